@@ -3,9 +3,14 @@
 #ifndef DLIB_BRIDGe_Hh_
 #define DLIB_BRIDGe_Hh_
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 #include "bridge_abstract.h"
 #include "../pipe.h"
@@ -15,6 +20,9 @@
 #include "../sockstreambuf.h"
 #include "../logger.h"
 #include "../algs.h"
+#include "../string.h"
+#include "../byte_orderer.h"
+#include "../matrix/matrix_fwd.h"
 
 
 namespace dlib
@@ -90,6 +98,44 @@ namespace dlib
         const unsigned short port;
     };
 
+    struct listen_on_unix_socket
+    {
+        listen_on_unix_socket(
+            const std::string& path_
+        ) : path(path_) 
+        {
+            // make sure requires clause is not broken
+            DLIB_ASSERT( path.size() != 0,
+                "\t listen_on_unix_socket()"
+                << "\n\t The path can't be empty."
+                << "\n\t this: " << this
+                );
+        }
+
+    private:
+        friend class bridge;
+        const std::string path;
+    };
+
+    struct connect_to_unix_socket
+    {
+        connect_to_unix_socket(
+            const std::string& path_
+        ) : path(path_) 
+        {
+            // make sure requires clause is not broken
+            DLIB_ASSERT( path.size() != 0,
+                "\t connect_to_unix_socket()"
+                << "\n\t The path can't be empty."
+                << "\n\t this: " << this
+                );
+        }
+
+    private:
+        friend class bridge;
+        const std::string path;
+    };
+
     template <typename pipe_type>
     struct bridge_transmit_decoration
     {
@@ -145,6 +191,148 @@ namespace dlib
 
     namespace impl_brns
     {
+        // The bridge sends these types as raw bytes, straight from and into their memory,
+        // rather than calling serialize() on each element.
+        template <typename T> 
+        struct is_raw_payload : std::false_type {};
+
+        template <typename T, long NR, long NC, typename MM>
+        struct is_raw_payload<matrix<T,NR,NC,MM,row_major_layout> > : std::is_arithmetic<T> {};
+
+        template <typename T, typename alloc>
+        struct is_raw_payload<std::vector<T,alloc> > : std::integral_constant<bool, 
+            std::is_arithmetic<T>::value && !std::is_same<T,bool>::value> {};
+
+        inline void write_raw_header (
+            uint64 nr,
+            uint64 nc,
+            unsigned char element_size,
+            std::ostream& out
+        )
+        {
+            serialize(nr, out);
+            serialize(nc, out);
+            // The high bit says if the data is little endian.
+            const unsigned char info = element_size | (byte_orderer().host_is_little_endian() ? 0x80 : 0);
+            out.write((const char*)&info, sizeof(info));
+        }
+
+        template <typename T>
+        void write_raw_data (
+            const T* data,
+            uint64 num,
+            std::ostream& out
+        )
+        {
+            if (num != 0)
+                out.write((const char*)data, num*sizeof(T));
+            if (!out)
+                throw serialization_error("Error writing raw data to the bridge connection.");
+        }
+
+        template <typename T>
+        void read_raw_data (
+            T* data,
+            uint64 num,
+            unsigned char info,
+            std::istream& in
+        )
+        {
+            if ((info&0x7F) != sizeof(T))
+                throw serialization_error("The bridge received raw data with the wrong element size.");
+
+            if (num != 0 && !in.read((char*)data, num*sizeof(T)))
+                throw serialization_error("Error reading raw data from the bridge connection.");
+
+            const bool data_is_little_endian = (info&0x80) != 0;
+            if (data_is_little_endian != byte_orderer().host_is_little_endian())
+            {
+                char* bytes = (char*)data;
+                for (uint64 i = 0; i < num; ++i)
+                    std::reverse(bytes + i*sizeof(T), bytes + (i+1)*sizeof(T));
+            }
+        }
+
+        template <typename T, long NR, long NC, typename MM>
+        void write_raw (
+            const matrix<T,NR,NC,MM,row_major_layout>& item,
+            std::ostream& out
+        )
+        {
+            write_raw_header(item.nr(), item.nc(), sizeof(T), out);
+            write_raw_data(item.size() != 0 ? &item(0,0) : (const T*)0, item.size(), out);
+        }
+
+        template <typename T, long NR, long NC, typename MM>
+        void read_raw (
+            matrix<T,NR,NC,MM,row_major_layout>& item,
+            std::istream& in
+        )
+        {
+            uint64 nr, nc;
+            unsigned char info;
+            deserialize(nr, in);
+            deserialize(nc, in);
+            if (!in.read((char*)&info, sizeof(info)))
+                throw serialization_error("Error reading raw data from the bridge connection.");
+            if ((NR != 0 && nr != (uint64)NR) || (NC != 0 && nc != (uint64)NC))
+                throw serialization_error("The bridge received a matrix of the wrong size.");
+
+            item.set_size(nr, nc);
+            read_raw_data(item.size() != 0 ? &item(0,0) : (T*)0, item.size(), info, in);
+        }
+
+        template <typename T, typename alloc>
+        void write_raw (
+            const std::vector<T,alloc>& item,
+            std::ostream& out
+        )
+        {
+            write_raw_header(item.size(), 1, sizeof(T), out);
+            write_raw_data(item.data(), item.size(), out);
+        }
+
+        template <typename T, typename alloc>
+        void read_raw (
+            std::vector<T,alloc>& item,
+            std::istream& in
+        )
+        {
+            uint64 nr, nc;
+            unsigned char info;
+            deserialize(nr, in);
+            deserialize(nc, in);
+            if (!in.read((char*)&info, sizeof(info)))
+                throw serialization_error("Error reading raw data from the bridge connection.");
+            if (nc != 1)
+                throw serialization_error("The bridge received raw data of the wrong shape.");
+
+            item.resize(nr);
+            read_raw_data(item.data(), item.size(), info, in);
+        }
+
+        template <typename T>
+        void write_raw (
+            const T& ,
+            std::ostream& 
+        )
+        {
+            // never called since the bridge only sends raw messages for is_raw_payload types.
+        }
+
+        template <typename T>
+        void read_raw (
+            T& ,
+            std::istream& 
+        )
+        {
+            throw serialization_error("The bridge received raw data for a type that can't take it.");
+        }
+
+// ----------------------------------------------------------------------------------------
+
+        struct unix_socket_tag {};
+
         class impl_bridge_base
         {
         public:
@@ -170,7 +358,17 @@ namespace dlib
                         - this object is supposed to be attempting to connect to ip:port when
                           not connected.
 
+                    - if (path.size() != 0) then
+                        - the connection is made over the Unix domain socket at path
+                          rather than over TCP.
+                        - if (list) then we created the socket file at path and remove it
+                          when this object is destroyed.
+
                     - get_bridge_status() == current_bs
+
+                    - peer_accepts_raw == true if the other end of the current connection
+                      told us it can receive is_raw_payload messages.  Otherwise we send
+                      everything with serialize().
             !*/
         public:
 
@@ -187,7 +385,10 @@ namespace dlib
                 receive_pipe(receive_pipe_),
                 dlog("dlib.bridge"),
                 keepalive_code(0),
-                message_code(1)
+                message_code(1),
+                raw_message_code(2),
+                accepts_raw_code(3),
+                peer_accepts_raw(false)
             {
                 int status = create_listener(list, listen_port);
                 if (status == PORTINUSE)
@@ -223,8 +424,42 @@ namespace dlib
                 receive_pipe(receive_pipe_),
                 dlog("dlib.bridge"),
                 keepalive_code(0),
-                message_code(1)
+                message_code(1),
+                raw_message_code(2),
+                accepts_raw_code(3),
+                peer_accepts_raw(false)
+            {
+                register_thread(*this, &impl_bridge::transmit_thread);
+                register_thread(*this, &impl_bridge::receive_thread);
+                register_thread(*this, &impl_bridge::connect_thread);
+
+                start();
+            }
+
+            impl_bridge (
+                unix_socket_tag,
+                const std::string& path_,
+                bool listen,
+                transmit_pipe_type* transmit_pipe_,
+                receive_pipe_type* receive_pipe_
+            ) :
+                s(m),
+                receive_thread_active(false),
+                transmit_thread_active(false),
+                port(0),
+                path(path_),
+                transmit_pipe(transmit_pipe_),
+                receive_pipe(receive_pipe_),
+                dlog("dlib.bridge"),
+                keepalive_code(0),
+                message_code(1),
+                raw_message_code(2),
+                accepts_raw_code(3),
+                peer_accepts_raw(false)
             {
+                if (listen && create_listener(list, path) != 0)
+                    throw socket_error("Unable to listen on the Unix domain socket '" + path + "'.");
+
                 register_thread(*this, &impl_bridge::transmit_thread);
                 register_thread(*this, &impl_bridge::receive_thread);
                 register_thread(*this, &impl_bridge::connect_thread);
@@ -266,6 +501,12 @@ namespace dlib
                 // wait for all the threads to terminate.
                 wait();
 
+                if (list && path.size() != 0)
+                {
+                    list.reset();
+                    std::remove(path.c_str());
+                }
+
                 if (transmit_pipe && transmit_enabled)
                     transmit_pipe->enable_dequeue();
                 if (receive_pipe && receive_enabled)
@@ -303,6 +544,50 @@ namespace dlib
             {
             }
 
+            std::string foreign_name (
+            ) const
+            {
+                if (con->is_inet())
+                    return con->get_foreign_ip() + ":" + cast_to_string(con->get_foreign_port());
+                else
+                    return path;
+            }
+
+            void set_foreign_address (
+                bridge_status& bs
+            ) const
+            {
+                // Unix domain socket connections don't have an IP address or port.
+                if (con->is_inet())
+                {
+                    bs.foreign_port = con->get_foreign_port();
+                    bs.foreign_ip = con->get_foreign_ip();
+                }
+                else
+                {
+                    bs.foreign_port = 0;
+                    bs.foreign_ip = "";
+                }
+            }
+
+            template <typename T>
+            void write_message (
+                const T& item,
+                std::ostream& out
+            )
+            {
+                if (is_raw_payload<T>::value && peer_accepts_raw)
+                {
+                    out.write((char*)&raw_message_code, sizeof(raw_message_code));
+                    write_raw(item, out);
+                }
+                else
+                {
+                    out.write((char*)&message_code, sizeof(message_code));
+                    serialize(item, out);
+                }
+            }
+
             void connect_thread (
             )
             {
@@ -317,6 +602,10 @@ namespace dlib
                             status = list->accept(con, 1000);
                         } while (status == TIMEOUT && !should_stop());
                     }
+                    else if (path.size() != 0)
+                    {
+                        status = create_connection(con, path);
+                    }
                     else
                     {
                         status = create_connection(con, port, ip);
@@ -332,18 +621,18 @@ namespace dlib
                         continue;
                     }
 
-                    dlog << LINFO << "Established new connection to " << con->get_foreign_ip() << ":" << con->get_foreign_port() << ".";
+                    dlog << LINFO << "Established new connection to " << foreign_name() << ".";
 
                     bridge_status temp_bs;
                     {   auto_mutex lock(current_bs_mutex);
                         current_bs.is_connected = true;
-                        current_bs.foreign_port = con->get_foreign_port();
-                        current_bs.foreign_ip = con->get_foreign_ip();
+                        set_foreign_address(current_bs);
                         temp_bs = current_bs;
                     }
                     enqueue_bridge_status(receive_pipe, temp_bs);
 
 
+                    peer_accepts_raw = false;
                     receive_thread_active = true;
                     transmit_thread_active = true;
 
@@ -355,11 +644,10 @@ namespace dlib
                         s.wait();
 
 
-                    dlog << LINFO << "Closed connection to " << con->get_foreign_ip() << ":" << con->get_foreign_port() << ".";
+                    dlog << LINFO << "Closed connection to " << foreign_name() << ".";
                     {   auto_mutex lock(current_bs_mutex);
                         current_bs.is_connected = false;
-                        current_bs.foreign_port = con->get_foreign_port();
-                        current_bs.foreign_ip = con->get_foreign_ip();
+                        set_foreign_address(current_bs);
                         temp_bs = current_bs;
                     }
                     enqueue_bridge_status(receive_pipe, temp_bs);
@@ -390,7 +678,7 @@ namespace dlib
                     {
                         if (receive_pipe)
                         {
-                            sockstreambuf buf(con);
+                            sockstreambuf buf(con, io_buffer_size, io_buffer_size);
                             std::istream in(&buf);
                             typename receive_pipe_type::type item;
                             // This isn't necessary but doing it avoids a warning about
@@ -406,31 +694,46 @@ namespace dlib
                                     deserialize(item, in);
                                     receive_pipe->enqueue(item);
                                 }
+                                else if (code == raw_message_code)
+                                {
+                                    read_raw(item, in);
+                                    receive_pipe->enqueue(item);
+                                }
+                                else if (code == accepts_raw_code)
+                                {
+                                    peer_accepts_raw = true;
+                                }
                             }
                         }
                         else
                         {
                             // Since we don't have a receive pipe to put messages into we will
-                            // just read the bytes from the connection and ignore them.
+                            // just read the bytes from the connection and ignore them.  The
+                            // only thing we look at is the first byte since that is where
+                            // the other end says if it takes raw messages.
                             char buf[1000];
-                            while (con->read(buf, sizeof(buf)) > 0) ;
+                            long num = con->read(buf, sizeof(buf));
+                            if (num > 0 && buf[0] == (char)accepts_raw_code)
+                                peer_accepts_raw = true;
+                            while (num > 0) 
+                                num = con->read(buf, sizeof(buf));
                         }
                     }
                     catch (std::bad_alloc& )
                     {
                         dlog << LERROR << "std::bad_alloc thrown while deserializing message from " 
-                            << con->get_foreign_ip() << ":" << con->get_foreign_port();
+                            << foreign_name();
                     }
                     catch (dlib::serialization_error& e)
                     {
                         dlog << LERROR << "dlib::serialization_error thrown while deserializing message from " 
-                            << con->get_foreign_ip() << ":" << con->get_foreign_port() 
+                            << foreign_name() 
                             << ".\nThe exception error message is: \n" << e.what();
                     }
                     catch (std::exception& e)
                     {
                         dlog << LERROR << "std::exception thrown while deserializing message from " 
-                            << con->get_foreign_ip() << ":" << con->get_foreign_port() 
+                            << foreign_name() 
                             << ".\nThe exception error message is: \n" << e.what();
                     }
 
@@ -468,13 +771,21 @@ namespace dlib
 
                     try
                     {
-                        sockstreambuf buf(con);
+                        sockstreambuf buf(con, io_buffer_size, io_buffer_size);
                         std::ostream out(&buf);
                         typename transmit_pipe_type::type item;
                         // This isn't necessary but doing it avoids a warning about
                         // item being uninitialized sometimes.
                         assign_zero_if_built_in_scalar_type(item);
 
+                        // The first byte we send tells the other end if we can take raw
+                        // messages.  Older versions of the bridge just ignore it.
+                        if (receive_pipe && is_raw_payload<typename receive_pipe_type::type>::value)
+                        {
+                            out.write((char*)&accepts_raw_code, sizeof(accepts_raw_code));
+                            out.flush();
+                        }
+
 
                         while (out)
                         {
@@ -483,8 +794,10 @@ namespace dlib
                             {
                                 if (transmit_pipe->dequeue_or_timeout(item,1000))
                                 {
-                                    out.write((char*)&message_code, sizeof(message_code));
-                                    serialize(item, out);
+                                    // Messages are collected in buf and only sent once the
+                                    // pipe is empty, so a burst of small messages goes out
+                                    // in a few big writes.  Big raw messages bypass buf.
+                                    write_message(item, out);
                                     if (transmit_pipe->size() == 0)
                                         out.flush();
 
@@ -514,18 +827,18 @@ namespace dlib
                     catch (std::bad_alloc& )
                     {
                         dlog << LERROR << "std::bad_alloc thrown while serializing message to " 
-                            << con->get_foreign_ip() << ":" << con->get_foreign_port();
+                            << foreign_name();
                     }
                     catch (dlib::serialization_error& e)
                     {
                         dlog << LERROR << "dlib::serialization_error thrown while serializing message to " 
-                            << con->get_foreign_ip() << ":" << con->get_foreign_port() 
+                            << foreign_name() 
                             << ".\nThe exception error message is: \n" << e.what();
                     }
                     catch (std::exception& e)
                     {
                         dlog << LERROR << "std::exception thrown while serializing message to " 
-                            << con->get_foreign_ip() << ":" << con->get_foreign_port() 
+                            << foreign_name() 
                             << ".\nThe exception error message is: \n" << e.what();
                     }
 
@@ -551,11 +864,17 @@ namespace dlib
             std::unique_ptr<listener> list;
             const unsigned short port;
             const std::string ip;
+            const std::string path;
             transmit_pipe_type* const transmit_pipe;
             receive_pipe_type* const receive_pipe;
             logger dlog;
             const unsigned char keepalive_code;
             const unsigned char message_code;
+            const unsigned char raw_message_code;
+            const unsigned char accepts_raw_code;
+            std::atomic<bool> peer_accepts_raw;
+
+            static const std::streamsize io_buffer_size = 64*1024;
 
             mutex current_bs_mutex;
             bridge_status current_bs;
@@ -647,6 +966,65 @@ namespace dlib
         ) { pimpl.reset(); pimpl.reset(new impl_brns::impl_bridge<T,T>(network_parameters.ip, network_parameters.port, &transmit_pipe.p, 0)); }
 
 
+
+
+
+        template < typename T, typename R >
+        void reconfigure (
+            listen_on_unix_socket network_parameters,
+            bridge_transmit_decoration<T> transmit_pipe,
+            bridge_receive_decoration<R> receive_pipe
+        ) { pimpl.reset(); pimpl.reset(new impl_brns::impl_bridge<T,R>(impl_brns::unix_socket_tag(), network_parameters.path, true, &transmit_pipe.p, &receive_pipe.p)); }
+
+        template < typename T, typename R >
+        void reconfigure (
+            listen_on_unix_socket network_parameters,
+            bridge_receive_decoration<R> receive_pipe,
+            bridge_transmit_decoration<T> transmit_pipe
+        ) { pimpl.reset(); pimpl.reset(new impl_brns::impl_bridge<T,R>(impl_brns::unix_socket_tag(), network_parameters.path, true, &transmit_pipe.p, &receive_pipe.p)); }
+
+        template < typename T >
+        void reconfigure (
+            listen_on_unix_socket network_parameters,
+            bridge_transmit_decoration<T> transmit_pipe
+        ) { pimpl.reset(); pimpl.reset(new impl_brns::impl_bridge<T,T>(impl_brns::unix_socket_tag(), network_parameters.path, true, &transmit_pipe.p, 0)); }
+
+        template < typename R >
+        void reconfigure (
+            listen_on_unix_socket network_parameters,
+            bridge_receive_decoration<R> receive_pipe
+        ) { pimpl.reset(); pimpl.reset(new impl_brns::impl_bridge<R,R>(impl_brns::unix_socket_tag(), network_parameters.path, true, 0, &receive_pipe.p)); }
+
+
+
+
+        template < typename T, typename R >
+        void reconfigure (
+            connect_to_unix_socket network_parameters,
+            bridge_transmit_decoration<T> transmit_pipe,
+            bridge_receive_decoration<R> receive_pipe
+        ) { pimpl.reset(); pimpl.reset(new impl_brns::impl_bridge<T,R>(impl_brns::unix_socket_tag(), network_parameters.path, false, &transmit_pipe.p, &receive_pipe.p)); }
+
+        template < typename T, typename R >
+        void reconfigure (
+            connect_to_unix_socket network_parameters,
+            bridge_receive_decoration<R> receive_pipe,
+            bridge_transmit_decoration<T> transmit_pipe
+        ) { pimpl.reset(); pimpl.reset(new impl_brns::impl_bridge<T,R>(impl_brns::unix_socket_tag(), network_parameters.path, false, &transmit_pipe.p, &receive_pipe.p)); }
+
+        template < typename R >
+        void reconfigure (
+            connect_to_unix_socket network_parameters,
+            bridge_receive_decoration<R> receive_pipe
+        ) { pimpl.reset(); pimpl.reset(new impl_brns::impl_bridge<R,R>(impl_brns::unix_socket_tag(), network_parameters.path, false, 0, &receive_pipe.p)); }
+
+        template < typename T >
+        void reconfigure (
+            connect_to_unix_socket network_parameters,
+            bridge_transmit_decoration<T> transmit_pipe
+        ) { pimpl.reset(); pimpl.reset(new impl_brns::impl_bridge<T,T>(impl_brns::unix_socket_tag(), network_parameters.path, false, &transmit_pipe.p, 0)); }
+
+
         bridge_status get_bridge_status (
         ) const
         {
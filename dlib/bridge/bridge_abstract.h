@@ -52,6 +52,37 @@ namespace dlib
         !*/
     };
 
+    struct connect_to_unix_socket
+    {
+        connect_to_unix_socket (
+            const std::string& path
+        );
+        /*!
+            requires
+                - path != ""
+            ensures
+                - this object will represent a request to connect to the Unix domain
+                  socket at the given file system path.  Use this instead of TCP when
+                  both applications run on the same machine since it avoids the TCP/IP
+                  stack.
+        !*/
+    };
+
+    struct listen_on_unix_socket
+    {
+        listen_on_unix_socket (
+            const std::string& path
+        );
+        /*!
+            requires
+                - path != ""
+            ensures
+                - this object will represent a request to create a Unix domain socket
+                  at the given file system path and listen on it for incoming
+                  connections.
+        !*/
+    };
+
     template <
         typename pipe_type
         >
@@ -91,7 +122,9 @@ namespace dlib
                 This simple struct represents the state of a bridge object.  A
                 bridge is either connected or not.  If it is connected then it
                 is connected to a foreign host with an IP address and port number
-                as indicated by this object.
+                as indicated by this object.  Connections over Unix domain sockets
+                don't have an IP address or port number, so for them foreign_ip is
+                always "" and foreign_port is always 0.
         !*/
         
         bridge_status(
@@ -135,6 +168,28 @@ namespace dlib
                 Additionally, a bridge object will periodically send bytes with
                 a value of 0 to ensure the TCP connection remains alive.  These
                 are just read and ignored.  
+
+                Objects are collected in a 64KB buffer and only written to the
+                connection once the transmit pipe is empty.  So a burst of small
+                objects is sent with a few large writes rather than one write per
+                object.
+
+                If the receive pipe holds dlib::matrix objects with arithmetic
+                elements and row major layout, or std::vector objects with arithmetic
+                (non-bool) elements, then the bridge sends a byte with the value 3 as
+                the very first byte on each new connection.  This tells the other end
+                it may send such objects in a raw binary format: a byte with the value
+                2, then the number of rows and columns as serialized uint64 values,
+                then one byte holding sizeof(element type) in its low 7 bits and a
+                high bit that is set if the data is little endian, and finally the
+                elements themselves, copied directly out of the object's memory.  The
+                receiving side reads them directly into the memory of the object it
+                enqueues, byte swapping them if the two machines have different
+                endianness.  This avoids the per element cost of serialize() and is
+                much faster for large numeric payloads.  The transmit side only uses
+                this format when the other end sent the value 3, so bridges built
+                before this format existed keep working with newer ones since they
+                ignore the value 3 and never send it.
         !*/
 
     public:
@@ -155,7 +210,8 @@ namespace dlib
         ); 
         /*!
             requires
-                - T is of type connect_to_ip_and_port or listen_on_port
+                - T is of type connect_to_ip_and_port, listen_on_port,
+                  connect_to_unix_socket, or listen_on_unix_socket
                 - U and V are of type bridge_transmit_decoration or bridge_receive_decoration,
                   however, U and V must be of different types (i.e. one is a receive type and 
                   another a transmit type).
@@ -173,7 +229,8 @@ namespace dlib
         ); 
         /*!
             requires
-                - T is of type connect_to_ip_and_port or listen_on_port
+                - T is of type connect_to_ip_and_port, listen_on_port,
+                  connect_to_unix_socket, or listen_on_unix_socket
                 - U is of type bridge_transmit_decoration or bridge_receive_decoration.
             ensures
                 - this object is properly initialized
@@ -336,6 +393,102 @@ namespace dlib
                   except that there is no transmit pipe.
         !*/
 
+
+
+        template <typename T, typename R>
+        void reconfigure (
+            listen_on_unix_socket network_parameters,
+            bridge_transmit_decoration<T> transmit_pipe,
+            bridge_receive_decoration<R> receive_pipe
+        ); 
+        /*!
+            ensures
+                - This function is identical to the listen_on_port version of
+                  reconfigure() except that it creates a Unix domain socket at the path
+                  given by network_parameters and listens on it instead of a TCP port.
+                - The socket file is removed when this object is cleared, reconfigured, or
+                  destructed.
+            throws
+                - socket_error
+                  This exception is thrown if we are unable to create the listening
+                  socket, e.g. because the file already exists.
+        !*/
+        template <typename T, typename R>
+        void reconfigure (
+            listen_on_unix_socket network_parameters,
+            bridge_receive_decoration<R> receive_pipe,
+            bridge_transmit_decoration<T> transmit_pipe
+        ); 
+        /*!
+            ensures
+                - performs reconfigure(network_parameters, transmit_pipe, receive_pipe)
+        !*/
+        template <typename T>
+        void reconfigure (
+            listen_on_unix_socket network_parameters,
+            bridge_transmit_decoration<T> transmit_pipe
+        );
+        /*!
+            ensures
+                - This function is identical to the above two reconfigure() functions 
+                  except that there is no receive pipe.
+        !*/
+        template <typename R>
+        void reconfigure (
+            listen_on_unix_socket network_parameters,
+            bridge_receive_decoration<R> receive_pipe
+        );
+        /*!
+            ensures
+                - This function is identical to the above three reconfigure() functions 
+                  except that there is no transmit pipe.
+        !*/
+
+
+
+        template <typename T, typename R>
+        void reconfigure (
+            connect_to_unix_socket network_parameters,
+            bridge_transmit_decoration<T> transmit_pipe,
+            bridge_receive_decoration<R> receive_pipe
+        ); 
+        /*!
+            ensures
+                - This function is identical to the connect_to_ip_and_port version of
+                  reconfigure() except that it connects to the Unix domain socket at the
+                  path given by network_parameters instead of a TCP port.
+        !*/
+        template <typename T, typename R>
+        void reconfigure (
+            connect_to_unix_socket network_parameters,
+            bridge_receive_decoration<R> receive_pipe,
+            bridge_transmit_decoration<T> transmit_pipe
+        ); 
+        /*!
+            ensures
+                - performs reconfigure(network_parameters, transmit_pipe, receive_pipe)
+        !*/
+        template <typename T>
+        void reconfigure (
+            connect_to_unix_socket network_parameters,
+            bridge_transmit_decoration<T> transmit_pipe
+        );
+        /*!
+            ensures
+                - This function is identical to the above two reconfigure() functions 
+                  except that there is no receive pipe.
+        !*/
+        template <typename R>
+        void reconfigure (
+            connect_to_unix_socket network_parameters,
+            bridge_receive_decoration<R> receive_pipe
+        );
+        /*!
+            ensures
+                - This function is identical to the above three reconfigure() functions 
+                  except that there is no transmit pipe.
+        !*/
+
     };
 
 // ---------------------------------------------------------------------------------------- 
@@ -131,6 +131,11 @@ namespace dlib
         // that an error occurred.
         const static char READ_ERROR                = 7;
 
+        // denotes a content message that is part of a collective operation such as
+        // bsp_context::all_reduce().  These are kept apart from normal messages, in a
+        // queue for each connection, so that a node can't mistake one for the other.
+        const static char COLLECTIVE_MESSAGE_HEADER = 8;
+
     // ------------------------------------------------------------------------------------
 
         void read_thread (
@@ -148,11 +153,17 @@ namespace dlib
                     deserialize(msg.msg_type, con->stream);
                     msg.sender_id = sender_id;
 
-                    if (msg.msg_type == MESSAGE_HEADER)
+                    if (msg.msg_type == MESSAGE_HEADER || msg.msg_type == COLLECTIVE_MESSAGE_HEADER)
                     {
                         msg.data.reset(new std::vector<char>);
                         deserialize(msg.epoch, con->stream);
                         deserialize(*msg.data, con->stream);
+
+                        if (msg.msg_type == COLLECTIVE_MESSAGE_HEADER)
+                        {
+                            con->collective_msgs.push(msg.data);
+                            continue;
+                        }
                     }
 
                     msg_buffer.push_and_consume(msg);
@@ -160,6 +171,7 @@ namespace dlib
                     if (msg.msg_type == NODE_TERMINATE)
                         break;
                 }
+                con->collective_msgs.close();
             }
             catch (std::exception& e)
             {
@@ -176,6 +188,7 @@ namespace dlib
                 msg.msg_type = READ_ERROR;
 
                 msg_buffer.push_and_consume(msg);
+                con->collective_msgs.close();
             }
             catch (...)
             {
@@ -191,6 +204,7 @@ namespace dlib
                 msg.msg_type = READ_ERROR;
 
                 msg_buffer.push_and_consume(msg);
+                con->collective_msgs.close();
             }
         }
 
@@ -327,6 +341,23 @@ namespace dlib
 
     }
 
+// ----------------------------------------------------------------------------------------
+
+    void bsp_context::
+    receive_data_from (
+        std::shared_ptr<std::vector<char> >& item,
+        unsigned long sending_node_id
+    ) 
+    {
+        if (!_cons[sending_node_id]->collective_msgs.pop(item))
+        {
+            std::ostringstream sout;
+            sout << "bsp_context: lost the connection to node " << sending_node_id 
+                 << " while waiting on a collective operation.";
+            throw dlib::socket_error(sout.str());
+        }
+    }
+
 // ----------------------------------------------------------------------------------------
 
     bool bsp_context::
@@ -473,19 +504,23 @@ namespace dlib
     void bsp_context::
     send_data(
         const std::vector<char>& item,
-        unsigned long target_node_id
+        unsigned long target_node_id,
+        bool is_collective
     ) 
     {
         using namespace impl2;
         if (_cons[target_node_id]->terminated)
             throw socket_error("Attempt to send a message to a node that has terminated.");
 
-        serialize(MESSAGE_HEADER, _cons[target_node_id]->stream);
+        serialize(is_collective ? COLLECTIVE_MESSAGE_HEADER : MESSAGE_HEADER, _cons[target_node_id]->stream);
         serialize(current_epoch, _cons[target_node_id]->stream);
         serialize(item, _cons[target_node_id]->stream);
         _cons[target_node_id]->stream.flush();
 
-        notify_control_node(SENT_MESSAGE);
+        // The receiving end of a collective operation is always waiting for its messages,
+        // so they don't need to be counted by the control node.
+        if (!is_collective)
+            notify_control_node(SENT_MESSAGE);
     }
 
 // ----------------------------------------------------------------------------------------
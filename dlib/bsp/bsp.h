@@ -5,8 +5,12 @@
 
 #include "bsp_abstract.h"
 
+#include <algorithm>
+#include <cstring>
+#include <deque>
 #include <memory>
 #include <queue>
+#include <type_traits>
 #include <vector>
 
 #include "../sockets.h"
@@ -17,6 +21,8 @@
 #include "../map.h"
 #include "../ref.h"
 #include "../vectorstream.h"
+#include "../byte_orderer.h"
+#include "../matrix/matrix_fwd.h"
 
 namespace dlib
 {
@@ -29,6 +35,58 @@ namespace dlib
             unsigned short
         ) {}
 
+        class collective_message_queue : noncopyable
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    This is a FIFO queue of the collective operation messages that came in
+                    over one connection.  Once the connection is closed pop() still returns
+                    the messages that are left and only then starts returning false.
+            !*/
+        public:
+            collective_message_queue() : sig(class_mutex), closed(false) {}
+
+            void close()
+            {
+                auto_mutex lock(class_mutex);
+                closed = true;
+                sig.broadcast();
+            }
+
+            void push (
+                const std::shared_ptr<std::vector<char> >& item
+            )
+            {
+                auto_mutex lock(class_mutex);
+                data.push_back(item);
+                sig.signal();
+            }
+
+            bool pop (
+                std::shared_ptr<std::vector<char> >& item
+            )
+            {
+                auto_mutex lock(class_mutex);
+                while (data.size() == 0 && !closed)
+                    sig.wait();
+
+                if (data.size() == 0)
+                    return false;
+
+                item = data.front();
+                data.pop_front();
+                return true;
+            }
+
+        private:
+            dlib::mutex class_mutex;
+            dlib::signaler sig;
+            std::deque<std::shared_ptr<std::vector<char> > > data;
+            bool closed;
+        };
+
+    // ------------------------------------------------------------------------------------
+
         struct bsp_con
         {
             bsp_con(
@@ -59,6 +117,7 @@ namespace dlib
             sockstreambuf buf;
             std::iostream stream;
             bool terminated;
+            collective_message_queue collective_msgs;
         };
 
         typedef dlib::map<unsigned long, std::unique_ptr<bsp_con> >::kernel_1a_c map_id_to_con;
@@ -412,6 +471,117 @@ namespace dlib
             }
         }
 
+        template <typename T>
+        void broadcast_from (
+            T& item,
+            unsigned long root_node_id
+        )
+        {
+            // make sure requires clause is not broken
+            DLIB_CASSERT(root_node_id < number_of_nodes(),
+                "\t void bsp_context::broadcast_from()"
+                << "\n\t Invalid arguments were given to this function."
+                << "\n\t root_node_id:      " << root_node_id
+                << "\n\t number_of_nodes(): " << number_of_nodes()
+                << "\n\t this: " << this
+                );
+
+            // Send item down a binomial tree rooted at root_node_id.  rel is our position
+            // in the tree, i.e. our id relative to the root.
+            const unsigned long n = number_of_nodes();
+            const unsigned long rel = (node_id() + n - root_node_id)%n;
+            unsigned long mask = 1;
+            while (mask < n)
+            {
+                if (rel & mask)
+                {
+                    receive_from(item, (rel - mask + root_node_id)%n);
+                    break;
+                }
+                mask <<= 1;
+            }
+
+            std::vector<char> buf;
+            for (mask >>= 1; mask > 0; mask >>= 1)
+            {
+                if (rel + mask < n)
+                {
+                    if (buf.size() == 0)
+                    {
+                        vectorstream sout(buf);
+                        serialize(item, sout);
+                    }
+                    send_data(buf, (rel + mask + root_node_id)%n, true);
+                }
+            }
+        }
+
+        template <typename T, typename reduce_op>
+        void all_reduce (
+            T& item,
+            reduce_op reduce
+        )
+        {
+            // Reduce up a binomial tree into node 0.  Each node combines its own value
+            // with the value from the subtree of higher ranked nodes, so the values are
+            // always combined in node id order.
+            const unsigned long n = number_of_nodes();
+            const unsigned long id = node_id();
+            for (unsigned long mask = 1; mask < n; mask <<= 1)
+            {
+                if (id & mask)
+                {
+                    send_collective(item, id - mask);
+                    break;
+                }
+                else if (id + mask < n)
+                {
+                    T temp;
+                    receive_from(temp, id + mask);
+                    item = reduce(item, temp);
+                }
+            }
+
+            broadcast_from(item, 0);
+        }
+
+        template <typename T, typename alloc>
+        void all_reduce_sum (
+            std::vector<T,alloc>& data
+        )
+        {
+            if (data.size() != 0)
+                all_reduce_sum(&data[0], data.size());
+            else
+                all_reduce_sum((T*)0, 0);
+        }
+
+        template <typename T, long NR, long NC, typename MM, typename L>
+        void all_reduce_sum (
+            matrix<T,NR,NC,MM,L>& data
+        )
+        {
+            if (data.size() != 0)
+                all_reduce_sum(&data(0,0), data.size());
+            else
+                all_reduce_sum((T*)0, 0);
+        }
+
+        template <typename T, typename alloc>
+        void reduce_scatter_sum (
+            std::vector<T,alloc>& data,
+            size_t& begin,
+            size_t& end
+        )
+        {
+            begin = chunk_begin(node_id(), data.size());
+            end = chunk_begin(node_id()+1, data.size());
+            if (data.size() != 0)
+                ring_reduce_scatter_sum(&data[0], data.size());
+            else
+                ring_reduce_scatter_sum((T*)0, 0);
+        }
+
         unsigned long node_id (
         ) const { return _node_id; }
 
@@ -464,12 +634,7 @@ namespace dlib
             std::shared_ptr<std::vector<char> > temp;
             if (receive_data(temp, sending_node_id))
             {
-                vectorstream sin(*temp);
-                deserialize(item, sin);
-                if (sin.peek() != EOF)
-                    throw serialization_error("deserialize() did not consume all bytes produced by serialize().  "
-                                              "This probably means you are calling a receive method with a different type "
-                                              "of object than the one which was sent.");
+                deserialize_message(item, *temp);
                 return true;
             }
             else
@@ -497,11 +662,177 @@ namespace dlib
                   of error.
         !*/
 
+        template <typename T>
+        static void deserialize_message (
+            T& item,
+            std::vector<char>& buf
+        )
+        {
+            vectorstream sin(buf);
+            deserialize(item, sin);
+            if (sin.peek() != EOF)
+                throw serialization_error("deserialize() did not consume all bytes produced by serialize().  "
+                                          "This probably means you are calling a receive method with a different type "
+                                          "of object than the one which was sent.");
+        }
+
+        template <typename T>
+        void receive_from (
+            T& item,
+            unsigned long sending_node_id
+        )
+        {
+            std::shared_ptr<std::vector<char> > temp;
+            receive_data_from(temp, sending_node_id);
+            deserialize_message(item, *temp);
+        }
+
+        static size_t chunk_begin (
+            unsigned long idx,
+            size_t size,
+            unsigned long n
+        ) { return size/n*idx + std::min<size_t>(idx, size%n); }
+
+        size_t chunk_begin (
+            unsigned long idx,
+            size_t size
+        ) const { return chunk_begin(idx, size, number_of_nodes()); }
+
+        template <typename T>
+        void send_chunk (
+            const T* data,
+            size_t num,
+            unsigned long target_node_id
+        )
+        {
+            // Chunks are sent as raw bytes in little endian order, which is a lot faster
+            // than serializing each element.
+            std::vector<char> buf(num*sizeof(T));
+            if (num != 0)
+                std::memcpy(&buf[0], data, buf.size());
+            if (!byte_orderer().host_is_little_endian())
+                swap_bytes<T>(buf);
+            send_data(buf, target_node_id, true);
+        }
+
+        template <typename T>
+        void receive_chunk (
+            T* data,
+            size_t num,
+            unsigned long sending_node_id,
+            bool add_to_data
+        )
+        {
+            std::shared_ptr<std::vector<char> > buf;
+            receive_data_from(buf, sending_node_id);
+            if (buf->size() != num*sizeof(T))
+                throw socket_error("bsp_context: the nodes called a collective operation with different amounts of data.");
+            if (!byte_orderer().host_is_little_endian())
+                swap_bytes<T>(*buf);
+
+            const char* src = buf->data();
+            for (size_t i = 0; i < num; ++i, src += sizeof(T))
+            {
+                T val;
+                std::memcpy(&val, src, sizeof(T));
+                if (add_to_data)
+                    data[i] += val;
+                else
+                    data[i] = val;
+            }
+        }
+
+        template <typename T>
+        static void swap_bytes (
+            std::vector<char>& buf
+        )
+        {
+            for (size_t i = 0; i + sizeof(T) <= buf.size(); i += sizeof(T))
+                std::reverse(buf.begin()+i, buf.begin()+i+sizeof(T));
+        }
+
+        template <typename T>
+        void ring_reduce_scatter_sum (
+            T* data,
+            size_t size
+        )
+        /*!
+            ensures
+                - #data[chunk_begin(node_id(),size), chunk_begin(node_id()+1,size)) == the sum
+                  of that range over all the nodes.
+        !*/
+        {
+            static_assert(std::is_arithmetic<T>::value && !std::is_same<T,bool>::value,
+                "The collective sum operations only work on arithmetic types.");
+
+            // Each node sends one chunk to the next node in the ring and adds the chunk it
+            // gets from the previous node into its own data.  After n-1 such steps every
+            // chunk has been summed over all nodes, each on a different node.
+            const unsigned long n = number_of_nodes();
+            const unsigned long id = node_id();
+            for (unsigned long step = 0; step+1 < n; ++step)
+            {
+                const unsigned long send_idx = (id + 2*n - step - 1)%n;
+                const unsigned long recv_idx = (id + 2*n - step - 2)%n;
+                send_chunk(data + chunk_begin(send_idx,size), chunk_begin(send_idx+1,size)-chunk_begin(send_idx,size), (id+1)%n);
+                receive_chunk(data + chunk_begin(recv_idx,size), chunk_begin(recv_idx+1,size)-chunk_begin(recv_idx,size), (id+n-1)%n, true);
+            }
+        }
+
+        template <typename T>
+        void ring_all_gather (
+            T* data,
+            size_t size
+        )
+        /*!
+            requires
+                - data[chunk_begin(node_id(),size), chunk_begin(node_id()+1,size)) contains
+                  this node's part of the result.
+            ensures
+                - copies every node's part into data.
+        !*/
+        {
+            const unsigned long n = number_of_nodes();
+            const unsigned long id = node_id();
+            for (unsigned long step = 0; step+1 < n; ++step)
+            {
+                const unsigned long send_idx = (id + n - step)%n;
+                const unsigned long recv_idx = (id + 2*n - step - 1)%n;
+                send_chunk(data + chunk_begin(send_idx,size), chunk_begin(send_idx+1,size)-chunk_begin(send_idx,size), (id+1)%n);
+                receive_chunk(data + chunk_begin(recv_idx,size), chunk_begin(recv_idx+1,size)-chunk_begin(recv_idx,size), (id+n-1)%n, false);
+            }
+        }
+
+        template <typename T>
+        void all_reduce_sum (
+            T* data,
+            size_t size
+        )
+        {
+            // A ring reduce-scatter followed by a ring all-gather.  Every node sends and
+            // receives about 2*size elements no matter how many nodes there are.
+            ring_reduce_scatter_sum(data, size);
+            ring_all_gather(data, size);
+        }
+
         bool receive_data (
             std::shared_ptr<std::vector<char> >& item,
             unsigned long& sending_node_id
         );
 
+        void receive_data_from (
+            std::shared_ptr<std::vector<char> >& item,
+            unsigned long sending_node_id
+        );
+        /*!
+            ensures
+                - #item == the next collective operation message sent to us by the given
+                  node.
+            throws
+                - dlib::socket_error if the connection to that node is lost before the
+                  message arrives.
+        !*/
+
 
         void notify_control_node (
             char val
@@ -513,7 +844,8 @@ namespace dlib
 
         void send_data(
             const std::vector<char>& item,
-            unsigned long target_node_id
+            unsigned long target_node_id,
+            bool is_collective = false
         );
         /*!
             requires
@@ -521,8 +853,24 @@ namespace dlib
                 - target_node_id != node_id()
             ensures
                 - sends a copy of item to the node with the given id.
+                - if (is_collective) then the message is part of a collective operation
+                  and the other end only hands it to receive_data_from().  These messages
+                  don't take part in the barrier synchronization bookkeeping done by the
+                  control node.
         !*/
 
+        template <typename T>
+        void send_collective (
+            const T& item,
+            unsigned long target_node_id
+        )
+        {
+            std::vector<char> buf;
+            vectorstream sout(buf);
+            serialize(item, sout);
+            send_data(buf, target_node_id, true);
+        }
+
 
 
 
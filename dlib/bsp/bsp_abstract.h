@@ -90,6 +90,140 @@ namespace dlib
                     network connectivity.
         !*/
 
+        // ------------------------------------------------------------------------------------
+        //                              Collective operations
+        // ------------------------------------------------------------------------------------
+        /*
+            The following functions are collective operations.  Every node must call the
+            same collective with the same root node and same sized data, and all nodes must
+            call collectives in the same order, otherwise they will block forever or throw
+            an exception.  The messages the collectives send between nodes are kept
+            apart from the ones sent by send() and broadcast().  A message sent with
+            send() that arrives while a node is inside a collective is simply left for the
+            receive methods, so collectives can be mixed freely with ordinary messaging.
+            Finally, note that a node waiting inside a collective doesn't count as blocked
+            on a receive method, so the receive methods' barrier synchronization can't
+            happen while any node is still inside a collective operation.
+        */
+
+        template <typename T>
+        void broadcast_from (
+            T& item,
+            unsigned long root_node_id
+        );
+        /*!
+            requires
+                - item is serializable
+                - root_node_id < number_of_nodes()
+            ensures
+                - #item == the value item had on the node with id root_node_id.  That is,
+                  this function copies item from the root node to all the other nodes.
+                - The copy is sent along a binomial tree, so it takes about
+                  log2(number_of_nodes()) rounds of messages rather than having the root
+                  send number_of_nodes()-1 messages.
+            throws
+                - dlib::socket_error
+                    This exception is thrown if some error occurs which prevents us from
+                    communicating with other processing nodes.
+                - dlib::serialization_error or any exception thrown by the global
+                  deserialize(T) routine.
+        !*/
+
+        template <typename T, typename reduce_op>
+        void all_reduce (
+            T& item,
+            reduce_op reduce
+        );
+        /*!
+            requires
+                - item is serializable and default constructable.
+                - reduce(a,b) is a valid expression that takes two objects of type T and
+                  returns a T.  It must be associative but doesn't need to be commutative.
+            ensures
+                - Let X(i) denote the value of item on the node with id i.  Then this
+                  function sets #item, on every node, to:
+                    reduce(...reduce(reduce(X(0), X(1)), X(2))..., X(number_of_nodes()-1))
+                  Moreover, every node gets exactly the same result, even if reduce() is
+                  only approximately associative, e.g. floating point addition.
+                - The values are combined along a binomial tree and then sent back out with
+                  broadcast_from(item,0).  This works for any T but sends the whole of item
+                  about 2*log2(number_of_nodes()) times.  Use all_reduce_sum() to add up
+                  large arrays of numbers.
+            throws
+                - dlib::socket_error, dlib::serialization_error, or any exception thrown by
+                  the global deserialize(T) routine or by reduce().
+        !*/
+
+        template <typename T, typename alloc>
+        void all_reduce_sum (
+            std::vector<T,alloc>& data
+        );
+        /*!
+            requires
+                - T is an arithmetic type other than bool.
+                - data.size() is the same on all nodes.
+            ensures
+                - Let X(i) denote the value of data on the node with id i.  Then this
+                  function sets #data, on every node, to the element-wise sum of X(i) over
+                  all nodes.  Every node gets exactly the same result.
+                - This is a ring all-reduce.  The data is split into number_of_nodes()
+                  chunks.  These are summed around the ring of nodes, each chunk ending up
+                  on a different node (a reduce-scatter), and then the summed chunks are
+                  passed around the ring again (an all-gather).  So each node sends and
+                  receives about 2*data.size() elements regardless of the number of nodes,
+                  which makes this the right tool for big arrays, e.g. averaging gradients
+                  in distributed training.
+                - The elements are sent as raw bytes rather than through serialize().
+            throws
+                - dlib::socket_error
+                    This exception is thrown if some error occurs which prevents us from
+                    communicating with other processing nodes or if data.size() isn't the
+                    same on all nodes.
+        !*/
+
+        template <typename T, long NR, long NC, typename MM, typename L>
+        void all_reduce_sum (
+            matrix<T,NR,NC,MM,L>& data
+        );
+        /*!
+            requires
+                - T is an arithmetic type other than bool.
+                - data.nr() and data.nc() are the same on all nodes.
+            ensures
+                - performs the same operation as the std::vector version of
+                  all_reduce_sum() but on the elements of a matrix.
+        !*/
+
+        template <typename T, typename alloc>
+        void reduce_scatter_sum (
+            std::vector<T,alloc>& data,
+            size_t& begin,
+            size_t& end
+        );
+        /*!
+            requires
+                - T is an arithmetic type other than bool.
+                - data.size() is the same on all nodes.
+            ensures
+                - Splits data into number_of_nodes() contiguous chunks of nearly equal size
+                  and gives each node the sum of one of them.  In particular:
+                    - #begin <= #end <= data.size()
+                    - [#begin, #end) is the chunk that belongs to this node.  The chunks
+                      are ordered by node id, so node 0 gets the first chunk and so on.
+                    - Let X(i) denote the value of data on the node with id i.  Then
+                      #data[j] == the sum over all nodes of X(i)[j], for all j in the
+                      range [#begin, #end).
+                    - The other elements of #data have unspecified values.
+                - This is the first half of all_reduce_sum(), so it sends only about half
+                  as much data.  It's useful when each node only needs part of the result,
+                  e.g. when each node updates a different part of a model.
+            throws
+                - dlib::socket_error
+                    This exception is thrown if some error occurs which prevents us from
+                    communicating with other processing nodes or if data.size() isn't the
+                    same on all nodes.
+        !*/
+
         unsigned long node_id (
         ) const; 
         /*!
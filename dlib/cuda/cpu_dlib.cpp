@@ -9,12 +9,368 @@
 #include "tensor_tools.h"
 #include "../image_transforms/interpolation.h"
 #include "../threads.h"
+#include "../simd.h"
+#include <cstring>
 
 namespace dlib
 {
     namespace cpu 
     {
 
+    // -----------------------------------------------------------------------------------
+
+        namespace
+        {
+            /*
+                Most of the elementwise and normalization kernels in this file are memory
+                bound.  They are written in terms of simd8f, so they use AVX when dlib is
+                built with USE_AVX_INSTRUCTIONS and pairs of SSE registers otherwise, and
+                large tensors are split into chunks that run on the default thread pool.
+
+                The transcendental functions they need are computed with the polynomial
+                approximations below rather than calling std::exp() and friends one
+                element at a time.  fast_exp() is within a couple of ULP of std::exp(),
+                fast_tanh() is within about 2e-7 in absolute terms, and fast_erf() has a
+                relative error of at most about 2e-7, including near 0.
+            */
+
+            // Work smaller than this, counted in floats, isn't worth sending to another
+            // thread.
+            const size_t min_parallel_chunk = 16*1024;
+
+            template <typename funct_type>
+            void parallel_in_chunks (
+                size_t num_items,
+                size_t item_size,
+                funct_type&& funct
+            )
+            /*!
+                ensures
+                    - calls funct(begin,end) for disjoint ranges that together cover
+                      [0,num_items), possibly in parallel.  item_size is the number of
+                      floats each item touches and decides how the range is split.
+            !*/
+            {
+                const size_t items_per_chunk = std::max<size_t>(1, min_parallel_chunk/std::max<size_t>(1,item_size));
+                const size_t num_chunks = num_items/items_per_chunk;
+                if (num_chunks <= 1 || default_thread_pool().num_threads_in_pool() <= 1)
+                {
+                    if (num_items != 0)
+                        funct(0, num_items);
+                    return;
+                }
+
+                parallel_for_blocked(0, num_chunks, [&](long begin, long end)
+                {
+                    funct(begin*items_per_chunk, (size_t)end == num_chunks ? num_items : end*items_per_chunk);
+                }, 4);
+            }
+
+        // -------------------------------------------------------------------------------
+
+            inline simd8f reinterpret_as_float (
+                const simd8i& v
+            )
+            {
+                int32 temp[8];
+                v.store(temp);
+                float ftemp[8];
+                std::memcpy(ftemp, temp, sizeof(ftemp));
+                simd8f result;
+                result.load(ftemp);
+                return result;
+            }
+
+            inline simd8f fast_floor (
+                const simd8f& x
+            )
+            {
+                // simd8f's floor() is a scalar loop without SSE4.1, truncating and fixing up
+                // the negative numbers is always a couple of instructions.
+                const simd8f t = simd8i(x);
+                return select(t > x, t - simd8f(1), t);
+            }
+
+            inline simd8f fast_abs (
+                const simd8f& x
+            )
+            {
+                return select(x < simd8f(0), simd8f(0) - x, x);
+            }
+
+            inline simd8f fast_exp (
+                const simd8f& x
+            )
+            {
+                // This is the Cephes expf() algorithm.  Write exp(x) == 2^n * exp(r) where
+                // |r| <= ln(2)/2, approximate exp(r) with a polynomial and put n directly
+                // into the exponent bits.
+                const simd8f hi(88.3762626647949f);
+                const simd8f lo(-87.3365447504019f);
+                const simd8f xc = min(max(x, lo), hi);
+
+                const simd8f fx = fast_floor(xc*simd8f(1.44269504088896341f) + simd8f(0.5f));
+                const simd8f r = xc - fx*simd8f(0.693359375f) - fx*simd8f(-2.12194440e-4f);
+
+                simd8f y = simd8f(1.9875691500e-4f);
+                y = y*r + simd8f(1.3981999507e-3f);
+                y = y*r + simd8f(8.3334519073e-3f);
+                y = y*r + simd8f(4.1665795894e-2f);
+                y = y*r + simd8f(1.6666665459e-1f);
+                y = y*r + simd8f(5.0000001201e-1f);
+                y = y*r*r + r + simd8f(1);
+
+                const simd8f pow2n = reinterpret_as_float((simd8i(fx) + simd8i(127)) << 23);
+                simd8f result = y*pow2n;
+                // Clamping the input keeps the exponent bits valid, so fix up the values
+                // that really overflow or underflow, and let NaNs through.
+                result = select(x < lo, simd8f(0), result);
+                result = select(x > hi, simd8f(std::numeric_limits<float>::infinity()), result);
+                return select(x != x, x, result);
+            }
+
+            inline simd8f fast_sigmoid (
+                const simd8f& x
+            )
+            {
+                return simd8f(1)/(simd8f(1) + fast_exp(simd8f(0) - x));
+            }
+
+            inline simd8f fast_tanh (
+                const simd8f& x
+            )
+            {
+                const simd8f ax = fast_abs(x);
+                // Near 0 use the odd polynomial from Cephes tanhf() since 1-2/(exp(2x)+1)
+                // loses all the relative precision there.
+                const simd8f z = x*x;
+                simd8f p = simd8f(-5.70498872745e-3f);
+                p = p*z + simd8f(2.06390887954e-2f);
+                p = p*z + simd8f(-5.37397155531e-2f);
+                p = p*z + simd8f(1.33314422036e-1f);
+                p = p*z + simd8f(-3.33332819422e-1f);
+                const simd8f small = p*z*x + x;
+
+                const simd8f big = simd8f(1) - simd8f(2)/(fast_exp(ax + ax) + simd8f(1));
+                const simd8f signed_big = select(x < simd8f(0), simd8f(0) - big, big);
+                return select(ax < simd8f(0.625f), small, signed_big);
+            }
+
+            inline simd8f fast_erf (
+                const simd8f& x
+            )
+            {
+                // For |x| < 1 an odd polynomial, the one in the Cephes library's erff().
+                // Computing 1 - erfc(x) there instead would lose most of the bits of a small
+                // erf(x).
+                const simd8f z = x*x;
+                simd8f s = simd8f(7.853861353153693e-5f);
+                s = s*z + simd8f(-8.010193625184903e-4f);
+                s = s*z + simd8f(5.188327685732524e-3f);
+                s = s*z + simd8f(-2.685381193529856e-2f);
+                s = s*z + simd8f(1.128358514861418e-1f);
+                s = s*z + simd8f(-3.761262582423300e-1f);
+                s = s*z + simd8f(1.128379165726710f);
+                const simd8f small = s*x;
+
+                // Otherwise Abramowitz and Stegun formula 7.1.26.
+                const simd8f ax = fast_abs(x);
+                const simd8f t = simd8f(1)/(simd8f(1) + simd8f(0.3275911f)*ax);
+                simd8f p = simd8f(1.061405429f);
+                p = p*t + simd8f(-1.453152027f);
+                p = p*t + simd8f(1.421413741f);
+                p = p*t + simd8f(-0.284496736f);
+                p = p*t + simd8f(0.254829592f);
+                const simd8f big = simd8f(1) - p*t*fast_exp(simd8f(0) - ax*ax);
+                const simd8f signed_big = select(x < simd8f(0), simd8f(0) - big, big);
+                return select(ax < simd8f(1), small, signed_big);
+            }
+
+        // -------------------------------------------------------------------------------
+
+            template <typename funct_type>
+            void apply (
+                size_t size,
+                float* d,
+                const float* s,
+                funct_type&& f
+            )
+            /*!
+                ensures
+                    - performs d[i] = f(s[i]) for all i < size, 8 elements at a time.  f
+                      takes and returns simd8f.  d and s may be the same array.
+            !*/
+            {
+                size_t i = 0;
+                simd8f x;
+                for (; i + 8 <= size; i += 8)
+                {
+                    x.load(s+i);
+                    f(x).store(d+i);
+                }
+                if (i != size)
+                {
+                    float temp[8] = {};
+                    std::copy(s+i, s+size, temp);
+                    x.load(temp);
+                    f(x).store(temp);
+                    std::copy(temp, temp+(size-i), d+i);
+                }
+            }
+
+            template <typename funct_type>
+            void apply (
+                size_t size,
+                float* d,
+                const float* s1,
+                const float* s2,
+                funct_type&& f
+            )
+            {
+                size_t i = 0;
+                simd8f x, y;
+                for (; i + 8 <= size; i += 8)
+                {
+                    x.load(s1+i);
+                    y.load(s2+i);
+                    f(x,y).store(d+i);
+                }
+                if (i != size)
+                {
+                    float temp1[8] = {}, temp2[8] = {};
+                    std::copy(s1+i, s1+size, temp1);
+                    std::copy(s2+i, s2+size, temp2);
+                    x.load(temp1);
+                    y.load(temp2);
+                    f(x,y).store(temp1);
+                    std::copy(temp1, temp1+(size-i), d+i);
+                }
+            }
+
+            template <typename funct_type>
+            void apply (
+                size_t size,
+                float* d,
+                const float* s1,
+                const float* s2,
+                const float* s3,
+                funct_type&& f
+            )
+            {
+                size_t i = 0;
+                simd8f x, y, z;
+                for (; i + 8 <= size; i += 8)
+                {
+                    x.load(s1+i);
+                    y.load(s2+i);
+                    z.load(s3+i);
+                    f(x,y,z).store(d+i);
+                }
+                if (i != size)
+                {
+                    float temp1[8] = {}, temp2[8] = {}, temp3[8] = {};
+                    std::copy(s1+i, s1+size, temp1);
+                    std::copy(s2+i, s2+size, temp2);
+                    std::copy(s3+i, s3+size, temp3);
+                    x.load(temp1);
+                    y.load(temp2);
+                    z.load(temp3);
+                    f(x,y,z).store(temp1);
+                    std::copy(temp1, temp1+(size-i), d+i);
+                }
+            }
+
+            template <typename funct_type>
+            void parallel_apply (
+                size_t size,
+                float* d,
+                const float* s,
+                funct_type f
+            )
+            {
+                parallel_in_chunks(size, 1, [&](size_t begin, size_t end) {
+                    apply(end-begin, d+begin, s+begin, f);
+                });
+            }
+
+            template <typename funct_type>
+            void parallel_apply (
+                size_t size,
+                float* d,
+                const float* s1,
+                const float* s2,
+                funct_type f
+            )
+            {
+                parallel_in_chunks(size, 1, [&](size_t begin, size_t end) {
+                    apply(end-begin, d+begin, s1+begin, s2+begin, f);
+                });
+            }
+
+            template <typename funct_type>
+            void parallel_apply (
+                size_t size,
+                float* d,
+                const float* s1,
+                const float* s2,
+                const float* s3,
+                funct_type f
+            )
+            {
+                parallel_in_chunks(size, 1, [&](size_t begin, size_t end) {
+                    apply(end-begin, d+begin, s1+begin, s2+begin, s3+begin, f);
+                });
+            }
+
+            template <typename funct_type>
+            void apply_gradient (
+                tensor& grad,
+                const tensor& gradient_input,
+                const tensor& src,
+                funct_type f
+            )
+            /*!
+                ensures
+                    - if (is_same_object(grad, gradient_input)) then
+                        - performs grad = gradient_input*f(src), elementwise
+                    - else
+                        - performs grad += gradient_input*f(src), elementwise
+            !*/
+            {
+                const auto g = grad.host();
+                const auto in = gradient_input.host();
+                const auto s = src.host();
+                if (is_same_object(grad, gradient_input))
+                    parallel_apply(src.size(), g, in, s, [&f](simd8f gi, simd8f x) { return gi*f(x); });
+                else
+                    parallel_apply(src.size(), g, g, in, s, [&f](simd8f gv, simd8f gi, simd8f x) { return gv + gi*f(x); });
+            }
+
+            void sum_and_sum_of_squares (
+                size_t size,
+                const float* s,
+                float& sum_out,
+                float& sum_sqr_out
+            )
+            {
+                simd8f sum(0), sum_sqr(0), x;
+                size_t i = 0;
+                for (; i + 8 <= size; i += 8)
+                {
+                    x.load(s+i);
+                    sum += x;
+                    sum_sqr += x*x;
+                }
+                sum_out = dlib::sum(sum);
+                sum_sqr_out = dlib::sum(sum_sqr);
+                for (; i < size; ++i)
+                {
+                    sum_out += s[i];
+                    sum_sqr_out += s[i]*s[i];
+                }
+            }
+        }
+
     // -----------------------------------------------------------------------------------
 
         void multiply (
@@ -485,8 +841,8 @@ namespace dlib
             DLIB_CASSERT(dest.size()==src.size());
             const auto d = dest.host();
             const auto s = src.host();
-            for (size_t i = 0; i < src.size(); ++i)
-                d[i] = A*s[i] + B;
+            const simd8f a(A), b(B);
+            parallel_apply(src.size(), d, s, [a,b](simd8f x) { return a*x + b; });
         }
 
         void affine_transform(
@@ -503,8 +859,8 @@ namespace dlib
             const auto d = dest.host();
             const auto s1 = src1.host();
             const auto s2 = src2.host();
-            for (size_t i = 0; i < src1.size(); ++i)
-                d[i] = A*s1[i] + B*s2[i] + C;
+            const simd8f a(A), b(B), c(C);
+            parallel_apply(src1.size(), d, s1, s2, [a,b,c](simd8f x, simd8f y) { return a*x + b*y + c; });
         }
 
         void affine_transform(
@@ -525,8 +881,8 @@ namespace dlib
             const auto s1 = src1.host();
             const auto s2 = src2.host();
             const auto s3 = src3.host();
-            for (size_t i = 0; i < src1.size(); ++i)
-                d[i] = A*s1[i] + B*s2[i] + C*s3[i] + D;
+            const simd8f a(A), b(B), c(C), dd(D);
+            parallel_apply(src1.size(), d, s1, s2, s3, [a,b,c,dd](simd8f x, simd8f y, simd8f z) { return a*x + b*y + c*z + dd; });
         }
 
         void affine_transform_range(
@@ -549,8 +905,9 @@ namespace dlib
             const auto s1 = src1.host();
             const auto s2 = src2.host();
             const auto s3 = src3.host();
-            for (size_t i = begin; i < end; ++i)
-                d[i] = A*s1[i] + B*s2[i] + C*s3[i];
+            const simd8f a(A), b(B), c(C);
+            parallel_apply(end-begin, d+begin, s1+begin, s2+begin, s3+begin,
+                [a,b,c](simd8f x, simd8f y, simd8f z) { return a*x + b*y + c*z; });
         }
 
     // -----------------------------------------------------------------------------------
@@ -574,23 +931,18 @@ namespace dlib
             auto s = src.host();
             const auto a = A.host();
             const auto b = B.host();
+            const auto f = [](simd8f x, simd8f y, simd8f z) { return y*x + z; };
             if (A.num_samples() == 1)
             {
                 const long num = src.size()/src.num_samples();
-                for (long i = 0; i < src.num_samples(); ++i)
-                {
-                    for (long j = 0; j < num; ++j)
-                    {
-                        *d = a[j]*(*s) + b[j];
-                        d++;
-                        s++;
-                    }
-                }
+                parallel_in_chunks(src.num_samples(), num, [&](size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; ++i)
+                        apply(num, d+i*num, s+i*num, a, b, f);
+                });
             }
             else
             {
-                for (size_t i = 0; i < src.size(); ++i)
-                    d[i] = a[i]*s[i] + b[i];
+                parallel_apply(src.size(), d, s, a, b, f);
             }
         }
 
@@ -614,19 +966,15 @@ namespace dlib
             auto s = src.host();
             const auto a = A.host();
             const auto b = B.host();
-            for (long n = 0; n < dest.num_samples(); ++n)
-            {
-                for (long k = 0; k < dest.k(); ++k)
+            const long num = dest.nr()*dest.nc();
+            const long ks = dest.k();
+            parallel_in_chunks(dest.num_samples()*ks, num, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i)
                 {
-                    for (long r = 0; r < dest.nr(); ++r)
-                    {
-                        for (long c = 0; c < dest.nc(); ++c)
-                        {
-                            *d++ = a[k]*(*s++) + b[k];
-                        }
-                    }
+                    const simd8f ak(a[i%ks]), bk(b[i%ks]);
+                    apply(num, d+i*num, s+i*num, [ak,bk](simd8f x) { return ak*x + bk; });
                 }
-            }
+            });
         }
 
     // ----------------------------------------------------------------------------------------
@@ -703,13 +1051,430 @@ namespace dlib
             auto ps = s.host_write_only();
             auto pparams = params.host();
             auto ppgrad = params_grad.host();
-            for (size_t i = begin; i < end; ++i)
+            parallel_in_chunks(end-begin, 5, [&](size_t cbegin, size_t cend) {
+                cbegin += begin;
+                cend += begin;
+                const simd8f wd(weight_decay), m1(momentum1), m2(momentum2);
+                const simd8f one_m1(1-momentum1), one_m2(1-momentum2);
+                const simd8f neg_alpha(-alpha), veps(eps);
+                size_t i = cbegin;
+                for (; i + 8 <= cend; i += 8)
+                {
+                    simd8f p, g, vm, vv;
+                    p.load(pparams+i);
+                    g.load(ppgrad+i);
+                    vm.load(pm+i);
+                    vv.load(pv+i);
+                    g = wd*p + g;
+                    vm = m1*vm + one_m1*g;
+                    vv = m2*vv + one_m2*g*g;
+                    vm.store(pm+i);
+                    vv.store(pv+i);
+                    (neg_alpha*vm/(sqrt(vv) + veps)).store(ps+i);
+                }
+                for (; i < cend; ++i)
+                {
+                    float g = weight_decay*pparams[i] + ppgrad[i];
+                    pm[i] = momentum1*pm[i] + (1-momentum1)*g;
+                    pv[i] = momentum2*pv[i] + (1-momentum2)*g*g;
+                    ps[i] = -alpha*pm[i]/(std::sqrt(pv[i]) + eps);
+                }
+            });
+        }
+
+    // -----------------------------------------------------------------------------------
+
+        namespace
+        {
+            struct prepared_solver_segment
+            {
+                const float* p;
+                const float* g;
+                float* s1;
+                float* s2;
+                float* out;
+                bool in_place;
+                // Rule dependent constants, see apply_solver_updates().
+                float c1 = 0;
+                float c2 = 0;
+                // The trust ratio of lamb and lars segments.
+                float ratio = 1;
+            };
+
+            struct solver_update_piece
+            {
+                size_t segment;
+                size_t begin;
+                size_t end;
+            };
+
+            inline bool solver_rule_needs_norms (
+                tt::solver_update_rule rule
+            )
+            {
+                return rule == tt::solver_update_rule::lamb || rule == tt::solver_update_rule::lars;
+            }
+
+            inline void store_solver_update (
+                const prepared_solver_segment& ps,
+                size_t i,
+                const simd8f& u
+            )
             {
-                float g = weight_decay*pparams[i] + ppgrad[i];
-                pm[i] = momentum1*pm[i] + (1-momentum1)*g;
-                pv[i] = momentum2*pv[i] + (1-momentum2)*g*g;
-                ps[i] = -alpha*pm[i]/(std::sqrt(pv[i]) + eps);
+                if (ps.in_place)
+                {
+                    simd8f p;
+                    p.load(ps.out+i);
+                    (p + u).store(ps.out+i);
+                }
+                else
+                {
+                    u.store(ps.out+i);
+                }
+            }
+
+            inline void store_solver_update (
+                const prepared_solver_segment& ps,
+                size_t i,
+                float u
+            )
+            {
+                if (ps.in_place)
+                    ps.out[i] += u;
+                else
+                    ps.out[i] = u;
+            }
+
+            void compute_solver_norms (
+                const tt::solver_update_segment& seg,
+                const prepared_solver_segment& ps,
+                size_t begin,
+                size_t end,
+                double& psqr,
+                double& rsqr
+            )
+            /*!
+                ensures
+                    - For lamb, updates the moment estimates in [begin,end) and sets psqr
+                      and rsqr to the squared lengths of p and R in that range.
+                    - For lars, sets psqr and rsqr to the squared lengths of p and g.
+            !*/
+            {
+                simd8f vpsqr(0), vrsqr(0);
+                size_t i = begin;
+                if (seg.rule == tt::solver_update_rule::lamb)
+                {
+                    const simd8f wd(seg.weight_decay), m1(seg.momentum1), m2(seg.momentum2);
+                    const simd8f one_m1(1-seg.momentum1), one_m2(1-seg.momentum2);
+                    const simd8f bc1(ps.c1), bc2(ps.c2), veps(1e-6f);
+                    for (; i + 8 <= end; i += 8)
+                    {
+                        simd8f p, g, vm, vv;
+                        p.load(ps.p+i);
+                        g.load(ps.g+i);
+                        vm.load(ps.s1+i);
+                        vv.load(ps.s2+i);
+                        vm = m1*vm + one_m1*g;
+                        vv = m2*vv + one_m2*g*g;
+                        vm.store(ps.s1+i);
+                        vv.store(ps.s2+i);
+                        const simd8f r = bc1*vm/(sqrt(bc2*vv) + veps) + wd*p;
+                        vpsqr += p*p;
+                        vrsqr += r*r;
+                    }
+                    psqr = sum(vpsqr);
+                    rsqr = sum(vrsqr);
+                    for (; i < end; ++i)
+                    {
+                        const float p = ps.p[i];
+                        const float g = ps.g[i];
+                        ps.s1[i] = seg.momentum1*ps.s1[i] + (1-seg.momentum1)*g;
+                        ps.s2[i] = seg.momentum2*ps.s2[i] + (1-seg.momentum2)*g*g;
+                        const float r = ps.c1*ps.s1[i]/(std::sqrt(ps.c2*ps.s2[i]) + 1e-6f) + seg.weight_decay*p;
+                        psqr += p*p;
+                        rsqr += r*r;
+                    }
+                }
+                else
+                {
+                    for (; i + 8 <= end; i += 8)
+                    {
+                        simd8f p, g;
+                        p.load(ps.p+i);
+                        g.load(ps.g+i);
+                        vpsqr += p*p;
+                        vrsqr += g*g;
+                    }
+                    psqr = sum(vpsqr);
+                    rsqr = sum(vrsqr);
+                    for (; i < end; ++i)
+                    {
+                        psqr += ps.p[i]*ps.p[i];
+                        rsqr += ps.g[i]*ps.g[i];
+                    }
+                }
+            }
+
+            void compute_solver_update (
+                const tt::solver_update_segment& seg,
+                const prepared_solver_segment& ps,
+                size_t begin,
+                size_t end
+            )
+            {
+                const float lr = seg.learning_rate;
+                const float wd = seg.weight_decay;
+                const float m1 = seg.momentum1;
+                const float m2 = seg.momentum2;
+                const simd8f vwd(wd), vm1(m1), vm2(m2), one_m1(1-m1), one_m2(1-m2);
+                size_t i = begin;
+                switch (seg.rule)
+                {
+                    case tt::solver_update_rule::sgd:
+                    {
+                        const simd8f neg_wdlr(-wd*lr), neg_lr(-lr);
+                        for (; i + 8 <= end; i += 8)
+                        {
+                            simd8f p, g, v;
+                            p.load(ps.p+i);
+                            g.load(ps.g+i);
+                            v.load(ps.s1+i);
+                            v = vm1*v + neg_wdlr*p + neg_lr*g;
+                            v.store(ps.s1+i);
+                            store_solver_update(ps, i, v);
+                        }
+                        for (; i < end; ++i)
+                        {
+                            ps.s1[i] = m1*ps.s1[i] - wd*lr*ps.p[i] - lr*ps.g[i];
+                            store_solver_update(ps, i, ps.s1[i]);
+                        }
+                    } break;
+
+                    case tt::solver_update_rule::adam:
+                    case tt::solver_update_rule::adamw:
+                    {
+                        // c1 is the bias corrected step size alpha.  Only adam folds the
+                        // weight decay into the gradient.
+                        const float l2 = seg.rule == tt::solver_update_rule::adam ? wd : 0;
+                        const float decay = seg.rule == tt::solver_update_rule::adamw ? -lr*wd : 0;
+                        const simd8f vl2(l2), vdecay(decay), neg_alpha(-ps.c1), veps(1e-8f);
+                        for (; i + 8 <= end; i += 8)
+                        {
+                            simd8f p, g, vm, vv;
+                            p.load(ps.p+i);
+                            g.load(ps.g+i);
+                            vm.load(ps.s1+i);
+                            vv.load(ps.s2+i);
+                            g = vl2*p + g;
+                            vm = vm1*vm + one_m1*g;
+                            vv = vm2*vv + one_m2*g*g;
+                            vm.store(ps.s1+i);
+                            vv.store(ps.s2+i);
+                            store_solver_update(ps, i, neg_alpha*vm/(sqrt(vv) + veps) + vdecay*p);
+                        }
+                        for (; i < end; ++i)
+                        {
+                            const float p = ps.p[i];
+                            const float g = l2*p + ps.g[i];
+                            ps.s1[i] = m1*ps.s1[i] + (1-m1)*g;
+                            ps.s2[i] = m2*ps.s2[i] + (1-m2)*g*g;
+                            store_solver_update(ps, i, -ps.c1*ps.s1[i]/(std::sqrt(ps.s2[i]) + 1e-8f) + decay*p);
+                        }
+                    } break;
+
+                    case tt::solver_update_rule::lamb:
+                    {
+                        // The moments were already updated by compute_solver_norms().
+                        const simd8f bc1(ps.c1), bc2(ps.c2), veps(1e-6f), neg_step(-lr*ps.ratio);
+                        for (; i + 8 <= end; i += 8)
+                        {
+                            simd8f p, vm, vv;
+                            p.load(ps.p+i);
+                            vm.load(ps.s1+i);
+                            vv.load(ps.s2+i);
+                            store_solver_update(ps, i, neg_step*(bc1*vm/(sqrt(bc2*vv) + veps) + vwd*p));
+                        }
+                        for (; i < end; ++i)
+                        {
+                            const float r = ps.c1*ps.s1[i]/(std::sqrt(ps.c2*ps.s2[i]) + 1e-6f) + wd*ps.p[i];
+                            store_solver_update(ps, i, -lr*ps.ratio*r);
+                        }
+                    } break;
+
+                    case tt::solver_update_rule::lars:
+                    {
+                        const simd8f local_lr(lr*ps.ratio);
+                        for (; i + 8 <= end; i += 8)
+                        {
+                            simd8f p, g, v;
+                            p.load(ps.p+i);
+                            g.load(ps.g+i);
+                            v.load(ps.s1+i);
+                            v = vm1*v + local_lr*(g + vwd*p);
+                            v.store(ps.s1+i);
+                            store_solver_update(ps, i, simd8f(0) - v);
+                        }
+                        for (; i < end; ++i)
+                        {
+                            ps.s1[i] = m1*ps.s1[i] + lr*ps.ratio*(ps.g[i] + wd*ps.p[i]);
+                            store_solver_update(ps, i, -ps.s1[i]);
+                        }
+                    } break;
+                }
+            }
+
+            class solver_work_list
+            {
+                /*!
+                    WHAT THIS OBJECT REPRESENTS
+                        A list of pieces of segments, grouped into work items of about
+                        min_parallel_chunk floats.  Small segments are packed together so
+                        that a work item, rather than a segment, is what gets sent to a
+                        thread.
+                !*/
+            public:
+
+                void add (
+                    size_t segment,
+                    size_t begin,
+                    size_t end
+                )
+                {
+                    while (begin < end)
+                    {
+                        if (starts.empty() || size_of_last >= min_parallel_chunk)
+                        {
+                            starts.push_back(pieces.size());
+                            size_of_last = 0;
+                        }
+                        const size_t n = std::min(end-begin, min_parallel_chunk-size_of_last);
+                        pieces.push_back({segment, begin, begin+n});
+                        size_of_last += n;
+                        begin += n;
+                    }
+                }
+
+                size_t size() const { return pieces.size(); }
+                const solver_update_piece& operator[] (size_t i) const { return pieces[i]; }
+
+                template <typename funct_type>
+                void for_each_piece (
+                    funct_type&& funct
+                ) const
+                /*!
+                    ensures
+                        - calls funct(i, (*this)[i]) for all i < size(), possibly in parallel.
+                !*/
+                {
+                    auto do_work = [&](size_t k)
+                    {
+                        const size_t end = k+1 < starts.size() ? starts[k+1] : pieces.size();
+                        for (size_t i = starts[k]; i < end; ++i)
+                            funct(i, pieces[i]);
+                    };
+
+                    if (starts.size() <= 1 || default_thread_pool().num_threads_in_pool() <= 1)
+                    {
+                        for (size_t k = 0; k < starts.size(); ++k)
+                            do_work(k);
+                        return;
+                    }
+
+                    parallel_for_blocked(0, starts.size(), [&](long begin, long end)
+                    {
+                        for (long k = begin; k < end; ++k)
+                            do_work(k);
+                    }, 4);
+                }
+
+            private:
+
+                std::vector<solver_update_piece> pieces;
+                std::vector<size_t> starts;
+                size_t size_of_last = 0;
+            };
+        }
+
+        void apply_solver_updates (
+            const std::vector<tt::solver_update_segment>& segments
+        )
+        {
+            // Grab the host pointers of all the segments and split them up into work
+            // items.
+            std::vector<prepared_solver_segment> prepared(segments.size());
+            solver_work_list work, norm_work;
+            for (size_t j = 0; j < segments.size(); ++j)
+            {
+                const auto& seg = segments[j];
+                DLIB_CASSERT(seg.params && seg.params_grad && seg.state1 && seg.step);
+                DLIB_CASSERT(seg.params->size() == seg.params_grad->size() &&
+                             seg.params->size() == seg.state1->size() &&
+                             seg.params->size() == seg.step->size());
+                DLIB_CASSERT(seg.begin <= seg.end && seg.end <= seg.params->size());
+                DLIB_CASSERT(seg.t > 0);
+                const bool uses_state2 = seg.rule == tt::solver_update_rule::adam ||
+                                         seg.rule == tt::solver_update_rule::adamw ||
+                                         seg.rule == tt::solver_update_rule::lamb;
+                DLIB_CASSERT(!uses_state2 || (seg.state2 && seg.state2->size() == seg.params->size()));
+
+                auto& ps = prepared[j];
+                ps.in_place = static_cast<const tensor*>(seg.step) == seg.params;
+                ps.out = seg.step->host();
+                ps.p = ps.in_place ? ps.out : seg.params->host();
+                ps.g = seg.params_grad->host();
+                ps.s1 = seg.state1->host();
+                ps.s2 = uses_state2 ? seg.state2->host() : nullptr;
+                if (seg.rule == tt::solver_update_rule::adam || seg.rule == tt::solver_update_rule::adamw)
+                {
+                    ps.c1 = seg.learning_rate*std::sqrt(1-std::pow(seg.momentum2,seg.t))/(1-std::pow(seg.momentum1, seg.t));
+                }
+                else if (seg.rule == tt::solver_update_rule::lamb)
+                {
+                    ps.c1 = 1/(1-std::pow(seg.momentum1, seg.t));
+                    ps.c2 = 1/(1-std::pow(seg.momentum2, seg.t));
+                }
+
+                work.add(j, seg.begin, seg.end);
+                // The trust ratio needs the norms over the whole segment, so these are
+                // computed in a separate pass before the update.
+                if (solver_rule_needs_norms(seg.rule))
+                    norm_work.add(j, seg.begin, seg.end);
+            }
+
+            if (norm_work.size() != 0)
+            {
+                std::vector<double> psqr(norm_work.size()), rsqr(norm_work.size());
+                norm_work.for_each_piece([&](size_t i, const solver_update_piece& c) {
+                    compute_solver_norms(segments[c.segment], prepared[c.segment], c.begin, c.end, psqr[i], rsqr[i]);
+                });
+
+                // Add up the pieces of each segment in order so the result doesn't depend on
+                // how the work was scheduled.
+                std::vector<double> seg_psqr(segments.size(), 0), seg_rsqr(segments.size(), 0);
+                for (size_t i = 0; i < norm_work.size(); ++i)
+                {
+                    seg_psqr[norm_work[i].segment] += psqr[i];
+                    seg_rsqr[norm_work[i].segment] += rsqr[i];
+                }
+                for (size_t j = 0; j < segments.size(); ++j)
+                {
+                    const auto& seg = segments[j];
+                    if (!solver_rule_needs_norms(seg.rule))
+                        continue;
+                    const double pnorm = std::sqrt(seg_psqr[j]);
+                    const double rnorm = std::sqrt(seg_rsqr[j]);
+                    if (pnorm == 0 || rnorm == 0)
+                        prepared[j].ratio = 1;
+                    else if (seg.rule == tt::solver_update_rule::lamb)
+                        prepared[j].ratio = pnorm/rnorm;
+                    else
+                        prepared[j].ratio = seg.trust_coefficient*pnorm/(rnorm + seg.weight_decay*pnorm);
+                }
             }
+
+            work.for_each_piece([&](size_t, const solver_update_piece& c) {
+                compute_solver_update(segments[c.segment], prepared[c.segment], c.begin, c.end);
+            });
         }
 
     // -----------------------------------------------------------------------------------
@@ -763,16 +1528,22 @@ namespace dlib
             auto m = running_means.host();
             auto v = running_variances.host();
 
+            // Fold everything into one multiply and add per element.
             const long num = src.k()*src.nr()*src.nc();
-            for (long n = 0; n < src.num_samples(); ++n)
+            std::vector<float> scale(num), shift(num);
+            for (long k = 0; k < num; ++k)
             {
-                for (long k = 0; k < num; ++k)
+                scale[k] = g[k]/std::sqrt(v[k]+eps);
+                shift[k] = b[k] - m[k]*scale[k];
+            }
+
+            parallel_in_chunks(src.num_samples(), num, [&](size_t begin, size_t end) {
+                for (size_t n = begin; n < end; ++n)
                 {
-                    *d = g[k]*(*s - m[k])/std::sqrt(v[k]+eps) + b[k];
-                    ++d;
-                    ++s;
+                    apply(num, d+n*num, s+n*num, scale.data(), shift.data(),
+                        [](simd8f x, simd8f a, simd8f b) { return a*x + b; });
                 }
-            }
+            });
         }
 
         void batch_normalize (
@@ -1024,19 +1795,21 @@ namespace dlib
             auto v = running_variances.host();
 
             const long num = src.nr()*src.nc();
-            for (long n = 0; n < src.num_samples(); ++n)
+            const long ks = src.k();
+            std::vector<float> scale(ks), shift(ks);
+            for (long k = 0; k < ks; ++k)
             {
-                for (long k = 0; k < src.k(); ++k)
+                scale[k] = g[k]/std::sqrt(v[k] + eps);
+                shift[k] = b[k] - m[k]*scale[k];
+            }
+
+            parallel_in_chunks(src.num_samples()*ks, num, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i)
                 {
-                    const float invstd = 1.0f/std::sqrt(v[k] + eps);
-                    for (long j = 0; j < num; ++j)
-                    {
-                        *d = g[k]*(*s - m[k])*invstd + b[k];
-                        ++d;
-                        ++s;
-                    }
+                    const simd8f vscale(scale[i%ks]), vshift(shift[i%ks]);
+                    apply(num, d+i*num, s+i*num, [vscale,vshift](simd8f x) { return vscale*x + vshift; });
                 }
-            }
+            });
         }
 
         void batch_normalize_conv (
@@ -1292,55 +2065,35 @@ namespace dlib
             means.set_size(src.num_samples());
             invstds.set_size(src.num_samples());
 
-            // first compute means and invstds
-            means = 0;
-            invstds = 0;
             const float* p_src = src.host();
             float* p_invstds = invstds.host();
             float* p_means = means.host();
-            const long num = src.nr() * src.nc();
-            // compute means, and sum of squares
-            for (long n = 0; n < src.num_samples(); ++n)
-            {
-                for (long k = 0; k < src.k(); ++k)
-                {
-                    for (long i = 0; i < num; ++i)
-                    {
-                        p_means[n] += *p_src;
-                        p_invstds[n] += (*p_src) * (*p_src);
-                        ++p_src;
-                    }
-                }
-            }
-            means /= src.k() * num;
-            invstds /= src.k () * num;
-            // copy data back to host
-            invstds.host();
-            means.host();
-
-            // compute variances
-            for (long n = 0; n < src.num_samples(); ++n)
-            {
-                p_invstds[n] = 1.0f / std::sqrt(p_invstds[n] - p_means[n] * p_means[n] + eps);
-            }
-
-            p_src = src.host();
             float* p_dest = dest.host();
             const float* p_gamma = gamma.host();
             const float* p_beta = beta.host();
-            for (long n = 0; n < src.num_samples(); ++n)
-            {
-                for (long k = 0; k < src.k(); ++k)
+            const long num = src.nr() * src.nc();
+            const long sample_size = src.k() * num;
+
+            // Each sample is normalized on its own so they can be done in parallel.
+            parallel_in_chunks(src.num_samples(), sample_size, [&](size_t begin, size_t end) {
+                for (size_t n = begin; n < end; ++n)
                 {
-                    for (long i = 0; i < num; ++i)
+                    const float* s = p_src + n*sample_size;
+                    float* d = p_dest + n*sample_size;
+
+                    float sum, sum_sqr;
+                    sum_and_sum_of_squares(sample_size, s, sum, sum_sqr);
+                    p_means[n] = sum/sample_size;
+                    p_invstds[n] = 1.0f / std::sqrt(sum_sqr/sample_size - p_means[n] * p_means[n] + eps);
+
+                    for (long k = 0; k < src.k(); ++k)
                     {
-                        *p_dest = (*p_src - p_means[n]) * p_invstds[n];
-                        *p_dest = (*p_dest) * p_gamma[k] + p_beta[k];
-                        ++p_src;
-                        ++p_dest;
+                        const simd8f scale(p_invstds[n]*p_gamma[k]);
+                        const simd8f shift(p_beta[k] - p_means[n]*p_invstds[n]*p_gamma[k]);
+                        apply(num, d + k*num, s + k*num, [scale,shift](simd8f x) { return scale*x + shift; });
                     }
                 }
-            }
+            });
         }
 
         void layer_normalize_gradient (
@@ -1478,40 +2231,31 @@ namespace dlib
             dest.copy_size(src);
             scale.set_size(ns);
 
-            // Compute RMS values
-            scale = 0;
             const float* p_src = src.host();
             float* p_scale = scale.host();
-            for (long n = 0; n < ns; ++n)
-            {
-                for (long k = 0; k < ks; ++k)
-                {
-                    for (long i = 0; i < num; ++i)
-                    {
-                        p_scale[n] += (*p_src) * (*p_src);
-                        ++p_src;
-                    }
-                }
-                p_scale[n] = 1.0f / std::sqrt(p_scale[n] / (ks * num) + static_cast<float>(eps));
-            }
-            scale.host();
-
-            // Apply RMS normalization
-            p_src = src.host();
             float* p_dest = dest.host();
             const float* p_gamma = gamma.host();
-            for (long n = 0; n < ns; ++n)
-            {
-                for (long k = 0; k < ks; ++k)
+            const long sample_size = ks * num;
+
+            parallel_in_chunks(ns, sample_size, [&](size_t begin, size_t end) {
+                for (size_t n = begin; n < end; ++n)
                 {
-                    for (long i = 0; i < num; ++i)
+                    const float* s = p_src + n*sample_size;
+                    float* d = p_dest + n*sample_size;
+
+                    // Compute the RMS value
+                    float sum, sum_sqr;
+                    sum_and_sum_of_squares(sample_size, s, sum, sum_sqr);
+                    p_scale[n] = 1.0f / std::sqrt(sum_sqr / sample_size + static_cast<float>(eps));
+
+                    // Apply RMS normalization
+                    for (long k = 0; k < ks; ++k)
                     {
-                        *p_dest = (*p_src) * p_scale[n] * p_gamma[k];
-                        ++p_src;
-                        ++p_dest;
+                        const simd8f a(p_scale[n] * p_gamma[k]);
+                        apply(num, d + k*num, s + k*num, [a](simd8f x) { return x*a; });
                     }
                 }
-            }
+            });
         }
 
         void rms_normalize_gradient(
@@ -1622,6 +2366,58 @@ namespace dlib
 
         namespace ttimpl
         {
+            void softmax_contiguous (
+                const long num,
+                float* d,
+                const float* s,
+                const bool zero_if_all_neg_inf
+            )
+            {
+                const float neg_inf = -std::numeric_limits<float>::infinity();
+                long i = 0;
+                simd8f x, vmax(neg_inf);
+                for (; i + 8 <= num; i += 8)
+                {
+                    x.load(s+i);
+                    vmax = max(vmax, x);
+                }
+                float temp[8];
+                vmax.store(temp);
+                float max_val = *std::max_element(temp, temp+8);
+                for (; i < num; ++i)
+                    max_val = std::max(max_val, s[i]);
+
+                if (zero_if_all_neg_inf && max_val == neg_inf)
+                {
+                    std::fill(d, d+num, 0.0f);
+                    return;
+                }
+
+                // Pad the leftovers with -inf so they don't add anything to the sum.
+                const simd8f m(max_val);
+                simd8f vsum(0);
+                for (i = 0; i + 8 <= num; i += 8)
+                {
+                    x.load(s+i);
+                    x = fast_exp(x - m);
+                    x.store(d+i);
+                    vsum += x;
+                }
+                if (i != num)
+                {
+                    std::fill(temp, temp+8, neg_inf);
+                    std::copy(s+i, s+num, temp);
+                    x.load(temp);
+                    x = fast_exp(x - m);
+                    x.store(temp);
+                    std::copy(temp, temp+(num-i), d+i);
+                    vsum += x;
+                }
+
+                const simd8f scale(1.0f/sum(vsum));
+                apply(num, d, d, [scale](simd8f v) { return v*scale; });
+            }
+
             void softmax(
                 const long num_locations,
                 const long num_channels,
@@ -1635,63 +2431,74 @@ namespace dlib
                 const auto d = dest.host();
                 const auto s = src.host();
 
-                for (long n = 0; n < src.num_samples(); ++n)
+                if (mode == operation_mode::CHANNEL_WISE)
                 {
-                    auto ss = s + num_locations * num_channels * n;
-                    auto dd = d + num_locations * num_channels * n;
-
-                    if (mode == operation_mode::CHANNEL_WISE)
-                    {
-                        for (long i = 0; i < num_locations; ++i)
+                    const long sample_size = num_locations * num_channels;
+                    parallel_in_chunks(src.num_samples(), sample_size, [&](size_t begin, size_t end) {
+                        for (size_t n = begin; n < end; ++n)
                         {
-                            float max_val = -std::numeric_limits<float>::infinity();
-                            for (long k = 0; k < num_channels; ++k)
-                                max_val = std::max(max_val, ss[k * num_locations]);
+                            auto ss = s + sample_size * n;
+                            auto dd = d + sample_size * n;
 
-                            float sum = 0.0f;
-                            for (long k = 0; k < num_channels; ++k)
+                            if (num_locations == 1)
                             {
-                                dd[k * num_locations] = std::exp(ss[k * num_locations] - max_val);
-                                sum += dd[k * num_locations];
+                                softmax_contiguous(num_channels, dd, ss, false);
+                                continue;
                             }
-                            for (long k = 0; k < num_channels; ++k)
-                                dd[k * num_locations] /= sum;
 
-                            ++ss;
-                            ++dd;
-                        }
-                    }
-                    else if (mode == operation_mode::PLANE_WISE)
-                    {
-                        for (long k = 0; k < num_channels; ++k)
-                        {
-                            auto s_channel = ss + k * num_locations;
-                            auto d_channel = dd + k * num_locations;
-                            for (long r = 0; r < src.nr(); ++r)
+                            // The channels of a location are num_locations apart, so do 8
+                            // neighboring locations at a time.
+                            long i = 0;
+                            for (; i + 8 <= num_locations; i += 8)
                             {
-                                float max_val = -std::numeric_limits<float>::infinity();
-                                for (long c = 0, idx = r * src.nc(); c < src.nc(); ++c, ++idx)
-                                    max_val = std::max(max_val, s_channel[idx]);
-
-                                if (max_val == -std::numeric_limits<float>::infinity())
+                                simd8f x, vmax(-std::numeric_limits<float>::infinity());
+                                for (long k = 0; k < num_channels; ++k)
                                 {
-                                    for (long c = 0, idx = r * src.nc(); c < src.nc(); ++c, ++idx)
-                                        d_channel[idx] = 0.0f;
+                                    x.load(ss + k*num_locations + i);
+                                    vmax = max(vmax, x);
                                 }
-                                else
+                                simd8f vsum(0);
+                                for (long k = 0; k < num_channels; ++k)
                                 {
-                                    float sum = 0.0f;
-                                    for (long c = 0, idx = r * src.nc(); c < src.nc(); ++c, ++idx)
-                                    {
-                                        d_channel[idx] = std::exp(s_channel[idx] - max_val);
-                                        sum += d_channel[idx];
-                                    }
-                                    for (long c = 0, idx = r * src.nc(); c < src.nc(); ++c, ++idx)
-                                        d_channel[idx] /= sum;
+                                    x.load(ss + k*num_locations + i);
+                                    x = fast_exp(x - vmax);
+                                    x.store(dd + k*num_locations + i);
+                                    vsum += x;
+                                }
+                                const simd8f scale = simd8f(1)/vsum;
+                                for (long k = 0; k < num_channels; ++k)
+                                {
+                                    x.load(dd + k*num_locations + i);
+                                    (x*scale).store(dd + k*num_locations + i);
                                 }
                             }
+
+                            for (; i < num_locations; ++i)
+                            {
+                                float max_val = -std::numeric_limits<float>::infinity();
+                                for (long k = 0; k < num_channels; ++k)
+                                    max_val = std::max(max_val, ss[k * num_locations + i]);
+
+                                float sum = 0.0f;
+                                for (long k = 0; k < num_channels; ++k)
+                                {
+                                    dd[k * num_locations + i] = std::exp(ss[k * num_locations + i] - max_val);
+                                    sum += dd[k * num_locations + i];
+                                }
+                                for (long k = 0; k < num_channels; ++k)
+                                    dd[k * num_locations + i] /= sum;
+                            }
                         }
-                    }
+                    });
+                }
+                else if (mode == operation_mode::PLANE_WISE)
+                {
+                    // Each row of each channel is normalized separately.
+                    const long nc = src.nc();
+                    parallel_in_chunks(src.num_samples()*num_channels*src.nr(), nc, [&](size_t begin, size_t end) {
+                        for (size_t row = begin; row < end; ++row)
+                            softmax_contiguous(nc, d + row*nc, s + row*nc, true);
+                    });
                 }
             }
 
@@ -1824,8 +2631,7 @@ namespace dlib
         {
             const auto d = dest.host();
             const auto s = src.host();
-            for (size_t i = 0; i < src.size(); ++i)
-                d[i] = 1/(1+std::exp(-s[i]));
+            parallel_apply(src.size(), d, s, [](simd8f x) { return fast_sigmoid(x); });
         }
 
         void sigmoid_gradient (
@@ -1834,19 +2640,7 @@ namespace dlib
             const tensor& gradient_input
         )
         {
-            const auto g = grad.host();
-            const auto d = dest.host();
-            const auto in = gradient_input.host();
-            if (is_same_object(gradient_input, grad))
-            {
-                for (size_t i = 0; i < dest.size(); ++i)
-                    g[i] = in[i]*d[i]*(1-d[i]);
-            }
-            else
-            {
-                for (size_t i = 0; i < dest.size(); ++i)
-                    g[i] += in[i]*d[i]*(1-d[i]);
-            }
+            apply_gradient(grad, gradient_input, dest, [](simd8f d) { return d*(simd8f(1)-d); });
         }
 
     // ------------------------------------------------------------------------------------
@@ -1858,12 +2652,13 @@ namespace dlib
         {
             const auto d = dest.host_write_only();
             const auto s = src.host();
-            for (size_t i = 0; i < src.size(); ++i)
+            parallel_apply(src.size(), d, s, [](simd8f x)
             {
-                const auto e = std::exp(s[i]);
-                const auto delta = 2*e + e*e + 2;
-                d[i] = s[i] - 2*s[i]/delta;
-            }
+                const simd8f two(2);
+                const simd8f e = fast_exp(x);
+                const simd8f delta = two*e + e*e + two;
+                return x - two*x/delta;
+            });
         }
 
         void mish_gradient(
@@ -1872,33 +2667,14 @@ namespace dlib
             const tensor& gradient_input
         )
         {
-            const auto g = grad.host();
-            const auto s = src.host();
-            const auto in = gradient_input.host();
-
-            const auto calculate_gradient = [](float x)
+            apply_gradient(grad, gradient_input, src, [](simd8f x)
             {
-                if (x >= 8)
-                    return 1.f;
-                if (x <= -8)
-                    return 0.f;
-
-                const auto e = std::exp(x);
-                const auto delta = 2*e + e*e + 2;
-                const auto omega = 4*(x + 1) + 4*e*e + e*e*e + e*(4*x + 6);
-                return e*omega/(delta*delta);
-            };
-
-            if (is_same_object(gradient_input, grad))
-            {
-                for (size_t i = 0; i < src.size(); ++i)
-                    g[i] = in[i]*calculate_gradient(s[i]);
-            }
-            else
-            {
-                for (size_t i = 0; i < src.size(); ++i)
-                    g[i] += in[i]*calculate_gradient(s[i]);
-            }
+                const simd8f e = fast_exp(x);
+                const simd8f delta = simd8f(2)*e + e*e + simd8f(2);
+                const simd8f omega = simd8f(4)*(x + simd8f(1)) + simd8f(4)*e*e + e*e*e + e*(simd8f(4)*x + simd8f(6));
+                const simd8f dy = e*omega/(delta*delta);
+                return select(x >= simd8f(8), simd8f(1), select(x <= simd8f(-8), simd8f(0), dy));
+            });
         }
 
     // ------------------------------------------------------------------------------------
@@ -2049,8 +2825,7 @@ namespace dlib
         {
             const auto d = dest.host();
             const auto s = src.host();
-            for (size_t i = 0; i < src.size(); ++i)
-                d[i] = std::tanh(s[i]);
+            parallel_apply(src.size(), d, s, [](simd8f x) { return fast_tanh(x); });
         }
 
         void tanh_gradient (
@@ -2059,19 +2834,7 @@ namespace dlib
             const tensor& gradient_input
         )
         {
-            const auto g = grad.host();
-            const auto d = dest.host();
-            const auto in = gradient_input.host();
-            if (is_same_object(grad, gradient_input))
-            {
-                for (size_t i = 0; i < dest.size(); ++i)
-                    g[i] = in[i]*(1-d[i]*d[i]);
-            }
-            else
-            {
-                for (size_t i = 0; i < dest.size(); ++i)
-                    g[i] += in[i]*(1-d[i]*d[i]);
-            }
+            apply_gradient(grad, gradient_input, dest, [](simd8f d) { return simd8f(1)-d*d; });
         }
 
     // ----------------------------------------------------------------------------------------
@@ -2125,13 +2888,11 @@ namespace dlib
         {
             const auto d = dest.host();
             const auto s = src.host();
-            for (size_t i = 0; i < src.size(); ++i)
+            const simd8f a(alpha);
+            parallel_apply(src.size(), d, s, [a](simd8f x)
             {
-                if (s[i] > 0)
-                    d[i] = s[i];
-                else
-                    d[i] = alpha * (std::exp(s[i]) - 1.0f);
-            }
+                return select(x > simd8f(0), x, a*(fast_exp(x) - simd8f(1)));
+            });
         }
 
         void elu_gradient (
@@ -2175,8 +2936,10 @@ namespace dlib
         {
             const auto d = dest.host();
             const auto s = src.host();
-            for (size_t i = 0; i < src.size(); ++i)
-                d[i] = 0.5f*s[i]*(1.0f + std::erf(s[i]/sqrt_2));
+            parallel_apply(src.size(), d, s, [](simd8f x)
+            {
+                return simd8f(0.5f)*x*(simd8f(1) + fast_erf(x*simd8f(1/sqrt_2)));
+            });
         }
 
         void gelu_gradient (
@@ -2185,26 +2948,13 @@ namespace dlib
             const tensor& gradient_input
         )
         {
-            const float beta = 1.0f / std::sqrt(2.0f * pi);
-            const auto compute_gradient = [beta](float x)
-            {
-                const float cdf = 0.5f*(1.0f + std::erf(x/sqrt_2));
-                const float pdf = beta*std::exp(-0.5f*x*x);
-                return cdf + x * pdf;
-            };
-            const auto g = grad.host();
-            const auto s = src.host();
-            const auto in = gradient_input.host();
-            if (is_same_object(grad, gradient_input))
-            {
-                for (size_t i = 0; i < src.size(); ++i)
-                    g[i] = in[i]*compute_gradient(s[i]);
-            }
-            else
+            const simd8f beta(1.0f / std::sqrt(2.0f * pi));
+            apply_gradient(grad, gradient_input, src, [beta](simd8f x)
             {
-                for (size_t i = 0; i < src.size(); ++i)
-                    g[i] += in[i]*compute_gradient(s[i]);
-            }
+                const simd8f cdf = simd8f(0.5f)*(simd8f(1) + fast_erf(x*simd8f(1/sqrt_2)));
+                const simd8f pdf = beta*fast_exp(simd8f(-0.5f)*x*x);
+                return cdf + x*pdf;
+            });
         }
 
     // ----------------------------------------------------------------------------------------
@@ -2273,8 +3023,7 @@ namespace dlib
         {
             const auto d = dest.host();
             const auto s = src.host();
-            for (size_t i = 0; i < src.size(); ++i)
-                d[i] = s[i] * impl::sigmoid(s[i]);
+            parallel_apply(src.size(), d, s, [](simd8f x) { return x*fast_sigmoid(x); });
         }
 
         void silu_gradient (
@@ -2283,25 +3032,11 @@ namespace dlib
             const tensor& gradient_input
         )
         {
-            const auto g = grad.host();
-            const auto s = src.host();
-            const auto in = gradient_input.host();
-            if (is_same_object(grad, gradient_input))
-            {
-                for (size_t i = 0; i < src.size(); ++i)
-                {
-                    const auto sig_s = impl::sigmoid(s[i]);
-                    g[i] = in[i] * (sig_s * (1.0f + s[i] * (1.0f - sig_s)));
-                }
-            }
-            else
+            apply_gradient(grad, gradient_input, src, [](simd8f x)
             {
-                for (size_t i = 0; i < src.size(); ++i)
-                {
-                    const auto sig_s = impl::sigmoid(s[i]);
-                    g[i] += in[i] * (sig_s * (1.0f + s[i] * (1.0f - sig_s)));
-                }
-            }
+                const simd8f sig_s = fast_sigmoid(x);
+                return sig_s*(simd8f(1) + x*(simd8f(1) - sig_s));
+            });
         }
 
     // ----------------------------------------------------------------------------------------
@@ -2477,6 +3212,52 @@ namespace dlib
 
     // ------------------------------------------------------------------------------------
 
+        namespace ttimpl
+        {
+            struct token_positions
+            {
+                // (token, position) pairs sorted by token.  A position p is the row
+                // p*nc of a tensor with nc columns.
+                std::vector<std::pair<unsigned long,size_t>> positions;
+                // The pairs for the i-th distinct token are in [starts[i], starts[i+1]).
+                std::vector<size_t> starts;
+
+                size_t num_tokens() const { return starts.size()-1; }
+                unsigned long token(size_t i) const { return positions[starts[i]].first; }
+            };
+
+            token_positions group_positions_by_token (
+                const tensor& prev,
+                const unsigned long num_embeddings
+            )
+            /*!
+                ensures
+                    - returns the positions in prev that hold each of the valid tokens,
+                      i.e. the ones < num_embeddings.  This takes time proportional to
+                      the size of prev rather than to num_embeddings.
+            !*/
+            {
+                token_positions rows;
+                const size_t num_positions = prev.num_samples()*prev.k()*prev.nr();
+                const float* prev_data = prev.host();
+                rows.positions.reserve(num_positions);
+                for (size_t p = 0; p < num_positions; ++p)
+                {
+                    const unsigned long token_idx = static_cast<unsigned long>(prev_data[p*prev.nc()]);
+                    if (token_idx < num_embeddings)
+                        rows.positions.emplace_back(token_idx, p);
+                }
+                std::sort(rows.positions.begin(), rows.positions.end());
+                for (size_t i = 0; i < rows.positions.size(); ++i)
+                {
+                    if (i == 0 || rows.positions[i].first != rows.positions[i-1].first)
+                        rows.starts.push_back(i);
+                }
+                rows.starts.push_back(rows.positions.size());
+                return rows;
+            }
+        }
+
         void embeddings(
             resizable_tensor& dest,
             const tensor& src,
@@ -2558,34 +3339,91 @@ namespace dlib
                 "\ngrads.nc(): " << grads.nc()
             );
 
-            const float* prev_data = prev.host();
             const float* gradient_input_data = gradient_input.host();
             const float* freqs_data = freqs.host();
             float* grads_data = grads.host();
-            long ns = gradient_input.num_samples(), nk = gradient_input.k();
-            long nr = gradient_input.nr(), nc = gradient_input.nc();
+            const long nc = gradient_input.nc();
 
-            std::vector<dlib::mutex> embedding_mutexes(grads.num_samples());
-            parallel_for(0, ns * nk, [&](long i)
+            // Each row of grads is updated by a single thread, so no locking is needed
+            // and rows of tokens that aren't in the batch are never touched.
+            const auto rows = ttimpl::group_positions_by_token(prev, grads.num_samples());
+            parallel_in_chunks(rows.num_tokens(), nc*rows.positions.size()/std::max<size_t>(1,rows.num_tokens()),
+                [&](size_t begin, size_t end)
                 {
-                    long s = i / nk;
-                    long k = i % nk;
-
-                    for (long r = 0; r < nr; ++r)
+                    for (size_t i = begin; i < end; ++i)
                     {
-                        const unsigned long token_idx = static_cast<unsigned long>(prev_data[tensor_index(prev, s, k, r, 0)]);
-                        if (token_idx < grads.num_samples())
+                        const unsigned long token_idx = rows.token(i);
+                        const float freg_token = freqs_data[token_idx];
+                        float freq_scale = 1.0f;
+
+                        if (scale && freg_token != 0.0f) freq_scale = std::min(0.15f, std::max(1.0f / freg_token, 1.0f));
+                        const float alpha = learning_rate * freq_scale;
+                        float* g = grads_data + token_idx*nc;
+                        for (size_t j = rows.starts[i]; j < rows.starts[i+1]; ++j)
                         {
-                            const float freg_token = freqs_data[token_idx];
-                            float freq_scale = 1.0f;
+                            const float* gi = gradient_input_data + rows.positions[j].second*nc;
+                            for (long c = 0; c < nc; ++c)
+                                g[c] -= gi[c] * alpha;
+                        }
+                    }
+                });
+        }
 
-                            if (scale && freg_token != 0.0f) freq_scale = std::min(0.15f, std::max(1.0f / freg_token, 1.0f));
-                            auto_mutex locker(embedding_mutexes[token_idx]);
+        void embeddings_adam_update(
+            const tensor& prev,
+            const tensor& gradient_input,
+            tensor& embs,
+            tensor& m,
+            tensor& v,
+            const float t,
+            const float learning_rate,
+            const float momentum1,
+            const float momentum2,
+            const float eps
+        )
+        {
+            DLIB_CASSERT(
+                prev.nr() > 0 &&
+                gradient_input.num_samples() == prev.num_samples() &&
+                gradient_input.k() == prev.k() &&
+                gradient_input.nr() == prev.nr() &&
+                gradient_input.nc() == embs.k() &&
+                embs.num_samples() > 0 &&
+                embs.nr() == 1 &&
+                embs.nc() == 1 &&
+                have_same_dimensions(m, embs) &&
+                have_same_dimensions(v, embs) &&
+                t > 0 &&
+                eps > 0);
+
+            const float* gradient_input_data = gradient_input.host();
+            float* e = embs.host();
+            float* pm = m.host();
+            float* pv = v.host();
+            const long nc = gradient_input.nc();
+            const float alpha = learning_rate*std::sqrt(1-std::pow(momentum2, t))/(1-std::pow(momentum1, t));
+
+            const auto rows = ttimpl::group_positions_by_token(prev, embs.num_samples());
+            parallel_in_chunks(rows.num_tokens(), nc*rows.positions.size()/std::max<size_t>(1,rows.num_tokens()),
+                [&](size_t begin, size_t end)
+                {
+                    std::vector<float> g(nc);
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        const size_t offset = rows.token(i)*nc;
+                        std::fill(g.begin(), g.end(), 0.0f);
+                        for (size_t j = rows.starts[i]; j < rows.starts[i+1]; ++j)
+                        {
+                            const float* gi = gradient_input_data + rows.positions[j].second*nc;
                             for (long c = 0; c < nc; ++c)
-                            {
-                                const float gradient = gradient_input_data[tensor_index(gradient_input, s, k, r, c)];
-                                grads_data[tensor_index(grads, token_idx, c, 0, 0)] -= (gradient * learning_rate * freq_scale);
-                            }
+                                g[c] += gi[c];
+                        }
+                        for (long c = 0; c < nc; ++c)
+                        {
+                            const size_t idx = offset + c;
+                            pm[idx] = momentum1*pm[idx] + (1-momentum1)*g[c];
+                            pv[idx] = momentum2*pv[idx] + (1-momentum2)*g[c]*g[c];
+                            e[idx] -= alpha*pm[idx]/(std::sqrt(pv[idx]) + eps);
                         }
                     }
                 });
@@ -12,6 +12,11 @@
 
 namespace dlib
 {
+    namespace tt
+    {
+        struct solver_update_segment;
+    }
+
     namespace cpu 
     {
 
@@ -157,6 +162,12 @@ namespace dlib
             const tensor& params_grad
         );
 
+    // -----------------------------------------------------------------------------------
+
+        void apply_solver_updates (
+            const std::vector<tt::solver_update_segment>& segments
+        );
+
     // -----------------------------------------------------------------------------------
 
         void batch_normalize_inference (
@@ -536,6 +547,19 @@ namespace dlib
             bool scale
         );
 
+        void embeddings_adam_update(
+            const tensor& prev,
+            const tensor& gradient_input,
+            tensor& embs,
+            tensor& m,
+            tensor& v,
+            const float t,
+            const float learning_rate,
+            const float momentum1,
+            const float momentum2,
+            const float eps
+        );
+
     // -----------------------------------------------------------------------------------
 
         void compute_act_halt_probabilities(
@@ -468,17 +468,27 @@ namespace dlib
         serialize(item.nc(), out);
         byte_orderer bo;
         auto sbuf = out.rdbuf();
-        for (auto d : item)
-        {
-            // Write out our data as 4byte little endian IEEE floats rather than using
-            // dlib's default float serialization.  We do this because it will result in
-            // more compact outputs.  It's slightly less portable but it seems doubtful
-            // that any CUDA enabled platform isn't going to use IEEE floats.  But if one
-            // does we can just update the serialization code here to handle it if such a
-            // platform is encountered.
-            bo.host_to_little(d);
-            static_assert(sizeof(d)==4, "This serialization code assumes we are writing 4 byte floats");
-            sbuf->sputn((char*)&d, sizeof(d));
+        // Write out our data as 4byte little endian IEEE floats rather than using dlib's
+        // default float serialization.  We do this because it will result in more
+        // compact outputs.  It's slightly less portable but it seems doubtful that any
+        // CUDA enabled platform isn't going to use IEEE floats.  But if one does we can
+        // just update the serialization code here to handle it if such a platform is
+        // encountered.
+        static_assert(sizeof(float)==4, "This serialization code assumes we are writing 4 byte floats");
+        if (bo.host_is_little_endian())
+        {
+            // Then the bytes in memory are already what we want to write, so write them
+            // all at once.  This is a lot faster than going one float at a time.
+            if (item.size() != 0)
+                sbuf->sputn((const char*)item.host(), item.size()*sizeof(float));
+        }
+        else
+        {
+            for (auto d : item)
+            {
+                bo.host_to_little(d);
+                sbuf->sputn((char*)&d, sizeof(d));
+            }
         }
     }
 
@@ -497,15 +507,27 @@ namespace dlib
         item.set_size(num_samples, k, nr, nc);
         byte_orderer bo;
         auto sbuf = in.rdbuf();
-        for (auto& d : item)
+        static_assert(sizeof(float)==4, "This serialization code assumes we are writing 4 byte floats");
+        if (bo.host_is_little_endian())
         {
-            static_assert(sizeof(d)==4, "This serialization code assumes we are writing 4 byte floats");
-            if (sbuf->sgetn((char*)&d,sizeof(d)) != sizeof(d))
+            const std::streamsize num_bytes = item.size()*sizeof(float);
+            if (num_bytes != 0 && sbuf->sgetn((char*)item.host_write_only(), num_bytes) != num_bytes)
             {
                 in.setstate(std::ios::badbit);
                 throw serialization_error("Error reading data while deserializing dlib::resizable_tensor.");
             }
-            bo.little_to_host(d);
+        }
+        else
+        {
+            for (auto& d : item)
+            {
+                if (sbuf->sgetn((char*)&d,sizeof(d)) != sizeof(d))
+                {
+                    in.setstate(std::ios::badbit);
+                    throw serialization_error("Error reading data while deserializing dlib::resizable_tensor.");
+                }
+                bo.little_to_host(d);
+            }
         }
     }
 
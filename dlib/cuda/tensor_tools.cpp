@@ -659,6 +659,17 @@ namespace dlib { namespace tt
         )
     }
 
+// ----------------------------------------------------------------------------------------
+
+    void apply_solver_updates (
+        const std::vector<solver_update_segment>& segments
+    )
+    {
+        // There is no CUDA version of this kernel.  The tensors take care of moving the
+        // data to the host.
+        cpu::apply_solver_updates(segments);
+    }
+
 // ----------------------------------------------------------------------------------------
 
     void batch_normalize_inference (
@@ -1573,6 +1584,24 @@ namespace dlib { namespace tt
         )
     }
 
+    void embeddings_adam_update(
+        const tensor& prev,
+        const tensor& gradient_input,
+        tensor& embs,
+        tensor& m,
+        tensor& v,
+        const float t,
+        const float learning_rate,
+        const float momentum1,
+        const float momentum2,
+        const float eps
+    )
+    {
+        // There is no CUDA version of this kernel.  The tensors take care of moving the
+        // data to the host.
+        cpu::embeddings_adam_update(prev, gradient_input, embs, m, v, t, learning_rate, momentum1, momentum2, eps);
+    }
+
 // ----------------------------------------------------------------------------------------
 
     void compute_act_halt_probabilities(
@@ -633,6 +633,100 @@ namespace dlib { namespace tt
               set begin to 0 and end to params.size().
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    enum class solver_update_rule
+    {
+        sgd,
+        adam,
+        adamw,
+        lamb,
+        lars
+    };
+
+    struct solver_update_segment
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object describes one solver step applied to the half open range
+                [begin,end) of a parameter tensor.  A list of these is given to
+                apply_solver_updates(), which runs the steps for all of them in one
+                parallel pass.  This way the many small tensors of a deep network (biases,
+                normalization layers, etc.) don't each pay for their own call.
+
+                In the following, p, g, s1, s2, and step refer to the elements of
+                *params, *params_grad, *state1, *state2, and *step in [begin,end).  lr
+                and wd refer to learning_rate and weight_decay.  The update U is computed
+                as follows, depending on rule:
+                    - sgd:
+                        s1 = momentum1*s1 - wd*lr*p - lr*g
+                        U  = s1
+                    - adam:  (the same as compute_adam_update())
+                        g' = wd*p + g
+                        s1 = momentum1*s1 + (1-momentum1)*g'
+                        s2 = momentum2*s2 + (1-momentum2)*g'*g'
+                        U  = -lr*sqrt(1-momentum2^t)/(1-momentum1^t) * s1/(sqrt(s2)+1e-8)
+                    - adamw:  (adam with weight decay decoupled from the gradient)
+                        s1 = momentum1*s1 + (1-momentum1)*g
+                        s2 = momentum2*s2 + (1-momentum2)*g*g
+                        U  = -lr*sqrt(1-momentum2^t)/(1-momentum1^t) * s1/(sqrt(s2)+1e-8) - lr*wd*p
+                    - lamb:
+                        s1 = momentum1*s1 + (1-momentum1)*g
+                        s2 = momentum2*s2 + (1-momentum2)*g*g
+                        R  = (s1/(1-momentum1^t)) / (sqrt(s2/(1-momentum2^t))+1e-6) + wd*p
+                        U  = -lr*(length(p)/length(R))*R
+                    - lars:
+                        s1 = momentum1*s1 + lr*trust_coefficient*length(p)/(length(g)+wd*length(p)) * (g + wd*p)
+                        U  = -s1
+                Here length() is the L2 norm over the whole segment.  When one of the
+                norms in the trust ratio of lamb or lars is 0 the whole ratio is taken to
+                be 1.
+        !*/
+
+        solver_update_rule rule = solver_update_rule::sgd;
+        const tensor* params = nullptr;
+        const tensor* params_grad = nullptr;
+        // The solver state.  state2 is only used by adam, adamw, and lamb.
+        tensor* state1 = nullptr;
+        tensor* state2 = nullptr;
+        // Where the update goes.  If step is the same tensor as params then U is added to
+        // the parameters, otherwise step is overwritten with U.
+        tensor* step = nullptr;
+        size_t begin = 0;
+        size_t end = 0;
+        float learning_rate = 0;
+        float weight_decay = 0;
+        float momentum1 = 0;
+        float momentum2 = 0;
+        float t = 1;
+        float trust_coefficient = 0.001;
+    };
+
+    void apply_solver_updates (
+        const std::vector<solver_update_segment>& segments
+    );
+    /*!
+        requires
+            - for all valid i, with s == segments[i]:
+                - s.params, s.params_grad, s.state1, and s.step are not null.
+                - s.state2 is not null if s.rule is adam, adamw, or lamb.
+                - s.params, s.params_grad, s.state1, s.state2, and s.step all have the
+                  same size.
+                - s.begin <= s.end <= s.params->size()
+                - The [begin,end) ranges of segments that write to the same tensor don't
+                  overlap.
+                - s.t > 0
+        ensures
+            - Applies each of the updates described by segments, as explained in the
+              documentation of solver_update_segment.
+            - The work is split into chunks that span the segments and these chunks are
+              processed in parallel on the default thread pool.  So calling this function
+              once with many segments is much faster than calling it once per segment
+              when the segments are small.
+            - This function always runs on the host.  In CUDA builds the tensors are
+              copied to the host as needed.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     void batch_normalize_inference (
@@ -2285,10 +2379,51 @@ namespace dlib { namespace tt
                         - The scale factor is min(0.15, max(1.0 / freqs[token_idx], 1.0))
                     - For each column c in gradient_input:
                         - Updates grads[token_idx, c] -= gradient_input[s,k,r,c] * learning_rate * freq_scale
-            - The updates to grads are performed atomically to handle concurrent updates to the same embedding.
-            - The function is thread-safe and processes samples in parallel.
+            - Only the rows of grads whose tokens appear in prev are touched, so the cost
+              doesn't depend on grads.num_samples().
     */
 
+    void embeddings_adam_update(
+        const tensor& prev,
+        const tensor& gradient_input,
+        tensor& embs,
+        tensor& m,
+        tensor& v,
+        const float t,
+        const float learning_rate,
+        const float momentum1,
+        const float momentum2,
+        const float eps
+    );
+    /*!
+        requires
+            - prev.nr() > 0
+            - gradient_input.num_samples() == prev.num_samples()
+            - gradient_input.k() == prev.k()
+            - gradient_input.nr() == prev.nr()
+            - gradient_input.nc() == embs.k()
+            - embs.num_samples() > 0
+            - embs.nr() == 1
+            - embs.nc() == 1
+            - have_same_dimensions(m, embs) == true
+            - have_same_dimensions(v, embs) == true
+            - t > 0
+            - eps > 0
+        ensures
+            - Performs a lazy ADAM step on the embedding table embs.  That is, only the
+              rows of the tokens that appear in prev are updated, along with their moment
+              estimates in m and v.  The other rows are left exactly as they are, so the
+              cost doesn't depend on embs.num_samples().
+            - For each token that appears in prev, let g be the sum of the rows of
+              gradient_input at the positions that hold that token.  Then the token's
+              rows of embs, m and v are updated as in compute_adam_update() with no
+              weight decay:
+                m = momentum1*m + (1-momentum1)*g
+                v = momentum2*v + (1-momentum2)*g*g
+                embs -= learning_rate*sqrt(1-momentum2^t)/(1-momentum1^t) * m/(sqrt(v)+eps)
+            - Token indices >= embs.num_samples() are ignored.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     class multi_device_tensor_averager
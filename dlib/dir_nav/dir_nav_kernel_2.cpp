@@ -65,8 +65,10 @@ namespace dlib
 
 
             state.last_modified = std::chrono::system_clock::from_time_t(buffer.st_mtime);
-#ifdef _BSD_SOURCE 
-            state.last_modified += std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(buffer.st_atim.tv_nsec));
+#if defined(__APPLE__)
+            state.last_modified += std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(buffer.st_mtimespec.tv_nsec));
+#elif defined(_BSD_SOURCE) || defined(_DEFAULT_SOURCE) || (defined(_POSIX_C_SOURCE) && _POSIX_C_SOURCE >= 200809L)
+            state.last_modified += std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(buffer.st_mtim.tv_nsec));
 #endif
         }
 
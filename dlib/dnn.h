@@ -33,5 +33,8 @@
 #include "dnn/validation.h"
 #include "dnn/visitors.h"
 #include "dnn/onnx.h"
+#include "dnn/onnx_import.h"
+#include "dnn/runtime_net.h"
+#include "dnn/generation.h"
 
 #endif // DLIB_DNn_
@@ -66,6 +66,27 @@ namespace dlib
 
         template<typename T>
         using has_clean = decltype(std::declval<T>().clean());
+
+        template<typename T>
+        using has_set_recomputing_forward = decltype(std::declval<T>().set_recomputing_forward(bool{}));
+
+        template <typename net_type>
+        void set_recomputing_forward (
+            net_type& net,
+            bool recomputing
+        )
+        {
+            // Tell the layers that keep state between forward() calls, like dropout_'s
+            // mask or bn_'s running statistics, that forward() is being rerun on the
+            // same input.
+            visit_computational_layers(net, [recomputing](auto& l)
+            {
+                switch_(bools(is_detected<has_set_recomputing_forward, decltype(l)>{}),
+                    [&](true_t, auto _) { _(l).set_recomputing_forward(recomputing); },
+                    [](auto...)         { /*no-op*/ }
+                );
+            });
+        }
     }
 
 // ----------------------------------------------------------------------------------------
@@ -618,6 +639,7 @@ namespace dlib
             typedef T layer_details_type;
             typedef T input_layer_type;
             const layer_details_type& layer_details() const { return l; }
+            layer_details_type& layer_details() { return l; }
             const input_layer_type& input_layer() const { return l; }
             input_layer_type& input_layer() { return l; }
             unsigned int sample_expansion_factor() const { return _sample_expansion_factor; }
@@ -646,6 +668,7 @@ namespace dlib
             tensor& get_gradient_input() { return l.private_get_gradient_input(); }
 
             const layer_details_type& layer_details() const { return l.layer_details(); }
+            layer_details_type& layer_details() { return l.layer_details(); }
 
             const subnet_wrapper<typename T::subnet_type,false>& subnet() const { return subnetwork; }
             subnet_wrapper<typename T::subnet_type,false>& subnet() { return subnetwork; }
@@ -679,6 +702,7 @@ namespace dlib
             tensor& get_gradient_input() { return l.get_gradient_input(); }
 
             const layer_details_type& layer_details() const { return l.layer_details(); }
+            layer_details_type& layer_details() { return l.layer_details(); }
 
             const subnet_wrapper<typename T::subnet_type,false>& subnet() const { return subnetwork; }
             subnet_wrapper<typename T::subnet_type,false>& subnet() { return subnetwork; }
@@ -701,6 +725,40 @@ namespace dlib
         yes = 1
     };
 
+// ----------------------------------------------------------------------------------------
+
+    class dnn_profiler;
+
+    namespace impl
+    {
+        class layer_profiler_hook
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    When one of these is installed in an add_layer, the add_layer calls
+                    begin() right before it runs its layer's forward() or backward() and
+                    end() right after.  See dnn_profiler in visitors.h.
+            !*/
+        public:
+            virtual void begin(const tensor& input) = 0;
+            virtual void end(bool is_backward, const tensor& input, const tensor& output, const tensor& params) = 0;
+        protected:
+            ~layer_profiler_hook() = default;
+        };
+
+        struct layer_profiler_slot
+        {
+            // A hook belongs to one layer object, so it isn't copied along with the
+            // layer.  Otherwise copies of a profiled network run by other threads, e.g.
+            // by a multi-device dnn_trainer, would report to the same hook.
+            layer_profiler_slot() = default;
+            layer_profiler_slot(const layer_profiler_slot&) {}
+            layer_profiler_slot& operator=(const layer_profiler_slot&) { return *this; }
+
+            layer_profiler_hook* hook = nullptr;
+        };
+    }
+
 // ----------------------------------------------------------------------------------------
 
     template <typename LAYER_DETAILS, typename SUBNET, typename enabled = void>
@@ -763,6 +821,7 @@ namespace dlib
         friend class add_skip_layer;
         template <size_t N, template<typename> class L, typename S>
         friend class repeat;
+        friend class dnn_profiler;
 
         // Allow copying networks from one to another as long as their corresponding 
         // layers can be constructed from each other.
@@ -922,10 +981,14 @@ namespace dlib
                 details.setup(wsub);
                 this_layer_setup_called = true;
             }
+            if (profiler.hook)
+                profiler.hook->begin(wsub.get_output());
             if (this_layer_operates_inplace())
                 impl::call_layer_forward(details, wsub, private_get_output());
             else
                 impl::call_layer_forward(details, wsub, cached_output);
+            if (profiler.hook)
+                profiler.hook->end(false, wsub.get_output(), private_get_output(), details.get_layer_params());
 
             gradient_input_is_stale = true;
             return private_get_output();
@@ -990,8 +1053,12 @@ namespace dlib
         {
             dimpl::subnet_wrapper<subnet_type> wsub(*subnetwork);
             params_grad.copy_size(details.get_layer_params());
+            if (profiler.hook)
+                profiler.hook->begin(gradient_input);
             impl::call_layer_backward(details, private_get_output(),
                 gradient_input, wsub, static_cast<tensor&>(params_grad));
+            if (profiler.hook)
+                profiler.hook->end(true, wsub.get_output(), private_get_output(), details.get_layer_params());
 
             subnetwork->back_propagate_error(x, zero_grads); 
 
@@ -1113,6 +1180,16 @@ namespace dlib
             return impl::backward_requires_forward_output(details, *subnetwork);
         }
 
+        void clean_activations(
+        )
+        {
+            // Like clean() but keeps params_grad since update_parameters() still needs it.
+            x_grad.clear();
+            cached_output.clear();
+            gradient_input_is_stale = true;
+            subnetwork->clean_activations();
+        }
+
         void swap(add_layer& item)
         {
             std::swap(subnetwork,item.subnetwork);
@@ -1143,6 +1220,8 @@ namespace dlib
         // It is here only to prevent it from being reallocated over and over.
         resizable_tensor temp_tensor;
 
+        impl::layer_profiler_slot profiler;
+
     };
 
     template <typename T, typename U, typename E>
@@ -1192,6 +1271,7 @@ namespace dlib
         friend class add_skip_layer;
         template <size_t N, template<typename> class L, typename S>
         friend class repeat;
+        friend class dnn_profiler;
 
         // Allow copying networks from one to another as long as their corresponding 
         // layers can be constructed from each other.
@@ -1323,7 +1403,11 @@ namespace dlib
                 details.setup(wsub);
                 this_layer_setup_called = true;
             }
+            if (profiler.hook)
+                profiler.hook->begin(x);
             impl::call_layer_forward(details, wsub, cached_output);
+            if (profiler.hook)
+                profiler.hook->end(false, x, cached_output, details.get_layer_params());
             gradient_input_is_stale = true;
             return private_get_output();
         }
@@ -1379,8 +1463,12 @@ namespace dlib
 
             subnet_wrapper wsub(x, grad_final, _sample_expansion_factor);
             params_grad.copy_size(details.get_layer_params());
+            if (profiler.hook)
+                profiler.hook->begin(gradient_input);
             impl::call_layer_backward(details, private_get_output(),
                 gradient_input, wsub, static_cast<tensor&>(params_grad));
+            if (profiler.hook)
+                profiler.hook->end(true, x, cached_output, details.get_layer_params());
 
             // zero out get_gradient_input()
             gradient_input_is_stale = zero_grads == zero_gradients::yes;
@@ -1499,6 +1587,15 @@ namespace dlib
             return impl::backward_requires_forward_output(details, wsub);
         }
 
+        void clean_activations(
+        )
+        {
+            x_grad.clear();
+            grad_final.clear();
+            cached_output.clear();
+            gradient_input_is_stale = true;
+        }
+
         class subnet_wrapper
         {
         public:
@@ -1554,6 +1651,8 @@ namespace dlib
         // member functions.
         resizable_tensor params_grad; 
         resizable_tensor temp_tensor; 
+
+        impl::layer_profiler_slot profiler;
     };
 
 // ----------------------------------------------------------------------------------------
@@ -1749,6 +1848,9 @@ namespace dlib
             DLIB_CASSERT(false,"This should never happen");
         }
 
+        void clean_activations(
+        ) { subnetwork.clean_activations(); }
+
         tensor& private_get_output() const
         { return subnetwork.private_get_output(); }
         tensor& private_get_gradient_input() 
@@ -1830,6 +1932,13 @@ namespace dlib
             return details[i]; 
         }
 
+        void set_gradient_checkpointing (
+            bool enabled
+        ) { gradient_checkpointing = enabled; }
+
+        bool get_gradient_checkpointing (
+        ) const { return gradient_checkpointing; }
+
         repeat(const repeat&) = default;
         repeat(repeat&&) = default;
         repeat& operator=(repeat&&) = default;
@@ -1839,7 +1948,8 @@ namespace dlib
         repeat(
             const repeat<num,T,U>& item
         ) : 
-            subnetwork(item.subnetwork)
+            subnetwork(item.subnetwork),
+            gradient_checkpointing(item.get_gradient_checkpointing())
         {
             for (auto&& d : item.details)
                 details.emplace_back(d);
@@ -1910,8 +2020,26 @@ namespace dlib
         {
             subnetwork.forward(x);
             details[details.size()-1].forward(subnetwork.get_output());
-            for (long i = details.size()-2; i >= 0; --i)
-                details[i].forward(details[i+1].get_output());
+            if (gradient_checkpointing)
+            {
+                // Only keep the output of each repetition and throw away everything else
+                // it computed.  back_propagate_error() will recompute it when needed.
+                // Note that we never resize group_outputs after this so the tag layers
+                // that point to its elements stay valid.
+                group_outputs.resize(details.size());
+                for (long i = details.size()-2; i >= 0; --i)
+                {
+                    group_outputs[i+1].copy_size(details[i+1].get_output());
+                    memcpy(group_outputs[i+1], details[i+1].get_output());
+                    details[i+1].clean_activations();
+                    details[i].forward(group_outputs[i+1]);
+                }
+            }
+            else
+            {
+                for (long i = details.size()-2; i >= 0; --i)
+                    details[i].forward(details[i+1].get_output());
+            }
             return private_get_output();
         }
 
@@ -1956,7 +2084,23 @@ namespace dlib
             zero_gradients zero_grads = zero_gradients::yes
         )
         {
-            if (details.size() > 1)
+            if (gradient_checkpointing && details.size() > 1)
+            {
+                details[0].back_propagate_error(group_outputs[1], gradient_input, zero_grads);
+                for (size_t i = 1; i < details.size(); ++i)
+                {
+                    const tensor& group_input = i+1 < details.size() ? group_outputs[i+1] : subnetwork.get_output();
+                    // Redo the forward pass forward() threw away, use it, and then throw
+                    // it away again once the group above no longer needs it.
+                    impl::set_recomputing_forward(details[i], true);
+                    details[i].forward(group_input);
+                    impl::set_recomputing_forward(details[i], false);
+                    details[i].back_propagate_error(group_input, details[i-1].get_final_data_gradient(), zero_grads);
+                    if (i > 1)
+                        details[i-1].clean_activations();
+                }
+            }
+            else if (details.size() > 1)
             {
                 details[0].back_propagate_error(details[1].get_output(), gradient_input, zero_grads);
                 for (size_t i = 1; i < details.size(); ++i)
@@ -1972,6 +2116,8 @@ namespace dlib
                 details[0].back_propagate_error(subnetwork.get_output(), gradient_input, zero_grads);
             }
             subnetwork.back_propagate_error(x, details.back().get_final_data_gradient(), zero_grads);
+            if (gradient_checkpointing && details.size() > 1)
+                details.back().clean_activations();
         }
 
         template <typename solver_type>
@@ -2004,6 +2150,8 @@ namespace dlib
         void clean()
         {
             temp_tensor.clear();
+            for (auto&& t : group_outputs)
+                t.clear();
             subnetwork.clean();
             for (auto&& d : details)
                 d.clean();
@@ -2069,9 +2217,23 @@ namespace dlib
             details[0].disable_output_and_gradient_getters();
         }
 
+        void clean_activations(
+        )
+        {
+            for (auto&& t : group_outputs)
+                t.clear();
+            subnetwork.clean_activations();
+            for (auto&& d : details)
+                d.clean_activations();
+        }
 
         std::vector<repeated_layer_type> details; 
         subnet_type subnetwork;
+        bool gradient_checkpointing = false;
+
+        // When gradient checkpointing is enabled, group_outputs[i] holds a copy of the
+        // output of details[i] (for i > 0) since details[i] doesn't keep it.
+        std::vector<resizable_tensor> group_outputs;
 
         // temp_tensor doesn't logically contribute to the state of this class.
         // It is here only to void needing to reallocate it over and over.
@@ -2333,6 +2495,9 @@ namespace dlib
             DLIB_CASSERT(false,"This should never happen");
         }
 
+        void clean_activations(
+        ) { clean(); }
+
         tensor& private_get_output() const
         { return const_cast<tensor&>(get_output()); }
         tensor& private_get_gradient_input() 
@@ -3174,6 +3339,9 @@ namespace dlib
         void disable_output_and_gradient_getters (
         ) { layer<TAG_TYPE>(subnetwork).disable_output_and_gradient_getters(); }
 
+        void clean_activations(
+        ) { subnetwork.clean_activations(); }
+
         tensor& private_get_output() const
         { return layer<TAG_TYPE>(subnetwork).private_get_output(); }
         tensor& private_get_gradient_input() 
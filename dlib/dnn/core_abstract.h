@@ -1522,6 +1522,46 @@ namespace dlib
                   instance of REPEATED_LAYER that is stacked immediately on top of SUBNET.
         !*/
 
+        void set_gradient_checkpointing (
+            bool enabled
+        );
+        /*!
+            ensures
+                - #get_gradient_checkpointing() == enabled
+        !*/
+
+        bool get_gradient_checkpointing (
+        ) const;
+        /*!
+            ensures
+                - returns true if this object uses gradient checkpointing (also called
+                  activation recomputation) and false otherwise.  
+                - Normally, after forward() every layer in the network holds on to its
+                  output tensor, and during back_propagate_error() to its gradient tensor
+                  as well.  So the memory needed to train a network grows with its depth.
+                  When gradient checkpointing is enabled, forward() only keeps the output
+                  of each REPEATED_LAYER instance and frees the tensors of the layers
+                  inside it.  back_propagate_error() then reruns the forward pass of each
+                  REPEATED_LAYER instance, one at a time, right before it back propagates
+                  through it.  This trades roughly one extra forward pass through the
+                  repeated layers for memory that no longer grows with num_repetitions().
+                  The outputs and gradients of the top instance, i.e.
+                  get_repeated_layer(0), are always kept.
+                - Gradient checkpointing gives the same results as normal training.  The
+                  forward pass of each REPEATED_LAYER instance is rerun with
+                  set_recomputing_forward(true) called on the layers inside it that define
+                  that method (see EXAMPLE_COMPUTATIONAL_LAYER_), so dropout_ layers reuse
+                  their masks and bn_ layers don't update their running statistics again.
+                  A custom layer whose forward() changes its own state must define
+                  set_recomputing_forward() to get the same guarantee.
+                - When gradient checkpointing is enabled, the get_output() and
+                  get_gradient_input() tensors of layers inside get_repeated_layer(i) for
+                  i > 0 are empty after forward() or back_propagate_error() returns.
+                - Don't change this setting between a call to forward() and the
+                  back_propagate_error() call that uses its results.
+                - This setting is not serialized.  The default is false.
+        !*/
+
         const subnet_type& subnet(
         ) const; 
         /*!
@@ -0,0 +1,387 @@
+// Copyright (C) 2026
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_DNn_GENERATION_H_
+#define DLIB_DNn_GENERATION_H_
+
+#include "generation_abstract.h"
+#include "../cuda/tensor.h"
+#include "../error.h"
+#include "../rand.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    struct generation_options
+    {
+        unsigned long max_new_tokens = 128;
+        float temperature = 1;
+        unsigned long top_k = 0;
+        float top_p = 1;
+        std::vector<int> stop_tokens;
+        unsigned long seed = 0;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    class token_sampler
+    {
+    public:
+
+        token_sampler(
+        ) : token_sampler(generation_options()) {}
+
+        explicit token_sampler(
+            const generation_options& options_
+        ) : options(options_), rnd(options_.seed)
+        {
+            DLIB_CASSERT(options.top_p > 0 && options.top_p <= 1, "top_p: " << options.top_p);
+        }
+
+        const generation_options& get_options(
+        ) const { return options; }
+
+        int operator() (
+            const float* logits,
+            long num_logits
+        )
+        {
+            DLIB_CASSERT(num_logits > 0);
+            if (options.temperature <= 0 || options.top_k == 1)
+                return static_cast<int>(std::max_element(logits, logits + num_logits) - logits);
+
+            candidates.resize(num_logits);
+            for (long i = 0; i < num_logits; ++i)
+                candidates[i] = std::make_pair(logits[i], static_cast<int>(i));
+
+            const auto by_logit = [](const std::pair<float,int>& a, const std::pair<float,int>& b) { return a.first > b.first; };
+            if (options.top_k != 0 && options.top_k < candidates.size())
+            {
+                std::nth_element(candidates.begin(), candidates.begin() + options.top_k, candidates.end(), by_logit);
+                candidates.resize(options.top_k);
+            }
+            if (options.top_p < 1)
+                std::sort(candidates.begin(), candidates.end(), by_logit);
+
+            // Turn the logits into unnormalized probabilities.
+            float max_logit = candidates[0].first;
+            for (const auto& c : candidates)
+                max_logit = std::max(max_logit, c.first);
+            double total = 0;
+            for (auto& c : candidates)
+            {
+                c.first = std::exp((c.first - max_logit)/options.temperature);
+                total += c.first;
+            }
+
+            if (options.top_p < 1)
+            {
+                // Keep the most likely tokens until they cover top_p of the probability.
+                double sum = 0;
+                size_t n = 0;
+                while (n < candidates.size() && sum < options.top_p*total)
+                    sum += candidates[n++].first;
+                candidates.resize(n);
+                total = sum;
+            }
+
+            double r = rnd.get_random_double()*total;
+            for (const auto& c : candidates)
+            {
+                r -= c.first;
+                if (r < 0)
+                    return c.second;
+            }
+            return candidates.back().second;
+        }
+
+    private:
+        generation_options options;
+        dlib::rand rnd;
+        std::vector<std::pair<float,int>> candidates;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename net_type>
+    class batched_generator
+    {
+    public:
+
+        typedef typename net_type::input_type input_type;
+
+        batched_generator(
+            net_type& net_,
+            long context_length_,
+            int pad_token_,
+            size_t max_batch_size_ = 64
+        ) :
+            net(net_),
+            context_length(context_length_),
+            pad_token(pad_token_),
+            max_batch_size(max_batch_size_)
+        {
+            DLIB_CASSERT(context_length > 0);
+            DLIB_CASSERT(max_batch_size > 0);
+            worker = std::thread([this]() { run(); });
+        }
+
+        batched_generator(const batched_generator&) = delete;
+        batched_generator& operator=(const batched_generator&) = delete;
+
+        ~batched_generator(
+        )
+        {
+            {
+                std::lock_guard<std::mutex> lock(m);
+                stopping = true;
+            }
+            cv.notify_all();
+            worker.join();
+        }
+
+        std::future<std::vector<int>> submit (
+            const std::vector<int>& prompt,
+            const generation_options& options = generation_options(),
+            std::function<void(int)> on_token = std::function<void(int)>()
+        )
+        {
+            std::unique_ptr<request> r(new request(prompt, options, std::move(on_token)));
+            auto result = r->result.get_future();
+            if (options.max_new_tokens == 0)
+            {
+                r->result.set_value(std::vector<int>());
+                return result;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m);
+                pending.push_back(std::move(r));
+            }
+            cv.notify_one();
+            return result;
+        }
+
+        std::vector<int> generate (
+            const std::vector<int>& prompt,
+            const generation_options& options = generation_options()
+        )
+        {
+            return submit(prompt, options).get();
+        }
+
+        long get_context_length() const { return context_length; }
+        int get_pad_token() const { return pad_token; }
+        size_t get_max_batch_size() const { return max_batch_size; }
+
+        size_t num_requests (
+        ) const
+        {
+            std::lock_guard<std::mutex> lock(m);
+            return pending.size() + num_active;
+        }
+
+        uint64_t get_num_steps (
+        ) const
+        {
+            std::lock_guard<std::mutex> lock(m);
+            return num_steps;
+        }
+
+        uint64_t get_num_generated_tokens (
+        ) const
+        {
+            std::lock_guard<std::mutex> lock(m);
+            return num_generated_tokens;
+        }
+
+        double get_busy_seconds (
+        ) const
+        {
+            std::lock_guard<std::mutex> lock(m);
+            return busy_seconds;
+        }
+
+    private:
+
+        struct request
+        {
+            request(
+                const std::vector<int>& prompt,
+                const generation_options& options,
+                std::function<void(int)>&& on_token_
+            ) : tokens(prompt), prompt_size(prompt.size()), sampler(options), on_token(std::move(on_token_)) {}
+
+            // The prompt followed by the tokens generated so far.
+            std::vector<int> tokens;
+            size_t prompt_size;
+            token_sampler sampler;
+            std::function<void(int)> on_token;
+            std::promise<std::vector<int>> result;
+            // Set if the request ended with an exception rather than its tokens.
+            std::exception_ptr error;
+
+            std::vector<int> generated() const { return std::vector<int>(tokens.begin() + prompt_size, tokens.end()); }
+        };
+
+        void load_context (
+            const request& r,
+            input_type& sample
+        ) const
+        {
+            // The last context_length tokens, left padded if there aren't that many, so
+            // the most recent token is always in the last position.
+            sample.set_size(context_length, 1);
+            const long n = std::min<long>(context_length, r.tokens.size());
+            const long pad = context_length - n;
+            for (long i = 0; i < pad; ++i)
+                sample(i) = pad_token;
+            for (long i = 0; i < n; ++i)
+                sample(pad + i) = r.tokens[r.tokens.size() - n + i];
+        }
+
+        void run (
+        )
+        {
+            // Only this thread touches active and the network.  Requests join the batch
+            // between steps and leave it as soon as they are finished.
+            std::vector<std::unique_ptr<request>> active, finished;
+            std::vector<input_type> samples;
+            resizable_tensor x;
+            while (true)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(m);
+                    cv.wait(lock, [&]() { return stopping || !pending.empty() || !active.empty(); });
+                    if (stopping)
+                        break;
+                    while (!pending.empty() && active.size() < max_batch_size)
+                    {
+                        active.push_back(std::move(pending.front()));
+                        pending.pop_front();
+                    }
+                    num_active = active.size();
+                }
+
+                const auto start = std::chrono::steady_clock::now();
+                size_t num_new_tokens = 0;
+                try
+                {
+                    samples.resize(active.size());
+                    for (size_t i = 0; i < active.size(); ++i)
+                        load_context(*active[i], samples[i]);
+                    net.to_tensor(samples.begin(), samples.end(), x);
+                    net.subnet().forward(x);
+                    const tensor& logits = net.subnet().get_output();
+                    DLIB_CASSERT(logits.num_samples() == (long long)active.size());
+                    const long num_logits = logits.size()/logits.num_samples();
+
+                    for (size_t i = 0; i < active.size(); ++i)
+                    {
+                        request& r = *active[i];
+                        const int token = r.sampler(logits.host() + i*num_logits, num_logits);
+                        const auto& options = r.sampler.get_options();
+                        bool done = std::find(options.stop_tokens.begin(), options.stop_tokens.end(), token) != options.stop_tokens.end();
+                        if (!done)
+                        {
+                            r.tokens.push_back(token);
+                            ++num_new_tokens;
+                            done = r.tokens.size() - r.prompt_size >= options.max_new_tokens;
+                            if (r.on_token)
+                            {
+                                try
+                                {
+                                    r.on_token(token);
+                                }
+                                catch (...)
+                                {
+                                    r.error = std::current_exception();
+                                    done = true;
+                                }
+                            }
+                        }
+                        if (done)
+                            finished.push_back(std::move(active[i]));
+                    }
+                }
+                catch (...)
+                {
+                    for (auto& r : active)
+                    {
+                        if (r)
+                        {
+                            r->error = std::current_exception();
+                            finished.push_back(std::move(r));
+                        }
+                    }
+                }
+                active.erase(std::remove(active.begin(), active.end(), nullptr), active.end());
+
+                const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                {
+                    // Account for the step before any caller can see its results, so that
+                    // once a future is ready the counters include its tokens.
+                    std::lock_guard<std::mutex> lock(m);
+                    ++num_steps;
+                    num_generated_tokens += num_new_tokens;
+                    busy_seconds += seconds;
+                    num_active = active.size();
+                }
+                for (auto& r : finished)
+                {
+                    if (r->error)
+                        r->result.set_exception(r->error);
+                    else
+                        r->result.set_value(r->generated());
+                }
+                finished.clear();
+            }
+
+            std::lock_guard<std::mutex> lock(m);
+            const auto err = std::make_exception_ptr(dlib::error("The batched_generator was destroyed before the request finished."));
+            for (auto& r : active)
+                r->result.set_exception(err);
+            for (auto& r : pending)
+                r->result.set_exception(err);
+            pending.clear();
+        }
+
+        net_type& net;
+        const long context_length;
+        const int pad_token;
+        const size_t max_batch_size;
+
+        mutable std::mutex m;
+        std::condition_variable cv;
+        std::deque<std::unique_ptr<request>> pending;
+        size_t num_active = 0;
+        bool stopping = false;
+        uint64_t num_steps = 0;
+        uint64_t num_generated_tokens = 0;
+        double busy_seconds = 0;
+
+        std::thread worker;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_DNn_GENERATION_H_
+
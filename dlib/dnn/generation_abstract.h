@@ -0,0 +1,252 @@
+// Copyright (C) 2026
+// License: Boost Software License   See LICENSE.txt for the full license.
+#undef DLIB_DNn_GENERATION_ABSTRACT_H_
+#ifdef DLIB_DNn_GENERATION_ABSTRACT_H_
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    struct generation_options
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object holds the settings for generating text from a language model,
+                one token at a time.  Each token is drawn from the model's output logits:
+                    - If temperature <= 0 the most likely token is always chosen.
+                    - Otherwise only the top_k most likely tokens are kept (all of them if
+                      top_k == 0), then only the smallest set of the most likely tokens
+                      whose probabilities add up to at least top_p, and a token is drawn
+                      from what remains with probabilities softmax(logits/temperature).
+                Generation stops after max_new_tokens tokens, or when one of the
+                stop_tokens is drawn.
+        !*/
+
+        unsigned long max_new_tokens = 128;
+        float temperature = 1;
+        unsigned long top_k = 0;
+        float top_p = 1;
+        std::vector<int> stop_tokens;
+        unsigned long seed = 0;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    class token_sampler
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object draws tokens from a vector of logits as described by a
+                generation_options object.  It owns a random number generator seeded with
+                options.seed, so two samplers with the same options draw the same tokens
+                from the same logits.
+        !*/
+
+    public:
+
+        token_sampler(
+        );
+        /*!
+            ensures
+                - #get_options() == generation_options()
+        !*/
+
+        explicit token_sampler(
+            const generation_options& options
+        );
+        /*!
+            requires
+                - 0 < options.top_p <= 1
+            ensures
+                - #get_options() == options
+        !*/
+
+        const generation_options& get_options(
+        ) const;
+        /*!
+            ensures
+                - returns the options this object samples with.
+        !*/
+
+        int operator() (
+            const float* logits,
+            long num_logits
+        );
+        /*!
+            requires
+                - num_logits > 0
+                - logits points to num_logits floats.
+            ensures
+                - returns the index of a token, in the range [0, num_logits), drawn from
+                  logits as described by get_options().
+                - If get_options().temperature <= 0 or get_options().top_k == 1 then the
+                  index of the largest logit is returned and no random numbers are used.
+        !*/
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename net_type>
+    class batched_generator
+    {
+        /*!
+            REQUIREMENTS ON net_type
+                - net_type is a dlib network, e.g. loss_multiclass_log<...>, whose
+                  input_type is matrix<int,0,1>, a window of token ids.
+                - For each sample, the output of net.subnet() holds the logits of the
+                  token that follows the window.
+
+            WHAT THIS OBJECT REPRESENTS
+                This object generates text from one network for many callers at the same
+                time.  A network runs much more efficiently on a batch than on a single
+                window, so rather than have each caller run the network on its own,
+                requests are submitted to this object and a single worker thread runs
+                them together:
+                    - Every step, the worker runs the network once on the windows of all
+                      the active requests, and adds one sampled token to each of them.
+                    - Requests join the batch at the start of any step, as long as fewer
+                      than get_max_batch_size() are active, and leave as soon as they are
+                      done.  So a long request never holds up short ones and new requests
+                      don't wait for the batch to drain.
+                Each request has its own generation_options, and so its own sampler.
+
+                The window of a request is the last get_context_length() tokens of its
+                prompt followed by the tokens generated so far.  When there are fewer
+                tokens than that they are placed at the end of the window and the start
+                is filled with get_pad_token().  dlib networks don't keep a cache of the
+                keys and values of earlier tokens, so each step runs the network on the
+                full windows.
+
+            THREAD SAFETY
+                submit(), generate(), and the getters may be called from any number of
+                threads at the same time.  The network is only used by the worker thread,
+                and must not be used by anything else while this object exists.
+        !*/
+
+    public:
+
+        batched_generator(
+            net_type& net,
+            long context_length,
+            int pad_token,
+            size_t max_batch_size = 64
+        );
+        /*!
+            requires
+                - context_length > 0
+                - max_batch_size > 0
+            ensures
+                - Starts the worker thread, which will generate from net.
+                - #get_context_length() == context_length
+                - #get_pad_token() == pad_token
+                - #get_max_batch_size() == max_batch_size
+                - #num_requests() == 0
+        !*/
+
+        batched_generator(const batched_generator&) = delete;
+        batched_generator& operator=(const batched_generator&) = delete;
+
+        ~batched_generator(
+        );
+        /*!
+            ensures
+                - Stops the worker thread.  Requests that haven't finished are failed with
+                  a dlib::error.
+        !*/
+
+        std::future<std::vector<int>> submit (
+            const std::vector<int>& prompt,
+            const generation_options& options = generation_options(),
+            std::function<void(int)> on_token = std::function<void(int)>()
+        );
+        /*!
+            requires
+                - 0 < options.top_p <= 1
+            ensures
+                - Queues a request to continue prompt and returns a future that will hold
+                  the generated tokens, not including the prompt or the stop token that
+                  ended generation, if any.
+                - If on_token is set it is called by the worker thread with every token as
+                  it is generated, which allows the tokens to be streamed.  If it throws,
+                  the request ends and the future holds the exception.
+                - If running the network throws, the futures of all the requests in the
+                  batch hold the exception.
+        !*/
+
+        std::vector<int> generate (
+            const std::vector<int>& prompt,
+            const generation_options& options = generation_options()
+        );
+        /*!
+            requires
+                - 0 < options.top_p <= 1
+            ensures
+                - returns submit(prompt, options).get()
+        !*/
+
+        long get_context_length(
+        ) const;
+        /*!
+            ensures
+                - returns the number of tokens in the window the network is run on.
+        !*/
+
+        int get_pad_token(
+        ) const;
+        /*!
+            ensures
+                - returns the token that fills the start of windows that are not full.
+        !*/
+
+        size_t get_max_batch_size(
+        ) const;
+        /*!
+            ensures
+                - returns the largest number of requests that are run together.
+        !*/
+
+        size_t num_requests(
+        ) const;
+        /*!
+            ensures
+                - returns the number of requests that have been submitted and haven't
+                  finished yet.
+        !*/
+
+        uint64_t get_num_steps(
+        ) const;
+        /*!
+            ensures
+                - returns the number of times the worker has run the network.
+        !*/
+
+        uint64_t get_num_generated_tokens(
+        ) const;
+        /*!
+            ensures
+                - returns the number of tokens generated for all requests so far.
+                - get_num_generated_tokens()/get_busy_seconds() is the throughput, in
+                  tokens per second, while there are requests to run.
+        !*/
+
+        double get_busy_seconds(
+        ) const;
+        /*!
+            ensures
+                - returns the number of seconds the worker has spent running steps, i.e.
+                  not counting the time it waited for requests.
+        !*/
+    };
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_DNn_GENERATION_ABSTRACT_H_
+
@@ -1861,6 +1861,8 @@ namespace dlib
         void set_bias_learning_rate_multiplier(double val) { bias_learning_rate_multiplier = val; }
         void set_bias_weight_decay_multiplier(double val)  { bias_weight_decay_multiplier  = val; }
 
+        void set_recomputing_forward(bool val) { recomputing_forward = val; }
+
         inline dpoint map_input_to_output (const dpoint& p) const { return p; }
         inline dpoint map_output_to_input (const dpoint& p) const { return p; }
 
@@ -1900,10 +1902,16 @@ namespace dlib
             auto b = beta(params,gamma.size());
             if (sub.get_output().num_samples() > 1)
             {
-                const double decay = 1.0 - num_updates/(num_updates+1.0);
-                ++num_updates;
-                if (num_updates > running_stats_window_size)
-                    num_updates = running_stats_window_size;
+                // A recomputed forward pass sees the same batch again, so it must not
+                // count towards the running statistics a second time.
+                double decay = 0;
+                if (!recomputing_forward)
+                {
+                    decay = 1.0 - num_updates/(num_updates+1.0);
+                    ++num_updates;
+                    if (num_updates > running_stats_window_size)
+                        num_updates = running_stats_window_size;
+                }
 
                 if (mode == FC_MODE)
                     tt::batch_normalize(eps, output, means, invstds, decay, running_means, running_variances, sub.get_output(), g, b);
@@ -2040,6 +2048,7 @@ namespace dlib
         double bias_learning_rate_multiplier;
         double bias_weight_decay_multiplier;
         double eps;
+        bool recomputing_forward = false;
     };
 
     template <typename SUBNET>
@@ -2584,6 +2593,10 @@ namespace dlib
         float get_drop_rate (
         ) const { return drop_rate; }
 
+        void set_recomputing_forward (
+            bool val
+        ) { recomputing_forward = val; }
+
         template <typename SUBNET>
         void setup (const SUBNET& /*sub*/)
         {
@@ -2591,10 +2604,18 @@ namespace dlib
 
         void forward_inplace(const tensor& input, tensor& output)
         {
-            // create a random mask and use it to filter the data
-            mask.copy_size(input);
-            rnd.fill_uniform(mask);
-            tt::threshold(mask, drop_rate);
+            // create a random mask and use it to filter the data, unless the forward pass
+            // is being recomputed, in which case the mask it drew is used again.
+            if (recomputing_forward)
+            {
+                DLIB_CASSERT(have_same_dimensions(mask, input));
+            }
+            else
+            {
+                mask.copy_size(input);
+                rnd.fill_uniform(mask);
+                tt::threshold(mask, drop_rate);
+            }
             tt::multiply(false, output, input, mask);
         } 
 
@@ -2657,6 +2678,7 @@ namespace dlib
     private:
         float drop_rate;
         resizable_tensor mask;
+        bool recomputing_forward = false;
 
         tt::tensor_rand rnd;
         resizable_tensor params; // unused
@@ -5441,7 +5463,13 @@ namespace dlib
         embeddings_() : num_embeddings(num_embeddings_),
             embedding_dim(embedding_dim_),
             learning_rate_multiplier(1.0f),
-            scale_by_freq(true)
+            scale_by_freq(true),
+            lazy_adam(false),
+            lazy_adam_learning_rate(0.001),
+            lazy_adam_momentum1(0.9),
+            lazy_adam_momentum2(0.999),
+            lazy_adam_eps(1e-8),
+            adam_t(0)
         {
         }
 
@@ -5451,6 +5479,46 @@ namespace dlib
         void set_scale_by_freq(bool val) { scale_by_freq = val; }
         bool get_scale_by_freq() const { return scale_by_freq; }
 
+        void set_lazy_adam(bool val)
+        {
+            if (val != lazy_adam)
+            {
+                lazy_adam = val;
+                adam_m.clear();
+                adam_v.clear();
+                adam_t = 0;
+            }
+        }
+        bool get_lazy_adam() const { return lazy_adam; }
+
+        double get_lazy_adam_learning_rate() const { return lazy_adam_learning_rate; }
+        void set_lazy_adam_learning_rate(double val)
+        {
+            DLIB_CASSERT(val >= 0);
+            lazy_adam_learning_rate = val;
+        }
+
+        double get_lazy_adam_momentum1() const { return lazy_adam_momentum1; }
+        void set_lazy_adam_momentum1(double val)
+        {
+            DLIB_CASSERT(0 <= val && val < 1);
+            lazy_adam_momentum1 = val;
+        }
+
+        double get_lazy_adam_momentum2() const { return lazy_adam_momentum2; }
+        void set_lazy_adam_momentum2(double val)
+        {
+            DLIB_CASSERT(0 <= val && val < 1);
+            lazy_adam_momentum2 = val;
+        }
+
+        double get_lazy_adam_eps() const { return lazy_adam_eps; }
+        void set_lazy_adam_eps(double val)
+        {
+            DLIB_CASSERT(val > 0);
+            lazy_adam_eps = val;
+        }
+
         unsigned long get_num_embeddings() const { return num_embeddings; }
         void set_num_embeddings(unsigned long num)
         {
@@ -5500,10 +5568,45 @@ namespace dlib
             if (learning_rate_multiplier != 0)
             {
                 auto& prev_src = sub.get_output();
-                
-                calc_token_freqs(prev_src, gradient_input);
-                tt::embeddings_gradient(prev_src, gradient_input, embs, freqs, learning_rate_multiplier, scale_by_freq);
+
+                if (tied_gradient_pending)
+                {
+                    update_tied(prev_src, gradient_input);
+                }
+                else if (lazy_adam)
+                {
+                    prepare_adam_moments();
+                    tt::embeddings_adam_update(prev_src, gradient_input, embs, adam_m, adam_v,
+                        adam_t, lazy_adam_learning_rate*learning_rate_multiplier,
+                        lazy_adam_momentum1, lazy_adam_momentum2, lazy_adam_eps);
+                }
+                else
+                {
+                    calc_token_freqs(prev_src);
+                    tt::embeddings_gradient(prev_src, gradient_input, embs, freqs, learning_rate_multiplier, scale_by_freq);
+                    clear_token_freqs(prev_src);
+                }
             }
+            tied_gradient_pending = false;
+        }
+
+        tensor& get_tied_gradient()
+        {
+            // Layers that use the table as their weights run their backward() before
+            // this layer's, so the first of them starts a fresh accumulator and the
+            // next call to backward() consumes it.
+            if (!tied_gradient_pending)
+            {
+                tied_grad.copy_size(embs);
+                tied_grad = 0;
+                tied_gradient_pending = true;
+            }
+            return tied_grad;
+        }
+
+        void clear_tied_gradient()
+        {
+            tied_gradient_pending = false;
         }
 
         const tensor& get_layer_params() const { return params; }
@@ -5514,24 +5617,63 @@ namespace dlib
 
         friend void serialize(const embeddings_& item, std::ostream& out)
         {
-            serialize("embeddings_", out);
+            serialize("embeddings_2", out);
             serialize(item.embs, out);
             serialize(item.num_embeddings, out);
             serialize(item.embedding_dim, out);
             serialize(item.learning_rate_multiplier, out);
             serialize(item.scale_by_freq, out);
+            serialize(item.lazy_adam, out);
+            serialize(item.lazy_adam_learning_rate, out);
+            serialize(item.lazy_adam_momentum1, out);
+            serialize(item.lazy_adam_momentum2, out);
+            serialize(item.lazy_adam_eps, out);
+            // The moment estimates are as big as the embeddings, so they are only
+            // written when there are some.
+            const bool has_moments = item.adam_m.size() != 0;
+            serialize(has_moments, out);
+            if (has_moments)
+            {
+                serialize(item.adam_t, out);
+                serialize(item.adam_m, out);
+                serialize(item.adam_v, out);
+            }
         }
         friend void deserialize(embeddings_& item, std::istream& in)
         {
             std::string version;
             deserialize(version, in);
-            if (version != "embeddings_")
+            if (version != "embeddings_" && version != "embeddings_2")
                 throw serialization_error("Unexpected version found while deserializing dlib::embeddings_.");
             deserialize(item.embs, in);
             deserialize(item.num_embeddings, in);
             deserialize(item.embedding_dim, in);
             deserialize(item.learning_rate_multiplier, in);
             deserialize(item.scale_by_freq, in);
+            item.lazy_adam = false;
+            item.lazy_adam_learning_rate = 0.001;
+            item.lazy_adam_momentum1 = 0.9;
+            item.lazy_adam_momentum2 = 0.999;
+            item.lazy_adam_eps = 1e-8;
+            item.adam_t = 0;
+            item.adam_m.clear();
+            item.adam_v.clear();
+            if (version == "embeddings_2")
+            {
+                deserialize(item.lazy_adam, in);
+                deserialize(item.lazy_adam_learning_rate, in);
+                deserialize(item.lazy_adam_momentum1, in);
+                deserialize(item.lazy_adam_momentum2, in);
+                deserialize(item.lazy_adam_eps, in);
+                bool has_moments;
+                deserialize(has_moments, in);
+                if (has_moments)
+                {
+                    deserialize(item.adam_t, in);
+                    deserialize(item.adam_m, in);
+                    deserialize(item.adam_v, in);
+                }
+            }
         }
 
         friend std::ostream& operator<<(std::ostream& out, const embeddings_& item)
@@ -5539,6 +5681,13 @@ namespace dlib
             out << "embeddings (num_embeddings=" << item.num_embeddings
                 << ", embedding_dim=" << item.embedding_dim
                 << ") learning_rate_mult=" << item.learning_rate_multiplier;
+            if (item.lazy_adam)
+            {
+                out << " lazy_adam (lr=" << item.lazy_adam_learning_rate
+                    << ", momentum1=" << item.lazy_adam_momentum1
+                    << ", momentum2=" << item.lazy_adam_momentum2
+                    << ", eps=" << item.lazy_adam_eps << ")";
+            }
             return out;
         }
         friend void to_xml(const embeddings_& item, std::ostream& out)
@@ -5546,36 +5695,107 @@ namespace dlib
             out << "<embeddings num_embeddings='" << item.num_embeddings
                 << "' embedding_dim='" << item.embedding_dim
                 << "' learning_rate_mult='"
-                << item.learning_rate_multiplier << "'>\n";
+                << item.learning_rate_multiplier
+                << "' lazy_adam='" << item.lazy_adam << "'>\n";
             out << mat(item.embs);
             out << "</embeddings>\n";
         }
 
     private:
-        void calc_token_freqs(const tensor& prev, const tensor& input) {
-            if (freqs.size() == 0) freqs.set_size(num_embeddings, 1, 1, 1);
-            freqs = 0;
-
+        template <typename visitor>
+        void visit_tokens(const tensor& prev, visitor&& v) const {
             const float* prev_data = prev.host();
-            float* freqs_data = freqs.host();
-            for (long s = 0; s < input.num_samples(); ++s)
+            for (long s = 0; s < prev.num_samples(); ++s)
             {
-                for (long k = 0; k < input.k(); ++k)
+                for (long k = 0; k < prev.k(); ++k)
                 {
-                    for (long r = 0; r < input.nr(); ++r)
+                    for (long r = 0; r < prev.nr(); ++r)
                     {
                         const unsigned long token_idx = static_cast<unsigned long>(prev_data[tensor_index(prev, s, k, r, 0)]);
-                        if (token_idx < num_embeddings) freqs_data[tensor_index(freqs, token_idx, 0, 0, 0)]++;
+                        if (token_idx < num_embeddings) v(token_idx);
                     }
                 }
             }
         }
 
+        void calc_token_freqs(const tensor& prev) {
+            // freqs is kept all zeros between calls, see clear_token_freqs(), so only the
+            // tokens in the batch are touched rather than the whole dictionary.
+            if (freqs.size() == 0)
+            {
+                freqs.set_size(num_embeddings, 1, 1, 1);
+                freqs = 0;
+            }
+            float* freqs_data = freqs.host();
+            visit_tokens(prev, [&](unsigned long token_idx) { freqs_data[token_idx]++; });
+        }
+
+        void clear_token_freqs(const tensor& prev) {
+            float* freqs_data = freqs.host();
+            visit_tokens(prev, [&](unsigned long token_idx) { freqs_data[token_idx] = 0; });
+        }
+
+        void prepare_adam_moments() {
+            if (!have_same_dimensions(adam_m, embs))
+            {
+                adam_m.copy_size(embs);
+                adam_m = 0;
+                adam_v.copy_size(embs);
+                adam_v = 0;
+                adam_t = 0;
+            }
+            ++adam_t;
+        }
+
+        void update_tied(const tensor& prev, const tensor& gradient_input) {
+            // Add the gradient of the lookup to the one accumulated by the tied layers.
+            // The sum is dense, so every row of the table is updated.
+            calc_token_freqs(prev);
+            tt::embeddings_gradient(prev, gradient_input, tied_grad, freqs, -1, scale_by_freq && !lazy_adam);
+            clear_token_freqs(prev);
+
+            if (lazy_adam)
+            {
+                // Run the sparse ADAM update with every token listed once, which makes
+                // it a dense update that shares its moment estimates.
+                if (all_tokens.num_samples() != static_cast<long long>(num_embeddings))
+                {
+                    all_tokens.set_size(num_embeddings, 1, 1, 1);
+                    float* t = all_tokens.host();
+                    for (unsigned long i = 0; i < num_embeddings; ++i)
+                        t[i] = i;
+                }
+                prepare_adam_moments();
+                alias_tensor rows(num_embeddings, 1, 1, embedding_dim);
+                tt::embeddings_adam_update(all_tokens, rows(tied_grad), embs, adam_m, adam_v,
+                    adam_t, lazy_adam_learning_rate*learning_rate_multiplier,
+                    lazy_adam_momentum1, lazy_adam_momentum2, lazy_adam_eps);
+            }
+            else
+            {
+                tt::add(1, embs, -learning_rate_multiplier, tied_grad);
+            }
+        }
+
         resizable_tensor params; // unused
         resizable_tensor embs, freqs;
         unsigned long num_embeddings, embedding_dim;
         double learning_rate_multiplier;
         bool scale_by_freq;
+        // The settings and state of the lazy ADAM update, adam_m and adam_v are empty
+        // until the first update.
+        bool lazy_adam;
+        double lazy_adam_learning_rate;
+        double lazy_adam_momentum1;
+        double lazy_adam_momentum2;
+        double lazy_adam_eps;
+        unsigned long adam_t;
+        resizable_tensor adam_m, adam_v;
+        // The gradient of the table accumulated by get_tied_gradient() during the
+        // current backward pass.  It isn't serialized.
+        resizable_tensor tied_grad;
+        bool tied_gradient_pending = false;
+        resizable_tensor all_tokens;
     };
 
     template <
@@ -5585,6 +5805,123 @@ namespace dlib
         >
     using embeddings = add_layer<embeddings_<nb_embeddings, embedding_length>, SUBNET>;
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        template<typename> class tag
+        >
+    class tied_embeddings_
+    {
+    public:
+        const static unsigned long id = tag_id<tag>::id;
+
+        tied_embeddings_()
+        {
+        }
+
+        template <typename SUBNET>
+        void setup (const SUBNET& /*sub*/)
+        {
+        }
+
+        template <typename SUBNET>
+        void forward(const SUBNET& sub, resizable_tensor& output)
+        {
+            const tensor& x = sub.get_output();
+            const tensor& embs = table(sub).get_embeddings();
+            const long dim = embs.k();
+            if (x.k()*x.nr()*x.nc() == dim)
+            {
+                output.set_size(x.num_samples(), embs.num_samples());
+            }
+            else
+            {
+                DLIB_CASSERT(x.nc() == dim,
+                    "The input must hold vectors of the embedding's size, x.nc(): " << x.nc() << ", embedding_dim: " << dim);
+                output.set_size(x.num_samples(), x.k(), x.nr(), embs.num_samples());
+            }
+
+            const long rows = x.size()/dim;
+            alias_tensor xa(rows, dim), oa(rows, embs.num_samples());
+            auto o = oa(output);
+            tt::gemm(0, o, 1, xa(x).get(), false, embs, true);
+        }
+
+        template <typename SUBNET>
+        void backward(const tensor& gradient_input, SUBNET& sub, tensor& /*params_grad*/)
+        {
+            auto& details = table(sub);
+            const tensor& embs = details.get_embeddings();
+            const tensor& x = sub.get_output();
+            const long dim = embs.k();
+            const long rows = x.size()/dim;
+            alias_tensor xa(rows, dim), ga(rows, embs.num_samples());
+
+            auto dx = xa(sub.get_gradient_input());
+            tt::gemm(1, dx, 1, ga(gradient_input).get(), false, embs, false);
+            tt::gemm(1, details.get_tied_gradient(), 1, ga(gradient_input).get(), true, xa(x).get(), false);
+        }
+
+        const tensor& get_layer_params() const { return params; }
+        tensor& get_layer_params() { return params; }
+
+        friend void serialize(const tied_embeddings_& /*item*/, std::ostream& out)
+        {
+            serialize("tied_embeddings_", out);
+        }
+
+        friend void deserialize(tied_embeddings_& /*item*/, std::istream& in)
+        {
+            std::string version;
+            deserialize(version, in);
+            if (version != "tied_embeddings_")
+                throw serialization_error("Unexpected version '"+version+"' found while deserializing dlib::tied_embeddings_.");
+        }
+        friend std::ostream& operator<<(std::ostream& out, const tied_embeddings_& /*item*/)
+        {
+            out << "tied_embeddings"<<id;
+            return out;
+        }
+
+        friend void to_xml(const tied_embeddings_& /*item*/, std::ostream& out)
+        {
+            out << "<tied_embeddings tag='"<<id<<"'/>\n";
+        }
+
+    private:
+        template <typename SUBNET>
+        static auto table(const SUBNET& sub) -> decltype(layer<tag>(sub).subnet().layer_details())
+        {
+            // The tag must be applied directly to the embeddings layer.
+            return layer<tag>(sub).subnet().layer_details();
+        }
+
+        template <typename SUBNET>
+        static auto table(SUBNET& sub) -> decltype(layer<tag>(sub).subnet().layer_details())
+        {
+            return layer<tag>(sub).subnet().layer_details();
+        }
+
+        resizable_tensor params;
+    };
+
+    template <
+        template<typename> class tag,
+        typename SUBNET
+        >
+    using tied_embeddings = add_layer<tied_embeddings_<tag>, SUBNET>;
+
+    template <typename SUBNET> using tied_embeddings1  = tied_embeddings<tag1, SUBNET>;
+    template <typename SUBNET> using tied_embeddings2  = tied_embeddings<tag2, SUBNET>;
+    template <typename SUBNET> using tied_embeddings3  = tied_embeddings<tag3, SUBNET>;
+    template <typename SUBNET> using tied_embeddings4  = tied_embeddings<tag4, SUBNET>;
+    template <typename SUBNET> using tied_embeddings5  = tied_embeddings<tag5, SUBNET>;
+    template <typename SUBNET> using tied_embeddings6  = tied_embeddings<tag6, SUBNET>;
+    template <typename SUBNET> using tied_embeddings7  = tied_embeddings<tag7, SUBNET>;
+    template <typename SUBNET> using tied_embeddings8  = tied_embeddings<tag8, SUBNET>;
+    template <typename SUBNET> using tied_embeddings9  = tied_embeddings<tag9, SUBNET>;
+    template <typename SUBNET> using tied_embeddings10 = tied_embeddings<tag10, SUBNET>;
+
 // ----------------------------------------------------------------------------------------
   
     struct neg_infinity_tag {};
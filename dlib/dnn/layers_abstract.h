@@ -116,6 +116,16 @@ namespace dlib
                   layer's behavior.
         !*/
 
+        layer_details_type& layer_details(
+        );
+        /*!
+            ensures
+                - returns the layer_details_type instance that defines the behavior of the
+                  layer at the top of this network.  This non-const version is only
+                  available during backward(), e.g. so that a layer can hand a gradient to
+                  a deeper layer that shares its parameters, as tied_embeddings_ does.
+        !*/
+
         unsigned int sample_expansion_factor (
         ) const;
         /*!
@@ -393,6 +403,24 @@ namespace dlib
                   information before saving the network to disk.  
         !*/
 
+        void set_recomputing_forward (
+            bool recomputing
+        );
+        /*!
+            Implementing this function is optional.  Layers whose forward() changes state
+            other than their output, e.g. by drawing random numbers or updating running
+            statistics, should provide it so that they work with gradient checkpointing
+            (see repeat::set_gradient_checkpointing()).  If you do provide it then it must
+            behave as follows:
+
+            ensures
+                - While set_recomputing_forward(true) is in effect, forward() is being rerun
+                  on the same input as the previous call to forward().  It must produce the
+                  same output that call did and must not change the state of this object
+                  again.
+                - set_recomputing_forward(false) returns this object to normal operation.
+        !*/
+
     };
 
     std::ostream& operator<<(std::ostream& out, const EXAMPLE_COMPUTATIONAL_LAYER_& item);
@@ -1852,12 +1880,14 @@ namespace dlib
         template <typename SUBNET> void setup (const SUBNET& sub);
         void forward_inplace(const tensor& input, tensor& output);
         void backward_inplace(const tensor& gradient_input, tensor& data_grad, tensor& params_grad);
+        void set_recomputing_forward(bool recomputing);
         dpoint map_input_to_output(dpoint p) const;
         dpoint map_output_to_input(dpoint p) const;
         const tensor& get_layer_params() const; 
         tensor& get_layer_params(); 
         /*!
-            These functions are implemented as described in the EXAMPLE_COMPUTATIONAL_LAYER_ interface.
+            These functions are implemented as described in the EXAMPLE_COMPUTATIONAL_LAYER_
+            interface.  A recomputed forward pass applies the same mask as the previous one.
         !*/
     };
 
@@ -2467,12 +2497,14 @@ namespace dlib
         template <typename SUBNET> void setup (const SUBNET& sub);
         template <typename SUBNET> void forward(const SUBNET& sub, resizable_tensor& output);
         template <typename SUBNET> void backward(const tensor& gradient_input, SUBNET& sub, tensor& params_grad);
+        void set_recomputing_forward(bool recomputing);
         dpoint map_input_to_output(dpoint p) const;
         dpoint map_output_to_input(dpoint p) const;
         const tensor& get_layer_params() const; 
         tensor& get_layer_params(); 
         /*!
-            These functions are implemented as described in the EXAMPLE_COMPUTATIONAL_LAYER_ interface.
+            These functions are implemented as described in the EXAMPLE_COMPUTATIONAL_LAYER_
+            interface.  A recomputed forward pass doesn't update the running statistics.
         !*/
     };
 
@@ -4492,6 +4524,14 @@ namespace dlib
                 Distributed representations of words and phrases and their compositionality. 
                 In Advances in neural information processing systems (pp. 3111-3119).
 
+                The embedding table is not given to the network's solvers.  Instead,
+                backward() updates the rows of the tokens in the current batch directly,
+                using get_learning_rate_multiplier() as the step size.  Rows of tokens
+                that aren't in the batch are never touched, so the cost of a training
+                step doesn't grow with the size of the dictionary.  By default the update
+                is plain SGD, but set_lazy_adam(true) switches it to ADAM applied only to
+                the touched rows, which usually trains large dictionaries much faster.
+
             TEMPLATE PARAMETERS
                 - num_embeddings_: The size of the embedding dictionary, i.e., the number of 
                                 discrete tokens that can be embedded.
@@ -4503,6 +4543,11 @@ namespace dlib
                 - get_embedding_dim() == embedding_dim_
                 - get_learning_rate_multiplier() returns the learning rate multiplier for this layer.
                 - get_scale_by_freq() returns whether to scale gradients by token frequency.
+                - get_lazy_adam() returns whether the embeddings are updated with lazy ADAM
+                  rather than SGD.
+                - get_lazy_adam_learning_rate(), get_lazy_adam_momentum1(),
+                  get_lazy_adam_momentum2(), and get_lazy_adam_eps() are the settings of
+                  the lazy ADAM update.
         */        
     public:
         embeddings_() = default;
@@ -4517,6 +4562,86 @@ namespace dlib
         void set_learning_rate_multiplier(double val);
         void set_scale_by_freq(bool val);
 
+        void set_lazy_adam(
+            bool val
+        );
+        /*!
+            ensures
+                - #get_lazy_adam() == val
+                - If val is true, backward() updates the embeddings of the tokens in the
+                  batch with tt::embeddings_adam_update(), using
+                  get_lazy_adam_learning_rate()*get_learning_rate_multiplier() as the
+                  learning rate, get_lazy_adam_momentum1(), get_lazy_adam_momentum2(),
+                  and get_lazy_adam_eps(), and one moment estimate per embedding value
+                  that is kept in this object.  get_scale_by_freq() has no effect in this
+                  mode.
+                - If val is false, backward() performs the frequency scaled SGD update of
+                  tt::embeddings_gradient().
+                - Changing the mode discards the moment estimates.  They take as much
+                  space as the embeddings and are serialized with this object when there
+                  are any, so that training can resume where it left off.  Calling
+                  set_lazy_adam(false) before saving a trained network leaves them out.
+        !*/
+
+        bool get_lazy_adam(
+        ) const;
+
+        void set_lazy_adam_learning_rate(
+            double val
+        );
+        /*!
+            requires
+                - val >= 0
+            ensures
+                - #get_lazy_adam_learning_rate() == val
+                - By default, get_lazy_adam_learning_rate() == 0.001.
+        !*/
+
+        double get_lazy_adam_learning_rate(
+        ) const;
+
+        void set_lazy_adam_momentum1(
+            double val
+        );
+        /*!
+            requires
+                - 0 <= val < 1
+            ensures
+                - #get_lazy_adam_momentum1() == val
+                - By default, get_lazy_adam_momentum1() == 0.9.
+        !*/
+
+        double get_lazy_adam_momentum1(
+        ) const;
+
+        void set_lazy_adam_momentum2(
+            double val
+        );
+        /*!
+            requires
+                - 0 <= val < 1
+            ensures
+                - #get_lazy_adam_momentum2() == val
+                - By default, get_lazy_adam_momentum2() == 0.999.
+        !*/
+
+        double get_lazy_adam_momentum2(
+        ) const;
+
+        void set_lazy_adam_eps(
+            double val
+        );
+        /*!
+            requires
+                - val > 0
+            ensures
+                - #get_lazy_adam_eps() == val
+                - By default, get_lazy_adam_eps() == 1e-8.
+        !*/
+
+        double get_lazy_adam_eps(
+        ) const;
+
         template <typename SUBNET> void setup(const SUBNET& sub);
         template <typename SUBNET> void forward(const SUBNET& sub, resizable_tensor& output);
         template <typename SUBNET> void backward(const tensor& gradient_input, SUBNET& sub, tensor& params_grad);
@@ -4526,6 +4651,33 @@ namespace dlib
         const tensor& get_embeddings() const;
         tensor& get_embeddings();
 
+        tensor& get_tied_gradient(
+        );
+        /*!
+            ensures
+                - returns a tensor with the dimensions of get_embeddings() into which
+                  layers that use the embeddings as their weights, such as
+                  tied_embeddings_ and loss_multiclass_log_chunked_, add the gradient of
+                  the loss with respect to the embeddings.  The first call after a
+                  backward() or clear_tied_gradient() returns a tensor of all zeros.
+                - If get_tied_gradient() was called since the last backward() or
+                  clear_tied_gradient(), the next backward() adds the gradient of its own
+                  lookup to this tensor and updates every row of the embeddings with the
+                  sum, using SGD or lazy ADAM as selected by set_lazy_adam().  This costs
+                  time proportional to the size of the dictionary.
+                - The accumulated gradient is not part of this object's serialized state.
+        !*/
+
+        void clear_tied_gradient(
+        );
+        /*!
+            ensures
+                - discards any gradient accumulated by get_tied_gradient() since the last
+                  backward().  Loss layers that add to get_tied_gradient() call this
+                  first, so a loss evaluated without a backward pass, e.g. by
+                  compute_loss() on validation data, never changes the embeddings.
+        !*/
+
         friend void serialize(const embeddings_& item, std::ostream& out);
         friend void deserialize(embeddings_& item, std::istream& in);
         friend std::ostream& operator<<(std::ostream& out, const embeddings_& item);
@@ -4543,6 +4695,69 @@ namespace dlib
         >
     using embeddings = add_layer<embeddings_<num_embeddings, embedding_dim>, SUBNET>;
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        template<typename> class tag
+        >
+    class tied_embeddings_
+    {
+        /*!
+            REQUIREMENTS ON tag
+                layer<tag>(sub).subnet() must be an embeddings layer, i.e. the tag must
+                be applied directly to the output of an embeddings_ layer.
+
+            WHAT THIS OBJECT REPRESENTS
+                This is an implementation of the EXAMPLE_COMPUTATIONAL_LAYER_ interface
+                defined above.  It projects its input onto the embeddings of a deeper
+                embeddings_ layer, which is how language models tie their input and
+                output embeddings.  If E is the num_embeddings by embedding_dim matrix
+                returned by get_embeddings() then each embedding_dim sized vector x of
+                the input is replaced by the num_embeddings logits E*x.  This layer has
+                no parameters of its own.  Instead, its backward() adds the gradient of
+                E to the embeddings layer's get_tied_gradient(), and the embeddings layer
+                applies it together with the gradient of its lookup.
+
+                If each input sample holds a single vector, i.e.
+                sub.get_output().k()*sub.get_output().nr()*sub.get_output().nc() ==
+                embedding_dim, the output has the shape num_samples x num_embeddings x 1
+                x 1, which is what loss_multiclass_log expects.  Otherwise the input must
+                have sub.get_output().nc() == embedding_dim and the output has the shape
+                num_samples x k x nr x num_embeddings.
+        !*/
+
+    public:
+        tied_embeddings_(
+        ); 
+
+        template <typename SUBNET> void setup (const SUBNET& sub);
+        template <typename SUBNET> void forward(const SUBNET& sub, resizable_tensor& output);
+        template <typename SUBNET> void backward(const tensor& gradient_input, SUBNET& sub, tensor& params_grad);
+        const tensor& get_layer_params() const; 
+        tensor& get_layer_params(); 
+        /*!
+            These functions are implemented as described in the EXAMPLE_COMPUTATIONAL_LAYER_ interface.
+        !*/
+    };
+
+    template <
+        template<typename> class tag,
+        typename SUBNET
+        >
+    using tied_embeddings = add_layer<tied_embeddings_<tag>, SUBNET>;
+
+    // Here we add some convenient aliases for using tied_embeddings_ with the tag layers. 
+    template <typename SUBNET> using tied_embeddings1  = tied_embeddings<tag1, SUBNET>;
+    template <typename SUBNET> using tied_embeddings2  = tied_embeddings<tag2, SUBNET>;
+    template <typename SUBNET> using tied_embeddings3  = tied_embeddings<tag3, SUBNET>;
+    template <typename SUBNET> using tied_embeddings4  = tied_embeddings<tag4, SUBNET>;
+    template <typename SUBNET> using tied_embeddings5  = tied_embeddings<tag5, SUBNET>;
+    template <typename SUBNET> using tied_embeddings6  = tied_embeddings<tag6, SUBNET>;
+    template <typename SUBNET> using tied_embeddings7  = tied_embeddings<tag7, SUBNET>;
+    template <typename SUBNET> using tied_embeddings8  = tied_embeddings<tag8, SUBNET>;
+    template <typename SUBNET> using tied_embeddings9  = tied_embeddings<tag9, SUBNET>;
+    template <typename SUBNET> using tied_embeddings10 = tied_embeddings<tag10, SUBNET>;
+
 // ----------------------------------------------------------------------------------------
 
     struct neg_infinity_tag {};
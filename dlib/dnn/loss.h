@@ -361,6 +361,246 @@ namespace dlib
     template <typename SUBNET>
     using loss_multiclass_log = add_loss_layer<loss_multiclass_log_, SUBNET>;
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        template<typename> class tag
+        >
+    class loss_multiclass_log_chunked_
+    {
+    public:
+
+        typedef unsigned long training_label_type;
+        typedef unsigned long output_label_type;
+
+        loss_multiclass_log_chunked_(
+        ) : chunk_size(4096)
+        {
+        }
+
+        void set_chunk_size (
+            unsigned long size
+        )
+        {
+            DLIB_CASSERT(size > 0);
+            chunk_size = size;
+        }
+
+        unsigned long get_chunk_size (
+        ) const { return chunk_size; }
+
+        template <
+            typename SUB_TYPE,
+            typename label_iterator
+            >
+        void to_label (
+            const tensor& input_tensor,
+            const SUB_TYPE& sub,
+            label_iterator iter
+        ) const
+        {
+            const tensor& output_tensor = sub.get_output();
+            const tensor& embs = table(sub).get_embeddings();
+            DLIB_CASSERT(sub.sample_expansion_factor() == 1);
+            DLIB_CASSERT(input_tensor.num_samples() == output_tensor.num_samples());
+            DLIB_CASSERT(output_tensor.k()*output_tensor.nr()*output_tensor.nc() == embs.k());
+
+            const long num = output_tensor.num_samples();
+            std::vector<float> best(num, -std::numeric_limits<float>::infinity());
+            std::vector<unsigned long> labels(num, 0);
+            for (long v0 = 0; v0 < embs.num_samples(); v0 += chunk_size)
+            {
+                const long size = compute_logits(output_tensor, embs, v0);
+                const float* l = logits.host();
+                for (long i = 0; i < num; ++i)
+                {
+                    for (long c = 0; c < size; ++c)
+                    {
+                        if (l[i*size+c] > best[i])
+                        {
+                            best[i] = l[i*size+c];
+                            labels[i] = v0+c;
+                        }
+                    }
+                }
+            }
+            for (long i = 0; i < num; ++i)
+                *iter++ = labels[i];
+        }
+
+
+        template <
+            typename const_label_iterator,
+            typename SUBNET
+            >
+        double compute_loss_value_and_gradient (
+            const tensor& input_tensor,
+            const_label_iterator truth, 
+            SUBNET& sub
+        ) const
+        {
+            const tensor& output_tensor = sub.get_output();
+            tensor& grad = sub.get_gradient_input();
+            auto& details = table(sub);
+            const tensor& embs = details.get_embeddings();
+
+            DLIB_CASSERT(sub.sample_expansion_factor() == 1);
+            DLIB_CASSERT(input_tensor.num_samples() != 0);
+            DLIB_CASSERT(input_tensor.num_samples() == grad.num_samples());
+            DLIB_CASSERT(input_tensor.num_samples() == output_tensor.num_samples());
+            DLIB_CASSERT(output_tensor.k()*output_tensor.nr()*output_tensor.nc() == embs.k(),
+                "The network's output must be a vector of the embedding's size for each sample.");
+
+            const long num = output_tensor.num_samples();
+            const long num_classes = embs.num_samples();
+            std::vector<long> y(num);
+            for (long i = 0; i < num; ++i)
+            {
+                y[i] = (long)*truth++;
+                DLIB_CASSERT(y[i] < num_classes, "y: " << y[i] << ", number of embeddings: " << num_classes);
+            }
+
+            // The first pass finds the log of the softmax normalizer of each sample one
+            // chunk of the vocabulary at a time, so the full matrix of logits is never
+            // stored.
+            std::vector<float> max_logit(num, -std::numeric_limits<float>::infinity());
+            std::vector<double> sum_exp(num, 0);
+            std::vector<float> truth_logit(num, 0);
+            for (long v0 = 0; v0 < num_classes; v0 += chunk_size)
+            {
+                const long size = compute_logits(output_tensor, embs, v0);
+                const float* l = logits.host();
+                for (long i = 0; i < num; ++i)
+                {
+                    const float* li = l + i*size;
+                    const float m = *std::max_element(li, li+size);
+                    double s = 0;
+                    for (long c = 0; c < size; ++c)
+                        s += std::exp(li[c]-m);
+                    if (m > max_logit[i])
+                    {
+                        sum_exp[i] = sum_exp[i]*std::exp(max_logit[i]-m) + s;
+                        max_logit[i] = m;
+                    }
+                    else
+                    {
+                        sum_exp[i] += s*std::exp(m-max_logit[i]);
+                    }
+                    if (v0 <= y[i] && y[i] < v0+size)
+                        truth_logit[i] = li[y[i]-v0];
+                }
+            }
+
+            // The loss we output is the average loss over the mini-batch.
+            const double scale = 1.0/num;
+            double loss = 0;
+            std::vector<float> log_norm(num);
+            for (long i = 0; i < num; ++i)
+            {
+                log_norm[i] = max_logit[i] + std::log(sum_exp[i]);
+                loss += scale*(log_norm[i] - truth_logit[i]);
+            }
+
+            // The second pass recomputes each chunk, turns it into the gradient of the
+            // logits, and sends that to the network's output and to the embeddings.
+            // compute_loss() runs this without a backward pass, so whatever an earlier
+            // call left behind is dropped rather than applied by the next backward().
+            details.clear_tied_gradient();
+            tensor& tied_grad = details.get_tied_gradient();
+            alias_tensor grad_rows(num, embs.k());
+            auto g = grad_rows(grad);
+            for (long v0 = 0; v0 < num_classes; v0 += chunk_size)
+            {
+                const long size = compute_logits(output_tensor, embs, v0);
+                float* l = logits.host();
+                for (long i = 0; i < num; ++i)
+                {
+                    float* li = l + i*size;
+                    for (long c = 0; c < size; ++c)
+                        li[c] = scale*std::exp(li[c]-log_norm[i]);
+                    if (v0 <= y[i] && y[i] < v0+size)
+                        li[y[i]-v0] -= scale;
+                }
+
+                alias_tensor chunk(size, embs.k());
+                auto dembs = chunk(tied_grad, v0*embs.k());
+                tt::gemm(v0 == 0 ? 0 : 1, g, 1, logits, false, chunk(embs, v0*embs.k()).get(), false);
+                tt::gemm(1, dembs, 1, logits, true, grad_rows(output_tensor).get(), false);
+            }
+            return loss;
+        }
+
+        friend void serialize(const loss_multiclass_log_chunked_& item, std::ostream& out)
+        {
+            serialize("loss_multiclass_log_chunked_", out);
+            serialize(item.chunk_size, out);
+        }
+
+        friend void deserialize(loss_multiclass_log_chunked_& item, std::istream& in)
+        {
+            std::string version;
+            deserialize(version, in);
+            if (version != "loss_multiclass_log_chunked_")
+                throw serialization_error("Unexpected version found while deserializing dlib::loss_multiclass_log_chunked_.");
+            deserialize(item.chunk_size, in);
+        }
+
+        friend std::ostream& operator<<(std::ostream& out, const loss_multiclass_log_chunked_& item)
+        {
+            out << "loss_multiclass_log_chunked (tag=" << tag_id<tag>::id
+                << ", chunk_size=" << item.chunk_size << ")";
+            return out;
+        }
+
+        friend void to_xml(const loss_multiclass_log_chunked_& item, std::ostream& out)
+        {
+            out << "<loss_multiclass_log_chunked tag='" << tag_id<tag>::id
+                << "' chunk_size='" << item.chunk_size << "'/>\n";
+        }
+
+    private:
+        template <typename SUBNET>
+        static auto table(const SUBNET& sub) -> decltype(layer<tag>(sub).subnet().layer_details())
+        {
+            // The tag must be applied directly to the embeddings layer.
+            return layer<tag>(sub).subnet().layer_details();
+        }
+
+        template <typename SUBNET>
+        static auto table(SUBNET& sub) -> decltype(layer<tag>(sub).subnet().layer_details())
+        {
+            return layer<tag>(sub).subnet().layer_details();
+        }
+
+        long compute_logits (
+            const tensor& x,
+            const tensor& embs,
+            long v0
+        ) const
+        /*!
+            ensures
+                - #logits == the logits of the embeddings in [v0, v0+returned value),
+                  one row per sample.
+        !*/
+        {
+            const long size = std::min<long>(chunk_size, embs.num_samples()-v0);
+            alias_tensor x_rows(x.num_samples(), embs.k());
+            alias_tensor chunk(size, embs.k());
+            logits.set_size(x.num_samples(), size);
+            tt::gemm(0, logits, 1, x_rows(x).get(), false, chunk(embs, v0*embs.k()).get(), true);
+            return size;
+        }
+
+        unsigned long chunk_size;
+        mutable resizable_tensor logits;
+    };
+
+    template <
+        template<typename> class tag,
+        typename SUBNET
+        >
+    using loss_multiclass_log_chunked = add_loss_layer<loss_multiclass_log_chunked_<tag>, SUBNET>;
+
 // ----------------------------------------------------------------------------------------
 
     class loss_multiclass_log_weighted_
@@ -369,6 +369,115 @@ namespace dlib
     template <typename SUBNET>
     using loss_multiclass_log = add_loss_layer<loss_multiclass_log_, SUBNET>;
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        template<typename> class tag
+        >
+    class loss_multiclass_log_chunked_
+    {
+        /*!
+            REQUIREMENTS ON tag
+                layer<tag>(sub).subnet() must be an embeddings layer, i.e. the tag must
+                be applied directly to the output of an embeddings_ layer.
+
+            WHAT THIS OBJECT REPRESENTS
+                This object implements the loss layer interface defined above by
+                EXAMPLE_LOSS_LAYER_.  It computes the same loss as
+                loss_multiclass_log<tied_embeddings<tag,SUBNET>>, that is, the multiclass
+                logistic regression loss of the logits obtained by projecting the
+                network's output onto the embeddings of the tagged embeddings_ layer.
+                The difference is that the logits are computed get_chunk_size()
+                embeddings at a time, twice, and never stored all at once.  So the
+                memory used by the loss is proportional to the mini-batch size times
+                get_chunk_size() rather than times the size of the dictionary, which
+                matters for the large vocabularies of language models.
+
+                The gradient with respect to the embeddings is added to the embeddings
+                layer's get_tied_gradient(), so the embeddings layer applies it during
+                the same backward pass.  Each evaluation of the loss first calls
+                clear_tied_gradient(), so evaluating it without a backward pass, as
+                compute_loss() and dnn_trainer::test_one_step() do, leaves the
+                embeddings untouched.  The labels are integers in the range [0,
+                num_embeddings).
+        !*/
+
+    public:
+
+        typedef unsigned long training_label_type;
+        typedef unsigned long output_label_type;
+
+        loss_multiclass_log_chunked_(
+        );
+        /*!
+            ensures
+                - #get_chunk_size() == 4096
+        !*/
+
+        void set_chunk_size (
+            unsigned long size
+        );
+        /*!
+            requires
+                - size > 0
+            ensures
+                - #get_chunk_size() == size
+        !*/
+
+        unsigned long get_chunk_size (
+        ) const;
+        /*!
+            ensures
+                - returns the number of embeddings whose logits are computed at once.
+        !*/
+
+        template <
+            typename SUB_TYPE,
+            typename label_iterator
+            >
+        void to_label (
+            const tensor& input_tensor,
+            const SUB_TYPE& sub,
+            label_iterator iter
+        ) const;
+        /*!
+            This function has the same interface as EXAMPLE_LOSS_LAYER_::to_label() except
+            it has the additional calling requirements that: 
+                - sub.get_output().k()*sub.get_output().nr()*sub.get_output().nc() ==
+                  the embedding_dim of the tagged embeddings layer.
+                - sub.get_output().num_samples() == input_tensor.num_samples()
+                - sub.sample_expansion_factor() == 1
+            and the output label is the index of the embedding with the largest logit.
+        !*/
+
+        template <
+            typename const_label_iterator,
+            typename SUBNET
+            >
+        double compute_loss_value_and_gradient (
+            const tensor& input_tensor,
+            const_label_iterator truth, 
+            SUBNET& sub
+        ) const;
+        /*!
+            This function has the same interface as EXAMPLE_LOSS_LAYER_::compute_loss_value_and_gradient() 
+            except it has the additional calling requirements that: 
+                - sub.get_output().k()*sub.get_output().nr()*sub.get_output().nc() ==
+                  the embedding_dim of the tagged embeddings layer.
+                - sub.get_output().num_samples() == input_tensor.num_samples()
+                - sub.sample_expansion_factor() == 1
+                - all values pointed to by truth are < the num_embeddings of the tagged
+                  embeddings layer.
+        !*/
+
+    };
+
+    template <
+        template<typename> class tag,
+        typename SUBNET
+        >
+    using loss_multiclass_log_chunked = add_loss_layer<loss_multiclass_log_chunked_<tag>, SUBNET>;
+
 // ----------------------------------------------------------------------------------------
 
     template <typename label_type>
@@ -61,7 +61,14 @@ namespace dlib
             enum tensor_data_type
             {
                 FLOAT = 1,
-                INT64 = 7
+                UINT8 = 2,
+                INT8 = 3,
+                UINT16 = 4,
+                INT16 = 5,
+                INT32 = 6,
+                INT64 = 7,
+                BOOL = 9,
+                DOUBLE = 11
             };
 
             enum attribute_type
@@ -70,6 +77,7 @@ namespace dlib
                 ATTRIBUTE_INT = 2,
                 ATTRIBUTE_STRING = 3,
                 ATTRIBUTE_TENSOR = 4,
+                ATTRIBUTE_FLOATS = 6,
                 ATTRIBUTE_INTS = 7
             };
 
@@ -1744,18 +1752,10 @@ namespace dlib
                 {
                     if (ctx.current_shape.size() != 4)
                         throw dlib::error("ONNX softmaxm export expected a 4D input tensor.");
-                    const auto output_shape = ctx.current_shape;
-                    const std::vector<int64_t> flat_plane_shape = {
-                        output_shape[0],
-                        output_shape[1],
-                        output_shape[2]*output_shape[3]
-                    };
-                    export_reshape(ctx, flat_plane_shape, "softmaxm_flatten");
-                    const std::string output_name = ctx.next_value_name("softmax");
-                    ctx.add_node("Softmax", {ctx.current_name}, {output_name}, {make_attribute_int("axis", 2)});
+                    // dlib normalizes each row of each plane, i.e. over the last axis.
+                    const std::string output_name = ctx.next_value_name("softmaxm");
+                    ctx.add_node("Softmax", {ctx.current_name}, {output_name}, {make_attribute_int("axis", 3)});
                     ctx.current_name = output_name;
-                    ctx.current_shape = flat_plane_shape;
-                    export_reshape(ctx, output_shape, "softmaxm");
                 }
                 else
                 {
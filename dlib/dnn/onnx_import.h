@@ -0,0 +1,3037 @@
+// Copyright (C) 2026
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_DNn_ONNX_IMPORT_H_
+#define DLIB_DNn_ONNX_IMPORT_H_
+
+#include "onnx_import_abstract.h"
+#include "onnx.h"
+#include "../cuda/tensor.h"
+#include "../cuda/tensor_tools.h"
+#include "../error.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        namespace onnx
+        {
+            /*
+                The reader below is the counterpart of the writer in onnx.h.  It
+                walks the protobuf wire format directly and understands the same
+                ModelProto subset, plus the TensorProto storage variants
+                (raw_data, float_data, int32_data, int64_data, double_data) that
+                other ONNX producers commonly emit.
+            */
+            class proto_reader
+            {
+            public:
+                proto_reader(const char* begin_, const char* end_) : pos(begin_), end(end_) {}
+
+                bool done() const { return pos >= end; }
+
+                bool next_field(int& field_number, int& wire_type)
+                {
+                    if (done())
+                        return false;
+                    const uint64_t key = read_varint();
+                    field_number = static_cast<int>(key >> 3);
+                    wire_type = static_cast<int>(key & 7);
+                    return true;
+                }
+
+                uint64_t read_varint()
+                {
+                    uint64_t value = 0;
+                    for (int shift = 0; shift < 64; shift += 7)
+                    {
+                        if (done())
+                            throw dlib::error("ONNX import found a truncated varint.");
+                        const uint8_t byte = static_cast<uint8_t>(*pos++);
+                        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                        if ((byte & 0x80) == 0)
+                            return value;
+                    }
+                    throw dlib::error("ONNX import found a malformed varint.");
+                }
+
+                float read_fixed32_float()
+                {
+                    require(4);
+                    const float value = decode_float(pos);
+                    pos += 4;
+                    return value;
+                }
+
+                double read_fixed64_double()
+                {
+                    require(8);
+                    const double value = decode_double(pos);
+                    pos += 8;
+                    return value;
+                }
+
+                proto_reader read_message()
+                {
+                    const uint64_t size = read_varint();
+                    if (size > static_cast<uint64_t>(end - pos))
+                        throw dlib::error("ONNX import found a truncated length-delimited field.");
+                    proto_reader sub(pos, pos + size);
+                    pos += size;
+                    return sub;
+                }
+
+                std::string read_string()
+                {
+                    const proto_reader sub = read_message();
+                    return std::string(sub.pos, sub.end);
+                }
+
+                void read_int64s(int wire_type, std::vector<int64_t>& values)
+                {
+                    if (wire_type == 2)
+                    {
+                        proto_reader sub = read_message();
+                        while (!sub.done())
+                            values.push_back(static_cast<int64_t>(sub.read_varint()));
+                    }
+                    else
+                    {
+                        values.push_back(static_cast<int64_t>(read_varint()));
+                    }
+                }
+
+                void read_floats(int wire_type, std::vector<float>& values)
+                {
+                    if (wire_type == 2)
+                    {
+                        proto_reader sub = read_message();
+                        while (!sub.done())
+                            values.push_back(sub.read_fixed32_float());
+                    }
+                    else
+                    {
+                        values.push_back(read_fixed32_float());
+                    }
+                }
+
+                void read_doubles(int wire_type, std::vector<double>& values)
+                {
+                    if (wire_type == 2)
+                    {
+                        proto_reader sub = read_message();
+                        while (!sub.done())
+                            values.push_back(sub.read_fixed64_double());
+                    }
+                    else
+                    {
+                        values.push_back(read_fixed64_double());
+                    }
+                }
+
+                void skip(int wire_type)
+                {
+                    switch (wire_type)
+                    {
+                        case 0: read_varint(); break;
+                        case 1: require(8); pos += 8; break;
+                        case 2: read_message(); break;
+                        case 5: require(4); pos += 4; break;
+                        default: throw dlib::error("ONNX import found an unsupported protobuf wire type.");
+                    }
+                }
+
+                static float decode_float(const char* p)
+                {
+                    uint32_t bits = 0;
+                    for (int i = 3; i >= 0; --i)
+                        bits = (bits << 8) | static_cast<uint8_t>(p[i]);
+                    float value;
+                    std::memcpy(&value, &bits, sizeof(value));
+                    return value;
+                }
+
+                static double decode_double(const char* p)
+                {
+                    uint64_t bits = 0;
+                    for (int i = 7; i >= 0; --i)
+                        bits = (bits << 8) | static_cast<uint8_t>(p[i]);
+                    double value;
+                    std::memcpy(&value, &bits, sizeof(value));
+                    return value;
+                }
+
+                static int64_t decode_int64(const char* p)
+                {
+                    uint64_t bits = 0;
+                    for (int i = 7; i >= 0; --i)
+                        bits = (bits << 8) | static_cast<uint8_t>(p[i]);
+                    return static_cast<int64_t>(bits);
+                }
+
+            private:
+                void require(size_t count) const
+                {
+                    if (static_cast<size_t>(end - pos) < count)
+                        throw dlib::error("ONNX import found a truncated fixed-width field.");
+                }
+
+                const char* pos;
+                const char* end;
+            };
+
+        // ------------------------------------------------------------------------------------
+
+            struct parsed_tensor
+            {
+                std::string name;
+                std::vector<int64_t> dims;
+                int data_type = 0;
+                // FLOAT and DOUBLE tensors are stored in float_data, all integer
+                // and BOOL tensors are widened into int64_data.
+                std::vector<float> float_data;
+                std::vector<int64_t> int64_data;
+            };
+
+            struct parsed_attribute
+            {
+                std::string name;
+                int type = 0;
+                float f = 0;
+                int64_t i = 0;
+                std::string s;
+                parsed_tensor t;
+                std::vector<float> floats;
+                std::vector<int64_t> ints;
+            };
+
+            struct parsed_value_info
+            {
+                std::string name;
+                int elem_type = 0;
+                // Unknown or symbolic dimensions are stored as -1.
+                std::vector<int64_t> dims;
+            };
+
+            struct parsed_node
+            {
+                std::string name;
+                std::string op_type;
+                std::string domain;
+                std::vector<std::string> inputs;
+                std::vector<std::string> outputs;
+                std::vector<parsed_attribute> attributes;
+            };
+
+            struct parsed_graph
+            {
+                std::vector<parsed_node> nodes;
+                std::vector<parsed_tensor> initializers;
+                std::vector<parsed_value_info> inputs;
+                std::vector<parsed_value_info> outputs;
+                int64_t opset_version = 0;
+            };
+
+            inline bool is_integer_data_type(int data_type)
+            {
+                return data_type == UINT8 || data_type == INT8 || data_type == UINT16 ||
+                       data_type == INT16 || data_type == INT32 || data_type == INT64 ||
+                       data_type == BOOL;
+            }
+
+            inline size_t raw_element_size(int data_type)
+            {
+                switch (data_type)
+                {
+                    case UINT8: case INT8: case BOOL: return 1;
+                    case UINT16: case INT16: return 2;
+                    case FLOAT: case INT32: return 4;
+                    case INT64: case DOUBLE: return 8;
+                    default: return 0;
+                }
+            }
+
+            inline int64_t decode_raw_integer(const char* p, int data_type)
+            {
+                switch (data_type)
+                {
+                    case UINT8: return static_cast<uint8_t>(p[0]);
+                    case INT8: return static_cast<int8_t>(p[0]);
+                    case BOOL: return p[0] != 0 ? 1 : 0;
+                    case UINT16: return static_cast<uint16_t>(static_cast<uint8_t>(p[0]) | (static_cast<uint8_t>(p[1]) << 8));
+                    case INT16: return static_cast<int16_t>(static_cast<uint8_t>(p[0]) | (static_cast<uint8_t>(p[1]) << 8));
+                    case INT32:
+                    {
+                        uint32_t bits = 0;
+                        for (int i = 3; i >= 0; --i)
+                            bits = (bits << 8) | static_cast<uint8_t>(p[i]);
+                        return static_cast<int32_t>(bits);
+                    }
+                    default: return proto_reader::decode_int64(p);
+                }
+            }
+
+            inline parsed_tensor parse_tensor(proto_reader in)
+            {
+                parsed_tensor t;
+                std::string raw;
+                bool has_raw = false;
+                bool external = false;
+                std::vector<int64_t> int32_data;
+                std::vector<double> double_data;
+                int field, wire;
+                while (in.next_field(field, wire))
+                {
+                    switch (field)
+                    {
+                        case 1: in.read_int64s(wire, t.dims); break;
+                        case 2: t.data_type = static_cast<int>(in.read_varint()); break;
+                        case 4: in.read_floats(wire, t.float_data); break;
+                        case 5: in.read_int64s(wire, int32_data); break;
+                        case 7: in.read_int64s(wire, t.int64_data); break;
+                        case 8: t.name = in.read_string(); break;
+                        case 9: raw = in.read_string(); has_raw = true; break;
+                        case 10: in.read_doubles(wire, double_data); break;
+                        case 13: external = true; in.skip(wire); break;
+                        case 14: external = external || in.read_varint() == 1; break;
+                        default: in.skip(wire); break;
+                    }
+                }
+
+                if (external)
+                    throw dlib::error("ONNX import doesn't support tensors stored in external data files: " + t.name);
+
+                const size_t count = element_count(t.dims);
+                if (t.data_type == FLOAT || t.data_type == DOUBLE)
+                {
+                    if (has_raw)
+                    {
+                        const size_t width = raw_element_size(t.data_type);
+                        if (raw.size() != count*width)
+                            throw dlib::error("ONNX import found a tensor whose raw_data size doesn't match its shape: " + t.name);
+                        t.float_data.resize(count);
+                        for (size_t i = 0; i < count; ++i)
+                        {
+                            if (t.data_type == FLOAT)
+                                t.float_data[i] = proto_reader::decode_float(&raw[i*width]);
+                            else
+                                t.float_data[i] = static_cast<float>(proto_reader::decode_double(&raw[i*width]));
+                        }
+                    }
+                    else if (t.data_type == DOUBLE)
+                    {
+                        t.float_data.assign(double_data.begin(), double_data.end());
+                    }
+                    if (t.float_data.size() != count)
+                        throw dlib::error("ONNX import found a tensor whose data size doesn't match its shape: " + t.name);
+                }
+                else if (is_integer_data_type(t.data_type))
+                {
+                    if (has_raw)
+                    {
+                        const size_t width = raw_element_size(t.data_type);
+                        if (raw.size() != count*width)
+                            throw dlib::error("ONNX import found a tensor whose raw_data size doesn't match its shape: " + t.name);
+                        t.int64_data.resize(count);
+                        for (size_t i = 0; i < count; ++i)
+                            t.int64_data[i] = decode_raw_integer(&raw[i*width], t.data_type);
+                    }
+                    else if (t.data_type != INT64)
+                    {
+                        t.int64_data = int32_data;
+                    }
+                    if (t.int64_data.size() != count)
+                        throw dlib::error("ONNX import found a tensor whose data size doesn't match its shape: " + t.name);
+                }
+                else
+                {
+                    std::ostringstream sout;
+                    sout << "ONNX import doesn't support tensor data type " << t.data_type << " used by " << t.name << ".";
+                    throw dlib::error(sout.str());
+                }
+                return t;
+            }
+
+            inline parsed_attribute parse_attribute(proto_reader in)
+            {
+                parsed_attribute a;
+                int field, wire;
+                while (in.next_field(field, wire))
+                {
+                    switch (field)
+                    {
+                        case 1: a.name = in.read_string(); break;
+                        case 2: a.f = in.read_fixed32_float(); break;
+                        case 3: a.i = static_cast<int64_t>(in.read_varint()); break;
+                        case 4: a.s = in.read_string(); break;
+                        case 5: a.t = parse_tensor(in.read_message()); break;
+                        case 7: in.read_floats(wire, a.floats); break;
+                        case 8: in.read_int64s(wire, a.ints); break;
+                        case 20: a.type = static_cast<int>(in.read_varint()); break;
+                        default: in.skip(wire); break;
+                    }
+                }
+                return a;
+            }
+
+            inline parsed_value_info parse_value_info(proto_reader in)
+            {
+                parsed_value_info info;
+                int field, wire;
+                while (in.next_field(field, wire))
+                {
+                    if (field == 1)
+                    {
+                        info.name = in.read_string();
+                    }
+                    else if (field == 2)
+                    {
+                        // TypeProto.tensor_type
+                        proto_reader type = in.read_message();
+                        while (type.next_field(field, wire))
+                        {
+                            if (field != 1)
+                            {
+                                type.skip(wire);
+                                continue;
+                            }
+                            proto_reader tensor_type = type.read_message();
+                            while (tensor_type.next_field(field, wire))
+                            {
+                                if (field == 1)
+                                {
+                                    info.elem_type = static_cast<int>(tensor_type.read_varint());
+                                }
+                                else if (field == 2)
+                                {
+                                    proto_reader shape = tensor_type.read_message();
+                                    while (shape.next_field(field, wire))
+                                    {
+                                        if (field != 1)
+                                        {
+                                            shape.skip(wire);
+                                            continue;
+                                        }
+                                        proto_reader dim = shape.read_message();
+                                        int64_t value = -1;
+                                        while (dim.next_field(field, wire))
+                                        {
+                                            if (field == 1)
+                                                value = static_cast<int64_t>(dim.read_varint());
+                                            else
+                                                dim.skip(wire);
+                                        }
+                                        info.dims.push_back(value);
+                                    }
+                                }
+                                else
+                                {
+                                    tensor_type.skip(wire);
+                                }
+                            }
+                        }
+                    }
+                    else
+                    {
+                        in.skip(wire);
+                    }
+                }
+                return info;
+            }
+
+            inline parsed_node parse_node(proto_reader in)
+            {
+                parsed_node n;
+                int field, wire;
+                while (in.next_field(field, wire))
+                {
+                    switch (field)
+                    {
+                        case 1: n.inputs.push_back(in.read_string()); break;
+                        case 2: n.outputs.push_back(in.read_string()); break;
+                        case 3: n.name = in.read_string(); break;
+                        case 4: n.op_type = in.read_string(); break;
+                        case 5: n.attributes.push_back(parse_attribute(in.read_message())); break;
+                        case 7: n.domain = in.read_string(); break;
+                        default: in.skip(wire); break;
+                    }
+                }
+                return n;
+            }
+
+            inline parsed_graph parse_model(const std::string& bytes)
+            {
+                parsed_graph g;
+                bool has_graph = false;
+                proto_reader model(bytes.data(), bytes.data() + bytes.size());
+                int field, wire;
+                while (model.next_field(field, wire))
+                {
+                    if (field == 7)
+                    {
+                        has_graph = true;
+                        proto_reader graph = model.read_message();
+                        while (graph.next_field(field, wire))
+                        {
+                            switch (field)
+                            {
+                                case 1: g.nodes.push_back(parse_node(graph.read_message())); break;
+                                case 5: g.initializers.push_back(parse_tensor(graph.read_message())); break;
+                                case 11: g.inputs.push_back(parse_value_info(graph.read_message())); break;
+                                case 12: g.outputs.push_back(parse_value_info(graph.read_message())); break;
+                                default: graph.skip(wire); break;
+                            }
+                        }
+                    }
+                    else if (field == 8)
+                    {
+                        proto_reader opset = model.read_message();
+                        std::string domain;
+                        int64_t version = 0;
+                        while (opset.next_field(field, wire))
+                        {
+                            if (field == 1)
+                                domain = opset.read_string();
+                            else if (field == 2)
+                                version = static_cast<int64_t>(opset.read_varint());
+                            else
+                                opset.skip(wire);
+                        }
+                        if (domain.empty() || domain == "ai.onnx")
+                            g.opset_version = version;
+                    }
+                    else
+                    {
+                        model.skip(wire);
+                    }
+                }
+                if (!has_graph)
+                    throw dlib::error("ONNX import found a model without a graph.");
+                return g;
+            }
+
+        // ------------------------------------------------------------------------------------
+
+            enum class op_kind
+            {
+                add, sub, mul, div, pow, equal, greater, greater_or_equal, less, less_or_equal,
+                logical_and, logical_or, logical_not, where, prelu,
+                relu, sigmoid, tanh, elu, leaky_relu, softplus, erf, sqrt, exp, log, neg, abs,
+                reciprocal, clip, cast, identity,
+                conv, conv_transpose, gemm, matmul, batch_normalization, layer_normalization,
+                max_pool, average_pool, global_max_pool, global_average_pool, softmax,
+                reshape, flatten, squeeze, unsqueeze, transpose, concat, slice, pad, resize, expand,
+                reduce_mean, reduce_sum, gather, shape, constant, constant_of_shape, trilu
+            };
+
+            inline op_kind parse_op_kind(const parsed_node& n)
+            {
+                static const std::map<std::string, op_kind> kinds = {
+                    {"Add", op_kind::add}, {"Sub", op_kind::sub}, {"Mul", op_kind::mul},
+                    {"Div", op_kind::div}, {"Pow", op_kind::pow}, {"Equal", op_kind::equal},
+                    {"Greater", op_kind::greater}, {"GreaterOrEqual", op_kind::greater_or_equal},
+                    {"Less", op_kind::less}, {"LessOrEqual", op_kind::less_or_equal},
+                    {"And", op_kind::logical_and}, {"Or", op_kind::logical_or}, {"Not", op_kind::logical_not},
+                    {"Where", op_kind::where}, {"PRelu", op_kind::prelu},
+                    {"Relu", op_kind::relu}, {"Sigmoid", op_kind::sigmoid}, {"Tanh", op_kind::tanh},
+                    {"Elu", op_kind::elu}, {"LeakyRelu", op_kind::leaky_relu}, {"Softplus", op_kind::softplus},
+                    {"Erf", op_kind::erf}, {"Sqrt", op_kind::sqrt}, {"Exp", op_kind::exp}, {"Log", op_kind::log},
+                    {"Neg", op_kind::neg}, {"Abs", op_kind::abs}, {"Reciprocal", op_kind::reciprocal},
+                    {"Clip", op_kind::clip}, {"Cast", op_kind::cast}, {"Identity", op_kind::identity},
+                    {"Dropout", op_kind::identity},
+                    {"Conv", op_kind::conv}, {"ConvTranspose", op_kind::conv_transpose},
+                    {"Gemm", op_kind::gemm}, {"MatMul", op_kind::matmul},
+                    {"BatchNormalization", op_kind::batch_normalization},
+                    {"LayerNormalization", op_kind::layer_normalization},
+                    {"MaxPool", op_kind::max_pool}, {"AveragePool", op_kind::average_pool},
+                    {"GlobalMaxPool", op_kind::global_max_pool}, {"GlobalAveragePool", op_kind::global_average_pool},
+                    {"Softmax", op_kind::softmax}, {"Reshape", op_kind::reshape}, {"Flatten", op_kind::flatten},
+                    {"Squeeze", op_kind::squeeze}, {"Unsqueeze", op_kind::unsqueeze},
+                    {"Transpose", op_kind::transpose}, {"Concat", op_kind::concat}, {"Slice", op_kind::slice},
+                    {"Pad", op_kind::pad}, {"Resize", op_kind::resize}, {"Expand", op_kind::expand},
+                    {"ReduceMean", op_kind::reduce_mean}, {"ReduceSum", op_kind::reduce_sum},
+                    {"Gather", op_kind::gather}, {"Shape", op_kind::shape}, {"Constant", op_kind::constant},
+                    {"ConstantOfShape", op_kind::constant_of_shape}, {"Trilu", op_kind::trilu}
+                };
+                const auto found = kinds.find(n.op_type);
+                if ((!n.domain.empty() && n.domain != "ai.onnx") || found == kinds.end())
+                {
+                    std::string op = n.domain.empty() ? n.op_type : n.domain + "::" + n.op_type;
+                    throw dlib::error("ONNX import doesn't support the operator: " + op);
+                }
+                return found->second;
+            }
+
+        // ------------------------------------------------------------------------------------
+
+            inline size_t shape_size(const std::vector<int64_t>& shape)
+            {
+                return element_count(shape);
+            }
+
+            inline std::vector<int64_t> shape_to_4d(const std::vector<int64_t>& shape)
+            {
+                // Maps an ONNX shape onto dlib's [N,K,NR,NC] layout without
+                // changing the row-major order of the elements.  Trailing
+                // dimensions beyond the fourth are folded into NC.
+                std::vector<int64_t> dims(4, 1);
+                for (size_t i = 0; i < shape.size(); ++i)
+                    dims[std::min<size_t>(i, 3)] *= shape[i];
+                return dims;
+            }
+
+            inline int64_t normalize_axis(int64_t axis, size_t rank, const std::string& op_type)
+            {
+                const int64_t r = static_cast<int64_t>(rank);
+                if (axis < -r || axis >= r)
+                    throw dlib::error("ONNX import found an out of range axis in a " + op_type + " node.");
+                return axis < 0 ? axis + r : axis;
+            }
+
+            inline std::vector<int64_t> broadcast_shape(
+                const std::vector<std::vector<int64_t>>& shapes,
+                const std::string& op_type
+            )
+            {
+                size_t rank = 0;
+                for (const auto& s : shapes)
+                    rank = std::max(rank, s.size());
+                std::vector<int64_t> out(rank, 1);
+                for (const auto& s : shapes)
+                {
+                    for (size_t i = 0; i < s.size(); ++i)
+                    {
+                        int64_t& d = out[rank - s.size() + i];
+                        if (d == 1)
+                            d = s[i];
+                        else if (s[i] != 1 && s[i] != d)
+                            throw dlib::error("ONNX import found incompatible broadcast shapes in a " + op_type + " node.");
+                    }
+                }
+                return out;
+            }
+
+            template <typename F>
+            void for_each_broadcast_index(
+                const std::vector<int64_t>& out_shape,
+                const std::vector<std::vector<int64_t>>& in_shapes,
+                F f
+            )
+            {
+                /*!
+                    requires
+                        - in_shapes.size() <= 3
+                        - every shape in in_shapes broadcasts to out_shape
+                    ensures
+                        - calls f(i, idx) for every element i of out_shape, where
+                          idx[j] is the index of the element of the j-th input that
+                          ONNX broadcasting pairs with output element i.
+                !*/
+                const size_t count = shape_size(out_shape);
+                const size_t num_inputs = in_shapes.size();
+                size_t idx[3] = {0, 0, 0};
+
+                // Most elementwise nodes combine equal shapes or a tensor with a
+                // scalar, so take a flat loop whenever no real broadcasting is needed.
+                bool flat = true;
+                size_t step[3] = {0, 0, 0};
+                for (size_t j = 0; j < num_inputs; ++j)
+                {
+                    const size_t size = shape_size(in_shapes[j]);
+                    if (size == count)
+                        step[j] = 1;
+                    else if (size != 1)
+                        flat = false;
+                }
+                if (flat)
+                {
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        for (size_t j = 0; j < num_inputs; ++j)
+                            idx[j] = i*step[j];
+                        f(i, idx);
+                    }
+                    return;
+                }
+
+                const size_t rank = out_shape.size();
+                std::vector<size_t> strides(num_inputs*rank, 0);
+                for (size_t j = 0; j < num_inputs; ++j)
+                {
+                    const auto& s = in_shapes[j];
+                    size_t stride = 1;
+                    for (size_t d = s.size(); d-- > 0;)
+                    {
+                        const size_t od = rank - s.size() + d;
+                        if (s[d] != 1)
+                            strides[j*rank + od] = stride;
+                        stride *= static_cast<size_t>(s[d]);
+                    }
+                }
+
+                std::vector<int64_t> counter(rank, 0);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    f(i, idx);
+                    for (size_t d = rank; d-- > 0;)
+                    {
+                        if (++counter[d] < out_shape[d])
+                        {
+                            for (size_t j = 0; j < num_inputs; ++j)
+                                idx[j] += strides[j*rank + d];
+                            break;
+                        }
+                        for (size_t j = 0; j < num_inputs; ++j)
+                            idx[j] -= strides[j*rank + d]*static_cast<size_t>(out_shape[d] - 1);
+                        counter[d] = 0;
+                    }
+                }
+            }
+
+            template <typename T>
+            void strided_copy(
+                const T* src,
+                T* dest,
+                const std::vector<int64_t>& out_shape,
+                const std::vector<int64_t>& src_strides,
+                int64_t src_offset
+            )
+            {
+                /*!
+                    ensures
+                        - for every element of out_shape, in row-major order, copies
+                          src[src_offset + dot(position, src_strides)] into dest.
+                !*/
+                const size_t count = shape_size(out_shape);
+                const size_t rank = out_shape.size();
+                std::vector<int64_t> counter(rank, 0);
+                int64_t s = src_offset;
+                for (size_t i = 0; i < count; ++i)
+                {
+                    dest[i] = src[s];
+                    for (size_t d = rank; d-- > 0;)
+                    {
+                        if (++counter[d] < out_shape[d])
+                        {
+                            s += src_strides[d];
+                            break;
+                        }
+                        s -= src_strides[d]*(out_shape[d] - 1);
+                        counter[d] = 0;
+                    }
+                }
+            }
+
+            inline std::vector<int64_t> contiguous_strides(const std::vector<int64_t>& shape)
+            {
+                std::vector<int64_t> strides(shape.size(), 1);
+                for (size_t d = shape.size(); d-- > 1;)
+                    strides[d-1] = strides[d]*shape[d];
+                return strides;
+            }
+
+            inline float resize_source_coordinate(
+                int64_t x,
+                int64_t in_len,
+                int64_t out_len,
+                float scale,
+                const std::string& mode
+            )
+            {
+                if (mode == "align_corners")
+                    return out_len == 1 ? 0.f : x*static_cast<float>(in_len - 1)/(out_len - 1);
+                if (mode == "asymmetric")
+                    return x/scale;
+                if (mode == "tf_half_pixel_for_nn")
+                    return (x + 0.5f)/scale;
+                if (mode == "pytorch_half_pixel")
+                    return out_len > 1 ? (x + 0.5f)/scale - 0.5f : 0.f;
+                if (mode == "half_pixel")
+                    return (x + 0.5f)/scale - 0.5f;
+                throw dlib::error("ONNX import doesn't support Resize coordinate_transformation_mode " + mode + ".");
+            }
+
+            inline int64_t resize_nearest_index(float x, int64_t in_len, const std::string& mode)
+            {
+                float r;
+                if (mode == "floor")
+                    r = std::floor(x);
+                else if (mode == "ceil")
+                    r = std::ceil(x);
+                else if (mode == "round_prefer_ceil")
+                    r = std::floor(x + 0.5f);
+                else if (mode == "round_prefer_floor")
+                    r = std::ceil(x - 0.5f);
+                else
+                    throw dlib::error("ONNX import doesn't support Resize nearest_mode " + mode + ".");
+                return std::min<int64_t>(std::max<int64_t>(static_cast<int64_t>(r), 0), in_len - 1);
+            }
+
+        // ------------------------------------------------------------------------------------
+
+            struct runtime_value
+            {
+                std::string name;
+                int type = FLOAT;               // FLOAT, INT64 or BOOL
+                std::vector<int64_t> shape;
+                bool known = false;
+                bool is_initializer = false;
+                bool is_constant = false;       // an initializer or folded during planning
+                bool is_graph_input = false;
+                bool is_graph_output = false;
+                bool owned_output = false;      // produced by a kernel that needs a resizable_tensor
+
+                // FLOAT and BOOL values live either in the planned arena or, for
+                // constants, graph outputs, and owned_output values, in data.
+                // INT64 values are always kept in ints.
+                resizable_tensor data;
+                std::vector<int64_t> ints;
+                long alias_of = -1;             // shares the storage of this value
+                bool in_arena = false;
+                size_t offset = 0;
+                long first_use = 0;
+                long last_use = -1;
+            };
+
+            struct runtime_node
+            {
+                op_kind op;
+                std::string op_type;
+                std::string name;
+                std::vector<long> inputs;       // -1 marks an omitted optional input
+                std::vector<long> outputs;
+                std::map<std::string, parsed_attribute> attributes;
+
+                bool folded = false;            // evaluated once while planning
+                bool aliased = false;           // output shares the input's storage
+                bool fused_relu = false;        // a following Relu was merged into this Conv
+
+                // Kernel state prepared while planning.
+                std::unique_ptr<tt::tensor_conv> conv;
+                std::unique_ptr<tt::pooling> pool;
+                resizable_tensor param1, param2;
+                resizable_tensor scratch1, scratch2;
+                std::vector<int64_t> config;
+
+                bool has_attribute(const std::string& key) const
+                {
+                    return attributes.count(key) != 0;
+                }
+
+                int64_t get_int(const std::string& key, int64_t default_value) const
+                {
+                    const auto found = attributes.find(key);
+                    return found == attributes.end() ? default_value : found->second.i;
+                }
+
+                float get_float(const std::string& key, float default_value) const
+                {
+                    const auto found = attributes.find(key);
+                    return found == attributes.end() ? default_value : found->second.f;
+                }
+
+                std::string get_string(const std::string& key, const std::string& default_value) const
+                {
+                    const auto found = attributes.find(key);
+                    return found == attributes.end() ? default_value : found->second.s;
+                }
+
+                std::vector<int64_t> get_ints(const std::string& key, const std::vector<int64_t>& default_value) const
+                {
+                    const auto found = attributes.find(key);
+                    return found == attributes.end() ? default_value : found->second.ints;
+                }
+
+                bool has_input(size_t i) const
+                {
+                    return i < inputs.size() && inputs[i] >= 0;
+                }
+
+                [[noreturn]] void fail(const std::string& message) const
+                {
+                    std::string where = op_type;
+                    if (!name.empty())
+                        where += " node " + name;
+                    else
+                        where += " node";
+                    throw dlib::error("ONNX import: " + where + ": " + message);
+                }
+            };
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    class onnx_model
+    {
+    public:
+
+        onnx_model() = default;
+
+        explicit onnx_model(
+            const std::string& filename
+        )
+        {
+            load(filename);
+        }
+
+        explicit onnx_model(
+            std::istream& in
+        )
+        {
+            load(in);
+        }
+
+        onnx_model(const onnx_model&) = delete;
+        onnx_model& operator=(const onnx_model&) = delete;
+        onnx_model(onnx_model&&) = default;
+        onnx_model& operator=(onnx_model&&) = default;
+
+        void load(
+            const std::string& filename
+        )
+        {
+            std::ifstream fin(filename, std::ios::binary);
+            if (!fin)
+                throw dlib::error("Unable to open ONNX model file: " + filename);
+            load(fin);
+        }
+
+        void load(
+            std::istream& in
+        )
+        {
+            const std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            if (in.bad())
+                throw dlib::error("Error while reading ONNX model.");
+            build(impl::onnx::parse_model(bytes));
+        }
+
+        size_t num_inputs(
+        ) const { return graph_inputs.size(); }
+
+        const std::string& get_input_name(
+            size_t i
+        ) const { return values[graph_inputs.at(i)].name; }
+
+        const std::vector<int64_t>& get_input_shape(
+            size_t i
+        ) const { return declared_input_shapes.at(i); }
+
+        size_t num_outputs(
+        ) const { return graph_outputs.size(); }
+
+        const std::string& get_output_name(
+            size_t i
+        ) const { return values[graph_outputs.at(i)].name; }
+
+        const std::vector<int64_t>& get_output_shape(
+            size_t i = 0
+        ) const
+        {
+            DLIB_CASSERT(i < num_outputs());
+            DLIB_CASSERT(planned, "forward() must be called before the output shapes are known.");
+            return values[graph_outputs[i]].shape;
+        }
+
+        const tensor& get_output(
+            size_t i = 0
+        ) const
+        {
+            DLIB_CASSERT(i < num_outputs());
+            return values[graph_outputs[i]].data;
+        }
+
+        size_t num_nodes(
+        ) const { return nodes.size(); }
+
+        size_t get_arena_size(
+        ) const { return arena.size(); }
+
+        size_t get_unplanned_activation_size(
+        ) const { return unplanned_size; }
+
+        const tensor& forward(
+            const tensor& input
+        )
+        {
+            DLIB_CASSERT(num_inputs() == 1, "This ONNX model has " << num_inputs() << " inputs.");
+            std::vector<const tensor*> inputs(1, &input);
+            forward(inputs);
+            return get_output(0);
+        }
+
+        void forward(
+            const std::vector<const tensor*>& inputs
+        )
+        {
+            if (inputs.size() != num_inputs())
+            {
+                std::ostringstream sout;
+                sout << "ONNX model forward() expected " << num_inputs() << " inputs but got " << inputs.size() << ".";
+                throw dlib::error(sout.str());
+            }
+
+            std::vector<std::vector<int64_t>> shapes(inputs.size());
+            for (size_t i = 0; i < inputs.size(); ++i)
+                shapes[i] = input_shape_for(i, *inputs[i]);
+            if (!planned || shapes != planned_input_shapes)
+                plan(shapes);
+
+            for (size_t i = 0; i < inputs.size(); ++i)
+            {
+                auto& v = values[graph_inputs[i]];
+                std::memcpy(host(v), inputs[i]->host(), inputs[i]->size()*sizeof(float));
+            }
+
+            for (auto& n : nodes)
+            {
+                if (!n.folded && !n.aliased)
+                    execute(n);
+            }
+
+            for (auto id : graph_outputs)
+            {
+                auto& v = values[id];
+                const auto dims = impl::onnx::shape_to_4d(v.shape);
+                if (v.type == impl::onnx::INT64)
+                {
+                    v.data.set_size(dims[0], dims[1], dims[2], dims[3]);
+                    float* d = v.data.host();
+                    for (size_t j = 0; j < v.ints.size(); ++j)
+                        d[j] = static_cast<float>(v.ints[j]);
+                }
+                else
+                {
+                    v.data.set_size(dims[0], dims[1], dims[2], dims[3]);
+                }
+            }
+        }
+
+    private:
+
+        typedef impl::onnx::runtime_value runtime_value;
+        typedef impl::onnx::runtime_node runtime_node;
+        typedef impl::onnx::op_kind op_kind;
+
+    // ------------------------------------------------------------------------------------
+    //                                  graph construction
+    // ------------------------------------------------------------------------------------
+
+        long value_id(
+            std::map<std::string, long>& ids,
+            const std::string& name
+        )
+        {
+            const auto found = ids.find(name);
+            if (found != ids.end())
+                return found->second;
+            runtime_value v;
+            v.name = name;
+            values.push_back(std::move(v));
+            ids[name] = static_cast<long>(values.size() - 1);
+            return static_cast<long>(values.size() - 1);
+        }
+
+        void build(
+            const impl::onnx::parsed_graph& g
+        )
+        {
+            using namespace impl::onnx;
+
+            values.clear();
+            nodes.clear();
+            graph_inputs.clear();
+            graph_outputs.clear();
+            declared_input_shapes.clear();
+            planned = false;
+            arena.clear();
+
+            if (g.opset_version != 0 && g.opset_version < 13)
+            {
+                std::ostringstream sout;
+                sout << "ONNX import requires opset 13 or newer but the model uses opset " << g.opset_version << ".";
+                throw dlib::error(sout.str());
+            }
+
+            std::map<std::string, long> ids;
+            for (const auto& t : g.initializers)
+            {
+                auto& v = values[value_id(ids, t.name)];
+                set_constant(v, t);
+                v.is_initializer = true;
+            }
+
+            for (const auto& input : g.inputs)
+            {
+                const long id = value_id(ids, input.name);
+                if (values[id].is_initializer)
+                    continue;
+                if (input.elem_type != FLOAT)
+                    throw dlib::error("ONNX import supports only float graph inputs but " + input.name + " isn't a float tensor.");
+                if (input.dims.empty())
+                    throw dlib::error("ONNX import requires graph input " + input.name + " to have a known rank.");
+                values[id].is_graph_input = true;
+                graph_inputs.push_back(id);
+                declared_input_shapes.push_back(input.dims);
+            }
+            if (graph_inputs.empty())
+                throw dlib::error("ONNX import found a model without graph inputs.");
+
+            std::vector<runtime_node> unsorted;
+            for (const auto& pn : g.nodes)
+            {
+                runtime_node n;
+                n.op = parse_op_kind(pn);
+                n.op_type = pn.op_type;
+                n.name = pn.name;
+                for (const auto& name : pn.inputs)
+                    n.inputs.push_back(name.empty() ? -1 : value_id(ids, name));
+                for (const auto& name : pn.outputs)
+                    n.outputs.push_back(name.empty() ? -1 : value_id(ids, name));
+                for (const auto& a : pn.attributes)
+                    n.attributes[a.name] = a;
+                unsorted.push_back(std::move(n));
+            }
+
+            for (const auto& output : g.outputs)
+            {
+                const long id = value_id(ids, output.name);
+                values[id].is_graph_output = true;
+                graph_outputs.push_back(id);
+            }
+            if (graph_outputs.empty())
+                throw dlib::error("ONNX import found a model without graph outputs.");
+
+            sort_nodes(unsorted);
+            fuse_conv_relu();
+        }
+
+        void set_constant(
+            runtime_value& v,
+            const impl::onnx::parsed_tensor& t
+        )
+        {
+            using namespace impl::onnx;
+            v.shape = t.dims;
+            v.known = true;
+            v.is_constant = true;
+            if (t.data_type == FLOAT || t.data_type == DOUBLE || t.data_type == BOOL)
+            {
+                v.type = t.data_type == BOOL ? BOOL : FLOAT;
+                const auto dims = shape_to_4d(v.shape);
+                v.data.set_size(dims[0], dims[1], dims[2], dims[3]);
+                float* d = v.data.host();
+                if (t.data_type == BOOL)
+                {
+                    for (size_t i = 0; i < t.int64_data.size(); ++i)
+                        d[i] = t.int64_data[i] != 0 ? 1 : 0;
+                }
+                else
+                {
+                    std::copy(t.float_data.begin(), t.float_data.end(), d);
+                }
+            }
+            else
+            {
+                v.type = INT64;
+                v.ints = t.int64_data;
+            }
+        }
+
+        void sort_nodes(
+            std::vector<runtime_node>& unsorted
+        )
+        {
+            // ONNX requires nodes to be stored in topological order, but sorting
+            // here costs a single pass for well formed files and lets us report
+            // dangling inputs with a useful message.
+            std::vector<bool> available(values.size(), false);
+            for (size_t i = 0; i < values.size(); ++i)
+                available[i] = values[i].is_initializer || values[i].is_graph_input;
+
+            std::vector<bool> done(unsorted.size(), false);
+            bool progress = true;
+            while (nodes.size() < unsorted.size() && progress)
+            {
+                progress = false;
+                for (size_t i = 0; i < unsorted.size(); ++i)
+                {
+                    if (done[i])
+                        continue;
+                    bool ready = true;
+                    for (auto id : unsorted[i].inputs)
+                        ready = ready && (id < 0 || available[id]);
+                    if (!ready)
+                        continue;
+                    for (auto id : unsorted[i].outputs)
+                    {
+                        if (id >= 0)
+                            available[id] = true;
+                    }
+                    done[i] = true;
+                    progress = true;
+                    nodes.push_back(std::move(unsorted[i]));
+                }
+            }
+
+            for (size_t i = 0; i < unsorted.size(); ++i)
+            {
+                if (!done[i])
+                    unsorted[i].fail("some of its inputs are never produced by the graph.");
+            }
+            for (auto id : graph_outputs)
+            {
+                if (!available[id])
+                    throw dlib::error("ONNX import found a graph output that is never produced: " + values[id].name);
+            }
+        }
+
+        void fuse_conv_relu(
+        )
+        {
+            std::vector<long> uses(values.size(), 0);
+            for (const auto& n : nodes)
+            {
+                for (auto id : n.inputs)
+                {
+                    if (id >= 0)
+                        ++uses[id];
+                }
+            }
+
+            std::vector<runtime_node> fused;
+            for (size_t i = 0; i < nodes.size(); ++i)
+            {
+                auto& n = nodes[i];
+                if (n.op == op_kind::relu && !fused.empty())
+                {
+                    auto& prev = fused.back();
+                    const long conv_out = prev.outputs.empty() ? -1 : prev.outputs[0];
+                    if (prev.op == op_kind::conv && !prev.fused_relu && conv_out >= 0 &&
+                        n.inputs.size() == 1 && n.inputs[0] == conv_out &&
+                        uses[conv_out] == 1 && !values[conv_out].is_graph_output)
+                    {
+                        prev.outputs[0] = n.outputs[0];
+                        prev.fused_relu = true;
+                        continue;
+                    }
+                }
+                fused.push_back(std::move(n));
+            }
+            nodes.swap(fused);
+        }
+
+        std::vector<int64_t> input_shape_for(
+            size_t i,
+            const tensor& t
+        ) const
+        {
+            // The dlib tensor's [N,K,NR,NC] dimensions are matched against the
+            // declared rank, with trailing dlib dimensions folded into the last
+            // ONNX dimension.
+            const auto& declared = declared_input_shapes[i];
+            const int64_t dims[4] = {t.num_samples(), t.k(), t.nr(), t.nc()};
+            std::vector<int64_t> shape(declared.size(), 1);
+            for (size_t d = 0; d < 4; ++d)
+                shape[std::min(d, declared.size() - 1)] *= dims[d];
+            for (size_t d = 0; d < declared.size(); ++d)
+            {
+                if (declared[d] >= 0 && declared[d] != shape[d])
+                {
+                    std::ostringstream sout;
+                    sout << "ONNX model input " << values[graph_inputs[i]].name << " expects shape "
+                         << impl::onnx::tensor_shape_to_string(declared) << " but was given a tensor with shape "
+                         << impl::onnx::tensor_shape_to_string(shape) << ".";
+                    throw dlib::error(sout.str());
+                }
+            }
+            return shape;
+        }
+
+    // ------------------------------------------------------------------------------------
+    //                                      planning
+    // ------------------------------------------------------------------------------------
+
+        runtime_value& in(const runtime_node& n, size_t i) { return values[n.inputs[i]]; }
+        runtime_value& out(const runtime_node& n, size_t i = 0) { return values[n.outputs[i]]; }
+
+        runtime_value& storage(runtime_value& v)
+        {
+            return v.alias_of >= 0 ? values[v.alias_of] : v;
+        }
+
+        float* host(runtime_value& v)
+        {
+            runtime_value& s = storage(v);
+            return s.in_arena ? arena.host() + s.offset : s.data.host();
+        }
+
+        alias_tensor_instance view(
+            runtime_value& v,
+            const std::vector<int64_t>& dims,
+            size_t extra_offset = 0
+        )
+        {
+            alias_tensor a(dims[0], dims[1], dims[2], dims[3]);
+            runtime_value& s = storage(v);
+            if (s.in_arena)
+                return a(arena, s.offset + extra_offset);
+            return a(s.data, extra_offset);
+        }
+
+        alias_tensor_instance view(runtime_value& v)
+        {
+            return view(v, impl::onnx::shape_to_4d(v.shape));
+        }
+
+        const std::vector<int64_t>& constant_ints(
+            const runtime_node& n,
+            size_t i
+        )
+        {
+            auto& v = in(n, i);
+            if (!v.is_constant || v.type != impl::onnx::INT64)
+                n.fail("input " + v.name + " must be a constant int64 tensor.");
+            return v.ints;
+        }
+
+        float constant_scalar(
+            const runtime_node& n,
+            size_t i
+        )
+        {
+            auto& v = in(n, i);
+            if (!v.is_constant || v.type == impl::onnx::INT64 || impl::onnx::shape_size(v.shape) != 1)
+                n.fail("input " + v.name + " must be a constant float scalar.");
+            return v.data.host()[0];
+        }
+
+        void set_output(
+            runtime_node& n,
+            size_t i,
+            int type,
+            const std::vector<int64_t>& shape
+        )
+        {
+            if (i >= n.outputs.size() || n.outputs[i] < 0)
+                return;
+            auto& v = out(n, i);
+            v.type = type;
+            v.shape = shape;
+            v.known = true;
+        }
+
+        void allocate_owned(
+            runtime_value& v
+        )
+        {
+            if (v.type == impl::onnx::INT64)
+            {
+                v.ints.resize(impl::onnx::shape_size(v.shape));
+            }
+            else
+            {
+                const auto dims = impl::onnx::shape_to_4d(v.shape);
+                v.data.set_size(dims[0], dims[1], dims[2], dims[3]);
+            }
+        }
+
+        void plan(
+            const std::vector<std::vector<int64_t>>& input_shapes
+        )
+        {
+            using namespace impl::onnx;
+            planned = false;
+
+            for (auto& v : values)
+            {
+                v.alias_of = -1;
+                v.in_arena = false;
+                v.owned_output = false;
+                v.first_use = 0;
+                v.last_use = -1;
+                if (!v.is_initializer)
+                {
+                    v.known = false;
+                    v.is_constant = false;
+                }
+            }
+            for (size_t i = 0; i < graph_inputs.size(); ++i)
+            {
+                auto& v = values[graph_inputs[i]];
+                v.type = FLOAT;
+                v.shape = input_shapes[i];
+                v.known = true;
+            }
+
+            // Shape inference.  Nodes whose inputs are all constants are
+            // evaluated right away so that shape computations (Shape,
+            // ConstantOfShape, Concat of int64 shapes, ...) become constants
+            // for the nodes that consume them.
+            for (auto& n : nodes)
+            {
+                n.folded = false;
+                n.aliased = false;
+                for (auto id : n.inputs)
+                {
+                    if (id >= 0 && !values[id].known)
+                        n.fail("input " + values[id].name + " has an unknown shape.");
+                }
+                infer(n);
+
+                bool constant_inputs = true;
+                for (auto id : n.inputs)
+                    constant_inputs = constant_inputs && (id < 0 || values[id].is_constant);
+                if (constant_inputs || n.op == op_kind::shape)
+                {
+                    for (auto id : n.outputs)
+                    {
+                        if (id < 0)
+                            continue;
+                        values[id].is_constant = true;
+                        allocate_owned(values[id]);
+                    }
+                    execute(n);
+                    n.folded = true;
+                }
+            }
+
+            // Reshape-like nodes reuse their input's storage instead of copying,
+            // unless the output must outlive the arena as a graph output.
+            for (auto& n : nodes)
+            {
+                if (n.folded)
+                    continue;
+                const bool reshape_like = n.op == op_kind::reshape || n.op == op_kind::flatten ||
+                                          n.op == op_kind::squeeze || n.op == op_kind::unsqueeze ||
+                                          n.op == op_kind::identity;
+                auto& o = out(n);
+                if (reshape_like && in(n, 0).type != INT64 && !o.is_graph_output)
+                {
+                    o.alias_of = in(n, 0).alias_of >= 0 ? in(n, 0).alias_of : n.inputs[0];
+                    n.aliased = true;
+                }
+            }
+
+            // Liveness of every storage root, measured in node positions.
+            // Graph inputs are written before the first node runs.
+            for (auto id : graph_inputs)
+                values[id].first_use = -1;
+            for (size_t p = 0; p < nodes.size(); ++p)
+            {
+                const auto& n = nodes[p];
+                if (n.folded)
+                    continue;
+                for (auto id : n.inputs)
+                {
+                    if (id < 0)
+                        continue;
+                    auto& s = storage(values[id]);
+                    s.last_use = std::max<long>(s.last_use, static_cast<long>(p));
+                }
+                for (auto id : n.outputs)
+                {
+                    if (id < 0 || values[id].alias_of >= 0)
+                        continue;
+                    values[id].first_use = static_cast<long>(p);
+                    values[id].last_use = std::max<long>(values[id].last_use, static_cast<long>(p));
+                }
+            }
+
+            struct block
+            {
+                long id;
+                size_t offset;
+                size_t size;
+            };
+            std::vector<block> candidates;
+            unplanned_size = 0;
+            for (size_t i = 0; i < values.size(); ++i)
+            {
+                auto& v = values[i];
+                if (!v.known || v.is_constant)
+                    continue;
+                if (v.alias_of >= 0)
+                    continue;
+                if (v.type == INT64 || v.is_graph_output || v.owned_output)
+                {
+                    allocate_owned(v);
+                    continue;
+                }
+                // Round every block up to 16 floats so each one starts on a 64
+                // byte boundary, which keeps the SIMD kernels on aligned loads.
+                const size_t size = (shape_size(v.shape) + 15)/16*16;
+                unplanned_size += size;
+                candidates.push_back(block{static_cast<long>(i), 0, size});
+            }
+
+            // Greedy best-fit by decreasing size: each block is placed at the
+            // lowest offset that doesn't overlap a block whose lifetime
+            // intersects its own.
+            std::sort(candidates.begin(), candidates.end(), [](const block& a, const block& b) {
+                return a.size > b.size || (a.size == b.size && a.id < b.id);
+            });
+            std::vector<block> placed;
+            size_t arena_size = 0;
+            for (auto& c : candidates)
+            {
+                const auto& cv = values[c.id];
+                size_t offset = 0;
+                for (const auto& b : placed)
+                {
+                    const auto& bv = values[b.id];
+                    if (bv.last_use < cv.first_use || cv.last_use < bv.first_use)
+                        continue;
+                    if (offset + c.size <= b.offset)
+                        break;
+                    offset = std::max(offset, b.offset + b.size);
+                }
+                c.offset = offset;
+                values[c.id].in_arena = true;
+                values[c.id].offset = offset;
+                arena_size = std::max(arena_size, offset + c.size);
+                placed.insert(std::upper_bound(placed.begin(), placed.end(), c,
+                    [](const block& a, const block& b) { return a.offset < b.offset; }), c);
+            }
+            arena.set_size(arena_size);
+
+            planned_input_shapes = input_shapes;
+            planned = true;
+        }
+
+    // ------------------------------------------------------------------------------------
+    //                                   shape inference
+    // ------------------------------------------------------------------------------------
+
+        static std::vector<int64_t> pool_output_shape(
+            const runtime_node& n,
+            const std::vector<int64_t>& x,
+            int64_t kh,
+            int64_t kw,
+            int64_t sy,
+            int64_t sx,
+            int64_t py,
+            int64_t px
+        )
+        {
+            const int64_t oh = (x[2] + 2*py - kh)/sy + 1;
+            const int64_t ow = (x[3] + 2*px - kw)/sx + 1;
+            if (oh <= 0 || ow <= 0)
+                n.fail("the window doesn't fit in the padded input.");
+            return {x[0], x[1], oh, ow};
+        }
+
+        void read_window_attributes(
+            runtime_node& n,
+            const std::vector<int64_t>& kernel
+        )
+        {
+            // Stores [kh, kw, sy, sx, py, px] in n.config after checking that
+            // the node only uses settings dlib's kernels implement.
+            const auto strides = n.get_ints("strides", {1, 1});
+            auto pads = n.get_ints("pads", {0, 0, 0, 0});
+            const auto dilations = n.get_ints("dilations", {1, 1});
+            const std::string auto_pad = n.get_string("auto_pad", "NOTSET");
+            if (kernel.size() != 2 || strides.size() != 2 || pads.size() != 4)
+                n.fail("only 2D windows are supported.");
+            if (dilations != std::vector<int64_t>({1, 1}))
+                n.fail("dilations other than 1 are not supported.");
+            if (auto_pad == "VALID")
+                pads.assign(4, 0);
+            else if (auto_pad != "NOTSET")
+                n.fail("auto_pad " + auto_pad + " is not supported.");
+            if (pads[0] != pads[2] || pads[1] != pads[3])
+                n.fail("asymmetric padding is not supported.");
+            if (strides[0] <= 0 || strides[1] <= 0 || pads[0] < 0 || pads[1] < 0)
+                n.fail("strides must be positive and pads non-negative.");
+            if (pads[0] >= kernel[0] || pads[1] >= kernel[1])
+                n.fail("padding must be smaller than the window.");
+            n.config = {kernel[0], kernel[1], strides[0], strides[1], pads[0], pads[1]};
+        }
+
+        void infer(
+            runtime_node& n
+        )
+        {
+            using namespace impl::onnx;
+            auto input_shape = [&](size_t i) -> const std::vector<int64_t>& { return in(n, i).shape; };
+            if (n.inputs.empty() && n.op != op_kind::constant)
+                n.fail("the node has no inputs.");
+            if (n.outputs.empty() || n.outputs[0] < 0)
+                n.fail("the node has no outputs.");
+            for (size_t i = 1; i < n.outputs.size(); ++i)
+            {
+                if (n.outputs[i] >= 0 && !(n.op == op_kind::identity && n.op_type == "Dropout"))
+                    n.fail("optional secondary outputs are not supported.");
+            }
+            auto require_inputs = [&](size_t count) {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    if (!n.has_input(i))
+                        n.fail("the node is missing required inputs.");
+                }
+            };
+            require_inputs(n.op == op_kind::constant ? 0 : 1);
+
+            switch (n.op)
+            {
+                case op_kind::add: case op_kind::sub: case op_kind::mul: case op_kind::div:
+                case op_kind::pow: case op_kind::prelu:
+                {
+                    require_inputs(2);
+                    if ((in(n, 0).type == INT64) != (in(n, 1).type == INT64) && n.op != op_kind::pow)
+                        n.fail("mixed int64 and float inputs are not supported.");
+                    set_output(n, 0, in(n, 0).type == INT64 ? INT64 : FLOAT,
+                               broadcast_shape({input_shape(0), input_shape(1)}, n.op_type));
+                    break;
+                }
+                case op_kind::equal: case op_kind::greater: case op_kind::greater_or_equal:
+                case op_kind::less: case op_kind::less_or_equal:
+                case op_kind::logical_and: case op_kind::logical_or:
+                {
+                    require_inputs(2);
+                    if ((in(n, 0).type == INT64) != (in(n, 1).type == INT64))
+                        n.fail("mixed int64 and float inputs are not supported.");
+                    set_output(n, 0, BOOL, broadcast_shape({input_shape(0), input_shape(1)}, n.op_type));
+                    break;
+                }
+                case op_kind::where:
+                {
+                    require_inputs(3);
+                    if (in(n, 0).type != BOOL)
+                        n.fail("the condition must be a bool tensor.");
+                    if ((in(n, 1).type == INT64) != (in(n, 2).type == INT64))
+                        n.fail("mixed int64 and float inputs are not supported.");
+                    set_output(n, 0, in(n, 1).type,
+                               broadcast_shape({input_shape(0), input_shape(1), input_shape(2)}, n.op_type));
+                    break;
+                }
+                case op_kind::logical_not:
+                    set_output(n, 0, BOOL, input_shape(0));
+                    break;
+
+                case op_kind::relu: case op_kind::sigmoid: case op_kind::tanh: case op_kind::elu:
+                case op_kind::leaky_relu: case op_kind::softplus: case op_kind::erf: case op_kind::sqrt:
+                case op_kind::exp: case op_kind::log: case op_kind::neg: case op_kind::abs:
+                case op_kind::reciprocal: case op_kind::softmax:
+                {
+                    if (in(n, 0).type != FLOAT && !(in(n, 0).type == INT64 && (n.op == op_kind::neg || n.op == op_kind::abs)))
+                        n.fail("the input must be a float tensor.");
+                    if (n.op == op_kind::softmax)
+                        normalize_axis(n.get_int("axis", -1), input_shape(0).size(), n.op_type);
+                    set_output(n, 0, in(n, 0).type, input_shape(0));
+                    break;
+                }
+                case op_kind::clip:
+                {
+                    for (size_t i = 1; i < 3; ++i)
+                    {
+                        if (n.has_input(i) && (!in(n, i).is_constant || shape_size(in(n, i).shape) != 1))
+                            n.fail("min and max must be constant scalars.");
+                    }
+                    set_output(n, 0, in(n, 0).type, input_shape(0));
+                    break;
+                }
+                case op_kind::cast:
+                {
+                    const int64_t to = n.get_int("to", FLOAT);
+                    int type;
+                    if (to == FLOAT || to == DOUBLE)
+                        type = FLOAT;
+                    else if (to == BOOL)
+                        type = BOOL;
+                    else if (is_integer_data_type(static_cast<int>(to)))
+                        type = INT64;
+                    else
+                        n.fail("unsupported target data type.");
+                    set_output(n, 0, type, input_shape(0));
+                    break;
+                }
+                case op_kind::identity:
+                    set_output(n, 0, in(n, 0).type, input_shape(0));
+                    break;
+
+                case op_kind::conv:
+                {
+                    require_inputs(2);
+                    const auto& x = input_shape(0);
+                    const auto& w = input_shape(1);
+                    if (x.size() != 4 || w.size() != 4)
+                        n.fail("only 2D convolutions over [N,C,H,W] inputs are supported.");
+                    if (n.get_int("group", 1) != 1)
+                        n.fail("grouped convolutions are not supported.");
+                    if (!in(n, 1).is_constant || (n.has_input(2) && !in(n, 2).is_constant))
+                        n.fail("weights and bias must be constants.");
+                    if (w[1] != x[1])
+                        n.fail("the weight tensor doesn't match the number of input channels.");
+                    read_window_attributes(n, n.get_ints("kernel_shape", {w[2], w[3]}));
+                    const auto y = pool_output_shape(n, x, w[2], w[3], n.config[2], n.config[3], n.config[4], n.config[5]);
+                    set_output(n, 0, FLOAT, {x[0], w[0], y[2], y[3]});
+
+                    if (!n.conv)
+                        n.conv.reset(new tt::tensor_conv());
+                    if (!n.has_input(2))
+                    {
+                        n.param1.set_size(1, w[0]);
+                        n.param1 = 0;
+                    }
+                    break;
+                }
+                case op_kind::conv_transpose:
+                {
+                    require_inputs(2);
+                    const auto& x = input_shape(0);
+                    const auto& w = input_shape(1);
+                    if (x.size() != 4 || w.size() != 4)
+                        n.fail("only 2D transposed convolutions over [N,C,H,W] inputs are supported.");
+                    if (n.get_int("group", 1) != 1)
+                        n.fail("grouped convolutions are not supported.");
+                    if (!in(n, 1).is_constant || (n.has_input(2) && !in(n, 2).is_constant))
+                        n.fail("weights and bias must be constants.");
+                    if (w[0] != x[1])
+                        n.fail("the weight tensor doesn't match the number of input channels.");
+                    for (auto p : n.get_ints("output_padding", {0, 0}))
+                    {
+                        if (p != 0)
+                            n.fail("output_padding is not supported.");
+                    }
+                    if (n.has_attribute("output_shape"))
+                        n.fail("the output_shape attribute is not supported.");
+                    read_window_attributes(n, n.get_ints("kernel_shape", {w[2], w[3]}));
+                    const int64_t oh = n.config[2]*(x[2] - 1) + w[2] - 2*n.config[4];
+                    const int64_t ow = n.config[3]*(x[3] - 1) + w[3] - 2*n.config[5];
+                    set_output(n, 0, FLOAT, {x[0], w[1], oh, ow});
+                    if (!n.conv)
+                        n.conv.reset(new tt::tensor_conv());
+                    break;
+                }
+                case op_kind::gemm:
+                {
+                    require_inputs(2);
+                    const auto& a = input_shape(0);
+                    const auto& b = input_shape(1);
+                    if (a.size() != 2 || b.size() != 2)
+                        n.fail("A and B must be matrices.");
+                    const bool ta = n.get_int("transA", 0) != 0;
+                    const bool tb = n.get_int("transB", 0) != 0;
+                    const int64_t m = ta ? a[1] : a[0];
+                    const int64_t k = ta ? a[0] : a[1];
+                    const int64_t nn = tb ? b[0] : b[1];
+                    if ((tb ? b[1] : b[0]) != k)
+                        n.fail("A and B have incompatible shapes.");
+                    if (n.has_input(2))
+                        broadcast_shape({input_shape(2), {m, nn}}, n.op_type);
+                    set_output(n, 0, FLOAT, {m, nn});
+                    break;
+                }
+                case op_kind::matmul:
+                {
+                    require_inputs(2);
+                    const auto& a = input_shape(0);
+                    const auto& b = input_shape(1);
+                    if (a.size() < 2 || b.size() < 2)
+                        n.fail("one dimensional operands are not supported.");
+                    if (a[a.size()-1] != b[b.size()-2])
+                        n.fail("A and B have incompatible shapes.");
+                    auto shape = broadcast_shape({
+                        std::vector<int64_t>(a.begin(), a.end()-2),
+                        std::vector<int64_t>(b.begin(), b.end()-2)}, n.op_type);
+                    shape.push_back(a[a.size()-2]);
+                    shape.push_back(b[b.size()-1]);
+                    set_output(n, 0, FLOAT, shape);
+                    break;
+                }
+                case op_kind::batch_normalization:
+                {
+                    require_inputs(5);
+                    const auto& x = input_shape(0);
+                    if (x.size() < 2)
+                        n.fail("the input must have at least 2 dimensions.");
+                    if (n.get_int("training_mode", 0) != 0)
+                        n.fail("training_mode is not supported.");
+                    for (size_t i = 1; i < 5; ++i)
+                    {
+                        if (!in(n, i).is_constant || shape_size(in(n, i).shape) != static_cast<size_t>(x[1]))
+                            n.fail("scale, bias, mean, and var must be constant vectors with one value per channel.");
+                    }
+                    // Fold the normalization into a per-channel affine transform.
+                    const float eps = n.get_float("epsilon", 1e-5f);
+                    n.param1.set_size(1, x[1]);
+                    n.param2.set_size(1, x[1]);
+                    const float* scale = in(n, 1).data.host();
+                    const float* bias = in(n, 2).data.host();
+                    const float* mean = in(n, 3).data.host();
+                    const float* var = in(n, 4).data.host();
+                    float* a = n.param1.host();
+                    float* b = n.param2.host();
+                    for (int64_t c = 0; c < x[1]; ++c)
+                    {
+                        a[c] = scale[c]/std::sqrt(var[c] + eps);
+                        b[c] = bias[c] - mean[c]*a[c];
+                    }
+                    set_output(n, 0, FLOAT, x);
+                    break;
+                }
+                case op_kind::layer_normalization:
+                {
+                    require_inputs(2);
+                    const auto& x = input_shape(0);
+                    const int64_t axis = normalize_axis(n.get_int("axis", -1), x.size(), n.op_type);
+                    const std::vector<int64_t> inner_shape(x.begin() + axis, x.end());
+                    const size_t inner = shape_size(inner_shape);
+                    n.param1.set_size(1, inner);
+                    n.param2.set_size(1, inner);
+                    n.param2 = 0;
+                    for (size_t i = 1; i < 3; ++i)
+                    {
+                        if (!n.has_input(i))
+                            continue;
+                        auto& p = in(n, i);
+                        if (!p.is_constant || p.type != FLOAT)
+                            n.fail("scale and bias must be constant float tensors.");
+                        const float* src = p.data.host();
+                        float* dest = (i == 1 ? n.param1 : n.param2).host();
+                        for_each_broadcast_index(inner_shape, {p.shape}, [&](size_t j, const size_t* idx) {
+                            dest[j] = src[idx[0]];
+                        });
+                        if (broadcast_shape({p.shape, inner_shape}, n.op_type) != inner_shape)
+                            n.fail("scale and bias must broadcast to the normalized dimensions.");
+                    }
+                    n.config = {axis};
+                    set_output(n, 0, FLOAT, x);
+                    out(n).owned_output = true;
+                    break;
+                }
+                case op_kind::max_pool: case op_kind::average_pool:
+                {
+                    const auto& x = input_shape(0);
+                    if (x.size() != 4)
+                        n.fail("only 2D pooling over [N,C,H,W] inputs is supported.");
+                    if (n.get_int("ceil_mode", 0) != 0)
+                        n.fail("ceil_mode is not supported.");
+                    if (n.get_int("storage_order", 0) != 0)
+                        n.fail("storage_order is not supported.");
+                    read_window_attributes(n, n.get_ints("kernel_shape", {}));
+                    if (n.op == op_kind::average_pool && n.get_int("count_include_pad", 0) != 0 &&
+                        (n.config[4] != 0 || n.config[5] != 0))
+                        n.fail("count_include_pad with non-zero padding is not supported.");
+                    set_output(n, 0, FLOAT, pool_output_shape(n, x, n.config[0], n.config[1],
+                                                               n.config[2], n.config[3], n.config[4], n.config[5]));
+                    out(n).owned_output = true;
+                    prepare_pool(n);
+                    break;
+                }
+                case op_kind::global_max_pool: case op_kind::global_average_pool:
+                {
+                    const auto& x = input_shape(0);
+                    if (x.size() != 4)
+                        n.fail("only [N,C,H,W] inputs are supported.");
+                    n.config = {x[2], x[3], 1, 1, 0, 0};
+                    set_output(n, 0, FLOAT, {x[0], x[1], 1, 1});
+                    out(n).owned_output = true;
+                    prepare_pool(n);
+                    break;
+                }
+                case op_kind::reshape:
+                {
+                    require_inputs(2);
+                    const auto& x = input_shape(0);
+                    const auto& spec = constant_ints(n, 1);
+                    const bool allow_zero = n.get_int("allowzero", 0) != 0;
+                    std::vector<int64_t> shape(spec.size());
+                    long infer_at = -1;
+                    size_t known = 1;
+                    for (size_t i = 0; i < spec.size(); ++i)
+                    {
+                        if (spec[i] == -1)
+                        {
+                            if (infer_at >= 0)
+                                n.fail("more than one dimension is -1.");
+                            infer_at = static_cast<long>(i);
+                            continue;
+                        }
+                        if (spec[i] == 0 && !allow_zero)
+                        {
+                            if (i >= x.size())
+                                n.fail("a 0 dimension refers past the input rank.");
+                            shape[i] = x[i];
+                        }
+                        else
+                        {
+                            shape[i] = spec[i];
+                        }
+                        known *= static_cast<size_t>(shape[i]);
+                    }
+                    if (infer_at >= 0)
+                    {
+                        if (known == 0 || shape_size(x) % known != 0)
+                            n.fail("the -1 dimension can't be inferred.");
+                        shape[infer_at] = static_cast<int64_t>(shape_size(x)/known);
+                    }
+                    if (shape_size(shape) != shape_size(x))
+                        n.fail("the new shape has a different number of elements.");
+                    set_output(n, 0, in(n, 0).type, shape);
+                    break;
+                }
+                case op_kind::flatten:
+                {
+                    const auto& x = input_shape(0);
+                    const int64_t axis = n.get_int("axis", 1);
+                    const int64_t a = axis < 0 ? axis + static_cast<int64_t>(x.size()) : axis;
+                    if (a < 0 || a > static_cast<int64_t>(x.size()))
+                        n.fail("axis is out of range.");
+                    set_output(n, 0, in(n, 0).type, {
+                        static_cast<int64_t>(shape_size(std::vector<int64_t>(x.begin(), x.begin() + a))),
+                        static_cast<int64_t>(shape_size(std::vector<int64_t>(x.begin() + a, x.end())))
+                    });
+                    break;
+                }
+                case op_kind::squeeze: case op_kind::unsqueeze:
+                {
+                    const auto& x = input_shape(0);
+                    std::vector<int64_t> axes = n.has_input(1) ? constant_ints(n, 1) : n.get_ints("axes", {});
+                    std::vector<int64_t> shape;
+                    if (n.op == op_kind::squeeze)
+                    {
+                        std::vector<bool> drop(x.size(), axes.empty());
+                        for (auto a : axes)
+                            drop[normalize_axis(a, x.size(), n.op_type)] = true;
+                        for (size_t i = 0; i < x.size(); ++i)
+                        {
+                            if (drop[i] && x[i] != 1 && !axes.empty())
+                                n.fail("can't squeeze a dimension that isn't 1.");
+                            if (!(drop[i] && x[i] == 1))
+                                shape.push_back(x[i]);
+                        }
+                    }
+                    else
+                    {
+                        const size_t rank = x.size() + axes.size();
+                        std::vector<bool> inserted(rank, false);
+                        for (auto a : axes)
+                            inserted[normalize_axis(a, rank, n.op_type)] = true;
+                        for (size_t i = 0, j = 0; i < rank; ++i)
+                            shape.push_back(inserted[i] ? 1 : x[j++]);
+                    }
+                    set_output(n, 0, in(n, 0).type, shape);
+                    break;
+                }
+                case op_kind::transpose:
+                {
+                    const auto& x = input_shape(0);
+                    std::vector<int64_t> perm(x.size());
+                    for (size_t i = 0; i < perm.size(); ++i)
+                        perm[i] = static_cast<int64_t>(perm.size() - 1 - i);
+                    perm = n.get_ints("perm", perm);
+                    if (perm.size() != x.size())
+                        n.fail("perm doesn't match the input rank.");
+                    std::vector<int64_t> shape(x.size());
+                    std::vector<bool> seen(x.size(), false);
+                    for (size_t i = 0; i < perm.size(); ++i)
+                    {
+                        const int64_t p = normalize_axis(perm[i], x.size(), n.op_type);
+                        if (seen[p])
+                            n.fail("perm isn't a permutation.");
+                        seen[p] = true;
+                        perm[i] = p;
+                        shape[i] = x[p];
+                    }
+                    n.config = perm;
+                    set_output(n, 0, in(n, 0).type, shape);
+                    break;
+                }
+                case op_kind::concat:
+                {
+                    std::vector<int64_t> shape = input_shape(0);
+                    const int64_t axis = normalize_axis(n.get_int("axis", 0), shape.size(), n.op_type);
+                    for (size_t i = 1; i < n.inputs.size(); ++i)
+                    {
+                        if (!n.has_input(i))
+                            continue;
+                        const auto& s = input_shape(i);
+                        if (s.size() != shape.size() || in(n, i).type != in(n, 0).type)
+                            n.fail("inputs must have equal ranks and types.");
+                        for (size_t d = 0; d < s.size(); ++d)
+                        {
+                            if (static_cast<int64_t>(d) == axis)
+                                shape[d] += s[d];
+                            else if (s[d] != shape[d])
+                                n.fail("inputs must have equal dimensions outside the concat axis.");
+                        }
+                    }
+                    n.config = {axis};
+                    set_output(n, 0, in(n, 0).type, shape);
+                    break;
+                }
+                case op_kind::slice:
+                {
+                    require_inputs(3);
+                    const auto& x = input_shape(0);
+                    const auto& starts = constant_ints(n, 1);
+                    const auto& ends = constant_ints(n, 2);
+                    std::vector<int64_t> axes;
+                    if (n.has_input(3))
+                    {
+                        axes = constant_ints(n, 3);
+                    }
+                    else
+                    {
+                        for (size_t i = 0; i < starts.size(); ++i)
+                            axes.push_back(static_cast<int64_t>(i));
+                    }
+                    const std::vector<int64_t> steps = n.has_input(4) ? constant_ints(n, 4) : std::vector<int64_t>(starts.size(), 1);
+                    if (ends.size() != starts.size() || axes.size() != starts.size() || steps.size() != starts.size())
+                        n.fail("starts, ends, axes, and steps must have equal lengths.");
+
+                    // config holds [start_0, step_0, start_1, step_1, ...] for every input dimension.
+                    std::vector<int64_t> shape = x;
+                    n.config.assign(2*x.size(), 0);
+                    for (size_t d = 0; d < x.size(); ++d)
+                        n.config[2*d + 1] = 1;
+                    for (size_t i = 0; i < starts.size(); ++i)
+                    {
+                        const int64_t d = normalize_axis(axes[i], x.size(), n.op_type);
+                        const int64_t dim = x[d];
+                        const int64_t step = steps[i];
+                        if (step == 0)
+                            n.fail("steps must be non-zero.");
+                        int64_t start = starts[i] < 0 ? starts[i] + dim : starts[i];
+                        int64_t end = ends[i] < 0 ? ends[i] + dim : ends[i];
+                        int64_t count;
+                        if (step > 0)
+                        {
+                            start = std::min(std::max<int64_t>(start, 0), dim);
+                            end = std::min(std::max<int64_t>(end, 0), dim);
+                            count = end > start ? (end - start + step - 1)/step : 0;
+                        }
+                        else
+                        {
+                            start = std::min(std::max<int64_t>(start, 0), dim - 1);
+                            end = std::min(std::max<int64_t>(end, -1), dim - 1);
+                            count = start > end ? (start - end - step - 1)/(-step) : 0;
+                        }
+                        n.config[2*d] = start;
+                        n.config[2*d + 1] = step;
+                        shape[d] = count;
+                    }
+                    set_output(n, 0, in(n, 0).type, shape);
+                    break;
+                }
+                case op_kind::pad:
+                {
+                    require_inputs(2);
+                    const auto& x = input_shape(0);
+                    if (n.get_string("mode", "constant") != "constant")
+                        n.fail("only constant padding is supported.");
+                    const auto& spec = constant_ints(n, 1);
+                    std::vector<int64_t> pads(2*x.size(), 0);
+                    if (n.has_input(3))
+                    {
+                        const auto& axes = constant_ints(n, 3);
+                        if (spec.size() != 2*axes.size())
+                            n.fail("pads doesn't match axes.");
+                        for (size_t i = 0; i < axes.size(); ++i)
+                        {
+                            const int64_t d = normalize_axis(axes[i], x.size(), n.op_type);
+                            pads[d] = spec[i];
+                            pads[d + x.size()] = spec[i + axes.size()];
+                        }
+                    }
+                    else
+                    {
+                        if (spec.size() != 2*x.size())
+                            n.fail("pads must have two values per input dimension.");
+                        pads = spec;
+                    }
+                    std::vector<int64_t> shape = x;
+                    for (size_t d = 0; d < x.size(); ++d)
+                    {
+                        if (pads[d] < 0 || pads[d + x.size()] < 0)
+                            n.fail("negative pads are not supported.");
+                        shape[d] += pads[d] + pads[d + x.size()];
+                    }
+                    n.config = pads;
+                    set_output(n, 0, in(n, 0).type, shape);
+                    break;
+                }
+                case op_kind::resize:
+                {
+                    const auto& x = input_shape(0);
+                    if (x.size() != 4 || in(n, 0).type != FLOAT)
+                        n.fail("only float [N,C,H,W] inputs are supported.");
+                    const std::string mode = n.get_string("mode", "nearest");
+                    if (mode != "nearest" && mode != "linear")
+                        n.fail("mode " + mode + " is not supported.");
+                    std::vector<int64_t> shape;
+                    if (n.has_input(3))
+                    {
+                        shape = constant_ints(n, 3);
+                    }
+                    else if (n.has_input(2))
+                    {
+                        auto& scales = in(n, 2);
+                        if (!scales.is_constant || scales.type != FLOAT || shape_size(scales.shape) != x.size())
+                            n.fail("scales must be a constant float tensor with one value per dimension.");
+                        for (size_t d = 0; d < x.size(); ++d)
+                            shape.push_back(static_cast<int64_t>(std::floor(x[d]*scales.data.host()[d])));
+                    }
+                    else
+                    {
+                        n.fail("either scales or sizes must be given.");
+                    }
+                    if (shape.size() != 4 || shape[0] != x[0] || shape[1] != x[1])
+                        n.fail("only spatial resizing is supported.");
+                    set_output(n, 0, FLOAT, shape);
+                    break;
+                }
+                case op_kind::expand:
+                {
+                    require_inputs(2);
+                    set_output(n, 0, in(n, 0).type, broadcast_shape({input_shape(0), constant_ints(n, 1)}, n.op_type));
+                    break;
+                }
+                case op_kind::reduce_mean: case op_kind::reduce_sum:
+                {
+                    const auto& x = input_shape(0);
+                    if (in(n, 0).type != FLOAT)
+                        n.fail("the input must be a float tensor.");
+                    std::vector<int64_t> axes = n.has_input(1) ? constant_ints(n, 1) : n.get_ints("axes", {});
+                    const bool keepdims = n.get_int("keepdims", 1) != 0;
+                    // config marks the reduced dimensions with 1.
+                    n.config.assign(x.size(), axes.empty() && n.get_int("noop_with_empty_axes", 0) == 0 ? 1 : 0);
+                    for (auto a : axes)
+                        n.config[normalize_axis(a, x.size(), n.op_type)] = 1;
+                    std::vector<int64_t> shape;
+                    for (size_t d = 0; d < x.size(); ++d)
+                    {
+                        if (!n.config[d])
+                            shape.push_back(x[d]);
+                        else if (keepdims)
+                            shape.push_back(1);
+                    }
+                    set_output(n, 0, FLOAT, shape);
+                    break;
+                }
+                case op_kind::gather:
+                {
+                    require_inputs(2);
+                    const auto& x = input_shape(0);
+                    if (in(n, 1).type != INT64)
+                        n.fail("indices must be an integer tensor.");
+                    const int64_t axis = normalize_axis(n.get_int("axis", 0), x.size(), n.op_type);
+                    std::vector<int64_t> shape(x.begin(), x.begin() + axis);
+                    shape.insert(shape.end(), input_shape(1).begin(), input_shape(1).end());
+                    shape.insert(shape.end(), x.begin() + axis + 1, x.end());
+                    n.config = {axis};
+                    set_output(n, 0, in(n, 0).type, shape);
+                    break;
+                }
+                case op_kind::shape:
+                {
+                    const int64_t rank = static_cast<int64_t>(input_shape(0).size());
+                    int64_t start = n.get_int("start", 0);
+                    int64_t end = n.get_int("end", rank);
+                    start = std::min(std::max<int64_t>(start < 0 ? start + rank : start, 0), rank);
+                    end = std::min(std::max<int64_t>(end < 0 ? end + rank : end, 0), rank);
+                    n.config = {start, std::max(start, end)};
+                    set_output(n, 0, INT64, {n.config[1] - n.config[0]});
+                    break;
+                }
+                case op_kind::constant:
+                {
+                    if (n.has_attribute("value"))
+                    {
+                        const auto& t = n.attributes["value"].t;
+                        set_output(n, 0, t.data_type == BOOL ? BOOL : (is_integer_data_type(t.data_type) ? INT64 : FLOAT), t.dims);
+                    }
+                    else if (n.has_attribute("value_float"))
+                        set_output(n, 0, FLOAT, {});
+                    else if (n.has_attribute("value_floats"))
+                        set_output(n, 0, FLOAT, {static_cast<int64_t>(n.attributes["value_floats"].floats.size())});
+                    else if (n.has_attribute("value_int"))
+                        set_output(n, 0, INT64, {});
+                    else if (n.has_attribute("value_ints"))
+                        set_output(n, 0, INT64, {static_cast<int64_t>(n.attributes["value_ints"].ints.size())});
+                    else
+                        n.fail("only tensor, float, and int values are supported.");
+                    break;
+                }
+                case op_kind::constant_of_shape:
+                {
+                    int type = FLOAT;
+                    if (n.has_attribute("value"))
+                    {
+                        const auto& t = n.attributes["value"].t;
+                        if (shape_size(t.dims) != 1)
+                            n.fail("value must hold a single element.");
+                        type = t.data_type == BOOL ? BOOL : (is_integer_data_type(t.data_type) ? INT64 : FLOAT);
+                    }
+                    set_output(n, 0, type, constant_ints(n, 0));
+                    break;
+                }
+                case op_kind::trilu:
+                {
+                    if (input_shape(0).size() < 2)
+                        n.fail("the input must have at least 2 dimensions.");
+                    n.config = {n.has_input(1) ? constant_ints(n, 1).at(0) : 0};
+                    set_output(n, 0, in(n, 0).type, input_shape(0));
+                    break;
+                }
+            }
+        }
+
+        void prepare_pool(
+            runtime_node& n
+        )
+        {
+            if (!n.pool)
+                n.pool.reset(new tt::pooling());
+            const auto& c = n.config;
+            if (n.op == op_kind::max_pool || n.op == op_kind::global_max_pool)
+                n.pool->setup_max_pooling(c[0], c[1], c[2], c[3], c[4], c[5]);
+            else
+                n.pool->setup_avg_pooling(c[0], c[1], c[2], c[3], c[4], c[5]);
+        }
+
+    // ------------------------------------------------------------------------------------
+    //                                      execution
+    // ------------------------------------------------------------------------------------
+
+        float* typed_host(runtime_value& v, float*) { return host(v); }
+        int64_t* typed_host(runtime_value& v, int64_t*) { return v.ints.data(); }
+
+        template <typename T>
+        T* typed(runtime_value& v) { return typed_host(v, static_cast<T*>(nullptr)); }
+
+        template <typename T, typename U, typename F>
+        void binary_kernel(
+            runtime_node& n,
+            F f
+        )
+        {
+            auto& a = in(n, 0);
+            auto& b = in(n, 1);
+            auto& y = out(n);
+            const T* pa = typed<T>(a);
+            const T* pb = typed<T>(b);
+            U* py = typed<U>(y);
+            impl::onnx::for_each_broadcast_index(y.shape, {a.shape, b.shape}, [&](size_t i, const size_t* idx) {
+                py[i] = f(pa[idx[0]], pb[idx[1]]);
+            });
+        }
+
+        template <typename T>
+        void arithmetic(
+            runtime_node& n
+        )
+        {
+            switch (n.op)
+            {
+                case op_kind::add: binary_kernel<T,T>(n, [](T a, T b) { return a + b; }); break;
+                case op_kind::sub: binary_kernel<T,T>(n, [](T a, T b) { return a - b; }); break;
+                case op_kind::mul: binary_kernel<T,T>(n, [](T a, T b) { return a * b; }); break;
+                case op_kind::div: binary_kernel<T,T>(n, [](T a, T b) { return a / b; }); break;
+                case op_kind::prelu: binary_kernel<T,T>(n, [](T a, T b) { return a < 0 ? a*b : a; }); break;
+                case op_kind::equal: binary_kernel<T,float>(n, [](T a, T b) { return a == b ? 1.f : 0.f; }); break;
+                case op_kind::greater: binary_kernel<T,float>(n, [](T a, T b) { return a > b ? 1.f : 0.f; }); break;
+                case op_kind::greater_or_equal: binary_kernel<T,float>(n, [](T a, T b) { return a >= b ? 1.f : 0.f; }); break;
+                case op_kind::less: binary_kernel<T,float>(n, [](T a, T b) { return a < b ? 1.f : 0.f; }); break;
+                case op_kind::less_or_equal: binary_kernel<T,float>(n, [](T a, T b) { return a <= b ? 1.f : 0.f; }); break;
+                case op_kind::logical_and: binary_kernel<T,float>(n, [](T a, T b) { return a != 0 && b != 0 ? 1.f : 0.f; }); break;
+                case op_kind::logical_or: binary_kernel<T,float>(n, [](T a, T b) { return a != 0 || b != 0 ? 1.f : 0.f; }); break;
+                default: n.fail("internal error: not a binary operator.");
+            }
+        }
+
+        void power(
+            runtime_node& n
+        )
+        {
+            using namespace impl::onnx;
+            auto& a = in(n, 0);
+            auto& b = in(n, 1);
+            if (a.type == INT64)
+                n.fail("int64 bases are not supported.");
+            // x^2 is by far the most common use, e.g. in exported normalization layers.
+            if (b.is_constant && shape_size(b.shape) == 1)
+            {
+                const float e = b.type == INT64 ? static_cast<float>(b.ints[0]) : b.data.host()[0];
+                const float* x = host(a);
+                float* y = host(out(n));
+                const size_t count = shape_size(a.shape);
+                if (e == 2)
+                {
+                    for (size_t i = 0; i < count; ++i)
+                        y[i] = x[i]*x[i];
+                }
+                else
+                {
+                    for (size_t i = 0; i < count; ++i)
+                        y[i] = std::pow(x[i], e);
+                }
+                return;
+            }
+            if (b.type == INT64)
+                n.fail("non-constant int64 exponents are not supported.");
+            binary_kernel<float,float>(n, [](float x, float e) { return std::pow(x, e); });
+        }
+
+        template <typename F>
+        void unary_kernel(
+            runtime_node& n,
+            F f
+        )
+        {
+            const float* x = host(in(n, 0));
+            float* y = host(out(n));
+            const size_t count = impl::onnx::shape_size(out(n).shape);
+            for (size_t i = 0; i < count; ++i)
+                y[i] = f(x[i]);
+        }
+
+        template <typename T>
+        void copy_kernel(
+            runtime_node& n
+        )
+        {
+            const T* x = typed<T>(in(n, 0));
+            T* y = typed<T>(out(n));
+            if (x != y)
+                std::copy(x, x + impl::onnx::shape_size(out(n).shape), y);
+        }
+
+        template <typename T>
+        void where_kernel(
+            runtime_node& n
+        )
+        {
+            auto& c = in(n, 0);
+            auto& a = in(n, 1);
+            auto& b = in(n, 2);
+            auto& y = out(n);
+            const float* pc = host(c);
+            const T* pa = typed<T>(a);
+            const T* pb = typed<T>(b);
+            T* py = typed<T>(y);
+            impl::onnx::for_each_broadcast_index(y.shape, {c.shape, a.shape, b.shape}, [&](size_t i, const size_t* idx) {
+                py[i] = pc[idx[0]] != 0 ? pa[idx[1]] : pb[idx[2]];
+            });
+        }
+
+        template <typename T>
+        void expand_kernel(
+            runtime_node& n
+        )
+        {
+            auto& x = in(n, 0);
+            auto& y = out(n);
+            const T* px = typed<T>(x);
+            T* py = typed<T>(y);
+            impl::onnx::for_each_broadcast_index(y.shape, {x.shape}, [&](size_t i, const size_t* idx) {
+                py[i] = px[idx[0]];
+            });
+        }
+
+        template <typename T>
+        void transpose_kernel(
+            runtime_node& n
+        )
+        {
+            auto& x = in(n, 0);
+            const auto in_strides = impl::onnx::contiguous_strides(x.shape);
+            std::vector<int64_t> strides(n.config.size());
+            for (size_t i = 0; i < n.config.size(); ++i)
+                strides[i] = in_strides[n.config[i]];
+            impl::onnx::strided_copy(typed<T>(x), typed<T>(out(n)), out(n).shape, strides, 0);
+        }
+
+        template <typename T>
+        void slice_kernel(
+            runtime_node& n
+        )
+        {
+            auto& x = in(n, 0);
+            const auto in_strides = impl::onnx::contiguous_strides(x.shape);
+            std::vector<int64_t> strides(x.shape.size());
+            int64_t offset = 0;
+            for (size_t d = 0; d < x.shape.size(); ++d)
+            {
+                offset += n.config[2*d]*in_strides[d];
+                strides[d] = n.config[2*d + 1]*in_strides[d];
+            }
+            if (impl::onnx::shape_size(out(n).shape) != 0)
+                impl::onnx::strided_copy(typed<T>(x), typed<T>(out(n)), out(n).shape, strides, offset);
+        }
+
+        template <typename T>
+        void concat_kernel(
+            runtime_node& n
+        )
+        {
+            auto& y = out(n);
+            const int64_t axis = n.config[0];
+            size_t outer = 1;
+            for (int64_t d = 0; d < axis; ++d)
+                outer *= static_cast<size_t>(y.shape[d]);
+            const size_t inner = impl::onnx::shape_size(std::vector<int64_t>(y.shape.begin() + axis + 1, y.shape.end()));
+            const size_t out_block = static_cast<size_t>(y.shape[axis])*inner;
+            T* py = typed<T>(y);
+            size_t position = 0;
+            for (size_t i = 0; i < n.inputs.size(); ++i)
+            {
+                if (!n.has_input(i))
+                    continue;
+                auto& x = in(n, i);
+                const size_t block = static_cast<size_t>(x.shape[axis])*inner;
+                const T* px = typed<T>(x);
+                for (size_t o = 0; o < outer; ++o)
+                    std::copy(px + o*block, px + (o + 1)*block, py + o*out_block + position);
+                position += block;
+            }
+        }
+
+        template <typename T>
+        void pad_kernel(
+            runtime_node& n,
+            T value
+        )
+        {
+            auto& x = in(n, 0);
+            auto& y = out(n);
+            T* py = typed<T>(y);
+            std::fill(py, py + impl::onnx::shape_size(y.shape), value);
+            if (impl::onnx::shape_size(x.shape) == 0)
+                return;
+            // Copy x into the interior of y by walking x with y's strides.
+            const auto y_strides = impl::onnx::contiguous_strides(y.shape);
+            int64_t offset = 0;
+            for (size_t d = 0; d < x.shape.size(); ++d)
+                offset += n.config[d]*y_strides[d];
+            const T* px = typed<T>(x);
+            const size_t count = impl::onnx::shape_size(x.shape);
+            const size_t rank = x.shape.size();
+            std::vector<int64_t> counter(rank, 0);
+            int64_t j = offset;
+            for (size_t i = 0; i < count; ++i)
+            {
+                py[j] = px[i];
+                for (size_t d = rank; d-- > 0;)
+                {
+                    if (++counter[d] < x.shape[d])
+                    {
+                        j += y_strides[d];
+                        break;
+                    }
+                    j -= y_strides[d]*(x.shape[d] - 1);
+                    counter[d] = 0;
+                }
+            }
+        }
+
+        template <typename T>
+        void gather_kernel(
+            runtime_node& n
+        )
+        {
+            auto& x = in(n, 0);
+            auto& indices = in(n, 1);
+            const int64_t axis = n.config[0];
+            const int64_t dim = x.shape[axis];
+            size_t outer = 1;
+            for (int64_t d = 0; d < axis; ++d)
+                outer *= static_cast<size_t>(x.shape[d]);
+            const size_t inner = impl::onnx::shape_size(std::vector<int64_t>(x.shape.begin() + axis + 1, x.shape.end()));
+            const T* px = typed<T>(x);
+            T* py = typed<T>(out(n));
+            const size_t count = indices.ints.size();
+            for (size_t o = 0; o < outer; ++o)
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    int64_t idx = indices.ints[i];
+                    if (idx < 0)
+                        idx += dim;
+                    if (idx < 0 || idx >= dim)
+                        n.fail("an index is out of range.");
+                    const T* src = px + (o*dim + idx)*inner;
+                    std::copy(src, src + inner, py + (o*count + i)*inner);
+                }
+            }
+        }
+
+        template <typename T>
+        void trilu_kernel(
+            runtime_node& n
+        )
+        {
+            auto& x = in(n, 0);
+            const size_t rank = x.shape.size();
+            const int64_t rows = x.shape[rank - 2];
+            const int64_t cols = x.shape[rank - 1];
+            const size_t planes = impl::onnx::shape_size(x.shape)/static_cast<size_t>(rows*cols);
+            const bool upper = n.get_int("upper", 1) != 0;
+            const int64_t k = n.config[0];
+            const T* px = typed<T>(x);
+            T* py = typed<T>(out(n));
+            for (size_t p = 0; p < planes; ++p)
+            {
+                for (int64_t r = 0; r < rows; ++r)
+                {
+                    for (int64_t c = 0; c < cols; ++c)
+                    {
+                        const size_t i = (p*rows + r)*cols + c;
+                        const bool keep = upper ? c - r >= k : c - r <= k;
+                        py[i] = keep ? px[i] : T(0);
+                    }
+                }
+            }
+        }
+
+        void reduce(
+            runtime_node& n
+        )
+        {
+            auto& x = in(n, 0);
+            auto& y = out(n);
+            const float* px = host(x);
+            float* py = host(y);
+            const size_t out_count = impl::onnx::shape_size(y.shape);
+            const size_t in_count = impl::onnx::shape_size(x.shape);
+            const size_t reduced = out_count == 0 ? 0 : in_count/out_count;
+            const size_t rank = x.shape.size();
+
+            // Position of every input element in the output, with the reduced
+            // dimensions given a stride of 0.
+            std::vector<int64_t> out_strides(rank, 0);
+            int64_t stride = 1;
+            for (size_t d = rank; d-- > 0;)
+            {
+                if (!n.config[d])
+                {
+                    out_strides[d] = stride;
+                    stride *= x.shape[d];
+                }
+            }
+
+            std::vector<double> sums(out_count, 0);
+            std::vector<int64_t> counter(rank, 0);
+            int64_t j = 0;
+            for (size_t i = 0; i < in_count; ++i)
+            {
+                sums[j] += px[i];
+                for (size_t d = rank; d-- > 0;)
+                {
+                    if (++counter[d] < x.shape[d])
+                    {
+                        j += out_strides[d];
+                        break;
+                    }
+                    j -= out_strides[d]*(x.shape[d] - 1);
+                    counter[d] = 0;
+                }
+            }
+            const double scale = n.op == op_kind::reduce_mean && reduced != 0 ? 1.0/reduced : 1.0;
+            for (size_t i = 0; i < out_count; ++i)
+                py[i] = static_cast<float>(sums[i]*scale);
+        }
+
+        void resize(
+            runtime_node& n
+        )
+        {
+            auto& x = in(n, 0);
+            auto& y = out(n);
+            const std::string mode = n.get_string("mode", "nearest");
+            const std::string coordinate_mode = n.get_string("coordinate_transformation_mode", "half_pixel");
+            if (mode == "linear" && coordinate_mode == "align_corners")
+            {
+                auto dest = view(y);
+                auto src = view(x);
+                tt::resize_bilinear(dest, src);
+                return;
+            }
+
+            const int64_t in_h = x.shape[2], in_w = x.shape[3];
+            const int64_t out_h = y.shape[2], out_w = y.shape[3];
+            float scale_h = static_cast<float>(out_h)/in_h;
+            float scale_w = static_cast<float>(out_w)/in_w;
+            if (!n.has_input(3) && n.has_input(2))
+            {
+                scale_h = in(n, 2).data.host()[2];
+                scale_w = in(n, 2).data.host()[3];
+            }
+
+            const std::string nearest_mode = n.get_string("nearest_mode", "round_prefer_floor");
+            std::vector<int64_t> y0(out_h), y1(out_h), x0(out_w), x1(out_w);
+            std::vector<float> wy(out_h), wx(out_w);
+            auto setup_axis = [&](int64_t out_len, int64_t in_len, float scale,
+                                  std::vector<int64_t>& lo, std::vector<int64_t>& hi, std::vector<float>& w) {
+                for (int64_t i = 0; i < out_len; ++i)
+                {
+                    const float c = impl::onnx::resize_source_coordinate(i, in_len, out_len, scale, coordinate_mode);
+                    if (mode == "nearest")
+                    {
+                        lo[i] = hi[i] = impl::onnx::resize_nearest_index(c, in_len, nearest_mode);
+                        w[i] = 0;
+                    }
+                    else
+                    {
+                        const float clamped = std::min(std::max(c, 0.f), static_cast<float>(in_len - 1));
+                        lo[i] = static_cast<int64_t>(std::floor(clamped));
+                        hi[i] = std::min(lo[i] + 1, in_len - 1);
+                        w[i] = clamped - lo[i];
+                    }
+                }
+            };
+            setup_axis(out_h, in_h, scale_h, y0, y1, wy);
+            setup_axis(out_w, in_w, scale_w, x0, x1, wx);
+
+            const float* px = host(x);
+            float* py = host(y);
+            const size_t planes = static_cast<size_t>(x.shape[0]*x.shape[1]);
+            for (size_t p = 0; p < planes; ++p)
+            {
+                const float* s = px + p*in_h*in_w;
+                float* d = py + p*out_h*out_w;
+                for (int64_t r = 0; r < out_h; ++r)
+                {
+                    const float* top = s + y0[r]*in_w;
+                    const float* bottom = s + y1[r]*in_w;
+                    for (int64_t c = 0; c < out_w; ++c)
+                    {
+                        const float t = top[x0[c]] + (top[x1[c]] - top[x0[c]])*wx[c];
+                        const float b = bottom[x0[c]] + (bottom[x1[c]] - bottom[x0[c]])*wx[c];
+                        d[r*out_w + c] = t + (b - t)*wy[r];
+                    }
+                }
+            }
+        }
+
+        void matmul(
+            runtime_node& n
+        )
+        {
+            auto& a = in(n, 0);
+            auto& b = in(n, 1);
+            auto& y = out(n);
+            const int64_t m = a.shape[a.shape.size()-2];
+            const int64_t k = a.shape[a.shape.size()-1];
+            const int64_t cols = b.shape[b.shape.size()-1];
+
+            if (b.shape.size() == 2)
+            {
+                // A single matrix on the right applies to every row of A, so the
+                // whole product is one gemm over A viewed as [rows, K].
+                const int64_t rows = static_cast<int64_t>(impl::onnx::shape_size(a.shape))/k;
+                auto dest = view(y, {rows, cols, 1, 1});
+                auto lhs = view(a, {rows, k, 1, 1});
+                auto rhs = view(b, {k, cols, 1, 1});
+                tt::gemm(0, dest, 1, lhs, false, rhs, false);
+                return;
+            }
+
+            const std::vector<int64_t> a_batch(a.shape.begin(), a.shape.end()-2);
+            const std::vector<int64_t> b_batch(b.shape.begin(), b.shape.end()-2);
+            const std::vector<int64_t> y_batch(y.shape.begin(), y.shape.end()-2);
+            const int64_t batches = static_cast<int64_t>(impl::onnx::shape_size(y_batch));
+            if (a_batch == b_batch)
+            {
+                auto dest = view(y, {batches, 1, m, cols});
+                auto lhs = view(a, {batches, 1, m, k});
+                auto rhs = view(b, {batches, 1, k, cols});
+                tt::gemm(0, dest, 1, lhs, false, rhs, false, operation_mode::PLANE_WISE);
+                return;
+            }
+
+            impl::onnx::for_each_broadcast_index(y_batch, {a_batch, b_batch}, [&](size_t i, const size_t* idx) {
+                auto dest = view(y, {m, cols, 1, 1}, i*m*cols);
+                auto lhs = view(a, {m, k, 1, 1}, idx[0]*m*k);
+                auto rhs = view(b, {k, cols, 1, 1}, idx[1]*k*cols);
+                tt::gemm(0, dest, 1, lhs, false, rhs, false);
+            });
+        }
+
+        void execute(
+            runtime_node& n
+        )
+        {
+            using namespace impl::onnx;
+            auto& y = out(n);
+            switch (n.op)
+            {
+                case op_kind::add: case op_kind::sub: case op_kind::mul: case op_kind::div:
+                case op_kind::prelu: case op_kind::equal: case op_kind::greater:
+                case op_kind::greater_or_equal: case op_kind::less: case op_kind::less_or_equal:
+                case op_kind::logical_and: case op_kind::logical_or:
+                {
+                    if (in(n, 0).type == INT64)
+                        arithmetic<int64_t>(n);
+                    else
+                        arithmetic<float>(n);
+                    break;
+                }
+                case op_kind::pow: power(n); break;
+                case op_kind::where:
+                    if (y.type == INT64) where_kernel<int64_t>(n); else where_kernel<float>(n);
+                    break;
+                case op_kind::logical_not: unary_kernel(n, [](float x) { return x != 0 ? 0.f : 1.f; }); break;
+
+                case op_kind::relu: { auto d = view(y); auto s = view(in(n, 0)); tt::relu(d, s); break; }
+                case op_kind::sigmoid: { auto d = view(y); auto s = view(in(n, 0)); tt::sigmoid(d, s); break; }
+                case op_kind::tanh: { auto d = view(y); auto s = view(in(n, 0)); tt::tanh(d, s); break; }
+                case op_kind::elu: { auto d = view(y); auto s = view(in(n, 0)); tt::elu(d, s, n.get_float("alpha", 1)); break; }
+                case op_kind::leaky_relu:
+                {
+                    auto d = view(y);
+                    auto s = view(in(n, 0));
+                    tt::leaky_relu(d, s, n.get_float("alpha", 0.01f));
+                    break;
+                }
+                case op_kind::softplus:
+                    unary_kernel(n, [](float x) { return x > 20 ? x : std::log1p(std::exp(x)); });
+                    break;
+                case op_kind::erf: unary_kernel(n, [](float x) { return std::erf(x); }); break;
+                case op_kind::sqrt: unary_kernel(n, [](float x) { return std::sqrt(x); }); break;
+                case op_kind::exp: unary_kernel(n, [](float x) { return std::exp(x); }); break;
+                case op_kind::log: unary_kernel(n, [](float x) { return std::log(x); }); break;
+                case op_kind::reciprocal: unary_kernel(n, [](float x) { return 1/x; }); break;
+                case op_kind::neg:
+                {
+                    if (y.type == INT64)
+                    {
+                        for (size_t i = 0; i < y.ints.size(); ++i)
+                            y.ints[i] = -in(n, 0).ints[i];
+                    }
+                    else
+                    {
+                        unary_kernel(n, [](float x) { return -x; });
+                    }
+                    break;
+                }
+                case op_kind::abs:
+                {
+                    if (y.type == INT64)
+                    {
+                        for (size_t i = 0; i < y.ints.size(); ++i)
+                            y.ints[i] = std::abs(in(n, 0).ints[i]);
+                    }
+                    else
+                    {
+                        unary_kernel(n, [](float x) { return std::abs(x); });
+                    }
+                    break;
+                }
+                case op_kind::clip: clip(n); break;
+                case op_kind::cast: cast(n); break;
+                case op_kind::identity:
+                    if (y.type == INT64) copy_kernel<int64_t>(n); else copy_kernel<float>(n);
+                    break;
+                case op_kind::reshape: case op_kind::flatten: case op_kind::squeeze: case op_kind::unsqueeze:
+                    if (y.type == INT64) copy_kernel<int64_t>(n); else copy_kernel<float>(n);
+                    break;
+
+                case op_kind::conv:
+                {
+                    auto& w = in(n, 1);
+                    auto dest = view(y);
+                    auto data = view(in(n, 0));
+                    auto filters = view(w);
+                    const long filters_count = static_cast<long>(w.shape[0]);
+                    n.conv->setup(data, filters, n.config[2], n.config[3], n.config[4], n.config[5]);
+                    if (n.has_input(2))
+                    {
+                        auto biases = view(in(n, 2), {1, filters_count, 1, 1});
+                        (*n.conv)(false, dest, data, filters, biases, n.fused_relu);
+                    }
+                    else
+                    {
+                        (*n.conv)(false, dest, data, filters, n.param1, n.fused_relu);
+                    }
+                    break;
+                }
+                case op_kind::conv_transpose:
+                {
+                    auto dest = view(y);
+                    auto data = view(in(n, 0));
+                    auto filters = view(in(n, 1));
+                    n.conv->setup(dest, filters, n.config[2], n.config[3], n.config[4], n.config[5]);
+                    n.conv->get_gradient_for_data(false, data, filters, dest);
+                    if (n.has_input(2))
+                    {
+                        auto biases = view(in(n, 2), {1, y.shape[1], 1, 1});
+                        tt::add(1, dest, 1, biases);
+                    }
+                    break;
+                }
+                case op_kind::gemm:
+                {
+                    auto& a = in(n, 0);
+                    auto& b = in(n, 1);
+                    const int64_t m = y.shape[0];
+                    const int64_t cols = y.shape[1];
+                    auto dest = view(y, {m, cols, 1, 1});
+                    auto lhs = view(a, {a.shape[0], a.shape[1], 1, 1});
+                    auto rhs = view(b, {b.shape[0], b.shape[1], 1, 1});
+                    tt::gemm(0, dest, n.get_float("alpha", 1), lhs, n.get_int("transA", 0) != 0,
+                             rhs, n.get_int("transB", 0) != 0);
+                    if (n.has_input(2))
+                        add_gemm_bias(n, in(n, 2), dest, m, cols);
+                    break;
+                }
+                case op_kind::matmul: matmul(n); break;
+                case op_kind::batch_normalization:
+                {
+                    const auto& x = in(n, 0).shape;
+                    const int64_t spatial = static_cast<int64_t>(shape_size(x))/(x[0]*x[1]);
+                    auto dest = view(y, {x[0], x[1], spatial, 1});
+                    auto src = view(in(n, 0), {x[0], x[1], spatial, 1});
+                    tt::affine_transform_conv(dest, src, n.param1, n.param2);
+                    break;
+                }
+                case op_kind::layer_normalization:
+                {
+                    const auto& x = in(n, 0).shape;
+                    const int64_t inner = static_cast<int64_t>(n.param1.size());
+                    const int64_t outer = static_cast<int64_t>(shape_size(x))/inner;
+                    auto src = view(in(n, 0), {outer, inner, 1, 1});
+                    tt::layer_normalize(n.get_float("epsilon", 1e-5f), y.data, n.scratch1, n.scratch2, src, n.param1, n.param2);
+                    break;
+                }
+                case op_kind::max_pool: case op_kind::average_pool:
+                case op_kind::global_max_pool: case op_kind::global_average_pool:
+                {
+                    auto src = view(in(n, 0));
+                    (*n.pool)(y.data, src);
+                    break;
+                }
+                case op_kind::softmax:
+                {
+                    const auto& x = in(n, 0).shape;
+                    const int64_t axis = normalize_axis(n.get_int("axis", -1), x.size(), n.op_type);
+                    const int64_t outer = static_cast<int64_t>(shape_size(std::vector<int64_t>(x.begin(), x.begin() + axis)));
+                    const int64_t inner = static_cast<int64_t>(shape_size(std::vector<int64_t>(x.begin() + axis + 1, x.end())));
+                    auto dest = view(y, {outer, x[axis], inner, 1});
+                    auto src = view(in(n, 0), {outer, x[axis], inner, 1});
+                    tt::softmax(dest, src);
+                    break;
+                }
+                case op_kind::transpose:
+                    if (y.type == INT64) transpose_kernel<int64_t>(n); else transpose_kernel<float>(n);
+                    break;
+                case op_kind::concat:
+                    if (y.type == INT64) concat_kernel<int64_t>(n); else concat_kernel<float>(n);
+                    break;
+                case op_kind::slice:
+                    if (y.type == INT64) slice_kernel<int64_t>(n); else slice_kernel<float>(n);
+                    break;
+                case op_kind::pad:
+                {
+                    if (y.type == INT64)
+                        pad_kernel<int64_t>(n, n.has_input(2) ? in(n, 2).ints.at(0) : 0);
+                    else
+                        pad_kernel<float>(n, n.has_input(2) ? constant_scalar(n, 2) : 0.f);
+                    break;
+                }
+                case op_kind::resize: resize(n); break;
+                case op_kind::expand:
+                    if (y.type == INT64) expand_kernel<int64_t>(n); else expand_kernel<float>(n);
+                    break;
+                case op_kind::reduce_mean: case op_kind::reduce_sum: reduce(n); break;
+                case op_kind::gather:
+                    if (y.type == INT64) gather_kernel<int64_t>(n); else gather_kernel<float>(n);
+                    break;
+                case op_kind::shape:
+                {
+                    const auto& x = in(n, 0).shape;
+                    y.ints.assign(x.begin() + n.config[0], x.begin() + n.config[1]);
+                    break;
+                }
+                case op_kind::constant: constant(n); break;
+                case op_kind::constant_of_shape:
+                {
+                    if (y.type == INT64)
+                    {
+                        const int64_t value = n.has_attribute("value") ? n.attributes["value"].t.int64_data.at(0) : 0;
+                        std::fill(y.ints.begin(), y.ints.end(), value);
+                    }
+                    else
+                    {
+                        float value = 0;
+                        if (n.has_attribute("value"))
+                        {
+                            const auto& t = n.attributes["value"].t;
+                            value = t.float_data.empty() ? static_cast<float>(t.int64_data.at(0)) : t.float_data[0];
+                        }
+                        float* d = host(y);
+                        std::fill(d, d + shape_size(y.shape), value);
+                    }
+                    break;
+                }
+                case op_kind::trilu:
+                    if (y.type == INT64) trilu_kernel<int64_t>(n); else trilu_kernel<float>(n);
+                    break;
+            }
+        }
+
+        void add_gemm_bias(
+            runtime_node& n,
+            runtime_value& c,
+            tensor& dest,
+            int64_t m,
+            int64_t cols
+        )
+        {
+            const float beta = n.get_float("beta", 1);
+            const size_t size = impl::onnx::shape_size(c.shape);
+            if (size == static_cast<size_t>(m*cols))
+            {
+                auto bias = view(c, {m, cols, 1, 1});
+                tt::add(1, dest, beta, bias);
+            }
+            else if (size == static_cast<size_t>(cols) && c.shape.back() == cols)
+            {
+                auto bias = view(c, {1, cols, 1, 1});
+                tt::add(1, dest, beta, bias);
+            }
+            else if (size == static_cast<size_t>(m))
+            {
+                auto bias = view(c, {m, 1, 1, 1});
+                tt::add(1, dest, beta, bias);
+            }
+            else
+            {
+                const float value = beta*host(c)[0];
+                float* d = dest.host();
+                for (size_t i = 0; i < dest.size(); ++i)
+                    d[i] += value;
+            }
+        }
+
+        void clip(
+            runtime_node& n
+        )
+        {
+            using namespace impl::onnx;
+            auto& x = in(n, 0);
+            auto& y = out(n);
+            if (x.type == INT64)
+            {
+                const int64_t lo = n.has_input(1) ? in(n, 1).ints.at(0) : std::numeric_limits<int64_t>::min();
+                const int64_t hi = n.has_input(2) ? in(n, 2).ints.at(0) : std::numeric_limits<int64_t>::max();
+                for (size_t i = 0; i < y.ints.size(); ++i)
+                    y.ints[i] = std::min(std::max(x.ints[i], lo), hi);
+                return;
+            }
+            const float lo = n.has_input(1) ? constant_scalar(n, 1) : -std::numeric_limits<float>::infinity();
+            const float hi = n.has_input(2) ? constant_scalar(n, 2) : std::numeric_limits<float>::infinity();
+            if (lo == 0 && hi < std::numeric_limits<float>::infinity())
+            {
+                auto d = view(y);
+                auto s = view(x);
+                tt::clipped_relu(d, s, hi);
+                return;
+            }
+            unary_kernel(n, [lo, hi](float v) { return std::min(std::max(v, lo), hi); });
+        }
+
+        void cast(
+            runtime_node& n
+        )
+        {
+            using namespace impl::onnx;
+            auto& x = in(n, 0);
+            auto& y = out(n);
+            const size_t count = shape_size(y.shape);
+            if (x.type == INT64 && y.type == INT64)
+            {
+                y.ints = x.ints;
+            }
+            else if (x.type == INT64)
+            {
+                float* d = host(y);
+                for (size_t i = 0; i < count; ++i)
+                    d[i] = y.type == BOOL ? (x.ints[i] != 0 ? 1.f : 0.f) : static_cast<float>(x.ints[i]);
+            }
+            else if (y.type == INT64)
+            {
+                const float* s = host(x);
+                for (size_t i = 0; i < count; ++i)
+                    y.ints[i] = static_cast<int64_t>(s[i]);
+            }
+            else if (y.type == BOOL)
+            {
+                unary_kernel(n, [](float v) { return v != 0 ? 1.f : 0.f; });
+            }
+            else
+            {
+                copy_kernel<float>(n);
+            }
+        }
+
+        void constant(
+            runtime_node& n
+        )
+        {
+            using namespace impl::onnx;
+            auto& y = out(n);
+            if (n.has_attribute("value"))
+            {
+                const auto& t = n.attributes["value"].t;
+                if (y.type == INT64)
+                {
+                    y.ints = t.int64_data;
+                }
+                else
+                {
+                    float* d = host(y);
+                    if (t.float_data.empty())
+                        std::copy(t.int64_data.begin(), t.int64_data.end(), d);
+                    else
+                        std::copy(t.float_data.begin(), t.float_data.end(), d);
+                }
+            }
+            else if (n.has_attribute("value_float"))
+                host(y)[0] = n.attributes["value_float"].f;
+            else if (n.has_attribute("value_floats"))
+                std::copy(n.attributes["value_floats"].floats.begin(), n.attributes["value_floats"].floats.end(), host(y));
+            else if (n.has_attribute("value_int"))
+                y.ints.assign(1, n.attributes["value_int"].i);
+            else
+                y.ints = n.attributes["value_ints"].ints;
+        }
+
+        std::vector<runtime_value> values;
+        std::vector<runtime_node> nodes;
+        std::vector<long> graph_inputs;
+        std::vector<long> graph_outputs;
+        std::vector<std::vector<int64_t>> declared_input_shapes;
+
+        bool planned = false;
+        std::vector<std::vector<int64_t>> planned_input_shapes;
+        resizable_tensor arena;
+        size_t unplanned_size = 0;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_DNn_ONNX_IMPORT_H_
+
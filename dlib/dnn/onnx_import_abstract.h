@@ -0,0 +1,260 @@
+// Copyright (C) 2026
+// License: Boost Software License   See LICENSE.txt for the full license.
+#undef DLIB_DNn_ONNX_IMPORT_ABSTRACT_H_
+#ifdef DLIB_DNn_ONNX_IMPORT_ABSTRACT_H_
+
+#include "../cuda/tensor_abstract.h"
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    class onnx_model
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object loads an ONNX ModelProto and runs it for inference using
+                dlib's tensor tools.  It lets models trained in other frameworks be
+                deployed through the same CPU and CUDA kernels that dlib networks use,
+                without depending on protobuf or the ONNX runtime.
+
+                Loading parses the model, topologically sorts its nodes, and fuses a
+                Conv followed only by a Relu into a single convolution.  The first
+                call to forward() with a given set of input shapes then plans the
+                graph:
+                    - shapes and types are inferred for every value,
+                    - nodes whose inputs are all constants (shape arithmetic in
+                      particular) are evaluated once and folded into constants,
+                    - Reshape, Flatten, Squeeze, Unsqueeze, Identity, and Dropout
+                      become views of their inputs instead of copies,
+                    - every remaining float activation is given an offset into a
+                      single arena tensor.  Offsets are chosen so that activations
+                      whose lifetimes overlap never share memory, which lets a
+                      deep model run in a small fraction of the memory needed to
+                      keep every activation alive at once.
+                Later calls with the same input shapes reuse the plan, so they do
+                not allocate.
+
+                Values are mapped onto dlib tensors in row-major order.  A rank 4
+                value [N,C,H,W] is viewed as a tensor with num_samples()==N, k()==C,
+                nr()==H, and nc()==W.  Values of lower rank fill the leading
+                dimensions and set the rest to 1, and values of higher rank fold
+                their trailing dimensions into nc().
+
+            SUPPORTED OPERATORS
+                The default ai.onnx domain at opset 13 or newer, restricted to:
+                    Add, Sub, Mul, Div, Pow, Equal, Greater, GreaterOrEqual, Less,
+                    LessOrEqual, And, Or, Not, Where, Relu, Sigmoid, Tanh, Elu,
+                    LeakyRelu, PRelu, Softplus, Erf, Sqrt, Exp, Log, Neg, Abs,
+                    Reciprocal, Clip, Cast, Identity, Dropout (inference only),
+                    Conv and ConvTranspose (2D, group 1, no dilation, symmetric
+                    padding), Gemm, MatMul, BatchNormalization (inference only),
+                    LayerNormalization, MaxPool, AveragePool, GlobalMaxPool,
+                    GlobalAveragePool, Softmax, Reshape, Flatten, Squeeze, Unsqueeze,
+                    Transpose, Concat, Slice, Pad (constant mode), Resize (nearest
+                    and linear over the spatial dimensions), Expand, ReduceMean,
+                    ReduceSum, Gather, Shape, Constant, ConstantOfShape, and Trilu.
+                Float, double, integer, and bool tensors are accepted.  Doubles are
+                computed as floats and integers as int64.  Any other operator,
+                attribute value, or data type causes dlib::error to be thrown, when
+                the model is loaded if possible and otherwise when it is planned.
+                Every model written by net_to_onnx() is supported.
+
+            THREAD SAFETY
+                An onnx_model holds per-run state, so one object must not be used
+                by multiple threads at the same time.
+        !*/
+
+    public:
+
+        onnx_model(
+        );
+        /*!
+            ensures
+                - #num_inputs() == 0
+                - #num_outputs() == 0
+        !*/
+
+        explicit onnx_model(
+            const std::string& filename
+        );
+        /*!
+            ensures
+                - Loads the ONNX model in the given file, see load().
+        !*/
+
+        explicit onnx_model(
+            std::istream& in
+        );
+        /*!
+            ensures
+                - Loads the ONNX model read from in, see load().
+        !*/
+
+        onnx_model(const onnx_model&) = delete;
+        onnx_model& operator=(const onnx_model&) = delete;
+        onnx_model(onnx_model&&);
+        onnx_model& operator=(onnx_model&&);
+
+        void load(
+            const std::string& filename
+        );
+        /*!
+            ensures
+                - Opens filename for binary input and loads the model, as
+                  load(std::istream&) does.
+                - Throws dlib::error if the file can't be opened.
+        !*/
+
+        void load(
+            std::istream& in
+        );
+        /*!
+            ensures
+                - Reads an ONNX ModelProto from in and replaces the current model
+                  with it.
+                - Graph inputs that are also initializers are treated as constants,
+                  so #num_inputs() counts only the inputs that must be supplied to
+                  forward().
+                - Throws dlib::error if the model is malformed, stores tensors in
+                  external data files, uses an opset older than 13, has a non-float
+                  graph input, or contains an unsupported operator.
+        !*/
+
+        size_t num_inputs(
+        ) const;
+        /*!
+            ensures
+                - returns the number of tensors that must be given to forward().
+        !*/
+
+        const std::string& get_input_name(
+            size_t i
+        ) const;
+        /*!
+            requires
+                - i < num_inputs()
+            ensures
+                - returns the name of the i-th graph input.
+        !*/
+
+        const std::vector<int64_t>& get_input_shape(
+            size_t i
+        ) const;
+        /*!
+            requires
+                - i < num_inputs()
+            ensures
+                - returns the declared shape of the i-th graph input.  Dimensions
+                  that are symbolic or unknown in the model are -1.
+        !*/
+
+        size_t num_outputs(
+        ) const;
+        /*!
+            ensures
+                - returns the number of graph outputs.
+        !*/
+
+        const std::string& get_output_name(
+            size_t i
+        ) const;
+        /*!
+            requires
+                - i < num_outputs()
+            ensures
+                - returns the name of the i-th graph output.
+        !*/
+
+        size_t num_nodes(
+        ) const;
+        /*!
+            ensures
+                - returns the number of nodes in the graph after Conv/Relu fusion.
+        !*/
+
+        const tensor& forward(
+            const tensor& input
+        );
+        /*!
+            requires
+                - num_inputs() == 1
+            ensures
+                - performs forward(std::vector<const tensor*>(1, &input)).
+                - returns get_output(0).
+        !*/
+
+        void forward(
+            const std::vector<const tensor*>& inputs
+        );
+        /*!
+            requires
+                - inputs.size() == num_inputs()
+            ensures
+                - Runs the model.  inputs[i] supplies the i-th graph input.  The
+                  tensor's [N,K,NR,NC] dimensions are matched against the declared
+                  rank R of that input: the first R-1 dimensions map directly and
+                  the remaining dlib dimensions are multiplied into the last ONNX
+                  dimension.  For example, a rank 2 input [N,F] is given as a
+                  tensor with num_samples()==N and k()*nr()*nc()==F.
+                - The execution plan is rebuilt whenever the input shapes differ
+                  from the previous call.
+                - #get_output(i) contains the i-th graph output.
+                - Throws dlib::error if an input shape contradicts a fixed
+                  dimension of the model, or if the model can't be planned for
+                  these shapes.
+        !*/
+
+        const tensor& get_output(
+            size_t i = 0
+        ) const;
+        /*!
+            requires
+                - i < num_outputs()
+            ensures
+                - returns the i-th graph output computed by the last call to
+                  forward().  The tensor's dimensions follow the rank mapping
+                  described above.  Integer and bool outputs are converted to
+                  float.
+        !*/
+
+        const std::vector<int64_t>& get_output_shape(
+            size_t i = 0
+        ) const;
+        /*!
+            requires
+                - i < num_outputs()
+                - forward() has been called.
+            ensures
+                - returns the ONNX shape of the i-th graph output.
+        !*/
+
+        size_t get_arena_size(
+        ) const;
+        /*!
+            ensures
+                - returns the number of floats in the arena that holds the
+                  intermediate activations of the current plan.
+        !*/
+
+        size_t get_unplanned_activation_size(
+        ) const;
+        /*!
+            ensures
+                - returns the number of floats the arena would need if no two
+                  activations shared memory.  Comparing this with get_arena_size()
+                  shows how much the memory plan saves.
+        !*/
+    };
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_DNn_ONNX_IMPORT_ABSTRACT_H_
+
@@ -0,0 +1,1596 @@
+// Copyright (C) 2026
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_DNn_RUNTIME_NET_H_
+#define DLIB_DNn_RUNTIME_NET_H_
+
+#include "runtime_net_abstract.h"
+#include "loss.h"
+#include "../cuda/tensor.h"
+#include "../cuda/tensor_tools.h"
+#include "../error.h"
+#include "../serialize.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        namespace runtime
+        {
+            /*
+                A network written by serialize() contains the parameters of every layer but
+                not the ids of its tags, skips, and tag referencing layers, since those only
+                exist as template arguments.  The text printed by operator<< has exactly the
+                missing pieces: one line per layer, in the same top-down order that the
+                layers are serialized, with repeat layers unrolled.  The loader below walks
+                both at once.
+            */
+
+            inline std::vector<std::string> parse_architecture(
+                std::istream& in
+            )
+            {
+                std::vector<std::string> descs;
+                std::string line;
+                while (std::getline(in, line))
+                {
+                    while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t'))
+                        line.pop_back();
+                    if (line.empty())
+                        continue;
+
+                    const std::string prefix = "layer<";
+                    const auto close = line.find(">\t");
+                    if (line.compare(0, prefix.size(), prefix) != 0 || close == std::string::npos)
+                        throw dlib::error("Malformed network architecture line: " + line);
+                    const std::string idx = line.substr(prefix.size(), close - prefix.size());
+                    if (idx.empty() || idx.find_first_not_of("0123456789") != std::string::npos ||
+                        std::stoul(idx) != descs.size())
+                        throw dlib::error("Network architecture lines must be numbered 0, 1, 2, ... but found: " + line);
+
+                    std::string desc = line.substr(close + 2);
+                    // Nets that have been run print the size of each layer's output
+                    // first.  It isn't needed so drop it.
+                    if (desc.compare(0, 12, "output size=") == 0)
+                    {
+                        const auto tab = desc.find('\t');
+                        desc = tab == std::string::npos ? std::string() : desc.substr(tab + 1);
+                    }
+                    descs.push_back(desc);
+                }
+                if (descs.size() < 2)
+                    throw dlib::error("A network architecture must contain at least a layer and an input layer.");
+                return descs;
+            }
+
+            // Returns the leading identifier of a layer description, e.g. "add_prev1"
+            // for "add_prev1" or "con" for "con\t (num_filters=...".
+            inline std::string leading_word(
+                const std::string& desc
+            )
+            {
+                size_t i = 0;
+                while (i < desc.size() && (std::isalnum(static_cast<unsigned char>(desc[i])) || desc[i] == '_'))
+                    ++i;
+                return desc.substr(0, i);
+            }
+
+            inline std::string strip_trailing_digits(
+                std::string s
+            )
+            {
+                while (!s.empty() && std::isdigit(static_cast<unsigned char>(s.back())))
+                    s.pop_back();
+                return s;
+            }
+
+            // The name a layer prints as, e.g. "add_prev" for "add_prev1".
+            inline std::string text_kind(
+                const std::string& desc
+            )
+            {
+                return strip_trailing_digits(leading_word(desc));
+            }
+
+            // The tag id at the end of descriptions like "tag3" or "add_prev3".
+            inline long text_id(
+                const std::string& desc
+            )
+            {
+                const std::string word = leading_word(desc);
+                const std::string base = strip_trailing_digits(word);
+                if (base.size() == word.size())
+                    return -1;
+                return std::stol(word.substr(base.size()));
+            }
+
+            // The name a serialized version string stands for, e.g. "con" for "con_6" or
+            // "bn_con" for "bn_con2".
+            inline std::string version_kind(
+                const std::string& version
+            )
+            {
+                std::string s = strip_trailing_digits(version);
+                while (!s.empty() && s.back() == '_')
+                    s.pop_back();
+                return s;
+            }
+
+            inline bool is_input_desc(const std::string& desc) { return desc.compare(0, 5, "input") == 0; }
+            inline bool is_loss_desc(const std::string& desc) { return desc.compare(0, 5, "loss_") == 0; }
+            inline bool is_tag_desc(const std::string& desc) { return text_kind(desc) == "tag" && text_id(desc) >= 0; }
+            inline bool is_skip_desc(const std::string& desc) { return text_kind(desc) == "skip" && text_id(desc) >= 0; }
+
+        // ------------------------------------------------------------------------------------
+
+            enum class node_kind
+            {
+                loss, input, tag, skip,
+                con, cont, upsample, resize_to, reshape_to, max_pool, avg_pool,
+                layer_norm, rms_norm, fc, linear, multiply, affine,
+                add_prev, mult_prev, multm_prev, resize_prev_to_tagged, scale, scale_prev,
+                relu, prelu, leaky_relu, sig, mish, htan, clipped_relu, elu, gelu, smelu, silu,
+                softmax, softmax_all, concat, l2normalize, extract, slice, reorg, transpose,
+                positional_encodings, embeddings, tied_embeddings, tril
+            };
+
+            struct node
+            {
+                node_kind kind = node_kind::input;
+                std::string desc;
+
+                // Tag ids this layer refers to, and the nodes those tags resolve to.
+                std::vector<long> ids;
+                std::vector<long> refs;
+
+                // Layer hyperparameters.  Their meaning depends on kind.
+                long cfg[6] = {0, 0, 0, 0, 0, 0};
+                double value = 0;
+                bool use_bias = true;
+                bool use_relu = false;
+                bool disabled = false;
+                bool flag = false;
+
+                resizable_tensor params;
+                alias_tensor a1, a2;
+                resizable_tensor aux1, aux2;
+                resizable_tensor scratch1, scratch2;
+                std::unique_ptr<tt::tensor_conv> conv;
+                std::unique_ptr<tt::pooling> pool;
+
+                // Execution plan.
+                long dims[4] = {0, 0, 0, 0};
+                long alias_of = -1;
+                bool in_place = false;
+                bool owned = false;
+                size_t offset = 0;
+                long first_use = 0;
+                long last_use = -1;
+                resizable_tensor data;
+            };
+
+            inline bool writes_in_place(
+                node_kind k
+            )
+            {
+                switch (k)
+                {
+                    case node_kind::relu: case node_kind::sig: case node_kind::htan:
+                    case node_kind::leaky_relu: case node_kind::clipped_relu: case node_kind::elu:
+                    case node_kind::smelu: case node_kind::softmax: case node_kind::softmax_all:
+                    case node_kind::multiply: case node_kind::affine: case node_kind::l2normalize:
+                        return true;
+                    default:
+                        return false;
+                }
+            }
+
+            inline bool writes_owned_output(
+                node_kind k
+            )
+            {
+                // The tt:: kernels behind these layers size their own output.
+                return k == node_kind::max_pool || k == node_kind::avg_pool || k == node_kind::layer_norm ||
+                       k == node_kind::rms_norm || k == node_kind::embeddings;
+            }
+
+        // ------------------------------------------------------------------------------------
+
+            class net_parser
+            {
+                /*
+                    Recursive descent over the serialized network, guided by the
+                    architecture text.  A few objects share the same version number in the
+                    stream: a tag or skip layer and a repeat layer all start with version
+                    1, and the length of each repeated block isn't stored.  When a choice
+                    can't be made from the text alone the parser tries each alternative,
+                    rewinding the stream whenever one fails with a serialization_error.
+                */
+            public:
+                net_parser(
+                    const std::vector<std::string>& descs_,
+                    const std::string& bytes,
+                    std::vector<node>& nodes_
+                ) : descs(descs_), in(bytes), total(bytes.size()), nodes(nodes_)
+                {
+                    last = static_cast<long>(descs.size()) - 1;
+                    if (!is_input_desc(descs[last]))
+                        throw dlib::error("The last layer of a network architecture must be its input layer.");
+                }
+
+                void parse_network(
+                )
+                {
+                    try
+                    {
+                        if (is_loss_desc(descs[0]))
+                        {
+                            if (read_int() != 1)
+                                throw serialization_error("Unexpected version found while deserializing dlib::add_loss_layer.");
+                            parse_loss(nodes[0]);
+                            parse_subnet(1, -1);
+                        }
+                        else
+                        {
+                            parse_subnet(0, -1);
+                        }
+                    }
+                    catch (serialization_error& e)
+                    {
+                        throw serialization_error("The serialized network doesn't match its architecture description: " +
+                                                  std::string(e.what()));
+                    }
+                }
+
+            private:
+
+                const std::vector<std::string>& descs;
+                std::istringstream in;
+                const size_t total;
+                std::vector<node>& nodes;
+                long last;
+
+                std::streampos tell() { return in.tellg(); }
+                void seek(std::streampos pos) { in.clear(); in.seekg(pos); }
+
+                long long read_int() { long long v; deserialize(v, in); return v; }
+                unsigned long long read_uint() { unsigned long long v; deserialize(v, in); return v; }
+                double read_real() { double v; deserialize(v, in); return v; }
+                bool read_bool() { bool v; deserialize(v, in); return v; }
+                std::string read_string() { std::string v; deserialize(v, in); return v; }
+                alias_tensor read_alias() { alias_tensor v; deserialize(v, in); return v; }
+
+                void read_tensor(
+                    resizable_tensor* dest
+                )
+                {
+                    // Check the header against the bytes that are left before trusting it,
+                    // since a wrong guess about the stream's structure would otherwise
+                    // lead to absurd allocations.
+                    const auto start = tell();
+                    if (read_int() != 2)
+                        throw serialization_error("Unexpected version found while deserializing dlib::resizable_tensor.");
+                    unsigned long long size = 1;
+                    for (int i = 0; i < 4; ++i)
+                    {
+                        const long long d = read_int();
+                        if (d < 0)
+                            throw serialization_error("Negative tensor dimension found while deserializing dlib::resizable_tensor.");
+                        size *= static_cast<unsigned long long>(d);
+                        if (size > total)
+                            throw serialization_error("Tensor larger than the serialized network.");
+                    }
+                    const auto data_start = tell();
+                    if (static_cast<unsigned long long>(data_start) + 4*size > total)
+                        throw serialization_error("Tensor extends past the end of the serialized network.");
+
+                    if (dest)
+                    {
+                        seek(start);
+                        deserialize(*dest, in);
+                    }
+                    else
+                    {
+                        seek(data_start + static_cast<std::streamoff>(4*size));
+                    }
+                }
+
+                void skip_tensor() { read_tensor(nullptr); }
+
+                long bottom(long end) const { return end < 0 ? last : end; }
+
+                void parse_subnet(
+                    long i,
+                    long end
+                )
+                {
+                    if (i >= bottom(end) || is_input_desc(descs[i]) || is_loss_desc(descs[i]))
+                        throw serialization_error("Unexpected layer structure at layer " + std::to_string(i) + ".");
+
+                    const long long version = read_int();
+                    const auto pos = tell();
+
+                    if (is_tag_desc(descs[i]) || is_skip_desc(descs[i]))
+                    {
+                        const bool is_tag = is_tag_desc(descs[i]);
+                        nodes[i].kind = is_tag ? node_kind::tag : node_kind::skip;
+                        nodes[i].ids.assign(1, text_id(descs[i]));
+                        if (version == 1)
+                        {
+                            try
+                            {
+                                parse_subnet(i + 1, end);
+                                return;
+                            }
+                            catch (serialization_error&)
+                            {
+                                seek(pos);
+                            }
+                            parse_repeat(i, end);
+                            return;
+                        }
+                        if (is_tag && version == 2)
+                        {
+                            parse_bottom_input(i, end);
+                            skip_tensor(); // cached_output
+                            skip_tensor(); // grad_final
+                            read_bool();
+                            read_uint();   // sample expansion factor
+                            return;
+                        }
+                        throw serialization_error("Unexpected version found while deserializing dlib::add_tag_layer.");
+                    }
+
+                    if (version == 1)
+                    {
+                        parse_repeat(i, end);
+                    }
+                    else if (version == 2)
+                    {
+                        parse_subnet(i + 1, end);
+                        parse_details(i);
+                        read_bool();
+                        read_bool();
+                        read_bool();
+                        skip_tensor(); // x_grad
+                        skip_tensor(); // cached_output
+                        skip_tensor(); // params_grad
+                    }
+                    else if (version == 3)
+                    {
+                        parse_bottom_input(i, end);
+                        parse_details(i);
+                        read_bool();
+                        read_bool();
+                        read_bool();
+                        skip_tensor(); // x_grad
+                        skip_tensor(); // cached_output
+                        skip_tensor(); // grad_final
+                        read_uint();   // sample expansion factor
+                    }
+                    else
+                    {
+                        throw serialization_error("Unexpected version found while deserializing dlib::add_layer.");
+                    }
+                }
+
+                void parse_bottom_input(
+                    long i,
+                    long end
+                )
+                {
+                    // Inside a repeated block the input is the block below, which doesn't
+                    // appear in the stream.
+                    if (end >= 0)
+                    {
+                        if (i + 1 != end)
+                            throw serialization_error("Input layer found inside a repeated block.");
+                        return;
+                    }
+                    if (i + 1 != last)
+                        throw serialization_error("Input layer found above the bottom of the network.");
+                    parse_input(nodes[last]);
+                }
+
+                void parse_repeat(
+                    long i,
+                    long end
+                )
+                {
+                    const unsigned long long num = read_uint();
+                    const long avail = bottom(end) - i;
+                    if (num == 0 || num > static_cast<unsigned long long>(avail))
+                        throw serialization_error("Invalid number of repetitions found while deserializing dlib::repeat.");
+                    const long reps = static_cast<long>(num);
+                    const auto pos = tell();
+
+                    // Every repetition prints identically, which narrows down the
+                    // possible block lengths before anything is read.
+                    for (long len = 1; reps*len < avail; ++len)
+                    {
+                        bool same = true;
+                        for (long r = 1; r < reps && same; ++r)
+                            for (long j = 0; j < len && same; ++j)
+                                same = descs[i + j] == descs[i + r*len + j];
+                        if (!same)
+                            continue;
+
+                        try
+                        {
+                            for (long r = 0; r < reps; ++r)
+                                parse_subnet(i + r*len, i + (r + 1)*len);
+                            parse_subnet(i + reps*len, end);
+                            return;
+                        }
+                        catch (serialization_error&)
+                        {
+                            seek(pos);
+                        }
+                    }
+                    throw serialization_error("No block length matches the repeat layer at layer " + std::to_string(i) + ".");
+                }
+
+                void parse_input(
+                    node& n
+                )
+                {
+                    n.kind = node_kind::input;
+                    const std::string version = read_string();
+                    if (version == "input_rgb_image" || version == "input_rgb_image_pair")
+                    {
+                        read_real(); read_real(); read_real();
+                    }
+                    else if (version == "input_rgb_image_sized")
+                    {
+                        read_real(); read_real(); read_real();
+                        read_int(); read_int();
+                    }
+                    else if (version == "input_rgb_image_pyramid2")
+                    {
+                        read_real(); read_real(); read_real();
+                        read_uint(); read_uint();
+                    }
+                    else if (version == "input_grayscale_image_pyramid")
+                    {
+                        read_uint(); read_uint();
+                    }
+                    else if (version != "input_tensor" && version != "input<matrix>" &&
+                             version != "input<array<matrix>>" && version != "input<array2d>")
+                    {
+                        throw serialization_error("Unexpected input layer '" + version + "' found.");
+                    }
+                }
+
+                template <typename LOSS>
+                void read_loss(
+                )
+                {
+                    LOSS loss;
+                    deserialize(loss, in);
+                }
+
+                void parse_loss(
+                    node& n
+                )
+                {
+                    // Loss layers don't take part in forward() but they sit in the stream
+                    // in front of the network, so read them with their own deserialize().
+                    n.kind = node_kind::loss;
+                    const auto pos = tell();
+                    const std::string version = read_string();
+                    const std::string kind = version_kind(version);
+                    if (kind != text_kind(n.desc))
+                        throw serialization_error("Found loss '" + version + "' where the architecture has " + n.desc);
+                    seek(pos);
+
+                    if (kind == "loss_binary_hinge") read_loss<loss_binary_hinge_>();
+                    else if (kind == "loss_binary_log") read_loss<loss_binary_log_>();
+                    else if (kind == "loss_multiclass_log") read_loss<loss_multiclass_log_>();
+                    else if (kind == "loss_multiclass_log_weighted") read_loss<loss_multiclass_log_weighted_>();
+                    else if (kind == "loss_multiclass_log_chunked") read_loss<loss_multiclass_log_chunked_<tag1>>();
+                    else if (kind == "loss_multimulticlass_log") read_loss<loss_multimulticlass_log_>();
+                    else if (kind == "loss_multibinary_log") read_loss<loss_multibinary_log_>();
+                    else if (kind == "loss_mmod") read_loss<loss_mmod_>();
+                    else if (kind == "loss_metric") read_loss<loss_metric_>();
+                    else if (kind == "loss_ranking") read_loss<loss_ranking_>();
+                    else if (kind == "loss_mean_squared") read_loss<loss_mean_squared_>();
+                    else if (kind == "loss_epsilon_insensitive") read_loss<loss_epsilon_insensitive_>();
+                    else if (kind == "loss_mean_squared_multioutput") read_loss<loss_mean_squared_multioutput_>();
+                    else if (kind == "loss_binary_log_per_pixel") read_loss<loss_binary_log_per_pixel_>();
+                    else if (kind == "loss_multiclass_log_per_pixel") read_loss<loss_multiclass_log_per_pixel_>();
+                    else if (kind == "loss_multiclass_log_per_pixel_weighted") read_loss<loss_multiclass_log_per_pixel_weighted_>();
+                    else if (kind == "loss_mean_squared_per_pixel") read_loss<loss_mean_squared_per_pixel_>();
+                    else if (kind == "loss_mean_squared_per_channel_and_pixel") read_loss<loss_mean_squared_per_channel_and_pixel_<1>>();
+                    else if (kind == "loss_dot") read_loss<loss_dot_>();
+                    else if (kind == "loss_barlow_twins") read_loss<loss_barlow_twins_>();
+                    else if (kind == "loss_yolo")
+                    {
+                        read_string();
+                        read_uint();
+                        yolo_options options;
+                        deserialize(options, in);
+                    }
+                    else
+                    {
+                        throw dlib::error("runtime_net doesn't support the loss layer " + version);
+                    }
+                }
+
+                void read_multipliers(
+                    int count
+                )
+                {
+                    for (int i = 0; i < count; ++i)
+                        read_real();
+                }
+
+                void parse_details(
+                    long i
+                )
+                {
+                    // Start from a fresh node since an abandoned parse may have
+                    // filled this one in already.
+                    node fresh;
+                    fresh.desc = nodes[i].desc;
+                    nodes[i] = std::move(fresh);
+
+                    node& n = nodes[i];
+                    const std::string version = read_string();
+                    const std::string kind = version_kind(version);
+                    const std::string tkind = text_kind(n.desc);
+
+                    // multiply_ and affine_ can be built from dropout_ and bn_, in which
+                    // case the stream holds the original layer.
+                    const bool converted = (tkind == "multiply" && kind == "dropout") ||
+                                           (tkind == "affine" && (kind == "bn_con" || kind == "bn_fc"));
+                    if (kind != tkind && !converted)
+                        throw serialization_error("Found layer '" + version + "' where the architecture has " + n.desc);
+
+                    if (version == "con_4" || version == "con_5" || version == "con_6" ||
+                        version == "cont_1" || version == "cont_2")
+                    {
+                        n.kind = kind == "con" ? node_kind::con : node_kind::cont;
+                        read_tensor(&n.params);
+                        read_int();                   // num_filters
+                        read_int(); read_int();       // nr, nc
+                        n.cfg[0] = read_int();        // stride_y
+                        n.cfg[1] = read_int();        // stride_x
+                        n.cfg[2] = read_int();        // padding_y
+                        n.cfg[3] = read_int();        // padding_x
+                        n.a1 = read_alias();          // filters
+                        n.a2 = read_alias();          // biases
+                        read_multipliers(4);
+                        if (version == "con_5" || version == "con_6" || version == "cont_2")
+                            n.use_bias = read_bool();
+                        if (version == "con_6")
+                            n.use_relu = read_bool();
+                        if (n.a1.size() + (n.use_bias ? n.a2.size() : 0) > n.params.size())
+                            throw serialization_error("Parameter tensor too small while deserializing dlib::" + version);
+                    }
+                    else if (version == "upsample_")
+                    {
+                        n.kind = node_kind::upsample;
+                        n.cfg[0] = read_int();
+                        n.cfg[1] = read_int();
+                    }
+                    else if (version == "resize_to_")
+                    {
+                        n.kind = node_kind::resize_to;
+                        n.cfg[0] = read_int();
+                        n.cfg[1] = read_int();
+                        read_real(); read_real();
+                    }
+                    else if (version == "reshape_to_")
+                    {
+                        n.kind = node_kind::reshape_to;
+                        for (int j = 0; j < 6; ++j)
+                            n.cfg[j] = read_int();
+                        n.flag = read_bool();
+                    }
+                    else if (version == "max_pool_2" || version == "avg_pool_2")
+                    {
+                        n.kind = kind == "max_pool" ? node_kind::max_pool : node_kind::avg_pool;
+                        for (int j = 0; j < 6; ++j)
+                            n.cfg[j] = read_int();
+                    }
+                    else if (version == "layer_norm_")
+                    {
+                        n.kind = node_kind::layer_norm;
+                        read_tensor(&n.params);
+                        n.a1 = read_alias();
+                        n.a2 = read_alias();
+                        skip_tensor(); // means
+                        skip_tensor(); // invstds
+                        read_multipliers(4);
+                        n.value = read_real();
+                    }
+                    else if (version == "rms_norm_")
+                    {
+                        n.kind = node_kind::rms_norm;
+                        read_tensor(&n.params);
+                        n.a1 = read_alias();
+                        read_multipliers(4);
+                        n.value = read_real();
+                    }
+                    else if (version == "bn_con2" || version == "bn_fc2")
+                    {
+                        // Batch normalization runs in inference mode, which is an affine
+                        // transform with these constants.
+                        n.kind = node_kind::affine;
+                        n.flag = version == "bn_con2";
+                        resizable_tensor params, running_means, running_variances;
+                        read_tensor(&params);
+                        const alias_tensor gamma = read_alias();
+                        const alias_tensor beta = read_alias();
+                        skip_tensor(); // means
+                        skip_tensor(); // invstds
+                        read_tensor(&running_means);
+                        read_tensor(&running_variances);
+                        read_uint();   // num_updates
+                        read_uint();   // running_stats_window_size
+                        read_multipliers(4);
+                        const double eps = read_real();
+                        if (gamma.size() + beta.size() > params.size() ||
+                            running_means.size() != gamma.size() || running_variances.size() != gamma.size())
+                            throw serialization_error("Inconsistent tensors while deserializing dlib::" + version);
+
+                        n.a1 = gamma;
+                        n.a2 = beta;
+                        n.params.copy_size(params);
+                        const float* p = params.host();
+                        const float* m = running_means.host();
+                        const float* v = running_variances.host();
+                        float* g = n.params.host();
+                        float* b = g + gamma.size();
+                        for (size_t j = 0; j < gamma.size(); ++j)
+                        {
+                            g[j] = p[j]/std::sqrt(v[j] + eps);
+                            b[j] = p[gamma.size() + j] - g[j]*m[j];
+                        }
+                    }
+                    else if (version == "fc_2" || version == "fc_3")
+                    {
+                        n.kind = node_kind::fc;
+                        n.cfg[0] = read_int();    // num_outputs
+                        n.cfg[1] = read_int();    // num_inputs
+                        read_tensor(&n.params);
+                        n.a1 = read_alias();      // weights
+                        n.a2 = read_alias();      // biases
+                        const long long bias_mode = read_int();
+                        read_multipliers(4);
+                        if (version == "fc_3")
+                            n.use_bias = read_bool();
+                        n.use_bias = n.use_bias && bias_mode == 0;
+                        if (n.a1.size() + (n.use_bias ? n.a2.size() : 0) > n.params.size())
+                            throw serialization_error("Parameter tensor too small while deserializing dlib::" + version);
+                    }
+                    else if (version == "linear_")
+                    {
+                        n.kind = node_kind::linear;
+                        n.cfg[0] = read_int();    // num_outputs
+                        n.cfg[1] = read_int();    // num_inputs
+                        read_tensor(&n.params);
+                        n.a1 = read_alias();
+                        n.a2 = read_alias();
+                        n.use_bias = read_int() == 0;
+                        read_multipliers(1);
+                        if (n.a1.size() + (n.use_bias ? n.a2.size() : 0) > n.params.size())
+                            throw serialization_error("Parameter tensor too small while deserializing dlib::linear_");
+                    }
+                    else if (version == "dropout_")
+                    {
+                        // dlib's dropout doesn't rescale during training, so at inference
+                        // time it scales by the keep rate, just like multiply_(dropout_).
+                        n.kind = node_kind::multiply;
+                        n.value = 1 - read_real();
+                        skip_tensor(); // mask
+                    }
+                    else if (version == "multiply_")
+                    {
+                        n.kind = node_kind::multiply;
+                        n.value = read_real();
+                    }
+                    else if (version == "affine_" || version == "affine_2")
+                    {
+                        n.kind = node_kind::affine;
+                        read_tensor(&n.params);
+                        n.a1 = read_alias();
+                        n.a2 = read_alias();
+                        n.flag = read_int() == 0; // CONV_MODE
+                        if (version == "affine_2")
+                            n.disabled = read_bool();
+                        if (!n.disabled && n.a1.size() + n.a2.size() > n.params.size())
+                            throw serialization_error("Parameter tensor too small while deserializing dlib::affine_");
+                    }
+                    else if (version == "add_prev_" || version == "mult_prev_" || version == "multm_prev_" ||
+                             version == "resize_prev_to_tagged_")
+                    {
+                        n.kind = kind == "add_prev" ? node_kind::add_prev :
+                                 kind == "mult_prev" ? node_kind::mult_prev :
+                                 kind == "multm_prev" ? node_kind::multm_prev : node_kind::resize_prev_to_tagged;
+                        n.ids.assign(1, text_id(n.desc));
+                    }
+                    else if (version == "scale_" || version == "scale_prev_")
+                    {
+                        n.kind = kind == "scale" ? node_kind::scale : node_kind::scale_prev;
+                        n.ids.assign(1, text_id(n.desc));
+                        read_alias();
+                        read_alias();
+                    }
+                    else if (version == "relu_" || version == "relu_2")
+                    {
+                        n.kind = node_kind::relu;
+                        if (version == "relu_2")
+                            n.disabled = read_bool();
+                    }
+                    else if (version == "prelu_")
+                    {
+                        n.kind = node_kind::prelu;
+                        read_tensor(&n.params);
+                        read_real();
+                    }
+                    else if (version == "leaky_relu_" || version == "elu_" || version == "clipped_relu_" ||
+                             version == "smelu_" || version == "l2normalize_")
+                    {
+                        n.kind = kind == "leaky_relu" ? node_kind::leaky_relu :
+                                 kind == "elu" ? node_kind::elu :
+                                 kind == "clipped_relu" ? node_kind::clipped_relu :
+                                 kind == "smelu" ? node_kind::smelu : node_kind::l2normalize;
+                        n.value = read_real();
+                    }
+                    else if (version == "sig_") n.kind = node_kind::sig;
+                    else if (version == "mish_") n.kind = node_kind::mish;
+                    else if (version == "htan_") n.kind = node_kind::htan;
+                    else if (version == "gelu_") n.kind = node_kind::gelu;
+                    else if (version == "silu_") n.kind = node_kind::silu;
+                    else if (version == "softmax_all_") n.kind = node_kind::softmax_all;
+                    else if (version == "transpose_") n.kind = node_kind::transpose;
+                    else if (version == "positional_encodings_") n.kind = node_kind::positional_encodings;
+                    else if (version == "softmax_")
+                    {
+                        // The mode is a template argument, so it comes from the text.
+                        n.kind = node_kind::softmax;
+                        n.flag = n.desc.find("mode=plane_wise") != std::string::npos;
+                    }
+                    else if (version == "concat_")
+                    {
+                        n.kind = node_kind::concat;
+                        const unsigned long long count = read_uint();
+                        const auto open = n.desc.find('(');
+                        const auto close = n.desc.find(')', open);
+                        if (open == std::string::npos || close == std::string::npos)
+                            throw serialization_error("Malformed concat description: " + n.desc);
+                        std::istringstream sin(n.desc.substr(open + 1, close - open - 1));
+                        std::string id;
+                        n.ids.clear();
+                        while (std::getline(sin, id, ','))
+                            n.ids.push_back(std::stol(id));
+                        if (n.ids.size() != count)
+                            throw serialization_error("Wrong number of tags found while deserializing dlib::concat_.");
+                    }
+                    else if (version == "extract_")
+                    {
+                        n.kind = node_kind::extract;
+                        for (int j = 0; j < 4; ++j)
+                            n.cfg[j] = read_int();
+                    }
+                    else if (version == "slice_")
+                    {
+                        n.kind = node_kind::slice;
+                        for (int j = 0; j < 6; ++j)
+                            n.cfg[j] = read_int();
+                    }
+                    else if (version == "reorg_")
+                    {
+                        n.kind = node_kind::reorg;
+                        n.cfg[0] = read_int();
+                        n.cfg[1] = read_int();
+                    }
+                    else if (version == "embeddings_" || version == "embeddings_2")
+                    {
+                        n.kind = node_kind::embeddings;
+                        read_tensor(&n.params);
+                        read_uint();
+                        read_uint();
+                        read_multipliers(1);
+                        read_bool();
+                        if (version == "embeddings_2")
+                        {
+                            read_bool();
+                            read_real(); read_real(); read_real(); read_real();
+                            if (read_bool())
+                            {
+                                read_uint();
+                                read_tensor(nullptr);   // ADAM moment estimates
+                                read_tensor(nullptr);
+                            }
+                        }
+                    }
+                    else if (version == "tied_embeddings_")
+                    {
+                        n.kind = node_kind::tied_embeddings;
+                        n.ids.assign(1, text_id(n.desc));
+                    }
+                    else if (version == "tril_")
+                    {
+                        n.kind = node_kind::tril;
+                        n.cfg[0] = read_int();
+                        n.value = read_real();
+                    }
+                    else
+                    {
+                        throw dlib::error("runtime_net doesn't support the layer " + n.desc);
+                    }
+                }
+            };
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    class runtime_net
+    {
+    public:
+
+        runtime_net() = default;
+
+        runtime_net(
+            const std::string& architecture_file,
+            const std::string& net_file
+        )
+        {
+            load(architecture_file, net_file);
+        }
+
+        runtime_net(
+            std::istream& architecture,
+            std::istream& net
+        )
+        {
+            load(architecture, net);
+        }
+
+        runtime_net(const runtime_net&) = delete;
+        runtime_net& operator=(const runtime_net&) = delete;
+        runtime_net(runtime_net&&) = default;
+        runtime_net& operator=(runtime_net&&) = default;
+
+        void load(
+            const std::string& architecture_file,
+            const std::string& net_file
+        )
+        {
+            std::ifstream farch(architecture_file);
+            if (!farch)
+                throw dlib::error("Unable to open network architecture file: " + architecture_file);
+            std::ifstream fnet(net_file, std::ios::binary);
+            if (!fnet)
+                throw dlib::error("Unable to open network file: " + net_file);
+            load(farch, fnet);
+        }
+
+        void load(
+            std::istream& architecture,
+            std::istream& net
+        )
+        {
+            using namespace impl::runtime;
+
+            const std::vector<std::string> descs = parse_architecture(architecture);
+            const std::string bytes((std::istreambuf_iterator<char>(net)), std::istreambuf_iterator<char>());
+            if (net.bad())
+                throw dlib::error("Error while reading the serialized network.");
+
+            std::vector<node> new_nodes(descs.size());
+            for (size_t i = 0; i < descs.size(); ++i)
+                new_nodes[i].desc = descs[i];
+            net_parser(descs, bytes, new_nodes).parse_network();
+
+            // Every tag reference resolves to the nearest tag with that id below the
+            // layer, which is what layer<tag>() finds in a template network.
+            for (size_t i = 0; i < new_nodes.size(); ++i)
+            {
+                auto& n = new_nodes[i];
+                if (n.kind == node_kind::tag || n.kind == node_kind::loss || n.kind == node_kind::input)
+                    continue;
+                n.refs.clear();
+                for (auto id : n.ids)
+                {
+                    long found = -1;
+                    for (size_t j = i + 1; j < new_nodes.size() && found < 0; ++j)
+                    {
+                        if (new_nodes[j].kind == node_kind::tag && new_nodes[j].ids[0] == id)
+                            found = static_cast<long>(j);
+                    }
+                    if (found < 0)
+                        throw dlib::error("Layer " + std::to_string(i) + " (" + n.desc + ") refers to tag " +
+                                          std::to_string(id) + " but there is no such tag below it.");
+                    n.refs.push_back(found);
+                }
+            }
+
+            nodes = std::move(new_nodes);
+            planned = false;
+            arena.clear();
+            output.clear();
+        }
+
+        size_t num_layers(
+        ) const { return nodes.size(); }
+
+        const std::string& get_layer_description(
+            size_t i
+        ) const
+        {
+            DLIB_CASSERT(i < num_layers());
+            return nodes[i].desc;
+        }
+
+        bool has_loss(
+        ) const { return !nodes.empty() && nodes[0].kind == impl::runtime::node_kind::loss; }
+
+        const tensor& forward(
+            const tensor& x
+        )
+        {
+            DLIB_CASSERT(num_layers() != 0, "runtime_net::forward() called before a network was loaded.");
+            const long shape[4] = {x.num_samples(), x.k(), x.nr(), x.nc()};
+            if (!planned || !std::equal(shape, shape + 4, planned_shape))
+                plan(shape);
+
+            const long last = static_cast<long>(nodes.size()) - 1;
+            {
+                auto in = view(last);
+                memcpy(in, x);
+            }
+            for (long i = last - 1; i >= output_index(); --i)
+                execute(i);
+
+            memcpy(output, view(output_index()));
+            return output;
+        }
+
+        const tensor& get_output(
+        ) const { return output; }
+
+        size_t get_arena_size(
+        ) const { return arena.size(); }
+
+        size_t get_unplanned_activation_size(
+        ) const { return unplanned_size; }
+
+    private:
+
+        typedef impl::runtime::node node;
+        typedef impl::runtime::node_kind node_kind;
+
+        long output_index() const { return has_loss() ? 1 : 0; }
+
+        long root(
+            long i
+        ) const
+        {
+            while (nodes[i].alias_of >= 0)
+                i = nodes[i].alias_of;
+            return i;
+        }
+
+        alias_tensor_instance view(
+            long i,
+            long n,
+            long k,
+            long nr,
+            long nc
+        )
+        {
+            node& r = nodes[root(i)];
+            alias_tensor a(n, k, nr, nc);
+            return r.owned ? a(r.data, 0) : a(arena, r.offset);
+        }
+
+        alias_tensor_instance view(
+            long i
+        )
+        {
+            const auto& d = nodes[i].dims;
+            return view(i, d[0], d[1], d[2], d[3]);
+        }
+
+    // ------------------------------------------------------------------------------------
+    //                                      planning
+    // ------------------------------------------------------------------------------------
+
+        [[noreturn]] void shape_error(
+            long i,
+            const std::string& why
+        ) const
+        {
+            throw dlib::error("runtime_net can't run layer " + std::to_string(i) + " (" + nodes[i].desc + "): " + why);
+        }
+
+        void infer_shape(
+            long i
+        )
+        {
+            node& n = nodes[i];
+            const long* in = nodes[i + 1].dims;
+            long* d = n.dims;
+            std::copy(in, in + 4, d);
+            const auto& c = n.cfg;
+
+            // A network that was never run hasn't allocated its parameters yet.
+            const bool has_params = n.kind == node_kind::con || n.kind == node_kind::cont ||
+                n.kind == node_kind::fc || n.kind == node_kind::linear || n.kind == node_kind::layer_norm ||
+                n.kind == node_kind::rms_norm || n.kind == node_kind::prelu || n.kind == node_kind::embeddings ||
+                (n.kind == node_kind::affine && !n.disabled);
+            if (has_params && n.params.size() == 0)
+                shape_error(i, "it has no parameters.  Only networks that have been run or trained can be loaded.");
+
+            switch (n.kind)
+            {
+                case node_kind::tag: break;
+                case node_kind::skip: std::copy(nodes[n.refs[0]].dims, nodes[n.refs[0]].dims + 4, d); break;
+                case node_kind::con:
+                {
+                    if (n.a1.k() != in[1])
+                        shape_error(i, "its filters expect " + std::to_string(n.a1.k()) + " input channels.");
+                    d[1] = n.a1.num_samples();
+                    d[2] = 1 + (in[2] + 2*c[2] - n.a1.nr())/c[0];
+                    d[3] = 1 + (in[3] + 2*c[3] - n.a1.nc())/c[1];
+                    break;
+                }
+                case node_kind::cont:
+                {
+                    if (n.a1.num_samples() != in[1])
+                        shape_error(i, "its filters expect " + std::to_string(n.a1.num_samples()) + " input channels.");
+                    d[1] = n.a1.k();
+                    d[2] = c[0]*(in[2] - 1) + n.a1.nr() - 2*c[2];
+                    d[3] = c[1]*(in[3] - 1) + n.a1.nc() - 2*c[3];
+                    break;
+                }
+                case node_kind::upsample: d[2] = c[0]*in[2]; d[3] = c[1]*in[3]; break;
+                case node_kind::resize_to: d[2] = c[0]; d[3] = c[1]; break;
+                case node_kind::reshape_to:
+                {
+                    d[1] = c[3]; d[2] = c[4]; d[3] = c[5];
+                    if (!n.flag && d[1]*d[2]*d[3] != in[1]*in[2]*in[3])
+                        shape_error(i, "the input has the wrong number of elements.");
+                    if (n.flag && d[1] != in[1])
+                        shape_error(i, "rescaling can't change the number of channels.");
+                    break;
+                }
+                case node_kind::max_pool: case node_kind::avg_pool:
+                {
+                    const long wnr = c[0] != 0 ? c[0] : in[2];
+                    const long wnc = c[1] != 0 ? c[1] : in[3];
+                    if (wnr > in[2] + 2*c[4] || wnc > in[3] + 2*c[5])
+                        shape_error(i, "the pooling window is larger than the input.");
+                    d[2] = 1 + (in[2] + 2*c[4] - wnr)/c[2];
+                    d[3] = 1 + (in[3] + 2*c[5] - wnc)/c[3];
+                    if (!n.pool)
+                        n.pool.reset(new tt::pooling());
+                    if (n.kind == node_kind::max_pool)
+                        n.pool->setup_max_pooling(wnr, wnc, c[2], c[3], c[4], c[5]);
+                    else
+                        n.pool->setup_avg_pooling(wnr, wnc, c[2], c[3], c[4], c[5]);
+                    break;
+                }
+                case node_kind::fc:
+                {
+                    if (in[1]*in[2]*in[3] != c[1])
+                        shape_error(i, "it expects " + std::to_string(c[1]) + " inputs per sample.");
+                    d[1] = c[0]; d[2] = 1; d[3] = 1;
+                    break;
+                }
+                case node_kind::linear:
+                {
+                    if (in[3] != c[1])
+                        shape_error(i, "it expects inputs with nc() == " + std::to_string(c[1]) + ".");
+                    d[3] = c[0];
+                    break;
+                }
+                case node_kind::add_prev: case node_kind::mult_prev:
+                {
+                    const long* t = nodes[n.refs[0]].dims;
+                    for (int j = 0; j < 4; ++j)
+                        d[j] = std::max(in[j], t[j]);
+                    break;
+                }
+                case node_kind::multm_prev:
+                {
+                    const long* t = nodes[n.refs[0]].dims;
+                    if (in[0] != t[0] || in[1] != t[1] || in[3] != t[2])
+                        shape_error(i, "the matrices can't be multiplied.");
+                    d[3] = t[3];
+                    break;
+                }
+                case node_kind::resize_prev_to_tagged:
+                {
+                    const long* t = nodes[n.refs[0]].dims;
+                    if (in[0] != t[0])
+                        shape_error(i, "the tagged layer has a different number of samples.");
+                    d[2] = t[2]; d[3] = t[3];
+                    break;
+                }
+                case node_kind::scale: case node_kind::scale_prev:
+                {
+                    const long* src = n.kind == node_kind::scale ? nodes[n.refs[0]].dims : in;
+                    const long* scales = n.kind == node_kind::scale ? in : nodes[n.refs[0]].dims;
+                    if (scales[0] != src[0] || scales[1] != src[1] || scales[2] != 1 || scales[3] != 1)
+                        shape_error(i, "the scales don't match the channels being scaled.");
+                    std::copy(src, src + 4, d);
+                    break;
+                }
+                case node_kind::concat:
+                {
+                    const long* first = nodes[n.refs[0]].dims;
+                    std::copy(first, first + 4, d);
+                    d[1] = 0;
+                    for (auto r : n.refs)
+                    {
+                        const long* t = nodes[r].dims;
+                        if (t[0] != d[0] || t[2] != d[2] || t[3] != d[3])
+                            shape_error(i, "the concatenated tensors have different shapes.");
+                        d[1] += t[1];
+                    }
+                    break;
+                }
+                case node_kind::extract:
+                {
+                    if (c[0] + c[1]*c[2]*c[3] > in[1]*in[2]*in[3])
+                        shape_error(i, "the extracted range is outside the input.");
+                    d[1] = c[1]; d[2] = c[2]; d[3] = c[3];
+                    break;
+                }
+                case node_kind::slice:
+                {
+                    if (c[0] + c[3] > in[1] || c[1] + c[4] > in[2] || c[2] + c[5] > in[3])
+                        shape_error(i, "the slice is outside the input.");
+                    d[1] = c[3]; d[2] = c[4]; d[3] = c[5];
+                    break;
+                }
+                case node_kind::reorg:
+                {
+                    if (in[2] % c[0] != 0 || in[3] % c[1] != 0)
+                        shape_error(i, "the input size isn't divisible by the reorg strides.");
+                    d[1] = in[1]*c[0]*c[1]; d[2] = in[2]/c[0]; d[3] = in[3]/c[1];
+                    break;
+                }
+                case node_kind::transpose: d[2] = in[3]; d[3] = in[2]; break;
+                case node_kind::embeddings: d[3] = n.params.k(); break;
+                case node_kind::tied_embeddings:
+                {
+                    // The table belongs to the embeddings layer the tag is applied to.
+                    const long t = n.refs[0] + 1;
+                    if (t >= static_cast<long>(nodes.size()) || nodes[t].kind != node_kind::embeddings)
+                        shape_error(i, "its tag isn't applied to an embeddings layer.");
+                    n.cfg[0] = t;
+                    const long dim = nodes[t].params.k();
+                    if (in[1]*in[2]*in[3] == dim)
+                    {
+                        d[1] = nodes[t].params.num_samples(); d[2] = 1; d[3] = 1;
+                    }
+                    else if (in[3] == dim)
+                    {
+                        d[3] = nodes[t].params.num_samples();
+                    }
+                    else
+                    {
+                        shape_error(i, "it expects vectors of " + std::to_string(dim) + " values.");
+                    }
+                    break;
+                }
+                case node_kind::positional_encodings: setup_positional_encodings(n); break;
+                case node_kind::tril: setup_tril(n); break;
+                default: break;
+            }
+            for (int j = 0; j < 4; ++j)
+            {
+                if (d[j] <= 0)
+                    shape_error(i, "it would produce an empty output.");
+            }
+        }
+
+        void setup_positional_encodings(
+            node& n
+        )
+        {
+            const long* d = n.dims;
+            n.aux1.set_size(d[0], d[1], d[2], d[3]);
+            float* pe = n.aux1.host();
+            for (long s = 0; s < d[0]; ++s)
+            {
+                for (long k = 0; k < d[1]; ++k)
+                {
+                    for (long r = 0; r < d[2]; ++r)
+                    {
+                        for (long c = 0; c < d[3]; ++c)
+                        {
+                            const float theta = static_cast<float>(r)/std::pow(10000.0f, static_cast<float>(c)/d[3]);
+                            *pe++ = c % 2 == 0 ? std::sin(theta) : std::cos(theta);
+                        }
+                    }
+                }
+            }
+        }
+
+        void setup_tril(
+            node& n
+        )
+        {
+            const long* d = n.dims;
+            const float diag_value = static_cast<float>(n.value);
+            n.aux1.set_size(d[0], d[1], d[2], d[3]);
+            n.aux1 = 1;
+            if (diag_value != 0)
+            {
+                n.aux2.copy_size(n.aux1);
+                n.aux2 = 0;
+            }
+            float* mask = n.aux1.host();
+            float* fill = diag_value != 0 ? n.aux2.host() : nullptr;
+            for (long s = 0; s < d[0]*d[1]; ++s)
+            {
+                for (long r = 0; r < d[2]; ++r)
+                {
+                    for (long c = std::max(r + n.cfg[0] + 1, 0L); c < d[3]; ++c)
+                    {
+                        const long idx = (s*d[2] + r)*d[3] + c;
+                        mask[idx] = 0;
+                        if (fill)
+                            fill[idx] = diag_value;
+                    }
+                }
+            }
+        }
+
+        void plan(
+            const long* shape
+        )
+        {
+            const long last = static_cast<long>(nodes.size()) - 1;
+            const long top = output_index();
+            // Nodes run bottom-up, so node i runs at position pos(i).
+            const auto pos = [&](long i) { return last - i; };
+
+            std::copy(shape, shape + 4, nodes[last].dims);
+            for (auto& n : nodes)
+            {
+                n.alias_of = -1;
+                n.in_place = false;
+                n.owned = false;
+                n.last_use = -1;
+            }
+            for (long i = last - 1; i >= top; --i)
+                infer_shape(i);
+
+            // Layers that only pass a tensor through become views of it.
+            for (long i = last - 1; i >= top; --i)
+            {
+                node& n = nodes[i];
+                if (n.kind == node_kind::tag || n.disabled || (n.kind == node_kind::reshape_to && !n.flag))
+                    n.alias_of = i + 1;
+                else if (n.kind == node_kind::skip)
+                    n.alias_of = n.refs[0];
+            }
+
+            // The last position at which each tensor is read.
+            for (long i = last - 1; i >= top; --i)
+            {
+                const node& n = nodes[i];
+                if (n.alias_of >= 0)
+                    continue;
+                nodes[root(i + 1)].last_use = std::max(nodes[root(i + 1)].last_use, pos(i));
+                for (auto r : n.refs)
+                    nodes[root(r)].last_use = std::max(nodes[root(r)].last_use, pos(i));
+            }
+
+            // Layers that dlib runs in place overwrite their input when nothing else
+            // reads it later.
+            for (long i = last - 1; i >= top; --i)
+            {
+                node& n = nodes[i];
+                if (n.alias_of >= 0 || !impl::runtime::writes_in_place(n.kind))
+                    continue;
+                const long r = root(i + 1);
+                if (nodes[r].last_use != pos(i) || static_cast<size_t>(n.dims[0]*n.dims[1]*n.dims[2]*n.dims[3]) != tensor_size(r))
+                    continue;
+                nodes[r].last_use = std::max(nodes[r].last_use, n.last_use);
+                n.alias_of = i + 1;
+                n.in_place = true;
+            }
+
+            // The network output is copied out after the last layer has run.
+            nodes[root(top)].last_use = pos(top) + 1;
+
+            struct block
+            {
+                long id;
+                size_t offset;
+                size_t size;
+            };
+            std::vector<block> candidates;
+            unplanned_size = 0;
+            for (long i = last; i >= top; --i)
+            {
+                node& n = nodes[i];
+                if (n.kind == node_kind::tag || n.kind == node_kind::skip)
+                    continue;
+                if (impl::runtime::writes_owned_output(n.kind))
+                {
+                    n.owned = true;
+                    n.data.set_size(n.dims[0], n.dims[1], n.dims[2], n.dims[3]);
+                    continue;
+                }
+                // In-place and pass-through layers are counted as dlib's template
+                // networks would store them, each with its own output.
+                const size_t size = (tensor_size(i) + 15)/16*16;
+                unplanned_size += size;
+                if (n.alias_of >= 0)
+                    continue;
+                n.first_use = pos(i);
+                n.last_use = std::max(n.last_use, pos(i));
+                candidates.push_back(block{i, 0, size});
+            }
+
+            // Greedy best-fit by decreasing size, as in onnx_model: each block goes at
+            // the lowest offset that doesn't overlap a block whose lifetime intersects
+            // its own.
+            std::sort(candidates.begin(), candidates.end(), [](const block& a, const block& b) {
+                return a.size > b.size || (a.size == b.size && a.id < b.id);
+            });
+            std::vector<block> placed;
+            size_t arena_size = 0;
+            for (auto& c : candidates)
+            {
+                const node& cn = nodes[c.id];
+                size_t offset = 0;
+                for (const auto& b : placed)
+                {
+                    const node& bn = nodes[b.id];
+                    if (bn.last_use < cn.first_use || cn.last_use < bn.first_use)
+                        continue;
+                    if (offset + c.size <= b.offset)
+                        break;
+                    offset = std::max(offset, b.offset + b.size);
+                }
+                c.offset = offset;
+                nodes[c.id].offset = offset;
+                arena_size = std::max(arena_size, offset + c.size);
+                placed.insert(std::upper_bound(placed.begin(), placed.end(), c,
+                    [](const block& a, const block& b) { return a.offset < b.offset; }), c);
+            }
+            arena.set_size(arena_size);
+
+            const long* d = nodes[top].dims;
+            output.set_size(d[0], d[1], d[2], d[3]);
+            std::copy(shape, shape + 4, planned_shape);
+            planned = true;
+        }
+
+        size_t tensor_size(
+            long i
+        ) const
+        {
+            const long* d = nodes[i].dims;
+            return static_cast<size_t>(d[0]*d[1]*d[2]*d[3]);
+        }
+
+    // ------------------------------------------------------------------------------------
+    //                                      execution
+    // ------------------------------------------------------------------------------------
+
+        void execute(
+            long i
+        )
+        {
+            node& n = nodes[i];
+            // Layers that pass their input through have nothing to compute.
+            if (n.alias_of >= 0 && !n.in_place)
+                return;
+
+            const long* d = n.dims;
+            auto src = view(i + 1);
+            const auto& c = n.cfg;
+
+            switch (n.kind)
+            {
+                case node_kind::con:
+                {
+                    auto dest = view(i);
+                    auto filters = n.a1(n.params, 0);
+                    if (!n.conv)
+                        n.conv.reset(new tt::tensor_conv());
+                    n.conv->setup(src, filters, c[0], c[1], c[2], c[3]);
+                    if (n.use_bias)
+                        (*n.conv)(false, dest, src, filters, n.a2(n.params, filters.size()), n.use_relu);
+                    else
+                        (*n.conv)(false, dest, src, filters);
+                    break;
+                }
+                case node_kind::cont:
+                {
+                    auto dest = view(i);
+                    auto filters = n.a1(n.params, 0);
+                    if (!n.conv)
+                        n.conv.reset(new tt::tensor_conv());
+                    n.conv->setup(dest, filters, c[0], c[1], c[2], c[3]);
+                    n.conv->get_gradient_for_data(false, src, filters, dest);
+                    if (n.use_bias)
+                        tt::add(1, dest, 1, n.a2(n.params, filters.size()));
+                    break;
+                }
+                case node_kind::upsample: case node_kind::resize_to:
+                {
+                    auto dest = view(i);
+                    tt::resize_bilinear(dest, src);
+                    break;
+                }
+                case node_kind::reshape_to:
+                {
+                    auto dest = view(i);
+                    tt::resize_bilinear(dest, src);
+                    break;
+                }
+                case node_kind::max_pool: case node_kind::avg_pool: (*n.pool)(n.data, src); break;
+                case node_kind::layer_norm:
+                    tt::layer_normalize(n.value, n.data, n.scratch1, n.scratch2, src,
+                                        n.a1(n.params, 0), n.a2(n.params, n.a1.size()));
+                    break;
+                case node_kind::rms_norm: tt::rms_normalize(n.value, n.data, n.scratch1, src, n.a1(n.params, 0)); break;
+                case node_kind::fc:
+                {
+                    auto dest = view(i);
+                    auto w = n.a1(n.params, 0);
+                    tt::gemm(0, dest, 1, src, false, w, false);
+                    if (n.use_bias)
+                        tt::add(1, dest, 1, n.a2(n.params, n.a1.size()));
+                    break;
+                }
+                case node_kind::linear:
+                {
+                    const long rows = d[0]*d[1]*d[2];
+                    auto dest = view(i, rows, c[0], 1, 1);
+                    auto lhs = view(i + 1, rows, c[1], 1, 1);
+                    auto w = n.a1(n.params, 0);
+                    tt::gemm(0, dest, 1, lhs, false, w, false);
+                    if (n.use_bias)
+                        tt::add(1, dest, 1, n.a2(n.params, n.a1.size()));
+                    break;
+                }
+                case node_kind::multiply: { auto dest = view(i); tt::affine_transform(dest, src, n.value); break; }
+                case node_kind::affine:
+                {
+                    auto dest = view(i);
+                    auto g = n.a1(n.params, 0);
+                    auto b = n.a2(n.params, n.a1.size());
+                    if (n.flag)
+                        tt::affine_transform_conv(dest, src, g, b);
+                    else
+                        tt::affine_transform(dest, src, g, b);
+                    break;
+                }
+                case node_kind::add_prev: { auto dest = view(i); tt::add(dest, src, view(n.refs[0])); break; }
+                case node_kind::mult_prev: { auto dest = view(i); tt::multiply_zero_padded(false, dest, src, view(n.refs[0])); break; }
+                case node_kind::multm_prev:
+                {
+                    auto dest = view(i);
+                    tt::gemm(0, dest, 1, src, false, view(n.refs[0]), false, operation_mode::PLANE_WISE);
+                    break;
+                }
+                case node_kind::resize_prev_to_tagged:
+                {
+                    auto dest = view(i);
+                    if (src.nr() == dest.nr() && src.nc() == dest.nc())
+                        tt::copy_tensor(false, dest, 0, src, 0, src.k());
+                    else
+                        tt::resize_bilinear(dest, src);
+                    break;
+                }
+                case node_kind::scale: { auto dest = view(i); tt::scale_channels(false, dest, view(n.refs[0]), src); break; }
+                case node_kind::scale_prev: { auto dest = view(i); tt::scale_channels(false, dest, src, view(n.refs[0])); break; }
+                case node_kind::relu: { auto dest = view(i); tt::relu(dest, src); break; }
+                case node_kind::prelu: { auto dest = view(i); tt::prelu(dest, src, n.params); break; }
+                case node_kind::leaky_relu: { auto dest = view(i); tt::leaky_relu(dest, src, n.value); break; }
+                case node_kind::sig: { auto dest = view(i); tt::sigmoid(dest, src); break; }
+                case node_kind::mish: { auto dest = view(i); tt::mish(dest, src); break; }
+                case node_kind::htan: { auto dest = view(i); tt::tanh(dest, src); break; }
+                case node_kind::clipped_relu: { auto dest = view(i); tt::clipped_relu(dest, src, n.value); break; }
+                case node_kind::elu: { auto dest = view(i); tt::elu(dest, src, n.value); break; }
+                case node_kind::gelu: { auto dest = view(i); tt::gelu(dest, src); break; }
+                case node_kind::smelu: { auto dest = view(i); tt::smelu(dest, src, n.value); break; }
+                case node_kind::silu: { auto dest = view(i); tt::silu(dest, src); break; }
+                case node_kind::softmax:
+                {
+                    auto dest = view(i);
+                    tt::softmax(dest, src, n.flag ? operation_mode::PLANE_WISE : operation_mode::CHANNEL_WISE);
+                    break;
+                }
+                case node_kind::softmax_all: { auto dest = view(i); tt::softmax_all(dest, src); break; }
+                case node_kind::concat:
+                {
+                    auto dest = view(i);
+                    size_t k_offset = 0;
+                    for (auto r : n.refs)
+                    {
+                        auto t = view(r);
+                        tt::copy_tensor(false, dest, k_offset, t, 0, t.k());
+                        k_offset += t.k();
+                    }
+                    break;
+                }
+                case node_kind::l2normalize:
+                {
+                    auto dest = view(i);
+                    tt::inverse_norms(n.scratch1, src, n.value);
+                    tt::scale_rows(dest, src, n.scratch1);
+                    break;
+                }
+                case node_kind::extract:
+                {
+                    const long count = c[1]*c[2]*c[3];
+                    auto dest = view(i, d[0], count, 1, 1);
+                    auto in = view(i + 1, d[0], static_cast<long>(src.size())/d[0], 1, 1);
+                    tt::copy_tensor(false, dest, 0, in, c[0], count);
+                    break;
+                }
+                case node_kind::slice:
+                {
+                    auto dest = view(i);
+                    tt::copy_tensor(false, dest, 0, 0, 0, src, c[0], c[1], c[2], c[3], c[4], c[5]);
+                    break;
+                }
+                case node_kind::reorg: { auto dest = view(i); tt::reorg(false, dest, c[0], c[1], src); break; }
+                case node_kind::transpose: { auto dest = view(i); tt::transpose(false, dest, src); break; }
+                case node_kind::positional_encodings: { auto dest = view(i); tt::add(dest, src, n.aux1); break; }
+                case node_kind::embeddings: tt::embeddings(n.data, src, n.params); break;
+                case node_kind::tied_embeddings:
+                {
+                    const tensor& embs = nodes[c[0]].params;
+                    const long rows = src.size()/embs.k();
+                    auto dest = view(i, rows, embs.num_samples(), 1, 1);
+                    auto lhs = view(i + 1, rows, embs.k(), 1, 1);
+                    tt::gemm(0, dest, 1, lhs, false, embs, true);
+                    break;
+                }
+                case node_kind::tril:
+                {
+                    auto dest = view(i);
+                    tt::multiply(false, dest, src, n.aux1);
+                    if (n.aux2.size() != 0)
+                        tt::add(1, dest, 1, n.aux2);
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+
+        std::vector<node> nodes;
+        resizable_tensor arena;
+        resizable_tensor output;
+        size_t unplanned_size = 0;
+        bool planned = false;
+        long planned_shape[4] = {0, 0, 0, 0};
+    };
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_DNn_RUNTIME_NET_H_
+
@@ -0,0 +1,200 @@
+// Copyright (C) 2026
+// License: Boost Software License   See LICENSE.txt for the full license.
+#undef DLIB_DNn_RUNTIME_NET_ABSTRACT_H_
+#ifdef DLIB_DNn_RUNTIME_NET_ABSTRACT_H_
+
+#include "../cuda/tensor_abstract.h"
+#include <iosfwd>
+#include <string>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    class runtime_net
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object runs a dlib network whose structure is only known at run
+                time.  A network's layers are normally fixed by its C++ type, so every
+                architecture change means recompiling, and deep networks have very large
+                types that are slow to compile.  A runtime_net instead builds its layer
+                graph while loading, which lets a single program run any network that was
+                trained elsewhere, using the same tt:: kernels as the template network.
+
+                A network is loaded from two things that a template network already
+                produces:
+                    - the file written by serialize(), e.g. serialize("net.dat") << net;
+                    - the description printed by operator<<, e.g. std::ofstream("net.txt") << net;
+                The description is needed because serialize() doesn't store the ids of
+                tag layers, skip layers, or the layers that refer to tags (add_prev,
+                concat, etc.), since those are template arguments.  Either the
+                description of a freshly constructed network or of one that has already
+                been run may be used.
+
+                Layers run bottom-up.  Layers that only pass their input through (tags,
+                skips, disabled layers, and reshape_to layers that don't rescale) become
+                views of their input, and layers that dlib runs in place overwrite their
+                input whenever no later layer reads it.  Every other output is given an
+                offset into a single arena tensor, chosen so that outputs whose lifetimes
+                overlap never share memory.  The plan is made by the first call to
+                forward() and reused as long as the input shape doesn't change.
+
+            SUPPORTED LAYERS
+                con, cont, upsample, resize_to, reshape_to, max_pool, avg_pool,
+                layer_norm, rms_norm, bn_con, bn_fc, fc, linear, dropout, multiply,
+                affine, add_prev, mult_prev, multm_prev, resize_prev_to_tagged, scale,
+                scale_prev, relu, prelu, leaky_relu, sig, mish, htan, clipped_relu, elu,
+                gelu, smelu, silu, softmax, softmaxm, softmax_all, concat, l2normalize,
+                extract, slice, reorg, transpose, positional_encodings, embeddings,
+                tied_embeddings, tril, tag and skip layers, and repeat layers, over any of dlib's input
+                layers and with any of dlib's loss layers.
+
+                forward() always computes what the network computes at inference time:
+                    - bn_con and bn_fc normalize with their running statistics, as they
+                      do in a template network when given a single sample, and as the
+                      affine layer that usually replaces them does.
+                    - dropout scales its input by 1-drop_rate, as the multiply layer
+                      that usually replaces it does.
+
+            THREAD SAFETY
+                A runtime_net holds per-run state, so one object must not be used by
+                multiple threads at the same time.
+        !*/
+
+    public:
+
+        runtime_net(
+        );
+        /*!
+            ensures
+                - #num_layers() == 0
+        !*/
+
+        runtime_net(
+            const std::string& architecture_file,
+            const std::string& net_file
+        );
+        /*!
+            ensures
+                - Loads the network in the given files, see load().
+        !*/
+
+        runtime_net(
+            std::istream& architecture,
+            std::istream& net
+        );
+        /*!
+            ensures
+                - Loads the network read from the given streams, see load().
+        !*/
+
+        runtime_net(const runtime_net&) = delete;
+        runtime_net& operator=(const runtime_net&) = delete;
+        runtime_net(runtime_net&&);
+        runtime_net& operator=(runtime_net&&);
+
+        void load(
+            const std::string& architecture_file,
+            const std::string& net_file
+        );
+        /*!
+            ensures
+                - Opens both files and loads the network, as load(std::istream&,
+                  std::istream&) does.
+                - Throws dlib::error if either file can't be opened.
+        !*/
+
+        void load(
+            std::istream& architecture,
+            std::istream& net
+        );
+        /*!
+            ensures
+                - Reads the text printed by operator<< for a network from architecture,
+                  and the bytes written by serialize() for the same network from net,
+                  and replaces the current network with it.
+                - #num_layers() == the number of lines in the architecture text.
+                - Throws serialization_error if the two don't describe the same
+                  network.
+                - Throws dlib::error if the text is malformed or the network contains
+                  an unsupported layer.
+        !*/
+
+        size_t num_layers(
+        ) const;
+        /*!
+            ensures
+                - returns the number of layers in the network, counted as operator<<
+                  counts them: repeat layers are unrolled, and the loss and input layers
+                  are included.
+        !*/
+
+        const std::string& get_layer_description(
+            size_t i
+        ) const;
+        /*!
+            requires
+                - i < num_layers()
+            ensures
+                - returns the description of the i-th layer, as printed by operator<<
+                  but without the output size.
+        !*/
+
+        bool has_loss(
+        ) const;
+        /*!
+            ensures
+                - returns true if the top layer of the network is a loss layer.
+        !*/
+
+        const tensor& forward(
+            const tensor& x
+        );
+        /*!
+            requires
+                - num_layers() != 0
+                - x is a tensor the network's input layer could produce, e.g. the
+                  output of to_tensor() on the template network's input layer.
+            ensures
+                - Runs the network on x and returns get_output().
+                - The execution plan is rebuilt whenever x has a different shape than
+                  in the previous call.
+                - Throws dlib::error if x has a shape some layer can't accept.
+        !*/
+
+        const tensor& get_output(
+        ) const;
+        /*!
+            ensures
+                - returns the output of the layer below the loss layer, or of the top
+                  layer if there is no loss layer, as computed by the last call to
+                  forward().  This is what net.subnet().get_output() holds in the
+                  template network.
+        !*/
+
+        size_t get_arena_size(
+        ) const;
+        /*!
+            ensures
+                - returns the number of floats in the arena that holds the layer outputs
+                  of the current plan.
+        !*/
+
+        size_t get_unplanned_activation_size(
+        ) const;
+        /*!
+            ensures
+                - returns the number of floats needed to give every layer its own
+                  output, as a template network does.  Comparing this with
+                  get_arena_size() shows how much the memory plan saves.
+        !*/
+    };
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_DNn_RUNTIME_NET_ABSTRACT_H_
+
@@ -7,9 +7,92 @@
 #include "../cuda/tensor.h"
 #include <iostream>
 #include "layers.h"
+#include <type_traits>
+#include <vector>
 
 namespace dlib
 {
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        struct solver_bias_split
+        {
+            // The parameters in [offset, params.size()) are biases and get these extra
+            // multipliers.
+            size_t offset;
+            double learning_rate_multiplier;
+            double weight_decay_multiplier;
+        };
+
+        template <typename layer_type>
+        solver_bias_split get_solver_bias_split(const layer_type&, const tensor& params_grad)
+        {
+            return {params_grad.size(), 1, 1};
+        }
+
+        template <unsigned long N>
+        solver_bias_split get_solver_bias_split(const fc_<N,FC_HAS_BIAS>& l, const tensor& params_grad)
+        {
+            return {params_grad.size()-l.get_num_outputs(), l.get_bias_learning_rate_multiplier(), l.get_bias_weight_decay_multiplier()};
+        }
+
+        template <long _num_filters, long _nr, long _nc, int _stride_y, int _stride_x, int _padding_y, int _padding_x>
+        solver_bias_split get_solver_bias_split(const con_<_num_filters,_nr,_nc,_stride_y,_stride_x,_padding_y,_padding_x>& l, const tensor& params_grad)
+        {
+            return {params_grad.size()-l.num_filters(), l.get_bias_learning_rate_multiplier(), l.get_bias_weight_decay_multiplier()};
+        }
+
+        template <long _num_filters, long _nr, long _nc, int _stride_y, int _stride_x, int _padding_y, int _padding_x>
+        solver_bias_split get_solver_bias_split(const cont_<_num_filters,_nr,_nc,_stride_y,_stride_x,_padding_y,_padding_x>& l, const tensor& params_grad)
+        {
+            return {params_grad.size()-l.num_filters(), l.get_bias_learning_rate_multiplier(), l.get_bias_weight_decay_multiplier()};
+        }
+
+        template <layer_mode mode>
+        solver_bias_split get_solver_bias_split(const bn_<mode>& l, const tensor& params_grad)
+        {
+            return {params_grad.size()/2, l.get_bias_learning_rate_multiplier(), l.get_bias_weight_decay_multiplier()};
+        }
+
+        template <typename layer_type>
+        void add_solver_update_segments (
+            tt::solver_update_segment seg,
+            const layer_type& l,
+            std::vector<tt::solver_update_segment>& segments
+        )
+        /*!
+            requires
+                - seg.learning_rate and seg.weight_decay are the solver's nominal values.
+            ensures
+                - Appends seg to segments, applying the layer's learning rate and weight
+                  decay multipliers.  If the layer has biases they become a second segment
+                  with the bias multipliers applied as well.
+        !*/
+        {
+            const auto split = get_solver_bias_split(l, *seg.params_grad);
+            const double lr = seg.learning_rate*get_learning_rate_multiplier(l);
+            const double wd = seg.weight_decay*get_weight_decay_multiplier(l);
+            seg.begin = 0;
+            seg.end = split.offset;
+            seg.learning_rate = lr;
+            seg.weight_decay = wd;
+            if (seg.end != 0)
+                segments.push_back(seg);
+            if (split.offset < seg.params->size())
+            {
+                seg.begin = split.offset;
+                seg.end = seg.params->size();
+                seg.learning_rate = lr*split.learning_rate_multiplier;
+                seg.weight_decay = wd*split.weight_decay_multiplier;
+                segments.push_back(seg);
+            }
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
     class sgd
     {
     public:
@@ -119,6 +202,34 @@ namespace dlib
             return v;
         }
 
+        template <typename layer_type>
+        void add_update_segments (
+            const float learning_rate,
+            layer_type& l,
+            const tensor& params_grad,
+            std::vector<tt::solver_update_segment>& segments
+        )
+        {
+            tensor& params = l.get_layer_params();
+            DLIB_CASSERT(params.size() != 0);
+            if (v.size() == 0)
+            {
+                v.copy_size(params_grad);
+                v = 0;
+            }
+
+            tt::solver_update_segment seg;
+            seg.rule = tt::solver_update_rule::sgd;
+            seg.params = &params;
+            seg.params_grad = &params_grad;
+            seg.state1 = &v;
+            seg.step = &params;
+            seg.learning_rate = learning_rate;
+            seg.weight_decay = weight_decay;
+            seg.momentum1 = momentum;
+            impl::add_solver_update_segments(seg, l, segments);
+        }
+
         friend void serialize(const sgd& item, std::ostream& out)
         {
             serialize("sgd2", out);
@@ -311,6 +422,42 @@ namespace dlib
         }
 
 
+        template <typename layer_type>
+        void add_update_segments (
+            const float learning_rate,
+            layer_type& l,
+            const tensor& params_grad,
+            std::vector<tt::solver_update_segment>& segments
+        )
+        {
+            tensor& params = l.get_layer_params();
+            DLIB_CASSERT(params.size() != 0);
+            if (v.size() == 0)
+            {
+                m.copy_size(params_grad);
+                m = 0;
+                v.copy_size(params_grad);
+                v = 0;
+                s.copy_size(params_grad);
+            }
+
+            ++t;
+
+            tt::solver_update_segment seg;
+            seg.rule = tt::solver_update_rule::adam;
+            seg.params = &params;
+            seg.params_grad = &params_grad;
+            seg.state1 = &m;
+            seg.state2 = &v;
+            seg.step = &params;
+            seg.learning_rate = learning_rate;
+            seg.weight_decay = weight_decay;
+            seg.momentum1 = momentum1;
+            seg.momentum2 = momentum2;
+            seg.t = t;
+            impl::add_solver_update_segments(seg, l, segments);
+        }
+
         friend void serialize(const adam& item, std::ostream& out)
         {
             serialize("adam2", out);
@@ -397,6 +544,457 @@ namespace dlib
         float t;
     };
 
+// ----------------------------------------------------------------------------------------
+
+    class adamw
+    {
+    public:
+
+        adamw(
+            float weight_decay_,
+            float momentum1_,
+            float momentum2_
+        )
+        {
+            weight_decay = weight_decay_;
+            momentum1 = momentum1_;
+            momentum2 = momentum2_;
+            t = 0;
+        }
+
+        adamw(
+        ) : adamw(0.01f, 0.9f, 0.999f)
+        {}
+
+        float get_momentum1 (
+        ) const { return momentum1; }
+
+        float get_momentum2 (
+        ) const { return momentum2; }
+
+        float get_weight_decay (
+        ) const { return weight_decay; }
+
+        template <typename layer_type>
+        const tensor& operator() (
+            const float learning_rate,
+            const layer_type& l,
+            const tensor& params_grad
+        )
+        {
+            const tensor& params = l.get_layer_params();
+            DLIB_CASSERT(params.size() != 0);
+            if (s.size() == 0)
+                s.copy_size(params_grad);
+            segments.clear();
+            impl::add_solver_update_segments(next_segment(learning_rate, params, params_grad, s), l, segments);
+            tt::apply_solver_updates(segments);
+            return s;
+        }
+
+        template <typename layer_type>
+        void add_update_segments (
+            const float learning_rate,
+            layer_type& l,
+            const tensor& params_grad,
+            std::vector<tt::solver_update_segment>& segments
+        )
+        {
+            tensor& params = l.get_layer_params();
+            DLIB_CASSERT(params.size() != 0);
+            impl::add_solver_update_segments(next_segment(learning_rate, params, params_grad, params), l, segments);
+        }
+
+        friend void serialize(const adamw& item, std::ostream& out)
+        {
+            serialize("adamw", out);
+            serialize(item.m, out);
+            serialize(item.v, out);
+            serialize(item.weight_decay, out);
+            serialize(item.momentum1, out);
+            serialize(item.momentum2, out);
+            serialize(item.t, out);
+        }
+
+        friend void deserialize(adamw& item, std::istream& in)
+        {
+            std::string version;
+            deserialize(version, in);
+            if (version != "adamw")
+                throw serialization_error("Unexpected version found while deserializing dlib::adamw.");
+            deserialize(item.m, in);
+            deserialize(item.v, in);
+            deserialize(item.weight_decay, in);
+            deserialize(item.momentum1, in);
+            deserialize(item.momentum2, in);
+            deserialize(item.t, in);
+        }
+
+        friend std::ostream& operator<< (std::ostream& out, const adamw& item)
+        {
+            out << "adamw: weight_decay="<<item.get_weight_decay() << ", momentum1="<<item.get_momentum1() << ", momentum2="<<item.get_momentum2();
+            return out;
+        }
+
+    private:
+
+        tt::solver_update_segment next_segment (
+            const float learning_rate,
+            const tensor& params,
+            const tensor& params_grad,
+            tensor& step
+        )
+        {
+            if (v.size() == 0)
+            {
+                m.copy_size(params_grad);
+                m = 0;
+                v.copy_size(params_grad);
+                v = 0;
+            }
+
+            ++t;
+
+            tt::solver_update_segment seg;
+            seg.rule = tt::solver_update_rule::adamw;
+            seg.params = &params;
+            seg.params_grad = &params_grad;
+            seg.state1 = &m;
+            seg.state2 = &v;
+            seg.step = &step;
+            seg.learning_rate = learning_rate;
+            seg.weight_decay = weight_decay;
+            seg.momentum1 = momentum1;
+            seg.momentum2 = momentum2;
+            seg.t = t;
+            return seg;
+        }
+
+        resizable_tensor m;
+        resizable_tensor v;
+        resizable_tensor s;
+        float weight_decay;
+        float momentum1;
+        float momentum2;
+        float t;
+        std::vector<tt::solver_update_segment> segments;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    class lamb
+    {
+    public:
+
+        lamb(
+            float weight_decay_,
+            float momentum1_,
+            float momentum2_
+        )
+        {
+            weight_decay = weight_decay_;
+            momentum1 = momentum1_;
+            momentum2 = momentum2_;
+            t = 0;
+        }
+
+        lamb(
+        ) : lamb(0.01f, 0.9f, 0.999f)
+        {}
+
+        float get_momentum1 (
+        ) const { return momentum1; }
+
+        float get_momentum2 (
+        ) const { return momentum2; }
+
+        float get_weight_decay (
+        ) const { return weight_decay; }
+
+        template <typename layer_type>
+        const tensor& operator() (
+            const float learning_rate,
+            const layer_type& l,
+            const tensor& params_grad
+        )
+        {
+            const tensor& params = l.get_layer_params();
+            DLIB_CASSERT(params.size() != 0);
+            if (s.size() == 0)
+                s.copy_size(params_grad);
+            segments.clear();
+            impl::add_solver_update_segments(next_segment(learning_rate, params, params_grad, s), l, segments);
+            tt::apply_solver_updates(segments);
+            return s;
+        }
+
+        template <typename layer_type>
+        void add_update_segments (
+            const float learning_rate,
+            layer_type& l,
+            const tensor& params_grad,
+            std::vector<tt::solver_update_segment>& segments
+        )
+        {
+            tensor& params = l.get_layer_params();
+            DLIB_CASSERT(params.size() != 0);
+            impl::add_solver_update_segments(next_segment(learning_rate, params, params_grad, params), l, segments);
+        }
+
+        friend void serialize(const lamb& item, std::ostream& out)
+        {
+            serialize("lamb", out);
+            serialize(item.m, out);
+            serialize(item.v, out);
+            serialize(item.weight_decay, out);
+            serialize(item.momentum1, out);
+            serialize(item.momentum2, out);
+            serialize(item.t, out);
+        }
+
+        friend void deserialize(lamb& item, std::istream& in)
+        {
+            std::string version;
+            deserialize(version, in);
+            if (version != "lamb")
+                throw serialization_error("Unexpected version found while deserializing dlib::lamb.");
+            deserialize(item.m, in);
+            deserialize(item.v, in);
+            deserialize(item.weight_decay, in);
+            deserialize(item.momentum1, in);
+            deserialize(item.momentum2, in);
+            deserialize(item.t, in);
+        }
+
+        friend std::ostream& operator<< (std::ostream& out, const lamb& item)
+        {
+            out << "lamb: weight_decay="<<item.get_weight_decay() << ", momentum1="<<item.get_momentum1() << ", momentum2="<<item.get_momentum2();
+            return out;
+        }
+
+    private:
+
+        tt::solver_update_segment next_segment (
+            const float learning_rate,
+            const tensor& params,
+            const tensor& params_grad,
+            tensor& step
+        )
+        {
+            if (v.size() == 0)
+            {
+                m.copy_size(params_grad);
+                m = 0;
+                v.copy_size(params_grad);
+                v = 0;
+            }
+
+            ++t;
+
+            tt::solver_update_segment seg;
+            seg.rule = tt::solver_update_rule::lamb;
+            seg.params = &params;
+            seg.params_grad = &params_grad;
+            seg.state1 = &m;
+            seg.state2 = &v;
+            seg.step = &step;
+            seg.learning_rate = learning_rate;
+            seg.weight_decay = weight_decay;
+            seg.momentum1 = momentum1;
+            seg.momentum2 = momentum2;
+            seg.t = t;
+            return seg;
+        }
+
+        resizable_tensor m;
+        resizable_tensor v;
+        resizable_tensor s;
+        float weight_decay;
+        float momentum1;
+        float momentum2;
+        float t;
+        std::vector<tt::solver_update_segment> segments;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    class lars
+    {
+    public:
+
+        lars(
+            float weight_decay_,
+            float momentum_,
+            float trust_coefficient_
+        )
+        {
+            weight_decay = weight_decay_;
+            momentum = momentum_;
+            trust_coefficient = trust_coefficient_;
+        }
+
+        lars(
+        ) : lars(0.0005f, 0.9f, 0.001f)
+        {}
+
+        float get_momentum (
+        ) const { return momentum; }
+
+        float get_weight_decay (
+        ) const { return weight_decay; }
+
+        float get_trust_coefficient (
+        ) const { return trust_coefficient; }
+
+        template <typename layer_type>
+        const tensor& operator() (
+            const float learning_rate,
+            const layer_type& l,
+            const tensor& params_grad
+        )
+        {
+            const tensor& params = l.get_layer_params();
+            DLIB_CASSERT(params.size() != 0);
+            if (s.size() == 0)
+                s.copy_size(params_grad);
+            segments.clear();
+            impl::add_solver_update_segments(next_segment(learning_rate, params, params_grad, s), l, segments);
+            tt::apply_solver_updates(segments);
+            return s;
+        }
+
+        template <typename layer_type>
+        void add_update_segments (
+            const float learning_rate,
+            layer_type& l,
+            const tensor& params_grad,
+            std::vector<tt::solver_update_segment>& segments
+        )
+        {
+            tensor& params = l.get_layer_params();
+            DLIB_CASSERT(params.size() != 0);
+            impl::add_solver_update_segments(next_segment(learning_rate, params, params_grad, params), l, segments);
+        }
+
+        friend void serialize(const lars& item, std::ostream& out)
+        {
+            serialize("lars", out);
+            serialize(item.v, out);
+            serialize(item.weight_decay, out);
+            serialize(item.momentum, out);
+            serialize(item.trust_coefficient, out);
+        }
+
+        friend void deserialize(lars& item, std::istream& in)
+        {
+            std::string version;
+            deserialize(version, in);
+            if (version != "lars")
+                throw serialization_error("Unexpected version found while deserializing dlib::lars.");
+            deserialize(item.v, in);
+            deserialize(item.weight_decay, in);
+            deserialize(item.momentum, in);
+            deserialize(item.trust_coefficient, in);
+        }
+
+        friend std::ostream& operator<< (std::ostream& out, const lars& item)
+        {
+            out << "lars: weight_decay="<<item.get_weight_decay() << ", momentum="<<item.get_momentum() << ", trust_coefficient="<<item.get_trust_coefficient();
+            return out;
+        }
+
+    private:
+
+        tt::solver_update_segment next_segment (
+            const float learning_rate,
+            const tensor& params,
+            const tensor& params_grad,
+            tensor& step
+        )
+        {
+            if (v.size() == 0)
+            {
+                v.copy_size(params_grad);
+                v = 0;
+            }
+
+            tt::solver_update_segment seg;
+            seg.rule = tt::solver_update_rule::lars;
+            seg.params = &params;
+            seg.params_grad = &params_grad;
+            seg.state1 = &v;
+            seg.step = &step;
+            seg.learning_rate = learning_rate;
+            seg.weight_decay = weight_decay;
+            seg.momentum1 = momentum;
+            seg.trust_coefficient = trust_coefficient;
+            return seg;
+        }
+
+        resizable_tensor v;
+        resizable_tensor s;
+        float weight_decay;
+        float momentum;
+        float trust_coefficient;
+        std::vector<tt::solver_update_segment> segments;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename solver_type> struct supports_fused_update : std::false_type {};
+    template <> struct supports_fused_update<sgd>   : std::true_type {};
+    template <> struct supports_fused_update<adam>  : std::true_type {};
+    template <> struct supports_fused_update<adamw> : std::true_type {};
+    template <> struct supports_fused_update<lamb>  : std::true_type {};
+    template <> struct supports_fused_update<lars>  : std::true_type {};
+
+    namespace impl
+    {
+        template <typename solver_type>
+        class visitor_fused_update_segments
+        {
+        public:
+            visitor_fused_update_segments(
+                std::vector<solver_type>& solvers_,
+                double learning_rate_,
+                std::vector<tt::solver_update_segment>& segments_
+            ) : solvers(solvers_), learning_rate(learning_rate_), segments(segments_) {}
+
+            template <typename T, typename U, typename E>
+            void operator()(add_layer<T,U,E>& l)
+            {
+                auto& solver = solvers[computational_layer_idx++];
+                // Skip the same layers add_layer::update_parameters() skips.
+                if (l.get_parameter_gradient().size() != 0 && get_learning_rate_multiplier(l.layer_details()) != 0)
+                    solver.add_update_segments(learning_rate, l.layer_details(), l.get_parameter_gradient(), segments);
+            }
+
+        private:
+
+            size_t computational_layer_idx = 0;
+            std::vector<solver_type>& solvers;
+            double learning_rate;
+            std::vector<tt::solver_update_segment>& segments;
+        };
+    }
+
+    template <
+        typename net_type,
+        typename solver_type
+        >
+    void fused_update_parameters (
+        net_type& net,
+        std::vector<solver_type>& solvers,
+        double learning_rate
+    )
+    {
+        static_assert(supports_fused_update<solver_type>::value, "This solver doesn't support fused updates.");
+        DLIB_CASSERT(solvers.size() >= net_type::num_computational_layers);
+        std::vector<tt::solver_update_segment> segments;
+        visit_layers(net, impl::visitor_fused_update_segments<solver_type>(solvers, learning_rate, segments));
+        tt::apply_solver_updates(segments);
+    }
+
 // ----------------------------------------------------------------------------------------
 
 }
@@ -56,6 +56,25 @@ namespace dlib
                   rate should be used to select the step size, i.e. to somehow determine
                   the magnitude of V.
         !*/
+
+        template <typename layer_type>
+        void add_update_segments (
+            const float learning_rate,
+            layer_type& l,
+            const tensor& params_grad,
+            std::vector<tt::solver_update_segment>& segments
+        );
+        /*!
+            requires
+                - The same requirements as operator().
+            ensures
+                - This function is optional.  Solvers that implement it, and specialize
+                  supports_fused_update to true, can be used with fused_update_parameters().
+                - Appends to segments the steps that, when given to
+                  tt::apply_solver_updates(), add the same step V that operator() would
+                  return directly to l.get_layer_params().  Any per step bookkeeping
+                  (e.g. an iteration counter) is done by this function.
+        !*/
     };
 
     void serialize(const EXAMPLE_SOLVER& item, std::ostream& out);
@@ -196,6 +215,243 @@ namespace dlib
         Prints the solver's name and parameters to out.
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    class adamw
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object implements the EXAMPLE_SOLVER interface defined above.  It is
+                the ADAM variant with decoupled weight decay described in the paper:
+                    Loshchilov, Ilya, and Frank Hutter. "Decoupled weight decay
+                    regularization." International Conference on Learning Representations.
+                    2019.
+                That is, the moment estimates are computed from params_grad alone and the
+                weight decay is applied directly to the parameters, giving the step:
+                    V = -alpha*M/(sqrt(S) + 1e-8) - learning_rate*weight_decay*l.get_layer_params()
+                where alpha is ADAM's bias corrected learning rate.  Unlike with adam, the
+                amount of weight decay doesn't get scaled down for parameters with large
+                gradients.
+
+                The learning rate and weight decay are multiplied by the per layer
+                multipliers, including the bias multipliers of fc_, con_, cont_, and bn_,
+                just like adam does.
+        !*/
+
+    public:
+
+        adamw(
+        );
+        /*!
+            ensures
+                - #get_weight_decay()  == 0.01
+                - #get_momentum1()     == 0.9
+                - #get_momentum2()     == 0.999
+        !*/
+
+        adamw(
+            float weight_decay,
+            float momentum1,
+            float momentum2
+        );
+        /*!
+            requires
+                - weight_decay >= 0
+                - 0 <= momentum1 < 1
+                - 0 <= momentum2 < 1
+            ensures
+                - #get_weight_decay()  == weight_decay
+                - #get_momentum1()     == momentum1
+                - #get_momentum2()     == momentum2
+        !*/
+
+        float get_weight_decay () const;
+        float get_momentum1 () const;
+        float get_momentum2 () const;
+    };
+
+    void serialize(const adamw& item, std::ostream& out);
+    void deserialize(adamw& item, std::istream& in);
+    /*!
+        provides serialization support
+    !*/
+
+    std::ostream& operator<< (std::ostream& out, const adamw& item);
+    /*!
+        Prints the solver's name and parameters to out.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    class lamb
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object implements the EXAMPLE_SOLVER interface defined above.  In
+                particular, it implements the LAMB method described in the paper:
+                    You, Yang, et al. "Large batch optimization for deep learning: Training
+                    BERT in 76 minutes." International Conference on Learning
+                    Representations. 2020.
+                It computes the same bias corrected moment estimates as adamw, but then
+                scales the step of each layer so its length is proportional to the length
+                of the layer's parameters.  This makes it well suited to the very large
+                mini-batches you get from dnn_trainer's gradient accumulation or data
+                parallel modes.  The weights and the biases of fc_, con_, cont_, and bn_
+                layers are scaled separately.
+
+                The learning rate and weight decay are multiplied by the per layer
+                multipliers, just like adam does.
+        !*/
+
+    public:
+
+        lamb(
+        );
+        /*!
+            ensures
+                - #get_weight_decay()  == 0.01
+                - #get_momentum1()     == 0.9
+                - #get_momentum2()     == 0.999
+        !*/
+
+        lamb(
+            float weight_decay,
+            float momentum1,
+            float momentum2
+        );
+        /*!
+            requires
+                - weight_decay >= 0
+                - 0 <= momentum1 < 1
+                - 0 <= momentum2 < 1
+            ensures
+                - #get_weight_decay()  == weight_decay
+                - #get_momentum1()     == momentum1
+                - #get_momentum2()     == momentum2
+        !*/
+
+        float get_weight_decay () const;
+        float get_momentum1 () const;
+        float get_momentum2 () const;
+    };
+
+    void serialize(const lamb& item, std::ostream& out);
+    void deserialize(lamb& item, std::istream& in);
+    /*!
+        provides serialization support
+    !*/
+
+    std::ostream& operator<< (std::ostream& out, const lamb& item);
+    /*!
+        Prints the solver's name and parameters to out.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    class lars
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object implements the EXAMPLE_SOLVER interface defined above.  In
+                particular, it implements the LARS method described in the paper:
+                    You, Yang, Igor Gitman, and Boris Ginsburg. "Large batch training of
+                    convolutional networks." arXiv preprint arXiv:1708.03888 (2017).
+                It is sgd with momentum where each layer gets its own learning rate:
+                    local_lr = learning_rate*trust_coefficient*length(P)/(length(G) + weight_decay*length(P))
+                    V = momentum*V - local_lr*(G + weight_decay*P)
+                Here P is l.get_layer_params() and G is params_grad.  The weights and the
+                biases of fc_, con_, cont_, and bn_ layers get separate local learning
+                rates.
+
+                The learning rate and weight decay are multiplied by the per layer
+                multipliers, just like sgd does.
+        !*/
+
+    public:
+
+        lars(
+        );
+        /*!
+            ensures
+                - #get_weight_decay()       == 0.0005
+                - #get_momentum()           == 0.9
+                - #get_trust_coefficient()  == 0.001
+        !*/
+
+        lars(
+            float weight_decay,
+            float momentum,
+            float trust_coefficient
+        );
+        /*!
+            requires
+                - weight_decay >= 0
+                - momentum >= 0
+                - trust_coefficient > 0
+            ensures
+                - #get_weight_decay()       == weight_decay
+                - #get_momentum()           == momentum
+                - #get_trust_coefficient()  == trust_coefficient
+        !*/
+
+        float get_weight_decay () const;
+        float get_momentum () const;
+        float get_trust_coefficient () const;
+    };
+
+    void serialize(const lars& item, std::ostream& out);
+    void deserialize(lars& item, std::istream& in);
+    /*!
+        provides serialization support
+    !*/
+
+    std::ostream& operator<< (std::ostream& out, const lars& item);
+    /*!
+        Prints the solver's name and parameters to out.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename solver_type>
+    struct supports_fused_update
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This is a type trait whose value member is true if solver_type implements
+                the optional add_update_segments() member of EXAMPLE_SOLVER.  It is true
+                for sgd, adam, adamw, lamb, and lars and false for everything else.  If
+                you write your own solver with add_update_segments() you can specialize
+                it to true.
+        !*/
+        static const bool value;
+    };
+
+    template <
+        typename net_type,
+        typename solver_type
+        >
+    void fused_update_parameters (
+        net_type& net,
+        std::vector<solver_type>& solvers,
+        double learning_rate
+    );
+    /*!
+        requires
+            - net_type is an object of type add_layer, add_loss_layer, add_skip_layer, or
+              add_tag_layer.
+            - supports_fused_update<solver_type>::value == true
+            - solvers.size() >= net_type::num_computational_layers
+            - learning_rate > 0
+        ensures
+            - Does the same thing as net.update_parameters(solvers, learning_rate).
+              However, rather than calling each layer's solver and then adding its step to
+              the layer's parameters, it collects the steps of all the layers and applies
+              them with a single call to tt::apply_solver_updates().  That call updates
+              the parameters in place and splits the work into evenly sized pieces that run
+              in parallel.  For networks with many small layers this is a lot faster.
+              dnn_trainer uses this function automatically when dlib isn't using CUDA.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
 }
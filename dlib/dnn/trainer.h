@@ -21,9 +21,11 @@
 #include <set>
 #include <future>
 #include <exception>
+#include <functional>
 #include <mutex>
 #include "../dir_nav.h"
 #include "../md5.h"
+#include "../vectorstream.h"
 
 namespace dlib
 {
@@ -138,6 +140,9 @@ namespace dlib
             job_pipe.disable();
             stop();
             wait();
+            // Let any background write of a sync file finish.  There isn't anyone to
+            // report an error to at this point so errors are ignored.
+            try { finish_sync_file_write(); } catch (...) {}
         }
 
         net_type& get_net (
@@ -162,6 +167,18 @@ namespace dlib
             mini_batch_size = batch_size;
         }
 
+        unsigned long get_gradient_accumulation_steps (
+        ) const { return gradient_accumulation_steps; }
+
+        void set_gradient_accumulation_steps (
+            unsigned long num
+        )
+        {
+            DLIB_CASSERT(num > 0);
+            wait_for_thread_to_pause();
+            gradient_accumulation_steps = num;
+        }
+
         unsigned long get_max_num_epochs (
         ) const { return max_num_epochs; }
 
@@ -185,6 +202,22 @@ namespace dlib
             verbose = false;
         }
 
+        template <typename bsp_context_type>
+        void be_data_parallel (
+            bsp_context_type& context
+        )
+        {
+            wait_for_thread_to_pause();
+            cluster_node_id = context.node_id();
+            cluster_size = context.number_of_nodes();
+            cluster_all_reduce_sum = [&context](std::vector<float>& v) { context.all_reduce_sum(v); };
+            cluster_broadcast = [&context](std::vector<char>& v) { context.broadcast_from(v, 0); };
+            cluster_state_synced = false;
+        }
+
+        bool is_data_parallel (
+        ) const { return static_cast<bool>(cluster_all_reduce_sum); }
+
 
         const std::vector<solver_type>& get_solvers (
         ) const 
@@ -411,6 +444,7 @@ namespace dlib
             std::chrono::seconds time_between_syncs_ = std::chrono::minutes(15)
         )
         {
+            finish_sync_file_write();
             last_sync_time = std::chrono::system_clock::now();
             sync_filename = filename;
             time_between_syncs = time_between_syncs_;
@@ -427,6 +461,28 @@ namespace dlib
             return sync_filename;
         }
 
+        void set_background_synchronization (
+            bool enabled
+        )
+        {
+            finish_sync_file_write();
+            background_sync = enabled;
+        }
+
+        bool get_background_synchronization (
+        ) const { return background_sync; }
+
+        void set_num_synchronization_file_backups (
+            unsigned long num
+        )
+        {
+            finish_sync_file_write();
+            num_sync_file_backups = num;
+        }
+
+        unsigned long get_num_synchronization_file_backups (
+        ) const { return num_sync_file_backups; }
+
         double get_average_loss (
         ) const 
         { 
@@ -650,7 +706,299 @@ namespace dlib
         {
             auto&& dev = *devices[device];
             dlib::cuda::set_device(dev.device_id);
+#ifdef DLIB_USE_CUDA
+            // The fused update runs on the host, so on the GPU it's faster to let each
+            // layer call its own solver.
             dev.net.update_parameters(make_sstack(dev.solvers), learning_rate);
+#else
+            update_parameters(dev.net, dev.solvers, supports_fused_update<solver_type>());
+#endif
+        }
+
+        void update_parameters(net_type& dnet, std::vector<solver_type>& dsolvers, std::true_type)
+        {
+            // Update all the layers with one call rather than one solver call per layer.
+            fused_update_parameters(dnet, dsolvers, learning_rate);
+        }
+
+        void update_parameters(net_type& dnet, std::vector<solver_type>& dsolvers, std::false_type)
+        {
+            dnet.update_parameters(make_sstack(dsolvers), learning_rate);
+        }
+
+        bool accumulate_gradients (
+            threads& tp,
+            job_t& next_job,
+            double& loss,
+            bool finish_accumulation
+        )
+        /*!
+            requires
+                - loss == the loss of the micro-batch in next_job, whose gradients have
+                  just been computed.
+            ensures
+                - Adds the gradients of the networks on all the devices to the gradients
+                  accumulated over the previous micro-batches.
+                - if (get_gradient_accumulation_steps() micro-batches have been accumulated
+                  or finish_accumulation == true) then
+                    - replaces the gradients in each device's network with the average of
+                      the accumulated gradients and starts a new accumulation.
+                    - #loss == the average loss over the accumulated micro-batches.
+                    - returns true
+                - else
+                    - returns false
+        !*/
+        {
+            accumulated_loss += loss;
+            ++num_accumulated_micro_batches;
+            const bool finish = finish_accumulation || num_accumulated_micro_batches >= gradient_accumulation_steps;
+            for (size_t i = 0; i < devices.size(); ++i)
+            {
+                tp[i]->add_task_by_value([&,i]()
+                {
+                    auto&& dev = *devices[i];
+                    dlib::cuda::set_device(dev.device_id);
+                    dev.accumulated_gradients.resize(num_computational_layers);
+                    const unsigned long num_before = dev.num_accumulated_gradients;
+                    const unsigned long num_total = num_before + (next_job.have_data[i] ? 1 : 0);
+                    size_t j = 0;
+                    visit_layer_parameter_gradients(dev.net, [&](tensor& grad) {
+                        resizable_tensor& acc = dev.accumulated_gradients[j++];
+                        if (grad.size() == 0)
+                            return;
+                        if (!finish)
+                        {
+                            if (!next_job.have_data[i])
+                                return;
+                            if (num_before == 0)
+                            {
+                                acc.copy_size(grad);
+                                memcpy(acc, grad);
+                            }
+                            else
+                            {
+                                tt::affine_transform(acc, acc, grad, 1, 1);
+                            }
+                        }
+                        else if (num_before != 0)
+                        {
+                            if (next_job.have_data[i])
+                                tt::affine_transform(grad, grad, acc, 1.0f/num_total, 1.0f/num_total);
+                            else
+                                tt::affine_transform(grad, acc, 1.0f/num_total);
+                        }
+                    });
+                    dev.num_accumulated_gradients = finish ? 0 : num_total;
+                });
+            }
+            for (size_t i = 0; i < devices.size(); ++i)
+                tp[i]->wait_for_all_tasks();
+
+            if (!finish)
+                return false;
+
+            loss = accumulated_loss/num_accumulated_micro_batches;
+            accumulated_loss = 0;
+            num_accumulated_micro_batches = 0;
+            return true;
+        }
+
+        void discard_accumulated_gradients (
+        )
+        {
+            accumulated_loss = 0;
+            num_accumulated_micro_batches = 0;
+            for (auto&& d : devices)
+                d->num_accumulated_gradients = 0;
+        }
+
+        bool compute_and_average_gradients (
+            threads& tp,
+            std::vector<dlib::future<double>>& losses,
+            std::vector<tt::multi_device_tensor_averager>& averagers,
+            job_t& next_job,
+            const training_label_type& pick_which_run_update,
+            double& loss,
+            bool finish_accumulation = false
+        )
+        /*!
+            ensures
+                - computes the gradients of the networks on all the devices.
+                - if (get_gradient_accumulation_steps() > 1) then accumulates them with
+                  accumulate_gradients(tp, next_job, loss, finish_accumulation) and
+                  returns false if that wasn't the last micro-batch of the accumulation.
+                - Otherwise, if there is more than one device, averages the gradients over
+                  the devices, sets #loss to the average loss over all the devices and
+                  micro-batches, and returns true.
+        !*/
+        {
+            // Call compute_parameter_gradients() and update_parameters() but pick the
+            // right version for unsupervised or supervised training based on the type
+            // of training_label_type.
+            for (size_t i = 0; i < devices.size(); ++i)
+                tp[i]->add_task_by_value([&,i](double& loss){ loss = compute_parameter_gradients(i, next_job, pick_which_run_update); }, losses[i]);
+            // aggregate loss values from all the network computations.
+            double theloss = 0;
+            for (auto&& l : losses)
+                theloss += l.get();
+            theloss /= losses.size();
+
+            if (gradient_accumulation_steps > 1 || num_accumulated_micro_batches != 0)
+            {
+                if (!accumulate_gradients(tp, next_job, theloss, finish_accumulation))
+                    return false;
+            }
+
+            // Now, if there is more than one active device we need to synchronize the
+            // gradient updates between devices.  So we do that now.
+            if (devices.size() > 1)
+            {
+                // if this is the first iteration then we need to setup the averagers.
+                // We can't do this outside the loop because the tensors that get
+                // averaged need to be allocated to their devices before we call set()
+                // so that the averagers can determine how best to average them.
+                if (averagers.size() == 0 || sync_file_reloaded)
+                {
+                    averagers = std::vector<tt::multi_device_tensor_averager>(net_type::num_computational_layers);
+                    // setup the averagers to point to the tensors in the networks.
+                    std::vector<std::vector<tensor*>> all_tensors(devices.size());
+                    for (size_t i = 0; i < all_tensors.size(); ++i)
+                    {
+                        all_tensors[i].resize(net_type::num_computational_layers);
+                        visit_layer_parameter_gradients(devices[i]->net, [&](size_t j, tensor& t){
+                            all_tensors[i][j] = &t;
+                        });
+                    }
+                    // Now set each averager to average the tensors at the same layer in each
+                    // network.
+                    for (size_t i = 0; i < net_type::num_computational_layers; ++i)
+                    {
+                        std::vector<tensor*> temp(all_tensors.size());
+                        for (size_t j = 0; j < all_tensors.size(); ++j)
+                        {
+                            temp[j] = all_tensors[j][i];
+                            DLIB_CASSERT(temp[0]->size() == temp[j]->size(),
+                            "Make sure you don't modify the network structure "
+                            "or number of parameters after constructing the trainer.");
+                        }
+                        // ignore layers that don't have parameters
+                        if (temp[0]->size() != 0)
+                            averagers[i].set(temp);
+                    }
+
+                    sync_file_reloaded = false;
+                }
+
+
+                for (auto&& d : devices)
+                    cuda::device_synchronize(d->device_id);
+
+                for (auto&& avg : averagers)
+                    avg.average();
+            }
+
+            loss = theloss;
+            return true;
+        }
+
+        bool all_reduce_gradients_with_cluster (
+            double& loss
+        )
+        /*!
+            requires
+                - is_data_parallel()
+                - compute_and_average_gradients() was just called and returned loss.
+            ensures
+                - if (all the processes in the cluster have the same state) then
+                    - replaces the gradients in every device's network with the average
+                      of the gradients over all the processes.
+                    - #loss == the average of loss over all the processes.
+                    - returns true
+                - else
+                    - returns false
+        !*/
+        {
+            // Pack all the gradients, the loss, and a flag saying if we need the state of
+            // node 0 into one buffer so we only do one all-reduce per step.
+            cluster_buffer.clear();
+            visit_layer_parameter_gradients(devices[0]->net, [&](tensor& t) {
+                cluster_buffer.insert(cluster_buffer.end(), t.host(), t.host()+t.size());
+            });
+            cluster_buffer.push_back(loss);
+            cluster_buffer.push_back(cluster_state_synced ? 0 : 1);
+
+            cluster_all_reduce_sum(cluster_buffer);
+
+            if (cluster_buffer.back() != 0)
+                return false;
+
+            loss = cluster_buffer[cluster_buffer.size()-2]/cluster_size;
+            for (auto&& d : devices)
+            {
+                const float* src = &cluster_buffer[0];
+                visit_layer_parameter_gradients(d->net, [&](tensor& t) {
+                    float* dest = t.host();
+                    for (size_t i = 0; i < t.size(); ++i)
+                        dest[i] = src[i]/cluster_size;
+                    src += t.size();
+                });
+            }
+            return true;
+        }
+
+        void sync_state_with_cluster (
+        )
+        /*!
+            requires
+                - is_data_parallel()
+            ensures
+                - copies the network parameters, solvers, and everything that decides the
+                  learning rate from node 0 to all the processes in the cluster.
+        !*/
+        {
+            std::vector<char> buf;
+            if (cluster_node_id == 0)
+            {
+                vectorstream sout(buf);
+                serialize(net, sout);
+                serialize(devices[0]->solvers, sout);
+                serialize(learning_rate.load(), sout);
+                serialize(previous_loss_values, sout);
+                serialize(test_previous_loss_values, sout);
+                serialize(steps_without_progress.load(), sout);
+                serialize(test_steps_without_progress.load(), sout);
+                serialize(lr_schedule_pos, sout);
+                serialize(gradient_check_budget, sout);
+            }
+
+            cluster_broadcast(buf);
+
+            if (cluster_node_id != 0)
+            {
+                vectorstream sin(buf);
+                double dtemp; long ltemp;
+                deserialize(net, sin);
+                deserialize(devices[0]->solvers, sin);
+                deserialize(dtemp, sin); learning_rate = dtemp;
+                deserialize(previous_loss_values, sin);
+                deserialize(test_previous_loss_values, sin);
+                deserialize(ltemp, sin); steps_without_progress = ltemp;
+                deserialize(ltemp, sin); test_steps_without_progress = ltemp;
+                deserialize(lr_schedule_pos, sin);
+                deserialize(gradient_check_budget, sin);
+
+                for (size_t i = 1; i < devices.size(); ++i)
+                {
+                    dlib::cuda::set_device(devices[i]->device_id);
+                    devices[i]->solvers = devices[0]->solvers;
+                    devices[i]->net = devices[0]->net;
+                }
+                dlib::cuda::set_device(devices[0]->device_id);
+                // make the gradient averagers point at the new tensors
+                sync_file_reloaded = true;
+            }
+
+            cluster_state_synced = true;
         }
 
         void thread() try
@@ -698,7 +1046,14 @@ namespace dlib
                     double theloss = 0;
                     for (auto&& loss : losses)
                         theloss += loss.get();
-                    record_test_loss(theloss/losses.size());
+                    theloss /= losses.size();
+                    if (is_data_parallel())
+                    {
+                        std::vector<float> temp(1, theloss);
+                        cluster_all_reduce_sum(temp);
+                        theloss = temp[0]/cluster_size;
+                    }
+                    record_test_loss(theloss);
 
                     // Check if we should shrink the learning rate based on how the test
                     // error has been doing lately.
@@ -723,67 +1078,31 @@ namespace dlib
                     continue;
                 }
 
-                updated_net_since_last_sync = true;
-                ++main_iteration_counter;
-                // Call compute_parameter_gradients() and update_parameters() but pick the
-                // right version for unsupervised or supervised training based on the type
-                // of training_label_type.
-                for (size_t i = 0; i < devices.size(); ++i)
-                    tp[i]->add_task_by_value([&,i](double& loss){ loss = compute_parameter_gradients(i, next_job, pick_which_run_update); }, losses[i]);
-                // aggregate loss values from all the network computations.
                 double theloss = 0;
-                for (auto&& loss : losses)
-                    theloss += loss.get();
-                record_loss(theloss/losses.size());
-
-                // Now, if there is more than one active device we need to synchronize the
-                // gradient updates between devices.  So we do that now.
-                if (devices.size() > 1)
+                if (!compute_and_average_gradients(tp, losses, averagers, next_job, pick_which_run_update, theloss))
                 {
-                    // if this is the first iteration then we need to setup the averagers.
-                    // We can't do this outside the loop because the tensors that get
-                    // averaged need to be allocated to their devices before we call set()
-                    // so that the averagers can determine how best to average them.
-                    if (averagers.size() == 0 || sync_file_reloaded)
-                    {
-                        averagers = std::vector<tt::multi_device_tensor_averager>(net_type::num_computational_layers);
-                        // setup the averagers to point to the tensors in the networks.
-                        std::vector<std::vector<tensor*>> all_tensors(devices.size());
-                        for (size_t i = 0; i < all_tensors.size(); ++i)
-                        {
-                            all_tensors[i].resize(net_type::num_computational_layers);
-                            visit_layer_parameter_gradients(devices[i]->net, [&](size_t j, tensor& t){
-                                all_tensors[i][j] = &t;
-                            });
-                        }
-                        // Now set each averager to average the tensors at the same layer in each
-                        // network.
-                        for (size_t i = 0; i < net_type::num_computational_layers; ++i)
-                        {
-                            std::vector<tensor*> temp(all_tensors.size());
-                            for (size_t j = 0; j < all_tensors.size(); ++j)
-                            {
-                                temp[j] = all_tensors[j][i];
-                                DLIB_CASSERT(temp[0]->size() == temp[j]->size(),
-                                "Make sure you don't modify the network structure "
-                                "or number of parameters after constructing the trainer.");
-                            }
-                            // ignore layers that don't have parameters
-                            if (temp[0]->size() != 0)
-                                averagers[i].set(temp);
-                        }
-
-                        sync_file_reloaded = false;
-                    }
-
+                    // This was only one of the micro-batches of a gradient accumulation
+                    // step, so don't touch the parameters until we have seen all of them.
+                    continue;
+                }
 
-                    for (auto&& d : devices)
-                        cuda::device_synchronize(d->device_id);
+                updated_net_since_last_sync = true;
+                ++main_iteration_counter;
 
-                    for (auto&& avg : averagers)
-                        avg.average();
+                // In data parallel mode we also average the gradients with the other
+                // processes.  If some process doesn't yet have the same state as the others
+                // then everyone first copies the state of node 0 and computes the gradients
+                // again.  This happens on the first step and after a process reloads its
+                // state from a synchronization file.
+                while (is_data_parallel() && !all_reduce_gradients_with_cluster(theloss))
+                {
+                    sync_state_with_cluster();
+                    // Any gradients accumulated before this were computed with the old
+                    // state, so only the current micro-batch is used for this step.
+                    discard_accumulated_gradients();
+                    compute_and_average_gradients(tp, losses, averagers, next_job, pick_which_run_update, theloss, true);
                 }
-
+                record_loss(theloss);
 
                 // Now apply all the updates to each device.
                 for (size_t i = 0; i < devices.size(); ++i)
@@ -875,6 +1194,7 @@ namespace dlib
         {
             max_num_epochs = 10000;
             mini_batch_size = 128;
+            gradient_accumulation_steps = 1;
             verbose = false;
             learning_rate = 1e-2;
             min_learning_rate = 1e-5;
@@ -913,7 +1233,7 @@ namespace dlib
         friend void serialize(const dnn_trainer& item, std::ostream& out)
         {
             item.wait_for_thread_to_pause();
-            int version = 13;
+            int version = 14;
             serialize(version, out);
 
             size_t nl = dnn_trainer::num_layers;
@@ -943,13 +1263,14 @@ namespace dlib
             serialize(item.previous_loss_values_dump_amount, out);
             serialize(item.test_previous_loss_values_dump_amount, out);
             serialize(item.previous_loss_values_to_keep_until_disk_sync, out);
+            serialize(item.gradient_accumulation_steps, out);
         }
         friend void deserialize(dnn_trainer& item, std::istream& in)
         {
             item.wait_for_thread_to_pause();
             int version = 0;
             deserialize(version, in);
-            if (version != 13)
+            if (!(13 <= version && version <= 14))
                 throw serialization_error("Unexpected version found while deserializing dlib::dnn_trainer.");
 
             size_t num_layers = 0;
@@ -989,6 +1310,13 @@ namespace dlib
             deserialize(item.previous_loss_values_dump_amount, in);
             deserialize(item.test_previous_loss_values_dump_amount, in);
             deserialize(item.previous_loss_values_to_keep_until_disk_sync, in);
+            if (version >= 14)
+                deserialize(item.gradient_accumulation_steps, in);
+            else
+                item.gradient_accumulation_steps = 1;
+
+            // Gradients accumulated so far belong to the state we just replaced.
+            item.discard_accumulated_gradients();
 
             if (item.devices.size() > 1)
             {
@@ -1024,6 +1352,14 @@ namespace dlib
             bool do_it_now = false
         ) 
         {
+            // Report any error from the last background write as soon as it's done, and
+            // make forced syncs, like the one in get_net(), wait for it.
+            if (pending_sync_write.valid() && (do_it_now ||
+                pending_sync_write.wait_for(std::chrono::seconds(0)) == std::future_status::ready))
+            {
+                finish_sync_file_write();
+            }
+
             // don't sync anything if we haven't updated the network since the last sync
             if (!updated_net_since_last_sync)
                 return;
@@ -1039,6 +1375,10 @@ namespace dlib
             {
                 wait_for_thread_to_pause();
 
+                // The previous write has to be on disk before we can tell which sync file
+                // is the newest.
+                finish_sync_file_write();
+
                 // compact network before saving to disk.
                 this->net.clean(); 
 
@@ -1051,6 +1391,7 @@ namespace dlib
                     std::ifstream fin(newest_syncfile(), std::ios::binary);
                     deserialize(*this, fin);
                     sync_file_reloaded = true;
+                    cluster_state_synced = false;
                     if (verbose)
                         std::cout << "Loss has been increasing, reloading saved state from " << newest_syncfile() << std::endl;
 
@@ -1074,10 +1415,38 @@ namespace dlib
                 {
 
                     const std::string filename = oldest_syncfile();
-                    serialize(filename) << *this;
+                    const std::string temp_filename = filename + ".tmp";
+                    const unsigned long num_backups = num_sync_file_backups;
+                    if (background_sync && !do_it_now)
+                    {
+                        // Snapshot our state into memory, which is quick, and let another
+                        // thread do the slow part of putting it on disk while we keep
+                        // training.  The thread gets its own copy of everything it needs
+                        // and doesn't touch this object.
+                        std::vector<char> buffer;
+                        vectorstream sout(buffer);
+                        serialize(*this, sout);
+                        pending_sync_write = std::async(std::launch::async,
+                            [buffer = std::move(buffer), temp_filename, filename, num_backups]() {
+                            std::ofstream fout(temp_filename, std::ios::binary);
+                            fout.write(buffer.data(), buffer.size());
+                            fout.close();
+                            if (!fout)
+                                throw serialization_error("Unable to write " + temp_filename);
+                            install_sync_file(temp_filename, filename, num_backups);
+                        });
 
-                    if (verbose)
-                        std::cout << "Saved state to " << filename << std::endl;
+                        if (verbose)
+                            std::cout << "Saving state to " << filename << " in the background" << std::endl;
+                    }
+                    else
+                    {
+                        serialize(temp_filename) << *this;
+                        install_sync_file(temp_filename, filename, num_backups);
+
+                        if (verbose)
+                            std::cout << "Saved state to " << filename << std::endl;
+                    }
                 }
 
                 last_sync_time = std::chrono::system_clock::now();
@@ -1086,6 +1455,46 @@ namespace dlib
             }
         }
 
+        void finish_sync_file_write (
+        )
+        {
+            // get() rethrows any exception thrown while writing the file.
+            if (pending_sync_write.valid())
+                pending_sync_write.get();
+        }
+
+        static void install_sync_file (
+            const std::string& temp_filename,
+            const std::string& filename,
+            unsigned long num_backups
+        )
+        /*!
+            ensures
+                - Moves the completely written temp_filename to filename.  If num_backups
+                  != 0 then the file being replaced is kept as filename+".1", the previous
+                  filename+".1" becomes filename+".2", and so on, with the oldest backup
+                  beyond num_backups deleted.  So each sync file has its own chain of
+                  backups.
+        !*/
+        {
+            auto backup_name = [&](unsigned long i) { return filename + "." + std::to_string(i); };
+            if (num_backups != 0 && std::ifstream(filename, std::ios::binary))
+            {
+                std::remove(backup_name(num_backups).c_str());
+                for (unsigned long i = num_backups; i > 1; --i)
+                    std::rename(backup_name(i-1).c_str(), backup_name(i).c_str());
+                std::rename(filename.c_str(), backup_name(1).c_str());
+            }
+
+            if (std::rename(temp_filename.c_str(), filename.c_str()) != 0)
+            {
+                // On Windows rename() won't replace an existing file.
+                std::remove(filename.c_str());
+                if (std::rename(temp_filename.c_str(), filename.c_str()) != 0)
+                    throw serialization_error("Unable to rename " + temp_filename + " to " + filename);
+            }
+        }
+
         std::string newest_syncfile (
         )
         {
@@ -1171,6 +1580,11 @@ namespace dlib
             std::shared_ptr<net_type> net_copy;
             net_type& net;
             std::vector<solver_type> solvers;
+
+            // The sum of the parameter gradients of the micro-batches seen so far in the
+            // current gradient accumulation step.
+            std::vector<resizable_tensor> accumulated_gradients;
+            unsigned long num_accumulated_gradients = 0;
         };
 
         template <
@@ -1296,6 +1710,7 @@ namespace dlib
         std::deque<double> previous_loss_values;
         unsigned long max_num_epochs;
         size_t mini_batch_size;
+        unsigned long gradient_accumulation_steps;
         bool verbose;
         net_type& net;
         std::atomic<double> learning_rate;
@@ -1342,6 +1757,23 @@ namespace dlib
         bool sync_file_reloaded;
         unsigned long previous_loss_values_dump_amount;
         unsigned long test_previous_loss_values_dump_amount;
+
+        // The state of the data parallel mode.  These aren't serialized either.
+        std::function<void(std::vector<float>&)> cluster_all_reduce_sum;
+        std::function<void(std::vector<char>&)> cluster_broadcast;
+        unsigned long cluster_node_id = 0;
+        unsigned long cluster_size = 1;
+        bool cluster_state_synced = false;
+        std::vector<float> cluster_buffer;
+
+        // The micro-batches of the current gradient accumulation step.  Not serialized.
+        double accumulated_loss = 0;
+        unsigned long num_accumulated_micro_batches = 0;
+
+        // The state of background synchronization.  Also not serialized.
+        bool background_sync = false;
+        unsigned long num_sync_file_backups = 0;
+        std::future<void> pending_sync_write;
     };
 
 // ----------------------------------------------------------------------------------------
@@ -1377,6 +1809,7 @@ namespace dlib
         out << "  synchronization file:                       " << trainer.get_synchronization_file() << endl;
         out << "  trainer.get_solvers()[0]:                   " << trainer.get_solvers()[0] << endl;
         out << "  mini batch size:                            " << trainer.get_mini_batch_size() << endl;
+        out << "  gradient accumulation steps:                " << trainer.get_gradient_accumulation_steps() << endl;
         auto sched = trainer.get_learning_rate_schedule();
         if (sched.size() != 0)
         {
@@ -89,6 +89,7 @@ namespace dlib
                 - #get_test_iterations_without_progress_threshold() == 500
                 - #get_learning_rate_shrink_factor() == 0.1
                 - #get_learning_rate_schedule().size() == 0
+                - #get_gradient_accumulation_steps() == 1
                 - #get_train_one_step_calls() == 0
                 - #get_test_one_step_calls() == 0
                 - #get_synchronization_file() == ""
@@ -163,6 +164,41 @@ namespace dlib
                 - #get_mini_batch_size() == batch_size
         !*/
 
+        unsigned long get_gradient_accumulation_steps (
+        ) const;
+        /*!
+            ensures
+                - returns the number of mini-batches whose gradients are summed before the
+                  solvers are used to update the network.  That is, each mini-batch given
+                  to train_one_step() or used inside train() is treated as a micro-batch.
+                  The trainer computes its parameter gradients and adds them to the ones
+                  from the previous micro-batches, and only every
+                  get_gradient_accumulation_steps() micro-batches does it call the solvers
+                  with the average of these gradients.  So the network is updated as if it
+                  had been given a mini-batch get_gradient_accumulation_steps() times
+                  larger, while only one micro-batch at a time needs to fit in memory.
+                  The price is one extra copy of the parameter gradients.
+                - Each solver update counts as one training step for the purposes of the
+                  loss history, get_average_loss(), get_steps_without_progress(), and the
+                  learning rate schedule.  The loss of a step is the average loss of its
+                  micro-batches.  get_train_one_step_calls() still counts micro-batches.
+                - Micro-batches are processed by the trainer's background thread just like
+                  normal mini-batches, so you can load the next micro-batch while the
+                  current one is being processed.  If training stops part way through an
+                  accumulation step, the gradients accumulated so far are used by the next
+                  call to train_one_step() or train().
+        !*/
+
+        void set_gradient_accumulation_steps (
+            unsigned long num
+        );
+        /*!
+            requires
+                - num > 0
+            ensures
+                - #get_gradient_accumulation_steps() == num
+        !*/
+
         unsigned long get_max_num_epochs (
         ) const; 
         /*!
@@ -360,6 +396,47 @@ namespace dlib
                 - This object will not print anything to standard out
         !*/
 
+        template <typename bsp_context_type>
+        void be_data_parallel (
+            bsp_context_type& context
+        );
+        /*!
+            requires
+                - bsp_context_type is dlib::bsp_context, or some other object with the same
+                  node_id(), number_of_nodes(), all_reduce_sum(std::vector<float>&), and
+                  broadcast_from(std::vector<char>&, 0) members.
+                - context must remain valid for as long as this trainer is used.
+            ensures
+                - #is_data_parallel() == true
+                - Puts this trainer into data parallel mode.  Each of the
+                  context.number_of_nodes() processes in the BSP computation runs its own
+                  trainer on its own part of the training data and every training step the
+                  trainers average their parameter gradients with a ring all-reduce.  So the
+                  networks on all the nodes stay identical and each step uses the combined
+                  mini-batch of all the nodes.  This lets you train on CPUs spread over
+                  several machines, or in several processes on one machine.  Any CUDA
+                  devices given to the constructor are still used, the gradients are first
+                  averaged over the local devices and then over the processes.
+                - On the first training step, and whenever the trainer on any node reloads
+                  its state from a synchronization file, all the nodes first copy the
+                  network, solvers, learning rate, and loss history from node 0.  So the
+                  networks don't need to be initialized identically.
+                - The losses given to the learning rate schedule are averaged over the
+                  nodes too, so all the trainers make the same learning rate decisions.
+                - For this to work every node must make the same number of calls to
+                  train_one_step() and test_one_step(), in the same order, and use the same
+                  training settings.  Moreover, the trainer's thread uses context while
+                  training, so you must not use context yourself while the trainer is
+                  busy.  It's safe to use it again after calling get_net().
+        !*/
+
+        bool is_data_parallel (
+        ) const;
+        /*!
+            ensures
+                - returns true if be_data_parallel() has been called and false otherwise.
+        !*/
+
         void set_synchronization_file (
             const std::string& filename,
             std::chrono::seconds time_between_syncs = std::chrono::minutes(15)
@@ -392,6 +469,58 @@ namespace dlib
                   state to.  If the return value is "" then synchronization is disabled.
         !*/
 
+        void set_background_synchronization (
+            bool enabled
+        );
+        /*!
+            ensures
+                - #get_background_synchronization() == enabled
+                - Waits for any synchronization file write currently happening in the
+                  background to finish before changing the setting.
+        !*/
+
+        bool get_background_synchronization (
+        ) const;
+        /*!
+            ensures
+                - returns true if the periodic saves to the synchronization file are
+                  written by a background thread.  In this case, a periodic save only
+                  blocks training for as long as it takes to copy the trainer's state into
+                  a buffer in RAM.  Writing that buffer to disk happens in parallel with
+                  training, so with big networks training doesn't stall for seconds every
+                  time the state is saved.  The price is that the trainer keeps a RAM copy
+                  of its serialized state around.
+                - Regardless of this setting, saves are always first written to a temporary
+                  file that is then renamed to the synchronization file.  Saves forced by
+                  get_net() or the end of train() are written before those functions
+                  return.  An error writing a file in the background is thrown from the
+                  next call to a function that saves state, e.g. train_one_step() or
+                  get_net().
+                - The default is false.
+        !*/
+
+        void set_num_synchronization_file_backups (
+            unsigned long num
+        );
+        /*!
+            ensures
+                - #get_num_synchronization_file_backups() == num
+        !*/
+
+        unsigned long get_num_synchronization_file_backups (
+        ) const;
+        /*!
+            ensures
+                - returns the number of old versions the trainer keeps of each of the
+                  synchronization files get_synchronization_file() and
+                  get_synchronization_file()+"_".  When the trainer overwrites one of those
+                  two files the old version is renamed to that file's name plus ".1", the
+                  previous ".1" file becomes ".2", and so on.  Only the newest
+                  get_num_synchronization_file_backups() of these files are kept for each
+                  of the two, so you get a rotating history of checkpoints.
+                - The default is 0, i.e. no backups are kept.
+        !*/
+
         void train (
             const std::vector<input_type>& data,
             const std::vector<training_label_type>& labels 
@@ -7,6 +7,12 @@
 #include "input.h"
 #include "layers.h"
 #include "loss.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
 
 namespace dlib
 {
@@ -285,6 +291,70 @@ namespace dlib
         visit_layers(net, impl::visitor_bn_running_stats_window_size(new_window_size));
     }
 
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        class visitor_gradient_checkpointing
+        {
+        public:
+
+            visitor_gradient_checkpointing(bool enabled_) : enabled(enabled_) {}
+
+            template<typename input_layer_type>
+            void operator()(input_layer_type& ) const
+            {
+            }
+
+            template <typename T, typename U>
+            void operator()(add_loss_layer<T,U>& net) const
+            {
+                (*this)(net.subnet());
+            }
+
+            template <typename T, typename U, typename E>
+            void operator()(add_layer<T,U,E>& net) const
+            {
+                (*this)(net.subnet());
+            }
+
+            template <size_t N, template <typename> class R, typename U>
+            void operator()(repeat<N, R, U>& net) const
+            {
+                net.set_gradient_checkpointing(enabled);
+                for (size_t i = 0; i < N; ++i)
+                    (*this)(net.get_repeated_layer(i));
+                (*this)(net.subnet());
+            }
+
+            template <unsigned long ID, typename U, typename E>
+            void operator()(add_tag_layer<ID,U,E>& net) const
+            {
+                (*this)(net.subnet());
+            }
+
+            template <template<typename> class TAG_TYPE, typename U>
+            void operator()(add_skip_layer<TAG_TYPE,U>& net) const
+            {
+                (*this)(net.subnet());
+            }
+
+        private:
+
+            bool enabled;
+        };
+    }
+
+    template <typename net_type>
+    void set_all_gradient_checkpointing (
+        net_type& net,
+        bool enabled
+    )
+    {
+        impl::visitor_gradient_checkpointing temp(enabled);
+        temp(net);
+    }
+
 // ----------------------------------------------------------------------------------------
 
     namespace impl
@@ -1146,6 +1216,412 @@ namespace dlib
         net_to_dot(net, fout);
     }
 
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        // Estimates of the floating point operations done by one call to a layer's
+        // forward(), counting a multiply-add as two operations.  Layers that aren't listed
+        // here are taken to do one operation per output element.
+        template <typename LAYER_DETAILS>
+        struct layer_flops
+        {
+            static double estimate(const tensor& /*params*/, const tensor& /*input*/, const tensor& output)
+            { return output.size(); }
+        };
+
+        template <long nf, long nr, long nc, int sy, int sx, int py, int px>
+        struct layer_flops<con_<nf,nr,nc,sy,sx,py,px>>
+        {
+            // Each output is the dot product of a filter, plus its bias, with the input.
+            static double estimate(const tensor& params, const tensor& /*input*/, const tensor& output)
+            { return 2.0*output.size()*(params.size()/output.k()); }
+        };
+
+        template <long nf, long nr, long nc, int sy, int sx, int py, int px>
+        struct layer_flops<cont_<nf,nr,nc,sy,sx,py,px>>
+        {
+            // Each input is scaled by a filter and added to the output.
+            static double estimate(const tensor& params, const tensor& input, const tensor& /*output*/)
+            { return 2.0*input.size()*(params.size()/input.k()); }
+        };
+
+        template <unsigned long num_outputs, fc_bias_mode bias_mode>
+        struct layer_flops<fc_<num_outputs,bias_mode>>
+        {
+            static double estimate(const tensor& params, const tensor& /*input*/, const tensor& output)
+            { return 2.0*output.num_samples()*params.size(); }
+        };
+
+        template <unsigned long num_outputs, linear_bias_mode bias_mode>
+        struct layer_flops<linear_<num_outputs,bias_mode>>
+        {
+            // The weights are applied to every row of the input.
+            static double estimate(const tensor& params, const tensor& /*input*/, const tensor& output)
+            { return 2.0*(output.size()/output.nc())*params.size(); }
+        };
+
+        template <template<typename> class tag>
+        struct layer_flops<multm_prev_<tag>>
+        {
+            static double estimate(const tensor& /*params*/, const tensor& input, const tensor& output)
+            { return 2.0*output.size()*input.nc(); }
+        };
+
+        template <long nr, long nc>
+        double pooling_flops(const tensor& input, const tensor& output)
+        {
+            // A window size of 0 means the window covers the whole input.
+            return double(output.size())*(nr != 0 ? nr : input.nr())*(nc != 0 ? nc : input.nc());
+        }
+
+        template <long nr, long nc, int sy, int sx, int py, int px>
+        struct layer_flops<max_pool_<nr,nc,sy,sx,py,px>>
+        {
+            static double estimate(const tensor& /*params*/, const tensor& input, const tensor& output)
+            { return pooling_flops<nr,nc>(input, output); }
+        };
+
+        template <long nr, long nc, int sy, int sx, int py, int px>
+        struct layer_flops<avg_pool_<nr,nc,sy,sx,py,px>>
+        {
+            static double estimate(const tensor& /*params*/, const tensor& input, const tensor& output)
+            { return pooling_flops<nr,nc>(input, output); }
+        };
+    }
+
+    class dnn_profiler
+    {
+    public:
+
+        struct layer_stats
+        {
+            size_t index = 0;
+            std::string name;
+            std::string description;
+            unsigned long forward_calls = 0;
+            unsigned long backward_calls = 0;
+            double forward_seconds = 0;
+            double backward_seconds = 0;
+            size_t output_bytes = 0;
+            size_t parameter_bytes = 0;
+            double forward_flops = 0;
+            double total_forward_flops = 0;
+
+            double total_seconds() const { return forward_seconds + backward_seconds; }
+        };
+
+        dnn_profiler(
+        ) : epoch(clock::now()) {}
+
+        dnn_profiler(const dnn_profiler&) = delete;
+        dnn_profiler& operator=(const dnn_profiler&) = delete;
+
+        template <typename net_type>
+        void attach (
+            net_type& net
+        )
+        {
+            visit_layers(net, attach_visitor(*this));
+        }
+
+        template <typename net_type>
+        void detach (
+            net_type& net
+        )
+        {
+            visit_layers(net, detach_visitor(*this));
+            events.erase(std::remove_if(events.begin(), events.end(), [](const trace_event& e) { return e.layer->detached; }), events.end());
+            slots.erase(std::remove_if(slots.begin(), slots.end(), [](const std::unique_ptr<slot>& s) { return s->detached; }), slots.end());
+        }
+
+        size_t num_layers(
+        ) const { return slots.size(); }
+
+        std::vector<layer_stats> get_layer_stats (
+        ) const
+        {
+            std::vector<layer_stats> stats;
+            for (const auto& s : slots)
+                stats.push_back(s->stats);
+            return stats;
+        }
+
+        void clear (
+        )
+        {
+            for (auto& s : slots)
+            {
+                layer_stats& stats = s->stats;
+                stats.forward_calls = stats.backward_calls = 0;
+                stats.forward_seconds = stats.backward_seconds = 0;
+                stats.output_bytes = 0;
+                stats.forward_flops = stats.total_forward_flops = 0;
+            }
+            events.clear();
+            epoch = clock::now();
+        }
+
+        size_t get_max_trace_events(
+        ) const { return max_trace_events; }
+
+        void set_max_trace_events (
+            size_t num
+        ) { max_trace_events = num; }
+
+        size_t num_trace_events(
+        ) const { return events.size(); }
+
+        void print_report (
+            std::ostream& out
+        ) const
+        {
+            std::vector<const layer_stats*> stats;
+            double total_seconds = 0;
+            size_t output_bytes = 0, parameter_bytes = 0;
+            for (const auto& s : slots)
+            {
+                stats.push_back(&s->stats);
+                total_seconds += s->stats.total_seconds();
+                output_bytes += s->stats.output_bytes;
+                parameter_bytes += s->stats.parameter_bytes;
+            }
+            std::stable_sort(stats.begin(), stats.end(), [](const layer_stats* a, const layer_stats* b) { return a->total_seconds() > b->total_seconds(); });
+
+            const auto flags = out.flags();
+            const auto precision = out.precision();
+            out << std::fixed << std::setprecision(3);
+            out << std::left << std::setw(12) << "layer" << std::setw(16) << "type" << std::right
+                << std::setw(10) << "calls" << std::setw(12) << "fwd ms" << std::setw(12) << "bwd ms"
+                << std::setw(12) << "total ms" << std::setw(8) << "%"
+                << std::setw(12) << "output" << std::setw(12) << "params"
+                << std::setw(12) << "MFLOP" << std::setw(10) << "GFLOP/s" << "\n";
+            for (const layer_stats* s : stats)
+            {
+                out << std::left << std::setw(12) << ("layer<" + std::to_string(s->index) + ">")
+                    << std::setw(16) << s->name << std::right
+                    << std::setw(10) << s->forward_calls
+                    << std::setw(12) << per_call_ms(s->forward_seconds, s->forward_calls)
+                    << std::setw(12) << per_call_ms(s->backward_seconds, s->backward_calls)
+                    << std::setw(12) << 1000*s->total_seconds()
+                    << std::setw(8) << std::setprecision(1) << (total_seconds > 0 ? 100*s->total_seconds()/total_seconds : 0.0)
+                    << std::setw(12) << bytes_to_str(s->output_bytes)
+                    << std::setw(12) << bytes_to_str(s->parameter_bytes)
+                    << std::setw(12) << std::setprecision(3) << s->forward_flops/1e6
+                    << std::setw(10) << std::setprecision(2) << (s->forward_seconds > 0 ? s->total_forward_flops/s->forward_seconds/1e9 : 0.0)
+                    << std::setprecision(3) << "\n";
+            }
+            out << "total " << 1000*total_seconds << " ms in " << stats.size() << " layers, "
+                << bytes_to_str(output_bytes) << " of outputs, " << bytes_to_str(parameter_bytes) << " of parameters\n";
+            out.flags(flags);
+            out.precision(precision);
+        }
+
+        friend std::ostream& operator<< (std::ostream& out, const dnn_profiler& item)
+        {
+            item.print_report(out);
+            return out;
+        }
+
+        void write_chrome_trace (
+            std::ostream& out
+        ) const
+        {
+            const auto flags = out.flags();
+            const auto precision = out.precision();
+            out << std::fixed << std::setprecision(3);
+            out << "{\"traceEvents\":[";
+            for (size_t i = 0; i < events.size(); ++i)
+            {
+                const trace_event& e = events[i];
+                const layer_stats& s = e.layer->stats;
+                out << (i == 0 ? "\n" : ",\n")
+                    << "{\"name\":\"" << json_escape(s.name) << "\",\"cat\":\"" << (e.is_backward ? "backward" : "forward")
+                    << "\",\"ph\":\"X\",\"ts\":" << e.start_us << ",\"dur\":" << e.duration_us
+                    << ",\"pid\":0,\"tid\":0,\"args\":{\"layer\":" << s.index
+                    << ",\"description\":\"" << json_escape(s.description) << "\"}}";
+            }
+            out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+            out.flags(flags);
+            out.precision(precision);
+        }
+
+        void save_chrome_trace (
+            const std::string& filename
+        ) const
+        {
+            std::ofstream fout(filename);
+            if (!fout)
+                throw dlib::error("Unable to open " + filename + " for writing.");
+            write_chrome_trace(fout);
+        }
+
+    private:
+
+        typedef std::chrono::steady_clock clock;
+
+        struct slot : public impl::layer_profiler_hook
+        {
+            slot(dnn_profiler& owner_) : owner(owner_) {}
+
+            void begin(const tensor& input) override
+            {
+                // With CUDA, layers only queue their kernels, so wait for the device to
+                // finish both before and after the layer runs.
+                cuda::device_synchronize(input);
+                start = clock::now();
+            }
+
+            void end(bool is_backward, const tensor& input, const tensor& output, const tensor& params) override
+            {
+                cuda::device_synchronize(output);
+                const auto stop = clock::now();
+                const double seconds = std::chrono::duration<double>(stop - start).count();
+                if (is_backward)
+                {
+                    ++stats.backward_calls;
+                    stats.backward_seconds += seconds;
+                }
+                else
+                {
+                    ++stats.forward_calls;
+                    stats.forward_seconds += seconds;
+                    stats.output_bytes = output.size()*sizeof(float);
+                    stats.forward_flops = estimate_flops(params, input, output);
+                    stats.total_forward_flops += stats.forward_flops;
+                }
+                stats.parameter_bytes = params.size()*sizeof(float);
+
+                if (owner.events.size() < owner.max_trace_events)
+                {
+                    const auto us = [](clock::duration d) { return std::chrono::duration<double,std::micro>(d).count(); };
+                    owner.events.push_back(trace_event{this, is_backward, us(start - owner.epoch), us(stop - start)});
+                }
+            }
+
+            dnn_profiler& owner;
+            layer_stats stats;
+            double (*estimate_flops)(const tensor&, const tensor&, const tensor&) = nullptr;
+            clock::time_point start;
+            bool detached = false;
+        };
+
+        struct trace_event
+        {
+            const slot* layer;
+            bool is_backward;
+            double start_us;
+            double duration_us;
+        };
+
+        template <typename T, typename U, typename E>
+        void install (
+            size_t idx,
+            add_layer<T,U,E>& l
+        )
+        {
+            if (l.profiler.hook)
+                return;
+            std::unique_ptr<slot> s(new slot(*this));
+            s->stats.index = idx;
+            std::ostringstream sout;
+            sout << l.layer_details();
+            s->stats.description = sout.str();
+            s->stats.name = s->stats.description.substr(0, s->stats.description.find_first_of(" \t("));
+            s->stats.parameter_bytes = l.layer_details().get_layer_params().size()*sizeof(float);
+            s->estimate_flops = &impl::layer_flops<T>::estimate;
+            l.profiler.hook = s.get();
+            slots.push_back(std::move(s));
+        }
+
+        template <typename T, typename U, typename E>
+        void uninstall (
+            add_layer<T,U,E>& l
+        )
+        {
+            for (auto& s : slots)
+            {
+                if (l.profiler.hook == s.get())
+                {
+                    s->detached = true;
+                    l.profiler.hook = nullptr;
+                }
+            }
+        }
+
+        class attach_visitor
+        {
+        public:
+            attach_visitor(dnn_profiler& p_) : p(p_) {}
+
+            template <typename T>
+            void operator()(size_t, T&) const {}
+
+            template <typename T, typename U, typename E>
+            void operator()(size_t idx, add_layer<T,U,E>& l) const { p.install(idx, l); }
+
+        private:
+            dnn_profiler& p;
+        };
+
+        class detach_visitor
+        {
+        public:
+            detach_visitor(dnn_profiler& p_) : p(p_) {}
+
+            template <typename T>
+            void operator()(size_t, T&) const {}
+
+            template <typename T, typename U, typename E>
+            void operator()(size_t, add_layer<T,U,E>& l) const { p.uninstall(l); }
+
+        private:
+            dnn_profiler& p;
+        };
+
+        static double per_call_ms(double seconds, unsigned long calls)
+        {
+            return calls == 0 ? 0.0 : 1000*seconds/calls;
+        }
+
+        static std::string bytes_to_str(size_t bytes)
+        {
+            std::ostringstream sout;
+            sout << std::fixed << std::setprecision(1);
+            if (bytes >= (1ul<<30))
+                sout << bytes/double(1ul<<30) << " GiB";
+            else if (bytes >= (1ul<<20))
+                sout << bytes/double(1ul<<20) << " MiB";
+            else if (bytes >= (1ul<<10))
+                sout << bytes/double(1ul<<10) << " KiB";
+            else
+                sout << bytes << " B";
+            return sout.str();
+        }
+
+        static std::string json_escape(const std::string& str)
+        {
+            std::ostringstream sout;
+            for (char c : str)
+            {
+                if (c == '"' || c == '\\')
+                    sout << '\\' << c;
+                else if (c == '\t')
+                    sout << ' ';
+                else if (static_cast<unsigned char>(c) < 0x20)
+                    sout << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c) << std::dec << std::setfill(' ');
+                else
+                    sout << c;
+            }
+            return sout.str();
+        }
+
+        std::vector<std::unique_ptr<slot>> slots;
+        std::vector<trace_event> events;
+        size_t max_trace_events = 100000;
+        clock::time_point epoch;
+    };
+
 // ----------------------------------------------------------------------------------------
 
 }
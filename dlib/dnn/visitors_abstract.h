@@ -27,6 +27,23 @@ namespace dlib
               new_window_size.
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    template <typename net_type>
+    void set_all_gradient_checkpointing (
+        net_type& net,
+        bool enabled
+    );
+    /*!
+        requires
+            - net_type is an object of type add_layer, add_loss_layer, add_skip_layer,
+              add_tag_layer, or repeat.
+        ensures
+            - Calls set_gradient_checkpointing(enabled) on every repeat layer in net,
+              including repeat layers nested inside other repeat layers.  See the
+              documentation of repeat::set_gradient_checkpointing() for details.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     template <typename net_type>
@@ -226,6 +243,202 @@ namespace dlib
             - This function is just like the above net_to_dot(), except it writes to a file
               rather than an ostream.
     !*/
+
+// ----------------------------------------------------------------------------------------
+
+    class dnn_profiler
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object measures how much time each computational layer of a network
+                spends in forward() and backward(), so slow layers can be found without an
+                external profiler.  It also records how large each layer's output and
+                parameters are and estimates the floating point operations each forward()
+                does.  For example:
+                    dnn_profiler prof;
+                    prof.attach(net);
+                    for (int i = 0; i < 100; ++i)
+                        net(samples);
+                    std::cout << prof;
+                    prof.save_chrome_trace("trace.json");
+                    prof.detach(net);
+
+                attach() installs a hook in each add_layer of the network.  The time
+                measured for a layer covers only its own forward() or backward() call, not
+                the layers below it.  A network without hooks, i.e. one that was never
+                attached or has been detached, only pays for one pointer test per layer
+                call.
+
+                The FLOP estimates count a multiply-add as two operations.  con, cont, fc,
+                linear, multm_prev, max_pool, and avg_pool layers are counted from the
+                sizes of their inputs, outputs, and parameters.  All other layers are
+                counted as one operation per output element.
+
+                When dlib is built with CUDA, the profiler waits for the device to finish
+                before and after each layer, so the times are those of the layer's
+                kernels, but the network runs slower than it would without the profiler.
+
+            THREAD SAFETY
+                The networks a dnn_profiler is attached to must not be run by several
+                threads at the same time.  Copies of an attached network are not
+                attached, so a dnn_trainer that trains on several devices only reports the
+                layers of the network it was given.
+        !*/
+
+    public:
+
+        struct layer_stats
+        {
+            size_t index;                   // The i in layer<i>(net).
+            std::string name;               // e.g. "con" or "fc".
+            std::string description;        // What operator<< prints for the layer.
+            unsigned long forward_calls;
+            unsigned long backward_calls;
+            double forward_seconds;         // Total over all calls.
+            double backward_seconds;        // Total over all calls.
+            size_t output_bytes;            // Size of the output of the last forward().
+            size_t parameter_bytes;
+            double forward_flops;           // Estimated FLOPs of the last forward().
+            double total_forward_flops;     // Estimated FLOPs of all forward() calls.
+
+            double total_seconds() const { return forward_seconds + backward_seconds; }
+        };
+
+        dnn_profiler(
+        );
+        /*!
+            ensures
+                - #num_layers() == 0
+                - #num_trace_events() == 0
+                - #get_max_trace_events() == 100000
+        !*/
+
+        dnn_profiler(const dnn_profiler&) = delete;
+        dnn_profiler& operator=(const dnn_profiler&) = delete;
+
+        template <typename net_type>
+        void attach (
+            net_type& net
+        );
+        /*!
+            requires
+                - net_type is an object of type add_layer, add_loss_layer, add_skip_layer, or
+                  add_tag_layer.
+                - net must be destroyed, or detach(net) called, before this object is
+                  destroyed.
+            ensures
+                - Starts profiling every computational layer in net, including the layers
+                  inside repeat layers.
+                - Layers that are already attached to a profiler are left as they are.
+                - #num_layers() == num_layers() + the number of layers added.
+        !*/
+
+        template <typename net_type>
+        void detach (
+            net_type& net
+        );
+        /*!
+            requires
+                - net_type is an object of type add_layer, add_loss_layer, add_skip_layer, or
+                  add_tag_layer.
+            ensures
+                - Stops profiling the layers of net that are attached to this object, and
+                  discards their statistics and trace events.
+        !*/
+
+        size_t num_layers(
+        ) const;
+        /*!
+            ensures
+                - returns the number of layers being profiled.
+        !*/
+
+        std::vector<layer_stats> get_layer_stats(
+        ) const;
+        /*!
+            ensures
+                - returns the statistics of all the layers being profiled, in the order they
+                  were attached, i.e. from the top of each network to the bottom.
+                - returns a vector of size num_layers().
+        !*/
+
+        void clear(
+        );
+        /*!
+            ensures
+                - Resets the call counts, times, and FLOP counts of all layers to 0 and
+                  discards all trace events, while the layers stay attached.
+                - Trace events recorded from now on are timed from this call.
+        !*/
+
+        size_t get_max_trace_events(
+        ) const;
+        /*!
+            ensures
+                - returns the largest number of trace events this object stores.  Once
+                  there are that many, later calls are still added to the layer statistics
+                  but not to the trace.
+        !*/
+
+        void set_max_trace_events (
+            size_t num
+        );
+        /*!
+            ensures
+                - #get_max_trace_events() == num
+        !*/
+
+        size_t num_trace_events(
+        ) const;
+        /*!
+            ensures
+                - returns the number of trace events stored.  Every forward() or backward()
+                  call of a profiled layer adds one, up to get_max_trace_events().
+        !*/
+
+        void print_report (
+            std::ostream& out
+        ) const;
+        /*!
+            ensures
+                - Prints a table to out with one row per profiled layer, sorted by total
+                  time, slowest first.  Each row shows the number of forward() calls, the
+                  mean time of a forward() and backward() call, the total time and its
+                  share of the time of all layers, the output and parameter sizes, the
+                  estimated MFLOPs of a forward() call, and the GFLOP/s forward() achieves.
+        !*/
+
+        friend std::ostream& operator<< (
+            std::ostream& out,
+            const dnn_profiler& item
+        );
+        /*!
+            ensures
+                - calls item.print_report(out) and returns out.
+        !*/
+
+        void write_chrome_trace (
+            std::ostream& out
+        ) const;
+        /*!
+            ensures
+                - Writes the stored trace events to out in the Chrome trace event format, as
+                  JSON.  The file can be viewed in chrome://tracing or
+                  https://ui.perfetto.dev.  There is one event per layer call, named after
+                  the layer type, in the "forward" or "backward" category, with the layer's
+                  index and description as arguments.
+        !*/
+
+        void save_chrome_trace (
+            const std::string& filename
+        ) const;
+        /*!
+            ensures
+                - Writes the trace, as write_chrome_trace() does, to the given file.
+                - Throws dlib::error if the file can't be opened.
+        !*/
+    };
+
 }
 
 #endif // DLIB_DNn_VISITORS_ABSTRACT_H_
@@ -20,6 +20,9 @@
 #include "fft_size.h"
 #include "../hash.h"
 #include "../assert.h"
+#ifndef DLIB_ISO_CPP_ONLY
+#include "../threads/parallel_for_extension.h"
+#endif
 
 #define C_FIXDIV(x,y) /*noop*/
 
@@ -157,8 +160,8 @@ namespace dlib
             }
         }
 
-        template<typename T>
-        inline void kf_bfly4(
+        template<bool inverse, typename T>
+        inline void kf_bfly4_impl(
             std::complex<T> * Fout,
             const size_t fstride,
             const kiss_fft_state<T>& cfg,
@@ -188,7 +191,7 @@ namespace dlib
 
                 Fout[k] += scratch[3];
 
-                if(cfg.inverse) {
+                if (inverse) {
                     Fout[m+k]  = scratch[5] - rot_PI_2(scratch[4]);
                     Fout[m3+k] = scratch[5] + rot_PI_2(scratch[4]);
                 }else {
@@ -198,6 +201,22 @@ namespace dlib
             }
         }
 
+        template<typename T>
+        inline void kf_bfly4(
+            std::complex<T> * Fout,
+            const size_t fstride,
+            const kiss_fft_state<T>& cfg,
+            const size_t m
+        )
+        {
+            // Dispatch on the direction once so the inner loop is branch free and can be
+            // vectorized by the compiler.
+            if (cfg.inverse)
+                kf_bfly4_impl<true>(Fout, fstride, cfg, m);
+            else
+                kf_bfly4_impl<false>(Fout, fstride, cfg, m);
+        }
+
         template<typename T>
         inline void kf_bfly5(
             std::complex<T> * Fout,
@@ -398,6 +417,26 @@ namespace dlib
             }
         }
 
+        /*
+         *  Splits [0,n) into blocks and calls f(begin,end) on each of them, using the
+         *  default_thread_pool() when the total amount of work, given by num_points,
+         *  is large enough to amortize the cost of dispatching tasks.  Small transforms,
+         *  like the ones done per frame by the correlation_tracker, always run serially.
+         */
+        template<typename F>
+        inline void parallel_blocks(long n, long num_points, const F& f)
+        {
+#ifndef DLIB_ISO_CPP_ONLY
+            constexpr long min_points_for_threading = 1L<<16;
+            if (n > 1 && num_points >= min_points_for_threading && default_thread_pool().num_threads_in_pool() > 1)
+            {
+                parallel_for_blocked(default_thread_pool(), 0, n, f, 1);
+                return;
+            }
+#endif
+            f(0, n);
+        }
+
         template<typename T>
         inline kiss_fftnd_state<T>::kiss_fftnd_state(const plan_key& key)
         {
@@ -430,8 +469,13 @@ namespace dlib
                 int curdim = cfg.dims[k];
                 int stride = cfg.dims.num_elements() / curdim;
 
-                for (int i=0 ; i<stride ; ++i ) 
-                    kiss_fft_stride(cfg.plans[k], bufin+i , bufout+i*curdim, stride );
+                // Each of the stride transforms along the current dimension reads and
+                // writes disjoint parts of the buffers so they can be done in parallel.
+                parallel_blocks(stride, cfg.dims.num_elements(), [&, bufin, bufout](long begin, long end)
+                {
+                    for (long i = begin; i < end; ++i)
+                        kiss_fft_stride(cfg.plans[k], bufin+i , bufout+i*curdim, stride );
+                });
 
                 /*toggle back and forth between the two buffers*/
                 if (bufout == &tmpbuf[0])
@@ -544,23 +588,30 @@ namespace dlib
             const int dimOther = plan.cfg_nd.dims.num_elements();
             const int nrbins   = dimReal/2+1;
 
-            std::vector<std::complex<T>> tmp1(std::max<int>(nrbins, dimOther));
             std::vector<std::complex<T>> tmp2(plan.cfg_nd.dims.num_elements()*dimReal);
 
             // take a real chunk of data, fft it and place the output at correct intervals
-            for (int k1 = 0; k1 < dimOther; ++k1) 
+            parallel_blocks(dimOther, dimOther*dimReal, [&](long begin, long end)
             {
-                kiss_fftr(plan.cfg_r, timedata + k1*dimReal , &tmp1[0]); // tmp1 now holds nrbins complex points
-                for (int k2 = 0; k2 < nrbins; ++k2)
-                   tmp2[k2*dimOther+k1] = tmp1[k2];
-            }
+                std::vector<std::complex<T>> tmp1(nrbins);
+                for (long k1 = begin; k1 < end; ++k1) 
+                {
+                    kiss_fftr(plan.cfg_r, timedata + k1*dimReal , &tmp1[0]); // tmp1 now holds nrbins complex points
+                    for (int k2 = 0; k2 < nrbins; ++k2)
+                       tmp2[k2*dimOther+k1] = tmp1[k2];
+                }
+            });
 
-            for (int k2 = 0; k2 < nrbins; ++k2) 
+            parallel_blocks(nrbins, dimOther*dimReal, [&](long begin, long end)
             {
-                kiss_fftnd(plan.cfg_nd, &tmp2[k2*dimOther], &tmp1[0]);  // tmp1 now holds dimOther complex points
-                for (int k1 = 0; k1 < dimOther; ++k1) 
-                    freqdata[ k1*(nrbins) + k2] = tmp1[k1];
-            }
+                std::vector<std::complex<T>> tmp1(dimOther);
+                for (long k2 = begin; k2 < end; ++k2) 
+                {
+                    kiss_fftnd(plan.cfg_nd, &tmp2[k2*dimOther], &tmp1[0]);  // tmp1 now holds dimOther complex points
+                    for (int k1 = 0; k1 < dimOther; ++k1) 
+                        freqdata[ k1*(nrbins) + k2] = tmp1[k1];
+                }
+            });
         }
 
         template<typename T>
@@ -570,22 +621,29 @@ namespace dlib
             const int dimOther = plan.cfg_nd.dims.num_elements();
             const int nrbins   = dimReal/2+1;
 
-            std::vector<std::complex<T>> tmp1(std::max<int>(nrbins, dimOther));
             std::vector<std::complex<T>> tmp2(plan.cfg_nd.dims.num_elements()*dimReal);
 
-            for (int k2 = 0; k2 < nrbins; ++k2) 
+            parallel_blocks(nrbins, dimOther*dimReal, [&](long begin, long end)
             {
-                for (int k1 = 0; k1 < dimOther; ++k1) 
-                    tmp1[k1] = freqdata[ k1*(nrbins) + k2 ];
-                kiss_fftnd(plan.cfg_nd, &tmp1[0], &tmp2[k2*dimOther]);
-            }
+                std::vector<std::complex<T>> tmp1(dimOther);
+                for (long k2 = begin; k2 < end; ++k2) 
+                {
+                    for (int k1 = 0; k1 < dimOther; ++k1) 
+                        tmp1[k1] = freqdata[ k1*(nrbins) + k2 ];
+                    kiss_fftnd(plan.cfg_nd, &tmp1[0], &tmp2[k2*dimOther]);
+                }
+            });
 
-            for (int k1 = 0; k1 < dimOther; ++k1) 
+            parallel_blocks(dimOther, dimOther*dimReal, [&](long begin, long end)
             {
-                for (int k2 = 0; k2 < nrbins; ++k2)
-                    tmp1[k2] = tmp2[ k2*dimOther+k1 ];
-                kiss_ifftr(plan.cfg_r, &tmp1[0], timedata + k1*dimReal);
-            }
+                std::vector<std::complex<T>> tmp1(nrbins);
+                for (long k1 = begin; k1 < end; ++k1) 
+                {
+                    for (int k2 = 0; k2 < nrbins; ++k2)
+                        tmp1[k2] = tmp2[ k2*dimOther+k1 ];
+                    kiss_ifftr(plan.cfg_r, &tmp1[0], timedata + k1*dimReal);
+                }
+            });
         }
 
         struct hasher
@@ -599,17 +657,13 @@ namespace dlib
             static std::mutex m;
             static std::unordered_map<plan_key, plan_type, hasher> plans;
             
+            // References into an unordered_map stay valid when other elements are
+            // inserted, so the plan can be used after the lock is released.
             std::lock_guard<std::mutex> l(m);
             auto it = plans.find(key);
-            if (it != plans.end())
-            {
-                return it->second;
-            }
-            else
-            {
-                plans[key] = plan_type(key);
-                return plans[key];
-            }
+            if (it == plans.end())
+                it = plans.emplace(key, plan_type(key)).first;
+            return it->second;
         }
     }
 
@@ -8,6 +8,7 @@
 #include "../array2d.h"
 #include "../geometry.h"
 #include "spatial_filtering.h"
+#include <vector>
 
 namespace dlib
 {
@@ -147,6 +148,126 @@ namespace dlib
     namespace impl
     {
 
+        template <typename T, typename row_filter, typename row_writer>
+        void pyramid_down_2_1_rows (
+            const long down_nr,
+            const long row_size,
+            row_filter&& filter_row,
+            row_writer&& write_row
+        )
+        /*!
+            requires
+                - filter_row(r, T* dst) writes row_size horizontally filtered values
+                  computed from row r of the input image into dst.
+                - write_row(dr, const T* sums) stores the row_size vertically filtered
+                  values in sums into row dr of the output image.
+            ensures
+                - Runs the vertical part of the 5 tap pyramid_down_2_1 filter for all
+                  down_nr output rows.  Rather than filtering the whole input image into a
+                  temporary image, each band of output rows keeps only the 5 filtered input
+                  rows it needs in a small ring buffer.  This keeps the working set in cache
+                  and the inner loops run over contiguous arrays the compiler can vectorize.
+        !*/
+        {
+            parallel_image_blocks(down_nr, down_nr*row_size, [&](long begin, long end)
+            {
+                std::vector<T> buf(6*row_size);
+                T* const sums = &buf[5*row_size];
+                auto row = [&](long r) { return &buf[(r%5)*row_size]; };
+
+                for (long r = 2*begin; r < 2*begin+3; ++r)
+                    filter_row(r, row(r));
+
+                for (long dr = begin; dr < end; ++dr)
+                {
+                    const long r = 2*dr+2;
+                    filter_row(r+1, row(r+1));
+                    filter_row(r+2, row(r+2));
+
+                    const T* const p0 = row(r-2);
+                    const T* const p1 = row(r-1);
+                    const T* const p2 = row(r);
+                    const T* const p3 = row(r+1);
+                    const T* const p4 = row(r+2);
+                    for (long c = 0; c < row_size; ++c)
+                        sums[c] = p0[c] + p1[c]*4 + p2[c]*6 + p3[c]*4 + p4[c];
+
+                    write_row(dr, sums);
+                }
+            });
+        }
+
+    // ----------------------------------------------------------------------------------------
+
+        template <typename P, typename T>
+        inline void pyramid_down_2_1_filter_row (
+            const P* src,
+            T* dst,
+            const long n
+        )
+        {
+            for (long c = 0; c < n; ++c)
+            {
+                T pix1, pix2, pix3, pix4, pix5;
+                assign_pixel(pix1, src[0]);
+                assign_pixel(pix2, src[1]);
+                assign_pixel(pix3, src[2]);
+                assign_pixel(pix4, src[3]);
+                assign_pixel(pix5, src[4]);
+                dst[c] = pix1 + pix2*4 + pix3*6 + pix4*4 + pix5;
+                src += 2;
+            }
+        }
+
+        // The common pixel types don't need any pixel conversions so we give them plain
+        // arithmetic loops.
+        template <typename P, typename T>
+        inline void pyramid_down_2_1_filter_row_arithmetic (
+            const P* src,
+            T* dst,
+            const long n
+        )
+        {
+            for (long c = 0; c < n; ++c)
+            {
+                const long oc = 2*c;
+                dst[c] = (T)src[oc] + (T)src[oc+1]*4 + (T)src[oc+2]*6 + (T)src[oc+3]*4 + (T)src[oc+4];
+            }
+        }
+
+        inline void pyramid_down_2_1_filter_row (const unsigned char* src, int32* dst, const long n)
+        { pyramid_down_2_1_filter_row_arithmetic(src, dst, n); }
+
+        inline void pyramid_down_2_1_filter_row (const float* src, double* dst, const long n)
+        { pyramid_down_2_1_filter_row_arithmetic(src, dst, n); }
+
+    // ----------------------------------------------------------------------------------------
+
+        template <typename P, typename T>
+        inline void pyramid_down_2_1_write_row (
+            const T* sums,
+            P* dst,
+            const long n
+        )
+        {
+            for (long c = 0; c < n; ++c)
+                assign_pixel(dst[c], sums[c]/256);
+        }
+
+        inline void pyramid_down_2_1_write_row (const int32* sums, unsigned char* dst, const long n)
+        {
+            for (long c = 0; c < n; ++c)
+                dst[c] = (unsigned char)(sums[c]/256);
+        }
+
+        inline void pyramid_down_2_1_write_row (const double* sums, float* dst, const long n)
+        {
+            for (long c = 0; c < n; ++c)
+                dst[c] = (float)(sums[c]/256);
+        }
+
+    // ----------------------------------------------------------------------------------------
+
         class pyramid_down_2_1 : noncopyable
         {
         public:
@@ -271,9 +392,8 @@ namespace dlib
 
                 typedef typename pixel_traits<in_pixel_type>::basic_pixel_type bp_type;
                 typedef typename promote<bp_type>::type ptype;
-                array2d<ptype> temp_img;
-                temp_img.set_size(original.nr(), (original.nc()-3)/2);
-                down.set_size((original.nr()-3)/2, (original.nc()-3)/2);
+                const long down_nc = (original.nc()-3)/2;
+                down.set_size((original.nr()-3)/2, down_nc);
 
 
                 // This function applies a 5x5 Gaussian filter to the image.  It
@@ -281,62 +401,12 @@ namespace dlib
                 // components and then downsamples the image by dropping every other
                 // row and column.  Note that we can do these things all together in
                 // one step.
-
-                // apply row filter
-                for (long r = 0; r < temp_img.nr(); ++r)
-                {
-                    long oc = 0;
-                    for (long c = 0; c < temp_img.nc(); ++c)
-                    {
-                        ptype pix1;
-                        ptype pix2;
-                        ptype pix3;
-                        ptype pix4;
-                        ptype pix5;
-
-                        assign_pixel(pix1, original[r][oc]);
-                        assign_pixel(pix2, original[r][oc+1]);
-                        assign_pixel(pix3, original[r][oc+2]);
-                        assign_pixel(pix4, original[r][oc+3]);
-                        assign_pixel(pix5, original[r][oc+4]);
-
-                        pix2 *= 4;
-                        pix3 *= 6;
-                        pix4 *= 4;
-                        
-                        assign_pixel(temp_img[r][c], pix1 + pix2 + pix3 + pix4 + pix5);
-                        oc += 2;
-                    }
-                }
-
-
-                // apply column filter
-                long dr = 0;
-                for (long r = 2; r < temp_img.nr()-2; r += 2)
-                {
-                    for (long c = 0; c < temp_img.nc(); ++c)
-                    {
-                        ptype temp = temp_img[r-2][c] + 
-                                    temp_img[r-1][c]*4 +  
-                                    temp_img[r  ][c]*6 +  
-                                    temp_img[r+1][c]*4 +  
-                                    temp_img[r+2][c];  
-
-                        assign_pixel(down[dr][c],temp/256);
-                    }
-                    ++dr;
-                }
-
+                pyramid_down_2_1_rows<ptype>(down.nr(), down_nc,
+                    [&](long r, ptype* dst) { pyramid_down_2_1_filter_row(&original[r][0], dst, down_nc); },
+                    [&](long dr, const ptype* sums) { pyramid_down_2_1_write_row(sums, &down[dr][0], down_nc); }
+                );
             }
 
-        private:
-            struct rgbptype 
-            {
-                uint16 red;
-                uint16 green;
-                uint16 blue;
-            };
-        public:
         // ------------------------------------------
         //       OVERLOAD FOR RGB TO RGB IMAGES
         // ------------------------------------------
@@ -370,99 +440,46 @@ namespace dlib
                     return;
                 }
 
-                array2d<rgbptype> temp_img;
-                temp_img.set_size(original.nr(), (original.nc()-3)/2);
-                down.set_size((original.nr()-3)/2, (original.nc()-3)/2);
-
+                const long down_nc = (original.nc()-3)/2;
+                down.set_size((original.nr()-3)/2, down_nc);
 
                 // This function applies a 5x5 Gaussian filter to the image.  It
                 // does this by separating the filter into its horizontal and vertical
                 // components and then downsamples the image by dropping every other
                 // row and column.  Note that we can do these things all together in
                 // one step.
-
-                // apply row filter
-                for (long r = 0; r < temp_img.nr(); ++r)
-                {
-                    long oc = 0;
-                    for (long c = 0; c < temp_img.nc(); ++c)
+                //
+                // The filtered rows are stored as separate red, green and blue planes so
+                // that the vertical filter is a single loop over plain uint16 values.
+                pyramid_down_2_1_rows<uint16>(down.nr(), 3*down_nc,
+                    [&](long r, uint16* dst)
                     {
-                        rgbptype pix1;
-                        rgbptype pix2;
-                        rgbptype pix3;
-                        rgbptype pix4;
-                        rgbptype pix5;
-
-                        pix1.red = original[r][oc].red;
-                        pix2.red = original[r][oc+1].red;
-                        pix3.red = original[r][oc+2].red;
-                        pix4.red = original[r][oc+3].red;
-                        pix5.red = original[r][oc+4].red;
-                        pix1.green = original[r][oc].green;
-                        pix2.green = original[r][oc+1].green;
-                        pix3.green = original[r][oc+2].green;
-                        pix4.green = original[r][oc+3].green;
-                        pix5.green = original[r][oc+4].green;
-                        pix1.blue = original[r][oc].blue;
-                        pix2.blue = original[r][oc+1].blue;
-                        pix3.blue = original[r][oc+2].blue;
-                        pix4.blue = original[r][oc+3].blue;
-                        pix5.blue = original[r][oc+4].blue;
-
-                        pix2.red *= 4;
-                        pix3.red *= 6;
-                        pix4.red *= 4;
-
-                        pix2.green *= 4;
-                        pix3.green *= 6;
-                        pix4.green *= 4;
-
-                        pix2.blue *= 4;
-                        pix3.blue *= 6;
-                        pix4.blue *= 4;
-                        
-                        rgbptype temp;
-                        temp.red = pix1.red + pix2.red + pix3.red + pix4.red + pix5.red;
-                        temp.green = pix1.green + pix2.green + pix3.green + pix4.green + pix5.green;
-                        temp.blue = pix1.blue + pix2.blue + pix3.blue + pix4.blue + pix5.blue;
-
-                        temp_img[r][c] = temp;
-
-                        oc += 2;
-                    }
-                }
-
-
-                // apply column filter
-                long dr = 0;
-                for (long r = 2; r < temp_img.nr()-2; r += 2)
-                {
-                    for (long c = 0; c < temp_img.nc(); ++c)
+                        const auto* src = &original[r][0];
+                        uint16* red = dst;
+                        uint16* green = dst + down_nc;
+                        uint16* blue = dst + 2*down_nc;
+                        for (long c = 0; c < down_nc; ++c)
+                        {
+                            red[c]   = src[0].red   + src[1].red*4   + src[2].red*6   + src[3].red*4   + src[4].red;
+                            green[c] = src[0].green + src[1].green*4 + src[2].green*6 + src[3].green*4 + src[4].green;
+                            blue[c]  = src[0].blue  + src[1].blue*4  + src[2].blue*6  + src[3].blue*4  + src[4].blue;
+                            src += 2;
+                        }
+                    },
+                    [&](long dr, const uint16* sums)
                     {
-                        rgbptype temp;
-                        temp.red = temp_img[r-2][c].red + 
-                                temp_img[r-1][c].red*4 +  
-                                temp_img[r  ][c].red*6 +  
-                                temp_img[r+1][c].red*4 +  
-                                temp_img[r+2][c].red;  
-                        temp.green = temp_img[r-2][c].green + 
-                                    temp_img[r-1][c].green*4 +  
-                                    temp_img[r  ][c].green*6 +  
-                                    temp_img[r+1][c].green*4 +  
-                                    temp_img[r+2][c].green;  
-                        temp.blue = temp_img[r-2][c].blue + 
-                                    temp_img[r-1][c].blue*4 +  
-                                    temp_img[r  ][c].blue*6 +  
-                                    temp_img[r+1][c].blue*4 +  
-                                    temp_img[r+2][c].blue;  
-
-                        down[dr][c].red = temp.red/256;
-                        down[dr][c].green = temp.green/256;
-                        down[dr][c].blue = temp.blue/256;
+                        auto* dst = &down[dr][0];
+                        const uint16* red = sums;
+                        const uint16* green = sums + down_nc;
+                        const uint16* blue = sums + 2*down_nc;
+                        for (long c = 0; c < down_nc; ++c)
+                        {
+                            dst[c].red = red[c]/256;
+                            dst[c].green = green[c]/256;
+                            dst[c].blue = blue[c]/256;
+                        }
                     }
-                    ++dr;
-                }
-
+                );
             }
 
             template <
@@ -622,36 +639,42 @@ namespace dlib
                 down.set_size(part_nr, part_nc);
 
 
-                long rr = 1;
-                long r;
-                for (r = 0; r < full_nr; r+=size_out)
+                // Each pass of this loop fills two rows of down using only original, so
+                // bands of them can be computed in parallel.
+                parallel_image_blocks(full_nr/size_out, full_nr*part_nc, [&](long begin, long end)
                 {
-                    long cc = 1;
-                    long c;
-                    for (c = 0; c < full_nc; c+=size_out)
+                    for (long i = begin; i < end; ++i)
                     {
-                        ptype block[size_in][size_in];
-                        separable_3x3_filter_block_grayscale(block, original_, rr, cc, 2, 12, 2);
-
-                        // bi-linearly interpolate block 
-                        assign_pixel(down[r][c]     , (block[0][0]*9 + block[1][0]*3 + block[0][1]*3 + block[1][1])/(16*256));
-                        assign_pixel(down[r][c+1]   , (block[0][2]*9 + block[1][2]*3 + block[0][1]*3 + block[1][1])/(16*256));
-                        assign_pixel(down[r+1][c]   , (block[2][0]*9 + block[1][0]*3 + block[2][1]*3 + block[1][1])/(16*256));
-                        assign_pixel(down[r+1][c+1] , (block[2][2]*9 + block[1][2]*3 + block[2][1]*3 + block[1][1])/(16*256));
-
-                        cc += size_in;
-                    }
-                    if (part_nc - full_nc == 1)
-                    {
-                        ptype block[size_in][2];
-                        separable_3x3_filter_block_grayscale(block, original_, rr, cc, 2, 12, 2);
-
-                        // bi-linearly interpolate partial block 
-                        assign_pixel(down[r][c]     , (block[0][0]*9 + block[1][0]*3 + block[0][1]*3 + block[1][1])/(16*256));
-                        assign_pixel(down[r+1][c]   , (block[2][0]*9 + block[1][0]*3 + block[2][1]*3 + block[1][1])/(16*256));
+                        const long r = i*size_out;
+                        const long rr = 1 + i*size_in;
+                        long cc = 1;
+                        long c;
+                        for (c = 0; c < full_nc; c+=size_out)
+                        {
+                            ptype block[size_in][size_in];
+                            separable_3x3_filter_block_grayscale(block, original_, rr, cc, 2, 12, 2);
+
+                            // bi-linearly interpolate block 
+                            assign_pixel(down[r][c]     , (block[0][0]*9 + block[1][0]*3 + block[0][1]*3 + block[1][1])/(16*256));
+                            assign_pixel(down[r][c+1]   , (block[0][2]*9 + block[1][2]*3 + block[0][1]*3 + block[1][1])/(16*256));
+                            assign_pixel(down[r+1][c]   , (block[2][0]*9 + block[1][0]*3 + block[2][1]*3 + block[1][1])/(16*256));
+                            assign_pixel(down[r+1][c+1] , (block[2][2]*9 + block[1][2]*3 + block[2][1]*3 + block[1][1])/(16*256));
+
+                            cc += size_in;
+                        }
+                        if (part_nc - full_nc == 1)
+                        {
+                            ptype block[size_in][2];
+                            separable_3x3_filter_block_grayscale(block, original_, rr, cc, 2, 12, 2);
+
+                            // bi-linearly interpolate partial block 
+                            assign_pixel(down[r][c]     , (block[0][0]*9 + block[1][0]*3 + block[0][1]*3 + block[1][1])/(16*256));
+                            assign_pixel(down[r+1][c]   , (block[2][0]*9 + block[1][0]*3 + block[2][1]*3 + block[1][1])/(16*256));
+                        }
                     }
-                    rr += size_in;
-                }
+                });
+                const long r = full_nr;
+                const long rr = 1 + (full_nr/size_out)*size_in;
                 if (part_nr - full_nr == 1)
                 {
                     long cc = 1;
@@ -731,52 +754,58 @@ namespace dlib
                 down.set_size(part_nr, part_nc);
 
 
-                long rr = 1;
-                long r;
-                for (r = 0; r < full_nr; r+=size_out)
+                // Each pass of this loop fills two rows of down using only original, so
+                // bands of them can be computed in parallel.
+                parallel_image_blocks(full_nr/size_out, full_nr*part_nc, [&](long begin, long end)
                 {
-                    long cc = 1;
-                    long c;
-                    for (c = 0; c < full_nc; c+=size_out)
+                    for (long i = begin; i < end; ++i)
                     {
-                        rgbptype block[size_in][size_in];
-                        separable_3x3_filter_block_rgb(block, original_, rr, cc, 2, 12, 2);
-
-                        // bi-linearly interpolate block 
-                        down[r][c].red       = (block[0][0].red*9   + block[1][0].red*3   + block[0][1].red*3   + block[1][1].red)/(16*256);
-                        down[r][c].green     = (block[0][0].green*9 + block[1][0].green*3 + block[0][1].green*3 + block[1][1].green)/(16*256);
-                        down[r][c].blue      = (block[0][0].blue*9  + block[1][0].blue*3  + block[0][1].blue*3  + block[1][1].blue)/(16*256);
-
-                        down[r][c+1].red     = (block[0][2].red*9   + block[1][2].red*3   + block[0][1].red*3   + block[1][1].red)/(16*256);
-                        down[r][c+1].green   = (block[0][2].green*9 + block[1][2].green*3 + block[0][1].green*3 + block[1][1].green)/(16*256);
-                        down[r][c+1].blue    = (block[0][2].blue*9  + block[1][2].blue*3  + block[0][1].blue*3  + block[1][1].blue)/(16*256);
-
-                        down[r+1][c].red     = (block[2][0].red*9   + block[1][0].red*3   + block[2][1].red*3   + block[1][1].red)/(16*256);
-                        down[r+1][c].green   = (block[2][0].green*9 + block[1][0].green*3 + block[2][1].green*3 + block[1][1].green)/(16*256);
-                        down[r+1][c].blue    = (block[2][0].blue*9  + block[1][0].blue*3  + block[2][1].blue*3  + block[1][1].blue)/(16*256);
-
-                        down[r+1][c+1].red   = (block[2][2].red*9   + block[1][2].red*3   + block[2][1].red*3   + block[1][1].red)/(16*256);
-                        down[r+1][c+1].green = (block[2][2].green*9 + block[1][2].green*3 + block[2][1].green*3 + block[1][1].green)/(16*256);
-                        down[r+1][c+1].blue  = (block[2][2].blue*9  + block[1][2].blue*3  + block[2][1].blue*3  + block[1][1].blue)/(16*256);
-
-                        cc += size_in;
-                    }
-                    if (part_nc - full_nc == 1)
-                    {
-                        rgbptype block[size_in][2];
-                        separable_3x3_filter_block_rgb(block, original_, rr, cc, 2, 12, 2);
-
-                        // bi-linearly interpolate partial block 
-                        down[r][c].red       = (block[0][0].red*9   + block[1][0].red*3   + block[0][1].red*3   + block[1][1].red)/(16*256);
-                        down[r][c].green     = (block[0][0].green*9 + block[1][0].green*3 + block[0][1].green*3 + block[1][1].green)/(16*256);
-                        down[r][c].blue      = (block[0][0].blue*9  + block[1][0].blue*3  + block[0][1].blue*3  + block[1][1].blue)/(16*256);
-
-                        down[r+1][c].red     = (block[2][0].red*9   + block[1][0].red*3   + block[2][1].red*3   + block[1][1].red)/(16*256);
-                        down[r+1][c].green   = (block[2][0].green*9 + block[1][0].green*3 + block[2][1].green*3 + block[1][1].green)/(16*256);
-                        down[r+1][c].blue    = (block[2][0].blue*9  + block[1][0].blue*3  + block[2][1].blue*3  + block[1][1].blue)/(16*256);
+                        const long r = i*size_out;
+                        const long rr = 1 + i*size_in;
+                        long cc = 1;
+                        long c;
+                        for (c = 0; c < full_nc; c+=size_out)
+                        {
+                            rgbptype block[size_in][size_in];
+                            separable_3x3_filter_block_rgb(block, original_, rr, cc, 2, 12, 2);
+
+                            // bi-linearly interpolate block 
+                            down[r][c].red       = (block[0][0].red*9   + block[1][0].red*3   + block[0][1].red*3   + block[1][1].red)/(16*256);
+                            down[r][c].green     = (block[0][0].green*9 + block[1][0].green*3 + block[0][1].green*3 + block[1][1].green)/(16*256);
+                            down[r][c].blue      = (block[0][0].blue*9  + block[1][0].blue*3  + block[0][1].blue*3  + block[1][1].blue)/(16*256);
+
+                            down[r][c+1].red     = (block[0][2].red*9   + block[1][2].red*3   + block[0][1].red*3   + block[1][1].red)/(16*256);
+                            down[r][c+1].green   = (block[0][2].green*9 + block[1][2].green*3 + block[0][1].green*3 + block[1][1].green)/(16*256);
+                            down[r][c+1].blue    = (block[0][2].blue*9  + block[1][2].blue*3  + block[0][1].blue*3  + block[1][1].blue)/(16*256);
+
+                            down[r+1][c].red     = (block[2][0].red*9   + block[1][0].red*3   + block[2][1].red*3   + block[1][1].red)/(16*256);
+                            down[r+1][c].green   = (block[2][0].green*9 + block[1][0].green*3 + block[2][1].green*3 + block[1][1].green)/(16*256);
+                            down[r+1][c].blue    = (block[2][0].blue*9  + block[1][0].blue*3  + block[2][1].blue*3  + block[1][1].blue)/(16*256);
+
+                            down[r+1][c+1].red   = (block[2][2].red*9   + block[1][2].red*3   + block[2][1].red*3   + block[1][1].red)/(16*256);
+                            down[r+1][c+1].green = (block[2][2].green*9 + block[1][2].green*3 + block[2][1].green*3 + block[1][1].green)/(16*256);
+                            down[r+1][c+1].blue  = (block[2][2].blue*9  + block[1][2].blue*3  + block[2][1].blue*3  + block[1][1].blue)/(16*256);
+
+                            cc += size_in;
+                        }
+                        if (part_nc - full_nc == 1)
+                        {
+                            rgbptype block[size_in][2];
+                            separable_3x3_filter_block_rgb(block, original_, rr, cc, 2, 12, 2);
+
+                            // bi-linearly interpolate partial block 
+                            down[r][c].red       = (block[0][0].red*9   + block[1][0].red*3   + block[0][1].red*3   + block[1][1].red)/(16*256);
+                            down[r][c].green     = (block[0][0].green*9 + block[1][0].green*3 + block[0][1].green*3 + block[1][1].green)/(16*256);
+                            down[r][c].blue      = (block[0][0].blue*9  + block[1][0].blue*3  + block[0][1].blue*3  + block[1][1].blue)/(16*256);
+
+                            down[r+1][c].red     = (block[2][0].red*9   + block[1][0].red*3   + block[2][1].red*3   + block[1][1].red)/(16*256);
+                            down[r+1][c].green   = (block[2][0].green*9 + block[1][0].green*3 + block[2][1].green*3 + block[1][1].green)/(16*256);
+                            down[r+1][c].blue    = (block[2][0].blue*9  + block[1][0].blue*3  + block[2][1].blue*3  + block[1][1].blue)/(16*256);
+                        }
                     }
-                    rr += size_in;
-                }
+                });
+                const long r = full_nr;
+                const long rr = 1 + (full_nr/size_out)*size_in;
                 if (part_nr - full_nr == 1)
                 {
                     long cc = 1;
@@ -1153,6 +1182,96 @@ namespace dlib
         }
     }
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename pyramid_type,
+        typename image_type
+        >
+    class tiled_pyramid
+    {
+    public:
+
+        tiled_pyramid (
+        ) = default;
+
+        tiled_pyramid (
+            const unsigned long padding_,
+            const unsigned long outer_padding_ = 0
+        ) : padding(padding_), outer_padding(outer_padding_) {}
+
+        template <
+            typename in_image_type
+            >
+        void build (
+            const in_image_type& img
+        )
+        {
+            DLIB_ASSERT(!is_same_object(img, out_img));
+
+            pyramid_type pyr;
+            const long nr = num_rows(img);
+            const long nc = num_columns(img);
+
+            // The layout of the tiled pyramid only depends on the input size.  So when we
+            // get another image of the same size we keep the packed image and its
+            // rectangles as they are.  The pyramid levels overwrite every pixel inside
+            // the rects and nothing ever writes to the padding, which is still 0.
+            if (nr != last_nr || nc != last_nc || rects.size() == 0)
+            {
+                long out_nr, out_nc;
+                impl::compute_tiled_image_pyramid_details(pyr, nr, nc, padding, outer_padding, rects, out_nr, out_nc);
+
+                set_image_size(out_img, out_nr, out_nc);
+                assign_all_pixels(out_img, 0);
+                last_nr = nr;
+                last_nc = nc;
+            }
+
+            if (rects.size() == 0)
+                return;
+
+            auto si = sub_image(out_img, rects[0]);
+            assign_image(si, img);
+            for (size_t i = 1; i < rects.size(); ++i)
+            {
+                auto s1 = sub_image(out_img, rects[i-1]);
+                auto s2 = sub_image(out_img, rects[i]);
+                pyr(s1,s2);
+            }
+        }
+
+        const image_type& get_image (
+        ) const { return out_img; }
+
+        const std::vector<rectangle>& get_rects (
+        ) const { return rects; }
+
+        unsigned long get_padding (
+        ) const { return padding; }
+
+        unsigned long get_outer_padding (
+        ) const { return outer_padding; }
+
+        void clear (
+        )
+        {
+            set_image_size(out_img, 0, 0);
+            rects.clear();
+            last_nr = -1;
+            last_nc = -1;
+        }
+
+    private:
+
+        image_type out_img;
+        std::vector<rectangle> rects;
+        unsigned long padding = 10;
+        unsigned long outer_padding = 0;
+        long last_nr = -1;
+        long last_nc = -1;
+    };
+
 // ----------------------------------------------------------------------------------------
 
     template <
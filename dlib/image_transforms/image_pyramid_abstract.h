@@ -63,6 +63,9 @@ namespace dlib
                   in the #down image.  
                 - Note that some points on the border of the original image might correspond to 
                   points outside the #down image.  
+                - For N == 2 and N == 3, large images are split into bands of rows which are
+                  downsampled in parallel using the default_thread_pool().  The output is
+                  identical to the serial computation.
         !*/
 
         template <
@@ -269,6 +272,121 @@ namespace dlib
               smaller and smaller pyramid layers inside out_img.
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename pyramid_type,
+        typename image_type
+        >
+    class tiled_pyramid
+    {
+        /*!
+            REQUIREMENTS ON pyramid_type
+                pyramid_type == one of the dlib::pyramid_down template instances defined above.
+
+            REQUIREMENTS ON image_type
+                image_type == an image object that implements the interface defined in
+                dlib/image_processing/generic_image.h and its pixel type must not have an
+                alpha channel.
+
+            WHAT THIS OBJECT REPRESENTS
+                This object is a reusable version of create_tiled_pyramid().  It owns the
+                packed pyramid image and the rectangles describing where each pyramid level
+                lives inside it.  This is useful when you build pyramids for a stream of
+                images that all have the same size, e.g. the frames of a video.  In that
+                case the packed image is allocated and its padding cleared only once and
+                every later call to build() just writes the new pyramid levels into the
+                existing memory.
+        !*/
+
+    public:
+
+        tiled_pyramid (
+        );
+        /*!
+            ensures
+                - #get_image() is an empty image.
+                - #get_rects().size() == 0
+                - #get_padding() == 10
+                - #get_outer_padding() == 0
+        !*/
+
+        tiled_pyramid (
+            const unsigned long padding,
+            const unsigned long outer_padding = 0
+        );
+        /*!
+            ensures
+                - #get_image() is an empty image.
+                - #get_rects().size() == 0
+                - #get_padding() == padding
+                - #get_outer_padding() == outer_padding
+        !*/
+
+        template <
+            typename in_image_type
+            >
+        void build (
+            const in_image_type& img
+        );
+        /*!
+            requires
+                - in_image_type == an image object that implements the interface defined in
+                  dlib/image_processing/generic_image.h 
+                - pixel_traits<typename image_traits<in_image_type>::pixel_type>::has_alpha == false
+                - is_same_object(img, get_image()) == false
+            ensures
+                - Performs: create_tiled_pyramid<pyramid_type>(img, #get_image(), #get_rects(), get_padding(), get_outer_padding())
+                  That is, #get_image() and #get_rects() are exactly what create_tiled_pyramid()
+                  would output.
+                - If img has the same dimensions as the image given to the previous call to
+                  build() then no memory is allocated.  The previous pyramid image is
+                  overwritten in place.
+        !*/
+
+        const image_type& get_image (
+        ) const;
+        /*!
+            ensures
+                - returns the tiled pyramid image made by the last call to build().
+        !*/
+
+        const std::vector<rectangle>& get_rects (
+        ) const;
+        /*!
+            ensures
+                - returns the locations of the pyramid levels inside get_image().  That is,
+                  get_rects()[i] is the location of the i-th pyramid level and
+                  get_rects()[0] is the full resolution image given to build().  You can
+                  give these rects to image_to_tiled_pyramid() and tiled_pyramid_to_image()
+                  to map between the two coordinate systems.
+        !*/
+
+        unsigned long get_padding (
+        ) const;
+        /*!
+            ensures
+                - returns the number of padding pixels between the pyramid levels.
+        !*/
+
+        unsigned long get_outer_padding (
+        ) const;
+        /*!
+            ensures
+                - returns the number of padding pixels around the edge of get_image().
+        !*/
+
+        void clear (
+        );
+        /*!
+            ensures
+                - releases the memory held by this object.
+                - #get_image() is an empty image.
+                - #get_rects().size() == 0
+                - get_padding() and get_outer_padding() are unchanged.
+        !*/
+    };
+
 // ----------------------------------------------------------------------------------------
 
     template <
@@ -12,6 +12,7 @@
 #include "../matrix.h"
 #include "../pixel.h"
 #include "../noncopyable.h"
+#include "spatial_filtering.h"
 
 namespace dlib
 {
@@ -35,30 +36,44 @@ namespace dlib
         )
         {
             const_image_view<image_type> img(img_);
-            T pixel;
             int_img.set_size(img.nr(), img.nc());
-
-            // compute the first row of the integral image
-            T temp = 0;
-            for (long c = 0; c < img.nc(); ++c)
+            const long nr = img.nr();
+            const long nc = img.nc();
+            if (nr == 0 || nc == 0)
+                return;
+
+            // The integral image is computed in two passes.  First each row is replaced
+            // with its running sum.  The rows don't depend on each other so this is done
+            // in parallel bands of rows.
+            impl::parallel_image_blocks(nr, nr*nc, [&](long begin, long end)
             {
-                assign_pixel(pixel, img[0][c]);
-                temp += pixel;
-                int_img[0][c] = temp;
-            }
+                T pixel;
+                for (long r = begin; r < end; ++r)
+                {
+                    T temp = 0;
+                    T* out = &int_img[r][0];
+                    for (long c = 0; c < nc; ++c)
+                    {
+                        assign_pixel(pixel, img[r][c]);
+                        temp += pixel;
+                        out[c] = temp;
+                    }
+                }
+            });
 
-            // now compute the rest of the integral image
-            for (long r = 1; r < img.nr(); ++r)
+            // Then we add each row into the one below it.  This has to go down the rows
+            // in order, but the columns are independent, so we split them into bands
+            // instead and the inner loop is a simple vectorizable add.
+            impl::parallel_image_blocks(nc, nr*nc, [&](long begin, long end)
             {
-                temp = 0;
-                for (long c = 0; c < img.nc(); ++c)
+                for (long r = 1; r < nr; ++r)
                 {
-                    assign_pixel(pixel, img[r][c]);
-                    temp += pixel;
-                    int_img[r][c] = temp + int_img[r-1][c];
+                    const T* above = &int_img[r-1][0];
+                    T* out = &int_img[r][0];
+                    for (long c = begin; c < end; ++c)
+                        out[c] += above[c];
                 }
-            }
-
+            });
         }
 
         value_type get_sum_of_area (
@@ -117,6 +132,7 @@ namespace dlib
 // ----------------------------------------------------------------------------------------
 
     typedef integral_image_generic<long> integral_image;
+    typedef integral_image_generic<int64> integral_image64;
 
 // ----------------------------------------------------------------------------------------
 
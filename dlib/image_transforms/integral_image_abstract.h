@@ -69,6 +69,8 @@ namespace dlib
                 - #nc() == img.nc()
                 - #*this will now contain an "integral image" representation of the
                   given input image.  
+                - Large images are processed in parallel using the default_thread_pool().
+                  The result is identical to the serial computation.
         !*/
 
         value_type get_sum_of_area (
@@ -110,6 +112,12 @@ namespace dlib
 // ----------------------------------------------------------------------------------------
 
     typedef integral_image_generic<long> integral_image;
+    typedef integral_image_generic<int64> integral_image64;
+    /*!
+        integral_image64 always holds its sums in 64 bit integers.  Use it instead of
+        integral_image for large images on platforms where long is only 32 bits, where
+        the sums of a large 8 bit image can overflow a long.
+    !*/
 
 // ----------------------------------------------------------------------------------------
 
@@ -13,10 +13,38 @@
 #include "../simd.h"
 #include <limits>
 #include "assign_image.h"
+#include "../threads/parallel_for_extension.h"
 
 namespace dlib
 {
 
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        template <typename funct>
+        void parallel_image_blocks (
+            const long n,
+            const long work,
+            funct&& f
+        )
+        /*!
+            ensures
+                - Calls f(begin,end) over a set of disjoint ranges that together cover
+                  [0,n).  This is used by the image filters below to split an image into
+                  bands of rows (or columns) that don't depend on each other.  When the
+                  image is big enough to be worth it (work is the number of pixels touched)
+                  the bands are processed by the default_thread_pool().  Otherwise
+                  f(0,n) is called directly.
+        !*/
+        {
+            if (work >= (1<<16) && n > 1 && default_thread_pool().num_threads_in_pool() > 1)
+                parallel_for_blocked(default_thread_pool(), 0, n, f, 1);
+            else
+                f(0, n);
+        }
+    }
+
 // ----------------------------------------------------------------------------------------
 
     namespace impl
@@ -1262,10 +1290,11 @@ namespace dlib
     {
     template <
         bool add_to,
+        typename ptype,
         typename image_type1, 
         typename image_type2
         >
-    void sum_filter (
+    void sum_filter_impl (
         const image_type1& img_,
         image_type2& out_,
         const rectangle& rect
@@ -1273,90 +1302,126 @@ namespace dlib
     {
         const_image_view<image_type1> img(img_);
         image_view<image_type2> out(out_);
-        DLIB_ASSERT(img.nr() == out.nr() &&
-                    img.nc() == out.nc() &&
-                    is_same_object(img_,out_) == false,
-            "\t void sum_filter()"
-            << "\n\t Invalid arguments given to this function."
-            << "\n\t img.nr(): " << img.nr() 
-            << "\n\t img.nc(): " << img.nc() 
-            << "\n\t out.nr(): " << out.nr() 
-            << "\n\t out.nc(): " << out.nc() 
-            << "\n\t is_same_object(img_,out_): " << is_same_object(img_,out_) 
-        );
-
-        typedef typename image_traits<image_type1>::pixel_type pixel_type;
-        typedef typename promote<pixel_type>::type ptype;
-
-        std::vector<ptype> column_sum;
-        column_sum.resize(img.nc() + rect.width(),0);
-
-        const long top    = -1 + rect.top();
-        const long bottom = -1 + rect.bottom();
-        long left = rect.left()-1;
-
-        // initialize column_sum at row -1
-        for (unsigned long j = 0; j < column_sum.size(); ++j)
-        {
-            rectangle strip(left,top,left,bottom);
-            strip = strip.intersect(get_rect(img));
-            if (!strip.is_empty())
-            {
-                column_sum[j] = sum(matrix_cast<ptype>(subm(mat(img),strip)));
-            }
-
-            ++left;
-        }
 
+        typedef typename image_traits<image_type2>::pixel_type out_pixel_type;
 
         const rectangle area = get_rect(img);
 
         // Save width to avoid computing it over and over.
         const long width = rect.width();
 
+        // column_sum[j] always holds the sum of the pixels in column rect.left()-1+j that
+        // are in the rows covered by rect at the current row.  Only the columns in
+        // [first_col, last_col) are inside the image, the rest are always 0.
+        const long first_col = std::max(0L, 1-rect.left());
+        const long last_col = std::min((long)img.nc()+width, img.nc()-rect.left()+1);
+        const long offset = rect.left()-1;
 
-        // Now do the bulk of the filtering work.
-        for (long r = 0; r < img.nr(); ++r)
+        // Every band of rows gets its own column sums, so the bands can be filtered
+        // independently of each other.
+        parallel_image_blocks(img.nr(), img.nr()*img.nc(), [&](long begin, long end)
         {
-            // set to sum at point(-1,r). i.e. should be equal to sum(mat(img), translate_rect(rect, point(-1,r)))
-            // We compute it's value in the next loop.
-            ptype cur_sum = 0; 
-
-            // Update the first part of column_sum since we only work on the c+width part of column_sum
-            // in the main loop.
-            const long top    = r + rect.top() - 1;
-            const long bottom = r + rect.bottom();
-            for (long k = 0; k < width; ++k)
+            std::vector<ptype> column_sum;
+            column_sum.resize(img.nc() + width,0);
+
+            const long top    = begin - 1 + rect.top();
+            const long bottom = begin - 1 + rect.bottom();
+            long left = rect.left()-1;
+
+            // initialize column_sum at row begin-1
+            for (unsigned long j = 0; j < column_sum.size(); ++j)
             {
-                const long right  = k-width + rect.right();
+                rectangle strip(left,top,left,bottom);
+                strip = strip.intersect(area);
+                if (!strip.is_empty())
+                {
+                    column_sum[j] = sum(matrix_cast<ptype>(subm(mat(img),strip)));
+                }
 
-                const ptype br_corner = area.contains(right,bottom) ? img[bottom][right] : 0;
-                const ptype tr_corner = area.contains(right,top)    ? img[top][right]    : 0;
-                // update the sum in this column now that we are on the next row
-                column_sum[k] = column_sum[k] + br_corner - tr_corner;
-                cur_sum += column_sum[k];
+                ++left;
             }
 
-            for (long c = 0; c < img.nc(); ++c)
+            ptype* const cs = column_sum.data();
+            for (long r = begin; r < end; ++r)
             {
+                // Move all the column sums down to row r.  That is, add in the pixels
+                // of the new bottom row and subtract the pixels of the old top row.
                 const long top    = r + rect.top() - 1;
                 const long bottom = r + rect.bottom();
-                const long right  = c + rect.right();
-
-                const ptype br_corner = area.contains(right,bottom) ? img[bottom][right] : 0;
-                const ptype tr_corner = area.contains(right,top)    ? img[top][right]    : 0;
+                if (0 <= bottom && bottom < img.nr() && first_col < last_col)
+                {
+                    const auto* const row = &img[bottom][0];
+                    for (long j = first_col; j < last_col; ++j)
+                        cs[j] += row[j+offset];
+                }
+                if (0 <= top && top < img.nr() && first_col < last_col)
+                {
+                    const auto* const row = &img[top][0];
+                    for (long j = first_col; j < last_col; ++j)
+                        cs[j] -= row[j+offset];
+                }
 
-                // update the sum in this column now that we are on the next row
-                column_sum[c+width] = column_sum[c+width] + br_corner - tr_corner;
+                // set to sum at point(-1,r). i.e. should be equal to sum(mat(img), translate_rect(rect, point(-1,r)))
+                ptype cur_sum = 0; 
+                for (long k = 0; k < width; ++k)
+                    cur_sum += cs[k];
 
-                // add in the new right side of the rect and subtract the old right side.
-                cur_sum = cur_sum + column_sum[c+width] - column_sum[c];
+                out_pixel_type* const out_row = &out[r][0];
+                for (long c = 0; c < img.nc(); ++c)
+                {
+                    // add in the new right side of the rect and subtract the old right side.
+                    cur_sum = cur_sum + cs[c+width] - cs[c];
 
-                if (add_to)
-                    out[r][c] += static_cast<typename image_traits<image_type2>::pixel_type>(cur_sum);
-                else
-                    out[r][c] = static_cast<typename image_traits<image_type2>::pixel_type>(cur_sum);
+                    if (add_to)
+                        out_row[c] += static_cast<out_pixel_type>(cur_sum);
+                    else
+                        out_row[c] = static_cast<out_pixel_type>(cur_sum);
+                }
             }
+        });
+    }
+
+    template <
+        bool add_to,
+        typename image_type1, 
+        typename image_type2
+        >
+    void sum_filter (
+        const image_type1& img,
+        image_type2& out,
+        const rectangle& rect
+    )
+    {
+        DLIB_ASSERT(num_rows(img) == num_rows(out) &&
+                    num_columns(img) == num_columns(out) &&
+                    is_same_object(img,out) == false,
+            "\t void sum_filter()"
+            << "\n\t Invalid arguments given to this function."
+            << "\n\t num_rows(img):    " << num_rows(img) 
+            << "\n\t num_columns(img): " << num_columns(img) 
+            << "\n\t num_rows(out):    " << num_rows(out) 
+            << "\n\t num_columns(out): " << num_columns(out) 
+            << "\n\t is_same_object(img,out): " << is_same_object(img,out) 
+        );
+
+        if (num_rows(img) == 0 || num_columns(img) == 0)
+            return;
+
+        typedef typename image_traits<image_type1>::pixel_type pixel_type;
+        typedef typename promote<pixel_type>::type ptype;
+
+        // promote gives 32 bit sums for 8 and 16 bit pixels.  Those overflow once the
+        // filter covers enough pixels, so big filters get 64 bit sums instead.
+        const double max_abs_pixel = std::max(std::abs((double)std::numeric_limits<pixel_type>::lowest()),
+                                              (double)std::numeric_limits<pixel_type>::max());
+        if (std::numeric_limits<ptype>::is_integer && sizeof(ptype) < sizeof(int64) &&
+            (double)rect.area()*max_abs_pixel > (double)std::numeric_limits<ptype>::max())
+        {
+            sum_filter_impl<add_to,int64>(img,out,rect);
+        }
+        else
+        {
+            sum_filter_impl<add_to,ptype>(img,out,rect);
         }
     }
     }
@@ -1393,79 +1458,57 @@ namespace dlib
     namespace impl
     {
         template <typename T>
-        class fast_deque
+        void running_max (
+            T* vals,
+            T* g,
+            T* h,
+            const long len,
+            const long width,
+            const long bw
+        )
+        /*!
+            requires
+                - vals, g, and h point to len vectors of bw values each.  I.e. vals[i*bw+k]
+                  is the k-th element of the i-th vector.
+                - width > 0
+            ensures
+                - This is the van Herk/Gil-Werman running max.  Split the vectors into
+                  blocks of width consecutive vectors.  Then this function sets g[i] to the
+                  max of vals over the part of i's block that comes before i (including i)
+                  and h[i] to the max over the part of the block that comes after i
+                  (including i).  All done elementwise.  Therefore, the max of vals over
+                  the window [i, i+width) is max(h[i], g[i+width-1]).  This costs 3
+                  comparisons per value no matter how big the window is and all the loops
+                  are over bw contiguous values, which the compiler can vectorize.
+        !*/
         {
-        /*
-            This is a fast and minimal implementation of std::deque for 
-            use with the max_filter.  
-
-            This object assumes that no more than max_size elements
-            will ever be pushed into it at a time.
-        */
-        public:
-
-            explicit fast_deque(unsigned long max_size)
+            for (long start = 0; start < len; start += width)
             {
-                // find a power of two that upper bounds max_size
-                mask = 2;
-                while (mask < max_size)
-                    mask *= 2;
-
-                clear();
-
-                data.resize(mask);
-                --mask;  // make into bit mask
-            }
-
-            void clear()
-            {
-                first = 1;
-                last = 0;
-                size = 0;
-            }
+                const long stop = std::min(start+width, len);
 
-            bool empty() const
-            {
-                return size == 0;
-            }
-
-            void pop_back()
-            {
-                last = (last-1)&mask;
-                --size;
-            }
-
-            void push_back(const T& item)
-            {
-                last = (last+1)&mask;
-                ++size;
-                data[last] = item;
-            }
-
-            void pop_front()
-            {
-                first = (first+1)&mask;
-                --size;
-            }
-
-            const T& front() const
-            {
-                return data[first];
-            }
+                for (long k = 0; k < bw; ++k)
+                    g[start*bw+k] = vals[start*bw+k];
+                for (long i = start+1; i < stop; ++i)
+                {
+                    const T* const prev = g + (i-1)*bw;
+                    const T* const v = vals + i*bw;
+                    T* const cur = g + i*bw;
+                    for (long k = 0; k < bw; ++k)
+                        cur[k] = std::max(prev[k], v[k]);
+                }
 
-            const T& back() const
-            {
-                return data[last];
+                for (long k = 0; k < bw; ++k)
+                    h[(stop-1)*bw+k] = vals[(stop-1)*bw+k];
+                for (long i = stop-2; i >= start; --i)
+                {
+                    const T* const next = h + (i+1)*bw;
+                    const T* const v = vals + i*bw;
+                    T* const cur = h + i*bw;
+                    for (long k = 0; k < bw; ++k)
+                        cur[k] = std::max(next[k], v[k]);
+                }
             }
-
-        private:
-
-            std::vector<T> data;
-            unsigned long mask;
-            unsigned long first;
-            unsigned long last;
-            unsigned long size;
-        };
+        }
     }
 
 // ----------------------------------------------------------------------------------------
@@ -1501,74 +1544,65 @@ namespace dlib
                      );
 
         typedef typename image_traits<image_type1>::pixel_type pixel_type;
+        typedef typename image_traits<image_type2>::pixel_type out_pixel_type;
 
+        const long nr = img.nr();
+        const long nc = img.nc();
+        if (nr == 0 || nc == 0)
+            return;
 
-        dlib::impl::fast_deque<std::pair<long,pixel_type> > Q(std::max(width,height));
-
-        const long last_col = std::max(img.nc(), ((width-1)/2));
-        const long last_row = std::max(img.nr(), ((height-1)/2));
+        // Pixels outside the image are treated as having the lowest possible value.  So
+        // we pad each row (or column) with width/2 of them in front and (width-1)/2 of
+        // them at the end.  Then the window centered at pixel p starts at index p of the
+        // padded row.
+        const pixel_type lowest = std::numeric_limits<pixel_type>::lowest();
 
         // run max filter along rows of img
-        for (long r = 0; r < img.nr(); ++r)
+        impl::parallel_image_blocks(nr, nr*nc, [&](long begin, long end)
         {
-            Q.clear();
-            for (long c = 0; c < (width-1)/2 && c < img.nc(); ++c)
-            {
-                while (!Q.empty() && img[r][c] >= Q.back().second)
-                    Q.pop_back();
-                Q.push_back(std::make_pair(c,img[r][c]));
-            }
-
-            for (long c = (width-1)/2; c < img.nc(); ++c)
-            {
-                while (!Q.empty() && img[r][c] >= Q.back().second)
-                    Q.pop_back();
-                while (!Q.empty() && Q.front().first <= c-width)
-                    Q.pop_front();
-                Q.push_back(std::make_pair(c,img[r][c]));
-
-                img[r][c-((width-1)/2)] = Q.front().second;
-            }
-
-            for (long c = last_col; c < img.nc() + ((width-1)/2); ++c)
+            const long len = nc + width - 1;
+            std::vector<pixel_type> vals(len, lowest), g(len), h(len);
+            for (long r = begin; r < end; ++r)
             {
-                while (!Q.empty() && Q.front().first <= c-width)
-                    Q.pop_front();
-
-                img[r][c-((width-1)/2)] = Q.front().second;
+                pixel_type* const row = &img[r][0];
+                std::copy(row, row+nc, vals.begin() + width/2);
+                impl::running_max(vals.data(), g.data(), h.data(), len, width, 1);
+                for (long c = 0; c < nc; ++c)
+                    row[c] = std::max(h[c], g[c+width-1]);
             }
-        }
-
-        // run max filter along columns of img.  Store result in out.
-        for (long cc = 0; cc < img.nc(); ++cc)
+        });
+
+        // run max filter along columns of img.  Store result in out.  We do this on
+        // blocks of columns at a time so the running max works on contiguous rows of
+        // pixels.
+        const long block_size = 64;
+        const long num_blocks = (nc + block_size - 1)/block_size;
+        impl::parallel_image_blocks(num_blocks, nr*nc, [&](long begin, long end)
         {
-            Q.clear();
-            for (long rr = 0; rr < (height-1)/2 && rr < img.nr(); ++rr)
-            {
-                while (!Q.empty() && img[rr][cc] >= Q.back().second)
-                    Q.pop_back();
-                Q.push_back(std::make_pair(rr,img[rr][cc]));
-            }
-
-            for (long rr = (height-1)/2; rr < img.nr(); ++rr)
+            const long len = nr + height - 1;
+            std::vector<pixel_type> vals, g, h;
+            for (long b = begin; b < end; ++b)
             {
-                while (!Q.empty() && img[rr][cc] >= Q.back().second)
-                    Q.pop_back();
-                while (!Q.empty() && Q.front().first <= rr-height)
-                    Q.pop_front();
-                Q.push_back(std::make_pair(rr,img[rr][cc]));
-
-                out[rr-((height-1)/2)][cc] += std::max(Q.front().second, thresh);
-            }
+                const long c0 = b*block_size;
+                const long bw = std::min(block_size, nc-c0);
+                vals.assign(len*bw, lowest);
+                g.resize(len*bw);
+                h.resize(len*bw);
 
-            for (long rr = last_row; rr < img.nr() + ((height-1)/2); ++rr)
-            {
-                while (!Q.empty() && Q.front().first <= rr-height)
-                    Q.pop_front();
+                for (long r = 0; r < nr; ++r)
+                    std::copy(&img[r][c0], &img[r][c0]+bw, vals.begin() + (r+height/2)*bw);
+                impl::running_max(vals.data(), g.data(), h.data(), len, height, bw);
 
-                out[rr-((height-1)/2)][cc] += std::max(Q.front().second, thresh);
+                for (long r = 0; r < nr; ++r)
+                {
+                    const pixel_type* const hr = &h[r*bw];
+                    const pixel_type* const gr = &g[(r+height-1)*bw];
+                    out_pixel_type* const out_row = &out[r][c0];
+                    for (long k = 0; k < bw; ++k)
+                        out_row[k] += std::max(std::max(hr[k], gr[k]), thresh);
+                }
             }
-        }
+        });
     }
 
 // ----------------------------------------------------------------------------------------
@@ -413,6 +413,11 @@ namespace dlib
                 - let SUM(r,c) == sum of pixels from img which are inside the rectangle 
                   translate_rect(rect, point(c,r)).
                 - #out[r][c] == out[r][c] + SUM(r,c)
+            - The sums are accumulated in a type big enough to hold them.  In particular,
+              8 and 16 bit pixels are summed with 64 bit integers when rect is large
+              enough to overflow 32 bits.
+            - Large images are split into bands of rows which are filtered in parallel
+              using the default_thread_pool().
     !*/
 
 // ----------------------------------------------------------------------------------------
@@ -440,6 +445,8 @@ namespace dlib
                 - let SUM(r,c) == sum of pixels from img which are inside the rectangle 
                   translate_rect(rect, point(c,r)).
                 - #out[r][c] == SUM(r,c)
+            - Like sum_filter(), large images and large rects are handled in parallel and
+              with 64 bit sums respectively.
     !*/
 
 // ----------------------------------------------------------------------------------------
@@ -477,6 +484,8 @@ namespace dlib
             - Uses img as scratch space.  Therefore, the pixel values in img will have
               been modified by this function.  That is, max_filter() destroys the contents
               of img. 
+            - The run time does not depend on width or height.  Large images are
+              processed in parallel using the default_thread_pool().
     !*/
 
 // ----------------------------------------------------------------------------------------
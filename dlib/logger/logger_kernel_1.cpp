@@ -4,8 +4,14 @@
 #define DLIB_LOGGER_KERNEL_1_CPp_
 
 #include "logger_kernel_1.h"
+#include "../pipe/lock_free_pipe.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <iostream>
+#include <mutex>
 #include <sstream>
+#include <thread>
 
 namespace dlib
 {
@@ -87,6 +93,33 @@ namespace dlib
 
 // ----------------------------------------------------------------------------------------
 
+    namespace logger_helper_stuff
+    {
+        uint64 microseconds_since_start (
+        )
+        {
+            static const std::chrono::steady_clock::time_point first_time = std::chrono::steady_clock::now();
+            return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - first_time).count();
+        }
+
+        void print_default_logger_header (
+            std::ostream& out,
+            const std::string& logger_name,
+            const log_level& l,
+            const uint64 thread_id,
+            const uint64 cur_time
+        )
+        {
+            using namespace std;
+            streamsize old_width = out.width(); out.width(5);
+            out << cur_time << " " << l.name; 
+            out.width(old_width);
+
+            out << " [" << thread_id << "] " << logger_name << ": ";
+        }
+    }
+
     void print_default_logger_header (
         std::ostream& out,
         const std::string& logger_name,
@@ -94,16 +127,583 @@ namespace dlib
         const uint64 thread_id
     )
     {
-        using namespace std;
-        static timestamper ts;
-        static const uint64 first_time = ts.get_timestamp();
+        logger_helper_stuff::print_default_logger_header(out, logger_name, l, thread_id,
+            logger_helper_stuff::microseconds_since_start()/1000);
+    }
+
+// ----------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------
+//                 async logging stuff
+// ----------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------
+
+    namespace logger_helper_stuff
+    {
+        struct async_log_record
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    This is one log message waiting to be written by the async log
+                    writer.  It holds the formatted message text along with everything
+                    needed to print its header and send it to the right place.  Records
+                    are swapped in and out of the per thread queues, so the memory in
+                    logger_name and text gets reused by later messages rather than
+                    being allocated for each one.
+            !*/
+
+            async_log_record() : timestamp(0), thread_name(0), l(LNONE), print_header(0), out(0), auto_flush(false), use_hook(false) {}
+
+            uint64 timestamp;
+            uint64 thread_name;
+            log_level l;
+            std::string logger_name;
+            print_header_type print_header;
+            std::streambuf* out;
+            bool auto_flush;
+            // Only allocated once a message with a hook goes through this record.  That
+            // keeps swapping records cheap since a member_function_pointer is slow to
+            // copy.
+            bool use_hook;
+            std::unique_ptr<logger::hook_mfp> hook;
+            std::vector<char> text;
+
+            void swap (
+                async_log_record& item
+            )
+            {
+                std::swap(timestamp, item.timestamp);
+                std::swap(thread_name, item.thread_name);
+                std::swap(l, item.l);
+                logger_name.swap(item.logger_name);
+                std::swap(print_header, item.print_header);
+                std::swap(out, item.out);
+                std::swap(auto_flush, item.auto_flush);
+                std::swap(use_hook, item.use_hook);
+                hook.swap(item.hook);
+                text.swap(item.text);
+            }
+        };
+
+        inline void swap (
+            async_log_record& a,
+            async_log_record& b
+        ) { a.swap(b); }
+
+        class vector_streambuf : public std::streambuf
+        {
+            /*!
+                A streambuf that appends everything written to it to *buffer.
+            !*/
+        public:
+            std::vector<char>* buffer;
+
+            int_type overflow ( int_type c)
+            {
+                if (c != EOF) buffer->push_back(static_cast<char>(c));
+                return c;
+            }
+
+            std::streamsize xsputn ( const char* s, std::streamsize num)
+            {
+                buffer->insert(buffer->end(), s, s+num);
+                return num;
+            }
+        };
+
+        struct async_thread_buffer
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    The part of the async log writer belonging to one thread.  The thread
+                    formats its messages into cur and then enqueues them into records,
+                    all without taking any locks.  The writer's background thread is the
+                    only one that dequeues from records.
+
+                    - busy == true while the thread is in the middle of a logging
+                      statement that uses this buffer.
+                    - epoch == the async_writer::epoch value in effect when records was
+                      made.  records is only replaced while holding the writer's mutex.
+                    - thread_ended == true once the thread has terminated.  After that
+                      only the writer touches this object.
+            !*/
+
+            async_thread_buffer (
+            ) : sout(&buf), thread_name(0), epoch(0), busy(false), thread_ended(false), in_message(false)
+            {
+                buf.buffer = &cur.text;
+            }
+
+            std::unique_ptr<lock_free_pipe<async_log_record,PIPE_SPSC> > records;
+            async_log_record cur;
+            vector_streambuf buf;
+            std::ostream sout;
+            uint64 thread_name;
+            uint64 epoch;
+            std::atomic<bool> busy;
+            std::atomic<bool> thread_ended;
+            bool in_message;
+        };
+
+        struct async_thread_buffer_holder
+        {
+            std::shared_ptr<async_thread_buffer> buf;
+
+            ~async_thread_buffer_holder()
+            {
+                if (buf)
+                    buf->thread_ended = true;
+            }
+        };
+
+        thread_local async_thread_buffer_holder this_threads_log_buffer;
+
+        // every time async logging is started it gets a new epoch number
+        std::atomic<uint64> next_async_epoch(1);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    class logger::global_data::async_writer
+    {
+        /*!
+            INITIAL VALUE
+                - running == false
+                - epoch == 0
+                - buffers.size() == 0
+                - num_dropped == 0
+
+            CONVENTION
+                - running == true while the writer accepts new messages.  While it's
+                  true gd.async_enabled is also true, except when stop() is in the
+                  middle of shutting things down.
+                - buffers == the buffers of all the threads that logged something since
+                  start() was called.  Each of them has its epoch == epoch.
+                - flusher == the background thread that takes the records out of the
+                  buffers and writes them.  It wakes up every flush_period milliseconds,
+                  or sooner if wake_requested is set or someone calls flush().
+                - flushes_done == the value flush_requests had when the flusher started
+                  its last completed pass over the buffers.
+                - m guards everything except num_dropped and wake_requested which are
+                  atomics.  control_m serializes start() and stop().
+        !*/
+    public:
+
+        typedef logger_helper_stuff::async_log_record record;
+        typedef logger_helper_stuff::async_thread_buffer thread_buffer;
+
+        explicit async_writer (
+            global_data& gd_
+        ) : 
+            gd(gd_),
+            running(false),
+            should_stop(false),
+            epoch(0),
+            max_pending(0),
+            policy(ASYNC_LOG_BLOCK),
+            flush_requests(0),
+            flushes_done(0),
+            wake_requested(false),
+            num_dropped(0),
+            out(0)
+        {}
+
+        ~async_writer (
+        )
+        {
+            stop();
+        }
+
+        void start (
+            unsigned long max_pending_,
+            async_log_overflow_policy policy_
+        )
+        {
+            std::lock_guard<std::mutex> control_lock(control_m);
+            stop_impl();
+
+            std::lock_guard<std::mutex> lock(m);
+            max_pending = max_pending_;
+            policy = policy_;
+            epoch = logger_helper_stuff::next_async_epoch++;
+            should_stop = false;
+            running = true;
+            flusher = std::thread([this](){ this->thread(); });
+            gd.async_enabled = true;
+        }
+
+        void stop (
+        )
+        {
+            std::lock_guard<std::mutex> control_lock(control_m);
+            stop_impl();
+        }
+
+        void flush (
+        )
+        {
+            std::unique_lock<std::mutex> lock(m);
+            if (!running)
+                return;
+            const uint64 request = ++flush_requests;
+            wake_cv.notify_one();
+            while (flushes_done < request)
+                done_cv.wait(lock);
+        }
+
+        uint64 dropped (
+        ) const { return num_dropped; }
+
+        std::ostream* begin_message (
+            logger& log,
+            const log_level& l
+        )
+        /*!
+            ensures
+                - if (async logging is on and the calling thread isn't already in the
+                  middle of an async log message) then
+                    - starts a new message in the calling thread's buffer and returns
+                      the stream the message text should be written to.
+                - else
+                    - returns 0.  The message should be logged synchronously.
+        !*/
+        {
+            using namespace logger_helper_stuff;
+            std::shared_ptr<thread_buffer>& buf = this_threads_log_buffer.buf;
+            if (!buf)
+                buf = std::make_shared<thread_buffer>();
+            thread_buffer& b = *buf;
+
+            // If something logs from within a logging statement, e.g. in an operator<<,
+            // we let it go through the normal locked path.
+            if (b.in_message)
+                return 0;
+
+            // stop() sets gd.async_enabled to false and then waits for busy to be false
+            // in all the buffers.  So once we see async_enabled after setting busy we
+            // know stop() will wait for us.
+            b.busy = true;
+            if (!gd.async_enabled || (b.epoch != epoch && !add_buffer(buf)))
+            {
+                b.busy = false;
+                return 0;
+            }
+
+            b.in_message = true;
+            record& r = b.cur;
+            r.timestamp = microseconds_since_start();
+            r.thread_name = b.thread_name;
+            r.l = l;
+            r.logger_name = log.logger_name;
+            r.print_header = log.print_header;
+            r.out = log.out.rdbuf();
+            r.auto_flush = log.auto_flush_enabled;
+            r.use_hook = log.hook.is_set();
+            if (r.use_hook)
+            {
+                if (!r.hook)
+                    r.hook.reset(new logger::hook_mfp);
+                *r.hook = log.hook;
+            }
+            r.text.clear();
+
+            // Don't let formatting flags from the last message leak into this one.
+            b.sout.flags(std::ios_base::dec | std::ios_base::skipws);
+            b.sout.precision(6);
+            b.sout.width(0);
+            b.sout.fill(' ');
+            return &b.sout;
+        }
+
+        void end_message (
+        )
+        /*!
+            requires
+                - the calling thread started a message with begin_message()
+            ensures
+                - hands the message to the flusher thread.
+        !*/
+        {
+            thread_buffer& b = *logger_helper_stuff::this_threads_log_buffer.buf;
+
+            if (!b.records->enqueue_or_timeout(b.cur, 0))
+            {
+                // The queue is full.  So either wait for the flusher to make room or
+                // throw the message away.
+                if (policy == ASYNC_LOG_DROP)
+                {
+                    ++num_dropped;
+                }
+                else
+                {
+                    wake();
+                    b.records->enqueue(b.cur);
+                }
+            }
+            else if (b.records->size() >= max_pending/2)
+            {
+                wake();
+            }
+
+            b.in_message = false;
+            b.busy.store(false, std::memory_order_release);
+        }
+
+    private:
+
+        void stop_impl (
+        )
+        /*!
+            requires
+                - control_m is locked
+            ensures
+                - writes all the pending messages, stops the flusher thread, and makes
+                  all new messages go through the normal synchronous path.
+        !*/
+        {
+            std::vector<std::shared_ptr<thread_buffer> > bufs;
+            {
+                std::lock_guard<std::mutex> lock(m);
+                if (!running)
+                    return;
+                // no new threads can join after this
+                running = false;
+                gd.async_enabled = false;
+                bufs = buffers;
+            }
+
+            // Wait for any threads that are still in the middle of logging a message.
+            // The flusher is still running so threads that are blocked on a full queue
+            // will get to finish.
+            for (auto& b : bufs)
+            {
+                while (b->busy)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m);
+                should_stop = true;
+                wake_cv.notify_one();
+            }
+            flusher.join();
+
+            std::lock_guard<std::mutex> lock(m);
+            buffers.clear();
+            flushes_done = flush_requests;
+            done_cv.notify_all();
+        }
+
+        bool add_buffer (
+            const std::shared_ptr<thread_buffer>& buf
+        )
+        /*!
+            ensures
+                - if (the writer is running) then
+                    - gives buf a new queue and adds it to buffers.
+                    - returns true
+                - else
+                    - returns false
+        !*/
+        {
+            uint64 thread_name;
+            {
+                auto_mutex M(gd.m);
+                thread_name = gd.get_thread_name();
+            }
+
+            std::lock_guard<std::mutex> lock(m);
+            if (!running)
+                return false;
+
+            buf->records.reset(new lock_free_pipe<record,PIPE_SPSC>(max_pending));
+            buf->thread_name = thread_name;
+            buf->epoch = epoch;
+            buffers.push_back(buf);
+            return true;
+        }
+
+        void wake (
+        )
+        {
+            if (!wake_requested.exchange(true))
+            {
+                std::lock_guard<std::mutex> lock(m);
+                wake_cv.notify_one();
+            }
+        }
+
+        void thread (
+        )
+        {
+            const auto flush_period = std::chrono::milliseconds(50);
+            while (true)
+            {
+                uint64 request;
+                bool stopping;
+                unsigned long num = 0;
+                {
+                    std::unique_lock<std::mutex> lock(m);
+                    if (!should_stop && !wake_requested && flush_requests == flushes_done)
+                        wake_cv.wait_for(lock, flush_period);
+                    wake_requested = false;
+                    request = flush_requests;
+                    stopping = should_stop;
+
+                    // Take everything out of the thread buffers.  Don't take more than
+                    // max_pending from a single thread so a very chatty thread can't
+                    // keep us from ever writing anything.
+                    for (unsigned long i = 0; i < buffers.size(); ++i)
+                    {
+                        thread_buffer& b = *buffers[i];
+                        for (unsigned long j = 0; j < max_pending; ++j)
+                        {
+                            if (num == batch.size())
+                                batch.resize(num+1);
+                            if (!b.records->dequeue_or_timeout(batch[num], 0))
+                                break;
+                            ++num;
+                        }
+
+                        // Forget about threads that ended once we have all their messages.
+                        if (b.thread_ended && b.records->size() == 0)
+                        {
+                            buffers[i] = buffers.back();
+                            buffers.pop_back();
+                            --i;
+                        }
+                    }
+                }
+
+                write(num);
+
+                {
+                    std::lock_guard<std::mutex> lock(m);
+                    flushes_done = request;
+                    done_cv.notify_all();
+                }
+
+                if (stopping)
+                    break;
+            }
+        }
+
+        void write (
+            unsigned long num
+        )
+        /*!
+            ensures
+                - writes out batch[0] through batch[num-1] in the order they were logged.
+        !*/
+        {
+            if (num == 0)
+                return;
+
+            order.resize(num);
+            for (unsigned long i = 0; i < num; ++i)
+                order[i] = i;
+            std::stable_sort(order.begin(), order.end(), [this](unsigned long a, unsigned long b)
+                             { return batch[a].timestamp < batch[b].timestamp; });
+
+            // Headers and hooks expect to be called one at a time, same as when
+            // they are called by logging statements.
+            auto_mutex M(gd.m);
+            to_flush.clear();
+            for (unsigned long i = 0; i < num; ++i)
+            {
+                record& r = batch[order[i]];
+                if (r.use_hook)
+                {
+                    r.text.push_back('\0');
+                    (*r.hook)(r.logger_name, r.l, r.thread_name, &r.text[0]);
+                    continue;
+                }
+
+                out.rdbuf(r.out);
+                if (r.print_header == print_default_logger_header)
+                    logger_helper_stuff::print_default_logger_header(out, r.logger_name, r.l, r.thread_name, r.timestamp/1000);
+                else
+                    r.print_header(out, r.logger_name, r.l, r.thread_name);
+                out.write(r.text.data(), r.text.size());
+                out << "\n";
+
+                if (r.auto_flush && std::find(to_flush.begin(), to_flush.end(), r.out) == to_flush.end())
+                    to_flush.push_back(r.out);
+            }
+
+            for (auto sb : to_flush)
+                sb->pubsync();
+            out.rdbuf(0);
+        }
+
+        global_data& gd;
+
+        std::mutex control_m;
+        std::mutex m;
+        std::condition_variable wake_cv;
+        std::condition_variable done_cv;
+
+        bool running;
+        bool should_stop;
+        uint64 epoch;
+        unsigned long max_pending;
+        async_log_overflow_policy policy;
+        uint64 flush_requests;
+        uint64 flushes_done;
+        std::atomic<bool> wake_requested;
+        std::atomic<uint64> num_dropped;
+        std::vector<std::shared_ptr<thread_buffer> > buffers;
+        std::thread flusher;
+
+        // only used by the flusher thread
+        std::vector<record> batch;
+        std::vector<unsigned long> order;
+        std::vector<std::streambuf*> to_flush;
+        std::ostream out;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    void enable_async_logging (
+        unsigned long max_pending_messages_per_thread,
+        async_log_overflow_policy policy
+    )
+    {
+        // make sure requires clause is not broken
+        DLIB_ASSERT(max_pending_messages_per_thread > 0,
+            "\t void enable_async_logging()"
+            << "\n\t max_pending_messages_per_thread must be greater than 0"
+            );
 
-        const uint64 cur_time = (ts.get_timestamp() - first_time)/1000;
-        streamsize old_width = out.width(); out.width(5);
-        out << cur_time << " " << l.name; 
-        out.width(old_width);
+        logger::global_data& gd = logger::get_global_data();
+        gd.async->start(max_pending_messages_per_thread, policy);
+    }
 
-        out << " [" << thread_id << "] " << logger_name << ": ";
+    void disable_async_logging (
+    )
+    {
+        logger::global_data& gd = logger::get_global_data();
+        gd.async->stop();
+    }
+
+    bool async_logging_enabled (
+    )
+    {
+        logger::global_data& gd = logger::get_global_data();
+        return gd.async_enabled;
+    }
+
+    void flush_async_logging (
+    )
+    {
+        logger::global_data& gd = logger::get_global_data();
+        gd.async->flush();
+    }
+
+    uint64 num_dropped_async_log_messages (
+    )
+    {
+        logger::global_data& gd = logger::get_global_data();
+        return gd.async->dropped();
     }
 
 // ----------------------------------------------------------------------------------------
@@ -116,6 +716,8 @@ namespace dlib
     ~global_data (
     )
     {
+        // write out any messages still waiting in the async log buffers
+        async.reset();
         unregister_thread_end_handler(*this,&global_data::thread_end_handler);
     }
 
@@ -124,8 +726,11 @@ namespace dlib
     logger::global_data::
     global_data(
     ) : 
-        next_thread_name(1) 
+        next_thread_name(1),
+        async_enabled(false)
     { 
+        async.reset(new async_writer(*this));
+
         // make sure the main program thread always has id 0.  Since there is
         // a global logger object declared in this file we should expect that 
         // the global_data object will be initialized in the main program thread
@@ -396,6 +1001,18 @@ namespace dlib
     {
         if (!been_used)
         {
+            if (log.gd.async_enabled)
+            {
+                sout = log.gd.async->begin_message(log, l);
+                if (sout)
+                {
+                    is_async = true;
+                    been_used = true;
+                    return;
+                }
+            }
+
+            sout = &log.out;
             log.gd.m.lock();
 
             // Check if the output hook is setup.  If it isn't then we print the logger
@@ -421,6 +1038,12 @@ namespace dlib
     print_end_of_line (
     )
     {
+        if (is_async)
+        {
+            log.gd.async->end_message();
+            return;
+        }
+
         auto_unlock M(log.gd.m);
 
         if (log.hook.is_set() == false)
@@ -3,6 +3,7 @@
 #ifndef DLIB_LOGGER_KERNEl_1_
 #define DLIB_LOGGER_KERNEl_1_
 
+#include <atomic>
 #include <limits>
 #include <memory>
 #include <cstring>
@@ -82,6 +83,31 @@ namespace dlib
         const print_header_type& new_header
     );
 
+// ----------------------------------------------------------------------------------------
+
+    enum async_log_overflow_policy
+    {
+        ASYNC_LOG_BLOCK,
+        ASYNC_LOG_DROP
+    };
+
+    void enable_async_logging (
+        unsigned long max_pending_messages_per_thread = 10000,
+        async_log_overflow_policy policy = ASYNC_LOG_BLOCK
+    );
+
+    void disable_async_logging (
+    );
+
+    bool async_logging_enabled (
+    );
+
+    void flush_async_logging (
+    );
+
+    uint64 num_dropped_async_log_messages (
+    );
+
 // ----------------------------------------------------------------------------------------
 
     void print_default_logger_header (
@@ -151,13 +177,20 @@ namespace dlib
             /*!
                 INITIAL VALUE
                     - been_used == false
+                    - is_async == false
 
                 CONVENTION
                     - enabled == is_enabled()
                     - if (been_used) then
-                        - logger::gd::m is locked
                         - someone has used the << operator to write something to the
                           output stream.
+                        - sout == the stream the message is written into
+                        - if (is_async) then
+                            - sout is the calling thread's async logging buffer and
+                              the message will be handed to the async log writer.
+                        - else
+                            - logger::gd::m is locked
+                            - sout == &log.out
             !*/
         public:
             logger_stream (
@@ -166,7 +199,9 @@ namespace dlib
             ) :
                 l(l_),
                 log(log_),
+                sout(0),
                 been_used(false),
+                is_async(false),
                 enabled (l.priority >= log.cur_level.priority)
             {}
 
@@ -198,7 +233,7 @@ namespace dlib
                 else
                 {
                     print_header_and_stuff();
-                    log.out << item;
+                    *sout << item;
                     return *this;
                 }
             }
@@ -210,8 +245,12 @@ namespace dlib
             /*!
                 ensures
                     - if (!been_used) then
-                        - prints the logger header 
-                        - locks log.gd.m
+                        - if (async logging is enabled) then
+                            - starts a new message in the calling thread's async
+                              logging buffer
+                        - else
+                            - prints the logger header 
+                            - locks log.gd.m
                         - #been_used == true
             !*/
 
@@ -219,13 +258,18 @@ namespace dlib
             );
             /*!
                 ensures
-                    - prints a newline to log.out
-                    - unlocks log.gd.m
+                    - if (is_async) then
+                        - hands the message to the async log writer
+                    - else
+                        - prints a newline to log.out
+                        - unlocks log.gd.m
             !*/
 
             const log_level& l;
             logger& log;
+            std::ostream* sout;
             bool been_used;
+            bool is_async;
             const bool enabled;
         }; // end of class logger_stream
 
@@ -418,6 +462,12 @@ namespace dlib
 
             hook_streambuf hookbuf;
 
+            // The background writer used when async logging is enabled.  async_enabled
+            // is true while it is accepting messages.
+            class async_writer;
+            std::unique_ptr<async_writer> async;
+            std::atomic<bool> async_enabled;
+
             global_data (
             );
 
@@ -615,6 +665,23 @@ namespace dlib
             std::ostream& out
         );
 
+        friend void enable_async_logging (
+            unsigned long max_pending_messages_per_thread,
+            async_log_overflow_policy policy
+        );
+
+        friend void disable_async_logging (
+        );
+
+        friend bool async_logging_enabled (
+        );
+
+        friend void flush_async_logging (
+        );
+
+        friend uint64 num_dropped_async_log_messages (
+        );
+
         template <
             typename T
             >
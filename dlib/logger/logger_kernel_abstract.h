@@ -145,6 +145,96 @@ namespace dlib
             - std::bad_alloc
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    enum async_log_overflow_policy
+    {
+        ASYNC_LOG_BLOCK, // wait for the background thread to make room
+        ASYNC_LOG_DROP   // throw the message away
+    };
+
+    void enable_async_logging (
+        unsigned long max_pending_messages_per_thread = 10000,
+        async_log_overflow_policy policy = ASYNC_LOG_BLOCK
+    );
+    /*!
+        requires
+            - max_pending_messages_per_thread > 0
+        ensures
+            - Turns on asynchronous logging for all loggers.  In this mode a logging
+              statement doesn't lock anything or write to the output stream.  Instead, the
+              message text is formatted into a buffer that belongs to the calling thread
+              and handed to a background thread which prints the logger headers and writes
+              the messages to their output streams, or calls the output hooks, in batches.
+              This makes logging much cheaper for threads that log a lot, and keeps
+              threads that log at the same time from waiting on each other.
+            - Messages are written in the order they were logged.  The exceptions are
+              messages logged at nearly the same time by different threads, which may be
+              written in either order.
+            - Each thread can have at most max_pending_messages_per_thread messages
+              waiting to be written.  If a thread logs a message while it already has that
+              many waiting then:
+                - if (policy == ASYNC_LOG_BLOCK) then
+                    - the logging statement waits until the background thread has
+                      written some of them.
+                - else
+                    - the message is thrown away and num_dropped_async_log_messages() is
+                      incremented.
+            - A message logged from inside another logging statement on the same thread
+              (e.g. by an operator<< called by a logging statement) is written
+              synchronously.
+            - If async logging was already enabled then this function first does the
+              equivalent of disable_async_logging().
+            - #async_logging_enabled() == true
+            - Note that in async mode:
+                - logger headers and output hooks are called from the background thread.
+                  print_default_logger_header() still prints the time the message was
+                  logged rather than the time it was written.
+                - the output streams and hook objects given to loggers must stay valid
+                  until the messages sent to them are written.  Calling
+                  flush_async_logging() or disable_async_logging() makes sure of that.
+                - with auto_flush() enabled, output streams are flushed after each batch
+                  rather than after each message.
+        throws
+            - std::bad_alloc
+            - std::system_error
+    !*/
+
+    void disable_async_logging (
+    );
+    /*!
+        ensures
+            - Writes out all the messages waiting to be written, stops the background
+              thread, and makes logging statements synchronous again.
+            - #async_logging_enabled() == false
+    !*/
+
+    bool async_logging_enabled (
+    );
+    /*!
+        ensures
+            - returns true if async logging is enabled and false otherwise.
+    !*/
+
+    void flush_async_logging (
+    );
+    /*!
+        requires
+            - is not called from a logger header or output hook.
+        ensures
+            - if (async_logging_enabled()) then
+                - blocks until all the messages that were logged before this call have
+                  been written.
+    !*/
+
+    uint64 num_dropped_async_log_messages (
+    );
+    /*!
+        ensures
+            - returns the total number of log messages that have been thrown away
+              because of the ASYNC_LOG_DROP policy.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 // ----------------------------------------------------------------------------------------
 // ----------------------------------------------------------------------------------------
@@ -184,7 +274,9 @@ namespace dlib
                 each logging action.  It just writes directly into the user supplied output
                 stream.  Alternatively, if you use a logging output hook no memory allocations
                 are performed either.  Logging just goes straight into a memory buffer
-                which gets passed to the user supplied logging hook.
+                which gets passed to the user supplied logging hook.  The same is true
+                of async logging (see enable_async_logging()) once the buffers it uses
+                have grown to fit the messages being logged.
 
             DEFAULTS
                 If the user hasn't specified values for the four inherited values level(),
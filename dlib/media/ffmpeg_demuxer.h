@@ -655,6 +655,9 @@ namespace dlib
                         - optionally converts frame using args_image if frame.is_image() == true, or args_audio if frame.is_audio() == true
                     - else
                         - returns false and frame.is_empty() == true
+                    - When args_image is empty, image frames are returned in the codec's native format
+                      without copying.  If has_luma_plane(frame.pixfmt()) == true, you can then wrap the
+                      frame in a luma_view to use its Y channel as a grayscale image without any conversion.
             !*/
 
             template <
@@ -677,6 +680,8 @@ namespace dlib
                         then the frame is resized to fit those dimensions.
                     - If num_rows(img) == 0 and num_cols(img) == 0:
                         then the frame is copied to "img"
+                    - The frame is scaled and converted directly into img's memory, so if img already has
+                      the right dimensions, no memory is allocated.
             !*/
 
         private:
@@ -818,15 +823,9 @@ namespace dlib
             {
                 if (f.is_image())
                 {
-                    convert (
-                        f, f,
-                        resizer,
-                        resampler,
-                        {0,0,pix_traits<pixel_type_t<image_type>>::fmt},
-                        {}
-                    );
-
-                    convert(f, img);
+                    // Convert straight into img, reusing its memory from one frame to the next.
+                    set_image_size(img, f.height(), f.width());
+                    resizer.resize(f, img);
                     pclb(img);
                 } 
             };
@@ -870,16 +869,8 @@ namespace dlib
             {
                 if (f.is_image())
                 {
-                    convert (
-                        f, f,
-                        resizer,
-                        resampler,
-                        {0,0,pix_traits<pixel_type_t<image_type>>::fmt},
-                        {}
-                    );
-
                     image_type img;
-                    convert(f, img);
+                    resizer.resize(f, img);
                     queue.push(std::move(img));
                 } 
             };
@@ -1538,19 +1529,9 @@ namespace dlib
 
                 if (f.is_image())
                 {
-                    convert (
-                        f,
-                        f,
-                        st.channel_video.resizer_image,
-                        st.channel_audio.resizer_audio,
-                        {img.nr() > 0 ? (int)img.nr() : f.height(),
-                         img.nc() > 0 ? (int)img.nc() : f.width(),
-                         pix_traits<pixel_type_t<image_type>>::fmt},
-                        {}
-                    );
-
-                    convert(f, img);
-                    
+                    // Scale and convert straight into img.  This avoids allocating an
+                    // intermediate frame and copying it a second time.
+                    st.channel_video.resizer_image.resize(f, img);
                     return true;
                 } 
             }
@@ -49,6 +49,7 @@ extern "C" {
 #include <libavutil/opt.h>
 #include <libavutil/pixdesc.h>
 #include <libavutil/frame.h>
+#include <libavutil/buffer.h>
 #include <libavutil/channel_layout.h>
 #include <libavutil/audio_fifo.h>
 #include <libavutil/imgutils.h>
@@ -362,6 +363,7 @@ namespace dlib { namespace ffmpeg { namespace details
         void operator()(AVCodecParserContext* ptr)  const;
         void operator()(AVFormatContext* ptr)       const;
         void operator()(AVDeviceInfoList* ptr)      const;
+        void operator()(AVBufferPool* ptr)          const;
     };
 
     inline void av_deleter::operator()(AVFrame *ptr)               const { if (ptr) av_frame_free(&ptr); }
@@ -372,6 +374,7 @@ namespace dlib { namespace ffmpeg { namespace details
     inline void av_deleter::operator()(AVCodecContext *ptr)        const { if (ptr) avcodec_free_context(&ptr); }
     inline void av_deleter::operator()(AVCodecParserContext *ptr)  const { if (ptr) av_parser_close(ptr); }
     inline void av_deleter::operator()(AVDeviceInfoList* ptr)      const { if (ptr) avdevice_free_list_devices(&ptr); }
+    inline void av_deleter::operator()(AVBufferPool* ptr)          const { if (ptr) av_buffer_pool_uninit(&ptr); }
     inline void av_deleter::operator()(AVFormatContext *ptr)       const 
     { 
         if (ptr) 
@@ -0,0 +1,672 @@
+// Copyright (C) 2023  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+
+#ifndef DLIB_FFMPEG_PIPELINE
+#define DLIB_FFMPEG_PIPELINE
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "ffmpeg_demuxer.h"
+#include "../pipe.h"
+#include "../threads.h"
+
+namespace dlib
+{
+    namespace ffmpeg
+    {
+
+// ---------------------------------------------------------------------------------------------------
+
+        template <class image_type>
+        struct stream_frame
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    This is a decoded video frame travelling through a multi_stream_pipeline.
+            !*/
+
+            // Index, into multi_stream_pipeline::args::sources, of the stream this frame came from.
+            std::size_t stream_id{0};
+
+            // Number of this frame within its stream, starting at 0.  Dropped frames still consume a number,
+            // so gaps in this sequence tell you frames were dropped.
+            uint64_t frame_number{0};
+
+            // Timestamp of the frame as reported by the demuxer
+            std::chrono::system_clock::time_point timestamp{};
+
+            // Time at which the frame finished decoding.  Used to measure queueing latency.
+            std::chrono::steady_clock::time_point decoded{};
+
+            // The decoded image
+            image_type img;
+        };
+
+// ---------------------------------------------------------------------------------------------------
+
+        struct pipeline_stats
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    This is a snapshot of the counters of a multi_stream_pipeline.
+                    All times are wall clock times in milliseconds.
+            !*/
+
+            // Decode stage
+            uint64_t    frames_decoded{0};      // frames read and converted, including the dropped ones
+            uint64_t    frames_dropped{0};      // frames discarded because the queue was full
+            double      mean_decode_ms{0};      // mean time to read and convert one frame
+            double      max_decode_ms{0};
+
+            // Queue between the decode and inference stages
+            double      mean_queue_ms{0};       // mean time a frame waits between decoding and the start of its batch
+            double      max_queue_ms{0};
+
+            // Inference stage
+            uint64_t    frames_processed{0};    // frames passed to the batch callback
+            uint64_t    batches_processed{0};   // calls to the batch callback
+            double      mean_batch_ms{0};       // mean time spent in one call to the batch callback
+            double      max_batch_ms{0};
+
+            // Time since start()
+            double      elapsed_seconds{0};
+
+            double decode_fps() const noexcept
+            {
+                return elapsed_seconds > 0 ? frames_decoded / elapsed_seconds : 0;
+            }
+
+            double processed_fps() const noexcept
+            {
+                return elapsed_seconds > 0 ? frames_processed / elapsed_seconds : 0;
+            }
+        };
+
+        inline std::ostream& operator<<(std::ostream& out, const pipeline_stats& s)
+        {
+            out << "decoded: "      << s.frames_decoded
+                << " dropped: "     << s.frames_dropped
+                << " processed: "   << s.frames_processed
+                << " batches: "     << s.batches_processed
+                << " decode: "      << s.mean_decode_ms << "ms (max " << s.max_decode_ms << "ms)"
+                << " queue: "       << s.mean_queue_ms  << "ms (max " << s.max_queue_ms  << "ms)"
+                << " batch: "       << s.mean_batch_ms  << "ms (max " << s.max_batch_ms  << "ms)"
+                << " throughput: "  << s.processed_fps() << "fps";
+            return out;
+        }
+
+// ---------------------------------------------------------------------------------------------------
+
+        template <class image_type>
+        class multi_stream_pipeline
+        {
+        public:
+            /*!
+                REQUIREMENTS ON image_type
+                    image_type is an image object that implements the interface defined in
+                    dlib/image_processing/generic_image.h and is default constructible and movable.
+
+                WHAT THIS OBJECT REPRESENTS
+                    This object decodes N video streams concurrently and feeds their frames, in
+                    batches, to a user supplied callback.  It is meant for video analytics services
+                    that run a detector or a DNN on many cameras or files at once.
+
+                    The pipeline has two stages connected by a bounded dlib::pipe:
+                        - The decode stage.  A pool of args::num_decode_threads threads is shared by
+                          all streams.  Each thread repeatedly picks a stream that no other thread is
+                          reading, reads one frame from it and converts it to image_type.  Streams are
+                          opened lazily by the decode threads.
+                        - The inference stage.  A pool of args::num_inference_threads threads pulls
+                          frames from the queue and groups them, across streams, into batches of at
+                          most args::batch_size frames.  A batch is handed to the callback as soon as
+                          it is full, or once args::batch_timeout has elapsed since its first frame
+                          was dequeued.
+
+                    When the queue is full and args::drop_frames == true, newly decoded frames are
+                    discarded rather than blocking the decoders, so live streams never fall behind.
+                    With args::drop_frames == false decoders wait for room in the queue instead, which
+                    is what you want when processing files where every frame matters.
+
+                    Latency and throughput counters for each stage are available via get_stats().
+
+                THREAD SAFETY
+                    The batch callback may be invoked concurrently from several inference threads
+                    if args::num_inference_threads > 1.  The public member functions of this object
+                    must not be called from within the callback.
+            !*/
+
+            using frame_type    = stream_frame<image_type>;
+            using callback_type = std::function<void(std::vector<frame_type>& batch)>;
+
+            struct args
+            {
+                /*!
+                    WHAT THIS OBJECT REPRESENTS
+                        This holds constructor arguments for multi_stream_pipeline.
+                !*/
+
+                // One entry per stream.  These can be files, devices or network streams.
+                std::vector<demuxer::args> sources;
+
+                // If non-zero, decoded frames are resized to these dimensions.  Otherwise they keep
+                // the size of their stream.
+                int height{0};
+                int width{0};
+
+                // Maximum number of decoded frames waiting for the inference stage
+                std::size_t queue_size{16};
+
+                // Maximum number of frames passed to one call of the batch callback
+                std::size_t batch_size{8};
+
+                // Maximum time spent waiting for a batch to fill up
+                std::chrono::milliseconds batch_timeout{20};
+
+                // Number of decode threads.  0 means one per stream.  Never more than sources.size() are used.
+                std::size_t num_decode_threads{0};
+
+                // Number of threads invoking the batch callback
+                std::size_t num_inference_threads{1};
+
+                // Drop frames when the queue is full instead of blocking the decoders
+                bool drop_frames{true};
+            };
+
+            multi_stream_pipeline(
+                const args& a,
+                callback_type process_batch
+            );
+            /*!
+                requires
+                    - a.queue_size > 0
+                    - a.batch_size > 0
+                    - a.num_inference_threads > 0
+                    - process_batch is a valid function object
+                ensures
+                    - #num_streams() == a.sources.size()
+                    - #is_running() == false
+                    - No stream is opened until start() is called.
+            !*/
+
+            multi_stream_pipeline(const multi_stream_pipeline&) = delete;
+            multi_stream_pipeline& operator=(const multi_stream_pipeline&) = delete;
+
+            ~multi_stream_pipeline();
+            /*!
+                ensures
+                    - calls stop()
+            !*/
+
+            void start();
+            /*!
+                requires
+                    - start() hasn't been called before
+                ensures
+                    - launches the decode and inference threads and returns immediately.
+                    - #is_running() == true
+            !*/
+
+            void wait();
+            /*!
+                ensures
+                    - blocks until every stream has ended or failed and every decoded frame that
+                      wasn't dropped has been passed to the batch callback, or until stop() is called.
+                    - #is_running() == false
+                    - If the batch callback or a decoder threw an exception, it is rethrown here.
+            !*/
+
+            void stop();
+            /*!
+                ensures
+                    - interrupts all streams, discards frames still waiting in the queue and waits
+                      for any batch currently being processed to finish.
+                    - #is_running() == false
+            !*/
+
+            bool is_running() const noexcept;
+            /*!
+                ensures
+                    - returns true if start() has been called and the pipeline hasn't finished,
+                      failed or been stopped yet.  This goes false on its own, without a call to
+                      wait() or stop(), once every decode and inference thread has returned.
+                      E.g. when the batch callback throws.  wait() then rethrows the exception.
+            !*/
+
+            std::size_t num_streams() const noexcept;
+            /*!
+                ensures
+                    - returns the number of streams given to the constructor.
+            !*/
+
+            std::size_t num_active_streams() const noexcept;
+            /*!
+                ensures
+                    - returns the number of streams that haven't ended or failed yet.  Once the
+                      pipeline has stopped reading, e.g. because of stop() or an exception,
+                      this is 0.
+            !*/
+
+            pipeline_stats get_stats() const;
+            /*!
+                ensures
+                    - returns the current values of the pipeline's counters.
+                    - This function may be called at any time, including while the pipeline runs.
+            !*/
+
+        private:
+
+            struct stream_state
+            {
+                std::size_t                 id{0};
+                demuxer::args               source;
+                std::unique_ptr<demuxer>    cap;
+                details::resizer            resizer;
+                frame                       f;
+                uint64_t                    frame_number{0};
+                std::atomic<bool>           claimed{false};
+                std::atomic<bool>           done{false};
+            };
+
+            struct timing
+            {
+                uint64_t    count{0};
+                double      total_ms{0};
+                double      max_ms{0};
+
+                void add(double ms)
+                {
+                    ++count;
+                    total_ms += ms;
+                    max_ms = std::max(max_ms, ms);
+                }
+
+                double mean() const { return count > 0 ? total_ms / count : 0; }
+            };
+
+            static double ms_since(std::chrono::steady_clock::time_point t)
+            {
+                return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t).count();
+            }
+
+            stream_state* claim_stream(std::size_t& next);
+            bool decode_one(stream_state& s);
+            void decode_loop(std::size_t first);
+            void inference_loop();
+            void on_decoder_exit();
+            void on_thread_exit();
+
+            const args                          args_;
+            const callback_type                 process_batch;
+            std::vector<std::unique_ptr<stream_state>> streams;
+            dlib::pipe<frame_type>              queue;
+            std::unique_ptr<thread_pool>        decode_pool;
+            std::unique_ptr<thread_pool>        inference_pool;
+            std::atomic<bool>                   stopping{false};
+            std::atomic<bool>                   running{false};
+            std::atomic<std::size_t>            active_streams{0};
+            std::atomic<std::size_t>            active_decoders{0};
+            std::atomic<std::size_t>            active_threads{0};
+
+            mutable std::mutex                  stats_mutex;
+            std::chrono::steady_clock::time_point started{};
+            uint64_t                            frames_dropped{0};
+            uint64_t                            frames_processed{0};
+            timing                              decode_timing;
+            timing                              queue_timing;
+            timing                              batch_timing;
+        };
+
+// ---------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------
+//                                          IMPLEMENTATION
+// ---------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------
+
+        template <class image_type>
+        inline multi_stream_pipeline<image_type>::multi_stream_pipeline(
+            const args& a,
+            callback_type process_batch_
+        ) : args_{a},
+            process_batch{std::move(process_batch_)},
+            queue{a.queue_size}
+        {
+            DLIB_CASSERT(a.queue_size > 0, "queue_size must be positive");
+            DLIB_CASSERT(a.batch_size > 0, "batch_size must be positive");
+            DLIB_CASSERT(a.num_inference_threads > 0, "num_inference_threads must be positive");
+            DLIB_CASSERT(process_batch != nullptr, "process_batch must be a valid function object");
+
+            for (const auto& source : args_.sources)
+            {
+                streams.emplace_back(new stream_state);
+                auto& s = *streams.back();
+                s.id     = streams.size()-1;
+                s.source = source;
+
+                // Let stop() interrupt streams blocked on network reads
+                s.source.interrupter = [this, user = source.interrupter]
+                {
+                    return stopping.load() || (user && user());
+                };
+            }
+        }
+
+// ---------------------------------------------------------------------------------------------------
+
+        template <class image_type>
+        inline multi_stream_pipeline<image_type>::~multi_stream_pipeline()
+        {
+            try
+            {
+                stop();
+            }
+            catch (...)
+            {
+            }
+        }
+
+// ---------------------------------------------------------------------------------------------------
+
+        template <class image_type>
+        inline void multi_stream_pipeline<image_type>::start()
+        {
+            DLIB_CASSERT(!decode_pool, "multi_stream_pipeline::start() can only be called once");
+
+            started = std::chrono::steady_clock::now();
+            running = true;
+            active_streams = streams.size();
+
+            const std::size_t ndecoders = std::max<std::size_t>(1, std::min(
+                args_.num_decode_threads > 0 ? args_.num_decode_threads : streams.size(),
+                streams.size()));
+
+            active_decoders = ndecoders;
+            active_threads = ndecoders + args_.num_inference_threads;
+            decode_pool.reset(new thread_pool(ndecoders));
+            inference_pool.reset(new thread_pool(args_.num_inference_threads));
+
+            // Spread the decoders over the streams so they don't all start with the first one.
+            for (std::size_t i = 0; i < ndecoders; ++i)
+                decode_pool->add_task_by_value([this, i]{ decode_loop(i); });
+
+            for (std::size_t i = 0; i < args_.num_inference_threads; ++i)
+                inference_pool->add_task_by_value([this]{ inference_loop(); });
+        }
+
+// ---------------------------------------------------------------------------------------------------
+
+        template <class image_type>
+        inline void multi_stream_pipeline<image_type>::wait()
+        {
+            if (!decode_pool)
+                return;
+
+            try
+            {
+                decode_pool->wait_for_all_tasks();
+                inference_pool->wait_for_all_tasks();
+            }
+            catch (...)
+            {
+                running = false;
+                throw;
+            }
+
+            running = false;
+        }
+
+// ---------------------------------------------------------------------------------------------------
+
+        template <class image_type>
+        inline void multi_stream_pipeline<image_type>::stop()
+        {
+            stopping = true;
+            queue.disable();
+            queue.empty();
+            wait();
+        }
+
+// ---------------------------------------------------------------------------------------------------
+
+        template <class image_type>
+        inline bool multi_stream_pipeline<image_type>::is_running() const noexcept
+        {
+            return running;
+        }
+
+        template <class image_type>
+        inline std::size_t multi_stream_pipeline<image_type>::num_streams() const noexcept
+        {
+            return streams.size();
+        }
+
+        template <class image_type>
+        inline std::size_t multi_stream_pipeline<image_type>::num_active_streams() const noexcept
+        {
+            return active_streams;
+        }
+
+// ---------------------------------------------------------------------------------------------------
+
+        template <class image_type>
+        inline pipeline_stats multi_stream_pipeline<image_type>::get_stats() const
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+
+            pipeline_stats s;
+            s.frames_decoded    = decode_timing.count;
+            s.frames_dropped    = frames_dropped;
+            s.mean_decode_ms    = decode_timing.mean();
+            s.max_decode_ms     = decode_timing.max_ms;
+            s.mean_queue_ms     = queue_timing.mean();
+            s.max_queue_ms      = queue_timing.max_ms;
+            s.frames_processed  = frames_processed;
+            s.batches_processed = batch_timing.count;
+            s.mean_batch_ms     = batch_timing.mean();
+            s.max_batch_ms      = batch_timing.max_ms;
+            s.elapsed_seconds   = decode_pool ? ms_since(started) / 1000.0 : 0.0;
+            return s;
+        }
+
+// ---------------------------------------------------------------------------------------------------
+
+        template <class image_type>
+        inline typename multi_stream_pipeline<image_type>::stream_state*
+        multi_stream_pipeline<image_type>::claim_stream(std::size_t& next)
+        {
+            // Round robin over the streams, starting at next, and grab the first one that isn't
+            // finished and isn't being read by another decoder.
+            for (std::size_t i = 0; i < streams.size(); ++i)
+            {
+                auto& s = *streams[(next + i) % streams.size()];
+                if (!s.done && !s.claimed.exchange(true))
+                {
+                    next = (next + i + 1) % streams.size();
+                    return &s;
+                }
+            }
+            return nullptr;
+        }
+
+// ---------------------------------------------------------------------------------------------------
+
+        template <class image_type>
+        inline bool multi_stream_pipeline<image_type>::decode_one(stream_state& s)
+        {
+            const auto t0 = std::chrono::steady_clock::now();
+
+            if (!s.cap)
+            {
+                s.cap.reset(new demuxer(s.source));
+                if (!s.cap->is_open() || !s.cap->video_enabled())
+                {
+                    logger_dlib_wrapper() << LERROR << "multi_stream_pipeline: failed to open video stream " << s.source.filepath;
+                    return false;
+                }
+            }
+
+            // Skip audio frames
+            do
+            {
+                if (!s.cap->read(s.f))
+                    return false;
+            } while (!s.f.is_image());
+
+            frame_type item;
+            item.stream_id      = s.id;
+            item.frame_number   = s.frame_number++;
+            item.timestamp      = s.f.get_timestamp();
+
+            if (args_.height > 0 && args_.width > 0)
+                set_image_size(item.img, args_.height, args_.width);
+            s.resizer.resize(s.f, item.img);
+
+            item.decoded = std::chrono::steady_clock::now();
+            const double decode_ms = std::chrono::duration<double, std::milli>(item.decoded - t0).count();
+
+            bool dropped = false;
+            if (args_.drop_frames)
+            {
+                // A timeout of 0 never blocks.  If the queue is full the frame is dropped.
+                if (!queue.enqueue_or_timeout(item, 0))
+                    dropped = queue.is_enabled();
+            }
+            else
+            {
+                queue.enqueue(item);
+            }
+
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            decode_timing.add(decode_ms);
+            if (dropped)
+                ++frames_dropped;
+
+            return queue.is_enabled();
+        }
+
+// ---------------------------------------------------------------------------------------------------
+
+        template <class image_type>
+        inline void multi_stream_pipeline<image_type>::decode_loop(std::size_t next)
+        {
+            try
+            {
+                while (!stopping)
+                {
+                    stream_state* s = claim_stream(next);
+
+                    // Every remaining stream is being read by another decoder, which will keep
+                    // reading it until it ends.  So this decoder isn't needed anymore.
+                    if (!s)
+                        break;
+
+                    if (!decode_one(*s))
+                    {
+                        s->cap.reset();
+                        s->done = true;
+                        --active_streams;
+                    }
+
+                    s->claimed = false;
+                }
+            }
+            catch (...)
+            {
+                on_decoder_exit();
+                throw;
+            }
+
+            on_decoder_exit();
+        }
+
+// ---------------------------------------------------------------------------------------------------
+
+        template <class image_type>
+        inline void multi_stream_pipeline<image_type>::on_decoder_exit()
+        {
+            // The last decoder out lets the inference stage drain the queue and then shuts it
+            // down, which makes the inference threads return.  If the pipeline was stopped some
+            // streams haven't ended, but nothing reads them anymore.
+            if (--active_decoders == 0)
+            {
+                active_streams = 0;
+                queue.wait_until_empty();
+                queue.disable();
+            }
+            on_thread_exit();
+        }
+
+// ---------------------------------------------------------------------------------------------------
+
+        template <class image_type>
+        inline void multi_stream_pipeline<image_type>::on_thread_exit()
+        {
+            // The pipeline is done once its last thread returns, whether or not anyone has
+            // called wait() yet.
+            if (--active_threads == 0)
+                running = false;
+        }
+
+// ---------------------------------------------------------------------------------------------------
+
+        template <class image_type>
+        inline void multi_stream_pipeline<image_type>::inference_loop()
+        {
+            using namespace std::chrono;
+
+            std::vector<frame_type> batch;
+            batch.reserve(args_.batch_size);
+            frame_type item;
+
+            try
+            {
+                while (queue.dequeue(item))
+                {
+                    batch.clear();
+                    batch.push_back(std::move(item));
+
+                    // Fill up the batch, but don't hold on to frames for longer than batch_timeout
+                    const auto deadline = steady_clock::now() + args_.batch_timeout;
+                    while (batch.size() < args_.batch_size)
+                    {
+                        const auto remaining = duration_cast<milliseconds>(deadline - steady_clock::now()).count();
+                        if (remaining <= 0 || !queue.dequeue_or_timeout(item, (unsigned long)remaining))
+                            break;
+                        batch.push_back(std::move(item));
+                    }
+
+                    const auto t0 = steady_clock::now();
+                    {
+                        std::lock_guard<std::mutex> lock(stats_mutex);
+                        for (const auto& b : batch)
+                            queue_timing.add(duration<double, std::milli>(t0 - b.decoded).count());
+                    }
+
+                    process_batch(batch);
+
+                    std::lock_guard<std::mutex> lock(stats_mutex);
+                    batch_timing.add(ms_since(t0));
+                    frames_processed += batch.size();
+                }
+            }
+            catch (...)
+            {
+                // Nobody will consume frames anymore so release the decoders.
+                stopping = true;
+                queue.disable();
+                on_thread_exit();
+                throw;
+            }
+
+            on_thread_exit();
+        }
+
+// ---------------------------------------------------------------------------------------------------
+
+    }
+}
+
+#endif //DLIB_FFMPEG_PIPELINE
@@ -292,6 +292,7 @@ namespace dlib
             friend class details::resampler;
             friend class encoder;
             friend class decoder;
+            friend class frame_pool;
 
             void copy_from(const frame& other);
 
@@ -299,6 +300,69 @@ namespace dlib
             std::chrono::system_clock::time_point timestamp;
         };
 
+// ---------------------------------------------------------------------------------------------------
+
+        class frame_pool
+        {
+        public:
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    This class hands out image frame objects whose pixel buffers are recycled.
+                    
+                    Frames returned by get() hold a reference to a buffer owned by an internal
+                    AVBufferPool.  When the last frame referencing a buffer is destroyed or
+                    cleared, the buffer goes back to the pool and is reused by a subsequent
+                    call to get().  So as long as the requested dimensions and pixel format
+                    don't change, a steady stream of frames doesn't allocate any memory.
+
+                    Buffers that are still in use when the pool is destroyed, or when the
+                    requested dimensions change, remain valid.  They are freed when their
+                    last frame is released.
+            !*/
+
+            frame_pool() = default;
+            /*!
+                ensures
+                    - this object doesn't hold any buffers
+            !*/
+
+            frame get (
+                int                                     h,
+                int                                     w,
+                AVPixelFormat                           pixfmt,
+                std::chrono::system_clock::time_point   timestamp = {}
+            );
+            /*!
+                requires
+                    - h > 0
+                    - w > 0
+                    - pixfmt != AV_PIX_FMT_NONE
+                ensures
+                    - returns an image frame F such that:
+                        - F.is_image() == true
+                        - F.height()   == h
+                        - F.width()    == w
+                        - F.pixfmt()   == pixfmt
+                        - F.get_timestamp() == timestamp
+                        - F's pixel data is uninitialized and backed by a recycled buffer if one is available.
+                    - If h, w or pixfmt differ from the previous call to get(), the pool is
+                      reset so that it hands out buffers of the new size.
+                    - throws std::runtime_error if the buffer couldn't be allocated
+            !*/
+
+            void clear();
+            /*!
+                ensures
+                    - releases all the buffers currently sitting unused in the pool.
+            !*/
+
+        private:
+            details::av_ptr<AVBufferPool>   pool;
+            int                             height{0};
+            int                             width{0};
+            AVPixelFormat                   fmt{AV_PIX_FMT_NONE};
+        };
+
 // ---------------------------------------------------------------------------------------------------
 
         template<class PixelType>
@@ -577,6 +641,93 @@ namespace dlib
             AVSampleFormat  fmt{AV_SAMPLE_FMT_NONE};
         };
 
+// ---------------------------------------------------------------------------------------------------
+
+        bool has_luma_plane(AVPixelFormat fmt);
+        /*!
+            ensures
+                - returns true if the first plane of an image with pixel format fmt holds
+                  8 bit luma (or gray) values with one byte per pixel, i.e. if that plane can be
+                  interpreted directly as an unsigned char image.  This is the case for the
+                  planar and semi-planar YUV formats most decoders output, e.g. AV_PIX_FMT_YUV420P,
+                  AV_PIX_FMT_YUVJ420P, AV_PIX_FMT_NV12, as well as AV_PIX_FMT_GRAY8.
+        !*/
+
+// ---------------------------------------------------------------------------------------------------
+
+        class luma_view
+        {
+        public:
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    This object is a read-only grayscale image, with pixel type unsigned char,
+                    that refers directly to the luma (Y) plane of a decoded frame.  No pixel data
+                    is copied or converted, which makes it the cheapest way to feed a decoded
+                    video frame to algorithms that only need intensity, e.g. HOG based object
+                    detectors.
+
+                    It implements the generic image interface defined in
+                    dlib/image_processing/generic_image.h, except that it can't be resized.
+                    The frame is kept alive by this object, so the view stays valid for as long
+                    as this object does.
+            !*/
+
+            luma_view() = default;
+            /*!
+                ensures
+                    - nr() == 0
+                    - nc() == 0
+            !*/
+
+            explicit luma_view(frame&& f);
+            /*!
+                requires
+                    - f.is_image() == true
+                    - has_luma_plane(f.pixfmt()) == true
+                ensures
+                    - #*this refers to the luma plane of f.  f is moved into *this.
+                    - nr() == f.height()
+                    - nc() == f.width()
+            !*/
+
+            long nr() const noexcept;
+            /*!
+                ensures
+                    - returns the number of rows in this image
+            !*/
+
+            long nc() const noexcept;
+            /*!
+                ensures
+                    - returns the number of columns in this image
+            !*/
+
+            long width_step() const noexcept;
+            /*!
+                ensures
+                    - returns the distance in bytes between the starts of two consecutive rows.
+                      This is the linesize of the underlying frame and is generally > nc().
+            !*/
+
+            const unsigned char* data() const noexcept;
+            /*!
+                ensures
+                    - if (nr() != 0 && nc() != 0) then
+                        - returns a pointer to the first pixel of the luma plane
+                    - else
+                        - returns nullptr
+            !*/
+
+            const frame& get_frame() const noexcept;
+            /*!
+                ensures
+                    - returns the frame this object refers to
+            !*/
+
+        private:
+            frame f;
+        };
+
 // ---------------------------------------------------------------------------------------------------
 
     }
@@ -664,8 +815,25 @@ namespace dlib
                     frame &dst
                 );
 
+                template <class image_type>
+                void resize(
+                    const frame &src,
+                    image_type &dst
+                );
+                /*!
+                    requires
+                        - src.is_image() == true
+                    ensures
+                        - Scales and converts src directly into the memory of dst, without
+                          going through an intermediate frame.
+                        - If num_rows(dst) > 0, the output has that many rows, otherwise it has
+                          src.height() rows.  Likewise, if num_columns(dst) > 0, the output has that
+                          many columns, otherwise it has src.width() columns.
+                !*/
+
             private:
-                av_ptr<SwsContext> imgConvertCtx;
+                av_ptr<SwsContext>  imgConvertCtx;
+                frame_pool          pool;
             };
 
             inline void resizer::resize (
@@ -691,9 +859,16 @@ namespace dlib
                 frame tmp;
 
                 if (is_same_object)
+                {
+                    // Resizing in-place needs a second buffer.  Take it from the pool so that
+                    // converting a stream of frames doesn't allocate a new one every time.
+                    tmp = pool.get(dst_h, dst_w, dst_fmt, src.get_timestamp());
                     ptr = &tmp;
-                
-                ptr->set_params(dst_h, dst_w, dst_fmt, 0, 0, 0, AV_SAMPLE_FMT_NONE, src.get_timestamp());
+                }
+                else
+                {
+                    ptr->set_params(dst_h, dst_w, dst_fmt, 0, 0, 0, AV_SAMPLE_FMT_NONE, src.get_timestamp());
+                }
 
                 sws_scale(imgConvertCtx.get(),
                           src.get_frame().data,  src.get_frame().linesize, 0, src.height(),
@@ -711,6 +886,42 @@ namespace dlib
                 resize(src, src.height(), src.width(), src.pixfmt(), dst);
             }
 
+            template <class image_type>
+            inline void resizer::resize (
+                const frame& src,
+                image_type& dst
+            )
+            {
+                using pixel = pixel_type_t<image_type>;
+                constexpr AVPixelFormat dst_fmt = pix_traits<pixel>::fmt;
+
+                DLIB_CASSERT(src.is_image(), "src.is_image() == false");
+
+                const int dst_h = num_rows(dst)    > 0 ? num_rows(dst)    : src.height();
+                const int dst_w = num_columns(dst) > 0 ? num_columns(dst) : src.width();
+                set_image_size(dst, dst_h, dst_w);
+
+                uint8_t*  dst_data[4]     = {(uint8_t*)image_data(dst), nullptr, nullptr, nullptr};
+                const int dst_linesize[4] = {(int)width_step(dst), 0, 0, 0};
+
+                if (std::make_tuple(src.height(), src.width(), src.pixfmt()) == std::make_tuple(dst_h, dst_w, dst_fmt))
+                {
+                    av_image_copy_plane(dst_data[0], dst_linesize[0],
+                                        src.get_frame().data[0], src.get_frame().linesize[0],
+                                        dst_w*sizeof(pixel), dst_h);
+                    return;
+                }
+
+                imgConvertCtx.reset(sws_getCachedContext(imgConvertCtx.release(),
+                                                         src.width(), src.height(), src.pixfmt(),
+                                                         dst_w,       dst_h,        dst_fmt,
+                                                         SWS_FAST_BILINEAR, NULL, NULL, NULL));
+
+                sws_scale(imgConvertCtx.get(),
+                          src.get_frame().data, src.get_frame().linesize, 0, src.height(),
+                          dst_data, dst_linesize);
+            }
+
 // ---------------------------------------------------------------------------------------------------
 
             class resampler
@@ -1086,6 +1297,106 @@ namespace dlib
         inline AVFrame&             frame::get_frame()        { DLIB_CASSERT(f, "is_empty() == true"); return *f; }
         inline std::chrono::system_clock::time_point frame::get_timestamp() const noexcept { return timestamp; }
 
+// ---------------------------------------------------------------------------------------------------
+
+        inline frame frame_pool::get(
+            int h,
+            int w,
+            AVPixelFormat pixfmt,
+            std::chrono::system_clock::time_point timestamp
+        )
+        {
+            using namespace details;
+
+            DLIB_ASSERT(h > 0 && w > 0 && pixfmt != AV_PIX_FMT_NONE, "frame_pool::get() requires a valid image size and format");
+
+            // Same alignment as frame::set_params()
+            const int align = 32;
+
+            if (!pool || std::tie(height, width, fmt) != std::tie(h, w, pixfmt))
+            {
+                const int size = av_image_get_buffer_size(pixfmt, w, h, align);
+                if (size < 0)
+                    throw std::runtime_error("av_image_get_buffer_size() failed : " + get_av_error(size));
+
+                // Buffers handed out by the old pool stay valid. The old pool is only
+                // freed once they are all released.
+                pool.reset(av_buffer_pool_init(size, nullptr));
+                if (!pool)
+                    throw std::runtime_error("av_buffer_pool_init() failed");
+
+                height  = h;
+                width   = w;
+                fmt     = pixfmt;
+            }
+
+            frame out;
+            out.f           = make_avframe();
+            out.f->height   = h;
+            out.f->width    = w;
+            out.f->format   = (int)pixfmt;
+            out.f->buf[0]   = av_buffer_pool_get(pool.get());
+
+            if (!out.f->buf[0])
+                throw std::runtime_error("av_buffer_pool_get() failed");
+
+            const int ret = av_image_fill_arrays(out.f->data, out.f->linesize, out.f->buf[0]->data, pixfmt, w, h, align);
+            if (ret < 0)
+                throw std::runtime_error("av_image_fill_arrays() failed : " + get_av_error(ret));
+
+            out.timestamp = timestamp;
+            return out;
+        }
+
+        inline void frame_pool::clear()
+        {
+            pool    = nullptr;
+            height  = 0;
+            width   = 0;
+            fmt     = AV_PIX_FMT_NONE;
+        }
+
+// ---------------------------------------------------------------------------------------------------
+
+        inline bool has_luma_plane(AVPixelFormat fmt)
+        {
+            const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(fmt);
+
+            if (!desc || desc->nb_components == 0)
+                return false;
+
+            if (desc->flags & (AV_PIX_FMT_FLAG_RGB | AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM | AV_PIX_FMT_FLAG_HWACCEL))
+                return false;
+
+            // The first component must live alone in plane 0, one byte per pixel
+            return desc->comp[0].plane  == 0 &&
+                   desc->comp[0].step   == 1 &&
+                   desc->comp[0].offset == 0 &&
+                   desc->comp[0].shift  == 0 &&
+                   desc->comp[0].depth  == 8;
+        }
+
+// ---------------------------------------------------------------------------------------------------
+
+        inline luma_view::luma_view(frame&& f_)
+        : f{std::move(f_)}
+        {
+            DLIB_CASSERT(f.is_image(), "frame isn't an image type");
+            DLIB_CASSERT(has_luma_plane(f.pixfmt()), "frame with pixel format " << get_pixel_fmt_str(f.pixfmt()) << " doesn't have a luma plane");
+        }
+
+        inline long luma_view::nr() const noexcept { return f.height(); }
+        inline long luma_view::nc() const noexcept { return f.width(); }
+        inline long luma_view::width_step() const noexcept { return f.is_image() ? f.get_frame().linesize[0] : 0; }
+        inline const unsigned char* luma_view::data() const noexcept { return f.is_image() ? f.get_frame().data[0] : nullptr; }
+        inline const frame& luma_view::get_frame() const noexcept { return f; }
+
+        inline long num_rows(const luma_view& img)                  { return img.nr(); }
+        inline long num_columns(const luma_view& img)               { return img.nc(); }
+        inline long width_step(const luma_view& img)                { return img.width_step(); }
+        inline const void* image_data(const luma_view& img)         { return img.data(); }
+        inline void* image_data(luma_view& img)                     { return const_cast<unsigned char*>(img.data()); }
+
 // ---------------------------------------------------------------------------------------------------
 
         inline const std::vector<std::string>& list_protocols()
@@ -1511,6 +1822,18 @@ namespace dlib
 // ---------------------------------------------------------------------------------------------------
 
     }
+
+    template <>
+    struct image_traits<ffmpeg::luma_view>
+    {
+        typedef unsigned char pixel_type;
+    };
+
+    template <>
+    struct image_traits<const ffmpeg::luma_view>
+    {
+        typedef unsigned char pixel_type;
+    };
 }
 
 #endif //DLIB_FFMPEG_UTILS
@@ -0,0 +1,815 @@
+// Copyright (C) 2026  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_LOCK_FREE_PIPe_H_
+#define DLIB_LOCK_FREE_PIPe_H_
+
+#include "lock_free_pipe_abstract.h"
+#include "../algs.h"
+#include "../assert.h"
+#include "../uintn.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    enum pipe_concurrency
+    {
+        PIPE_SPSC,
+        PIPE_MPMC
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T,
+        pipe_concurrency concurrency = PIPE_MPMC
+        >
+    class lock_free_pipe
+    {
+        /*!
+            INITIAL VALUE
+                - pipe_max_size == defined by constructor
+                - enqueue_pos == 0
+                - dequeue_pos == 0
+                - for all i: cells[i].seq == 0
+                - enabled == true
+                - enqueue_enabled == true
+                - dequeue_enabled == true
+                - dequeue_waiters == 0
+                - enqueue_waiters == 0
+                - state_waiters == 0
+
+            CONVENTION
+                - This is a bounded multi-producer/multi-consumer ring buffer of the kind
+                  described by Dmitry Vyukov.  Counting every item ever put into the pipe,
+                  item number i lives in cells[i%pipe_max_size] and is put there on the
+                  turn == i/pipe_max_size trip around the ring.
+                - enqueue_pos == the number of the next item to be enqueued.
+                - dequeue_pos == the number of the next item to be dequeued.
+                - size() == enqueue_pos - dequeue_pos
+                - max_size() == pipe_max_size
+                - for the cell c that is going to hold item number i:
+                    - if ((c.seq&~1) == 4*turn) then
+                        - c is free and item i can be written into it.
+                    - if ((c.seq&~1) == 4*turn+2) then
+                        - c.item is item i and it can be dequeued.
+                    - Dequeuing item i sets c.seq to 4*(turn+1), which frees the cell for
+                      the next trip around the ring.
+                    - if (c.seq&1) then
+                        - some thread is blocked waiting for c.seq to change.
+                - Enqueue and dequeue positions are claimed with a compare and swap when
+                  concurrency == PIPE_MPMC.  With PIPE_SPSC only one thread ever moves each
+                  position so it's just stored.
+
+                - m and changed are only used by threads that have to block and by the
+                  threads that wake them up.  A thread that has to block sets the low bit
+                  of the seq of the cell it is waiting on, while holding m, and then waits
+                  on changed.  Whoever updates a cell does so with an atomic exchange, so
+                  it sees that bit and then notifies changed.  That way the enqueue() and
+                  dequeue() calls that don't block never touch m.
+                - dequeue_waiters == the number of threads blocked in dequeue() or
+                  dequeue_or_timeout().
+                - enqueue_waiters == the number of threads blocked in enqueue() or
+                  enqueue_or_timeout().
+                - state_waiters == the number of threads blocked in wait_until_empty() or
+                  wait_for_num_blocked_dequeues().
+                - The waiter counts are only accessed while holding m.
+        !*/
+
+        struct cell
+        {
+            std::atomic<uint64> seq;
+            T item;
+        };
+
+    public:
+
+        typedef T type;
+
+        explicit lock_free_pipe (
+            size_t maximum_size
+        );
+
+        virtual ~lock_free_pipe (
+        );
+
+        void empty (
+        );
+
+        void wait_until_empty (
+        ) const;
+
+        void wait_for_num_blocked_dequeues (
+            unsigned long num
+        ) const;
+
+        void enable (
+        );
+
+        void disable (
+        );
+
+        bool is_enqueue_enabled (
+        ) const { return enqueue_enabled; }
+
+        void disable_enqueue (
+        );
+
+        void enable_enqueue (
+        ) { enqueue_enabled = true; }
+
+        bool is_dequeue_enabled (
+        ) const { return dequeue_enabled; }
+
+        void disable_dequeue (
+        );
+
+        void enable_dequeue (
+        ) { dequeue_enabled = true; }
+
+        bool is_enabled (
+        ) const { return enabled; }
+
+        size_t max_size (
+        ) const { return pipe_max_size; }
+
+        size_t size (
+        ) const
+        {
+            const uint64 d = dequeue_pos.load(std::memory_order_acquire);
+            const uint64 e = enqueue_pos.load(std::memory_order_acquire);
+            return (e > d) ? static_cast<size_t>(std::min<uint64>(e-d, pipe_max_size)) : 0;
+        }
+
+        bool enqueue (
+            T& item
+        );
+
+        bool enqueue (
+            T&& item
+        ) { return enqueue(item); }
+
+        bool dequeue (
+            T& item
+        );
+
+        bool enqueue_or_timeout (
+            T& item,
+            unsigned long timeout
+        );
+
+        bool enqueue_or_timeout (
+            T&& item,
+            unsigned long timeout
+        ) { return enqueue_or_timeout(item,timeout); }
+
+        bool dequeue_or_timeout (
+            T& item,
+            unsigned long timeout
+        );
+
+    private:
+
+        bool try_enqueue (
+            T& item,
+            bool m_is_locked
+        );
+
+        bool try_dequeue (
+            T& item,
+            bool m_is_locked
+        );
+
+        void update_cell (
+            cell& c,
+            uint64 seq,
+            bool m_is_locked
+        );
+        /*!
+            requires
+                - m_is_locked == true if and only if the calling thread holds m
+            ensures
+                - #c.seq == seq
+                - wakes up any threads waiting on c.
+        !*/
+
+        bool mark_cell (
+            cell& c,
+            uint64 seen
+        ) const;
+        /*!
+            requires
+                - m is locked
+            ensures
+                - if (c.seq still has the value seen, ignoring the low bit) then
+                    - sets the low bit of c.seq so that the next update_cell(c) call
+                      notifies changed.
+                    - returns true
+                - else
+                    - returns false.  The state of c changed since we looked at it.
+        !*/
+
+        bool wait_for_change (
+            std::unique_lock<std::mutex>& lock,
+            bool use_timeout,
+            const std::chrono::steady_clock::time_point& deadline
+        ) const;
+        /*!
+            ensures
+                - waits on changed, until deadline if use_timeout is true.
+                - returns false if the deadline passed.
+        !*/
+
+        bool mark_last_item (
+        ) const;
+        /*!
+            requires
+                - m is locked
+            ensures
+                - marks the cell of the last item enqueued, so that we are woken up when
+                  it's dequeued.
+                - returns false if the pipe changed while looking at it.
+        !*/
+
+        bool enqueue_slow (
+            T& item,
+            bool use_timeout,
+            unsigned long timeout
+        );
+
+        bool dequeue_slow (
+            T& item,
+            bool use_timeout,
+            unsigned long timeout
+        );
+
+        const size_t pipe_max_size;
+        std::unique_ptr<cell[]> cells;
+
+        // Keep the producer and consumer positions on different cache lines so the two
+        // sides don't slow each other down.
+        char pad0[64];
+        std::atomic<uint64> enqueue_pos;
+        char pad1[64];
+        std::atomic<uint64> dequeue_pos;
+        char pad2[64];
+
+        std::atomic<bool> enabled;
+        std::atomic<bool> enqueue_enabled;
+        std::atomic<bool> dequeue_enabled;
+
+        mutable std::mutex m;
+        mutable std::condition_variable changed;
+        unsigned long dequeue_waiters;
+        unsigned long enqueue_waiters;
+        mutable unsigned long state_waiters;
+
+        // restricted functions
+        lock_free_pipe(const lock_free_pipe&);        // copy constructor
+        lock_free_pipe& operator=(const lock_free_pipe&);    // assignment operator
+    };
+
+// ----------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------
+//                      member function definitions
+// ----------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T,
+        pipe_concurrency concurrency
+        >
+    lock_free_pipe<T,concurrency>::
+    lock_free_pipe (
+        size_t maximum_size
+    ) :
+        pipe_max_size(maximum_size),
+        cells(new cell[maximum_size]),
+        enqueue_pos(0),
+        dequeue_pos(0),
+        enabled(true),
+        enqueue_enabled(true),
+        dequeue_enabled(true),
+        dequeue_waiters(0),
+        enqueue_waiters(0),
+        state_waiters(0)
+    {
+        // make sure requires clause is not broken
+        DLIB_ASSERT(maximum_size > 0,
+            "\t lock_free_pipe::lock_free_pipe(maximum_size)"
+            << "\n\t maximum_size must be greater than 0"
+            << "\n\t this: " << this
+            );
+
+        for (size_t i = 0; i < pipe_max_size; ++i)
+            cells[i].seq.store(0, std::memory_order_relaxed);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T,
+        pipe_concurrency concurrency
+        >
+    lock_free_pipe<T,concurrency>::
+    ~lock_free_pipe (
+    )
+    {
+        std::unique_lock<std::mutex> lock(m);
+
+        // first make sure no one is blocked on any calls to enqueue() or dequeue()
+        enabled = false;
+        changed.notify_all();
+
+        // wait for all threads to unblock
+        while (dequeue_waiters > 0 || enqueue_waiters > 0 || state_waiters > 0)
+            changed.wait(lock);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T,
+        pipe_concurrency concurrency
+        >
+    bool lock_free_pipe<T,concurrency>::
+    try_enqueue (
+        T& item,
+        bool m_is_locked
+    )
+    {
+        uint64 pos = enqueue_pos.load(std::memory_order_relaxed);
+        cell* c;
+        uint64 turn;
+        while (true)
+        {
+            c = &cells[pos%pipe_max_size];
+            turn = pos/pipe_max_size;
+            const uint64 state = c->seq.load(std::memory_order_acquire)&~uint64(1);
+            if (state == 4*turn)
+            {
+                if (concurrency == PIPE_SPSC)
+                {
+                    enqueue_pos.store(pos+1, std::memory_order_relaxed);
+                    break;
+                }
+                if (enqueue_pos.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (state < 4*turn)
+            {
+                // The cell still holds the item from the last trip around the ring, so
+                // the pipe is full.
+                return false;
+            }
+            else
+            {
+                // another producer beat us to this cell
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        exchange(item, c->item);
+        update_cell(*c, 4*turn+2, m_is_locked);
+        return true;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T,
+        pipe_concurrency concurrency
+        >
+    bool lock_free_pipe<T,concurrency>::
+    try_dequeue (
+        T& item,
+        bool m_is_locked
+    )
+    {
+        uint64 pos = dequeue_pos.load(std::memory_order_relaxed);
+        cell* c;
+        uint64 turn;
+        while (true)
+        {
+            c = &cells[pos%pipe_max_size];
+            turn = pos/pipe_max_size;
+            const uint64 state = c->seq.load(std::memory_order_acquire)&~uint64(1);
+            if (state == 4*turn+2)
+            {
+                if (concurrency == PIPE_SPSC)
+                {
+                    dequeue_pos.store(pos+1, std::memory_order_relaxed);
+                    break;
+                }
+                if (dequeue_pos.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (state < 4*turn+2)
+            {
+                // nothing has been written into this cell yet, so the pipe is empty
+                return false;
+            }
+            else
+            {
+                // another consumer beat us to this cell
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        exchange(item, c->item);
+        update_cell(*c, 4*turn+4, m_is_locked);
+        return true;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T,
+        pipe_concurrency concurrency
+        >
+    void lock_free_pipe<T,concurrency>::
+    update_cell (
+        cell& c,
+        uint64 seq,
+        bool m_is_locked
+    )
+    {
+        if (c.seq.exchange(seq, std::memory_order_acq_rel)&1)
+        {
+            if (m_is_locked)
+            {
+                changed.notify_all();
+            }
+            else
+            {
+                std::lock_guard<std::mutex> lock(m);
+                changed.notify_all();
+            }
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T,
+        pipe_concurrency concurrency
+        >
+    bool lock_free_pipe<T,concurrency>::
+    mark_cell (
+        cell& c,
+        uint64 seen
+    ) const
+    {
+        seen &= ~uint64(1);
+        uint64 expected = seen;
+        if (c.seq.compare_exchange_strong(expected, seen|1, std::memory_order_acq_rel))
+            return true;
+        // someone else may have marked it already
+        return expected == (seen|1);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T,
+        pipe_concurrency concurrency
+        >
+    bool lock_free_pipe<T,concurrency>::
+    wait_for_change (
+        std::unique_lock<std::mutex>& lock,
+        bool use_timeout,
+        const std::chrono::steady_clock::time_point& deadline
+    ) const
+    {
+        if (!use_timeout)
+        {
+            changed.wait(lock);
+            return true;
+        }
+        return changed.wait_until(lock, deadline) == std::cv_status::no_timeout;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T,
+        pipe_concurrency concurrency
+        >
+    bool lock_free_pipe<T,concurrency>::
+    mark_last_item (
+    ) const
+    {
+        const uint64 pos = enqueue_pos.load(std::memory_order_acquire)-1;
+        cell& c = cells[pos%pipe_max_size];
+        const uint64 turn = pos/pipe_max_size;
+        const uint64 seen = c.seq.load(std::memory_order_acquire);
+        // if the item was already dequeued then there is nothing to wait for
+        if ((seen&~uint64(1)) > 4*turn+2)
+            return false;
+        return mark_cell(c, seen);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T,
+        pipe_concurrency concurrency
+        >
+    bool lock_free_pipe<T,concurrency>::
+    enqueue_slow (
+        T& item,
+        bool use_timeout,
+        unsigned long timeout
+    )
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+        std::unique_lock<std::mutex> lock(m);
+        ++enqueue_waiters;
+
+        bool added = false;
+        while (enabled && enqueue_enabled)
+        {
+            if (try_enqueue(item, true))
+            {
+                added = true;
+                break;
+            }
+
+            // Wait for the cell we want to write into to be freed.  If it already was,
+            // or enqueue_pos moved on since we looked at it, just try again.
+            const uint64 pos = enqueue_pos.load(std::memory_order_relaxed);
+            cell& c = cells[pos%pipe_max_size];
+            const uint64 seen = c.seq.load(std::memory_order_acquire);
+            if ((seen&~uint64(1)) >= 4*(pos/pipe_max_size) || !mark_cell(c, seen))
+                continue;
+
+            if (!wait_for_change(lock, use_timeout, deadline))
+                break;
+        }
+
+        --enqueue_waiters;
+        // let the destructor know we are unblocking
+        if (!enabled)
+            changed.notify_all();
+        return added;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T,
+        pipe_concurrency concurrency
+        >
+    bool lock_free_pipe<T,concurrency>::
+    dequeue_slow (
+        T& item,
+        bool use_timeout,
+        unsigned long timeout
+    )
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+        std::unique_lock<std::mutex> lock(m);
+        ++dequeue_waiters;
+
+        // notify wait_for_num_blocked_dequeues()
+        if (state_waiters > 0)
+            changed.notify_all();
+
+        bool removed = false;
+        while (enabled && dequeue_enabled)
+        {
+            if (try_dequeue(item, true))
+            {
+                removed = true;
+                break;
+            }
+
+            // Wait for something to be written into the cell we want to read from.  If
+            // it already was, or dequeue_pos moved on since we looked at it, just try
+            // again.
+            const uint64 pos = dequeue_pos.load(std::memory_order_relaxed);
+            cell& c = cells[pos%pipe_max_size];
+            const uint64 seen = c.seq.load(std::memory_order_acquire);
+            if ((seen&~uint64(1)) >= 4*(pos/pipe_max_size)+2 || !mark_cell(c, seen))
+                continue;
+
+            if (!wait_for_change(lock, use_timeout, deadline))
+                break;
+        }
+
+        --dequeue_waiters;
+        // let the destructor know we are unblocking
+        if (!enabled)
+            changed.notify_all();
+        return removed;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T,
+        pipe_concurrency concurrency
+        >
+    bool lock_free_pipe<T,concurrency>::
+    enqueue (
+        T& item
+    )
+    {
+        if (!enabled || !enqueue_enabled)
+            return false;
+
+        return try_enqueue(item, false) || enqueue_slow(item, false, 0);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T,
+        pipe_concurrency concurrency
+        >
+    bool lock_free_pipe<T,concurrency>::
+    enqueue_or_timeout (
+        T& item,
+        unsigned long timeout
+    )
+    {
+        if (!enabled || !enqueue_enabled)
+            return false;
+
+        return try_enqueue(item, false) || (timeout != 0 && enqueue_slow(item, true, timeout));
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T,
+        pipe_concurrency concurrency
+        >
+    bool lock_free_pipe<T,concurrency>::
+    dequeue (
+        T& item
+    )
+    {
+        if (!enabled || !dequeue_enabled)
+            return false;
+
+        return try_dequeue(item, false) || dequeue_slow(item, false, 0);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T,
+        pipe_concurrency concurrency
+        >
+    bool lock_free_pipe<T,concurrency>::
+    dequeue_or_timeout (
+        T& item,
+        unsigned long timeout
+    )
+    {
+        if (!enabled || !dequeue_enabled)
+            return false;
+
+        return try_dequeue(item, false) || (timeout != 0 && dequeue_slow(item, true, timeout));
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T,
+        pipe_concurrency concurrency
+        >
+    void lock_free_pipe<T,concurrency>::
+    empty (
+    )
+    {
+        T temp;
+        while (try_dequeue(temp, false)) {}
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T,
+        pipe_concurrency concurrency
+        >
+    void lock_free_pipe<T,concurrency>::
+    wait_until_empty (
+    ) const
+    {
+        std::unique_lock<std::mutex> lock(m);
+        ++state_waiters;
+
+        while (size() > 0 && enabled && dequeue_enabled)
+        {
+            if (mark_last_item())
+                changed.wait(lock);
+        }
+
+        --state_waiters;
+        // let the destructor know we are ending if it is blocked waiting
+        if (!enabled)
+            changed.notify_all();
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T,
+        pipe_concurrency concurrency
+        >
+    void lock_free_pipe<T,concurrency>::
+    wait_for_num_blocked_dequeues (
+        unsigned long num
+    ) const
+    {
+        std::unique_lock<std::mutex> lock(m);
+        ++state_waiters;
+
+        while ((dequeue_waiters < num || size() != 0) && enabled && dequeue_enabled)
+        {
+            // Blocking dequeues wake us up when they start.  We need to mark the pipe's
+            // last item to hear about it being taken out.
+            if (size() == 0 || mark_last_item())
+                changed.wait(lock);
+        }
+
+        --state_waiters;
+        // let the destructor know we are ending if it is blocked waiting
+        if (!enabled)
+            changed.notify_all();
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T,
+        pipe_concurrency concurrency
+        >
+    void lock_free_pipe<T,concurrency>::
+    enable (
+    )
+    {
+        std::lock_guard<std::mutex> lock(m);
+        enabled = true;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T,
+        pipe_concurrency concurrency
+        >
+    void lock_free_pipe<T,concurrency>::
+    disable (
+    )
+    {
+        std::lock_guard<std::mutex> lock(m);
+        enabled = false;
+        changed.notify_all();
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T,
+        pipe_concurrency concurrency
+        >
+    void lock_free_pipe<T,concurrency>::
+    disable_enqueue (
+    )
+    {
+        std::lock_guard<std::mutex> lock(m);
+        enqueue_enabled = false;
+        changed.notify_all();
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T,
+        pipe_concurrency concurrency
+        >
+    void lock_free_pipe<T,concurrency>::
+    disable_dequeue (
+    )
+    {
+        std::lock_guard<std::mutex> lock(m);
+        dequeue_enabled = false;
+        changed.notify_all();
+    }
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_LOCK_FREE_PIPe_H_
+
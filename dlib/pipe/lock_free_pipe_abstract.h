@@ -0,0 +1,186 @@
+// Copyright (C) 2026  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#undef DLIB_LOCK_FREE_PIPe_ABSTRACT_H_
+#ifdef DLIB_LOCK_FREE_PIPe_ABSTRACT_H_
+
+#include "pipe_kernel_abstract.h"
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    enum pipe_concurrency
+    {
+        PIPE_SPSC, // Exactly one thread enqueues and exactly one thread dequeues.
+        PIPE_MPMC  // Any number of threads enqueue and dequeue.
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T,
+        pipe_concurrency concurrency = PIPE_MPMC
+        >
+    class lock_free_pipe
+    {
+        /*!
+            REQUIREMENTS ON T
+                T must be swappable by a global swap()
+                T must have a default constructor
+
+            INITIAL VALUE
+                size() == 0
+                is_enabled() == true
+                is_enqueue_enabled() == true
+                is_dequeue_enabled() == true
+
+            WHAT THIS OBJECT REPRESENTS
+                This is a first in first out queue with a fixed maximum size containing
+                items of type T.  It has the same interface and behavior as dlib::pipe,
+                so it can be used in place of it, except that max_size() must be greater
+                than 0.  That is, lock_free_pipe can't be used to hand items directly from
+                one thread to another.
+
+                The difference is in how it's implemented.  dlib::pipe does every
+                operation while holding a mutex.  lock_free_pipe is a ring buffer whose
+                enqueue() and dequeue() calls don't take any lock when the pipe is
+                neither full nor empty, i.e. when they don't have to block.  A thread
+                only locks a mutex to wait when the pipe is full or empty, or to wake
+                up such a thread.  So it is a lot faster for pipelines that move many
+                small items between threads.
+
+                If concurrency == PIPE_SPSC then the pipe is optimized for the case of
+                one producer thread and one consumer thread and doesn't use any atomic
+                read-modify-write operations on its fast paths.  In this case you must not
+                call enqueue(), enqueue_or_timeout() or empty() from more than one thread
+                at a time, nor dequeue(), dequeue_or_timeout() or empty() from more than
+                one thread at a time.
+
+            THREAD SAFETY
+                If concurrency == PIPE_MPMC then all methods of this class are thread
+                safe.  You may call them from any thread and any number of threads may
+                call them at once.  With PIPE_SPSC the restrictions described above apply
+                to the enqueue and dequeue functions.  All the other methods are thread
+                safe.
+        !*/
+
+    public:
+
+        typedef T type;
+
+        explicit lock_free_pipe (
+            size_t maximum_size
+        );
+        /*!
+            requires
+                - maximum_size > 0
+            ensures
+                - #*this is properly initialized
+                - #max_size() == maximum_size
+            throws
+                - std::bad_alloc
+        !*/
+
+        virtual ~lock_free_pipe (
+        );
+        /*!
+            ensures
+                - any resources associated with *this have been released
+                - disables (i.e. sets is_enabled() == false) this object so that
+                  all calls currently blocking on it will return immediately.
+        !*/
+
+        // All the following functions behave exactly as they do in dlib::pipe.  See
+        // pipe_kernel_abstract.h for their documentation.
+
+        void enable (
+        );
+
+        void disable (
+        );
+
+        bool is_enabled (
+        ) const;
+
+        void empty (
+        );
+        /*!
+            ensures
+                - removes all the items that are in the pipe when empty() looks at them.
+                  Items another thread enqueues at the same time may or may not be
+                  removed.
+        !*/
+
+        void wait_until_empty (
+        ) const;
+
+        void wait_for_num_blocked_dequeues (
+           unsigned long num
+        ) const;
+
+        bool is_enqueue_enabled (
+        ) const;
+
+        void disable_enqueue (
+        );
+
+        void enable_enqueue (
+        );
+
+        bool is_dequeue_enabled (
+        ) const;
+
+        void disable_dequeue (
+        );
+
+        void enable_dequeue (
+        );
+
+        size_t max_size (
+        ) const;
+
+        size_t size (
+        ) const;
+
+        bool enqueue (
+            T& item
+        );
+
+        bool enqueue (
+            T&& item
+        );
+
+        bool enqueue_or_timeout (
+            T& item,
+            unsigned long timeout
+        );
+
+        bool enqueue_or_timeout (
+            T&& item,
+            unsigned long timeout
+        );
+
+        bool dequeue (
+            T& item
+        );
+
+        bool dequeue_or_timeout (
+            T& item,
+            unsigned long timeout
+        );
+
+    private:
+
+        // restricted functions
+        lock_free_pipe(const lock_free_pipe&);        // copy constructor
+        lock_free_pipe& operator=(const lock_free_pipe&);    // assignment operator
+
+    };
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_LOCK_FREE_PIPe_ABSTRACT_H_
+
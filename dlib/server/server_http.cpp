@@ -4,6 +4,10 @@
 #define DLIB_SERVER_HTTP_CPp_
 
 #include "server_http.h"
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+#include <vector>
 
 namespace dlib
 {
@@ -149,6 +153,423 @@ namespace dlib
                     in.get();
             }
         }
+
+        bool header_has_token (
+            const std::string& value,
+            const std::string& token
+        )
+        /*!
+            ensures
+                - returns true if the comma separated list of tokens in value, e.g. the
+                  value of a Connection or Transfer-Encoding header, contains token.
+                  The comparison is case insensitive.
+        !*/
+        {
+            const std::vector<std::string> tokens = split(value, ",");
+            for (unsigned long i = 0; i < tokens.size(); ++i)
+            {
+                if (strings_equal_ignore_case(trim(tokens[i]), token))
+                    return true;
+            }
+            return false;
+        }
+
+        bool is_http_1_1 (
+            const incoming_things& incoming
+        )
+        /*!
+            ensures
+                - returns true if the request came from a client that speaks HTTP/1.1 or
+                  a later HTTP/1.x version, and therefore understands persistent
+                  connections and chunked responses by default.
+        !*/
+        {
+            const std::string& p = incoming.protocol;
+            return p.size() >= 8 && p.compare(0, 7, "HTTP/1.") == 0 && p[7] != '0';
+        }
+
+        void write_http_header (
+            std::ostream& out,
+            outgoing_things& outgoing
+        )
+        /*!
+            ensures
+                - writes the status line, headers and cookies of an HTTP response to out,
+                  followed by the blank line that ends the header.
+                - adds a default Content-Type and turns responses with a Location header
+                  into redirects.
+        !*/
+        {
+            key_value_map& new_cookies      = outgoing.cookies;
+            key_value_map_ci& response_headers = outgoing.headers;
+
+            // only send this header if the user hasn't told us to send another kind
+            bool has_content_type = false, has_location = false;
+            for(key_value_map_ci::const_iterator ci = response_headers.begin(); ci != response_headers.end(); ++ci )
+            {
+                if ( !has_content_type && strings_equal_ignore_case(ci->first , "content-type") )
+                {
+                    has_content_type = true;
+                }
+                else if ( !has_location && strings_equal_ignore_case(ci->first , "location") )
+                {
+                    has_location = true;
+                }
+            }
+
+            if ( has_location )
+            {
+                outgoing.http_return = 302;
+            }
+
+            if ( !has_content_type )
+            {
+                response_headers["Content-Type"] = "text/html";
+            }
+
+            out << "HTTP/1.1 " << outgoing.http_return << " " << outgoing.http_return_status << "\r\n";
+
+            // Set any new headers
+            for(key_value_map_ci::const_iterator ci = response_headers.begin(); ci != response_headers.end(); ++ci )
+            {
+                out << ci->first << ": " << ci->second << "\r\n";
+            }
+
+            // set any cookies 
+            for(key_value_map::const_iterator ci = new_cookies.begin(); ci != new_cookies.end(); ++ci )
+            {
+                out << "Set-Cookie: " << urlencode(ci->first) << '=' << urlencode(ci->second) << "\r\n";
+            }
+            out << "\r\n";
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        class request_body_streambuf : public std::streambuf
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    This is the streambuf behind the request_body stream given to
+                    server_http::on_streaming_request().  It reads the body of the current
+                    request out of the connection's input stream, either the number of
+                    bytes given by the Content-Length header or the chunks of a request
+                    sent with Transfer-Encoding: chunked, and stops at the end of the body
+                    so the next request on the connection is left untouched.
+
+                CONVENTION
+                    - prefix == the part of the body parse_http_request() already read.
+                      It is handed out before anything else.
+                    - if (chunked) then
+                        - left == the number of bytes left in the current chunk
+                    - else
+                        - left == the number of body bytes still in the input stream
+                    - total == the number of body bytes announced so far.  It never
+                      exceeds max_length.
+                    - done == true once the whole body has been read.
+            !*/
+        public:
+            request_body_streambuf (
+                std::istream& in_,
+                std::ostream& out_
+            ) : in(in_), out(out_), buffer(8*1024)
+            {
+                reset();
+            }
+
+            void reset (
+                const std::string& prefix_ = std::string(),
+                unsigned long content_length = 0,
+                bool chunked_ = false,
+                unsigned long max_length_ = 0,
+                bool send_continue_ = false
+            )
+            {
+                prefix = prefix_.size() != 0 ? &prefix_ : nullptr;
+                chunked = chunked_;
+                max_length = max_length_;
+                send_continue = send_continue_;
+                left = chunked ? 0 : content_length - std::min<unsigned long>(content_length, prefix_.size());
+                total = chunked ? 0 : content_length;
+                first_chunk = true;
+                done = !chunked && left == 0;
+                setg(buffer.data(), buffer.data(), buffer.data());
+            }
+
+            bool at_end (
+            ) const { return done && gptr() == egptr(); }
+
+            void drain (
+            )
+            {
+                while (!at_end())
+                {
+                    setg(buffer.data(), buffer.data(), buffer.data());
+                    underflow();
+                }
+            }
+
+        private:
+
+            int_type underflow (
+            )
+            {
+                if (gptr() < egptr())
+                    return traits_type::to_int_type(*gptr());
+
+                if (prefix)
+                {
+                    char* p = const_cast<char*>(prefix->data());
+                    setg(p, p, p + prefix->size());
+                    prefix = nullptr;
+                    return traits_type::to_int_type(*gptr());
+                }
+
+                if (done)
+                    return traits_type::eof();
+
+                // The client asked us to say when it may send the body, and we only do
+                // so once someone actually wants to read it.
+                if (send_continue)
+                {
+                    send_continue = false;
+                    out << "HTTP/1.1 100 Continue\r\n\r\n";
+                    out.flush();
+                }
+
+                if (chunked && left == 0)
+                {
+                    if (!first_chunk)
+                        read_line();
+                    first_chunk = false;
+
+                    left = parse_chunk_size(read_line());
+                    if (left == 0)
+                    {
+                        // skip any trailer headers
+                        while (trim(read_line()).size() != 0) {}
+                        done = true;
+                        return traits_type::eof();
+                    }
+                }
+
+                const std::streamsize num = static_cast<std::streamsize>(std::min<uint64>(left, buffer.size()));
+                const std::streamsize got = in.rdbuf()->sgetn(buffer.data(), num);
+                if (got <= 0)
+                    throw http_parse_error("Connection ended in the middle of the request body", 400);
+
+                left -= got;
+                if (!chunked && left == 0)
+                    done = true;
+
+                setg(buffer.data(), buffer.data(), buffer.data() + got);
+                return traits_type::to_int_type(*gptr());
+            }
+
+            std::string read_line (
+            )
+            {
+                std::string line;
+                read_with_limit(in, line);
+                return line;
+            }
+
+            uint64 parse_chunk_size (
+                const std::string& line
+            )
+            {
+                // the size may be followed by chunk extensions, which we ignore
+                uint64 size = 0;
+                unsigned long i = 0;
+                for (; i < line.size() && std::isxdigit(static_cast<unsigned char>(line[i])); ++i)
+                {
+                    size = size*16 + from_hex(line[i]);
+                    if (total + size > max_length)
+                    {
+                        std::ostringstream sout;
+                        sout << "Chunked post back is too large.  It must be less than " << max_length;
+                        throw http_parse_error(sout.str(), 413);
+                    }
+                }
+                if (i == 0)
+                    throw http_parse_error("Invalid chunk size of '" + trim(line) + "'", 400);
+
+                total += size;
+                return size;
+            }
+
+            std::istream& in;
+            std::ostream& out;
+            std::vector<char> buffer;
+            const std::string* prefix;
+            bool chunked;
+            bool send_continue;
+            bool first_chunk;
+            bool done;
+            uint64 left;
+            uint64 total;
+            uint64 max_length;
+        };
+
+    // ------------------------------------------------------------------------------------
+
+        class response_body_streambuf : public std::streambuf
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    This is the streambuf behind the response_body stream given to
+                    server_http::on_streaming_request().  It holds back the HTTP header
+                    until the handler is done or the buffer fills up, so that the handler
+                    can set outgoing headers, cookies and status codes before writing, and
+                    so small responses get a Content-Length.  Responses that don't fit in
+                    the buffer are sent with Transfer-Encoding: chunked, or, for clients
+                    that don't understand it, without a length by closing the connection
+                    after them.  A Content-Length header set by the handler is sent as is
+                    and the body is written unframed.
+            !*/
+        public:
+            response_body_streambuf (
+                std::ostream& out_
+            ) : out(out_), buffer(16*1024)
+            {
+                reset(nullptr, false, false, false);
+            }
+
+            void reset (
+                outgoing_things* outgoing_,
+                bool allow_chunked_,
+                bool head_request_,
+                bool keep_alive_
+            )
+            {
+                outgoing = outgoing_;
+                allow_chunked = allow_chunked_;
+                head_request = head_request_;
+                keep_alive = keep_alive_;
+                sent_header = false;
+                chunked = false;
+                declared_length = -1;
+                bytes_sent = 0;
+                setp(buffer.data(), buffer.data() + buffer.size() - 1);
+            }
+
+            bool header_sent (
+            ) const { return sent_header; }
+
+            bool keeps_alive (
+            ) const { return keep_alive; }
+
+            void finish (
+            )
+            {
+                send(true);
+                if (declared_length >= 0 && bytes_sent != declared_length)
+                {
+                    // The handler didn't write as many bytes as it said it would, so the
+                    // client can't find where the next response starts.
+                    keep_alive = false;
+                }
+            }
+
+        private:
+
+            int_type overflow (
+                int_type c
+            )
+            {
+                if (!traits_type::eq_int_type(c, traits_type::eof()))
+                {
+                    *pptr() = traits_type::to_char_type(c);
+                    pbump(1);
+                }
+                send(false);
+                return out ? traits_type::not_eof(c) : traits_type::eof();
+            }
+
+            int sync (
+            )
+            {
+                send(false);
+                out.flush();
+                return out ? 0 : -1;
+            }
+
+            void send (
+                bool last
+            )
+            {
+                const std::streamsize num = pptr() - pbase();
+                if (!sent_header)
+                    write_header(last, num);
+
+                if (!head_request)
+                {
+                    if (chunked)
+                    {
+                        if (num != 0)
+                        {
+                            char size[20];
+                            std::snprintf(size, sizeof(size), "%lx\r\n", static_cast<unsigned long>(num));
+                            out << size;
+                            out.write(pbase(), num);
+                            out << "\r\n";
+                        }
+                        if (last)
+                            out << "0\r\n\r\n";
+                    }
+                    else
+                    {
+                        out.write(pbase(), num);
+                    }
+                }
+
+                bytes_sent += num;
+                setp(buffer.data(), buffer.data() + buffer.size() - 1);
+            }
+
+            void write_header (
+                bool last,
+                std::streamsize num
+            )
+            {
+                key_value_map_ci& headers = outgoing->headers;
+                if (headers.count("Content-Length") != 0)
+                {
+                    declared_length = string_cast<std::streamsize>(trim(headers["Content-Length"]));
+                }
+                else if (last)
+                {
+                    headers["Content-Length"] = cast_to_string(num);
+                }
+                else if (allow_chunked)
+                {
+                    headers["Transfer-Encoding"] = "chunked";
+                    chunked = true;
+                }
+                else
+                {
+                    // The end of this response is marked by closing the connection.
+                    keep_alive = false;
+                }
+
+                if (header_has_token(headers["Connection"], "close"))
+                    keep_alive = false;
+                headers["Connection"] = keep_alive ? "keep-alive" : "close";
+
+                write_http_header(out, *outgoing);
+                sent_header = true;
+            }
+
+            std::ostream& out;
+            std::vector<char> buffer;
+            outgoing_things* outgoing;
+            bool allow_chunked;
+            bool head_request;
+            bool keep_alive;
+            bool sent_header;
+            bool chunked;
+            std::streamsize declared_length;
+            std::streamsize bytes_sent;
+        };
     }
 
 // ----------------------------------------------------------------------------------------
@@ -325,50 +746,9 @@ namespace dlib
         const std::string& result
     )
     {
-        using namespace http_impl;
-        key_value_map& new_cookies      = outgoing.cookies;
-        key_value_map_ci& response_headers = outgoing.headers;
-
-        // only send this header if the user hasn't told us to send another kind
-        bool has_content_type = false, has_location = false;
-        for(key_value_map_ci::const_iterator ci = response_headers.begin(); ci != response_headers.end(); ++ci )
-        {
-            if ( !has_content_type && strings_equal_ignore_case(ci->first , "content-type") )
-            {
-                has_content_type = true;
-            }
-            else if ( !has_location && strings_equal_ignore_case(ci->first , "location") )
-            {
-                has_location = true;
-            }
-        }
-
-        if ( has_location )
-        {
-            outgoing.http_return = 302;
-        }
-
-        if ( !has_content_type )
-        {
-            response_headers["Content-Type"] = "text/html";
-        }
-
-        response_headers["Content-Length"] = cast_to_string(result.size());
-
-        out << "HTTP/1.0 " << outgoing.http_return << " " << outgoing.http_return_status << "\r\n";
-
-        // Set any new headers
-        for(key_value_map_ci::const_iterator ci = response_headers.begin(); ci != response_headers.end(); ++ci )
-        {
-            out << ci->first << ": " << ci->second << "\r\n";
-        }
-
-        // set any cookies 
-        for(key_value_map::const_iterator ci = new_cookies.begin(); ci != new_cookies.end(); ++ci )
-        {
-            out << "Set-Cookie: " << urlencode(ci->first) << '=' << urlencode(ci->second) << "\r\n";
-        }
-        out << "\r\n" << result;
+        outgoing.headers["Content-Length"] = cast_to_string(result.size());
+        http_impl::write_http_header(out, outgoing);
+        out << result;
     }
 
 // ----------------------------------------------------------------------------------------
@@ -381,6 +761,8 @@ namespace dlib
         outgoing_things outgoing;
         outgoing.http_return = e.http_error_code;
         outgoing.http_return_status = e.what();
+        // after an error we don't know where the next request starts
+        outgoing.headers["Connection"] = "close";
         write_http_response(out, outgoing, std::string("Error processing request: ") + e.what());
     }
 
@@ -394,9 +776,231 @@ namespace dlib
         outgoing_things outgoing;
         outgoing.http_return = 500;
         outgoing.http_return_status = e.what();
+        outgoing.headers["Connection"] = "close";
         write_http_response(out, outgoing, std::string("Error processing request: ") + e.what());
     }
 
+// ----------------------------------------------------------------------------------------
+
+    const std::string server_http::
+    on_request (
+        const incoming_things& ,
+        outgoing_things& 
+    )
+    {
+        throw http_parse_error("This server doesn't handle any requests", 501);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void server_http::
+    on_streaming_request (
+        const incoming_things& incoming,
+        std::istream& request_body,
+        outgoing_things& outgoing,
+        std::ostream& response_body
+    )
+    {
+        using namespace http_impl;
+        incoming_things req(incoming);
+        const bool already_parsed = req.body.size() != 0;
+        req.body.assign(std::istreambuf_iterator<char>(request_body), std::istreambuf_iterator<char>());
+
+        // parse_http_request() only picks out the queries of form posts that come with a
+        // Content-Length, so do it here for chunked ones.
+        if (!already_parsed && 
+            (strings_equal_ignore_case(req.request_type, "POST") || 
+             strings_equal_ignore_case(req.request_type, "PUT")) && 
+            strings_equal_ignore_case(left_substr(req.content_type,";"), "application/x-www-form-urlencoded"))
+        {
+            parse_url(req.body, req.queries);
+        }
+
+        const std::string result = on_request(req, outgoing);
+        outgoing.headers["Content-Length"] = cast_to_string(result.size());
+        response_body.write(result.data(), result.size());
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void server_http::
+    on_connect (
+        std::istream& in,
+        std::ostream& out,
+        const std::string& foreign_ip,
+        const std::string& local_ip,
+        unsigned short foreign_port,
+        unsigned short local_port,
+        uint64
+    )
+    {
+        handle_requests(in, out, foreign_ip, local_ip, foreign_port, local_port, false);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    bool server_http::
+    on_connection_ready (
+        connection& con
+    )
+    {
+        // A kept alive connection is parked between requests rather than holding a
+        // worker thread.  parked_connections holds the ones that have been parked before.
+        try
+        {
+            bool parked_before;
+            {
+                auto_mutex lock(http_class_mutex);
+                parked_before = !parked_connections.insert(&con).second;
+            }
+
+            sockstreambuf buf(&con);
+            const long num = buf.wait_for_data(0);
+            if (num == TIMEOUT)
+            {
+                // Either a new connection that hasn't sent anything yet, or one that was
+                // parked and has been idle for the whole keep-alive timeout.
+                return !parked_before;
+            }
+            if (num <= 0)
+                return false;
+
+            std::istream in(&buf);
+            std::ostream out(&buf);
+            return handle_requests(in, out, con.get_foreign_ip(), con.get_local_ip(),
+                                   con.get_foreign_port(), con.get_local_port(), true);
+        }
+        catch (std::exception& e)
+        {
+            dlog << LERROR << "Error servicing a connection: " << e.what();
+            return false;
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void server_http::
+    on_connection_closed (
+        connection& con
+    )
+    {
+        auto_mutex lock(http_class_mutex);
+        parked_connections.erase(&con);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    bool server_http::
+    handle_requests (
+        std::istream& in,
+        std::ostream& out,
+        const std::string& foreign_ip,
+        const std::string& local_ip,
+        unsigned short foreign_port,
+        unsigned short local_port,
+        bool park_when_idle
+    )
+    {
+        using namespace http_impl;
+
+        // We flush the responses ourselves, once there are no more pipelined requests
+        // waiting, rather than before every read.
+        in.tie(nullptr);
+        sockstreambuf* buf = dynamic_cast<sockstreambuf*>(in.rdbuf());
+
+        request_body_streambuf request_buf(in, out);
+        response_body_streambuf response_buf(out);
+        std::istream request_body(&request_buf);
+        std::ostream response_body(&response_buf);
+        // Let errors in the request body, like a post back that is too large, escape
+        // from the handler rather than just look like the end of the body.
+        request_body.exceptions(std::ios::badbit);
+
+        bool keep_alive = true;
+        while (keep_alive)
+        {
+            incoming_things incoming(foreign_ip, local_ip, foreign_port, local_port);
+            outgoing_things outgoing;
+            try
+            {
+                const unsigned long max_length = get_max_content_length();
+                const unsigned long content_length = parse_http_request(in, incoming, max_length);
+
+                const key_value_map_ci& headers = incoming.headers;
+                const bool chunked = header_has_token(headers["Transfer-Encoding"], "chunked");
+                if (headers.count("Transfer-Encoding") != 0)
+                {
+                    if (!chunked)
+                        throw http_parse_error("Unsupported Transfer-Encoding of '" + headers["Transfer-Encoding"] + "'", 501);
+                    if (headers.count("Content-Length") != 0)
+                        throw http_parse_error("Request has both a Content-Length and a Transfer-Encoding", 400);
+                }
+
+                const bool http_1_1 = is_http_1_1(incoming);
+                const std::string& connection = headers["Connection"];
+                keep_alive = get_keep_alive_timeout() != 0 && !header_has_token(connection, "close") &&
+                             (http_1_1 || header_has_token(connection, "keep-alive"));
+                const bool send_continue = http_1_1 && 
+                    strings_equal_ignore_case(trim(headers["Expect"]), "100-continue") &&
+                    (chunked || content_length > incoming.body.size());
+
+                request_buf.reset(incoming.body, content_length, chunked, max_length, send_continue);
+                request_body.clear();
+                response_buf.reset(&outgoing, http_1_1, strings_equal_ignore_case(incoming.request_type, "HEAD"), keep_alive);
+                response_body.clear();
+
+                on_streaming_request(incoming, request_body, outgoing, response_body);
+                response_buf.finish();
+                keep_alive = response_buf.keeps_alive() && out;
+
+                // Skip any part of the body the handler didn't read so the next request
+                // starts in the right place.
+                if (keep_alive)
+                    request_buf.drain();
+            }
+            catch (http_parse_error& e)
+            {
+                dlog << LERROR << "Error processing request from: " << foreign_ip << " - " << e.what();
+                if (!response_buf.header_sent())
+                    write_http_response(out, e);
+                return false;
+            }
+            catch (std::exception& e)
+            {
+                dlog << LERROR << "Error processing request from: " << foreign_ip << " - " << e.what();
+                if (!response_buf.header_sent())
+                    write_http_response(out, e);
+                return false;
+            }
+
+            if (!keep_alive)
+                return false;
+
+            // If the client already sent its next request then just go handle it.
+            // Otherwise send what we have and wait for the client, but not forever.
+            if (in.rdbuf()->in_avail() <= 0)
+            {
+                if (!out.flush())
+                    return false;
+
+                // The server waits for the next request without tying up this thread.
+                if (park_when_idle)
+                    return true;
+
+                if (buf)
+                {
+                    if (buf->wait_for_data(get_keep_alive_timeout()) <= 0)
+                        return false;
+                }
+                else if (in.peek() == EOF)
+                {
+                    return false;
+                }
+            }
+        }
+        return false;
+    }
+
 // ----------------------------------------------------------------------------------------
 
     const logger server_http::dlog("dlib.server_http");
@@ -10,6 +10,7 @@
 #include <string>
 #include <cctype>
 #include <map>
+#include <unordered_set>
 #include "../logger.h"
 #include "../string.h"
 #include "server_iostream.h"
@@ -168,6 +169,7 @@ namespace dlib
         server_http()
         {
             max_content_length = 10*1024*1024; // 10MB
+            keep_alive_timeout = 10000; // 10 seconds
         }
 
         unsigned long get_max_content_length (
@@ -185,13 +187,42 @@ namespace dlib
             max_content_length = max_length;
         }
 
+        unsigned long get_keep_alive_timeout (
+        ) const 
+        { 
+            auto_mutex lock(http_class_mutex);
+            return keep_alive_timeout; 
+        }
+
+        void set_keep_alive_timeout (
+            unsigned long milliseconds
+        )
+        {
+            // make sure requires clause is not broken
+            DLIB_ASSERT(milliseconds < 2000000,
+                "\tvoid server_http::set_keep_alive_timeout()"
+                << "\n\t invalid arguments were given to this function"
+                << "\n\t milliseconds: " << milliseconds
+                << "\n\t this:         " << this
+            );
+
+            auto_mutex lock(http_class_mutex);
+            keep_alive_timeout = milliseconds;
+        }
+
 
     private:
         virtual const std::string on_request (
             const incoming_things& incoming,
             outgoing_things& outgoing
-        ) = 0;
+        );
 
+        virtual void on_streaming_request (
+            const incoming_things& incoming,
+            std::istream& request_body,
+            outgoing_things& outgoing,
+            std::ostream& response_body
+        );
       
         virtual void on_connect (
             std::istream& in,
@@ -201,32 +232,43 @@ namespace dlib
             unsigned short foreign_port,
             unsigned short local_port,
             uint64
-        )
-        {
-            try
-            {
-                incoming_things incoming(foreign_ip, local_ip, foreign_port, local_port);
-                outgoing_things outgoing;
+        );
 
-                parse_http_request(in, incoming, get_max_content_length());
-                read_body(in, incoming);
-                const std::string& result = on_request(incoming, outgoing);
-                write_http_response(out, outgoing, result);
-            }
-            catch (http_parse_error& e)
-            {
-                dlog << LERROR << "Error processing request from: " << foreign_ip << " - " << e.what();
-                write_http_response(out, e);
-            }
-            catch (std::exception& e)
-            {
-                dlog << LERROR << "Error processing request from: " << foreign_ip << " - " << e.what();
-                write_http_response(out, e);
-            }
-        }
+        virtual bool on_connection_ready (
+            connection& con
+        );
+
+        virtual unsigned long get_parked_connection_timeout (
+        ) const { return get_keep_alive_timeout(); }
+
+        virtual void on_connection_closed (
+            connection& con
+        );
+
+        bool handle_requests (
+            std::istream& in,
+            std::ostream& out,
+            const std::string& foreign_ip,
+            const std::string& local_ip,
+            unsigned short foreign_port,
+            unsigned short local_port,
+            bool park_when_idle
+        );
+        /*!
+            ensures
+                - handles the requests that arrive on in until the connection should be
+                  closed, and then returns false.
+                - if (park_when_idle) then
+                    - returns true instead of waiting for the next request of a kept
+                      alive connection.  All the responses have been flushed by then
+                      and in has nothing buffered.
+        !*/
 
         mutex http_class_mutex;
         unsigned long max_content_length;
+        unsigned long keep_alive_timeout;
+        // the connections on_connection_ready() has parked at least once
+        std::unordered_set<const connection*> parked_connections;
         const static logger dlog;
     };
 
@@ -194,9 +194,10 @@ namespace dlib
     );
     /*!
         ensures
-            - Writes an HTTP response, defined by the data in outgoing, to the given output
-              stream.
-            - The result variable is written out as the content of the response.
+            - Writes an HTTP/1.1 response, defined by the data in outgoing, to the given
+              output stream.
+            - The result variable is written out as the content of the response and the
+              Content-Length header is set to result.size().
     !*/
 
     void write_http_response (
@@ -207,6 +208,7 @@ namespace dlib
         ensures
             - Writes an HTTP error response based on the information in the exception 
               object e.
+            - The response tells the client that the connection will be closed.
     !*/
 
     void write_http_response (
@@ -217,6 +219,7 @@ namespace dlib
         ensures
             - Writes an HTTP error response based on the information in the exception
               object e.
+            - The response tells the client that the connection will be closed.
     !*/
 
 // -----------------------------------------------------------------------------------------
@@ -229,7 +232,28 @@ namespace dlib
             WHAT THIS EXTENSION DOES FOR server_iostream
                 This extension turns the server object into a simple HTTP server.  It only
                 handles HTTP GET, PUT and POST requests and each incoming request triggers
-                the on_request() callback.  
+                the on_streaming_request() callback, which by default reads the whole
+                request body and calls on_request().  
+
+            PERSISTENT CONNECTIONS
+                The server speaks HTTP/1.1.  Unless the client asks for the connection to
+                be closed, or is an HTTP/1.0 client that didn't ask for it to be kept
+                alive, a connection stays open after a response and the server waits up
+                to get_keep_alive_timeout() milliseconds for the next request on it.
+                Clients may also pipeline requests, i.e. send several of them without
+                waiting for the responses.  They are handled in order and their
+                responses are flushed to the network together.  Note that a connection
+                waiting for its next request holds a thread, unless
+                set_max_worker_threads() is used.  Then the connection is parked between
+                requests, so idle clients don't tie up the worker threads (see
+                server::on_connection_ready()), and it is closed if the next request
+                doesn't start arriving within get_keep_alive_timeout() milliseconds.
+
+                Request bodies may be sent with either a Content-Length or with
+                Transfer-Encoding: chunked.  Responses get a Content-Length if they fit
+                in the server's output buffer, or if the handler sets one itself.
+                Otherwise they are sent chunked, or, for HTTP/1.0 clients, terminated by
+                closing the connection.  Any error closes the connection.
 
             COOKIE STRINGS
                 The strings returned in the cookies key_value_map should be of the following form:
@@ -258,6 +282,7 @@ namespace dlib
         /*!
             ensures
                 - #get_max_content_length() == 10*1024*1024
+                - #get_keep_alive_timeout() == 10000
         !*/
 
         unsigned long get_max_content_length (
@@ -278,15 +303,36 @@ namespace dlib
                 - #get_max_content_length() == max_length
         !*/
 
+        unsigned long get_keep_alive_timeout (
+        ) const;
+        /*!
+            ensures
+                - returns the number of milliseconds the server waits for the next request
+                  on a persistent connection before closing it.  
+                - if (get_keep_alive_timeout() == 0) then
+                    - connections are closed after each response, just like in HTTP/1.0.
+        !*/
+
+        void set_keep_alive_timeout (
+            unsigned long milliseconds
+        );
+        /*!
+            requires
+                - milliseconds < 2000000
+            ensures
+                - #get_keep_alive_timeout() == milliseconds
+        !*/
+
     private:
 
         virtual const std::string on_request (
             const incoming_things& incoming,
             outgoing_things& outgoing
-        ) = 0;
+        );
         /*!
             requires
-                - on_request() is called when there is an HTTP GET or POST request to be serviced 
+                - on_request() is called by the default on_streaming_request() when there is
+                  an HTTP GET or POST request to be serviced 
                 - on_request() is run in its own thread 
                 - is_running() == true 
                 - the number of current on_request() functions running < get_max_connection() 
@@ -332,6 +378,53 @@ namespace dlib
             throws
                 - throws only exceptions derived from std::exception.  If an exception is thrown
                   then the error string from the exception is returned to the web browser.
+                - The default implementation of on_request() throws an http_parse_error with
+                  the 501 (Not Implemented) error code.  So you must override either this
+                  function or on_streaming_request().
+        !*/
+
+        virtual void on_streaming_request (
+            const incoming_things& incoming,
+            std::istream& request_body,
+            outgoing_things& outgoing,
+            std::ostream& response_body
+        );
+        /*!
+            requires
+                - on_streaming_request() is called when there is an HTTP request to be
+                  serviced.
+                - incoming and outgoing are as described for on_request(), except that the
+                  request body has not been read yet, so incoming.body is empty unless the
+                  request is a form post with a Content-Length (see parse_http_request()).
+                - reading request_body yields the body of the request, with any chunked
+                  transfer encoding removed, and then hits EOF.  The data is read from the
+                  connection as you consume it, so, for example, an uploaded image can be
+                  decoded straight from the network with load_png(img, request_body)
+                  without buffering the upload first.
+                - request_body.exceptions() == std::ios::badbit.  So reading a chunked body
+                  larger than get_max_content_length(), or a malformed one, throws an
+                  http_parse_error.
+                - Anything written to response_body is sent to the client as the body of
+                  the response.
+            ensures
+                - Writes the response to this request into response_body and sets the
+                  fields of outgoing as described for on_request().  The HTTP header is
+                  sent when the first data is sent to the client.  That happens when this
+                  function returns, when the server's output buffer fills up, or when you
+                  call response_body.flush().  Changes to outgoing after that point have
+                  no effect.
+                - If you set outgoing.headers["Content-Length"] then you must write exactly
+                  that many bytes to response_body.
+                - You don't have to read all of request_body.  The server skips whatever
+                  you didn't read.
+                - The default implementation reads all of request_body into a copy of
+                  incoming, calls on_request() with it, and writes the returned string to
+                  response_body.
+            throws
+                - throws only exceptions derived from std::exception.  If an exception is
+                  thrown before the HTTP header was sent then the error string from the
+                  exception is returned to the web browser.  In any case the connection
+                  is closed.
         !*/
 
 
@@ -347,39 +440,40 @@ namespace dlib
             unsigned short foreign_port,
             unsigned short local_port,
             uint64
-        )
+        );
         /*!
             on_connect() is the function defined by server_iostream which is overloaded by
-            server_http.  In particular, the server_http's implementation is shown below.
-            In it you can see how the server_http parses the incoming http request, gets a
-            response by calling on_request(), and sends it back using the helper routines
-            defined at the top of this file.
-
-            Therefore, if you want to modify the behavior of the HTTP server, for example,
-            to do some more complex data streaming requiring direct access to the
-            iostreams, then you can do so by defining your own on_connect() routine.  In
-            particular, the default implementation shown below is a good starting point.
+            server_http.  It loops over the requests sent on the connection.  For each one
+            it calls parse_http_request(), sets up the request_body and response_body
+            streams, calls on_streaming_request(), and then decides, based on the
+            request and response headers, whether to wait for another request or close
+            the connection.
+
+            Therefore, if you want to modify the behavior of the HTTP server beyond what
+            on_streaming_request() allows then you can do so by defining your own
+            on_connect() routine.  A simple one that handles a single request per
+            connection looks like this:
+
+                try
+                {
+                    incoming_things incoming(foreign_ip, local_ip, foreign_port, local_port);
+                    outgoing_things outgoing;
+
+                    parse_http_request(in, incoming, get_max_content_length());
+                    read_body(in, incoming);
+                    outgoing.headers["Connection"] = "close";
+                    const std::string& result = on_request(incoming, outgoing);
+                    write_http_response(out, outgoing, result);
+                }
+                catch (http_parse_error& e)
+                {
+                    write_http_response(out, e);
+                }
+                catch (std::exception& e)
+                {
+                    write_http_response(out, e);
+                }
         !*/
-        {
-            try
-            {
-                incoming_things incoming(foreign_ip, local_ip, foreign_port, local_port);
-                outgoing_things outgoing;
-
-                parse_http_request(in, incoming, get_max_content_length());
-                read_body(in, incoming);
-                const std::string& result = on_request(incoming, outgoing);
-                write_http_response(out, outgoing, result);
-            }
-            catch (http_parse_error& e)
-            {
-                write_http_response(out, e);
-            }
-            catch (std::exception& e)
-            {
-                write_http_response(out, e);
-            }
-        }
     };
 
 }
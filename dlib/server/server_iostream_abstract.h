@@ -21,6 +21,13 @@ namespace dlib
                 instead of giving you a connection object you get an istream 
                 and ostream object.
 
+                on_connect() owns its connection until it returns.  So when
+                set_max_worker_threads() is used, every open connection holds one of the
+                worker threads, even while it is idle, and connections beyond
+                get_max_worker_threads() wait until one of them closes.  This extension
+                doesn't park connections; see server::on_connection_ready().  server_http
+                does, between the requests of a kept alive connection.
+
             THREAD SAFETY
                 Note that in on_connect() the input stream in is tied to the output stream 
                 out.  This means that when you read from in it will modify out and thus 
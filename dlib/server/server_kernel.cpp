@@ -5,6 +5,22 @@
 
 #include "server_kernel.h"
 #include "../string.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__linux__)
+#define DLIB_SERVER_USE_EPOLL
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
 
 namespace dlib
 {
@@ -22,7 +38,8 @@ namespace dlib
         thread_count_signaler(thread_count_mutex),
         max_connections(1000),
         thread_count_zero(thread_count_mutex),
-        graceful_close_timeout(500)
+        graceful_close_timeout(500),
+        max_worker_threads(0)
     {
     }
 
@@ -56,6 +73,27 @@ namespace dlib
         graceful_close_timeout = timeout;
     }
 
+// ----------------------------------------------------------------------------------------
+
+    unsigned long server::
+    get_max_worker_threads (
+    ) const
+    {
+        auto_mutex lock(max_connections_mutex);
+        return max_worker_threads;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void server::
+    set_max_worker_threads (
+        unsigned long num
+    ) 
+    {
+        auto_mutex lock(max_connections_mutex);
+        max_worker_threads = num;
+    }
+
 // ----------------------------------------------------------------------------------------
 
 
@@ -109,6 +147,7 @@ namespace dlib
         listening_port = 0;
         max_connections = 1000;
         graceful_close_timeout = 500;
+        max_worker_threads = 0;
         listening_port_mutex.unlock();
         listening_ip_mutex.unlock();
         max_connections_mutex.unlock();
@@ -208,6 +247,7 @@ namespace dlib
                 listening_port = 0;
                 max_connections = 1000;
                 graceful_close_timeout = 500;
+                max_worker_threads = 0;
                 listening_port_mutex.unlock();
                 listening_ip_mutex.unlock();
                 max_connections_mutex.unlock();
@@ -275,6 +315,25 @@ namespace dlib
             on_listening_port_assigned();
         
 
+        const unsigned long num_workers = get_max_worker_threads();
+        if (num_workers != 0)
+        {
+            try
+            {
+                start_event_loop(num_workers);
+            }
+            catch (...)
+            {
+                sock.reset();
+                running_mutex.lock();
+                running = false;
+                running_signaler.broadcast();
+                running_mutex.unlock();
+                clear();
+                throw;
+            }
+        }
+
 
         int status = 0;
 
@@ -339,74 +398,90 @@ namespace dlib
                 
 
                 clear(); 
+                stop_event_loop();
                 throw;
             }
             cons_mutex.unlock();
 
 
-            // make a param structure
-            param* temp = 0;
-            try{
-            temp = new param (
-                            *this,
-                            *client,
-                            get_graceful_close_timeout() 
-                            );
-            } catch (...) 
+            if (event_loop)
             {
-                sock.reset();
-                delete client;
-                running_mutex.lock();
-                running = false;
-                running_signaler.broadcast();
-                running_mutex.unlock();
-                clear(); 
-                throw;
-            }
-
+                // The reactor's workers take it from here.
+                thread_count_mutex.lock();
+                ++thread_count;
+                thread_count_mutex.unlock();
+                enqueue_connection(client);
 
-            // if create_new_thread failed
-            if (!create_new_thread(service_connection,temp))
+                // Don't accept more connections than the workers can keep up with.
+                // Anyone else waits in the listening socket's backlog.
+                wait_for_queue_space();
+            }
+            else
             {
-                delete temp;
-                // close the listening socket
-                sock.reset();
-
-                // close the new connection and remove it from cons
-                cons_mutex.lock();
-                connection* ctemp;
-                if (cons.is_member(client))
+                // make a param structure
+                param* temp = 0;
+                try{
+                temp = new param (
+                                *this,
+                                *client,
+                                get_graceful_close_timeout() 
+                                );
+                } catch (...) 
                 {
-                    cons.remove(client,ctemp);
+                    sock.reset();
+                    delete client;
+                    running_mutex.lock();
+                    running = false;
+                    running_signaler.broadcast();
+                    running_mutex.unlock();
+                    clear(); 
+                    throw;
                 }
-                delete client;
-                cons_mutex.unlock();
 
 
-                // signal that the listener has closed
-                running_mutex.lock();
-                running = false;
-                running_signaler.broadcast();
-                running_mutex.unlock();
+                // if create_new_thread failed
+                if (!create_new_thread(service_connection,temp))
+                {
+                    delete temp;
+                    // close the listening socket
+                    sock.reset();
+
+                    // close the new connection and remove it from cons
+                    cons_mutex.lock();
+                    connection* ctemp;
+                    if (cons.is_member(client))
+                    {
+                        cons.remove(client,ctemp);
+                    }
+                    delete client;
+                    cons_mutex.unlock();
 
-                // make sure the object is cleared
-                clear();
 
-                // throw the exception
-                throw dlib::thread_error(
-                    ECREATE_THREAD,
-                    "error occurred in server::start()\nunable to start thread"
-                    );    
-            }
-            // if we made the new thread then update thread_count
-            else
-            {
-                // increment the thread count
-                thread_count_mutex.lock();
-                ++thread_count;
-                if (thread_count == 0)
-                    thread_count_zero.broadcast();
-                thread_count_mutex.unlock();
+                    // signal that the listener has closed
+                    running_mutex.lock();
+                    running = false;
+                    running_signaler.broadcast();
+                    running_mutex.unlock();
+
+                    // make sure the object is cleared
+                    clear();
+
+                    // throw the exception
+                    throw dlib::thread_error(
+                        ECREATE_THREAD,
+                        "error occurred in server::start()\nunable to start thread"
+                        );    
+                }
+                // if we made the new thread then update thread_count
+                else
+                {
+                    // increment the thread count
+                    thread_count_mutex.lock();
+                    ++thread_count;
+                    if (thread_count == 0)
+                        thread_count_zero.broadcast();
+                    thread_count_mutex.unlock();
+                }
             }
 
 
@@ -446,6 +521,11 @@ namespace dlib
         // close the socket
         sock.reset();
 
+        // If we are shutting down then clear() is closing the connections, so wait for
+        // them to finish and stop the reactor before saying we are done.
+        if (status != OTHER_ERROR)
+            stop_event_loop();
+
         // signal that the listener has closed
         running_mutex.lock();
         running = false;
@@ -457,6 +537,7 @@ namespace dlib
         {
             // make sure the object is cleared
             clear();
+            stop_event_loop();
 
             // throw the exception
             throw dlib::socket_error(
@@ -564,27 +645,392 @@ namespace dlib
         p.the_server.on_connect(p.new_connection);
 
 
+        p.the_server.finish_connection(&p.new_connection, p.graceful_close_timeout);
+
+        delete &p;
+
+
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void server::
+    finish_connection (
+        connection* con,
+        unsigned long timeout
+    )
+    {
+        try{ on_connection_closed(*con); }
+        catch (...) { sdlog << LERROR << "on_connection_closed() threw"; }
+
         // remove this connection from cons and close it
-        p.the_server.cons_mutex.lock();
+        cons_mutex.lock();
         connection* temp;
-        if (p.the_server.cons.is_member(&p.new_connection))
-            p.the_server.cons.remove(&p.new_connection,temp);
-        p.the_server.cons_mutex.unlock();
+        if (cons.is_member(con))
+            cons.remove(con,temp);
+        cons_mutex.unlock();
 
-        try{ close_gracefully(&p.new_connection, p.graceful_close_timeout); } 
+        try{ close_gracefully(con, timeout); } 
         catch (...) { sdlog << LERROR << "close_gracefully() threw"; } 
 
         // decrement the thread count and signal if it is now zero
-        p.the_server.thread_count_mutex.lock();
-        --p.the_server.thread_count;
-        p.the_server.thread_count_signaler.broadcast();
-        if (p.the_server.thread_count == 0)
-            p.the_server.thread_count_zero.broadcast();
-        p.the_server.thread_count_mutex.unlock();
+        thread_count_mutex.lock();
+        --thread_count;
+        thread_count_signaler.broadcast();
+        if (thread_count == 0)
+            thread_count_zero.broadcast();
+        thread_count_mutex.unlock();
+    }
 
-        delete &p;
+// ----------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------
+    // event driven connection handling
+// ----------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------
+
+    struct server::reactor
+    {
+        std::mutex m;
+        std::condition_variable work_ready;
+        std::condition_variable space_ready;
+        std::deque<connection*> ready;
+        unsigned long max_ready = 0;
+        std::vector<std::thread> workers;
+        bool stop = false;
+#ifdef DLIB_SERVER_USE_EPOLL
+        int epoll_fd = -1;
+        // written to when the epoll thread should exit or look at the deadlines again
+        int wake_fd = -1;
+        std::thread epoll_thread;
+
+        // The parked connections and the times they are queued again if no data arrives
+        // first.  Connections without a timeout have a deadline of time_point::max().
+        typedef std::multimap<std::chrono::steady_clock::time_point, connection*> deadline_map;
+        std::mutex parked_m;
+        deadline_map deadlines;
+        std::unordered_map<connection*, deadline_map::iterator> parked;
+
+        void wake_epoll_thread (
+        )
+        {
+            const uint64_t one = 1;
+            if (::write(wake_fd, &one, sizeof(one)) != sizeof(one))
+                server::sdlog << LERROR << "unable to wake the epoll thread";
+        }
+#endif
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    void server::
+    start_event_loop (
+        unsigned long num_workers
+    )
+    {
+        event_loop.reset(new reactor);
+        reactor& r = *event_loop;
+        r.max_ready = 4*num_workers;
+
+#ifdef DLIB_SERVER_USE_EPOLL
+        r.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        r.wake_fd = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK);
+        epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr;
+        if (r.epoll_fd == -1 || r.wake_fd == -1 || epoll_ctl(r.epoll_fd, EPOLL_CTL_ADD, r.wake_fd, &ev) == -1)
+        {
+            if (r.epoll_fd != -1) ::close(r.epoll_fd);
+            if (r.wake_fd != -1) ::close(r.wake_fd);
+            event_loop.reset();
+            throw dlib::socket_error("error occurred in server::start()\nunable to create epoll instance");
+        }
+#endif
+
+        try
+        {
+#ifdef DLIB_SERVER_USE_EPOLL
+            r.epoll_thread = std::thread([this](){ watch_parked_connections(); });
+#endif
+            for (unsigned long i = 0; i < num_workers; ++i)
+                r.workers.emplace_back([this](){ service_queued_connections(); });
+        }
+        catch (...)
+        {
+            stop_event_loop();
+            throw dlib::thread_error(
+                ECREATE_THREAD,
+                "error occurred in server::start()\nunable to start thread"
+            );
+        }
+    }
 
+// ----------------------------------------------------------------------------------------
 
+    void server::
+    stop_event_loop (
+    )
+    {
+        if (!event_loop)
+            return;
+
+        reactor& r = *event_loop;
+
+        // wait for all the connections to finish
+        thread_count_mutex.lock();
+        while (thread_count > 0)
+            thread_count_zero.wait();
+        thread_count_mutex.unlock();
+
+        {
+            std::lock_guard<std::mutex> lock(r.m);
+            r.stop = true;
+        }
+        r.work_ready.notify_all();
+
+#ifdef DLIB_SERVER_USE_EPOLL
+        if (r.epoll_thread.joinable())
+        {
+            r.wake_epoll_thread();
+            r.epoll_thread.join();
+        }
+        ::close(r.epoll_fd);
+        ::close(r.wake_fd);
+#endif
+
+        for (auto& t : r.workers)
+            t.join();
+
+        event_loop.reset();
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void server::
+    enqueue_connection (
+        connection* con
+    )
+    {
+        reactor& r = *event_loop;
+        {
+            std::lock_guard<std::mutex> lock(r.m);
+            r.ready.push_back(con);
+        }
+        r.work_ready.notify_one();
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void server::
+    wait_for_queue_space (
+    )
+    {
+        reactor& r = *event_loop;
+        std::unique_lock<std::mutex> lock(r.m);
+        while (r.ready.size() >= r.max_ready)
+        {
+            r.space_ready.wait_for(lock, std::chrono::seconds(1));
+
+            shutting_down_mutex.lock();
+            const bool exit = shutting_down;
+            shutting_down_mutex.unlock();
+            if (exit)
+                return;
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void server::
+    park_connection (
+        connection* con
+    )
+    {
+        const unsigned long timeout = get_parked_connection_timeout();
+#ifdef DLIB_SERVER_USE_EPOLL
+        reactor& r = *event_loop;
+        const auto deadline = timeout == 0 ? std::chrono::steady_clock::time_point::max() :
+            std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+        bool earliest_deadline;
+        {
+            // This has to happen before the connection is armed, since the epoll thread
+            // only queues connections it finds in parked.
+            std::lock_guard<std::mutex> lock(r.parked_m);
+            const auto i = r.deadlines.emplace(deadline, con);
+            r.parked[con] = i;
+            earliest_deadline = timeout != 0 && i == r.deadlines.begin();
+        }
+
+        // The connection is registered edge triggered and one shot.  So exactly one
+        // epoll event hands it to a worker, and it stays disarmed until it is parked
+        // again.  Arming a connection that already has data pending reports it right
+        // away, so nothing that arrived while a worker had it is missed.
+        epoll_event ev;
+        ev.events = EPOLLIN|EPOLLRDHUP|EPOLLET|EPOLLONESHOT;
+        ev.data.ptr = con;
+        const int fd = con->get_socket_descriptor();
+        if (epoll_ctl(r.epoll_fd, EPOLL_CTL_MOD, fd, &ev) == -1 &&
+            (errno != ENOENT || epoll_ctl(r.epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1))
+        {
+            sdlog << LERROR << "unable to add a connection to epoll";
+            {
+                std::lock_guard<std::mutex> lock(r.parked_m);
+                r.deadlines.erase(r.parked[con]);
+                r.parked.erase(con);
+            }
+            finish_connection(con, get_graceful_close_timeout());
+            return;
+        }
+
+        // The epoll thread may be sleeping until a later deadline.
+        if (earliest_deadline)
+            r.wake_epoll_thread();
+#else
+        // Without epoll this worker waits for the data itself, so a parked connection
+        // still holds a thread.
+        const auto start = std::chrono::steady_clock::now();
+        while (!con->readable(100))
+        {
+            shutting_down_mutex.lock();
+            const bool exit = shutting_down;
+            shutting_down_mutex.unlock();
+            if (exit)
+                break;
+            if (timeout != 0 && std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(timeout))
+                break;
+        }
+        enqueue_connection(con);
+#endif
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void server::
+    service_queued_connections (
+    )
+    {
+        reactor& r = *event_loop;
+        while (true)
+        {
+            connection* con = 0;
+            {
+                std::unique_lock<std::mutex> lock(r.m);
+                while (r.ready.size() == 0 && !r.stop)
+                    r.work_ready.wait(lock);
+                if (r.ready.size() == 0)
+                    return;
+                con = r.ready.front();
+                r.ready.pop_front();
+            }
+            r.space_ready.notify_one();
+
+            bool keep_open = false;
+            try
+            {
+                keep_open = on_connection_ready(*con);
+            }
+            catch (std::exception& e)
+            {
+                sdlog << LERROR << "exception thrown while servicing a connection: " << e.what();
+            }
+            catch (...)
+            {
+                sdlog << LERROR << "exception thrown while servicing a connection";
+            }
+
+            shutting_down_mutex.lock();
+            const bool exit = shutting_down;
+            shutting_down_mutex.unlock();
+
+            if (keep_open && !exit)
+                park_connection(con);
+            else
+                finish_connection(con, get_graceful_close_timeout());
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void server::
+    watch_parked_connections (
+    )
+    {
+#ifdef DLIB_SERVER_USE_EPOLL
+        reactor& r = *event_loop;
+        epoll_event events[128];
+        std::vector<connection*> expired;
+        while (true)
+        {
+            // Sleep until the earliest deadline, if there is one.
+            int wait_ms = -1;
+            {
+                std::lock_guard<std::mutex> lock(r.parked_m);
+                if (!r.deadlines.empty() && r.deadlines.begin()->first != std::chrono::steady_clock::time_point::max())
+                {
+                    const auto left = r.deadlines.begin()->first - std::chrono::steady_clock::now();
+                    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(left).count() + 1;
+                    wait_ms = static_cast<int>(std::max<long long>(0, std::min<long long>(ms, 1000000)));
+                }
+            }
+
+            const int num = epoll_wait(r.epoll_fd, events, 128, wait_ms);
+            if (num == -1)
+            {
+                if (errno == EINTR)
+                    continue;
+                sdlog << LERROR << "epoll_wait() failed";
+                return;
+            }
+
+            for (int i = 0; i < num; ++i)
+            {
+                if (events[i].data.ptr == nullptr)
+                {
+                    uint64_t junk;
+                    if (::read(r.wake_fd, &junk, sizeof(junk)) != sizeof(junk) && errno != EAGAIN)
+                        sdlog << LERROR << "unable to read from the epoll thread's eventfd";
+                    std::lock_guard<std::mutex> lock(r.m);
+                    if (r.stop)
+                        return;
+                    continue;
+                }
+
+                connection* con = static_cast<connection*>(events[i].data.ptr);
+                bool was_parked = false;
+                {
+                    std::lock_guard<std::mutex> lock(r.parked_m);
+                    const auto j = r.parked.find(con);
+                    if (j != r.parked.end())
+                    {
+                        r.deadlines.erase(j->second);
+                        r.parked.erase(j);
+                        was_parked = true;
+                    }
+                }
+                if (was_parked)
+                    enqueue_connection(con);
+            }
+
+            // Hand the connections that waited too long back to a worker.  They are
+            // removed from epoll first so that no event for them can show up later.
+            expired.clear();
+            {
+                std::lock_guard<std::mutex> lock(r.parked_m);
+                const auto now = std::chrono::steady_clock::now();
+                while (!r.deadlines.empty() && r.deadlines.begin()->first <= now)
+                {
+                    connection* con = r.deadlines.begin()->second;
+                    r.parked.erase(con);
+                    r.deadlines.erase(r.deadlines.begin());
+                    expired.push_back(con);
+                }
+            }
+            for (auto con : expired)
+            {
+                epoll_ctl(r.epoll_fd, EPOLL_CTL_DEL, con->get_socket_descriptor(), nullptr);
+                enqueue_connection(con);
+            }
+        }
+#endif
     }
 
 // ----------------------------------------------------------------------------------------
@@ -46,8 +46,11 @@ namespace dlib
                 thread_count_signaler   == a signaler associated with thread_count_mutex
                 thread_count_zero       == a signaler associated with thread_count_mutex
                 max_connections         == 1000 
-                max_connections_mutex   == a mutex for max_connections and graceful_close_timeout
+                max_connections_mutex   == a mutex for max_connections, graceful_close_timeout
+                                           and max_worker_threads
                 graceful_close_timeout  == 500 
+                max_worker_threads      == 0
+                event_loop              == a null pointer
              
             CONVENTION
                 listening_port          == get_listening_port()
@@ -65,7 +68,11 @@ namespace dlib
                                            used to signal when running is false
                 shutting_down_mutex     == a mutex for shutting_down
                 cons_mutex              == a mutex for cons
-                thread_count            == the number of threads currently running
+                thread_count            == the number of connections currently being
+                                           serviced.  Each one either has its own
+                                           thread or, if event_loop is non-null, is
+                                           queued in, being run by or parked in
+                                           event_loop.
                 thread_count_mutex      == a mutex for thread_count
                 thread_count_signaler   == a signaler for thread_count and
                                            is associated with thread_count_mutex.  it
@@ -77,6 +84,14 @@ namespace dlib
                                            zero
                 max_connections         == get_max_connections()
                 max_connections_mutex   == a mutex for max_connections
+                max_worker_threads      == get_max_worker_threads()
+                event_loop              == if (start() is accepting connections and
+                                           max_worker_threads was non-zero when it began)
+                                           then a pointer to the reactor that runs the
+                                           connections: a fixed set of worker threads
+                                           and, on Linux, an epoll thread that watches
+                                           parked connections for incoming data.
+                                           Otherwise a null pointer.
         !*/
         
 
@@ -158,6 +173,13 @@ namespace dlib
             unsigned long get_graceful_close_timeout (
             ) const;
 
+            void set_max_worker_threads (
+                unsigned long num
+            );
+
+            unsigned long get_max_worker_threads (
+            ) const;
+
         private:
 
             void start_async_helper (
@@ -176,6 +198,95 @@ namespace dlib
             virtual void on_listening_port_assigned (
             ) {}
 
+            virtual bool on_connection_ready (
+                connection& con
+            ) { on_connect(con); return false; }
+
+            virtual unsigned long get_parked_connection_timeout (
+            ) const { return 0; }
+
+            virtual void on_connection_closed (
+                connection&
+            ) {}
+
+            struct reactor;
+
+            void start_event_loop (
+                unsigned long num_workers
+            );
+            /*!
+                requires
+                    - event_loop is a null pointer
+                ensures
+                    - #event_loop points to a running reactor with num_workers worker
+                      threads.
+            !*/
+
+            void stop_event_loop (
+            );
+            /*!
+                ensures
+                    - if (event_loop is non-null) then
+                        - waits for thread_count to become 0, i.e. for all connections to
+                          be finished, then stops the reactor's threads.
+                    - #event_loop is a null pointer
+            !*/
+
+            void enqueue_connection (
+                connection* con
+            );
+            /*!
+                requires
+                    - event_loop is non-null
+                ensures
+                    - queues con so that a worker calls on_connection_ready(*con).
+            !*/
+
+            void wait_for_queue_space (
+            );
+            /*!
+                requires
+                    - event_loop is non-null
+                ensures
+                    - blocks while the number of connections waiting for a worker is at
+                      its limit, unless the server is shutting down.
+            !*/
+
+            void park_connection (
+                connection* con
+            );
+            /*!
+                requires
+                    - event_loop is non-null
+                ensures
+                    - arranges for con to be queued again once it has data to read, or
+                      once get_parked_connection_timeout() milliseconds have passed
+                      without any.  On platforms without epoll the calling thread does
+                      the waiting.
+            !*/
+
+            void service_queued_connections (
+            );
+            /*!
+                this is the function run by the reactor's worker threads
+            !*/
+
+            void watch_parked_connections (
+            );
+            /*!
+                this is the function run by the reactor's epoll thread
+            !*/
+
+            void finish_connection (
+                connection* con,
+                unsigned long timeout
+            );
+            /*!
+                ensures
+                    - removes con from cons, closes it gracefully, deletes it and then
+                      decrements thread_count.
+            !*/
+
             const static logger sdlog;
 
             static void service_connection(
@@ -213,6 +324,8 @@ namespace dlib
             std::unique_ptr<thread_function> async_start_thread;
             std::unique_ptr<listener> sock;
             unsigned long graceful_close_timeout;
+            unsigned long max_worker_threads;
+            std::unique_ptr<reactor> event_loop;
 
 
             // restricted functions
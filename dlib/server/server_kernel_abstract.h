@@ -20,6 +20,7 @@ namespace dlib
                 is_running()                 == false
                 get_max_connections()        == 1000
                 get_graceful_close_timeout() == 500 
+                get_max_worker_threads()     == 0
 
 
             CALLBACK FUNCTIONS
@@ -42,10 +43,33 @@ namespace dlib
                 is NOT called in its own thread.  Thus, making it block might hang the
                 server.
 
+            on_connection_ready():
+                This function is only used when get_max_worker_threads() != 0.  By
+                default it just calls on_connect() and returns false, so it never parks
+                anything: each connection holds a worker thread until on_connect()
+                returns, even while it is idle, and at most get_max_worker_threads()
+                connections are serviced at once.  This is the case for server_iostream.
+                Servers that want to keep mostly idle connections open without tying up
+                a thread for each one must override it, handle whatever data is
+                available, and return true to have the connection parked until more
+                data arrives.
+
             WHAT THIS OBJECT REPRESENTS
                 This object represents a server that listens on a port and spawns new
                 threads to handle each new connection.            
 
+                Alternatively, if get_max_worker_threads() != 0 when start() is called,
+                the connections are handled by a fixed number of worker threads.  Each
+                new connection is queued and a worker calls on_connection_ready() on
+                it.  If that returns true, the connection is parked until it has more
+                data to read, or until get_parked_connection_timeout() runs out, and then
+                queued again.  On Linux parked connections are watched with epoll, so
+                they cost no thread at all.  On other platforms the worker that parked a
+                connection waits for its data itself.  When the workers
+                can't keep up and several connections are waiting for one, accept() is
+                not called until a worker frees up.  So, as with get_max_connections(),
+                new clients wait in the listening socket's backlog.
+
                 Note that the clear() function does not return until all calls to 
                 on_connect() have finished and the start() function has been shutdown.
                 Also note that when clear() is called all open connection objects 
@@ -265,6 +289,29 @@ namespace dlib
                       connection.  This is the timeout value given to close_gracefully().
             !*/
 
+            void set_max_worker_threads (
+                unsigned long num
+            );
+            /*!
+                ensures
+                    - #get_max_worker_threads() == num
+                    - The new value takes effect the next time start() or start_async()
+                      begins accepting connections.
+            !*/
+
+            unsigned long get_max_worker_threads (
+            ) const;
+            /*!
+                ensures
+                    - if (this function returns 0) then
+                        - each connection is handled by its own thread.  This is the
+                          default.
+                    - else
+                        - returns the number of worker threads that service all the
+                          connections.  At most this many calls to on_connect() or
+                          on_connection_ready() run at the same time.
+            !*/
+
         private:
 
             virtual void on_connect (
@@ -272,7 +319,8 @@ namespace dlib
             )=0;
             /*!
                 requires
-                    - on_connect() is run in its own thread 
+                    - on_connect() is run in its own thread, or in one of the worker
+                      threads if get_max_worker_threads() != 0
                     - is_running() == true 
                     - the number of current connections < get_max_connection() 
                     - new_connection == the new connection to the server which is
@@ -284,6 +332,78 @@ namespace dlib
                     - does not throw any exceptions
             !*/
 
+            virtual bool on_connection_ready (
+                connection& con
+            ) { on_connect(con); return false; }
+            /*!
+                The default implementation runs on_connect(con) to completion and returns
+                false.  So it never parks a connection, and an idle connection keeps its
+                worker thread busy for as long as on_connect() waits on it.
+
+                requires
+                    - get_max_worker_threads() was non-zero when start() began
+                    - is run in one of the worker threads
+                    - con is either a new connection or one for which the previous call
+                      to on_connection_ready() returned true and which now has data to
+                      read, has been closed by the remote host, was shutdown() by
+                      clear(), or has been parked for get_parked_connection_timeout()
+                      milliseconds without receiving anything.
+                ensures
+                    - services con for a while and returns.
+                    - if (this function returns true) then
+                        - con stays open and on_connection_ready(con) will be called again
+                          once it has more data to read, or once it has been idle for
+                          get_parked_connection_timeout() milliseconds, in which case
+                          con has nothing to read.  Any state needed to pick up
+                          where it left off, e.g. data already read from con, must be
+                          kept by the implementation.  con.user_data is free for this.
+                          Note that on_connection_ready() is only called again when the
+                          socket has data, so data the implementation has already
+                          buffered must be handled before returning true.
+                    - A new connection is handed to this function right away, before
+                      the remote host has necessarily sent anything.  con.read(buf,num,0)
+                      doesn't block, so an implementation that returns true when it
+                      gives TIMEOUT never holds a worker thread while waiting for a
+                      client.
+                    - else
+                        - con is closed with close_gracefully() and deleted.
+                    - this function will not call clear()  
+                throws
+                    - does not throw any exceptions
+            !*/
+
+            virtual unsigned long get_parked_connection_timeout (
+            ) const { return 0; }
+            /*!
+                ensures
+                    - returns the number of milliseconds a connection parked by
+                      on_connection_ready() may wait for data before it is handed back to
+                      on_connection_ready() anyway, e.g. so that it can be closed.  0
+                      means there is no limit, which is the default.
+                    - this function will not block
+                    - this function will not call clear()
+                throws
+                    - does not throw any exceptions
+            !*/
+
+            virtual void on_connection_closed (
+                connection& con
+            ) {}
+            /*!
+                requires
+                    - con is about to be closed with close_gracefully() and deleted.
+                      This happens to every connection, whichever way it ends, e.g. also
+                      when clear() shuts down a connection that on_connection_ready()
+                      wanted to keep open.
+                ensures
+                    - releases any state the implementation keeps for con, e.g. in
+                      on_connection_ready().  By default this does nothing.
+                    - this function will not block
+                    - this function will not call clear()
+                throws
+                    - does not throw any exceptions
+            !*/
+
             // do nothing by default
             virtual void on_listening_port_assigned (
             ) {}
@@ -3,8 +3,12 @@
 #ifndef DLIB_SOCKETS_EXTENSIONs_CPP
 #define DLIB_SOCKETS_EXTENSIONs_CPP
 
+#include <algorithm>
+#include <fstream>
+#include <limits>
 #include <string>
 #include <sstream>
+#include <vector>
 #include "../sockets.h"
 #include "../error.h"
 #include "sockets_extensions.h"
@@ -15,6 +19,13 @@
 #include "../serialize.h"
 #include "../string.h"
 
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace dlib
 {
 
@@ -188,6 +199,20 @@ namespace dlib
         unsigned long timeout
     )
     {
+        // If we don't need to look up a host name then the sockets layer can do the
+        // whole thing with a non-blocking connect.  Otherwise we have to do the connect
+        // in another thread since there isn't any way to time out a host name lookup.
+        if (is_ip_address(host_or_ip))
+        {
+            connection* con;
+            const int status = create_connection(con, port, host_or_ip, 0, "", std::max<unsigned long>(timeout,1));
+            if (status == TIMEOUT)
+                throw socket_error("unable to connect to '" + host_or_ip + "' because connect timed out"); 
+            else if (status != 0)
+                throw socket_error("unable to connect to '" + host_or_ip); 
+            return con;
+        }
+
         using namespace connect_timeout_helpers;
 
         auto_mutex M(connect_mutex);
@@ -274,6 +299,98 @@ namespace dlib
         return con;
     }
 
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        inline uint64 send_file_with_streams (
+            connection& con,
+            const std::string& filename,
+            uint64 offset,
+            uint64 num
+        )
+        {
+            std::ifstream fin(filename.c_str(), std::ios::binary);
+            if (!fin)
+                throw socket_error("send_file(): unable to open file '" + filename + "'");
+            fin.seekg(0, std::ios::end);
+            const uint64 file_size = static_cast<uint64>(fin.tellg());
+            if (offset >= file_size)
+                return 0;
+            num = std::min(num, file_size-offset);
+            fin.seekg(offset);
+
+            std::vector<char> buf(static_cast<size_t>(std::min<uint64>(num, 64*1024)));
+            uint64 sent = 0;
+            while (sent < num)
+            {
+                const long length = static_cast<long>(std::min<uint64>(num-sent, buf.size()));
+                if (!fin.read(&buf[0], length))
+                    throw socket_error("send_file(): error reading file '" + filename + "'");
+                if (con.write(&buf[0], length) != length)
+                    throw socket_error("send_file(): error writing to the connection");
+                sent += length;
+            }
+            return sent;
+        }
+    }
+
+    uint64 send_file (
+        connection& con,
+        const std::string& filename,
+        uint64 offset,
+        uint64 num
+    )
+    {
+#ifdef __linux__
+        const int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd == -1)
+            throw socket_error("send_file(): unable to open file '" + filename + "'");
+
+        struct stat st;
+        if (fstat(fd, &st) == -1)
+        {
+            ::close(fd);
+            throw socket_error("send_file(): unable to read file '" + filename + "'");
+        }
+        const uint64 file_size = st.st_size;
+        if (offset >= file_size)
+        {
+            ::close(fd);
+            return 0;
+        }
+        num = std::min(num, file_size-offset);
+
+        // sendfile() copies the file to the socket inside the kernel so the data never
+        // has to be copied into user space.
+        off_t pos = offset;
+        uint64 sent = 0;
+        while (sent < num)
+        {
+            const size_t length = static_cast<size_t>(std::min<uint64>(num-sent, 1<<30));
+            const ssize_t status = ::sendfile(con.get_socket_descriptor(), fd, &pos, length);
+            if (status <= 0)
+            {
+                if (status == -1 && errno == EINTR)
+                    continue;
+
+                const int err = errno;
+                ::close(fd);
+                // Some kinds of files and sockets don't work with sendfile() so fall
+                // back to copying the data ourselves.
+                if (sent == 0 && (err == EINVAL || err == ENOSYS))
+                    return impl::send_file_with_streams(con, filename, offset, num);
+                throw socket_error("send_file(): error writing to the connection");
+            }
+            sent += status;
+        }
+        ::close(fd);
+        return sent;
+#else
+        return impl::send_file_with_streams(con, filename, offset, num);
+#endif
+    }
+
 // ----------------------------------------------------------------------------------------
 
     bool is_ip_address (
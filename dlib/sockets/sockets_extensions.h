@@ -4,6 +4,7 @@
 #define DLIB_SOCKETS_EXTENSIONs_
 
 #include <iosfwd>
+#include <limits>
 #include <memory>
 #include <string>
 
@@ -125,6 +126,15 @@ namespace dlib
         const std::string& path
     );
 
+// ----------------------------------------------------------------------------------------
+
+    uint64 send_file (
+        connection& con,
+        const std::string& filename,
+        uint64 offset = 0,
+        uint64 num = std::numeric_limits<uint64>::max()
+    );
+
 // ----------------------------------------------------------------------------------------
 
     bool is_ip_address (
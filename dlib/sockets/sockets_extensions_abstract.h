@@ -214,6 +214,9 @@ namespace dlib
             - returns a connection object that is connected to the given host at the 
               given port.  
             - blocks for at most timeout milliseconds
+            - if (host_or_ip is an IP address) then
+                - this is done with a non-blocking connect.  Otherwise, host_or_ip has to
+                  be resolved first and so the connect is done in a separate thread.
         throws
             - dlib::socket_error
                 This exception is thrown if there is some problem that prevents us from
@@ -238,6 +241,31 @@ namespace dlib
             - std::bad_alloc
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    uint64 send_file (
+        connection& con,
+        const std::string& filename,
+        uint64 offset = 0,
+        uint64 num = std::numeric_limits<uint64>::max()
+    );
+    /*!
+        ensures
+            - Writes num bytes of the given file, starting offset bytes into the file, to
+              con.  If the file ends before that then only the bytes up to the end of the
+              file are written.  
+            - On Linux this uses sendfile(), which copies the file to the socket within
+              the kernel.  This makes it a fast way to serve large files, such as
+              serialized models.  On other platforms the file is read in chunks and
+              written with con.write().
+            - returns the number of bytes written to con.
+        throws
+            - dlib::socket_error
+                This exception is thrown if the file can't be read or there is an error
+                writing to con.  In that case you should close con since you don't know
+                how much of the file was written to it.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
 
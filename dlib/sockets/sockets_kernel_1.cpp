@@ -301,6 +301,169 @@ namespace dlib
             return 0;
     }
 
+// ----------------------------------------------------------------------------------------
+
+    int connection::
+    set_send_buffer_size (
+        long size
+    )
+    {
+        int value = static_cast<int>(size);
+        if (setsockopt(connection_socket, SOL_SOCKET, SO_SNDBUF, (char *)&value, sizeof(value)) == SOCKET_ERROR)
+            return OTHER_ERROR;
+        return 0;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    long connection::
+    get_send_buffer_size (
+    ) const
+    {
+        int value = 0;
+        int length = sizeof(value);
+        if (getsockopt(connection_socket, SOL_SOCKET, SO_SNDBUF, (char *)&value, &length) == SOCKET_ERROR)
+            return OTHER_ERROR;
+        return value;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    int connection::
+    set_receive_buffer_size (
+        long size
+    )
+    {
+        int value = static_cast<int>(size);
+        if (setsockopt(connection_socket, SOL_SOCKET, SO_RCVBUF, (char *)&value, sizeof(value)) == SOCKET_ERROR)
+            return OTHER_ERROR;
+        return 0;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    long connection::
+    get_receive_buffer_size (
+    ) const
+    {
+        int value = 0;
+        int length = sizeof(value);
+        if (getsockopt(connection_socket, SOL_SOCKET, SO_RCVBUF, (char *)&value, &length) == SOCKET_ERROR)
+            return OTHER_ERROR;
+        return value;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    int connection::
+    set_keepalive (
+        bool enabled
+    )
+    {
+        BOOL flag = enabled ? TRUE : FALSE;
+        if (setsockopt(connection_socket, SOL_SOCKET, SO_KEEPALIVE, (char *)&flag, sizeof(flag)) == SOCKET_ERROR)
+            return OTHER_ERROR;
+        return 0;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    long connection::
+    write (
+        const const_buffer* bufs,
+        unsigned long num_bufs
+    )
+    {
+        long total = 0;
+        for (unsigned long i = 0; i < num_bufs; ++i)
+            total += bufs[i].size;
+
+        // The buffer we are currently on and how much of it has been sent already.
+        unsigned long cur = 0;
+        long offset = 0;
+        while (true)
+        {
+            // Gather up as many of the remaining buffers as we can send in one call.
+            const DWORD max_wsabufs = 64;
+            WSABUF wsabufs[max_wsabufs];
+            DWORD num_wsabufs = 0;
+            for (unsigned long i = cur; i < num_bufs && num_wsabufs < max_wsabufs; ++i)
+            {
+                const long skip = (i == cur) ? offset : 0;
+                if (bufs[i].size - skip == 0)
+                    continue;
+                wsabufs[num_wsabufs].buf = const_cast<char*>(bufs[i].data + skip);
+                wsabufs[num_wsabufs].len = static_cast<ULONG>(bufs[i].size - skip);
+                ++num_wsabufs;
+            }
+            if (num_wsabufs == 0)
+                break;
+
+            DWORD sent = 0;
+            if (WSASend(connection_socket, wsabufs, num_wsabufs, &sent, 0, NULL, NULL) == SOCKET_ERROR)
+            {
+                if (sdo_called())
+                    return SHUTDOWN;
+                else
+                    return OTHER_ERROR;
+            }
+
+            // skip past the bytes that were sent
+            long status = static_cast<long>(sent);
+            while (cur < num_bufs && status >= bufs[cur].size - offset)
+            {
+                status -= bufs[cur].size - offset;
+                offset = 0;
+                ++cur;
+            }
+            offset += status;
+        }
+        return total;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    long connection::
+    write_some (
+        const char* buf,
+        long num,
+        unsigned long timeout
+    )
+    {
+        if (writable(timeout) == false)
+        {
+            if (sdo_called())
+                return SHUTDOWN;
+            return TIMEOUT;
+        }
+
+        // Windows doesn't have MSG_DONTWAIT so we switch the socket to non-blocking
+        // mode for the duration of this send() call.
+        u_long non_blocking = 1;
+        if (ioctlsocket(connection_socket, FIONBIO, &non_blocking) == SOCKET_ERROR)
+            return OTHER_ERROR;
+
+        const long max_send_length = 1024*1024*100;
+        const long length = std::min(max_send_length, num);
+        const long status = send(connection_socket, buf, length, 0);
+        const int err = WSAGetLastError();
+
+        non_blocking = 0;
+        if (ioctlsocket(connection_socket, FIONBIO, &non_blocking) == SOCKET_ERROR)
+            return OTHER_ERROR;
+
+        if (status == SOCKET_ERROR)
+        {
+            if (err == WSAEWOULDBLOCK)
+                return TIMEOUT;
+            else if (sdo_called())
+                return SHUTDOWN;
+            else
+                return OTHER_ERROR;
+        }
+        return status;
+    }
+
 // ----------------------------------------------------------------------------------------
 
     long connection::
@@ -393,6 +556,66 @@ namespace dlib
         return status;
     }
 
+// ----------------------------------------------------------------------------------------
+
+    long connection::
+    read (
+        const mutable_buffer* bufs,
+        unsigned long num_bufs
+    )
+    {
+        const DWORD max_wsabufs = 64;
+        WSABUF wsabufs[max_wsabufs];
+        DWORD num_wsabufs = 0;
+        for (unsigned long i = 0; i < num_bufs && num_wsabufs < max_wsabufs; ++i)
+        {
+            if (bufs[i].size == 0)
+                continue;
+            wsabufs[num_wsabufs].buf = bufs[i].data;
+            wsabufs[num_wsabufs].len = static_cast<ULONG>(bufs[i].size);
+            ++num_wsabufs;
+        }
+
+        DWORD received = 0;
+        DWORD flags = 0;
+        if (WSARecv(connection_socket, wsabufs, num_wsabufs, &received, &flags, NULL, NULL) == SOCKET_ERROR)
+        {
+            // if this error is the result of a shutdown call then return SHUTDOWN
+            if (sd_called())
+                return SHUTDOWN;
+            else
+                return OTHER_ERROR;
+        }
+        else if (received == 0 && sd_called())
+        {
+            return SHUTDOWN;
+        }
+        return static_cast<long>(received);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    bool connection::
+    writable (
+        unsigned long timeout
+    ) const
+    {
+        fd_set write_set, except_set;
+        FD_ZERO(&write_set);
+        FD_ZERO(&except_set);
+        FD_SET(connection_socket, &write_set);
+        FD_SET(connection_socket, &except_set);
+
+        timeval time_to_wait;
+        time_to_wait.tv_sec = static_cast<long>(timeout/1000);
+        time_to_wait.tv_usec = static_cast<long>((timeout%1000)*1000);
+
+        // If there is an error on the socket we also say it's writable since the next
+        // write will then report the error.
+        int status = select(0,0,&write_set,&except_set,&time_to_wait);
+        return status > 0;
+    }
+
 // ----------------------------------------------------------------------------------------
 
     bool connection::
@@ -1027,6 +1250,27 @@ namespace dlib
         return status;
     }
 
+// ----------------------------------------------------------------------------------------
+
+    int create_connection (
+        std::unique_ptr<connection>& new_connection,
+        unsigned short foreign_port, 
+        const std::string& foreign_ip, 
+        unsigned short local_port,
+        const std::string& local_ip,
+        unsigned long timeout
+    )
+    {
+        new_connection.reset();
+        connection* temp;
+        int status = create_connection(temp,foreign_port, foreign_ip, local_port, local_ip, timeout);
+
+        if (status == 0)
+            new_connection.reset(temp);
+
+        return status;
+    }
+
     int create_connection ( 
         connection*& new_connection,
         unsigned short foreign_port, 
@@ -1034,6 +1278,99 @@ namespace dlib
         unsigned short local_port,
         const std::string& local_ip
     )
+    {
+        return create_connection(new_connection, foreign_port, foreign_ip, local_port, local_ip, 0);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    static int connect_with_timeout (
+        SOCKET sock,
+        const sockaddr_in& foreign_sa,
+        unsigned long timeout,
+        int& err
+    )
+    /*!
+        ensures
+            - connects sock to foreign_sa.  If timeout != 0 then it gives up after
+              timeout milliseconds.
+            - returns 0 on success, TIMEOUT if the timeout expired, and OTHER_ERROR
+              if there was some other error.  In that case #err is the error code.
+    !*/
+    {
+        err = 0;
+        if (timeout == 0)
+        {
+            if (connect(sock, reinterpret_cast<const sockaddr*>(&foreign_sa), sizeof(sockaddr_in)) == SOCKET_ERROR)
+            {
+                err = WSAGetLastError();
+                return OTHER_ERROR;
+            }
+            return 0;
+        }
+
+        // Do a non-blocking connect and then wait for it to finish.
+        u_long non_blocking = 1;
+        if (ioctlsocket(sock, FIONBIO, &non_blocking) == SOCKET_ERROR)
+        {
+            err = WSAGetLastError();
+            return OTHER_ERROR;
+        }
+
+        if (connect(sock, reinterpret_cast<const sockaddr*>(&foreign_sa), sizeof(sockaddr_in)) == SOCKET_ERROR)
+        {
+            err = WSAGetLastError();
+            if (err != WSAEWOULDBLOCK)
+                return OTHER_ERROR;
+            err = 0;
+
+            fd_set write_set, except_set;
+            FD_ZERO(&write_set);
+            FD_ZERO(&except_set);
+            FD_SET(sock, &write_set);
+            FD_SET(sock, &except_set);
+            timeval time_to_wait;
+            time_to_wait.tv_sec = static_cast<long>(timeout/1000);
+            time_to_wait.tv_usec = static_cast<long>((timeout%1000)*1000);
+
+            const int status = select(0,0,&write_set,&except_set,&time_to_wait);
+            if (status == 0)
+                return TIMEOUT;
+            if (status == SOCKET_ERROR)
+            {
+                err = WSAGetLastError();
+                return OTHER_ERROR;
+            }
+
+            // Windows reports failed connects in the exception set.
+            if (FD_ISSET(sock, &except_set))
+            {
+                int length = sizeof(err);
+                getsockopt(sock, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&err), &length);
+                return OTHER_ERROR;
+            }
+        }
+
+        // put the socket back into blocking mode
+        non_blocking = 0;
+        if (ioctlsocket(sock, FIONBIO, &non_blocking) == SOCKET_ERROR)
+        {
+            err = WSAGetLastError();
+            return OTHER_ERROR;
+        }
+        return 0;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    int create_connection ( 
+        connection*& new_connection,
+        unsigned short foreign_port, 
+        const std::string& foreign_ip, 
+        unsigned short local_port,
+        const std::string& local_ip,
+        unsigned long timeout
+    )
     {
         // ensure that WSAStartup has been called and WSACleanup
         // will eventually be called when program ends
@@ -1115,15 +1452,13 @@ namespace dlib
         }
 
         // connect the socket        
-        if (connect (
-                sock,
-                reinterpret_cast<sockaddr*>(&foreign_sa),
-                sizeof(sockaddr_in)
-            ) == SOCKET_ERROR
-        )
+        int err = 0;
+        const int connect_status = connect_with_timeout(sock, foreign_sa, timeout, err);
+        if (connect_status != 0)
         {
-            const int err = WSAGetLastError();
             closesocket(sock); 
+            if (connect_status == TIMEOUT)
+                return TIMEOUT;
             // if the port is already bound then return PORTINUSE
             if (err == WSAEADDRINUSE)
                 return PORTINUSE;
@@ -26,6 +26,7 @@ namespace dlib
     // forward declarations
     class socket_factory;
     class listener;
+    class server;
     class SOCKET_container;
 
 // ----------------------------------------------------------------------------------------
@@ -87,6 +88,7 @@ namespace dlib
         !*/
 
         friend class listener;                // make listener a friend of connection
+        friend class server;                  // server waits on parked connections with readable()
         // make create_connection a friend of connection
         friend int create_connection ( 
             connection*& new_connection,
@@ -96,6 +98,15 @@ namespace dlib
             const std::string& local_ip 
         );
 
+        friend int create_connection ( 
+            connection*& new_connection,
+            unsigned short foreign_port, 
+            const std::string& foreign_ip, 
+            unsigned short local_port,
+            const std::string& local_ip,
+            unsigned long timeout
+        );
+
         friend int create_connection (
             connection*& new_connection,
             const std::string& path
@@ -108,11 +119,34 @@ namespace dlib
 
         void* user_data;
 
+        struct const_buffer
+        {
+            const char* data;
+            long size;
+        };
+
+        struct mutable_buffer
+        {
+            char* data;
+            long size;
+        };
+
         long write (
             const char* buf, 
             long num
         );
 
+        long write (
+            const const_buffer* bufs,
+            unsigned long num_bufs
+        );
+
+        long write_some (
+            const char* buf,
+            long num,
+            unsigned long timeout
+        );
+
         long read (
             char* buf, 
             long num
@@ -124,6 +158,11 @@ namespace dlib
             unsigned long timeout
         );
 
+        long read (
+            const mutable_buffer* bufs,
+            unsigned long num_bufs
+        );
+
         unsigned short get_local_port (
         ) const {  return info.cast_to<inet_info>().connection_local_port; }
 
@@ -160,6 +199,24 @@ namespace dlib
         int disable_nagle(
         );
 
+        int set_send_buffer_size (
+            long size
+        );
+
+        long get_send_buffer_size (
+        ) const;
+
+        int set_receive_buffer_size (
+            long size
+        );
+
+        long get_receive_buffer_size (
+        ) const;
+
+        int set_keepalive (
+            bool enabled
+        );
+
         socket_descriptor_type get_socket_descriptor (
         ) const;
 
@@ -177,6 +234,18 @@ namespace dlib
                   there was an error. 
         !*/ 
 
+        bool writable (
+            unsigned long timeout 
+        ) const;
+        /*! 
+            requires 
+                - timeout < 2000000  
+            ensures 
+                - returns true if a write call on this connection can write at least
+                  one byte without blocking. 
+                - returns false if it would block or if there was an error. 
+        !*/ 
+
         bool sd_called (
         )const
         /*!
@@ -439,6 +508,15 @@ namespace dlib
         const std::string& local_ip = ""
     );
 
+    int create_connection ( 
+        connection*& new_connection,
+        unsigned short foreign_port, 
+        const std::string& foreign_ip, 
+        unsigned short local_port,
+        const std::string& local_ip,
+        unsigned long timeout
+    );
+
     int create_listener (
         std::unique_ptr<listener>& new_listener,
         unsigned short port,
@@ -463,6 +541,15 @@ namespace dlib
         const std::string& local_ip = ""
     );
 
+    int create_connection ( 
+        std::unique_ptr<connection>& new_connection,
+        unsigned short foreign_port, 
+        const std::string& foreign_ip, 
+        unsigned short local_port,
+        const std::string& local_ip,
+        unsigned long timeout
+    );
+
     int create_connection (
         std::unique_ptr<connection>& new_connection,
         const std::string& path
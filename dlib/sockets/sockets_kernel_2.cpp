@@ -10,8 +10,10 @@
 
 #include "sockets_kernel_2.h"
 #include <fcntl.h>
+#include <algorithm>
 #include "../set.h"
 #include <netinet/tcp.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <string.h>
 
@@ -73,6 +75,22 @@ namespace dlib
         }
     }
 
+// ----------------------------------------------------------------------------------------
+
+    static int
+    poll_timeout (
+        unsigned long timeout
+    )
+    /*!
+        ensures
+            - returns timeout as the timeout argument of poll(), i.e. clamped so that
+              large values don't wrap around to 0 or to a negative number, which poll()
+              would take as waiting forever.
+    !*/
+    {
+        return static_cast<int>(std::min<unsigned long>(timeout, 0x7FFFFFFF));
+    }
+
 // ----------------------------------------------------------------------------------------
 
 
@@ -365,6 +383,71 @@ namespace dlib
         return 0;
     }
 
+// ----------------------------------------------------------------------------------------
+
+    int connection::
+    set_send_buffer_size (
+        long size
+    )
+    {
+        int value = static_cast<int>(size);
+        if (setsockopt(connection_socket, SOL_SOCKET, SO_SNDBUF, (char *)&value, sizeof(value)))
+            return OTHER_ERROR;
+        return 0;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    long connection::
+    get_send_buffer_size (
+    ) const
+    {
+        int value = 0;
+        dsocklen_t length = sizeof(value);
+        if (getsockopt(connection_socket, SOL_SOCKET, SO_SNDBUF, (char *)&value, &length))
+            return OTHER_ERROR;
+        return value;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    int connection::
+    set_receive_buffer_size (
+        long size
+    )
+    {
+        int value = static_cast<int>(size);
+        if (setsockopt(connection_socket, SOL_SOCKET, SO_RCVBUF, (char *)&value, sizeof(value)))
+            return OTHER_ERROR;
+        return 0;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    long connection::
+    get_receive_buffer_size (
+    ) const
+    {
+        int value = 0;
+        dsocklen_t length = sizeof(value);
+        if (getsockopt(connection_socket, SOL_SOCKET, SO_RCVBUF, (char *)&value, &length))
+            return OTHER_ERROR;
+        return value;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    int connection::
+    set_keepalive (
+        bool enabled
+    )
+    {
+        int flag = enabled ? 1 : 0;
+        if (setsockopt(connection_socket, SOL_SOCKET, SO_KEEPALIVE, (char *)&flag, sizeof(flag)))
+            return OTHER_ERROR;
+        return 0;
+    }
+
 // ----------------------------------------------------------------------------------------
 
     long connection::
@@ -404,6 +487,108 @@ namespace dlib
         return old_num;
     }
 
+// ----------------------------------------------------------------------------------------
+
+    long connection::
+    write (
+        const const_buffer* bufs,
+        unsigned long num_bufs
+    )
+    {
+        long total = 0;
+        for (unsigned long i = 0; i < num_bufs; ++i)
+            total += bufs[i].size;
+
+        // The buffer we are currently on and how much of it has been sent already.
+        unsigned long cur = 0;
+        long offset = 0;
+        while (true)
+        {
+            // Gather up as many of the remaining buffers as we can send in one call.
+            const int max_iovecs = 64;
+            iovec iov[max_iovecs];
+            int num_iovecs = 0;
+            for (unsigned long i = cur; i < num_bufs && num_iovecs < max_iovecs; ++i)
+            {
+                const long skip = (i == cur) ? offset : 0;
+                if (bufs[i].size - skip == 0)
+                    continue;
+                iov[num_iovecs].iov_base = const_cast<char*>(bufs[i].data + skip);
+                iov[num_iovecs].iov_len = bufs[i].size - skip;
+                ++num_iovecs;
+            }
+            if (num_iovecs == 0)
+                break;
+
+            msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = iov;
+            msg.msg_iovlen = num_iovecs;
+            long status = ::sendmsg(connection_socket, &msg, 0);
+            if (status <= 0)
+            {
+                // if send was interupted by a signal then restart it
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                else
+                {
+                    // check if shutdown or shutdown_outgoing have been called
+                    if (sdo_called())
+                        return SHUTDOWN;
+                    else
+                        return OTHER_ERROR;
+                }
+            }
+
+            // skip past the bytes that were sent
+            while (cur < num_bufs && status >= bufs[cur].size - offset)
+            {
+                status -= bufs[cur].size - offset;
+                offset = 0;
+                ++cur;
+            }
+            offset += status;
+        }
+        return total;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    long connection::
+    write_some (
+        const char* buf,
+        long num,
+        unsigned long timeout
+    )
+    {
+        if (writable(timeout) == false)
+        {
+            if (sdo_called())
+                return SHUTDOWN;
+            return TIMEOUT;
+        }
+
+        const long max_send_length = 1024*1024*100;
+        const long length = std::min(max_send_length, num);
+        // MSG_DONTWAIT makes send() write only as much as fits in the socket's send
+        // buffer rather than blocking until all of buf has been sent.
+        const long status = ::send(connection_socket, buf, length, MSG_DONTWAIT);
+        if (status <= 0)
+        {
+            // if send was interupted or the buffer filled up in the mean time then
+            // call this a timeout
+            if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)
+                return TIMEOUT;
+            else if (sdo_called())
+                return SHUTDOWN;
+            else
+                return OTHER_ERROR;
+        }
+        return status;
+    }
+
 // ----------------------------------------------------------------------------------------
 
     long connection::
@@ -485,29 +670,91 @@ namespace dlib
         return status;
     }
 
+// ----------------------------------------------------------------------------------------
+
+    long connection::
+    read (
+        const mutable_buffer* bufs,
+        unsigned long num_bufs
+    )
+    {
+        const int max_iovecs = 64;
+        iovec iov[max_iovecs];
+        int num_iovecs = 0;
+        for (unsigned long i = 0; i < num_bufs && num_iovecs < max_iovecs; ++i)
+        {
+            if (bufs[i].size == 0)
+                continue;
+            iov[num_iovecs].iov_base = bufs[i].data;
+            iov[num_iovecs].iov_len = bufs[i].size;
+            ++num_iovecs;
+        }
+
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = num_iovecs;
+        while (true)
+        {
+            long status = ::recvmsg(connection_socket, &msg, 0);
+            if (status == -1)
+            {
+                // if recv was interupted then try again
+                if (errno == EINTR)
+                    continue;
+                else
+                {
+                    if (sd_called())
+                        return SHUTDOWN;
+                    else
+                        return OTHER_ERROR;
+                }
+            }
+            else if (status == 0 && sd_called())
+            {
+                return SHUTDOWN;
+            }
+
+            return status;
+        }
+    }
+
 // ----------------------------------------------------------------------------------------
 
     bool connection::
-    readable (
+    writable (
         unsigned long timeout
     ) const
     {
-        fd_set read_set;
-        // initialize read_set
-        FD_ZERO(&read_set);
+        pollfd pfd;
+        pfd.fd = connection_socket;
+        pfd.events = POLLOUT;
+        pfd.revents = 0;
+
+        // If there is an error on the socket we also say it's writable since the next
+        // write will then report the error.
+        int status = poll(&pfd,1,poll_timeout(timeout));
+        return status > 0;
+    }
 
-        // add the listening socket to read_set
-        FD_SET(connection_socket, &read_set);
+// ----------------------------------------------------------------------------------------
 
-        // setup a timeval structure
-        timeval time_to_wait;
-        time_to_wait.tv_sec = static_cast<long>(timeout/1000);
-        time_to_wait.tv_usec = static_cast<long>((timeout%1000)*1000);
+    bool connection::
+    readable (
+        unsigned long timeout
+    ) const
+    {
+        // Use poll() rather than select() since select() can't handle socket handles
+        // >= FD_SETSIZE, which servers with many open connections run into.
+        pollfd pfd;
+        pfd.fd = connection_socket;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
 
-        // wait on select
-        int status = select(connection_socket+1,&read_set,0,0,&time_to_wait);
+        // wait on poll
+        int status = poll(&pfd,1,poll_timeout(timeout));
 
-        // if select timed out or there was an error
+        // if poll timed out or there was an error
         if (status <= 0)
             return false;
         
@@ -597,40 +844,31 @@ namespace dlib
         sockaddr_storage incomingAddr;
         dsocklen_t length = sizeof(sockaddr_storage);
 
-        // implement timeout with select if timeout is > 0
+        // implement timeout with poll if timeout is > 0
         if (timeout > 0)
         {
+            pollfd pfd;
+            pfd.fd = listening_socket;
+            pfd.events = POLLIN;
+            const int time_to_wait = poll_timeout(timeout);
 
-            fd_set read_set;
-            // initialize read_set
-            FD_ZERO(&read_set);
-
-            // add the listening socket to read_set
-            FD_SET(listening_socket, &read_set);
-
-            timeval time_to_wait;
-
-
-            // loop on select so if its interupted then we can start it again
+            // loop on poll so if its interupted then we can start it again
             while (true)
             {
+                pfd.revents = 0;
 
-                // setup a timeval structure
-                time_to_wait.tv_sec = static_cast<long>(timeout/1000);
-                time_to_wait.tv_usec = static_cast<long>((timeout%1000)*1000);
+                // wait on poll
+                int status = poll(&pfd,1,time_to_wait);
 
-                // wait on select
-                int status = select(listening_socket+1,&read_set,0,0,&time_to_wait);
-
-                // if select timed out
+                // if poll timed out
                 if (status == 0)
                     return TIMEOUT;
                 
-                // if select returned an error
+                // if poll returned an error
                 if (status == -1)
                 {
-                    // if select was interupted or the connection was aborted
-                    // then go back to select
+                    // if poll was interupted or the connection was aborted
+                    // then go back to poll
                     if (errno == EINTR || 
                         errno == ECONNABORTED || 
 #ifdef EPROTO
@@ -1120,6 +1358,27 @@ namespace dlib
         return status;
     }
 
+// ----------------------------------------------------------------------------------------
+
+    int create_connection (
+        std::unique_ptr<connection>& new_connection,
+        unsigned short foreign_port, 
+        const std::string& foreign_ip, 
+        unsigned short local_port,
+        const std::string& local_ip,
+        unsigned long timeout
+    )
+    {
+        new_connection.reset();
+        connection* temp;
+        int status = create_connection(temp,foreign_port, foreign_ip, local_port, local_ip, timeout);
+
+        if (status == 0)
+            new_connection.reset(temp);
+
+        return status;
+    }
+
     int 
     create_connection ( 
         connection*& new_connection,
@@ -1128,6 +1387,88 @@ namespace dlib
         unsigned short local_port,
         const std::string& local_ip
     )
+    {
+        return create_connection(new_connection, foreign_port, foreign_ip, local_port, local_ip, 0);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    static int 
+    connect_with_timeout (
+        int sock,
+        const sockaddr_in& foreign_sa,
+        unsigned long timeout
+    )
+    /*!
+        ensures
+            - connects sock to foreign_sa.  If timeout != 0 then it gives up after
+              timeout milliseconds.
+            - returns 0 on success, TIMEOUT if the timeout expired, and OTHER_ERROR
+              with errno set if there was some other error.
+    !*/
+    {
+        if (timeout == 0)
+        {
+            if (::connect(sock, reinterpret_cast<const sockaddr*>(&foreign_sa), sizeof(sockaddr_in)) == -1)
+                return OTHER_ERROR;
+            return 0;
+        }
+
+        // Do a non-blocking connect and then wait for it to finish.
+        const int flags = fcntl(sock, F_GETFL, 0);
+        if (flags == -1 || fcntl(sock, F_SETFL, flags | O_NONBLOCK) == -1)
+            return OTHER_ERROR;
+
+        int status = ::connect(sock, reinterpret_cast<const sockaddr*>(&foreign_sa), sizeof(sockaddr_in));
+        if (status == -1 && errno == EINPROGRESS)
+        {
+            pollfd pfd;
+            pfd.fd = sock;
+            pfd.events = POLLOUT;
+            pfd.revents = 0;
+            do
+            {
+                status = poll(&pfd, 1, poll_timeout(timeout));
+            } while (status == -1 && errno == EINTR);
+
+            if (status == 0)
+                return TIMEOUT;
+            if (status == -1)
+                return OTHER_ERROR;
+
+            // the connect finished, so see if it worked
+            int err = 0;
+            dsocklen_t length = sizeof(err);
+            if (getsockopt(sock, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&err), &length) == -1)
+                return OTHER_ERROR;
+            if (err != 0)
+            {
+                errno = err;
+                return OTHER_ERROR;
+            }
+        }
+        else if (status == -1)
+        {
+            return OTHER_ERROR;
+        }
+
+        // put the socket back into blocking mode
+        if (fcntl(sock, F_SETFL, flags) == -1)
+            return OTHER_ERROR;
+        return 0;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    int 
+    create_connection ( 
+        connection*& new_connection,
+        unsigned short foreign_port, 
+        const std::string& foreign_ip, 
+        unsigned short local_port,
+        const std::string& local_ip,
+        unsigned long timeout
+    )
     {
         sockets_startup();
         
@@ -1201,16 +1542,15 @@ namespace dlib
         }
 
         // connect the socket        
-        if ( connect (
-                sock,
-                reinterpret_cast<sockaddr*>(&foreign_sa),
-                sizeof(sockaddr_in)
-            ) == -1
-        )
+        const int connect_status = connect_with_timeout(sock, foreign_sa, timeout);
+        if (connect_status != 0)
         {
+            const int err = errno;
             close_socket(sock); 
+            if (connect_status == TIMEOUT)
+                return TIMEOUT;
             // if the port is already bound then return PORTINUSE
-            if (errno == EADDRINUSE)
+            if (err == EADDRINUSE)
                 return PORTINUSE;
             else
                 return OTHER_ERROR;    
@@ -274,6 +274,44 @@ namespace dlib
         std::unique_ptr smart pointer instead of a C pointer.
     !*/
 
+    int create_connection ( 
+        connection*& new_connection,
+        unsigned short foreign_port, 
+        const std::string& foreign_ip, 
+        unsigned short local_port,
+        const std::string& local_ip,
+        unsigned long timeout
+    );
+    /*!
+        requires
+            - 0 <  foreign_port <= 65535 
+            - 0 <= local_port   <= 65535
+            - timeout < 2000000
+        ensures
+            - This function is identical to the create_connection() above except that
+              if (timeout != 0) then it does a non-blocking connect and gives up if the
+              connection hasn't been established after timeout milliseconds.  If
+              timeout == 0 then it waits as long as the operating system does.
+            - returns 0 if create_connection was successful 
+            - returns TIMEOUT if the connection couldn't be made within timeout
+              milliseconds
+            - returns PORTINUSE if the specified local port was already in use 
+            - returns OTHER_ERROR if some other error occurred
+    !*/
+
+    int create_connection ( 
+        std::unique_ptr<connection>& new_connection,
+        unsigned short foreign_port, 
+        const std::string& foreign_ip, 
+        unsigned short local_port,
+        const std::string& local_ip,
+        unsigned long timeout
+    );
+    /*!
+        This function is just an overload of the above function but it gives you a
+        std::unique_ptr smart pointer instead of a C pointer.
+    !*/
+
     int create_connection (
         connection*& new_connection,
         const std::string& path
@@ -341,7 +379,7 @@ namespace dlib
                 - you may NOT call any function more than once at a time (except the 
                   shutdown functions).
                 - do not call read() more than once at a time
-                - do not call write() more than once at a time
+                - do not call write() or write_some() more than once at a time
                 - You can safely call shutdown or shutdown_outgoing in conjunction with 
                   the read/write functions.
                     This is helpful if you want to unblock another thread that is 
@@ -394,6 +432,72 @@ namespace dlib
                   shutdown locally
         !*/
 
+        struct const_buffer
+        {
+            /*!
+                This is a pointer to size bytes of data to be written.
+            !*/
+            const char* data;
+            long size;
+        };
+
+        long write (
+            const const_buffer* bufs,
+            unsigned long num_bufs
+        );
+        /*!
+            requires
+                - bufs points to an array of num_bufs const_buffer objects
+                - for all valid i:
+                    - bufs[i].size >= 0
+                    - bufs[i].data points to an array of at least bufs[i].size bytes
+            ensures
+                - Writes the contents of all the buffers, one after another, to the
+                  connection.  This is the same as calling write() on each buffer in
+                  turn except that the operating system is given all of them at once
+                  (i.e. this is a gather write, like writev()).  So a small header
+                  followed by a payload goes out in one system call and, when Nagle's
+                  algorithm is enabled, usually in one packet.
+                - will block until ONE of the following occurs:
+                    - all the bytes have been written to the connection 
+                    - an error has occurred
+                    - the outgoing channel of the connection has been shutdown locally
+
+                - returns the total number of bytes in the buffers if the write
+                  succeeded 
+                - returns OTHER_ERROR if there was an error (this could be due to a 
+                  connection close)
+                - returns SHUTDOWN if the outgoing channel of the connection has been 
+                  shutdown locally
+        !*/
+
+        long write_some (
+            const char* buf,
+            long num,
+            unsigned long timeout
+        );
+        /*!
+            requires
+                - num > 0 
+                - buf points to an array of at least num bytes
+                - timeout < 2000000                
+            ensures
+                - Writes as many of the bytes in buf to the connection as can be written
+                  without blocking, which may be fewer than num.  
+                - if (timeout > 0) then write_some() waits up to timeout milliseconds
+                  for there to be room in the connection's send buffer.
+                - else
+                    - write_some() does not block
+
+                - returns the number of bytes written if any were written.
+                - returns TIMEOUT if nothing could be written within timeout
+                  milliseconds.
+                - returns OTHER_ERROR if there was an error (this could be due to a 
+                  connection close)
+                - returns SHUTDOWN if the outgoing channel of the connection has been 
+                  shutdown locally
+        !*/
+
         long read (
             char* buf, 
             long num
@@ -444,6 +548,43 @@ namespace dlib
                 - returns SHUTDOWN if the connection has been shutdown locally
         !*/
 
+        struct mutable_buffer
+        {
+            /*!
+                This is a pointer to size bytes of memory to read into.
+            !*/
+            char* data;
+            long size;
+        };
+
+        long read (
+            const mutable_buffer* bufs,
+            unsigned long num_bufs
+        );
+        /*!
+            requires
+                - bufs points to an array of num_bufs mutable_buffer objects
+                - the total size of all the buffers is > 0
+                - for all valid i:
+                    - bufs[i].size >= 0
+                    - bufs[i].data points to an array of at least bufs[i].size bytes
+            ensures
+                - This function behaves just like read(buf,num) except that the data is
+                  scattered across the given buffers (i.e. this is a scatter read, like
+                  readv()).  That is, the buffers are filled one after another and
+                  the returned number of bytes is spread over them in that order. 
+                - blocks until ONE of the following happens:
+                    - there is some data available and it has been written into #bufs
+                    - the remote end of the connection is closed 
+                    - an error has occurred
+                    - the connection has been shutdown locally
+
+                - returns the number of bytes read if there was any data.
+                - returns 0 if the connection has ended/terminated and there is no more data.
+                - returns OTHER_ERROR if there was an error.
+                - returns SHUTDOWN if the connection has been shutdown locally
+        !*/
+
         unsigned short get_local_port (
         ) const;
         /*!
@@ -540,6 +681,64 @@ namespace dlib
                 - returns OTHER_ERROR if there was an error 
         !*/
 
+        int set_send_buffer_size (
+            long size
+        );
+        /*!
+            requires
+                - size > 0
+            ensures
+                - Sets the SO_SNDBUF socket option, i.e. asks the operating system to use
+                  a send buffer of size bytes for this connection.  The operating system
+                  is free to adjust this value.  For example, Linux doubles it.
+                - returns 0 upon success
+                - returns OTHER_ERROR if there was an error 
+        !*/
+
+        long get_send_buffer_size (
+        ) const;
+        /*!
+            ensures
+                - returns the size in bytes of this connection's send buffer (i.e. the
+                  SO_SNDBUF socket option).
+                - returns OTHER_ERROR if there was an error 
+        !*/
+
+        int set_receive_buffer_size (
+            long size
+        );
+        /*!
+            requires
+                - size > 0
+            ensures
+                - Sets the SO_RCVBUF socket option, i.e. asks the operating system to use
+                  a receive buffer of size bytes for this connection.  The operating
+                  system is free to adjust this value.  
+                - returns 0 upon success
+                - returns OTHER_ERROR if there was an error 
+        !*/
+
+        long get_receive_buffer_size (
+        ) const;
+        /*!
+            ensures
+                - returns the size in bytes of this connection's receive buffer (i.e. the
+                  SO_RCVBUF socket option).
+                - returns OTHER_ERROR if there was an error 
+        !*/
+
+        int set_keepalive (
+            bool enabled
+        );
+        /*!
+            ensures
+                - Sets the SO_KEEPALIVE socket option.  When enabled the operating system
+                  periodically probes an idle connection so that a dead peer is
+                  eventually noticed.
+                - returns 0 upon success
+                - returns OTHER_ERROR if there was an error 
+        !*/
+
         typedef platform_specific_type socket_descriptor_type;
         socket_descriptor_type get_socket_descriptor (
         ) const;
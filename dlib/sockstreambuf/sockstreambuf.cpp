@@ -6,7 +6,9 @@
 #include "sockstreambuf.h"
 #include "../assert.h"
 
+#include <algorithm>
 #include <cstring>
+#include <limits>
 
 namespace dlib
 {
@@ -56,6 +58,27 @@ namespace dlib
             pbump(static_cast<int>(num));
             return num;
         }
+        else if (num - space_left >= out_buffer_size)
+        {
+            // The data is too big to go through out_buffer anyway.  So rather than
+            // topping off the buffer, flushing it, and then writing the rest, we hand
+            // whatever is in the buffer and the new data to the connection in one gather
+            // write.  This way something like a small header followed by a big payload
+            // goes out with one system call.
+            const long num_buffered = static_cast<long>(pptr()-pbase());
+            connection::const_buffer bufs[2];
+            bufs[0].data = pbase();
+            bufs[0].size = num_buffered;
+            bufs[1].data = s;
+            bufs[1].size = static_cast<long>(num);
+            if (con.write(bufs, 2) != num_buffered + static_cast<long>(num))
+            {
+                // the write was not successful so return that 0 bytes were written
+                return 0;
+            }
+            pbump(-num_buffered);
+            return num;
+        }
         else
         {
             std::memcpy(pptr(),s,static_cast<size_t>(space_left));
@@ -69,21 +92,9 @@ namespace dlib
                 return 0;
             }
 
-            if (num_left < out_buffer_size)
-            {
-                std::memcpy(pptr(),s,static_cast<size_t>(num_left));
-                pbump(num_left);
-                return num;
-            }
-            else
-            {
-                if (con.write(s,num_left) != num_left)
-                {
-                    // the write was not successful so return that 0 bytes were written
-                    return 0;
-                } 
-                return num;
-            }
+            std::memcpy(pptr(),s,static_cast<size_t>(num_left));
+            pbump(num_left);
+            return num;
         }
     }
 
@@ -91,15 +102,12 @@ namespace dlib
     // input functions
 // ---------------------------------------------------------------------------------------- 
 
-    sockstreambuf::int_type sockstreambuf::
-    underflow( 
+    long sockstreambuf::
+    fill_in_buffer (
+        bool use_timeout,
+        unsigned long timeout
     )
     {
-        if (gptr() < egptr())
-        {
-            return static_cast<unsigned char>(*gptr());
-        }
-
         int num_put_back = static_cast<int>(gptr() - eback());
         if (num_put_back > max_putback)
         {
@@ -118,11 +126,14 @@ namespace dlib
             }
         }
 
-        int num = con.read(in_buffer.get()+max_putback, in_buffer_size-max_putback);
+        long num;
+        if (use_timeout)
+            num = con.read(in_buffer.get()+max_putback, in_buffer_size-max_putback, timeout);
+        else
+            num = con.read(in_buffer.get()+max_putback, in_buffer_size-max_putback);
         if (num <= 0)
         {
-            // an error occurred or the connection is over which is EOF
-            return EOF;
+            return num;
         }
 
         // reset in_buffer pointers
@@ -130,9 +141,49 @@ namespace dlib
               in_buffer.get()+max_putback,
               in_buffer.get()+max_putback+num);
 
+        return num;
+    }
+
+// ---------------------------------------------------------------------------------------- 
+
+    sockstreambuf::int_type sockstreambuf::
+    underflow( 
+    )
+    {
+        if (gptr() < egptr())
+        {
+            return static_cast<unsigned char>(*gptr());
+        }
+
+        if (fill_in_buffer(false, 0) <= 0)
+        {
+            // an error occurred or the connection is over which is EOF
+            return EOF;
+        }
+
         return static_cast<unsigned char>(*gptr());
     }
 
+// ---------------------------------------------------------------------------------------- 
+
+    long sockstreambuf::
+    wait_for_data (
+        unsigned long timeout
+    )
+    {
+        DLIB_ASSERT(timeout < 2000000,
+            "\tlong sockstreambuf::wait_for_data(timeout)"
+            << "\n\t invalid arguments were given to this function"
+            << "\n\t timeout: " << timeout
+            << "\n\t this:    " << this
+        );
+
+        if (gptr() < egptr())
+            return static_cast<long>(egptr() - gptr());
+
+        return fill_in_buffer(true, timeout);
+    }
+
 // ---------------------------------------------------------------------------------------- 
 
     std::streamsize sockstreambuf::
@@ -156,6 +207,29 @@ namespace dlib
             // read more data into our buffer  
             if (num == 0)
             {
+                // Big reads go straight into the caller's memory rather than being copied
+                // through in_buffer.
+                if (n >= in_buffer_size-max_putback)
+                {
+                    if (flushes_output_on_read() && flush_out_buffer() == EOF)
+                        break;
+
+                    const long num_read = con.read(s, static_cast<long>(std::min<std::streamsize>(n, std::numeric_limits<int>::max())));
+                    if (num_read <= 0)
+                        break;
+
+                    // keep the last few bytes we read around as the put back area
+                    const long num_put_back = std::min<long>(num_read, max_putback);
+                    std::memcpy(in_buffer.get()+(max_putback-num_put_back), s+num_read-num_put_back, num_put_back);
+                    setg(in_buffer.get()+(max_putback-num_put_back),
+                         in_buffer.get()+max_putback,
+                         in_buffer.get()+max_putback);
+
+                    n -= num_read;
+                    s += num_read;
+                    continue;
+                }
+
                 if (underflow() == EOF)
                     break;
                 continue;
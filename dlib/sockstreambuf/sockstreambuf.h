@@ -99,6 +99,10 @@ namespace dlib
             autoflush = false;
         }
 
+        long wait_for_data (
+            unsigned long timeout
+        );
+
     protected:
 
         void init (
@@ -155,6 +159,19 @@ namespace dlib
 
     private:
 
+        long fill_in_buffer (
+            bool use_timeout,
+            unsigned long timeout
+        );
+        /*!
+            ensures
+                - reads more data from con into in_buffer, keeping up to max_putback of
+                  the already read characters as the put back area.  If use_timeout is
+                  true then con.read(..., timeout) is used, otherwise the read blocks.
+                - returns the value returned by con.read(), or EOF if flushing the output
+                  buffer failed.
+        !*/
+
         // member data
         connection&  con;
         const std::streamsize out_buffer_size;
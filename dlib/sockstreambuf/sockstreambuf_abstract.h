@@ -141,6 +141,31 @@ namespace dlib
                 - #flushes_output_on_read() == false
         !*/
 
+        long wait_for_data (
+            unsigned long timeout
+        );
+        /*!
+            requires
+                - timeout < 2000000
+            ensures
+                - if (this object already holds buffered input that hasn't been read) then
+                    - returns the number of buffered bytes immediately.
+                - else
+                    - Waits up to timeout milliseconds for data to arrive on
+                      get_connection() and puts it into the input buffer.  If timeout == 0
+                      then this function doesn't wait at all.  The data is then available
+                      to the next read through this streambuf.
+                    - returns the number of bytes that arrived, if any did.
+                    - returns 0 if the connection has ended and there is no more data.
+                    - returns TIMEOUT if timeout milliseconds elapsed before any data
+                      arrived.
+                    - returns OTHER_ERROR or SHUTDOWN on errors, just like
+                      connection::read().
+                - This function allows a server to wait a bounded amount of time for the
+                  next request on an idle connection, e.g. an HTTP keep-alive connection,
+                  without giving up the streambuf's buffering.
+        !*/
+
     };
 
 // ---------------------------------------------------------------------------------------- 
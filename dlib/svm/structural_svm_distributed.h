@@ -3,6 +3,7 @@
 #ifndef DLIB_STRUCTURAL_SVM_DISTRIBUTeD_Hh_
 #define DLIB_STRUCTURAL_SVM_DISTRIBUTeD_Hh_
 
+#include <algorithm>
 #include <memory>
 #include <iostream>
 #include <vector>
@@ -33,12 +34,14 @@ namespace dlib
             matrix_type subgradient;
             scalar_type loss;
             long num;
+            unsigned long id;
 
             friend void swap (oracle_response& a, oracle_response& b)
             {
                 a.subgradient.swap(b.subgradient);
                 std::swap(a.loss, b.loss);
                 std::swap(a.num, b.num);
+                std::swap(a.id, b.id);
             }
 
             friend void serialize (const oracle_response& item, std::ostream& out)
@@ -46,6 +49,7 @@ namespace dlib
                 serialize(item.subgradient, out);
                 dlib::serialize(item.loss, out);
                 dlib::serialize(item.num, out);
+                dlib::serialize(item.id, out);
             }
 
             friend void deserialize (oracle_response& item, std::istream& in)
@@ -53,6 +57,7 @@ namespace dlib
                 deserialize(item.subgradient, in);
                 dlib::deserialize(item.loss, in);
                 dlib::deserialize(item.num, in);
+                dlib::deserialize(item.id, in);
             }
         };
 
@@ -61,35 +66,114 @@ namespace dlib
         template <typename matrix_type>
         struct oracle_request
         {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    This is a request to run the separation oracle on the samples
+                    [begin, end) of a processing node.  
+
+                    Each node keeps a copy of the current solution and this object
+                    carries the changes to it.  If is_delta == false then solution is the
+                    whole new solution vector.  Otherwise, only the elements in
+                    changed_dims are different from the last solution the node was sent.
+                    In that case solution(i) is the new value of the element at index
+                    changed_dims[0] + ... + changed_dims[i].  We store the distance from
+                    one changed element to the next since these are mostly small numbers
+                    and dlib's serialization makes small numbers small.
+            !*/
+
             typedef typename matrix_type::type scalar_type;
 
-            matrix_type current_solution;
+            matrix_type solution;
+            std::vector<unsigned long> changed_dims;
+            bool is_delta;
             scalar_type saved_current_risk_gap;
             bool skip_cache;
             bool converged;
+            long begin;
+            long end;
+            unsigned long id;
+
+            void update_solution (
+                matrix_type& w
+            ) const
+            {
+                if (!is_delta)
+                {
+                    w = solution;
+                    return;
+                }
+
+                unsigned long idx = 0;
+                for (unsigned long i = 0; i < changed_dims.size(); ++i)
+                {
+                    idx += changed_dims[i];
+                    w(idx) = solution(i);
+                }
+            }
 
             friend void swap (oracle_request& a, oracle_request& b)
             {
-                a.current_solution.swap(b.current_solution);
+                a.solution.swap(b.solution);
+                a.changed_dims.swap(b.changed_dims);
+                std::swap(a.is_delta, b.is_delta);
                 std::swap(a.saved_current_risk_gap, b.saved_current_risk_gap);
                 std::swap(a.skip_cache, b.skip_cache);
                 std::swap(a.converged, b.converged);
+                std::swap(a.begin, b.begin);
+                std::swap(a.end, b.end);
+                std::swap(a.id, b.id);
             }
 
             friend void serialize (const oracle_request& item, std::ostream& out)
             {
-                serialize(item.current_solution, out);
+                serialize(item.solution, out);
+                dlib::serialize(item.changed_dims, out);
+                dlib::serialize(item.is_delta, out);
                 dlib::serialize(item.saved_current_risk_gap, out);
                 dlib::serialize(item.skip_cache, out);
                 dlib::serialize(item.converged, out);
+                dlib::serialize(item.begin, out);
+                dlib::serialize(item.end, out);
+                dlib::serialize(item.id, out);
             }
 
             friend void deserialize (oracle_request& item, std::istream& in)
             {
-                deserialize(item.current_solution, in);
+                deserialize(item.solution, in);
+                dlib::deserialize(item.changed_dims, in);
+                dlib::deserialize(item.is_delta, in);
                 dlib::deserialize(item.saved_current_risk_gap, in);
                 dlib::deserialize(item.skip_cache, in);
                 dlib::deserialize(item.converged, in);
+                dlib::deserialize(item.begin, in);
+                dlib::deserialize(item.end, in);
+                dlib::deserialize(item.id, in);
+            }
+        };
+
+    // ----------------------------------------------------------------------------------------
+
+        struct node_description
+        {
+            long num_dimensions;
+            long num_samples;
+
+            friend void swap (node_description& a, node_description& b)
+            {
+                std::swap(a.num_dimensions, b.num_dimensions);
+                std::swap(a.num_samples, b.num_samples);
+            }
+
+            friend void serialize (const node_description& item, std::ostream& out)
+            {
+                dlib::serialize(item.num_dimensions, out);
+                dlib::serialize(item.num_samples, out);
+            }
+
+            friend void deserialize (node_description& item, std::istream& in)
+            {
+                dlib::deserialize(item.num_dimensions, in);
+                dlib::deserialize(item.num_samples, in);
             }
         };
 
@@ -174,31 +258,25 @@ namespace dlib
 
                 while (in.dequeue(msg))
                 {
-                    // initialize the cache and compute psi_true.
+                    // initialize the cache
                     if (cache.size() == 0)
                     {
                         cache.resize(problem.get_num_samples());
                         for (unsigned long i = 0; i < cache.size(); ++i)
                             cache[i].init(&problem,i);
-
-                        psi_true.set_size(problem.get_num_dimensions(),1);
-                        psi_true = 0;
-
-                        const unsigned long num = problem.get_num_samples();
-                        feature_vector_type ftemp;
-                        for (unsigned long i = 0; i < num; ++i)
-                        {
-                            cache[i].get_truth_joint_feature_vector_cached(ftemp);
-
-                            subtract_from(psi_true, ftemp);
-                        }
                     }
 
 
                     if (msg.template contains<bridge_status>() && 
                         msg.template get<bridge_status>().is_connected)
                     {
-                        temp = problem.get_num_dimensions();
+                        // A new controller starts out from the all zero solution.
+                        current_solution.set_size(problem.get_num_dimensions(),1);
+                        current_solution = 0;
+
+                        node_description& desc = temp.template get<node_description>();
+                        desc.num_dimensions = problem.get_num_dimensions();
+                        desc.num_samples = problem.get_num_samples();
                         out.enqueue(temp);
 
                     }
@@ -207,13 +285,26 @@ namespace dlib
                         ++num_iterations_executed;
 
                         const oracle_request<matrix_type>& req = msg.template get<oracle_request<matrix_type> >();
+                        req.update_solution(current_solution);
 
                         oracle_response<matrix_type>& data = temp.template get<oracle_response<matrix_type> >();
 
-                        data.subgradient = psi_true;
+                        // If we are asked for all our samples then we can use the
+                        // precomputed sum of their true PSI vectors.  Otherwise they get
+                        // subtracted one at a time along with the oracle outputs.
+                        const bool all_samples = req.begin == 0 && req.end == problem.get_num_samples();
+                        if (all_samples)
+                        {
+                            data.subgradient = get_psi_true();
+                        }
+                        else
+                        {
+                            data.subgradient.set_size(problem.get_num_dimensions(),1);
+                            data.subgradient = 0;
+                        }
                         data.loss = 0;
-
-                        data.num = problem.get_num_samples();
+                        data.num = req.end - req.begin;
+                        data.id = req.id;
 
                         const uint64 start_time = ts.get_timestamp();
 
@@ -227,29 +318,52 @@ namespace dlib
                             buffer_subgradients_locally = !buffer_subgradients_locally;
                         }
 
-                        binder b(*this, req, data, buffer_subgradients_locally);
-                        parallel_for_blocked(tp, 0, data.num, b, &binder::call_oracle);
+                        binder b(*this, req, data, buffer_subgradients_locally, !all_samples);
+                        parallel_for_blocked(tp, req.begin, req.end, b, &binder::call_oracle);
 
-                        const uint64 stop_time = ts.get_timestamp();
+                        // The requests can be for any number of samples so we keep track
+                        // of the time per sample.
+                        const double time_per_sample = (ts.get_timestamp()-start_time)/std::max<double>(1, data.num);
                         if (buffer_subgradients_locally)
-                            with_buffer_time.add(stop_time-start_time);
+                            with_buffer_time.add(time_per_sample);
                         else
-                            without_buffer_time.add(stop_time-start_time);
+                            without_buffer_time.add(time_per_sample);
 
                         out.enqueue(temp);
                     }
                 }
             }
 
+            const matrix_type& get_psi_true (
+            ) 
+            {
+                if (psi_true.size() == 0)
+                {
+                    psi_true.set_size(problem.get_num_dimensions(),1);
+                    psi_true = 0;
+
+                    feature_vector_type ftemp;
+                    for (unsigned long i = 0; i < cache.size(); ++i)
+                    {
+                        cache[i].get_truth_joint_feature_vector_cached(ftemp);
+
+                        subtract_from(psi_true, ftemp);
+                    }
+                }
+                return psi_true;
+            }
+
             struct binder
             {
                 binder (
                     const node_type& self_,
                     const impl::oracle_request<matrix_type>& req_,
                     impl::oracle_response<matrix_type>& data_,
-                    bool buffer_subgradients_locally_
+                    bool buffer_subgradients_locally_,
+                    bool subtract_true_psi_
                 ) : self(self_), req(req_), data(data_),
-                    buffer_subgradients_locally(buffer_subgradients_locally_) {}
+                    buffer_subgradients_locally(buffer_subgradients_locally_),
+                    subtract_true_psi(subtract_true_psi_) {}
 
                 void call_oracle (
                     long begin,
@@ -266,19 +380,23 @@ namespace dlib
                     if (end-begin <= 1 || !buffer_subgradients_locally)
                     {
                         scalar_type loss;
-                        feature_vector_type ftemp;
+                        feature_vector_type ftemp, ftrue;
                         for (long i = begin; i < end; ++i)
                         {
                             self.cache[i].separation_oracle_cached(req.converged, 
                                                                    req.skip_cache, 
                                                                    req.saved_current_risk_gap,
-                                                                   req.current_solution,
+                                                                   self.current_solution,
                                                                    loss,
                                                                    ftemp);
+                            if (subtract_true_psi)
+                                self.cache[i].get_truth_joint_feature_vector_cached(ftrue);
 
                             auto_mutex lock(self.accum_mutex);
                             data.loss += loss;
                             add_to(data.subgradient, ftemp);
+                            if (subtract_true_psi)
+                                subtract_from(data.subgradient, ftrue);
                         }
                     }
                     else
@@ -295,11 +413,16 @@ namespace dlib
                             self.cache[i].separation_oracle_cached(req.converged,
                                                                    req.skip_cache, 
                                                                    req.saved_current_risk_gap,
-                                                                   req.current_solution,
+                                                                   self.current_solution,
                                                                    loss_temp,
                                                                    ftemp);
                             loss += loss_temp;
                             add_to(faccum, ftemp);
+                            if (subtract_true_psi)
+                            {
+                                self.cache[i].get_truth_joint_feature_vector_cached(ftemp);
+                                subtract_from(faccum, ftemp);
+                            }
                         }
 
                         auto_mutex lock(self.accum_mutex);
@@ -312,18 +435,20 @@ namespace dlib
                 const impl::oracle_request<matrix_type>& req;
                 impl::oracle_response<matrix_type>& data;
                 bool buffer_subgradients_locally;
+                bool subtract_true_psi;
             };
 
 
 
             typedef type_safe_union<impl::oracle_request<matrix_type>, bridge_status> tsu_in;
-            typedef type_safe_union<impl::oracle_response<matrix_type> , long> tsu_out;
+            typedef type_safe_union<impl::oracle_response<matrix_type> , impl::node_description> tsu_out;
 
             pipe<tsu_in> in;
             pipe<tsu_out> out;
             bridge b;
 
-            mutable matrix_type psi_true;
+            matrix_type psi_true;
+            matrix_type current_solution;
             const structural_svm_problem<matrix_type,feature_vector_type>& problem;
             mutable std::vector<cache_element_structural_svm<structural_svm_problem<matrix_type,feature_vector_type> > > cache;
 
@@ -347,7 +472,8 @@ namespace dlib
             max_iterations(10000),
             cache_based_eps(std::numeric_limits<double>::infinity()),
             verbose(false),
-            C(1)
+            C(1),
+            load_balancing(false)
         {}
 
         double get_cache_based_epsilon (
@@ -446,6 +572,21 @@ namespace dlib
         ) { nuclear_norm_regularizers.clear(); }
 
 
+        void enable_load_balancing (
+        )
+        {
+            load_balancing = true;
+        }
+
+        void disable_load_balancing (
+        )
+        {
+            load_balancing = false;
+        }
+
+        bool load_balancing_enabled (
+        ) const { return load_balancing; }
+
         double get_c (
         ) const { return C; }
 
@@ -522,7 +663,7 @@ namespace dlib
                         << "\n\t this: " << this
             );
 
-            problem_type<matrix_type> problem(nodes);
+            problem_type<matrix_type> problem(nodes, load_balancing);
             problem.set_cache_based_epsilon(cache_based_eps);
             problem.set_epsilon(eps);
             problem.set_max_iterations(max_iterations);
@@ -560,11 +701,13 @@ namespace dlib
             typedef matrix_type_ matrix_type;
 
             problem_type (
-                const std::vector<network_address>& nodes_
+                const std::vector<network_address>& nodes_,
+                bool load_balancing_
             ) :
                 nodes(nodes_),
                 in(3),
-                num_dims(0)
+                num_dims(0),
+                load_balancing(load_balancing_)
             {
 
                 // initialize all the transmit pipes
@@ -592,18 +735,29 @@ namespace dlib
                 while (responses < nodes.size())
                 {
                     in.dequeue(temp);
-                    if (temp.template contains<long>())
+                    if (temp.template contains<impl::node_description>())
                     {
                         ++responses;
+                        const impl::node_description& desc = temp.template get<impl::node_description>();
                         // if this new dimension doesn't match what we have seen previously
-                        if (seen_dim && num_dims != temp.template get<long>())
+                        if (seen_dim && num_dims != desc.num_dimensions)
                         {
                             throw invalid_problem("remote hosts disagree on the number of dimensions!");
                         }
                         seen_dim = true;
-                        num_dims = temp.template get<long>();
+                        num_dims = desc.num_dimensions;
+                        num_samples.push_back(desc.num_samples);
                     }
                 }
+
+                if (load_balancing && min(mat(num_samples)) != max(mat(num_samples)))
+                {
+                    throw invalid_problem("remote hosts must all have the same samples to use load balancing!");
+                }
+
+                // This is the solution each processing node starts out with.
+                last_solution.set_size(num_dims,1);
+                last_solution = 0;
             }
 
             // These functions are just here because the structural_svm_problem requires
@@ -629,29 +783,79 @@ namespace dlib
                 subgradient.set_size(w.size(),1);
                 subgradient = 0;
 
+                // The first request each node gets in this iteration tells it how w
+                // changed since the last iteration.  Any more requests just say which
+                // samples to process.
+                oracle_request<matrix_type> update;
+                encode_solution_update(w, update);
+                update.saved_current_risk_gap = this->saved_current_risk_gap;
+                update.skip_cache = this->skip_cache;
+                update.converged = this->converged;
+
+                oracle_request<matrix_type> more_work;
+                more_work.is_delta = true;
+                more_work.saved_current_risk_gap = this->saved_current_risk_gap;
+                more_work.skip_cache = this->skip_cache;
+                more_work.converged = this->converged;
+
+                // Each node starts out with its own contiguous range of samples.  If we
+                // aren't load balancing that's all the node's samples.  Otherwise all the
+                // nodes have the same samples and we split them evenly.  
+                const unsigned long num_nodes = out_pipes.size();
+                std::vector<std::pair<long,long> > remaining(num_nodes);
+                for (unsigned long i = 0; i < num_nodes; ++i)
+                {
+                    if (load_balancing)
+                        remaining[i] = std::make_pair(i*num_samples[i]/num_nodes, (i+1)*num_samples[i]/num_nodes);
+                    else
+                        remaining[i] = std::make_pair(0L, num_samples[i]);
+                }
+                const long chunk_size = std::max<long>(1, num_samples[0]/(num_nodes*chunks_per_node));
+
                 // send out all the oracle requests
                 tsu_out temp_out;
-                for (unsigned long i = 0; i < out_pipes.size(); ++i)
+                unsigned long outstanding = 0;
+                for (unsigned long i = 0; i < num_nodes; ++i)
                 {
-                    temp_out.template get<oracle_request<matrix_type> >().current_solution = w;
-                    temp_out.template get<oracle_request<matrix_type> >().saved_current_risk_gap = this->saved_current_risk_gap;
-                    temp_out.template get<oracle_request<matrix_type> >().skip_cache = this->skip_cache;
-                    temp_out.template get<oracle_request<matrix_type> >().converged = this->converged;
+                    oracle_request<matrix_type>& req = temp_out.template get<oracle_request<matrix_type> >();
+                    req = update;
+                    req.id = i;
+                    if (load_balancing)
+                        next_chunk(remaining, i, chunk_size, req.begin, req.end);
+                    else
+                    {
+                        req.begin = remaining[i].first;
+                        req.end = remaining[i].second;
+                    }
                     out_pipes[i]->enqueue(temp_out);
+                    ++outstanding;
                 }
+                // When load balancing, give each node a second chunk to work on so it
+                // doesn't sit idle while we receive its results and send it more work.
+                for (unsigned long i = 0; i < num_nodes && load_balancing; ++i)
+                    send_chunk(remaining, i, chunk_size, more_work, outstanding);
+
+                // The nuclear norm part of the risk doesn't depend on the oracle outputs,
+                // so we compute it while the processing nodes run the oracles.
+                matrix_type nuclear_norm_grad;
+                double nuclear_norm_obj = 0;
+                if (this->nuclear_norm_regularizers.size() != 0)
+                    this->compute_nuclear_norm_parts(w, nuclear_norm_grad, nuclear_norm_obj);
 
                 // collect all the oracle responses  
                 long num = 0;
                 scalar_type total_loss = 0;
                 tsu_in temp_in;
-                unsigned long responses = 0;
-                while (responses < out_pipes.size())
+                while (outstanding != 0)
                 {
                     in.dequeue(temp_in);
                     if (temp_in.template contains<oracle_response<matrix_type> >())
                     {
-                        ++responses;
+                        --outstanding;
                         const oracle_response<matrix_type>& data = temp_in.template get<oracle_response<matrix_type> >();
+                        if (load_balancing)
+                            send_chunk(remaining, data.id, chunk_size, more_work, outstanding);
+
                         subgradient += data.subgradient; 
                         total_loss += data.loss;
                         num += data.num;
@@ -664,23 +868,136 @@ namespace dlib
 
                 if (this->nuclear_norm_regularizers.size() != 0)
                 {
-                    matrix_type grad; 
-                    double obj;
-                    this->compute_nuclear_norm_parts(w, grad, obj);
-                    risk += obj;
-                    subgradient += grad;
+                    risk += nuclear_norm_obj;
+                    subgradient += nuclear_norm_grad;
                 }
             }
 
+            void encode_solution_update (
+                const matrix_type& w,
+                impl::oracle_request<matrix_type>& req
+            ) const
+            /*!
+                ensures
+                    - #req contains the change from last_solution to w.
+                    - #last_solution == w
+            !*/
+            {
+                long num_changed = 0;
+                for (long i = 0; i < w.size(); ++i)
+                {
+                    if (w(i) != last_solution(i))
+                        ++num_changed;
+                }
+
+                // Each changed element costs us an index and a value.  So only send the
+                // changes if less than about half of w changed.
+                req.changed_dims.clear();
+                if (num_changed < w.size()/2)
+                {
+                    req.is_delta = true;
+                    req.solution.set_size(num_changed,1);
+                    req.changed_dims.reserve(num_changed);
+                    long prev = 0;
+                    long j = 0;
+                    for (long i = 0; i < w.size(); ++i)
+                    {
+                        if (w(i) != last_solution(i))
+                        {
+                            req.solution(j++) = w(i);
+                            req.changed_dims.push_back(i-prev);
+                            prev = i;
+                        }
+                    }
+                }
+                else
+                {
+                    req.is_delta = false;
+                    req.solution = w;
+                }
+                last_solution = w;
+            }
+
+            static bool next_chunk (
+                std::vector<std::pair<long,long> >& remaining,
+                unsigned long node,
+                long chunk_size,
+                long& begin,
+                long& end
+            )
+            /*!
+                ensures
+                    - Picks the next range of samples for the given node to process, takes
+                      it out of remaining, and stores it into [#begin, #end).  A node first
+                      works through its own range from the front.  This way samples tend
+                      to go to the same node every iteration, which keeps the nodes' oracle
+                      caches useful.  After that it takes chunks off the end of whichever
+                      range has the most samples left.
+                    - returns false if there isn't anything left to do.  In this case
+                      #begin == #end.
+            !*/
+            {
+                unsigned long victim = node;
+                if (remaining[node].first == remaining[node].second)
+                {
+                    for (unsigned long i = 0; i < remaining.size(); ++i)
+                    {
+                        if (remaining[i].second-remaining[i].first > remaining[victim].second-remaining[victim].first)
+                            victim = i;
+                    }
+                }
+
+                std::pair<long,long>& r = remaining[victim];
+                if (victim == node)
+                {
+                    begin = r.first;
+                    end = std::min(r.second, begin+chunk_size);
+                    r.first = end;
+                }
+                else
+                {
+                    end = r.second;
+                    begin = std::max(r.first, end-chunk_size);
+                    r.second = begin;
+                }
+                return begin != end;
+            }
+
+            void send_chunk (
+                std::vector<std::pair<long,long> >& remaining,
+                unsigned long node,
+                long chunk_size,
+                const impl::oracle_request<matrix_type>& more_work,
+                unsigned long& outstanding
+            ) const
+            {
+                tsu_out temp_out;
+                impl::oracle_request<matrix_type>& req = temp_out.template get<impl::oracle_request<matrix_type> >();
+                req = more_work;
+                req.id = node;
+                if (next_chunk(remaining, node, chunk_size, req.begin, req.end))
+                {
+                    out_pipes[node]->enqueue(temp_out);
+                    ++outstanding;
+                }
+            }
+
+            // When load balancing, each node's range of samples is split into about this
+            // many chunks.
+            const static long chunks_per_node = 8;
+
             std::vector<network_address> nodes;
 
             typedef type_safe_union<impl::oracle_request<matrix_type> > tsu_out;
-            typedef type_safe_union<impl::oracle_response<matrix_type>, long> tsu_in;
+            typedef type_safe_union<impl::oracle_response<matrix_type>, impl::node_description> tsu_in;
 
             std::vector<std::shared_ptr<pipe<tsu_out> > > out_pipes;
             mutable pipe<tsu_in> in;
             std::vector<std::shared_ptr<bridge> > bridges;
             long num_dims;
+            std::vector<long> num_samples;
+            bool load_balancing;
+            mutable matrix_type last_solution;
         };
 
         std::vector<network_address> nodes;
@@ -689,6 +1006,7 @@ namespace dlib
         double cache_based_eps;
         bool verbose;
         double C;
+        bool load_balancing;
         std::vector<impl::nuclear_norm_regularizer> nuclear_norm_regularizers;
     };
 
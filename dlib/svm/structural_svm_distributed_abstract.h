@@ -66,6 +66,7 @@ namespace dlib
                 - get_epsilon() == 0.001
                 - get_max_iterations() == 10000
                 - get_c() == 1
+                - load_balancing_enabled() == false
                 - This object will not be verbose
 
             WHAT THIS OBJECT REPRESENTS
@@ -111,6 +112,10 @@ namespace dlib
                         cin.get();
                     }
 
+                Each iteration of the optimizer sends the current solution vector to all
+                the processing nodes.  To keep this cheap, only the elements of the solution
+                that changed since the previous iteration are sent whenever that is smaller
+                than sending the whole vector.  
         !*/
 
     public:
@@ -260,6 +265,40 @@ namespace dlib
                 - this object will not print anything to standard out
         !*/
 
+        void enable_load_balancing (
+        );
+        /*!
+            ensures
+                - #load_balancing_enabled() == true
+        !*/
+
+        void disable_load_balancing (
+        );
+        /*!
+            ensures
+                - #load_balancing_enabled() == false
+        !*/
+
+        bool load_balancing_enabled (
+        ) const;
+        /*!
+            ensures
+                - returns true if the processing nodes share the work dynamically and false
+                  otherwise.  
+                - If load balancing is disabled then each processing node runs the
+                  separation oracle on all of its own samples every iteration, so each
+                  iteration takes as long as the slowest node needs to do that.  Therefore,
+                  you normally give each node a different subset of the training data.
+                - If load balancing is enabled then every processing node must have the
+                  same training samples, in the same order.  Each iteration the controller
+                  splits the samples into one range per node and hands them out a piece at
+                  a time.  A node that finishes its own range takes pieces from the end of
+                  the other nodes' ranges.  So fast nodes do more of the work and nobody
+                  sits idle waiting for a slow node.  Samples mostly stay on the same node
+                  from one iteration to the next so the separation oracle caches on the
+                  nodes remain useful.
+        !*/
+
         double get_c (
         ) const;
         /*!
@@ -343,7 +382,9 @@ namespace dlib
                 - invalid_problem
                   This exception is thrown if the svm_struct_processing_nodes disagree
                   on the dimensionality of the problem.  That is, if they disagree on
-                  the value of structural_svm_problem::get_num_dimensions().
+                  the value of structural_svm_problem::get_num_dimensions().  It is also
+                  thrown if load_balancing_enabled() == true and the processing nodes
+                  don't all have the same number of samples.
         !*/
 
     };
@@ -122,8 +122,11 @@ namespace dlib
                     // a proxy for the true separation oracle.  If the risk value has dropped
                     // by enough to get into the stopping condition then the best psi isn't
                     // good enough. 
+                    // use_only_cache can't be honored if there isn't anything in the
+                    // cache yet.  This happens when a distributed solver moves a sample
+                    // to a processing node that hasn't seen it before.
                     if ((best_risk + saved_current_risk_gap > last_true_risk_computed &&
-                        best_risk >= 0) || use_only_cache)
+                        best_risk >= 0) || (use_only_cache && loss.size() != 0))
                     {
                         out_psi = psi[best_idx];
                         lru_count[best_idx] = max_lru_count + 1;
@@ -5,7 +5,10 @@
 #include <string>
 #include <cstdlib>
 #include <ctime>
+#include <vector>
 #include <dlib/bridge.h>
+#include <dlib/matrix.h>
+#include <dlib/rand.h>
 #include <dlib/type_safe_union.h>
 
 #include "tester.h"
@@ -220,6 +223,140 @@ namespace
         dlib::sleep(100);
     }
 
+    void do_test_raw_matrix()
+    {
+        // Both ends have receive pipes that hold matrices, so the matrices go over the
+        // connection in the raw format.
+        dlib::pipe<matrix<double> > in(0), out(0), echo_pipe(0);
+
+        bridge b2(listen_on_port(testing_port), transmit(out), receive(in));
+        bridge echo(connect_to_ip_and_port("127.0.0.1",testing_port), receive(echo_pipe), transmit(echo_pipe));
+
+        dlib::rand rnd;
+        for (int i = 0; i < 50; ++i)
+        {
+            matrix<double> m = randm(rnd.get_random_32bit_number()%40, rnd.get_random_32bit_number()%40, rnd);
+            matrix<double> m2 = m, val;
+            out.enqueue(m2);
+            in.dequeue(val);
+            DLIB_TEST(val.nr() == m.nr() && val.nc() == m.nc());
+            DLIB_TEST(val == m);
+        }
+
+        // a big one that doesn't fit in the bridge's buffers
+        matrix<double> m = randm(500,300,rnd), m2 = m, val;
+        out.enqueue(m2);
+        in.dequeue(val);
+        DLIB_TEST(val == m);
+    }
+
+    void do_test_raw_fixed_size_matrix()
+    {
+        dlib::pipe<matrix<float,3,4> > in(0), out(0), echo_pipe(0);
+
+        bridge b2(listen_on_port(testing_port), transmit(out), receive(in));
+        bridge echo(connect_to_ip_and_port("127.0.0.1",testing_port), receive(echo_pipe), transmit(echo_pipe));
+
+        for (int i = 0; i < 20; ++i)
+        {
+            matrix<float,3,4> m, val;
+            val = 0;
+            for (long r = 0; r < m.nr(); ++r)
+                for (long c = 0; c < m.nc(); ++c)
+                    m(r,c) = i*100 + r*10 + c;
+            matrix<float,3,4> m2 = m;
+            out.enqueue(m2);
+            in.dequeue(val);
+            DLIB_TEST(val == m);
+        }
+    }
+
+    void do_test_raw_vector()
+    {
+        dlib::pipe<std::vector<float> > in(0), out(0), echo_pipe(0);
+
+        bridge b2(listen_on_port(testing_port), transmit(out), receive(in));
+        bridge echo(connect_to_ip_and_port("127.0.0.1",testing_port), receive(echo_pipe), transmit(echo_pipe));
+
+        for (int i = 0; i < 100; ++i)
+        {
+            std::vector<float> v(i*37);
+            for (size_t j = 0; j < v.size(); ++j)
+                v[j] = i + j*0.5f;
+            std::vector<float> v2 = v, val(3);
+            out.enqueue(v2);
+            in.dequeue(val);
+            DLIB_TEST(val == v);
+        }
+    }
+
+    void do_test_raw_to_serialized()
+    {
+        // The receiving end holds column major matrices, which the bridge doesn't send
+        // raw, so it doesn't ask for raw messages.  The matrices must still get there,
+        // serialized the normal way.
+        typedef matrix<double,0,0,default_memory_manager,column_major_layout> col_major_matrix;
+        dlib::pipe<matrix<double> > out(0);
+        dlib::pipe<col_major_matrix> in(0);
+
+        bridge b1(connect_to_ip_and_port("127.0.0.1",testing_port), receive(in));
+        bridge b2(listen_on_port(testing_port), transmit(out));
+
+        for (int i = 0; i < 10; ++i)
+        {
+            matrix<double> m = matrix_cast<double>(randm(i,i+1)), m2 = m;
+            out.enqueue(m2);
+
+            col_major_matrix val;
+            in.dequeue(val);
+            DLIB_TEST(val == m);
+        }
+    }
+
+    void do_test_unix_socket()
+    {
+        const std::string path = "dlib_bridge_test.sock";
+        typedef type_safe_union<int, bridge_status> tsu_type;
+
+        dlib::pipe<tsu_type> out(0), in(0);
+
+        bridge b2(listen_on_unix_socket(path), transmit(out));
+        bridge b1(connect_to_unix_socket(path), receive(in));
+
+        tsu_type msg;
+        in.dequeue(msg);
+        DLIB_TEST(msg.contains<bridge_status>());
+        DLIB_TEST(msg.get<bridge_status>().is_connected == true);
+        DLIB_TEST(msg.get<bridge_status>().foreign_ip == "");
+        DLIB_TEST(msg.get<bridge_status>().foreign_port == 0);
+        DLIB_TEST(b2.get_bridge_status().is_connected == true);
+
+        for (int i = 0; i < 100; ++i)
+        {
+            tsu_type val;
+            val = i;
+            out.enqueue(val);
+            in.dequeue(msg);
+            DLIB_TEST(msg.contains<int>());
+            DLIB_TEST(msg.get<int>() == i);
+        }
+
+        // Clearing the listening bridge removes the socket file so we can listen on the
+        // same path again.
+        b1.clear();
+        b2.clear();
+        b2.reconfigure(listen_on_unix_socket(path), transmit(out));
+        b1.reconfigure(connect_to_unix_socket(path), receive(in));
+        in.dequeue(msg);
+        DLIB_TEST(msg.contains<bridge_status>());
+        DLIB_TEST(msg.get<bridge_status>().is_connected == true);
+        tsu_type val;
+        val = 7;
+        out.enqueue(val);
+        in.dequeue(msg);
+        DLIB_TEST(msg.contains<int>() && msg.get<int>() == 7);
+    }
+
     class test_bridge : public tester
     {
     public:
@@ -248,6 +385,16 @@ namespace
             do_test5_5(1);
             print_spinner();
             do_test6();
+            print_spinner();
+            do_test_raw_matrix();
+            print_spinner();
+            do_test_raw_fixed_size_matrix();
+            print_spinner();
+            do_test_raw_vector();
+            print_spinner();
+            do_test_raw_to_serialized();
+            print_spinner();
+            do_test_unix_socket();
         }
     } a;
 
@@ -6,6 +6,7 @@
 #include <dlib/threads.h>
 #include <dlib/pipe.h>
 #include <dlib/matrix.h>
+#include <dlib/dnn.h>
 
 #include "tester.h"
 
@@ -533,6 +534,213 @@ namespace
         }
         DLIB_TEST(error_occurred == false);
     }
+// ----------------------------------------------------------------------------------------
+
+    std::string concat (const std::string& a, const std::string& b) { return a + b; }
+
+    void collectives_job (
+        bsp_context& context
+    )
+    {
+        const unsigned long n = context.number_of_nodes();
+        const unsigned long id = context.node_id();
+
+        // Node 1 sends a normal message that node 0 only picks up after the collectives,
+        // so it has to be set aside while they run.
+        if (id == 1)
+            context.send(std::string("hello"), 0);
+
+        for (unsigned long root = 0; root < n; ++root)
+        {
+            int val = id == root ? 1000+root : -1;
+            context.broadcast_from(val, root);
+            DLIB_TEST(val == (int)(1000+root));
+        }
+
+        unsigned long sum = id;
+        context.all_reduce(sum, [](unsigned long a, unsigned long b) { return a+b; });
+        DLIB_TEST(sum == n*(n-1)/2);
+
+        // concatenation isn't commutative, so this checks the order things are combined in.
+        std::string str = cast_to_string(id);
+        context.all_reduce(str, concat);
+        std::string expected;
+        for (unsigned long i = 0; i < n; ++i)
+            expected += cast_to_string(i);
+        DLIB_TEST(str == expected);
+
+        for (size_t size : {0, 1, 3, 1001})
+        {
+            std::vector<double> v(size);
+            for (size_t i = 0; i < size; ++i)
+                v[i] = i + 0.25*id;
+            context.all_reduce_sum(v);
+            DLIB_TEST(v.size() == size);
+            for (size_t i = 0; i < size; ++i)
+                DLIB_TEST(v[i] == n*i + 0.25*n*(n-1)/2);
+
+            std::vector<int> w(size, id+1);
+            size_t begin = 1, end = 0;
+            context.reduce_scatter_sum(w, begin, end);
+            DLIB_TEST(begin <= end && end <= size);
+            for (size_t i = begin; i < end; ++i)
+                DLIB_TEST(w[i] == (int)(n*(n+1)/2));
+
+            // The chunks of all the nodes together must cover every element exactly once.
+            std::vector<int> covered(size, 0);
+            for (size_t i = begin; i < end; ++i)
+                covered[i] = 1;
+            context.all_reduce_sum(covered);
+            for (size_t i = 0; i < size; ++i)
+                DLIB_TEST(covered[i] == 1);
+        }
+
+        matrix<float> m = uniform_matrix<float>(7,5, id);
+        context.all_reduce_sum(m);
+        DLIB_TEST(m.nr() == 7 && m.nc() == 5);
+        DLIB_TEST(max(abs(m - n*(n-1)/2.0f)) == 0);
+
+        if (id == 0 && n > 1)
+        {
+            std::string msg;
+            unsigned long sender = 0;
+            context.receive(msg, sender);
+            DLIB_TEST(msg == "hello" && sender == 1);
+        }
+    }
+
+    void dotest_collectives()
+    {
+        dlog << LINFO << "start dotest_collectives()";
+        print_spinner();
+        bool error_occurred = false;
+        {
+            dlib::pipe<unsigned short> ports(5);
+            thread_function t1(callfunct(collectives_job, 0, error_occurred, ports));
+            thread_function t2(callfunct(collectives_job, 0, error_occurred, ports));
+            thread_function t3(callfunct(collectives_job, 0, error_occurred, ports));
+
+            try
+            {
+                std::vector<network_address> hosts;
+                unsigned short port;
+                ports.dequeue(port); hosts.push_back(network_address("127.0.0.1",port));
+                ports.dequeue(port); hosts.push_back(network_address("127.0.0.1",port));
+                ports.dequeue(port); hosts.push_back(network_address("127.0.0.1",port));
+                bsp_connect(hosts, collectives_job);
+            }
+            catch (std::exception& e)
+            {
+                dlog << LERROR << "error during bsp_context: " << e.what();
+                DLIB_TEST_MSG(false, e.what());
+            }
+        }
+        DLIB_TEST(error_occurred == false);
+
+        // A single node doesn't need to talk to anyone.
+        std::vector<network_address> hosts;
+        bsp_connect(hosts, collectives_job);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    typedef loss_mean_squared<fc<1,relu<fc<5,input<matrix<float,0,1>>>>>> dp_net_type;
+
+    void train_data_parallel (
+        bsp_context& context,
+        dp_net_type net,
+        const std::vector<matrix<float,0,1>>& samples,
+        const std::vector<float>& labels,
+        std::vector<std::vector<float>>& params
+    )
+    {
+        // Each node trains on its own part of the data.
+        const size_t n = context.number_of_nodes();
+        const size_t begin = samples.size()*context.node_id()/n;
+        const size_t end = samples.size()*(context.node_id()+1)/n;
+        const std::vector<matrix<float,0,1>> my_samples(samples.begin()+begin, samples.begin()+end);
+        const std::vector<float> my_labels(labels.begin()+begin, labels.begin()+end);
+
+        // Scramble the parameters on the other nodes.  They should get node 0's.
+        if (context.node_id() != 0)
+            visit_layer_parameters(net, [](tensor& t) { t = 1; });
+
+        dnn_trainer<dp_net_type> trainer(net, sgd());
+        trainer.set_learning_rate(0.01);
+        trainer.be_data_parallel(context);
+        DLIB_TEST(trainer.is_data_parallel());
+        for (int i = 0; i < 30; ++i)
+            trainer.train_one_step(my_samples, my_labels);
+        trainer.test_one_step(my_samples, my_labels);
+        trainer.get_net();
+
+        visit_layer_parameters(net, [&](tensor& t) { params[context.node_id()].insert(params[context.node_id()].end(), t.begin(), t.end()); });
+    }
+
+    void dotest_data_parallel_dnn_trainer()
+    {
+        dlog << LINFO << "start dotest_data_parallel_dnn_trainer()";
+        print_spinner();
+
+        dlib::rand rnd;
+        std::vector<matrix<float,0,1>> samples;
+        std::vector<float> labels;
+        for (int i = 0; i < 24; ++i)
+        {
+            samples.push_back(matrix_cast<float>(gaussian_randm(4,1,i)));
+            labels.push_back(sum(samples.back()) + 0.1f*rnd.get_random_gaussian());
+        }
+
+        dp_net_type net;
+        net(samples[0]);
+
+        // Training with the combined mini-batch in one process should give the same net
+        // as the data parallel training.
+        dp_net_type single_net = net;
+        {
+            dnn_trainer<dp_net_type> trainer(single_net, sgd());
+            trainer.set_learning_rate(0.01);
+            for (int i = 0; i < 30; ++i)
+                trainer.train_one_step(samples, labels);
+            trainer.get_net();
+        }
+        std::vector<float> single_params;
+        visit_layer_parameters(single_net, [&](tensor& t) { single_params.insert(single_params.end(), t.begin(), t.end()); });
+
+        bool error_occurred = false;
+        std::vector<std::vector<float>> params(3);
+        {
+            auto job = [&](bsp_context& context) { train_data_parallel(context, net, samples, labels, params); };
+            dlib::pipe<unsigned short> ports(5);
+            thread_function t1(callfunct(job, 0, error_occurred, ports));
+            thread_function t2(callfunct(job, 0, error_occurred, ports));
+
+            try
+            {
+                std::vector<network_address> hosts;
+                unsigned short port;
+                ports.dequeue(port); hosts.push_back(network_address("127.0.0.1",port));
+                ports.dequeue(port); hosts.push_back(network_address("127.0.0.1",port));
+                bsp_connect(hosts, job);
+            }
+            catch (std::exception& e)
+            {
+                dlog << LERROR << "error during bsp_context: " << e.what();
+                DLIB_TEST_MSG(false, e.what());
+            }
+        }
+        DLIB_TEST(error_occurred == false);
+
+        for (auto& p : params)
+        {
+            DLIB_TEST(p.size() == single_params.size());
+            // all the nodes end up with exactly the same network
+            DLIB_TEST(p == params[0]);
+            if (p.size() == single_params.size())
+                DLIB_TEST(max(abs(mat(p) - mat(single_params))) < 1e-5);
+        }
+    }
+
 // ----------------------------------------------------------------------------------------
 
     class bsp_tester : public tester
@@ -559,6 +767,8 @@ namespace
                 dotest5();
                 dotest6();
             }
+            dotest_collectives();
+            dotest_data_parallel_dnn_trainer();
         }
     } a;
 
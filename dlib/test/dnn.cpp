@@ -8,6 +8,7 @@
 #include <ctime>
 #include <vector>
 #include <random>
+#include <thread>
 #include <numeric>
 #include "../dnn.h"
 
@@ -281,8 +282,8 @@ namespace
             const auto nodes = parse_onnx_nodes(sout.str());
 
             DLIB_TEST(count_onnx_nodes(nodes, "Softmax") == 1);
-            DLIB_TEST(count_onnx_nodes(nodes, "Reshape") == 2);
-            DLIB_TEST(get_onnx_int_attribute(nth_onnx_node(nodes, "Softmax", 0), "axis") == 2);
+            DLIB_TEST(count_onnx_nodes(nodes, "Reshape") == 0);
+            DLIB_TEST(get_onnx_int_attribute(nth_onnx_node(nodes, "Softmax", 0), "axis") == 3);
         }
 
         {
@@ -517,6 +518,533 @@ namespace
         }
     }
 
+// ----------------------------------------------------------------------------------------
+
+    float max_onnx_difference (
+        const tensor& a,
+        const tensor& b
+    )
+    {
+        DLIB_TEST(a.size() == b.size());
+        float max_error = 0;
+        for (size_t i = 0; i < a.size() && i < b.size(); ++i)
+            max_error = std::max(max_error, std::abs(a.host()[i] - b.host()[i]));
+        return max_error;
+    }
+
+    template <typename net_type>
+    void check_onnx_round_trip (
+        net_type& net,
+        const std::vector<int64_t>& shape,
+        bool integer_input = false
+    )
+    {
+        onnx_export_options options;
+        options.input_tensor_shape = shape;
+        std::ostringstream sout(std::ios::binary);
+        net_to_onnx(net, sout, options);
+        std::istringstream sin(sout.str(), std::ios::binary);
+        onnx_model model(sin);
+        DLIB_TEST(model.num_inputs() == 1);
+        DLIB_TEST(model.num_outputs() == 1);
+
+        resizable_tensor x(shape[0], shape[1], shape[2], shape[3]);
+        tt::tensor_rand rnd(0);
+        if (integer_input)
+        {
+            rnd.fill_uniform(x);
+            for (auto& v : x)
+                v = std::floor(v*10);
+        }
+        else
+        {
+            rnd.fill_gaussian(x);
+        }
+
+        net.subnet().forward(x);
+        const tensor& expected = net.subnet().get_output();
+        const tensor& actual = model.forward(x);
+        const float error = max_onnx_difference(actual, expected);
+        DLIB_TEST_MSG(error < 1e-4, "error: " << error);
+
+        // A second run reuses the plan and must give the same answer.
+        DLIB_TEST(max_onnx_difference(model.forward(x), expected) < 1e-4);
+    }
+
+    void test_onnx_import()
+    {
+        print_spinner();
+
+        {
+            using net_type = loss_multiclass_log<fc<2,relu<max_pool<2,2,2,2,con<3,3,3,1,1,input_tensor>>>>>;
+            net_type net;
+            check_onnx_round_trip(net, {1, 3, 8, 8});
+        }
+        {
+            using net_type = loss_multiclass_log<fc<2,relu<con<4,3,3,1,1,relu<con<3,3,3,2,2,input_tensor>>>>>>;
+            net_type net;
+            check_onnx_round_trip(net, {2, 3, 9, 9});
+        }
+        {
+            using a1 = sig<input_tensor>;
+            using a2 = htan<a1>;
+            using a3 = leaky_relu<a2>;
+            using a4 = prelu<a3>;
+            using a5 = clipped_relu<a4>;
+            using a6 = elu<a5>;
+            using a7 = gelu<a6>;
+            using a8 = silu<a7>;
+            using a9 = mish<a8>;
+            using net_type = loss_multiclass_log<fc<2,a9>>;
+            net_type net;
+            check_onnx_round_trip(net, {1, 3, 4, 4});
+        }
+        print_spinner();
+        {
+            using net_type = loss_multiclass_log<fc<2,upsample<2,cont<3,2,2,2,2,input_tensor>>>>;
+            net_type net;
+            check_onnx_round_trip(net, {1, 2, 4, 4});
+        }
+        {
+            using net_type = loss_multiclass_log<fc<2,
+                             concat2<tag1, tag2,
+                             tag1<con<2,1,1,1,1,
+                             tag2<con<3,1,1,1,1,input_tensor>>>>>>>;
+            net_type net;
+            check_onnx_round_trip(net, {1, 3, 4, 4});
+        }
+        {
+            using net_type = loss_multiclass_log<fc<2,
+                             extract<0,2,5,3,
+                             transpose<linear<5,
+                             multiply<reshape_to<2,3,4,input_tensor>>>>>>>;
+            net_type net;
+            check_onnx_round_trip(net, {1, 2, 3, 4});
+        }
+        {
+            using net_type = loss_multiclass_log<fc<2,
+                             scale_prev2<skip1<tag2<con<3,1,1,1,1,
+                             avg_pool_everything<tag1<input_tensor>>>>>>>>;
+            net_type net;
+            check_onnx_round_trip(net, {1, 3, 4, 4});
+        }
+        print_spinner();
+        {
+            using transposed = tag1<transpose<tag2<input_tensor>>>;
+            using net_type = loss_multiclass_log<fc<2,multm_prev1<skip2<transposed>>>>;
+            net_type net;
+            check_onnx_round_trip(net, {1, 2, 3, 4});
+        }
+        {
+            using net_type = loss_multiclass_log<fc<2,
+                             softmax_all<softmaxm<tril_mask<input_tensor>>>>>;
+            net_type net;
+            check_onnx_round_trip(net, {1, 1, 4, 4});
+        }
+        {
+            using net_type = loss_multiclass_log<fc<2,softmax<avg_pool<3,3,2,2,input_tensor>>>>;
+            net_type net;
+            check_onnx_round_trip(net, {2, 3, 7, 7});
+        }
+        {
+            using net_type = loss_multiclass_log<fc<2,
+                             layer_norm<rms_norm<input_tensor>>>>;
+            net_type net;
+            check_onnx_round_trip(net, {2, 3, 4, 4});
+        }
+        {
+            using net_type = loss_multiclass_log<fc<2,
+                             l2normalize<smelu<input_tensor>>>>;
+            net_type net;
+            check_onnx_round_trip(net, {1, 3, 4, 4});
+        }
+        print_spinner();
+        {
+            using net_type = loss_multiclass_log<fc<2,
+                             positional_encodings<embeddings<10,4,input_tensor>>>>;
+            net_type net;
+            check_onnx_round_trip(net, {1, 1, 3, 1}, true);
+        }
+        {
+            using net_type = loss_multiclass_log<fc<2,
+                             add_prev1<max_pool<2,2,2,2,tag1<input_tensor>>>>>;
+            net_type net;
+            check_onnx_round_trip(net, {1, 3, 4, 4});
+        }
+        {
+            using net_type = loss_multiclass_log<fc<2,
+                             mult_prev1<max_pool<2,2,2,2,tag1<input_tensor>>>>>;
+            net_type net;
+            check_onnx_round_trip(net, {1, 3, 4, 4});
+        }
+        {
+            using net_type = loss_multiclass_log<fc<2,
+                             resize_prev_to_tagged<tag1,
+                             con<2,1,1,1,1,max_pool<2,2,2,2,tag1<input_tensor>>>>>>;
+            net_type net;
+            check_onnx_round_trip(net, {1, 3, 8, 8});
+        }
+        {
+            using net_type = loss_multiclass_log<fc<2,
+                             slice<1,0,0,2,2,2,reorg<input_tensor>>>>;
+            net_type net;
+            check_onnx_round_trip(net, {1, 1, 4, 4});
+        }
+        print_spinner();
+
+        {
+            // A long chain only ever needs two live activations, so the memory
+            // plan should fold all of them into a small arena.
+            using net_type = loss_multiclass_log<fc<2,
+                             htan<sig<htan<sig<htan<sig<htan<sig<input_tensor>>>>>>>>>>;
+            net_type net;
+            onnx_export_options options;
+            options.input_tensor_shape = {2, 3, 8, 8};
+            std::ostringstream sout(std::ios::binary);
+            net_to_onnx(net, sout, options);
+            std::istringstream sin(sout.str(), std::ios::binary);
+            onnx_model model(sin);
+
+            resizable_tensor x(2, 3, 8, 8);
+            tt::tensor_rand rnd(0);
+            rnd.fill_gaussian(x);
+            net.subnet().forward(x);
+            DLIB_TEST(max_onnx_difference(model.forward(x), net.subnet().get_output()) < 1e-4);
+            DLIB_TEST(model.get_arena_size() > 0);
+            DLIB_TEST_MSG(4*model.get_arena_size() <= model.get_unplanned_activation_size(),
+                model.get_arena_size() << " " << model.get_unplanned_activation_size());
+            DLIB_TEST(model.get_output_shape() == std::vector<int64_t>({2, 2}));
+        }
+
+        using impl::onnx::export_context;
+        using impl::onnx::make_attribute_float;
+        using impl::onnx::make_attribute_int;
+
+        {
+            onnx_export_options options;
+            options.input_tensor_shape = {2, 3, 2, 2};
+            export_context ctx(options);
+            ctx.add_initializer("scale", {3}, std::vector<float>({1, 2, 0.5f}));
+            ctx.add_initializer("bias", {3}, std::vector<float>({0, 1, -1}));
+            ctx.add_initializer("mean", {3}, std::vector<float>({0.5f, -1, 2}));
+            ctx.add_initializer("var", {3}, std::vector<float>({1, 4, 0.25f}));
+            ctx.add_node("BatchNormalization", {"input", "scale", "bias", "mean", "var"}, {"bn"},
+                {make_attribute_float("epsilon", 0)});
+            ctx.current_name = "bn";
+            ctx.finish();
+            std::ostringstream sout(std::ios::binary);
+            ctx.save(sout);
+            std::istringstream sin(sout.str(), std::ios::binary);
+            onnx_model model(sin);
+
+            resizable_tensor x(2, 3, 2, 2);
+            tt::tensor_rand rnd(0);
+            rnd.fill_gaussian(x);
+            const float scale[] = {1, 2, 0.5f}, bias[] = {0, 1, -1}, mean[] = {0.5f, -1, 2}, var[] = {1, 4, 0.25f};
+            resizable_tensor expected(x);
+            for (long n = 0; n < x.num_samples(); ++n)
+                for (long k = 0; k < x.k(); ++k)
+                    for (long i = 0; i < x.nr()*x.nc(); ++i)
+                    {
+                        float& v = expected.host()[(n*x.k() + k)*x.nr()*x.nc() + i];
+                        v = (v - mean[k])/std::sqrt(var[k])*scale[k] + bias[k];
+                    }
+            DLIB_TEST(max_onnx_difference(model.forward(x), expected) < 1e-5);
+        }
+
+        {
+            // Gemm with a transposed weight matrix and a broadcast bias, fed
+            // through a reshape whose target shape is computed by the graph.
+            onnx_export_options options;
+            options.input_tensor_shape = {2, 3, 1, 1};
+            export_context ctx(options);
+            ctx.add_initializer("w", {4, 3}, std::vector<float>({1, 0, 0,  0, 1, 0,  0, 0, 1,  1, 1, 1}));
+            ctx.add_initializer("c", {4}, std::vector<float>({0.5f, -0.5f, 1, 2}));
+            ctx.add_initializer_int64("starts", {1}, {0});
+            ctx.add_initializer_int64("ends", {1}, {1});
+            ctx.add_initializer_int64("minus_one", {1}, {-1});
+            ctx.add_node("Shape", {"input"}, {"shape"});
+            ctx.add_node("Slice", {"shape", "starts", "ends"}, {"batch"});
+            ctx.add_node("Concat", {"batch", "minus_one"}, {"flat_shape"}, {make_attribute_int("axis", 0)});
+            ctx.add_node("Reshape", {"input", "flat_shape"}, {"flat"});
+            ctx.add_node("Gemm", {"flat", "w", "c"}, {"y"},
+                {make_attribute_int("transB", 1), make_attribute_float("alpha", 2)});
+            ctx.current_name = "y";
+            ctx.current_shape = {2, 4};
+            ctx.finish();
+            std::ostringstream sout(std::ios::binary);
+            ctx.save(sout);
+            std::istringstream sin(sout.str(), std::ios::binary);
+            onnx_model model(sin);
+
+            resizable_tensor x(2, 3, 1, 1);
+            const float xs[] = {1, 2, 3, -1, 0, 4};
+            std::copy(xs, xs + 6, x.host());
+            const tensor& y = model.forward(x);
+            const float expected[] = {2.5f, 3.5f, 7, 14,  -1.5f, -0.5f, 9, 8};
+            DLIB_TEST(y.num_samples() == 2 && y.k() == 4);
+            for (size_t i = 0; i < 8; ++i)
+                DLIB_TEST(std::abs(y.host()[i] - expected[i]) < 1e-5);
+        }
+
+        {
+            onnx_export_options options;
+            options.input_tensor_shape = {2, 3, 4, 1};
+            export_context ctx(options);
+            ctx.add_initializer("gamma", {4, 1}, std::vector<float>({1, 2, 3, 4}));
+            ctx.add_initializer("beta", {1}, std::vector<float>({0.5f}));
+            ctx.add_node("LayerNormalization", {"input", "gamma", "beta"}, {"ln"},
+                {make_attribute_int("axis", -2), make_attribute_float("epsilon", 1e-5f)});
+            ctx.current_name = "ln";
+            ctx.finish();
+            std::ostringstream sout(std::ios::binary);
+            ctx.save(sout);
+            std::istringstream sin(sout.str(), std::ios::binary);
+            onnx_model model(sin);
+
+            resizable_tensor x(2, 3, 4, 1);
+            tt::tensor_rand rnd(0);
+            rnd.fill_gaussian(x);
+            resizable_tensor expected(x);
+            for (long r = 0; r < 6; ++r)
+            {
+                float* v = expected.host() + r*4;
+                double m = 0, s = 0;
+                for (int i = 0; i < 4; ++i)
+                    m += v[i];
+                m /= 4;
+                for (int i = 0; i < 4; ++i)
+                    s += (v[i] - m)*(v[i] - m);
+                s /= 4;
+                for (int i = 0; i < 4; ++i)
+                    v[i] = (v[i] - m)/std::sqrt(s + 1e-5)*(i + 1) + 0.5f;
+            }
+            DLIB_TEST(max_onnx_difference(model.forward(x), expected) < 1e-4);
+        }
+
+        {
+            onnx_export_options options;
+            options.input_tensor_shape = {1, 3, 4, 4};
+            export_context ctx(options);
+            ctx.add_node("NonMaxSuppression", {"input"}, {"y"});
+            ctx.current_name = "y";
+            ctx.finish();
+            std::ostringstream sout(std::ios::binary);
+            ctx.save(sout);
+
+            bool threw = false;
+            try
+            {
+                std::istringstream sin(sout.str(), std::ios::binary);
+                onnx_model model(sin);
+            }
+            catch (const dlib::error& e)
+            {
+                threw = contains_substring(e.what(), "doesn't support the operator: NonMaxSuppression");
+            }
+            DLIB_TEST(threw);
+
+            onnx_model model;
+            resizable_tensor x(1, 3, 5, 4);
+            threw = false;
+            try
+            {
+                std::ostringstream sout2(std::ios::binary);
+                export_context ctx2(options);
+                ctx2.add_node("Relu", {"input"}, {"y"});
+                ctx2.current_name = "y";
+                ctx2.finish();
+                ctx2.save(sout2);
+                std::istringstream sin(sout2.str(), std::ios::binary);
+                model.load(sin);
+                model.forward(x);
+            }
+            catch (const dlib::error& e)
+            {
+                threw = contains_substring(e.what(), "expects shape");
+            }
+            DLIB_TEST(threw);
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename net_type>
+    runtime_net to_runtime_net (
+        const net_type& net,
+        const net_type& architecture
+    )
+    {
+        std::ostringstream sarch, snet(std::ios::binary);
+        sarch << architecture;
+        serialize(net, snet);
+        std::istringstream iarch(sarch.str());
+        std::istringstream inet(snet.str(), std::ios::binary);
+        return runtime_net(iarch, inet);
+    }
+
+    template <typename net_type, typename forward_iterator>
+    void check_runtime_net (
+        net_type& net,
+        forward_iterator ibegin,
+        forward_iterator iend
+    )
+    {
+        resizable_tensor x;
+        net.to_tensor(ibegin, iend, x);
+        net.subnet().forward(x);
+        const tensor& expected = net.subnet().get_output();
+        // The architecture may come from a network that has been run, which prints
+        // the size of each layer's output, or from a new one, which doesn't.
+        runtime_net rnet = to_runtime_net(net, net);
+        runtime_net fresh = to_runtime_net(net, net_type());
+        DLIB_TEST(rnet.num_layers() == net_type::num_layers);
+        DLIB_TEST(rnet.has_loss());
+
+        for (auto* r : {&fresh, &rnet})
+        {
+            const tensor& actual = r->forward(x);
+            DLIB_TEST(have_same_dimensions(actual, expected));
+            const float error = max_onnx_difference(actual, expected);
+            DLIB_TEST_MSG(error < 1e-4, "error: " << error);
+            DLIB_TEST(max_onnx_difference(r->forward(x), expected) < 1e-4);
+            DLIB_TEST(r->get_arena_size() <= r->get_unplanned_activation_size());
+        }
+    }
+
+    template <typename SUBNET> using rt_block = relu<add_prev1<bn_con<con<4,3,3,1,1,relu<bn_con<con<4,3,3,1,1,tag1<SUBNET>>>>>>>>;
+    template <typename SUBNET> using rt_dense = relu<add_prev1<fc<3,tag1<SUBNET>>>>;
+
+    void test_runtime_net()
+    {
+        print_spinner();
+        tt::tensor_rand rnd(0);
+
+        {
+            // repeat, tag, skip, and add_prev layers over an image input
+            using net_type = loss_multiclass_log<fc<2,repeat<2,rt_dense,tag2<relu<con<4,3,3,1,1,skip2<tag2<input_rgb_image_sized<8>>>>>>>>>;
+            net_type net;
+            std::vector<matrix<rgb_pixel>> images(2, matrix<rgb_pixel>(8, 8));
+            dlib::rand prnd;
+            for (auto& img : images)
+                for (auto& p : img)
+                    p = rgb_pixel(prnd.get_random_8bit_number(), prnd.get_random_8bit_number(), prnd.get_random_8bit_number());
+            check_runtime_net(net, images.begin(), images.end());
+        }
+        {
+            // A small resnet.  Running batches first gives the bn layers nontrivial
+            // running statistics, which a single sample is then normalized with.
+            using net_type = loss_multiclass_log<fc<3,avg_pool_everything<repeat<3,rt_block,max_pool<3,3,2,2,relu<bn_con<con<4,5,5,2,2,input_tensor>>>>>>>>;
+            net_type net;
+            resizable_tensor batch(4, 3, 20, 20), data, x(1, 3, 20, 20);
+            for (int i = 0; i < 3; ++i)
+            {
+                rnd.fill_gaussian(batch, 1, 2);
+                net.to_tensor(&batch, &batch + 1, data);
+                net.subnet().forward(data);
+            }
+            rnd.fill_gaussian(x);
+            check_runtime_net(net, &x, &x + 1);
+
+            // Only a few activations are alive at any one time.
+            runtime_net rnet = to_runtime_net(net, net);
+            rnet.forward(x);
+            DLIB_TEST(2*rnet.get_arena_size() < rnet.get_unplanned_activation_size());
+        }
+        {
+            using net_type = loss_multiclass_log_per_pixel<resize_to<5,5,add_prev1<cont<3,2,2,2,2,reorg<
+                concat2<tag3,tag4,tag4<leaky_relu<skip2<tag3<mult_prev2<upsample<2,max_pool<2,2,2,2,
+                tag2<con<6,3,3,1,1,tag1<input_tensor>>>>>>>>>>>>>>>>;
+            net_type net;
+            resizable_tensor x(2, 3, 8, 8);
+            rnd.fill_gaussian(x);
+            check_runtime_net(net, &x, &x + 1);
+        }
+        {
+            using net_type = loss_multiclass_log<softmax<multiply<fc<5,prelu<clipped_relu<elu<sig<htan<mish<smelu<
+                silu<gelu<l2normalize<layer_norm<rms_norm<softmaxm<tril_mask<multm_prev2<transpose<
+                linear_no_bias<6,skip1<tag2<linear<6,tag1<positional_encodings<input_tensor>>>>>>>>>>>>>>>>>>>>>>>>>>;
+            net_type net;
+            resizable_tensor x(2, 1, 4, 6);
+            rnd.fill_gaussian(x);
+            check_runtime_net(net, &x, &x + 1);
+        }
+        {
+            using net_type = loss_multiclass_log<fc<3,softmax_all<embeddings<10,4,input_tensor>>>>;
+            net_type net;
+            resizable_tensor x(2, 1, 5, 1);
+            rnd.fill_uniform(x);
+            for (auto& v : x)
+                v = std::floor(v*10);
+            check_runtime_net(net, &x, &x + 1);
+
+            // With the lazy ADAM moment estimates in the serialized network.
+            layer<3>(net).layer_details().set_lazy_adam(true);
+            net.subnet().forward(x);
+            net.subnet().get_gradient_input() = 1;
+            net.subnet().back_propagate_error(x);
+            check_runtime_net(net, &x, &x + 1);
+        }
+        {
+            // A tied output head, under the chunked loss that shares its table.
+            using net_type = loss_multiclass_log_chunked<tag1,fc<4,tied_embeddings1<tag1<embeddings<10,4,input_tensor>>>>>;
+            net_type net;
+            net.loss_details().set_chunk_size(3);
+            resizable_tensor x(2, 1, 5, 1);
+            rnd.fill_uniform(x);
+            for (auto& v : x)
+                v = std::floor(v*10);
+            check_runtime_net(net, &x, &x + 1);
+        }
+        {
+            using net_type = loss_multiclass_log<fc<3,bn_fc<affine<reshape_to<4,2,2,extract<0,2,2,4,
+                resize_prev_to_tagged<tag4,max_pool<2,2,2,2,tag4<slice<1,1,1,2,4,4,scale_prev3<skip2<
+                tag3<avg_pool_everything<tag2<scale1<sig<avg_pool_everything<tag1<input_tensor>>>>>>>>>>>>>>>>>>>;
+            net_type net;
+            resizable_tensor batch(3, 4, 6, 6), data, x(1, 4, 6, 6);
+            rnd.fill_gaussian(batch, 1, 2);
+            net.to_tensor(&batch, &batch + 1, data);
+            net.subnet().forward(data);
+            rnd.fill_gaussian(x);
+            check_runtime_net(net, &x, &x + 1);
+        }
+        {
+            // A network without a loss layer.
+            using net_type = fc<2,relu<con<3,3,3,1,1,input_tensor>>>;
+            net_type net;
+            resizable_tensor x(1, 2, 5, 5);
+            rnd.fill_gaussian(x);
+            resizable_tensor data;
+            net.to_tensor(&x, &x + 1, data);
+            net.forward(data);
+            runtime_net rnet = to_runtime_net(net, net);
+            DLIB_TEST(!rnet.has_loss());
+            DLIB_TEST(max_onnx_difference(rnet.forward(x), net.get_output()) < 1e-4);
+        }
+        {
+            // The architecture must describe the serialized network.
+            using net_type1 = loss_multiclass_log<fc<2,relu<con<3,3,3,1,1,input_tensor>>>>;
+            using net_type2 = loss_multiclass_log<fc<2,htan<con<3,3,3,1,1,input_tensor>>>>;
+            net_type1 net1;
+            net_type2 net2;
+            std::ostringstream sarch, snet(std::ios::binary);
+            sarch << net1;
+            serialize(net2, snet);
+            std::istringstream iarch(sarch.str());
+            std::istringstream inet(snet.str(), std::ios::binary);
+            bool threw = false;
+            try
+            {
+                runtime_net rnet(iarch, inet);
+            }
+            catch (const serialization_error&)
+            {
+                threw = true;
+            }
+            DLIB_TEST(threw);
+        }
+    }
+
 // ----------------------------------------------------------------------------------------
 
     template <typename T>
@@ -1389,18 +1917,11 @@ namespace
 
     void test_embeddings()
     {
-        print_spinner();
         const size_t num_sequences = 100, sequence_length = 7, num_classes = 3, num_tokens = 50, embedding_length = 5;
         using net_type = loss_multiclass_log<fc<num_classes,
             relu<fc<32,relu<fc<64,
             embeddings<num_tokens, embedding_length,
             input<matrix<unsigned long, 0, 1>>>>>>>>>;
-        net_type net;
-        dnn_trainer<net_type> trainer(net, sgd(0, 0.9));
-        trainer.set_learning_rate(1e-1);
-        trainer.set_min_learning_rate(1e-4);
-        trainer.set_mini_batch_size(16);
-        trainer.set_max_num_epochs(500);
 
         dlib::rand rnd(std::rand());
         auto generate_sequences = [&](size_t num_sequences, size_t sequence_length, size_t num_tokens) {
@@ -1422,17 +1943,182 @@ namespace
             return labels;
         };
 
-        auto sequences = generate_sequences(num_sequences, sequence_length, num_tokens);
-        auto labels = generate_labels(num_sequences, num_classes);
+        for (bool lazy_adam : {false, true})
+        {
+            print_spinner();
+            net_type net;
+            if (lazy_adam)
+            {
+                layer<6>(net).layer_details().set_lazy_adam(true);
+                layer<6>(net).layer_details().set_lazy_adam_learning_rate(0.01);
+                layer<6>(net).layer_details().set_lazy_adam_momentum2(0.99);
+            }
+            dnn_trainer<net_type> trainer(net, sgd(0, 0.9));
+            trainer.set_learning_rate(1e-1);
+            trainer.set_min_learning_rate(1e-4);
+            trainer.set_mini_batch_size(16);
+            trainer.set_max_num_epochs(500);
+
+            auto sequences = generate_sequences(num_sequences, sequence_length, num_tokens);
+            auto labels = generate_labels(num_sequences, num_classes);
+
+            trainer.train(sequences, labels);
+            std::vector<unsigned long> predicted_labels = net(sequences);
+            size_t num_correct = 0;
+            for (size_t i = 0; i < labels.size(); ++i)
+                if (predicted_labels[i] == labels[i]) ++num_correct;
+
+            double acc = static_cast<double>(num_correct) / labels.size();
+            DLIB_TEST_MSG(acc > 0.9, "lazy_adam: " << lazy_adam << ", acc: " << acc);
+
+            // The update mode and its state survive serialization.
+            std::ostringstream sout;
+            serialize(net, sout);
+            std::istringstream sin(sout.str());
+            net_type net2;
+            deserialize(net2, sin);
+            DLIB_TEST(layer<6>(net2).layer_details().get_lazy_adam() == lazy_adam);
+            DLIB_TEST(layer<6>(net2).layer_details().get_lazy_adam_learning_rate() == (lazy_adam ? 0.01 : 0.001));
+            DLIB_TEST(layer<6>(net2).layer_details().get_lazy_adam_momentum2() == (lazy_adam ? 0.99 : 0.999));
+            DLIB_TEST(net2(sequences) == predicted_labels);
+
+            // The moment estimates are only written while there are some.
+            const size_t embs_bytes = layer<6>(net).layer_details().get_embeddings().size()*sizeof(float);
+            layer<6>(net2).layer_details().set_lazy_adam(false);
+            std::ostringstream sout2;
+            serialize(net2, sout2);
+            if (lazy_adam)
+                DLIB_TEST(sout.str().size() >= sout2.str().size() + 2*embs_bytes);
+            else
+                DLIB_TEST(sout.str().size() == sout2.str().size());
+        }
+    }
 
-        trainer.train(sequences, labels);
-        std::vector<unsigned long> predicted_labels = net(sequences);
-        size_t num_correct = 0;
-        for (size_t i = 0; i < labels.size(); ++i)
-            if (predicted_labels[i] == labels[i]) ++num_correct;
+// ----------------------------------------------------------------------------------------
+
+    void test_tied_embeddings()
+    {
+        const long num_tokens = 23, embedding_length = 6, sequence_length = 4, num_sequences = 10;
+        using input_type = matrix<unsigned long, 0, 1>;
+        using full_net_type = loss_multiclass_log<tied_embeddings1<fc<embedding_length,relu<fc<16,
+            tag1<embeddings<num_tokens, embedding_length, input<input_type>>>>>>>>;
+        using chunked_net_type = loss_multiclass_log_chunked<tag1, fc<embedding_length,relu<fc<16,
+            tag1<embeddings<num_tokens, embedding_length, input<input_type>>>>>>>;
+
+        dlib::rand rnd(std::rand());
+        std::vector<input_type> sequences;
+        std::vector<unsigned long> labels;
+        for (long i = 0; i < num_sequences; ++i)
+        {
+            input_type seq(sequence_length);
+            for (long j = 0; j < sequence_length; ++j)
+                seq(j) = rnd.get_random_32bit_number() % num_tokens;
+            sequences.push_back(seq);
+            labels.push_back(rnd.get_random_32bit_number() % num_tokens);
+        }
+
+        // The tied head projects onto the table of the tagged embeddings layer.
+        {
+            print_spinner();
+            tied_embeddings1<tag1<embeddings<num_tokens, embedding_length, input<input_type>>>> net;
+            resizable_tensor x;
+            net.to_tensor(sequences.begin(), sequences.end(), x);
+            const tensor& out = net.forward(x);
+            DLIB_TEST(out.num_samples() == num_sequences);
+            DLIB_TEST(out.k() == 1 && out.nr() == sequence_length && out.nc() == num_tokens);
+            const matrix<float> embs = mat(layer<tag1>(net).subnet().layer_details().get_embeddings());
+            const float* o = out.host();
+            double max_err = 0;
+            for (long i = 0; i < num_sequences; ++i)
+                for (long j = 0; j < sequence_length; ++j)
+                    for (long v = 0; v < num_tokens; ++v)
+                        max_err = std::max(max_err, (double)std::abs(o[(i*sequence_length+j)*num_tokens+v] -
+                            dot(rowm(embs, sequences[i](j)), rowm(embs, v))));
+            DLIB_TEST_MSG(max_err < 1e-5, max_err);
+        }
+
+        for (bool lazy_adam : {false, true})
+        {
+            print_spinner();
+            chunked_net_type chunked_net;
+            // A chunk size that doesn't divide the dictionary exercises the last,
+            // shorter chunk.
+            chunked_net.loss_details().set_chunk_size(7);
+            layer<tag1>(chunked_net).subnet().layer_details().set_lazy_adam(lazy_adam);
+            layer<tag1>(chunked_net).subnet().layer_details().set_learning_rate_multiplier(0.1);
+            resizable_tensor x;
+            chunked_net.to_tensor(sequences.begin(), sequences.end(), x);
+            chunked_net.forward(x);
+
+            full_net_type full_net;
+            full_net.subnet().subnet() = chunked_net.subnet();
+
+            const double full_loss = full_net.compute_parameter_gradients(x, labels.begin());
+            const double chunked_loss = chunked_net.compute_parameter_gradients(x, labels.begin());
+            DLIB_TEST_MSG(std::abs(full_loss - chunked_loss) < 1e-5, full_loss << " " << chunked_loss);
+
+            // The gradient that reaches the rest of the network is the same, and so is
+            // the update of the embeddings that backward() applied.
+            const double grad_err = max(abs(mat(layer<2>(full_net).get_parameter_gradient()) -
+                mat(layer<1>(chunked_net).get_parameter_gradient())));
+            DLIB_TEST_MSG(grad_err < 1e-5, grad_err);
+            const double embs_err = max(abs(mat(layer<tag1>(full_net).subnet().layer_details().get_embeddings()) -
+                mat(layer<tag1>(chunked_net).subnet().layer_details().get_embeddings())));
+            DLIB_TEST_MSG(embs_err < 1e-5, embs_err);
+            DLIB_TEST(full_net(sequences) == chunked_net(sequences));
+
+            std::ostringstream sout;
+            serialize(chunked_net, sout);
+            std::istringstream sin(sout.str());
+            chunked_net_type chunked_net2;
+            deserialize(chunked_net2, sin);
+            DLIB_TEST(chunked_net2.loss_details().get_chunk_size() == 7);
+            DLIB_TEST(chunked_net2(sequences) == chunked_net(sequences));
+        }
+
+        // Evaluating the loss on other data between training steps, as
+        // dnn_trainer::test_one_step() does, leaves no gradient behind for the next
+        // backward() to apply to the embeddings.
+        {
+            print_spinner();
+            std::vector<input_type> test_sequences(sequences.rbegin(), sequences.rend());
+            std::vector<unsigned long> test_labels(labels.begin(), labels.end());
+            for (auto& l : test_labels)
+                l = (l+1) % num_tokens;
 
-        double acc = static_cast<double>(num_correct) / labels.size();
-        DLIB_TEST(acc > 0.9);
+            chunked_net_type net1;
+            net1.loss_details().set_chunk_size(7);
+            resizable_tensor x, test_x;
+            net1.to_tensor(sequences.begin(), sequences.end(), x);
+            net1.to_tensor(test_sequences.begin(), test_sequences.end(), test_x);
+            net1.forward(x);
+            chunked_net_type net2 = net1;
+
+            net1.compute_loss(test_x, test_labels.begin());
+            net1.compute_parameter_gradients(x, labels.begin());
+            net2.compute_parameter_gradients(x, labels.begin());
+            const double embs_err = max(abs(mat(layer<tag1>(net1).subnet().layer_details().get_embeddings()) -
+                mat(layer<tag1>(net2).subnet().layer_details().get_embeddings())));
+            DLIB_TEST_MSG(embs_err == 0, embs_err);
+        }
+
+        // Training through the chunked loss fits the labels.
+        {
+            print_spinner();
+            chunked_net_type net;
+            net.loss_details().set_chunk_size(5);
+            dnn_trainer<chunked_net_type> trainer(net, sgd(0, 0.9));
+            trainer.set_learning_rate(1e-1);
+            trainer.set_min_learning_rate(1e-4);
+            trainer.set_mini_batch_size(num_sequences);
+            trainer.set_max_num_epochs(500);
+            trainer.train(sequences, labels);
+            const std::vector<unsigned long> predicted = net(sequences);
+            long num_correct = 0;
+            for (size_t i = 0; i < labels.size(); ++i)
+                if (predicted[i] == labels[i]) ++num_correct;
+            DLIB_TEST_MSG(num_correct >= num_sequences-1, num_correct);
+        }
     }
 
 // ----------------------------------------------------------------------------------------
@@ -3242,6 +3928,254 @@ namespace
 
     }
 
+// ----------------------------------------------------------------------------------------
+
+    template <typename net_type>
+    std::vector<std::string> bn_states (
+        net_type& net
+    )
+    {
+        std::vector<std::string> states;
+        visit_computational_layers(net, [&](bn_<CONV_MODE>& l)
+        {
+            std::ostringstream sout;
+            serialize(l, sout);
+            states.push_back(sout.str());
+        });
+        return states;
+    }
+
+    template <typename net_type>
+    std::vector<matrix<float>> parameter_gradients (
+        net_type& net
+    )
+    {
+        std::vector<matrix<float>> grads;
+        visit_layer_parameter_gradients(net, [&](tensor& t) { grads.push_back(mat(t)); });
+        return grads;
+    }
+
+    template <typename SUBNET>
+    using dropout_block = dropout<relu<bn_con<con<8,3,3,1,1,SUBNET>>>>;
+
+    void test_gradient_checkpointing_with_dropout()
+    {
+        print_spinner();
+        using net_type = loss_multiclass_log<fc<3,avg_pool_everything<
+            repeat<3,dropout_block,
+            con<8,3,3,1,1,
+            input<matrix<float>>
+            >>>>>;
+
+        std::vector<matrix<float>> x(4);
+        std::vector<unsigned long> y(4);
+        dlib::rand rnd;
+        for (size_t i = 0; i < x.size(); ++i)
+        {
+            x[i] = matrix_cast<float>(randm(8,8,rnd));
+            y[i] = i%3;
+        }
+
+        net_type net;
+        resizable_tensor data;
+        net.to_tensor(x.begin(), x.end(), data);
+        net.forward(data);
+        set_all_gradient_checkpointing(net, true);
+        const double loss1 = net.compute_parameter_gradients(data, y.begin());
+        const auto grads1 = parameter_gradients(net);
+        const auto states1 = bn_states(net);
+
+        // Run the same step without checkpointing, replaying the dropout masks of the
+        // checkpointed run.  The gradients can only match if the recomputed forward passes
+        // used those masks too.
+        set_all_gradient_checkpointing(net, false);
+        visit_computational_layers(net, [](dropout_& l) { l.set_recomputing_forward(true); });
+        visit_computational_layers(net, [](bn_<CONV_MODE>& l) { l.set_recomputing_forward(true); });
+        const double loss2 = net.compute_parameter_gradients(data, y.begin());
+        const auto grads2 = parameter_gradients(net);
+        DLIB_TEST(bn_states(net) == states1);
+        visit_computational_layers(net, [](dropout_& l) { l.set_recomputing_forward(false); });
+        visit_computational_layers(net, [](bn_<CONV_MODE>& l) { l.set_recomputing_forward(false); });
+
+        DLIB_TEST_MSG(std::abs(loss1 - loss2) < 1e-6, loss1 << " " << loss2);
+        DLIB_TEST(grads1.size() == grads2.size());
+        for (size_t i = 0; i < grads1.size(); ++i)
+        {
+            DLIB_TEST(grads1[i].size() == grads2[i].size());
+            if (grads1[i].size() != 0)
+                DLIB_TEST_MSG(max(abs(grads1[i] - grads2[i])) < 1e-5, max(abs(grads1[i] - grads2[i])));
+        }
+
+        // With new masks the gradients are different.
+        const double loss3 = net.compute_parameter_gradients(data, y.begin());
+        DLIB_TEST(loss3 != loss1);
+    }
+
+    void test_gradient_checkpointing()
+    {
+        print_spinner();
+        using net_type = loss_multiclass_log<fc<3,avg_pool_everything<
+            repeat<3,pres,
+            con<8,3,3,1,1,
+            input<matrix<float>>
+            >>>>>;
+
+        std::vector<matrix<float>> x(4);
+        std::vector<unsigned long> y(4);
+        dlib::rand rnd;
+        for (size_t i = 0; i < x.size(); ++i)
+        {
+            x[i] = matrix_cast<float>(randm(8,8,rnd));
+            y[i] = i%3;
+        }
+
+        net_type net1;
+        resizable_tensor data;
+        net1.to_tensor(x.begin(), x.end(), data);
+        net1.forward(data);
+        net_type net2 = net1;
+
+        auto& rep = net2.subnet().subnet().subnet();
+        DLIB_TEST(rep.get_gradient_checkpointing() == false);
+        set_all_gradient_checkpointing(net2, true);
+        DLIB_TEST(rep.get_gradient_checkpointing() == true);
+
+        // The gradients must be the same as without checkpointing.
+        for (int iter = 0; iter < 2; ++iter)
+        {
+            const double loss1 = net1.compute_parameter_gradients(data, y.begin());
+            const double loss2 = net2.compute_parameter_gradients(data, y.begin());
+            DLIB_TEST(std::abs(loss1 - loss2) < 1e-6);
+
+            std::vector<matrix<float>> grads1, grads2;
+            visit_layer_parameter_gradients(net1, [&](tensor& t) { grads1.push_back(mat(t)); });
+            visit_layer_parameter_gradients(net2, [&](tensor& t) { grads2.push_back(mat(t)); });
+            DLIB_TEST(grads1.size() == grads2.size());
+            for (size_t i = 0; i < grads1.size(); ++i)
+            {
+                DLIB_TEST(grads1[i].size() == grads2[i].size());
+                if (grads1[i].size() != 0)
+                    DLIB_TEST_MSG(max(abs(grads1[i] - grads2[i])) < 1e-5, max(abs(grads1[i] - grads2[i])));
+            }
+
+            // Rerunning the forward passes didn't update the bn_ running statistics
+            // again.
+            DLIB_TEST(bn_states(net1) == bn_states(net2));
+
+            // Only the top repetition keeps its outputs around.
+            DLIB_TEST(rep.get_repeated_layer(0).get_output().size() != 0);
+            DLIB_TEST(rep.get_repeated_layer(1).get_output().size() == 0);
+            DLIB_TEST(rep.get_repeated_layer(2).get_output().size() == 0);
+            DLIB_TEST(layer<2>(rep.get_repeated_layer(1)).get_output().size() == 0);
+
+            std::vector<sgd> solvers1(net1.num_computational_layers), solvers2(net2.num_computational_layers);
+            net1.update_parameters(solvers1, 0.1);
+            net2.update_parameters(solvers2, 0.1);
+        }
+
+        set_all_gradient_checkpointing(net2, false);
+        DLIB_TEST(rep.get_gradient_checkpointing() == false);
+        net2.forward(data);
+        DLIB_TEST(rep.get_repeated_layer(1).get_output().size() != 0);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename SUBNET> using profiled_block = relu<con<8,3,3,1,1,SUBNET>>;
+
+    void test_dnn_profiler()
+    {
+        print_spinner();
+        using net_type = loss_multiclass_log<fc<3,relu<repeat<2,profiled_block,con<8,3,3,1,1,input<matrix<float>>>>>>>;
+
+        std::vector<matrix<float>> x(4);
+        std::vector<unsigned long> y(4);
+        dlib::rand rnd;
+        for (size_t i = 0; i < x.size(); ++i)
+        {
+            x[i] = matrix_cast<float>(randm(8,8,rnd));
+            y[i] = i%3;
+        }
+
+        net_type net;
+        resizable_tensor data;
+        net.to_tensor(x.begin(), x.end(), data);
+
+        dnn_profiler prof;
+        prof.attach(net);
+        // fc, relu, two repetitions of relu and con, and con.
+        DLIB_TEST(prof.num_layers() == 7);
+        prof.attach(net);
+        DLIB_TEST(prof.num_layers() == 7);
+
+        for (int i = 0; i < 3; ++i)
+            net.compute_parameter_gradients(data, y.begin());
+
+        auto stats = prof.get_layer_stats();
+        DLIB_TEST(stats.size() == 7);
+        double total_seconds = 0;
+        for (const auto& s : stats)
+        {
+            DLIB_TEST(s.forward_calls == 3);
+            DLIB_TEST(s.backward_calls == 3);
+            total_seconds += s.total_seconds();
+        }
+        DLIB_TEST(total_seconds > 0);
+        DLIB_TEST(prof.num_trace_events() == 7*6);
+
+        DLIB_TEST(stats[0].index == 1);
+        DLIB_TEST(stats[0].name == "fc");
+        DLIB_TEST(stats[0].output_bytes == 4*3*sizeof(float));
+        DLIB_TEST(stats[0].parameter_bytes == (8*8*8+1)*3*sizeof(float));
+        DLIB_TEST(stats[0].forward_flops == 2.0*4*(8*8*8+1)*3);
+        DLIB_TEST(stats[0].total_forward_flops == 3*stats[0].forward_flops);
+        DLIB_TEST(stats[1].name == "relu");
+        DLIB_TEST(stats[1].forward_flops == 4*8*8*8);
+        DLIB_TEST(stats[6].index == 7);
+        DLIB_TEST(stats[6].name == "con");
+        DLIB_TEST(stats[6].forward_flops == 2.0*(4*8*8*8)*(3*3+1));
+        DLIB_TEST(stats[3].name == "con");
+        DLIB_TEST(stats[3].forward_flops == 2.0*(4*8*8*8)*(8*3*3+1));
+
+        std::ostringstream report;
+        report << prof;
+        DLIB_TEST(report.str().find("layer<1>") != std::string::npos);
+        DLIB_TEST(report.str().find("total") != std::string::npos);
+
+        std::ostringstream trace;
+        prof.write_chrome_trace(trace);
+        const std::string json = trace.str();
+        DLIB_TEST(json.find("{\"traceEvents\":[") == 0);
+        DLIB_TEST(json.find("\"cat\":\"backward\"") != std::string::npos);
+        size_t num_events = 0;
+        for (size_t pos = json.find("\"ph\":\"X\""); pos != std::string::npos; pos = json.find("\"ph\":\"X\"", pos+1))
+            ++num_events;
+        DLIB_TEST(num_events == prof.num_trace_events());
+        DLIB_TEST(json.find('\t') == std::string::npos);
+
+        // Copies of the network aren't profiled.
+        net_type net2 = net;
+        net2.compute_parameter_gradients(data, y.begin());
+        DLIB_TEST(prof.get_layer_stats()[0].forward_calls == 3);
+
+        // The trace stops growing, the statistics don't.
+        prof.clear();
+        prof.set_max_trace_events(10);
+        for (int i = 0; i < 3; ++i)
+            net.compute_parameter_gradients(data, y.begin());
+        DLIB_TEST(prof.num_trace_events() == 10);
+        DLIB_TEST(prof.get_layer_stats()[0].forward_calls == 3);
+
+        prof.detach(net);
+        DLIB_TEST(prof.num_layers() == 0);
+        DLIB_TEST(prof.num_trace_events() == 0);
+        net.compute_parameter_gradients(data, y.begin());
+        prof.attach(net);
+        DLIB_TEST(prof.num_layers() == 7);
+        DLIB_TEST(prof.get_layer_stats()[0].forward_calls == 0);
+        prof.detach(net);
+    }
+
     float tensor_read_cpu(const tensor& t, long i, long k, long r, long c)
     {
         const float* p = t.host() + t.k() * t.nr() * t.nc() * i +
@@ -3834,6 +4768,191 @@ namespace
 
     }
 
+// ----------------------------------------------------------------------------------------
+
+    void test_gradient_accumulation()
+    {
+        print_spinner();
+        ::std::vector<matrix<double>> x(8);
+        ::std::vector<float> y(8);
+        for (size_t i = 0; i < x.size(); ++i)
+        {
+            x[i] = matrix<double>(2,1);
+            x[i] = i/8.0, 1 - i/4.0;
+            y[i] = 3*x[i](0) - x[i](1) + 1;
+        }
+        const ::std::vector<matrix<double>> x1(x.begin(), x.begin()+4), x2(x.begin()+4, x.end());
+        const ::std::vector<float> y1(y.begin(), y.begin()+4), y2(y.begin()+4, y.end());
+
+        using net_type = loss_mean_squared<fc<1, input<matrix<double>>>>;
+        net_type net1;
+        net1(x[0]);
+        net_type net2 = net1;
+
+        // Training on the whole batch should give the same result as accumulating
+        // the gradients of its two halves.
+        dnn_trainer<net_type> trainer1(net1, sgd(0,0.9));
+        dnn_trainer<net_type> trainer2(net2, sgd(0,0.9));
+        DLIB_TEST(trainer2.get_gradient_accumulation_steps() == 1);
+        trainer2.set_gradient_accumulation_steps(2);
+        DLIB_TEST(trainer2.get_gradient_accumulation_steps() == 2);
+        trainer1.set_learning_rate(1e-2);
+        trainer2.set_learning_rate(1e-2);
+        for (int i = 0; i < 5; ++i)
+        {
+            trainer1.train_one_step(x, y);
+            trainer2.train_one_step(x1, y1);
+            trainer2.train_one_step(x2, y2);
+        }
+        trainer1.get_net();
+        trainer2.get_net();
+        DLIB_TEST(trainer2.get_train_one_step_calls() == 10);
+        DLIB_TEST(std::abs(trainer1.get_average_loss() - trainer2.get_average_loss()) < 1e-5);
+
+        const tensor& params1 = layer<1>(net1).layer_details().get_layer_params();
+        const tensor& params2 = layer<1>(net2).layer_details().get_layer_params();
+        DLIB_TEST(max(abs(mat(params1) - mat(params2))) < 1e-5);
+
+        // An unfinished accumulation step must not change the network.
+        trainer2.train_one_step(x1, y1);
+        trainer2.get_net();
+        DLIB_TEST(max(abs(mat(params1) - mat(params2))) < 1e-5);
+
+        std::ostringstream sout;
+        serialize(trainer2, sout);
+        net_type net3;
+        dnn_trainer<net_type> trainer3(net3);
+        std::istringstream sin(sout.str());
+        deserialize(trainer3, sin);
+        DLIB_TEST(trainer3.get_gradient_accumulation_steps() == 2);
+    }
+
+    template <typename solver_type>
+    void check_fused_solver(const solver_type& solver)
+    {
+        print_spinner();
+        using net_type = loss_multiclass_log<fc<3,relu<bn_con<con<4,3,3,1,1,input<matrix<float>>>>>>>;
+        dlib::rand rnd;
+        std::vector<matrix<float>> x(4);
+        std::vector<unsigned long> y(4);
+        for (size_t i = 0; i < x.size(); ++i)
+        {
+            x[i] = matrix_cast<float>(gaussian_randm(6,6,i));
+            y[i] = i%3;
+        }
+
+        net_type net1;
+        // Give the fc biases their own multiplier and turn off learning for the con layer
+        // so all the cases of splitting and skipping layers are covered.
+        layer<1>(net1).layer_details().set_bias_learning_rate_multiplier(0.5);
+        layer<4>(net1).layer_details().set_learning_rate_multiplier(0);
+        resizable_tensor data;
+        net1.to_tensor(x.begin(), x.end(), data);
+        net1.compute_parameter_gradients(data, y.begin());
+        net_type net2 = net1;
+
+        std::vector<solver_type> solvers1(net_type::num_computational_layers, solver);
+        std::vector<solver_type> solvers2(net_type::num_computational_layers, solver);
+        for (int iter = 0; iter < 3; ++iter)
+        {
+            net1.compute_parameter_gradients(data, y.begin());
+            net2.compute_parameter_gradients(data, y.begin());
+            net1.update_parameters(solvers1, 0.1);
+            fused_update_parameters(net2, solvers2, 0.1);
+
+            std::vector<matrix<float>> params1, params2;
+            visit_layer_parameters(net1, [&](tensor& t) { if (t.size() != 0) params1.push_back(mat(t)); });
+            visit_layer_parameters(net2, [&](tensor& t) { if (t.size() != 0) params2.push_back(mat(t)); });
+            DLIB_TEST(params1.size() == params2.size());
+            for (size_t i = 0; i < params1.size(); ++i)
+                DLIB_TEST_MSG(max(abs(params1[i] - params2[i])) < 1e-5, solver << " " << max(abs(params1[i] - params2[i])));
+        }
+
+        std::ostringstream sout;
+        serialize(solvers2[0], sout);
+        solver_type solver2;
+        std::istringstream sin(sout.str());
+        deserialize(solver2, sin);
+        std::ostringstream sout2;
+        serialize(solver2, sout2);
+        DLIB_TEST(sout.str() == sout2.str());
+    }
+
+    void test_fused_solvers()
+    {
+        check_fused_solver(sgd(0.01, 0.9));
+        check_fused_solver(adam(0.01, 0.9, 0.999));
+        check_fused_solver(adamw(0.01, 0.9, 0.999));
+        check_fused_solver(lamb(0.01, 0.9, 0.999));
+        check_fused_solver(lars(0.01, 0.9, 0.01));
+    }
+
+    void test_trainer_synchronization_files()
+    {
+        print_spinner();
+        const std::string sync_file = "dnn_trainer_sync_test.dat";
+        auto remove_sync_files = [&]() {
+            for (auto suffix : {"", "_", ".1", ".2", ".3", "_.1", "_.2", "_.3", ".tmp", "_.tmp"})
+                std::remove((sync_file + suffix).c_str());
+        };
+        auto file_exists = [](const std::string& name) { return !!std::ifstream(name, std::ios::binary); };
+        remove_sync_files();
+
+        ::std::vector<matrix<double>> x(100);
+        ::std::vector<float> y(100);
+        for (size_t i = 0; i < x.size(); ++i)
+        {
+            x[i] = matrix<double>(1,1);
+            x[i] = i/100.0;
+            y[i] = 3*i/100.0 + 1;
+        }
+
+        using net_type = loss_mean_squared<fc<1, input<matrix<double>>>>;
+        net_type net;
+        {
+            dnn_trainer<net_type> trainer(net, sgd(0,0.9));
+            trainer.set_learning_rate(1e-2);
+            trainer.set_mini_batch_size(10);
+            DLIB_TEST(trainer.get_background_synchronization() == false);
+            DLIB_TEST(trainer.get_num_synchronization_file_backups() == 0);
+            trainer.set_background_synchronization(true);
+            trainer.set_num_synchronization_file_backups(2);
+            DLIB_TEST(trainer.get_background_synchronization() == true);
+            DLIB_TEST(trainer.get_num_synchronization_file_backups() == 2);
+            // Save the state after every step.
+            trainer.set_synchronization_file(sync_file, std::chrono::seconds(0));
+            for (int i = 0; i < 20; ++i)
+                trainer.train_one_step(x, y);
+            // Make sure the file written by get_net() is clearly the newest one.
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            trainer.get_net();
+
+            DLIB_TEST(file_exists(sync_file));
+            DLIB_TEST(file_exists(sync_file + "_"));
+            DLIB_TEST(file_exists(sync_file + ".1"));
+            DLIB_TEST(file_exists(sync_file + ".2"));
+            DLIB_TEST(!file_exists(sync_file + ".3"));
+            // Each of the two sync files has its own backups.
+            DLIB_TEST(file_exists(sync_file + "_.1"));
+            DLIB_TEST(file_exists(sync_file + "_.2"));
+            DLIB_TEST(!file_exists(sync_file + "_.3"));
+            DLIB_TEST(!file_exists(sync_file + ".tmp"));
+            DLIB_TEST(!file_exists(sync_file + "_.tmp"));
+        }
+
+        // A new trainer picks up the state saved by get_net().
+        net_type net2;
+        dnn_trainer<net_type> trainer2(net2, sgd(0,0.9));
+        trainer2.set_synchronization_file(sync_file);
+        DLIB_TEST(trainer2.get_train_one_step_calls() == 20);
+        const tensor& params1 = layer<1>(net).layer_details().get_layer_params();
+        const tensor& params2 = layer<1>(net2).layer_details().get_layer_params();
+        DLIB_TEST(params1.size() == params2.size());
+        DLIB_TEST(max(abs(mat(params1) - mat(params2))) == 0);
+
+        remove_sync_files();
+    }
+
 // ----------------------------------------------------------------------------------------
 
     void test_simple_linear_regression_eil()
@@ -5801,12 +6920,16 @@ void test_multm_prev()
             test_transpose();
             test_positional_encodings();
             test_embeddings();
+            test_tied_embeddings();
             test_tril();
             test_adaptive_computation_time_network();
             test_basic_tensor_ops();
             test_resize_to();
             test_layers();
             test_visit_functions();
+            test_gradient_checkpointing();
+            test_gradient_checkpointing_with_dropout();
+            test_dnn_profiler();
             test_copy_tensor_cpu();
             test_copy_tensor_add_to_cpu();
             test_copy_tensor_slice_cpu();
@@ -5814,6 +6937,9 @@ void test_multm_prev()
             test_concat();
             test_multm_prev();
             test_simple_linear_regression();
+            test_trainer_synchronization_files();
+            test_fused_solvers();
+            test_gradient_accumulation();
             test_simple_linear_regression_eil();
             test_simple_linear_regression_with_mult_prev();
             test_multioutput_linear_regression();
@@ -5881,12 +7007,14 @@ void test_multm_prev()
         dnn_onnx_tester (
         ) :
             tester ("test_dnn_onnx",
-                "Runs tests on the dlib DNN ONNX exporter.")
+                "Runs tests on the dlib DNN ONNX exporter, ONNX importer, and runtime_net.")
         {}
 
         void perform_test()
         {
             test_onnx_export();
+            test_onnx_import();
+            test_runtime_net();
         }
     } b;
 }
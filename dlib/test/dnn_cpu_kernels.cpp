@@ -0,0 +1,1022 @@
+// Copyright (C) 2026  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+
+
+#include <dlib/dnn.h>
+#include <dlib/string.h>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "tester.h"
+
+namespace
+{
+    using namespace test;
+    using namespace dlib;
+    using namespace std;
+
+    logger dlog("test.dnn_cpu_kernels");
+
+    /*
+        The kernels in dlib/cuda/cpu_dlib.cpp are vectorized and use approximations of
+        exp(), tanh() and erf().  These tests check them against plain scalar versions
+        using the standard library.
+    */
+
+// ----------------------------------------------------------------------------------------
+
+    void fill_gaussian (
+        dlib::rand& rnd,
+        tensor& t,
+        float mean = 0,
+        float stddev = 1
+    )
+    {
+        for (auto& x : t)
+            x = mean + stddev*rnd.get_random_gaussian();
+    }
+
+    void fill_uniform (
+        dlib::rand& rnd,
+        tensor& t
+    )
+    {
+        for (auto& x : t)
+            x = rnd.get_random_float();
+    }
+
+    void fill_test_values (
+        tensor& t,
+        unsigned long seed
+    )
+    {
+        // Mostly normally distributed numbers but also some values that are far out in
+        // the tails of the activation functions, and some tiny ones.
+        dlib::rand rnd(seed);
+        fill_gaussian(rnd, t, 0, 3);
+        const float special[] = {0, 1e-4f, -1e-4f, 0.5f, -0.7f, 8, -8, 10, -10, 30, -30, 90, -90, 100, -100};
+        float* p = t.host();
+        for (size_t i = 0; i < t.size(); i += 7)
+            p[i] = special[(i/7)%(sizeof(special)/sizeof(special[0]))];
+    }
+
+    float max_relative_error (
+        const tensor& a,
+        const tensor& b
+    )
+    {
+        // This is the relative error for values much larger than 1 and the absolute
+        // error for values much smaller than 1.
+        DLIB_TEST(a.size() == b.size());
+        float err = 0;
+        for (size_t i = 0; i < a.size(); ++i)
+        {
+            const float x = a.host()[i];
+            const float y = b.host()[i];
+            if (std::isnan(x) || std::isnan(y))
+            {
+                if (std::isnan(x) != std::isnan(y))
+                    return std::numeric_limits<float>::infinity();
+                continue;
+            }
+            if (x == y)
+                continue;
+            err = std::max(err, std::abs(x-y)/(1+std::abs(y)));
+        }
+        return err;
+    }
+
+    std::vector<resizable_tensor> test_shapes (
+    )
+    {
+        std::vector<resizable_tensor> shapes;
+        shapes.emplace_back(1,1,1,1);
+        shapes.emplace_back(2,3,1,7);
+        shapes.emplace_back(3,5,4,5);
+        shapes.emplace_back(2,16,9,9);
+        shapes.emplace_back(4,64,16,17);
+        return shapes;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    // Reference implementations, these are the scalar loops the kernels replaced.
+
+    float ref_sigmoid(float x) { return 1/(1+std::exp(-x)); }
+    float ref_mish(float x) { const float e = std::exp(x); const float delta = 2*e + e*e + 2; return x - 2*x/delta; }
+    float ref_gelu(float x) { return 0.5f*x*(1.0f + std::erf(x/sqrt_2)); }
+    float ref_silu(float x) { return x*ref_sigmoid(x); }
+    float ref_elu(float x) { return x > 0 ? x : 0.5f*(std::exp(x) - 1.0f); }
+    float ref_tanh(float x) { return std::tanh(x); }
+
+    float ref_mish_gradient(float x)
+    {
+        if (x >= 8)
+            return 1.f;
+        if (x <= -8)
+            return 0.f;
+        const auto e = std::exp(x);
+        const auto delta = 2*e + e*e + 2;
+        const auto omega = 4*(x + 1) + 4*e*e + e*e*e + e*(4*x + 6);
+        return e*omega/(delta*delta);
+    }
+
+    float ref_gelu_gradient(float x)
+    {
+        const float beta = 1.0f / std::sqrt(2.0f * pi);
+        const float cdf = 0.5f*(1.0f + std::erf(x/sqrt_2));
+        const float pdf = beta*std::exp(-0.5f*x*x);
+        return cdf + x * pdf;
+    }
+
+    float ref_silu_gradient(float x)
+    {
+        const float sig_s = ref_sigmoid(x);
+        return sig_s * (1.0f + x * (1.0f - sig_s));
+    }
+
+    void ref_softmax (
+        const long num_locations,
+        const long num_channels,
+        tensor& dest,
+        const tensor& src,
+        operation_mode mode
+    )
+    {
+        const auto d = dest.host();
+        const auto s = src.host();
+        for (long n = 0; n < src.num_samples(); ++n)
+        {
+            auto ss = s + num_locations * num_channels * n;
+            auto dd = d + num_locations * num_channels * n;
+            if (mode == operation_mode::CHANNEL_WISE)
+            {
+                for (long i = 0; i < num_locations; ++i)
+                {
+                    float max_val = -std::numeric_limits<float>::infinity();
+                    for (long k = 0; k < num_channels; ++k)
+                        max_val = std::max(max_val, ss[k * num_locations + i]);
+                    float sum = 0.0f;
+                    for (long k = 0; k < num_channels; ++k)
+                    {
+                        dd[k * num_locations + i] = std::exp(ss[k * num_locations + i] - max_val);
+                        sum += dd[k * num_locations + i];
+                    }
+                    for (long k = 0; k < num_channels; ++k)
+                        dd[k * num_locations + i] /= sum;
+                }
+            }
+            else
+            {
+                for (long k = 0; k < num_channels; ++k)
+                {
+                    auto s_channel = ss + k * num_locations;
+                    auto d_channel = dd + k * num_locations;
+                    for (long r = 0; r < src.nr(); ++r)
+                    {
+                        float max_val = -std::numeric_limits<float>::infinity();
+                        for (long c = 0, idx = r * src.nc(); c < src.nc(); ++c, ++idx)
+                            max_val = std::max(max_val, s_channel[idx]);
+                        if (max_val == -std::numeric_limits<float>::infinity())
+                        {
+                            for (long c = 0, idx = r * src.nc(); c < src.nc(); ++c, ++idx)
+                                d_channel[idx] = 0.0f;
+                            continue;
+                        }
+                        float sum = 0.0f;
+                        for (long c = 0, idx = r * src.nc(); c < src.nc(); ++c, ++idx)
+                        {
+                            d_channel[idx] = std::exp(s_channel[idx] - max_val);
+                            sum += d_channel[idx];
+                        }
+                        for (long c = 0, idx = r * src.nc(); c < src.nc(); ++c, ++idx)
+                            d_channel[idx] /= sum;
+                    }
+                }
+            }
+        }
+    }
+
+    void ref_layer_normalize (
+        const double eps,
+        resizable_tensor& dest,
+        resizable_tensor& means,
+        resizable_tensor& invstds,
+        const tensor& src,
+        const tensor& gamma,
+        const tensor& beta
+    )
+    {
+        dest.copy_size(src);
+        means.set_size(src.num_samples());
+        invstds.set_size(src.num_samples());
+        const long num = src.k()*src.nr()*src.nc();
+        for (long n = 0; n < src.num_samples(); ++n)
+        {
+            const float* s = src.host() + n*num;
+            double m = 0, m2 = 0;
+            for (long i = 0; i < num; ++i)
+            {
+                m += s[i];
+                m2 += s[i]*s[i];
+            }
+            m /= num;
+            m2 /= num;
+            means.host()[n] = m;
+            invstds.host()[n] = 1.0/std::sqrt(m2 - m*m + eps);
+            for (long i = 0; i < num; ++i)
+            {
+                const long k = i/(src.nr()*src.nc());
+                dest.host()[n*num+i] = (s[i] - means.host()[n])*invstds.host()[n]*gamma.host()[k] + beta.host()[k];
+            }
+        }
+    }
+
+    void ref_rms_normalize (
+        const double eps,
+        resizable_tensor& dest,
+        resizable_tensor& scale,
+        const tensor& src,
+        const tensor& gamma
+    )
+    {
+        dest.copy_size(src);
+        scale.set_size(src.num_samples());
+        const long num = src.k()*src.nr()*src.nc();
+        for (long n = 0; n < src.num_samples(); ++n)
+        {
+            const float* s = src.host() + n*num;
+            double m2 = 0;
+            for (long i = 0; i < num; ++i)
+                m2 += s[i]*s[i];
+            scale.host()[n] = 1.0/std::sqrt(m2/num + eps);
+            for (long i = 0; i < num; ++i)
+            {
+                const long k = i/(src.nr()*src.nc());
+                dest.host()[n*num+i] = s[i]*scale.host()[n]*gamma.host()[k];
+            }
+        }
+    }
+
+    void ref_adam_update (
+        tensor& s,
+        tensor& m,
+        tensor& v,
+        const float t,
+        const float learning_rate,
+        const float weight_decay,
+        const float momentum1,
+        const float momentum2,
+        const tensor& params,
+        const tensor& params_grad
+    )
+    {
+        const float eps = 1e-8;
+        const float alpha = learning_rate*std::sqrt(1-std::pow(momentum2,t))/(1-std::pow(momentum1, t));
+        auto pm = m.host();
+        auto pv = v.host();
+        auto ps = s.host();
+        auto pparams = params.host();
+        auto ppgrad = params_grad.host();
+        for (size_t i = 0; i < params.size(); ++i)
+        {
+            float g = weight_decay*pparams[i] + ppgrad[i];
+            pm[i] = momentum1*pm[i] + (1-momentum1)*g;
+            pv[i] = momentum2*pv[i] + (1-momentum2)*g*g;
+            ps[i] = -alpha*pm[i]/(std::sqrt(pv[i]) + eps);
+        }
+    }
+
+    void ref_solver_update (
+        const tt::solver_update_segment& seg
+    )
+    {
+        using rule = tt::solver_update_rule;
+        const float* p = seg.params->host();
+        const float* g = seg.params_grad->host();
+        float* s1 = seg.state1->host();
+        float* s2 = seg.state2 ? seg.state2->host() : nullptr;
+        const bool in_place = static_cast<const tensor*>(seg.step) == seg.params;
+        const float lr = seg.learning_rate, wd = seg.weight_decay;
+        const float m1 = seg.momentum1, m2 = seg.momentum2;
+
+        std::vector<float> u(seg.end-seg.begin);
+        if (seg.rule == rule::sgd)
+        {
+            for (size_t i = seg.begin; i < seg.end; ++i)
+            {
+                s1[i] = m1*s1[i] - wd*lr*p[i] - lr*g[i];
+                u[i-seg.begin] = s1[i];
+            }
+        }
+        else if (seg.rule == rule::adam || seg.rule == rule::adamw)
+        {
+            const float alpha = lr*std::sqrt(1-std::pow(m2,seg.t))/(1-std::pow(m1,seg.t));
+            for (size_t i = seg.begin; i < seg.end; ++i)
+            {
+                const float gg = (seg.rule == rule::adam ? wd*p[i] : 0) + g[i];
+                s1[i] = m1*s1[i] + (1-m1)*gg;
+                s2[i] = m2*s2[i] + (1-m2)*gg*gg;
+                u[i-seg.begin] = -alpha*s1[i]/(std::sqrt(s2[i]) + 1e-8f) - (seg.rule == rule::adamw ? lr*wd*p[i] : 0);
+            }
+        }
+        else if (seg.rule == rule::lamb)
+        {
+            double pnorm = 0, rnorm = 0;
+            for (size_t i = seg.begin; i < seg.end; ++i)
+            {
+                s1[i] = m1*s1[i] + (1-m1)*g[i];
+                s2[i] = m2*s2[i] + (1-m2)*g[i]*g[i];
+                const float r = (s1[i]/(1-std::pow(m1,seg.t)))/(std::sqrt(s2[i]/(1-std::pow(m2,seg.t))) + 1e-6f) + wd*p[i];
+                u[i-seg.begin] = r;
+                pnorm += p[i]*p[i];
+                rnorm += r*r;
+            }
+            pnorm = std::sqrt(pnorm);
+            rnorm = std::sqrt(rnorm);
+            const double ratio = (pnorm == 0 || rnorm == 0) ? 1 : pnorm/rnorm;
+            for (auto& x : u)
+                x = -lr*ratio*x;
+        }
+        else
+        {
+            double pnorm = 0, gnorm = 0;
+            for (size_t i = seg.begin; i < seg.end; ++i)
+            {
+                pnorm += p[i]*p[i];
+                gnorm += g[i]*g[i];
+            }
+            pnorm = std::sqrt(pnorm);
+            gnorm = std::sqrt(gnorm);
+            const double ratio = (pnorm == 0 || gnorm == 0) ? 1 : seg.trust_coefficient*pnorm/(gnorm + wd*pnorm);
+            for (size_t i = seg.begin; i < seg.end; ++i)
+            {
+                s1[i] = m1*s1[i] + lr*ratio*(g[i] + wd*p[i]);
+                u[i-seg.begin] = -s1[i];
+            }
+        }
+
+        float* out = seg.step->host();
+        for (size_t i = seg.begin; i < seg.end; ++i)
+        {
+            if (in_place)
+                out[i] += u[i-seg.begin];
+            else
+                out[i] = u[i-seg.begin];
+        }
+    }
+
+    void ref_embeddings_gradient (
+        const tensor& prev,
+        const tensor& gradient_input,
+        tensor& grads,
+        const tensor& freqs,
+        float learning_rate,
+        bool scale
+    )
+    {
+        // The kernel this replaced.  It locks one mutex per dictionary entry, which it
+        // allocates on every call.
+        const float* prev_data = prev.host();
+        const float* gradient_input_data = gradient_input.host();
+        const float* freqs_data = freqs.host();
+        float* grads_data = grads.host();
+        long ns = gradient_input.num_samples(), nk = gradient_input.k();
+        long nr = gradient_input.nr(), nc = gradient_input.nc();
+
+        std::vector<dlib::mutex> embedding_mutexes(grads.num_samples());
+        parallel_for(0, ns * nk, [&](long i)
+            {
+                long s = i / nk;
+                long k = i % nk;
+
+                for (long r = 0; r < nr; ++r)
+                {
+                    const unsigned long token_idx = static_cast<unsigned long>(prev_data[tensor_index(prev, s, k, r, 0)]);
+                    if (token_idx < static_cast<unsigned long>(grads.num_samples()))
+                    {
+                        const float freg_token = freqs_data[token_idx];
+                        float freq_scale = 1.0f;
+
+                        if (scale && freg_token != 0.0f) freq_scale = std::min(0.15f, std::max(1.0f / freg_token, 1.0f));
+                        auto_mutex locker(embedding_mutexes[token_idx]);
+                        for (long c = 0; c < nc; ++c)
+                        {
+                            const float gradient = gradient_input_data[tensor_index(gradient_input, s, k, r, c)];
+                            grads_data[tensor_index(grads, token_idx, c, 0, 0)] -= (gradient * learning_rate * freq_scale);
+                        }
+                    }
+                }
+            });
+    }
+
+    void ref_embeddings_adam_update (
+        const tensor& prev,
+        const tensor& gradient_input,
+        tensor& embs,
+        tensor& m,
+        tensor& v,
+        const float t,
+        const float learning_rate,
+        const float momentum1,
+        const float momentum2
+    )
+    {
+        // A dense gradient of the whole table followed by ADAM on the rows that got one.
+        const long nc = embs.k();
+        resizable_tensor grad, s;
+        grad.copy_size(embs);
+        grad = 0;
+        std::vector<bool> touched(embs.num_samples(), false);
+        const float* prev_data = prev.host();
+        for (size_t p = 0; p < prev.size()/prev.nc(); ++p)
+        {
+            const unsigned long token_idx = static_cast<unsigned long>(prev_data[p*prev.nc()]);
+            if (token_idx >= static_cast<unsigned long>(embs.num_samples()))
+                continue;
+            touched[token_idx] = true;
+            for (long c = 0; c < nc; ++c)
+                grad.host()[token_idx*nc + c] += gradient_input.host()[p*nc + c];
+        }
+
+        s.copy_size(embs);
+        resizable_tensor m2 = m, v2 = v;
+        ref_adam_update(s, m2, v2, t, learning_rate, 0, momentum1, momentum2, embs, grad);
+        for (long i = 0; i < embs.num_samples(); ++i)
+        {
+            if (!touched[i])
+                continue;
+            for (long c = 0; c < nc; ++c)
+            {
+                const long idx = i*nc + c;
+                embs.host()[idx] += s.host()[idx];
+                m.host()[idx] = m2.host()[idx];
+                v.host()[idx] = v2.host()[idx];
+            }
+        }
+    }
+
+    void fill_tokens (
+        dlib::rand& rnd,
+        tensor& prev,
+        unsigned long num_embeddings
+    )
+    {
+        // Mostly valid tokens, a few of them very common, and some out of range ones.
+        for (auto& x : prev)
+        {
+            if (rnd.get_random_double() < 0.3)
+                x = rnd.get_random_32bit_number()%3;
+            else
+                x = rnd.get_random_32bit_number()%(num_embeddings + num_embeddings/10 + 1);
+        }
+    }
+
+    void count_tokens (
+        const tensor& prev,
+        tensor& freqs
+    )
+    {
+        freqs = 0;
+        for (auto x : prev)
+        {
+            if (static_cast<unsigned long>(x) < (unsigned long)freqs.num_samples())
+                freqs.host()[static_cast<unsigned long>(x)]++;
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void check_activation (
+        const std::string& name,
+        const std::function<void(tensor&,const tensor&)>& kernel,
+        float (*ref)(float),
+        const float tol
+    )
+    {
+        for (auto& src : test_shapes())
+        {
+            print_spinner();
+            fill_test_values(src, src.size());
+            resizable_tensor dest, expected;
+            dest.copy_size(src);
+            expected.copy_size(src);
+            dest = 123;
+            kernel(dest, src);
+            for (size_t i = 0; i < src.size(); ++i)
+                expected.host()[i] = ref(src.host()[i]);
+            const float err = max_relative_error(dest, expected);
+            DLIB_TEST_MSG(err < tol, name << " size: " << src.size() << " error: " << err);
+
+            // in place
+            resizable_tensor inplace = src;
+            kernel(inplace, inplace);
+            DLIB_TEST_MSG(max(abs(mat(inplace) - mat(dest))) == 0, name);
+        }
+    }
+
+    void check_activation_gradient (
+        const std::string& name,
+        const std::function<void(tensor&,const tensor&,const tensor&)>& kernel,
+        const std::function<void(tensor&,const tensor&)>& forward,
+        const bool uses_output,
+        float (*ref)(float),
+        const float tol
+    )
+    /*!
+        ensures
+            - checks kernel(grad, src or forward(src), gradient_input) against
+              gradient_input*ref(src), both when grad is gradient_input and when the
+              gradient is added to grad.
+    !*/
+    {
+        for (auto& src : test_shapes())
+        {
+            print_spinner();
+            fill_test_values(src, src.size()+1);
+            resizable_tensor out, gradient_input, grad, expected;
+            out.copy_size(src);
+            forward(out, src);
+            gradient_input.copy_size(src);
+            dlib::rand rnd(src.size());
+            fill_gaussian(rnd, gradient_input);
+
+            // grad += gradient_input*f'(x)
+            grad.copy_size(src);
+            grad = 1;
+            kernel(grad, uses_output ? out : src, gradient_input);
+            expected.copy_size(src);
+            for (size_t i = 0; i < src.size(); ++i)
+            {
+                const float x = uses_output ? out.host()[i] : src.host()[i];
+                expected.host()[i] = 1 + gradient_input.host()[i]*ref(x);
+            }
+            float err = max_relative_error(grad, expected);
+            DLIB_TEST_MSG(err < tol, name << " size: " << src.size() << " error: " << err);
+
+            // grad = gradient_input*f'(x)
+            kernel(gradient_input, uses_output ? out : src, gradient_input);
+            expected = mat(expected) - 1;
+            err = max_relative_error(gradient_input, expected);
+            DLIB_TEST_MSG(err < tol, name << " in place, size: " << src.size() << " error: " << err);
+        }
+    }
+
+    void test_activations (
+    )
+    {
+        const auto sigmoid = [](tensor& d, const tensor& s) { cpu::sigmoid(d,s); };
+        const auto tanh = [](tensor& d, const tensor& s) { cpu::tanh(d,s); };
+        const auto mish = [](tensor& d, const tensor& s) { cpu::mish(d,s); };
+        const auto gelu = [](tensor& d, const tensor& s) { cpu::gelu(d,s); };
+        const auto silu = [](tensor& d, const tensor& s) { cpu::silu(d,s); };
+        const auto elu = [](tensor& d, const tensor& s) { cpu::elu(d,s,0.5f); };
+
+        check_activation("sigmoid", sigmoid, ref_sigmoid, 1e-6);
+        check_activation("tanh", tanh, ref_tanh, 1e-6);
+        check_activation("mish", mish, ref_mish, 1e-6);
+        check_activation("gelu", gelu, ref_gelu, 1e-6);
+        check_activation("silu", silu, ref_silu, 1e-6);
+        check_activation("elu", elu, ref_elu, 1e-6);
+
+        check_activation_gradient("sigmoid_gradient",
+            [](tensor& g, const tensor& d, const tensor& gi) { cpu::sigmoid_gradient(g,d,gi); },
+            sigmoid, true, [](float d) { return d*(1-d); }, 1e-6);
+        check_activation_gradient("tanh_gradient",
+            [](tensor& g, const tensor& d, const tensor& gi) { cpu::tanh_gradient(g,d,gi); },
+            tanh, true, [](float d) { return 1-d*d; }, 1e-6);
+        check_activation_gradient("mish_gradient",
+            [](tensor& g, const tensor& s, const tensor& gi) { cpu::mish_gradient(g,s,gi); },
+            mish, false, ref_mish_gradient, 1e-5);
+        check_activation_gradient("gelu_gradient",
+            [](tensor& g, const tensor& s, const tensor& gi) { cpu::gelu_gradient(g,s,gi); },
+            gelu, false, ref_gelu_gradient, 1e-5);
+        check_activation_gradient("silu_gradient",
+            [](tensor& g, const tensor& s, const tensor& gi) { cpu::silu_gradient(g,s,gi); },
+            silu, false, ref_silu_gradient, 1e-5);
+
+        // gelu(x) == x*(1+erf(x/sqrt(2)))/2, so the error in erf() shows up in gelu(x)
+        // scaled by |x|/2.  Check it against a reference computed in double precision,
+        // on a dense grid that includes values close to 0.
+        {
+            resizable_tensor src(1,1,1,24001), dest;
+            for (long i = 0; i < (long)src.size(); ++i)
+                src.host()[i] = (i - 12000)/2000.0f;
+            src.host()[12000] = 1e-6f;
+            dest.copy_size(src);
+            cpu::gelu(dest, src);
+            double worst = 0;
+            for (size_t i = 0; i < src.size(); ++i)
+            {
+                const double x = src.host()[i];
+                const double expected = 0.5*x*(1 + std::erf(x/std::sqrt(2.0)));
+                // Allow for dest being rounded to float, on top of the error in erf().
+                const double rounding = std::abs(expected)*std::numeric_limits<float>::epsilon();
+                worst = std::max(worst, (std::abs(dest.host()[i] - expected) - rounding)/(0.5*std::abs(x)));
+            }
+            DLIB_TEST_MSG(worst < 2.5e-7, "erf() error: " << worst);
+        }
+
+        // NaNs and infinities go through like they do with the std:: functions.
+        resizable_tensor src(1,1,1,4), dest;
+        src.host()[0] = std::numeric_limits<float>::quiet_NaN();
+        src.host()[1] = std::numeric_limits<float>::infinity();
+        src.host()[2] = -std::numeric_limits<float>::infinity();
+        src.host()[3] = 1;
+        dest.copy_size(src);
+        cpu::sigmoid(dest, src);
+        DLIB_TEST(std::isnan(dest.host()[0]));
+        DLIB_TEST(dest.host()[1] == 1);
+        DLIB_TEST(dest.host()[2] == 0);
+        cpu::tanh(dest, src);
+        DLIB_TEST(std::isnan(dest.host()[0]));
+        DLIB_TEST(dest.host()[1] == 1);
+        DLIB_TEST(dest.host()[2] == -1);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_softmax (
+    )
+    {
+        for (auto& src : test_shapes())
+        {
+            print_spinner();
+            fill_test_values(src, src.size()+2);
+            resizable_tensor dest, expected;
+            dest.copy_size(src);
+            expected.copy_size(src);
+
+            cpu::softmax(dest, src, operation_mode::CHANNEL_WISE);
+            ref_softmax(src.nr()*src.nc(), src.k(), expected, src, operation_mode::CHANNEL_WISE);
+            DLIB_TEST_MSG(max_relative_error(dest, expected) < 1e-6, max_relative_error(dest, expected));
+
+            // rows that are all -inf come out as 0 in PLANE_WISE mode
+            src.host()[0] = -std::numeric_limits<float>::infinity();
+            if (src.nc() > 1)
+                std::fill(src.host(), src.host()+src.nc(), -std::numeric_limits<float>::infinity());
+            cpu::softmax(dest, src, operation_mode::PLANE_WISE);
+            ref_softmax(src.nr()*src.nc(), src.k(), expected, src, operation_mode::PLANE_WISE);
+            DLIB_TEST_MSG(max_relative_error(dest, expected) < 1e-6, max_relative_error(dest, expected));
+            if (src.nc() > 1)
+                DLIB_TEST(dest.host()[0] == 0);
+
+            cpu::softmax_all(dest, src);
+            ref_softmax(1, src.k()*src.nr()*src.nc(), expected, src, operation_mode::CHANNEL_WISE);
+            DLIB_TEST_MSG(max_relative_error(dest, expected) < 1e-6, max_relative_error(dest, expected));
+
+            // in place
+            resizable_tensor inplace = src;
+            cpu::softmax_all(inplace, inplace);
+            DLIB_TEST(max_relative_error(inplace, dest) == 0);
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_affine_transforms (
+    )
+    {
+        for (auto& src : test_shapes())
+        {
+            print_spinner();
+            dlib::rand rnd(src.size());
+            resizable_tensor src2, src3, dest, expected;
+            src2.copy_size(src);
+            src3.copy_size(src);
+            fill_gaussian(rnd, src);
+            fill_gaussian(rnd, src2);
+            fill_gaussian(rnd, src3);
+            dest.copy_size(src);
+
+            cpu::affine_transform(dest, src, 2, 3);
+            expected = 2*mat(src) + 3;
+            DLIB_TEST(max_relative_error(dest, expected) < 1e-6);
+
+            cpu::affine_transform(dest, src, src2, 2, 3, 4);
+            expected = 2*mat(src) + 3*mat(src2) + 4;
+            DLIB_TEST(max_relative_error(dest, expected) < 1e-6);
+
+            cpu::affine_transform(dest, src, src2, src3, 2, 3, 4, 5);
+            expected = 2*mat(src) + 3*mat(src2) + 4*mat(src3) + 5;
+            DLIB_TEST(max_relative_error(dest, expected) < 1e-6);
+
+            // only the range gets written
+            dest = 7;
+            const size_t begin = src.size()/3, end = src.size() - src.size()/5;
+            cpu::affine_transform_range(begin, end, dest, src, src2, src3, 2, 3, 4);
+            expected = 2*mat(src) + 3*mat(src2) + 4*mat(src3);
+            for (size_t i = 0; i < src.size(); ++i)
+            {
+                if (begin <= i && i < end)
+                    DLIB_TEST(std::abs(dest.host()[i] - expected.host()[i]) < 1e-5);
+                else
+                    DLIB_TEST(dest.host()[i] == 7);
+            }
+
+            // per element A and B, either one per sample or shared by all samples
+            resizable_tensor A, B;
+            A.copy_size(src);
+            B.copy_size(src);
+            fill_gaussian(rnd, A);
+            fill_gaussian(rnd, B);
+            cpu::affine_transform(dest, src, A, B);
+            expected = pointwise_multiply(mat(A), mat(src)) + mat(B);
+            DLIB_TEST(max_relative_error(dest, expected) < 1e-6);
+
+            A.set_size(1, src.k(), src.nr(), src.nc());
+            B.copy_size(A);
+            fill_gaussian(rnd, A);
+            fill_gaussian(rnd, B);
+            cpu::affine_transform(dest, src, A, B);
+            const long num = A.size();
+            for (size_t i = 0; i < src.size(); ++i)
+                expected.host()[i] = A.host()[i%num]*src.host()[i] + B.host()[i%num];
+            DLIB_TEST(max_relative_error(dest, expected) < 1e-6);
+
+            // per channel A and B
+            A.set_size(1, src.k());
+            B.copy_size(A);
+            fill_gaussian(rnd, A);
+            fill_gaussian(rnd, B);
+            cpu::affine_transform_conv(dest, src, A, B);
+            const long plane = src.nr()*src.nc();
+            for (size_t i = 0; i < src.size(); ++i)
+            {
+                const long k = (i/plane)%src.k();
+                expected.host()[i] = A.host()[k]*src.host()[i] + B.host()[k];
+            }
+            DLIB_TEST(max_relative_error(dest, expected) < 1e-6);
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_normalization (
+    )
+    {
+        const double eps = 1e-5;
+        for (auto& src : test_shapes())
+        {
+            print_spinner();
+            dlib::rand rnd(src.size());
+            fill_gaussian(rnd, src, 1, 2);
+
+            resizable_tensor gamma(1, src.k()), beta(1, src.k());
+            fill_gaussian(rnd, gamma);
+            fill_gaussian(rnd, beta);
+
+            resizable_tensor dest, means, invstds, expected, expected_means, expected_invstds;
+            cpu::layer_normalize(eps, dest, means, invstds, src, gamma, beta);
+            ref_layer_normalize(eps, expected, expected_means, expected_invstds, src, gamma, beta);
+            DLIB_TEST_MSG(max_relative_error(dest, expected) < 1e-4, max_relative_error(dest, expected));
+            DLIB_TEST(max_relative_error(means, expected_means) < 1e-5);
+            // When a sample is a single number its variance is 0 and invstds is decided by
+            // how E[x^2]-E[x]^2 rounds.
+            if (src.size()/src.num_samples() > 1)
+                DLIB_TEST_MSG(max_relative_error(invstds, expected_invstds) < 1e-4, max_relative_error(invstds, expected_invstds));
+
+            resizable_tensor scale, expected_scale;
+            cpu::rms_normalize(eps, dest, scale, src, gamma);
+            ref_rms_normalize(eps, expected, expected_scale, src, gamma);
+            DLIB_TEST_MSG(max_relative_error(dest, expected) < 1e-5, max_relative_error(dest, expected));
+            DLIB_TEST(max_relative_error(scale, expected_scale) < 1e-5);
+
+            // batch norm inference, first with per channel statistics
+            resizable_tensor running_means, running_variances;
+            running_means.copy_size(gamma);
+            running_variances.copy_size(gamma);
+            fill_gaussian(rnd, running_means);
+            fill_uniform(rnd, running_variances);
+            cpu::batch_normalize_conv_inference(eps, dest, src, gamma, beta, running_means, running_variances);
+            expected.copy_size(src);
+            const long plane = src.nr()*src.nc();
+            for (size_t i = 0; i < src.size(); ++i)
+            {
+                const long k = (i/plane)%src.k();
+                expected.host()[i] = gamma.host()[k]*(src.host()[i] - running_means.host()[k])/std::sqrt(running_variances.host()[k] + eps) + beta.host()[k];
+            }
+            DLIB_TEST_MSG(max_relative_error(dest, expected) < 1e-5, max_relative_error(dest, expected));
+
+            // and then with per element statistics
+            gamma.set_size(1, src.k(), src.nr(), src.nc());
+            beta.copy_size(gamma);
+            running_means.copy_size(gamma);
+            running_variances.copy_size(gamma);
+            fill_gaussian(rnd, gamma);
+            fill_gaussian(rnd, beta);
+            fill_gaussian(rnd, running_means);
+            fill_uniform(rnd, running_variances);
+            cpu::batch_normalize_inference(eps, dest, src, gamma, beta, running_means, running_variances);
+            const long num = gamma.size();
+            for (size_t i = 0; i < src.size(); ++i)
+            {
+                const long k = i%num;
+                expected.host()[i] = gamma.host()[k]*(src.host()[i] - running_means.host()[k])/std::sqrt(running_variances.host()[k] + eps) + beta.host()[k];
+            }
+            DLIB_TEST_MSG(max_relative_error(dest, expected) < 1e-5, max_relative_error(dest, expected));
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_adam (
+    )
+    {
+        for (auto& params : test_shapes())
+        {
+            print_spinner();
+            dlib::rand rnd(params.size());
+            resizable_tensor grad, s, m, v;
+            grad.copy_size(params);
+            s.copy_size(params);
+            m.copy_size(params);
+            v.copy_size(params);
+            fill_gaussian(rnd, params);
+            m = 0;
+            v = 0;
+            resizable_tensor s2 = s, m2 = m, v2 = v;
+            for (int t = 1; t <= 3; ++t)
+            {
+                fill_gaussian(rnd, grad);
+                cpu::compute_adam_update(0, params.size(), s, m, v, t, 0.01, 0.0005, 0.9, 0.999, params, grad);
+                ref_adam_update(s2, m2, v2, t, 0.01, 0.0005, 0.9, 0.999, params, grad);
+                DLIB_TEST(max_relative_error(m, m2) < 1e-6);
+                DLIB_TEST(max_relative_error(v, v2) < 1e-6);
+                DLIB_TEST_MSG(max_relative_error(s, s2) < 1e-6, max_relative_error(s, s2));
+            }
+
+            // only the given range is updated
+            const size_t begin = params.size()/4, end = params.size()/2;
+            s = 5;
+            cpu::compute_adam_update(begin, end, s, m, v, 4, 0.01, 0.0005, 0.9, 0.999, params, grad);
+            for (size_t i = 0; i < params.size(); ++i)
+            {
+                if (i < begin || i >= end)
+                    DLIB_TEST(s.host()[i] == 5);
+            }
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_solver_updates (
+    )
+    {
+        using rule = tt::solver_update_rule;
+        // A mix of tiny tensors, like biases, and ones big enough to be split into
+        // several work items.
+        const std::vector<long> sizes = {1, 7, 13, 64, 1000, 40000, 3, 70001};
+        for (auto r : {rule::sgd, rule::adam, rule::adamw, rule::lamb, rule::lars})
+        {
+            for (bool in_place : {true, false})
+            {
+                print_spinner();
+                dlib::rand rnd(sizes.size());
+                const size_t n = sizes.size();
+                std::vector<resizable_tensor> params(n), grads(n), s1(n), s2(n), steps(n);
+                for (size_t j = 0; j < n; ++j)
+                {
+                    params[j].set_size(sizes[j]);
+                    grads[j].set_size(sizes[j]);
+                    s1[j].set_size(sizes[j]);
+                    s2[j].set_size(sizes[j]);
+                    steps[j].set_size(sizes[j]);
+                    fill_gaussian(rnd, params[j]);
+                    s1[j] = 0;
+                    s2[j] = 0;
+                    steps[j] = 0;
+                }
+                // An all zero tensor, where the trust ratio falls back to 1.
+                params[2] = 0;
+                std::vector<resizable_tensor> params2 = params, s12 = s1, s22 = s2, steps2 = steps;
+
+                auto make_segments = [&](std::vector<resizable_tensor>& p, std::vector<resizable_tensor>& st1,
+                    std::vector<resizable_tensor>& st2, std::vector<resizable_tensor>& step, float t)
+                {
+                    std::vector<tt::solver_update_segment> segments;
+                    for (size_t j = 0; j < n; ++j)
+                    {
+                        tt::solver_update_segment seg;
+                        seg.rule = r;
+                        seg.params = &p[j];
+                        seg.params_grad = &grads[j];
+                        seg.state1 = &st1[j];
+                        seg.state2 = &st2[j];
+                        seg.step = in_place ? &p[j] : &step[j];
+                        seg.learning_rate = 0.01*(j+1);
+                        seg.weight_decay = j%3 == 0 ? 0 : 0.01;
+                        seg.momentum1 = 0.9;
+                        seg.momentum2 = 0.999;
+                        seg.t = t;
+                        seg.trust_coefficient = 0.02;
+                        // Split the last tensor in two, like the weights and biases of a
+                        // layer.
+                        if (j+1 == n)
+                        {
+                            seg.end = p[j].size()/3;
+                            segments.push_back(seg);
+                            seg.begin = seg.end;
+                            seg.learning_rate *= 2;
+                        }
+                        seg.end = p[j].size();
+                        segments.push_back(seg);
+                    }
+                    return segments;
+                };
+
+                for (int t = 1; t <= 3; ++t)
+                {
+                    for (auto& g : grads)
+                        fill_gaussian(rnd, g);
+                    tt::apply_solver_updates(make_segments(params, s1, s2, steps, t));
+                    for (auto& seg : make_segments(params2, s12, s22, steps2, t))
+                        ref_solver_update(seg);
+                    for (size_t j = 0; j < n; ++j)
+                    {
+                        DLIB_TEST_MSG(max_relative_error(params[j], params2[j]) < 1e-5, max_relative_error(params[j], params2[j]));
+                        DLIB_TEST_MSG(max_relative_error(steps[j], steps2[j]) < 1e-5, max_relative_error(steps[j], steps2[j]));
+                        DLIB_TEST(max_relative_error(s1[j], s12[j]) < 1e-5);
+                        DLIB_TEST(max_relative_error(s2[j], s22[j]) < 1e-5);
+                    }
+                }
+            }
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_embeddings_updates (
+    )
+    {
+        dlib::rand rnd(1);
+        for (long num_embeddings : {1, 7, 50, 3000})
+        {
+            print_spinner();
+            const long dim = 13;
+            resizable_tensor prev(4,3,20,1), gradient_input(4,3,20,dim), freqs(num_embeddings);
+            resizable_tensor embs(num_embeddings, dim), m, v;
+            fill_gaussian(rnd, embs);
+            m.copy_size(embs);
+            v.copy_size(embs);
+            m = 0;
+            v = 0;
+            resizable_tensor embs2 = embs, m2 = m, v2 = v;
+
+            for (int t = 1; t <= 3; ++t)
+            {
+                fill_tokens(rnd, prev, num_embeddings);
+                fill_gaussian(rnd, gradient_input);
+                count_tokens(prev, freqs);
+                for (bool scale : {true, false})
+                {
+                    const resizable_tensor before = embs;
+                    cpu::embeddings_gradient(prev, gradient_input, embs, freqs, 0.1, scale);
+                    ref_embeddings_gradient(prev, gradient_input, embs2, freqs, 0.1, scale);
+                    DLIB_TEST_MSG(max_relative_error(embs, embs2) < 1e-5, max_relative_error(embs, embs2));
+                    // Rows of tokens that aren't in the batch are exactly as they were.
+                    for (long i = 0; i < num_embeddings; ++i)
+                    {
+                        if (freqs.host()[i] == 0)
+                            DLIB_TEST(max(abs(mat(embs.host()+i*dim, 1, dim) - mat(before.host()+i*dim, 1, dim))) == 0);
+                    }
+                }
+
+                cpu::embeddings_adam_update(prev, gradient_input, embs, m, v, t, 0.01, 0.9, 0.999, 1e-8);
+                ref_embeddings_adam_update(prev, gradient_input, embs2, m2, v2, t, 0.01, 0.9, 0.999);
+                DLIB_TEST_MSG(max_relative_error(embs, embs2) < 1e-5, max_relative_error(embs, embs2));
+                DLIB_TEST(max_relative_error(m, m2) < 1e-5);
+                DLIB_TEST(max_relative_error(v, v2) < 1e-5);
+            }
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    class dnn_cpu_kernels_tester : public tester
+    {
+    public:
+        dnn_cpu_kernels_tester (
+        ) :
+            tester ("test_dnn_cpu_kernels",
+                    "Runs tests on the elementwise and normalization kernels in cpu_dlib.cpp.")
+        {}
+
+        void perform_test (
+        )
+        {
+            test_activations();
+            test_softmax();
+            test_affine_transforms();
+            test_normalization();
+            test_adam();
+            test_solver_updates();
+            test_embeddings_updates();
+        }
+    } a;
+
+}
+
@@ -0,0 +1,241 @@
+// Copyright (C) 2026
+// License: Boost Software License   See LICENSE.txt for the full license.
+
+
+#include <dlib/dnn.h>
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "tester.h"
+
+namespace
+{
+    using namespace test;
+    using namespace dlib;
+    using namespace std;
+
+    logger dlog("test.dnn_generation");
+
+// ----------------------------------------------------------------------------------------
+
+    const long vocab_size = 12;
+    const long context_length = 5;
+    const int pad_token = 0;
+
+    using lm_type = loss_multiclass_log<fc<vocab_size,relu<fc<16,embeddings<vocab_size,8,input<matrix<int,0,1>>>>>>>;
+
+    lm_type make_lm (
+    )
+    {
+        // A randomly initialized model, run once so that its layers are allocated.
+        lm_type net;
+        matrix<int,0,1> window(context_length);
+        window = 1;
+        net(window);
+        return net;
+    }
+
+    std::vector<int> generate_sequentially (
+        lm_type& net,
+        std::vector<int> tokens,
+        const generation_options& options
+    )
+    {
+        // What batched_generator should compute, one token of one request at a time.
+        const size_t prompt_size = tokens.size();
+        token_sampler sampler(options);
+        resizable_tensor x;
+        while (tokens.size() - prompt_size < options.max_new_tokens)
+        {
+            matrix<int,0,1> window(context_length);
+            for (long i = 0; i < context_length; ++i)
+            {
+                const long j = (long)tokens.size() - context_length + i;
+                window(i) = j < 0 ? pad_token : tokens[j];
+            }
+            net.to_tensor(&window, &window + 1, x);
+            net.subnet().forward(x);
+            const tensor& logits = net.subnet().get_output();
+            const int token = sampler(logits.host(), logits.size());
+            if (std::find(options.stop_tokens.begin(), options.stop_tokens.end(), token) != options.stop_tokens.end())
+                break;
+            tokens.push_back(token);
+        }
+        return std::vector<int>(tokens.begin() + prompt_size, tokens.end());
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_token_sampler()
+    {
+        print_spinner();
+        const std::vector<float> logits = {0, 1, 2, 0.5};
+        const long n = logits.size();
+
+        auto frequencies = [&](const generation_options& options)
+        {
+            token_sampler sampler(options);
+            std::vector<double> counts(n, 0);
+            const int num = 20000;
+            for (int i = 0; i < num; ++i)
+            {
+                const int token = sampler(logits.data(), n);
+                DLIB_TEST(0 <= token && token < n);
+                counts[token] += 1.0/num;
+            }
+            return counts;
+        };
+
+        generation_options options;
+        options.temperature = 0;
+        DLIB_TEST(token_sampler(options)(logits.data(), n) == 2);
+        options.temperature = 1;
+        options.top_k = 1;
+        DLIB_TEST(token_sampler(options)(logits.data(), n) == 2);
+
+        // softmax(logits)
+        options.top_k = 0;
+        double total = 0;
+        for (auto l : logits)
+            total += std::exp(l);
+        auto counts = frequencies(options);
+        for (long i = 0; i < n; ++i)
+            DLIB_TEST_MSG(std::abs(counts[i] - std::exp(logits[i])/total) < 0.02, i << ": " << counts[i]);
+
+        // Only the two largest logits.
+        options.top_k = 2;
+        counts = frequencies(options);
+        DLIB_TEST(counts[0] == 0 && counts[3] == 0);
+        DLIB_TEST_MSG(std::abs(counts[2] - std::exp(2)/(std::exp(1) + std::exp(2))) < 0.02, counts[2]);
+
+        // The largest logit alone has probability 0.58, the two largest together 0.79.
+        options.top_k = 0;
+        options.top_p = 0.6;
+        counts = frequencies(options);
+        DLIB_TEST(counts[0] == 0 && counts[3] == 0);
+        options.top_p = 0.4;
+        counts = frequencies(options);
+        DLIB_TEST(counts[0] == 0 && counts[1] == 0 && counts[3] == 0);
+
+        // A high temperature flattens the distribution.
+        options.top_p = 1;
+        options.temperature = 100;
+        counts = frequencies(options);
+        for (long i = 0; i < n; ++i)
+            DLIB_TEST_MSG(std::abs(counts[i] - 0.25) < 0.02, i << ": " << counts[i]);
+
+        // The same seed gives the same tokens.
+        options.temperature = 1;
+        options.seed = 3;
+        token_sampler s1(options), s2(options);
+        for (int i = 0; i < 100; ++i)
+            DLIB_TEST(s1(logits.data(), n) == s2(logits.data(), n));
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_batched_generator()
+    {
+        print_spinner();
+        lm_type net = make_lm();
+        lm_type reference = net;
+
+        std::vector<std::vector<int>> prompts = {{1, 2, 3}, {4}, {5, 6, 7, 8, 9, 10, 11}, {2, 2}, {}, {7, 3, 9}};
+        std::vector<generation_options> options(prompts.size());
+        for (size_t i = 0; i < prompts.size(); ++i)
+        {
+            options[i].max_new_tokens = 3 + 4*i;
+            options[i].seed = i;
+            options[i].top_k = i%3;
+            options[i].temperature = i == 0 ? 0 : 0.7;
+        }
+
+        std::vector<std::vector<int>> expected;
+        for (size_t i = 0; i < prompts.size(); ++i)
+            expected.push_back(generate_sequentially(reference, prompts[i], options[i]));
+
+        {
+            batched_generator<lm_type> gen(net, context_length, pad_token, 4);
+            DLIB_TEST(gen.get_context_length() == context_length);
+            DLIB_TEST(gen.get_pad_token() == pad_token);
+            DLIB_TEST(gen.get_max_batch_size() == 4);
+
+            // Requests submitted from several threads at once, more of them than fit in
+            // a batch, each streaming its tokens.
+            std::vector<std::vector<int>> results(prompts.size()), streamed(prompts.size());
+            std::vector<std::thread> threads;
+            for (size_t i = 0; i < prompts.size(); ++i)
+            {
+                threads.emplace_back([&, i]() {
+                    results[i] = gen.submit(prompts[i], options[i], [&, i](int t) { streamed[i].push_back(t); }).get();
+                });
+            }
+            for (auto& t : threads)
+                t.join();
+
+            size_t total = 0;
+            for (size_t i = 0; i < prompts.size(); ++i)
+            {
+                DLIB_TEST(results[i] == expected[i]);
+                DLIB_TEST(streamed[i] == expected[i]);
+                DLIB_TEST(results[i].size() == options[i].max_new_tokens);
+                total += results[i].size();
+            }
+            DLIB_TEST(gen.num_requests() == 0);
+            DLIB_TEST(gen.get_num_generated_tokens() == total);
+            DLIB_TEST(gen.get_num_steps() >= total/4);
+            DLIB_TEST(gen.get_num_steps() <= total);
+            DLIB_TEST(gen.get_busy_seconds() > 0);
+
+            // Generation stops at a stop token, which isn't returned.
+            generation_options stop = options[2];
+            stop.stop_tokens = {expected[2][3]};
+            auto before_stop = expected[2];
+            before_stop.resize(std::find(before_stop.begin(), before_stop.end(), expected[2][3]) - before_stop.begin());
+            DLIB_TEST(gen.generate(prompts[2], stop) == before_stop);
+            DLIB_TEST(generate_sequentially(reference, prompts[2], stop) == before_stop);
+
+            stop.max_new_tokens = 0;
+            DLIB_TEST(gen.generate(prompts[2], stop).empty());
+
+            // An exception thrown by a callback ends only its own request.
+            auto failing = gen.submit(prompts[0], options[0], [](int) { throw dlib::error("stop streaming"); });
+            auto fine = gen.submit(prompts[1], options[1]);
+            bool threw = false;
+            try
+            {
+                failing.get();
+            }
+            catch (const dlib::error&)
+            {
+                threw = true;
+            }
+            DLIB_TEST(threw);
+            DLIB_TEST(fine.get() == expected[1]);
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    class dnn_generation_tester : public tester
+    {
+    public:
+        dnn_generation_tester (
+        ) :
+            tester ("test_dnn_generation",
+                    "Runs tests on the token sampler and the batched_generator.")
+        {}
+
+        void perform_test (
+        )
+        {
+            test_token_sampler();
+            test_batched_generator();
+        }
+    } a;
+
+}
+
@@ -6,6 +6,9 @@
 #include <fstream>
 #include <vector>
 #include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
 #include <dlib/dir_nav.h>
 #include <dlib/config_reader.h>
 #include <dlib/media.h>
@@ -116,6 +119,92 @@ namespace
         print_spinner();
     }
 
+    void test_frame_pool()
+    {
+        frame_pool pool;
+        const matrix<rgb_pixel> img = get_random_image<rgb_pixel>();
+
+        const uint8_t* data{nullptr};
+        {
+            frame f = pool.get(img.nr(), img.nc(), AV_PIX_FMT_RGB24);
+            DLIB_TEST(f.is_image());
+            DLIB_TEST(f.height() == img.nr());
+            DLIB_TEST(f.width()  == img.nc());
+            DLIB_TEST(f.pixfmt() == AV_PIX_FMT_RGB24);
+            convert(img, f);
+            check_image(f, img);
+            data = f.get_frame().data[0];
+        }
+
+        // The buffer went back to the pool so the next frame of the same size reuses it
+        frame f1 = pool.get(img.nr(), img.nc(), AV_PIX_FMT_RGB24);
+        DLIB_TEST(f1.get_frame().data[0] == data);
+
+        // While f1 is alive the pool hands out a different buffer
+        frame f2 = pool.get(img.nr(), img.nc(), AV_PIX_FMT_RGB24);
+        DLIB_TEST(f2.get_frame().data[0] != f1.get_frame().data[0]);
+
+        // Changing the size doesn't invalidate frames handed out before
+        convert(img, f1);
+        frame f3 = pool.get(img.nr()+1, img.nc()+1, AV_PIX_FMT_GRAY8);
+        DLIB_TEST(f3.height() == img.nr()+1);
+        DLIB_TEST(f3.width()  == img.nc()+1);
+        DLIB_TEST(f3.pixfmt() == AV_PIX_FMT_GRAY8);
+        check_image(f1, img);
+
+        print_spinner();
+    }
+
+    void test_luma_view()
+    {
+        DLIB_TEST(has_luma_plane(AV_PIX_FMT_GRAY8));
+        DLIB_TEST(has_luma_plane(AV_PIX_FMT_YUV420P));
+        DLIB_TEST(has_luma_plane(AV_PIX_FMT_YUVJ420P));
+        DLIB_TEST(has_luma_plane(AV_PIX_FMT_NV12));
+        DLIB_TEST(!has_luma_plane(AV_PIX_FMT_YUYV422));
+        DLIB_TEST(!has_luma_plane(AV_PIX_FMT_RGB24));
+        DLIB_TEST(!has_luma_plane(AV_PIX_FMT_BGR24));
+        DLIB_TEST(!has_luma_plane(AV_PIX_FMT_NONE));
+
+        const matrix<rgb_pixel> img = get_random_image<rgb_pixel>();
+        frame rgb;
+        convert(img, rgb);
+
+        frame yuv;
+        details::resizer resizer;
+        resizer.resize(rgb, rgb.height(), rgb.width(), AV_PIX_FMT_YUV420P, yuv);
+        const uint8_t* data = yuv.get_frame().data[0];
+
+        luma_view view(std::move(yuv));
+        DLIB_TEST(yuv.is_empty());
+        DLIB_TEST(view.nr() == img.nr());
+        DLIB_TEST(view.nc() == img.nc());
+        DLIB_TEST(num_rows(view) == img.nr());
+        DLIB_TEST(num_columns(view) == img.nc());
+        DLIB_TEST(view.data() == data);
+        DLIB_TEST(image_data(view) == data);
+        DLIB_TEST(width_step(view) >= view.nc());
+
+        // The view should look like a grayscale version of the original image
+        matrix<unsigned char> gray, expected;
+        assign_image(gray, view);
+        assign_image(expected, img);
+        DLIB_TEST(have_same_dimensions(gray, expected));
+        DLIB_TEST(max(abs(matrix_cast<int>(gray) - matrix_cast<int>(expected))) < 30);
+
+        // Converting straight into a caller owned image matches going through a frame
+        matrix<rgb_pixel> direct;
+        resizer.resize(rgb, direct);
+        DLIB_TEST(direct == img);
+
+        matrix<unsigned char> small(img.nr()/2+1, img.nc()/2+1);
+        resizer.resize(rgb, small);
+        DLIB_TEST(small.nr() == img.nr()/2+1);
+        DLIB_TEST(small.nc() == img.nc()/2+1);
+
+        print_spinner();
+    }
+
     template <typename pixel_type>
     static double psnr(const matrix<pixel_type>& img1, const matrix<pixel_type>& img2)
     {
@@ -327,6 +416,149 @@ namespace
 //////////////////////////////////////////////////////////////////////////////////////////////////////
 // DEMUXER
 //////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    void test_pipeline (
+        const std::string& filepath,
+        const int nframes,
+        const int height,
+        const int width
+    )
+    {
+        using pipeline = multi_stream_pipeline<array2d<rgb_pixel>>;
+        const std::size_t nstreams = 3;
+
+        // Without dropping, every frame of every stream gets processed, in order within each stream.
+        {
+            pipeline::args args;
+            args.sources.assign(nstreams, demuxer::args{filepath, video_enabled, audio_disabled});
+            args.num_decode_threads = 2;
+            args.batch_size         = 4;
+            args.queue_size         = 4;
+            args.drop_frames        = false;
+
+            std::mutex m;
+            std::vector<uint64_t> counts(nstreams, 0);
+            std::size_t max_batch{0};
+
+            pipeline p(args, [&](std::vector<pipeline::frame_type>& batch)
+            {
+                std::lock_guard<std::mutex> lock(m);
+                max_batch = std::max(max_batch, batch.size());
+                for (const auto& item : batch)
+                {
+                    DLIB_TEST(item.stream_id < nstreams);
+                    DLIB_TEST(item.frame_number == counts[item.stream_id]);
+                    DLIB_TEST(item.img.nr() == height);
+                    DLIB_TEST(item.img.nc() == width);
+                    ++counts[item.stream_id];
+                }
+            });
+
+            DLIB_TEST(p.num_streams() == nstreams);
+            DLIB_TEST(!p.is_running());
+            p.start();
+            p.wait();
+            DLIB_TEST(!p.is_running());
+            DLIB_TEST(p.num_active_streams() == 0);
+
+            for (auto c : counts)
+                DLIB_TEST_MSG(c == (uint64_t)nframes, c << " != " << nframes);
+            DLIB_TEST(max_batch <= args.batch_size);
+
+            const pipeline_stats stats = p.get_stats();
+            DLIB_TEST(stats.frames_decoded   == nstreams*nframes);
+            DLIB_TEST(stats.frames_processed == nstreams*nframes);
+            DLIB_TEST(stats.frames_dropped   == 0);
+            DLIB_TEST(stats.batches_processed > 0);
+            DLIB_TEST(stats.batches_processed <= stats.frames_processed);
+            dlog << LINFO << stats;
+            print_spinner();
+        }
+
+        // With a slow consumer and dropping enabled, frames get dropped but are all accounted for.
+        {
+            pipeline::args args;
+            args.sources.assign(nstreams, demuxer::args{filepath, video_enabled, audio_disabled});
+            args.height             = height/2;
+            args.width              = width/2;
+            args.batch_size         = 2;
+            args.queue_size         = 1;
+            args.drop_frames        = true;
+
+            std::atomic<uint64_t> processed{0};
+
+            pipeline p(args, [&](std::vector<pipeline::frame_type>& batch)
+            {
+                for (const auto& item : batch)
+                {
+                    DLIB_TEST(item.img.nr() == height/2);
+                    DLIB_TEST(item.img.nc() == width/2);
+                }
+                processed += batch.size();
+                std::this_thread::sleep_for(milliseconds(5));
+            });
+
+            p.start();
+            p.wait();
+
+            const pipeline_stats stats = p.get_stats();
+            DLIB_TEST(stats.frames_decoded == nstreams*nframes);
+            DLIB_TEST(stats.frames_processed == processed);
+            DLIB_TEST(stats.frames_processed + stats.frames_dropped == stats.frames_decoded);
+            print_spinner();
+        }
+
+        // Stopping early doesn't hang
+        {
+            pipeline::args args;
+            args.sources.assign(nstreams, demuxer::args{filepath, video_enabled, audio_disabled});
+            args.drop_frames = false;
+
+            pipeline p(args, [&](std::vector<pipeline::frame_type>&)
+            {
+                std::this_thread::sleep_for(milliseconds(1));
+            });
+
+            p.start();
+            std::this_thread::sleep_for(milliseconds(10));
+            p.stop();
+            DLIB_TEST(!p.is_running());
+            print_spinner();
+        }
+
+        // When the batch callback throws the pipeline stops by itself, and wait() rethrows.
+        {
+            pipeline::args args;
+            args.sources.assign(nstreams, demuxer::args{filepath, video_enabled, audio_disabled});
+            args.drop_frames = false;
+
+            pipeline p(args, [&](std::vector<pipeline::frame_type>&)
+            {
+                throw dlib::error("batch failed");
+            });
+
+            p.start();
+            const auto deadline = std::chrono::steady_clock::now() + seconds(10);
+            while (p.is_running() && std::chrono::steady_clock::now() < deadline)
+                std::this_thread::sleep_for(milliseconds(1));
+            DLIB_TEST(!p.is_running());
+            DLIB_TEST(p.num_active_streams() == 0);
+
+            bool threw = false;
+            try
+            {
+                p.wait();
+            }
+            catch (const dlib::error&)
+            {
+                threw = true;
+            }
+            DLIB_TEST(threw);
+            print_spinner();
+        }
+    }
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////
 
     template <
@@ -824,6 +1056,8 @@ namespace
                 test_frame<bgr_pixel>();
                 test_frame<rgb_alpha_pixel>();
                 test_frame<bgr_alpha_pixel>();
+                test_frame_pool();
+                test_luma_view();
 
                 if (codec_supported(AV_CODEC_ID_PNG))
                 {
@@ -922,6 +1156,10 @@ namespace
                     }
 
                     test_demuxer_full(filepath, nframes, height, width, sample_rate, has_video, has_audio);
+
+                    if (has_video)
+                        test_pipeline(filepath, nframes, height, width);
+
                     test_encoder(filepath, AV_CODEC_ID_MPEG4, AV_CODEC_ID_AC3);
                     
                     if (has_video)
@@ -224,6 +224,42 @@ namespace
         test_real_compile_time_sized_ffts<1,131>();    //some large prime
     }
 
+// ----------------------------------------------------------------------------------------
+
+    template<typename R>
+    void test_large_2d_ffts()
+    {
+        // These sizes are big enough that the rows and columns of the transforms get
+        // split over the default_thread_pool().  Check the result against doing the
+        // separable 1D transforms by hand.
+        print_spinner();
+        const R eps = std::is_same<R,float>::value ? 1e-3 : 1e-9;
+        const long nr = 300;
+        const long nc = 512;
+
+        const matrix<complex<R>> m = rand_complex<R>(nr,nc);
+        matrix<complex<R>> expected(nr,nc);
+        for (long r = 0; r < nr; ++r)
+            set_rowm(expected,r) = trans(fft(matrix<complex<R>,0,1>(trans(rowm(m,r)))));
+        for (long c = 0; c < nc; ++c)
+            set_colm(expected,c) = fft(matrix<complex<R>,0,1>(colm(expected,c)));
+
+        const matrix<complex<R>> f = fft(m);
+        DLIB_TEST_MSG(max(norm(f-expected))/max(norm(expected)) < eps, max(norm(f-expected)));
+        DLIB_TEST(max(norm(ifft(f)-m)) < eps);
+
+        matrix<complex<R>> temp = m;
+        fft_inplace(temp);
+        DLIB_TEST(max(norm(temp-f))/max(norm(expected)) < eps);
+
+        const matrix<R> x = rand_real<R>(nr,nc);
+        const matrix<complex<R>> fx = fftr(x);
+        const matrix<complex<R>> fullx = fft(complex_matrix(x));
+        DLIB_TEST(fx.nr() == nr && fx.nc() == nc/2+1);
+        DLIB_TEST(max(norm(fx-colm(fullx,range(0,nc/2))))/max(norm(fullx)) < eps);
+        DLIB_TEST(max(abs(ifftr(fx)-x)) < eps*100);
+    }
+
 // ----------------------------------------------------------------------------------------
     
     template<typename R>
@@ -709,6 +745,8 @@ namespace
             test_against_saved_good_fftrs();
             test_random_ffts();
             test_random_real_ffts();
+            test_large_2d_ffts<float>();
+            test_large_2d_ffts<double>();
             test_linearity_real<float>();
             test_linearity_real<double>();
             test_linearity_complex<float>();
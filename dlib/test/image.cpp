@@ -936,6 +936,25 @@ namespace
 
         }
 
+        // big enough to be computed in parallel
+        print_spinner();
+        img.set_size(731, 617);
+        for (long r = 0; r < img.nr(); ++r)
+        {
+            for (long c = 0; c < img.nc(); ++c)
+                img[r][c] = (int)rnd.get_random_8bit_number() - 100;
+        }
+        int_img.load(img);
+        const matrix<T> m = matrix_cast<T>(mat(img));
+        for (int j = 0; j < 100; ++j)
+        {
+            point p1(rnd.get_random_32bit_number()%img.nc(), rnd.get_random_32bit_number()%img.nr());
+            point p2(rnd.get_random_32bit_number()%img.nc(), rnd.get_random_32bit_number()%img.nr());
+            rectangle rect(p1,p2);
+            DLIB_TEST(int_img.get_sum_of_area(rect) == sum(subm(m, rect)));
+        }
+        DLIB_TEST(int_img.get_sum_of_area(get_rect(img)) == sum(m));
+
 
     }
 
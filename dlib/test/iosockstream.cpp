@@ -9,6 +9,9 @@
 #include <dlib/iosockstream.h>
 #include <dlib/server.h>
 #include <vector>
+#include <atomic>
+#include <chrono>
+#include <memory>
 
 #include "tester.h"
 
@@ -95,11 +98,12 @@ namespace
 
 // ----------------------------------------------------------------------------------------
 
-    void test1()
+    void test1(unsigned long num_workers)
     {
         dlog << LINFO << "in test1()";
         serv theserv;
         theserv.set_listening_port(12345);
+        theserv.set_max_worker_threads(num_workers);
         theserv.start_async();
 
         // wait a little bit to make sure the server has started listening before we try 
@@ -131,11 +135,12 @@ namespace
 
 // ----------------------------------------------------------------------------------------
 
-    void test2()
+    void test2(unsigned long num_workers)
     {
         dlog << LINFO << "in test2()";
         serv2 theserv;
         theserv.set_listening_port(12345);
+        theserv.set_max_worker_threads(num_workers);
         theserv.start_async();
 
         // wait a little bit to make sure the server has started listening before we try 
@@ -157,6 +162,337 @@ namespace
         }
     }
 
+// ----------------------------------------------------------------------------------------
+
+    class echo_serv : public server
+    {
+        /*!
+            Echos back whatever it receives.  Between messages the connection is parked
+            rather than holding one of the worker threads.
+        !*/
+    public:
+        ~echo_serv() { clear(); }
+
+        std::atomic<long> num_calls{0};
+
+    private:
+        void on_connect (
+            connection& 
+        ) {}
+
+        bool on_connection_ready (
+            connection& con
+        )
+        {
+            ++num_calls;
+            char buf[1024];
+            // A timeout of 0 makes read() non-blocking.  New connections are handed
+            // to us before the client has sent anything, in which case we just wait
+            // for it in the parking lot.
+            const long num = con.read(buf, sizeof(buf), 0);
+            if (num == TIMEOUT)
+                return true;
+            if (num <= 0)
+                return false;
+            return con.write(buf, num) == num;
+        }
+    };
+
+    void test_parked_connections()
+    {
+        dlog << LINFO << "in test_parked_connections()";
+        // Many more open connections than worker threads.  This only works if idle
+        // connections don't hold on to a worker.
+        echo_serv theserv;
+        theserv.set_listening_port(12346);
+        theserv.set_max_worker_threads(2);
+        theserv.start_async();
+
+        std::vector<std::unique_ptr<iosockstream>> clients;
+        for (int i = 0; i < 50; ++i)
+            clients.emplace_back(new iosockstream("localhost:12346"));
+
+        for (int round = 0; round < 3; ++round)
+        {
+            print_spinner();
+            for (size_t i = 0; i < clients.size(); ++i)
+            {
+                *clients[i] << "msg" << i << "_" << round << " " << std::flush;
+                std::string temp;
+                *clients[i] >> temp;
+                DLIB_TEST(temp == "msg" + cast_to_string(i) + "_" + cast_to_string(round));
+            }
+        }
+
+        // Each connection is serviced once when it is accepted and once per message.
+        // It doesn't matter which worker did it.
+        DLIB_TEST(theserv.num_calls >= 150);
+
+        clients.clear();
+        theserv.clear();
+        DLIB_TEST(theserv.is_running() == false);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    class http_serv : public server_http
+    {
+    public:
+        ~http_serv() { clear(); }
+
+    private:
+        const std::string on_request (
+            const incoming_things& incoming,
+            outgoing_things& 
+        )
+        {
+            return incoming.path + " " + cast_to_string(incoming.foreign_port) + " " + incoming.body;
+        }
+    };
+
+    class http_streaming_serv : public server_http
+    {
+    public:
+        ~http_streaming_serv() { clear(); }
+
+    private:
+        void on_streaming_request (
+            const incoming_things& incoming,
+            std::istream& request_body,
+            outgoing_things& outgoing,
+            std::ostream& response_body
+        )
+        {
+            outgoing.headers["Content-Type"] = "text/plain";
+            if (incoming.path == "/big")
+            {
+                // Much more than fits in the server's buffer, so it gets sent chunked.
+                for (int i = 0; i < 20000; ++i)
+                    response_body << i << "\n";
+            }
+            else
+            {
+                // echo the body back, one word per line
+                std::string word;
+                while (request_body >> word)
+                    response_body << word << "\n";
+            }
+        }
+    };
+
+    struct http_response
+    {
+        std::string status;
+        key_value_map_ci headers;
+        std::string body;
+    };
+
+    http_response read_http_response (
+        std::istream& in
+    )
+    {
+        http_response res;
+        std::string line;
+        std::getline(in, res.status);
+        while (std::getline(in, line) && line != "\r")
+        {
+            const std::string::size_type pos = line.find(':');
+            res.headers[trim(line.substr(0,pos))] = trim(line.substr(pos+1));
+        }
+
+        // interim responses don't have a body
+        if (res.status.find(" 100 ") != std::string::npos)
+            return res;
+
+        if (res.headers.count("Content-Length"))
+        {
+            res.body.resize(string_cast<unsigned long>(res.headers["Content-Length"]));
+            in.read(&res.body[0], res.body.size());
+        }
+        else if (res.headers["Transfer-Encoding"] == "chunked")
+        {
+            unsigned long size;
+            while (in >> std::hex >> size >> std::dec && size != 0)
+            {
+                std::getline(in, line);
+                std::string chunk(size, ' ');
+                in.read(&chunk[0], size);
+                res.body += chunk;
+            }
+            std::getline(in, line);
+            std::getline(in, line);
+        }
+        else
+        {
+            res.body.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+        return res;
+    }
+
+    void test_http_keep_alive(unsigned long num_workers)
+    {
+        dlog << LINFO << "in test_http_keep_alive()";
+        http_serv theserv;
+        theserv.set_listening_port(12348);
+        theserv.set_max_content_length(1000);
+        theserv.set_max_worker_threads(num_workers);
+        theserv.start_async();
+
+        {
+            iosockstream s("localhost:12348");
+            // Requests one after the other on the same connection.  The body tells us
+            // the client port the server saw, which is the same every time.
+            std::string port;
+            for (int i = 0; i < 3; ++i)
+            {
+                s << "GET /path" << i << " HTTP/1.1\r\nHost: localhost\r\n\r\n" << std::flush;
+                http_response res = read_http_response(s);
+                DLIB_TEST_MSG(res.status == "HTTP/1.1 200 OK\r", res.status);
+                DLIB_TEST(res.headers["Connection"] == "keep-alive");
+                std::istringstream sin(res.body);
+                std::string path, p;
+                sin >> path >> p;
+                DLIB_TEST(path == "/path" + cast_to_string(i));
+                if (i == 0)
+                    port = p;
+                DLIB_TEST(port == p);
+            }
+
+            // Pipelined requests, one with a chunked body.
+            s << "GET /a HTTP/1.1\r\n\r\n"
+              << "POST /b HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhello\r\n6;ext=1\r\n world\r\n0\r\n\r\n"
+              << "POST /c HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc" << std::flush;
+            DLIB_TEST(read_http_response(s).body == "/a " + port + " ");
+            DLIB_TEST(read_http_response(s).body == "/b " + port + " hello world");
+            DLIB_TEST(read_http_response(s).body == "/c " + port + " abc");
+
+            // A chunked body that is too big.  The server gives up on the connection.
+            s << "POST /d HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n7d0\r\n" << std::flush;
+            http_response res = read_http_response(s);
+            DLIB_TEST_MSG(res.status.find("413") != std::string::npos, res.status);
+            DLIB_TEST(res.headers["Connection"] == "close");
+        }
+
+        {
+            // HTTP/1.0 clients only get persistent connections if they ask for them.
+            iosockstream s("localhost:12348");
+            s << "GET /x HTTP/1.0\r\nConnection: keep-alive\r\n\r\n" << std::flush;
+            http_response res = read_http_response(s);
+            DLIB_TEST(res.headers["Connection"] == "keep-alive");
+            s << "GET /y HTTP/1.0\r\n\r\n" << std::flush;
+            res = read_http_response(s);
+            DLIB_TEST(res.headers["Connection"] == "close");
+            DLIB_TEST(res.body.substr(0,3) == "/y ");
+            DLIB_TEST(s.peek() == EOF);
+        }
+
+        {
+            // Idle connections are closed after the keep-alive timeout.
+            theserv.set_keep_alive_timeout(50);
+            iosockstream s("localhost:12348");
+            s << "GET /z HTTP/1.1\r\n\r\n" << std::flush;
+            DLIB_TEST(read_http_response(s).body.substr(0,3) == "/z ");
+            DLIB_TEST(s.peek() == EOF);
+        }
+    }
+
+    void test_http_parked_keep_alive()
+    {
+        dlog << LINFO << "in test_http_parked_keep_alive()";
+        // More kept alive clients than worker threads.  If idle connections held on to
+        // a worker until the keep-alive timeout, the third client would have to wait
+        // that long to be serviced.
+        http_serv theserv;
+        theserv.set_listening_port(12348);
+        theserv.set_max_worker_threads(2);
+        theserv.set_keep_alive_timeout(5000);
+        theserv.start_async();
+
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<std::unique_ptr<iosockstream>> clients;
+        for (int i = 0; i < 10; ++i)
+            clients.emplace_back(new iosockstream("localhost:12348"));
+        for (int round = 0; round < 3; ++round)
+        {
+            print_spinner();
+            for (size_t i = 0; i < clients.size(); ++i)
+            {
+                const std::string path = "/c" + cast_to_string(i) + "_" + cast_to_string(round);
+                *clients[i] << "GET " << path << " HTTP/1.1\r\n\r\n" << std::flush;
+                http_response res = read_http_response(*clients[i]);
+                DLIB_TEST(res.headers["Connection"] == "keep-alive");
+                DLIB_TEST(res.body.substr(0, path.size() + 1) == path + " ");
+            }
+        }
+
+        {
+            // With all of those connections idle, a new client still gets through.
+            iosockstream s("localhost:12348");
+            s << "GET /new HTTP/1.1\r\nConnection: close\r\n\r\n" << std::flush;
+            DLIB_TEST(read_http_response(s).body.substr(0,5) == "/new ");
+            DLIB_TEST(s.peek() == EOF);
+        }
+        DLIB_TEST(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(2500));
+
+        {
+            // Parked connections are closed once they have been idle for the keep-alive
+            // timeout, including ones that never sent a request.
+            theserv.set_keep_alive_timeout(100);
+            iosockstream s("localhost:12348");
+            s << "GET /z HTTP/1.1\r\n\r\n" << std::flush;
+            DLIB_TEST(read_http_response(s).body.substr(0,3) == "/z ");
+            DLIB_TEST(s.peek() == EOF);
+
+            iosockstream silent("localhost:12348");
+            DLIB_TEST(silent.peek() == EOF);
+        }
+
+        // The first clients are still open, and parked with the longer timeout.
+        *clients[0] << "GET /last HTTP/1.1\r\n\r\n" << std::flush;
+        DLIB_TEST(read_http_response(*clients[0]).body.substr(0,6) == "/last ");
+
+        clients.clear();
+        theserv.clear();
+        DLIB_TEST(theserv.is_running() == false);
+    }
+
+    void test_http_streaming()
+    {
+        dlog << LINFO << "in test_http_streaming()";
+        http_streaming_serv theserv;
+        theserv.set_listening_port(12348);
+        theserv.start_async();
+
+        iosockstream s("localhost:12348");
+        s << "GET /big HTTP/1.1\r\n\r\n" << std::flush;
+        http_response res = read_http_response(s);
+        DLIB_TEST(res.headers["Transfer-Encoding"] == "chunked");
+        DLIB_TEST(res.headers["Content-Type"] == "text/plain");
+        std::istringstream sin(res.body);
+        int val, i = 0;
+        while (sin >> val)
+            DLIB_TEST(val == i++);
+        DLIB_TEST(i == 20000);
+
+        // The same connection still works after a chunked response, and the client
+        // gets a 100 Continue before sending its body.
+        s << "POST /echo HTTP/1.1\r\nTransfer-Encoding: chunked\r\nExpect: 100-continue\r\n\r\n" << std::flush;
+        DLIB_TEST(read_http_response(s).status == "HTTP/1.1 100 Continue\r");
+        s << "4\r\nab c\r\n0\r\n\r\n" << std::flush;
+        res = read_http_response(s);
+        DLIB_TEST(res.headers["Content-Length"] == "5");
+        DLIB_TEST(res.body == "ab\nc\n");
+
+        // HEAD responses have no body, even though the handler writes one.
+        s << "HEAD /echo HTTP/1.1\r\nContent-Length: 2\r\n\r\nxy" 
+          << "POST /echo HTTP/1.1\r\nContent-Length: 2\r\n\r\nzw" << std::flush;
+        std::string line;
+        std::getline(s, line);
+        while (std::getline(s, line) && line != "\r") {}
+        res = read_http_response(s);
+        DLIB_TEST(res.body == "zw\n");
+    }
+
 // ----------------------------------------------------------------------------------------
 
     class test_iosockstream : public tester
@@ -171,8 +507,15 @@ namespace
         void perform_test (
         )
         {
-            test1();
-            test2();
+            test1(0);
+            test2(0);
+            test1(3);
+            test2(3);
+            test_parked_connections();
+            test_http_keep_alive(0);
+            test_http_keep_alive(2);
+            test_http_parked_keep_alive();
+            test_http_streaming();
         }
     } a;
 
@@ -0,0 +1,285 @@
+// Copyright (C) 2026  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+
+
+#include <dlib/logger.h>
+#include <dlib/string.h>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tester.h"
+
+namespace
+{
+    using namespace test;
+    using namespace dlib;
+    using namespace std;
+
+    logger dlog("test.logger");
+
+// ----------------------------------------------------------------------------------------
+
+    void print_test_header (
+        std::ostream& out,
+        const std::string& logger_name,
+        const log_level& l,
+        const uint64
+    )
+    {
+        out << l.name << " " << logger_name << ": ";
+    }
+
+    std::vector<std::string> get_lines (
+        const std::string& str
+    )
+    {
+        std::vector<std::string> lines;
+        std::istringstream sin(str);
+        std::string line;
+        while (std::getline(sin, line))
+            lines.push_back(line);
+        return lines;
+    }
+
+    struct message_collector
+    {
+        std::mutex m;
+        std::vector<std::string> messages;
+        std::vector<uint64> thread_ids;
+
+        void log (
+            const std::string& logger_name,
+            const log_level& l,
+            const uint64 thread_id,
+            const char* message_to_log
+        )
+        {
+            std::lock_guard<std::mutex> lock(m);
+            messages.push_back(logger_name + " " + l.name + " " + message_to_log);
+            thread_ids.push_back(thread_id);
+        }
+    };
+
+    struct logs_when_printed
+    {
+        logger* log;
+    };
+
+    std::ostream& operator<< (std::ostream& out, const logs_when_printed& item)
+    {
+        (*item.log) << LINFO << "nested";
+        out << "outer";
+        return out;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_logging_to_stream (
+        bool async
+    )
+    {
+        std::ostringstream sout;
+        logger log("test.logger.stream");
+        log.set_output_stream(sout);
+        log.set_logger_header(print_test_header);
+        log.set_level(LALL);
+
+        if (async)
+            enable_async_logging();
+
+        log << LINFO << "one " << 1;
+        log << LTRACE << "hex " << std::hex << 255;
+        log << LWARN << "dec " << 255;
+        log << LDEBUG;  // nothing written so no message
+        logger child("test.logger.stream.child");
+        child << LERROR << "from child";
+
+        if (async)
+        {
+            DLIB_TEST(async_logging_enabled());
+            flush_async_logging();
+        }
+
+        std::vector<std::string> lines = get_lines(sout.str());
+        DLIB_TEST_MSG(lines.size() == 4, sout.str());
+        DLIB_TEST(lines[0] == "INFO  test.logger.stream: one 1");
+        DLIB_TEST(lines[1] == "TRACE test.logger.stream: hex ff");
+        // Async logging doesn't keep formatting flags from one message to the next.
+        if (async)
+            DLIB_TEST(lines[2] == "WARN  test.logger.stream: dec 255");
+        DLIB_TEST(lines[3] == "ERROR test.logger.stream.child: from child");
+
+        if (async)
+        {
+            // Messages logged while the logger is deep inside a log statement still come
+            // out, it's just that they don't go through the async path.
+            logs_when_printed item;
+            item.log = &log;
+            log << LINFO << item;
+            disable_async_logging();
+            DLIB_TEST(!async_logging_enabled());
+            lines = get_lines(sout.str());
+            DLIB_TEST_MSG(lines.size() == 6, sout.str());
+            DLIB_TEST(lines[4] == "INFO  test.logger.stream: nested");
+            DLIB_TEST(lines[5] == "INFO  test.logger.stream: outer");
+
+            // After disabling things are synchronous again
+            log << LINFO << "sync";
+            lines = get_lines(sout.str());
+            DLIB_TEST(lines.size() == 7 && lines[6] == "INFO  test.logger.stream: sync");
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_async_default_header (
+    )
+    {
+        std::ostringstream sout;
+        logger log("test.logger.header");
+        log.set_output_stream(sout);
+        log.set_level(LALL);
+
+        enable_async_logging();
+        log << LINFO << "hello";
+        disable_async_logging();
+
+        // e.g. "   12 INFO  [0] test.logger.header: hello"
+        const std::string str = sout.str();
+        DLIB_TEST_MSG(str.find(" INFO  [0] test.logger.header: hello\n") != std::string::npos, str);
+        DLIB_TEST_MSG(str.find_first_not_of(" 0123456789") == str.find("INFO"), str);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_async_many_threads (
+    )
+    {
+        // Several threads logging through the same logger.  Every message has to show up
+        // exactly once and the messages from each thread have to stay in order.
+        print_spinner();
+        std::ostringstream sout;
+        logger log("test.logger.threads");
+        log.set_output_stream(sout);
+        log.set_logger_header(print_test_header);
+        log.set_level(LALL);
+        log.set_auto_flush(false);
+
+        enable_async_logging(16);
+
+        const int num_threads = 4;
+        const int num_messages = 2000;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; ++t)
+        {
+            threads.emplace_back([&,t](){
+                for (int i = 0; i < num_messages; ++i)
+                    log << LINFO << t << " " << i;
+            });
+        }
+        for (auto& t : threads)
+            t.join();
+
+        flush_async_logging();
+        DLIB_TEST(num_dropped_async_log_messages() == 0);
+
+        std::vector<int> next(num_threads, 0);
+        std::vector<std::string> lines = get_lines(sout.str());
+        DLIB_TEST(lines.size() == num_threads*num_messages);
+        for (auto& line : lines)
+        {
+            std::istringstream sin(line.substr(line.find(": ")+2));
+            int t = -1, i = -1;
+            sin >> t >> i;
+            DLIB_TEST_MSG(0 <= t && t < num_threads, line);
+            if (0 <= t && t < num_threads)
+            {
+                DLIB_TEST_MSG(next[t] == i, line);
+                next[t] = i+1;
+            }
+        }
+
+        disable_async_logging();
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_async_hooks (
+    )
+    {
+        message_collector col;
+        logger log("test.logger.hook");
+        log.set_output_hook(col, &message_collector::log);
+        log.set_level(LALL);
+
+        enable_async_logging();
+        log << LINFO << "from main";
+        std::thread t([&](){ log << LWARN << "from thread"; });
+        t.join();
+        flush_async_logging();
+
+        DLIB_TEST(col.messages.size() == 2);
+        DLIB_TEST(col.messages[0] == "test.logger.hook INFO  from main");
+        DLIB_TEST(col.messages[1] == "test.logger.hook WARN  from thread");
+        DLIB_TEST(col.thread_ids[0] != col.thread_ids[1]);
+
+        disable_async_logging();
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_async_drop_policy (
+    )
+    {
+        print_spinner();
+        std::ostringstream sout;
+        logger log("test.logger.drop");
+        log.set_output_stream(sout);
+        log.set_logger_header(print_test_header);
+        log.set_level(LALL);
+
+        // With a tiny queue and no waiting some messages are probably going to get
+        // dropped.  But each one is either written or counted as dropped.
+        const uint64 dropped_before = num_dropped_async_log_messages();
+        enable_async_logging(2, ASYNC_LOG_DROP);
+        const int num_messages = 5000;
+        for (int i = 0; i < num_messages; ++i)
+            log << LINFO << i;
+        disable_async_logging();
+
+        const uint64 dropped = num_dropped_async_log_messages() - dropped_before;
+        const std::vector<std::string> lines = get_lines(sout.str());
+        dlog << LINFO << "dropped " << dropped << " of " << num_messages;
+        DLIB_TEST(lines.size() + dropped == num_messages);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    class logger_tester : public tester
+    {
+    public:
+        logger_tester (
+        ) :
+            tester ("test_logger",
+                    "Runs tests on the logger component.")
+        {}
+
+        void perform_test (
+        )
+        {
+            test_logging_to_stream(false);
+            test_logging_to_stream(true);
+            test_async_default_header();
+            test_async_many_threads();
+            test_async_hooks();
+            test_async_drop_policy();
+        }
+    } a;
+
+}
+
+
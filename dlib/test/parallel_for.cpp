@@ -3,8 +3,13 @@
 
 #include "tester.h"
 #include <dlib/threads.h>
+#include <algorithm>
 #include <vector>
 #include <sstream>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
 
 namespace  
 {
@@ -298,6 +303,69 @@ namespace
         }
     }
 
+    void test_parallel_for_on_default_pool()
+    {
+        // The num_threads overloads share the default_thread_pool(), so nesting them
+        // neither deadlocks nor creates new threads.
+        std::mutex m;
+        std::set<std::thread::id> thread_ids;
+        std::vector<std::vector<long>> vals(13, std::vector<long>(1001, 0));
+        parallel_for(4, 0, vals.size(), [&](long i) {
+            parallel_for(4, 0, vals[i].size(), [&](long j) {
+                parallel_for_blocked(3, 0, 10, [&](long begin, long end) {
+                    for (long k = begin; k < end; ++k)
+                        vals[i][j] += k;
+                }, 2);
+                std::lock_guard<std::mutex> lock(m);
+                thread_ids.insert(std::this_thread::get_id());
+            });
+        });
+
+        for (auto& v : vals)
+            for (auto x : v)
+                DLIB_TEST(x == 45);
+        // The calling thread plus the pool's threads are the only ones that did any work.
+        DLIB_TEST(thread_ids.size() <= default_thread_pool().num_threads_in_pool()+1);
+
+        // At most num_threads threads work on a loop at once.
+        std::atomic<long> active(0), max_active(0);
+        parallel_for(2, 0, 64, [&](long) {
+            const long a = ++active;
+            long prev = max_active;
+            while (a > prev && !max_active.compare_exchange_weak(prev, a)) {}
+            dlib::sleep(1);
+            --active;
+        });
+        DLIB_TEST(max_active <= 2);
+
+        // Asking for more threads than the default pool has doesn't create any.
+        const long pool_size = default_thread_pool().num_threads_in_pool();
+        active = 0;
+        max_active = 0;
+        parallel_for(pool_size+2, 0, 64, [&](long) {
+            const long a = ++active;
+            long prev = max_active;
+            while (a > prev && !max_active.compare_exchange_weak(prev, a)) {}
+            dlib::sleep(1);
+            --active;
+        });
+        DLIB_TEST_MSG(max_active <= std::max(1L, pool_size), max_active << " " << pool_size);
+
+        // Once the default pool exists its size can't be changed.
+        const unsigned long num_threads = default_thread_pool().num_threads_in_pool();
+        set_default_thread_pool_size(num_threads);
+        bool got_exception = false;
+        try
+        {
+            set_default_thread_pool_size(num_threads+1);
+        }
+        catch (dlib::error&)
+        {
+            got_exception = true;
+        }
+        DLIB_TEST(got_exception);
+    }
+
     class test_parallel_for_routines : public tester
     {
     public:
@@ -322,6 +390,7 @@ namespace
             test_parallel_for2(50);
 
             test_parallel_for_additional();
+            test_parallel_for_on_default_pool();
         }
     };
 
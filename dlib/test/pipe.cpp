@@ -8,6 +8,9 @@
 #include <ctime>
 #include <dlib/misc_api.h>
 #include <dlib/pipe.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
 
 #include "tester.h"
 
@@ -665,6 +668,245 @@ namespace
 
 
 
+    template <
+        typename pipe
+        >
+    void lock_free_pipe_test (
+        bool many_consumers
+    )
+    /*!
+        requires
+            - pipe is an instantiation of lock_free_pipe with int.  If many_consumers
+              then it must be a PIPE_MPMC pipe.
+        ensures
+            - runs the parts of pipe_kernel_test() that apply to pipes with a non-zero
+              max_size() on pipe.
+    !*/
+    {
+        using namespace pipe_kernel_test_helpers;
+        found_error = false;
+
+        print_spinner();
+        pipe test(10), test2(100), test_1(1);
+
+        DLIB_TEST(test.size() == 0);
+        DLIB_TEST(test.max_size() == 10);
+        DLIB_TEST(test_1.max_size() == 1);
+        DLIB_TEST(test.is_enqueue_enabled() == true);
+        DLIB_TEST(test.is_dequeue_enabled() == true);
+        DLIB_TEST(test.is_enabled() == true);
+
+        int a;
+        a = 3;
+        DLIB_TEST(test.enqueue(a));
+        DLIB_TEST(test.size() == 1);
+        DLIB_TEST(test.enqueue(5));
+        DLIB_TEST(test.size() == 2);
+        a = 0;
+        DLIB_TEST(test.dequeue(a));
+        DLIB_TEST(a == 3);
+        DLIB_TEST(test.dequeue(a));
+        DLIB_TEST(a == 5);
+        DLIB_TEST(test.size() == 0);
+
+        // go around the ring a few times
+        for (int i = 0; i < 35; ++i)
+        {
+            DLIB_TEST(test.enqueue(i+0));
+            DLIB_TEST(test.enqueue(i+1));
+            DLIB_TEST(test.dequeue(a) && a == i);
+            DLIB_TEST(test.dequeue(a) && a == i+1);
+        }
+
+        print_spinner();
+        {
+            create_new_thread(&threadproc1<pipe>,&test);
+            for (unsigned long i = 0; i < proc1_count; ++i)
+            {
+                a = i;
+                test.enqueue(a);
+            }
+            test.disable_enqueue();
+            DLIB_TEST(test.is_enqueue_enabled() == false);
+            a = 1;
+            DLIB_TEST(test.enqueue(a) == false);
+            DLIB_TEST(test.enqueue_or_timeout(a,10) == false);
+            DLIB_TEST(a == 1);
+
+            const int num_consumers = many_consumers ? 3 : 1;
+            for (int i = 0; i < num_consumers; ++i)
+                create_new_thread(&threadproc2<pipe>,&test2);
+
+            for (unsigned long i = 0; i < 100000; ++i)
+            {
+                a = i;
+                if (i%2 == 0)
+                    test2.enqueue(a);
+                else
+                    test2.enqueue_or_timeout(a,100000);
+            }
+
+            test2.wait_for_num_blocked_dequeues(num_consumers);
+            DLIB_TEST(test2.size() == 0);
+            test2.disable();
+            wait_for_threads();
+            DLIB_TEST(test2.size() == 0);
+
+            test2.enable();
+            print_spinner();
+
+            for (int i = 0; i < num_consumers; ++i)
+                create_new_thread(&threadproc3<pipe>,&test2);
+
+            for (unsigned long i = 0; i < 100000; ++i)
+            {
+                a = i;
+                if (i%2 == 0)
+                    test2.enqueue(a);
+                else
+                    test2.enqueue_or_timeout(a,100000);
+            }
+
+            test2.wait_until_empty();
+            test2.wait_for_num_blocked_dequeues(num_consumers);
+            DLIB_TEST(test2.size() == 0);
+            test2.disable();
+            wait_for_threads();
+            DLIB_TEST(test2.size() == 0);
+        }
+
+        print_spinner();
+        test.enable_enqueue();
+        for (int i = 0; i < 100; ++i)
+        {
+            a = 1;
+            test.enqueue_or_timeout(a,0);
+            a = 1;
+            test_1.enqueue_or_timeout(a,0);
+        }
+        DLIB_TEST_MSG(test.size() == 10,"size: " << test.size() );
+        DLIB_TEST_MSG(test_1.size() == 1,"size: " << test_1.size() );
+
+        for (int i = 0; i < 3; ++i)
+        {
+            a = 0;
+            DLIB_TEST(test.enqueue_or_timeout(a,10) == false);
+            DLIB_TEST(a == 0);
+            DLIB_TEST(test_1.enqueue_or_timeout(a,10) == false);
+        }
+
+        for (int i = 0; i < 10; ++i)
+        {
+            a = 0;
+            DLIB_TEST(test.dequeue_or_timeout(a,0) == true);
+            DLIB_TEST(a == 1);
+        }
+        DLIB_TEST(test.dequeue_or_timeout(a,0) == false);
+        DLIB_TEST(test.dequeue_or_timeout(a,10) == false);
+        DLIB_TEST(test.size() == 0);
+
+        test_1.empty();
+        DLIB_TEST(test_1.size() == 0);
+        DLIB_TEST(test_1.dequeue_or_timeout(a,0) == false);
+
+        {
+            // Make sure disable_dequeue() works right
+            test.disable_dequeue();
+            DLIB_TEST(test.is_dequeue_enabled() == false);
+            DLIB_TEST(test.dequeue(a) == false);
+            a = 4;
+            test.enqueue(a);
+            test.wait_until_empty();
+            test.wait_for_num_blocked_dequeues(4);
+            DLIB_TEST(test.size() == 1);
+            DLIB_TEST(test.dequeue(a) == false);
+            DLIB_TEST(test.dequeue_or_timeout(a,10000) == false);
+            DLIB_TEST(test.size() == 1);
+            a = 0;
+            test.enable_dequeue();
+            DLIB_TEST(test.dequeue(a) == true);
+            DLIB_TEST(a == 4);
+            test.wait_until_empty();
+        }
+
+        {
+            // disable() wakes up blocked producers and consumers
+            std::thread t([&](){ int b; DLIB_TEST(test.dequeue(b) == false); });
+            test.wait_for_num_blocked_dequeues(1);
+            test.disable();
+            t.join();
+            DLIB_TEST(test.enqueue(a) == false);
+            test.enable();
+
+            for (int i = 0; i < 10; ++i)
+                DLIB_TEST(test.enqueue(i+0));
+            std::thread t2([&](){ int b = 7; DLIB_TEST(test.enqueue(b) == false); DLIB_TEST(b == 7); });
+            dlib::sleep(50);
+            test.disable();
+            t2.join();
+        }
+
+        DLIB_TEST(found_error == false);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void lock_free_pipe_stress_test (
+    )
+    {
+        // Several producers and consumers hammering a small pipe.  Every item has to come
+        // out exactly once.
+        print_spinner();
+        const int num_producers = 4;
+        const int num_consumers = 4;
+        const long per_producer = 50000;
+        dlib::lock_free_pipe<long> p(8);
+
+        std::vector<std::thread> threads;
+        std::vector<std::vector<long>> got(num_consumers);
+        for (int i = 0; i < num_consumers; ++i)
+        {
+            threads.emplace_back([&,i](){
+                long val;
+                while (p.dequeue(val))
+                    got[i].push_back(val);
+            });
+        }
+        for (int i = 0; i < num_producers; ++i)
+        {
+            threads.emplace_back([&,i](){
+                for (long j = 0; j < per_producer; ++j)
+                    DLIB_TEST(p.enqueue(i*per_producer + j));
+            });
+        }
+
+        for (int i = num_consumers; i < num_consumers+num_producers; ++i)
+            threads[i].join();
+        p.wait_for_num_blocked_dequeues(num_consumers);
+        p.disable();
+        for (int i = 0; i < num_consumers; ++i)
+            threads[i].join();
+
+        std::vector<long> all;
+        for (auto& v : got)
+        {
+            // each producer's items come out in the order they went in
+            std::vector<long> last(num_producers, -1);
+            for (long val : v)
+            {
+                DLIB_TEST(val > last[val/per_producer]);
+                last[val/per_producer] = val;
+            }
+            all.insert(all.end(), v.begin(), v.end());
+        }
+        std::sort(all.begin(), all.end());
+        DLIB_TEST(all.size() == num_producers*per_producer);
+        for (size_t i = 0; i < all.size(); ++i)
+            DLIB_TEST(all[i] == (long)i);
+    }
+
+// ----------------------------------------------------------------------------------------
+
     class pipe_tester : public tester
     {
     public:
@@ -680,6 +922,10 @@ namespace
             pipe_kernel_test<dlib::pipe<int> >();
 
             do_zero_size_test_with_timeouts();
+
+            lock_free_pipe_test<dlib::lock_free_pipe<int,PIPE_SPSC> >(false);
+            lock_free_pipe_test<dlib::lock_free_pipe<int,PIPE_MPMC> >(true);
+            lock_free_pipe_stress_test();
         }
     } a;
 
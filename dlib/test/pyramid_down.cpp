@@ -329,6 +329,179 @@ void test_pyramid_down_small_sizes()
     }
 }
 
+// ----------------------------------------------------------------------------------------
+
+template <typename in_image_type, typename out_image_type>
+void naive_pyramid_down_2_1 (
+    const in_image_type& original,
+    out_image_type& down
+)
+{
+    // The straightforward two pass version of pyramid_down<2> for grayscale output.
+    // The real one filters the rows in bands and, for large images, in parallel.  Its
+    // output must be exactly the same as this.
+    typedef typename pixel_traits<typename image_traits<in_image_type>::pixel_type>::basic_pixel_type bp_type;
+    typedef typename promote<bp_type>::type ptype;
+    matrix<ptype> temp(original.nr(), (original.nc()-3)/2);
+    down.set_size((original.nr()-3)/2, (original.nc()-3)/2);
+    for (long r = 0; r < temp.nr(); ++r)
+    {
+        for (long c = 0; c < temp.nc(); ++c)
+        {
+            ptype p[5];
+            for (long i = 0; i < 5; ++i)
+                assign_pixel(p[i], original[r][2*c+i]);
+            temp(r,c) = p[0] + p[1]*4 + p[2]*6 + p[3]*4 + p[4];
+        }
+    }
+    for (long r = 0; r < down.nr(); ++r)
+    {
+        for (long c = 0; c < down.nc(); ++c)
+        {
+            const long rr = 2*r+2;
+            assign_pixel(down[r][c], (temp(rr-2,c) + temp(rr-1,c)*4 + temp(rr,c)*6 + temp(rr+1,c)*4 + temp(rr+2,c))/256);
+        }
+    }
+}
+
+void naive_pyramid_down_2_1_rgb (
+    const array2d<rgb_pixel>& original,
+    array2d<rgb_pixel>& down
+)
+{
+    down.set_size((original.nr()-3)/2, (original.nc()-3)/2);
+    for (long r = 0; r < down.nr(); ++r)
+    {
+        for (long c = 0; c < down.nc(); ++c)
+        {
+            long red = 0, green = 0, blue = 0;
+            const long w[5] = {1,4,6,4,1};
+            for (long i = 0; i < 5; ++i)
+            {
+                for (long j = 0; j < 5; ++j)
+                {
+                    const rgb_pixel& p = original[2*r+i][2*c+j];
+                    red += w[i]*w[j]*p.red;
+                    green += w[i]*w[j]*p.green;
+                    blue += w[i]*w[j]*p.blue;
+                }
+            }
+            down[r][c] = rgb_pixel(red/256, green/256, blue/256);
+        }
+    }
+}
+
+template <typename image_type>
+void fill_random (
+    dlib::rand& rnd,
+    image_type& img,
+    long nr,
+    long nc
+)
+{
+    img.set_size(nr, nc);
+    for (long r = 0; r < img.nr(); ++r)
+    {
+        for (long c = 0; c < img.nc(); ++c)
+            assign_pixel(img[r][c], rnd.get_random_8bit_number());
+    }
+}
+
+void test_pyramid_down_2_1_matches_naive()
+{
+    dlib::rand rnd;
+    pyramid_down<2> pyr;
+
+    // Include sizes big enough to be split into row bands.
+    const long sizes[][2] = {{9,9}, {10,11}, {57,33}, {120,200}, {513,601}, {720,1280}};
+    for (auto& size : sizes)
+    {
+        print_spinner();
+        const long nr = size[0];
+        const long nc = size[1];
+
+        array2d<unsigned char> gimg, gdown, gdown_naive;
+        fill_random(rnd, gimg, nr, nc);
+        pyr(gimg, gdown);
+        naive_pyramid_down_2_1(gimg, gdown_naive);
+        DLIB_TEST(mat(gdown) == mat(gdown_naive));
+
+        array2d<float> fimg, fdown, fdown_naive;
+        fill_random(rnd, fimg, nr, nc);
+        pyr(fimg, fdown);
+        naive_pyramid_down_2_1(fimg, fdown_naive);
+        DLIB_TEST(mat(fdown) == mat(fdown_naive));
+
+        array2d<rgb_pixel> cimg, cdown, cdown_naive;
+        fill_random(rnd, cimg, nr, nc);
+        for (long r = 0; r < cimg.nr(); ++r)
+        {
+            for (long c = 0; c < cimg.nc(); ++c)
+                cimg[r][c] = rgb_pixel(rnd.get_random_8bit_number(), rnd.get_random_8bit_number(), rnd.get_random_8bit_number());
+        }
+        pyr(cimg, cdown);
+        naive_pyramid_down_2_1_rgb(cimg, cdown_naive);
+        DLIB_TEST(mat(cdown) == mat(cdown_naive));
+
+        // color to grayscale goes through the generic pixel conversion code
+        pyr(cimg, gdown);
+        naive_pyramid_down_2_1(cimg, gdown_naive);
+        DLIB_TEST(mat(gdown) == mat(gdown_naive));
+
+        // sub images have a width_step that isn't the same as their width
+        if (nr > 20 && nc > 20)
+        {
+            const rectangle rect(3,5,nc-4,nr-2);
+            pyr(sub_image(gimg, rect), gdown);
+            array2d<unsigned char> crop;
+            assign_image(crop, sub_image(gimg, rect));
+            naive_pyramid_down_2_1(crop, gdown_naive);
+            DLIB_TEST(mat(gdown) == mat(gdown_naive));
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------------------
+
+template <typename pyramid_type>
+void test_tiled_pyramid()
+{
+    dlib::rand rnd;
+    tiled_pyramid<pyramid_type, array2d<unsigned char>> tp(7, 3);
+    DLIB_TEST(tp.get_padding() == 7);
+    DLIB_TEST(tp.get_outer_padding() == 3);
+    DLIB_TEST(tp.get_rects().size() == 0);
+
+    array2d<unsigned char> img, out;
+    std::vector<rectangle> rects;
+    const unsigned char* data = nullptr;
+    for (int iter = 0; iter < 6; ++iter)
+    {
+        print_spinner();
+        // switch to a new size half way through
+        const long nr = iter < 3 ? 300 : 211;
+        const long nc = iter < 3 ? 400 : 257;
+        fill_random(rnd, img, nr, nc);
+
+        tp.build(img);
+        create_tiled_pyramid<pyramid_type>(img, out, rects, 7, 3);
+        DLIB_TEST(tp.get_rects() == rects);
+        DLIB_TEST(mat(tp.get_image()) == mat(out));
+
+        // frames of the same size are written into the same memory
+        if (iter != 0 && iter != 3)
+            DLIB_TEST(data == image_data(tp.get_image()));
+        data = (const unsigned char*)image_data(tp.get_image());
+    }
+
+    tp.clear();
+    DLIB_TEST(tp.get_rects().size() == 0);
+    DLIB_TEST(num_rows(tp.get_image()) == 0);
+    tp.build(img);
+    DLIB_TEST(tp.get_rects() == rects);
+    DLIB_TEST(mat(tp.get_image()) == mat(out));
+}
+
 // ----------------------------------------------------------------------------------------
 
 
@@ -348,6 +521,10 @@ void test_pyramid_down_small_sizes()
             test_pyramid_down_grayscale();
             print_spinner();
             test_pyramid_down_rgb();
+            test_pyramid_down_2_1_matches_naive();
+            test_tiled_pyramid<pyramid_down<2>>();
+            test_tiled_pyramid<pyramid_down<3>>();
+            test_tiled_pyramid<pyramid_down<4>>();
 
             print_spinner();
             dlog << LINFO << "call test_pyramid_down_small_sizes<pyramid_down<2> >();";
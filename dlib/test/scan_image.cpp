@@ -442,6 +442,56 @@ namespace
         }
     }
 
+// ----------------------------------------------------------------------------------------
+
+    void test_sum_filter_large (
+    )
+    {
+        dlib::rand rnd;
+        print_spinner();
+
+        // big enough to be split into bands of rows
+        array2d<unsigned char> img(613, 587);
+        for (long r = 0; r < img.nr(); ++r)
+        {
+            for (long c = 0; c < img.nc(); ++c)
+                img[r][c] = rnd.get_random_8bit_number();
+        }
+        for (int i = 0; i < 4; ++i)
+        {
+            const rectangle rect = centered_rect(point(rnd.get_random_32bit_number()%20, rnd.get_random_32bit_number()%20),
+                                                 rnd.get_random_32bit_number()%40+1,
+                                                 rnd.get_random_32bit_number()%40+1);
+            array2d<long> out1(img.nr(), img.nc()), out2(img.nr(), img.nc());
+            assign_all_pixels(out1, 0);
+            assign_all_pixels(out2, 0);
+            sum_filter(img, out1, rect);
+            sum_filter_i(img, out2, rect);
+            DLIB_TEST(mat(out1) == mat(out2));
+
+            sum_filter_assign(img, out1, rect);
+            DLIB_TEST(mat(out1) == mat(out2));
+        }
+
+        // The sum of 201*201 pixels of value 65535 doesn't fit in the 32 bit integers
+        // normally used for 16 bit pixels.
+        print_spinner();
+        array2d<uint16> img16(250, 260);
+        assign_all_pixels(img16, 65535);
+        const rectangle rect = centered_rect(point(0,0), 201, 201);
+        array2d<int64> out(img16.nr(), img16.nc());
+        assign_all_pixels(out, 0);
+        sum_filter(img16, out, rect);
+        integral_image iimg;
+        iimg.load(img16);
+        for (long r = 0; r < img16.nr(); ++r)
+        {
+            for (long c = 0; c < img16.nc(); ++c)
+                DLIB_TEST(out[r][c] == iimg.get_sum_of_area(translate_rect(rect, point(c,r)).intersect(get_rect(iimg))));
+        }
+        DLIB_TEST(out[125][130] == 201*201*(int64)65535);
+    }
+
 // ----------------------------------------------------------------------------------------
 
     template <
@@ -534,6 +584,11 @@ namespace
             test_max_filter(20,20,901,1,rnd);
         }
 
+        // big enough to be split into bands of rows and blocks of columns
+        test_max_filter(523,611,13,7,rnd);
+        test_max_filter(523,611,1,1,rnd);
+        test_max_filter(300,700,64,65,rnd);
+
         for (int iter = 0; iter < 200; ++iter)
         {
             print_spinner();
@@ -705,6 +760,7 @@ namespace
 
             test_sum_filter<unsigned char>();
             test_sum_filter<double>();
+            test_sum_filter_large();
         }
     } a;
 
@@ -2,13 +2,19 @@
 // License: Boost Software License   See LICENSE.txt for the full license.
 
 #include <algorithm>
+#include <chrono>
 #include <cstdio>
+#include <fstream>
 #include <memory>
+#include <thread>
+#include <vector>
 
 #include "tester.h"
 #include <dlib/sockets.h>
 #include <dlib/threads.h>
 #include <dlib/array.h>
+#include <dlib/rand.h>
+#include <dlib/string.h>
 
 // This is called an unnamed-namespace and it has the effect of making everything 
 // inside this file "private" so that everything you declare will have static linkage.  
@@ -31,6 +37,240 @@ namespace
         std::remove(socket_name.c_str());
     }
 
+// ----------------------------------------------------------------------------------------
+
+    void make_connected_pair (
+        std::unique_ptr<listener>& list,
+        std::unique_ptr<connection>& a,
+        std::unique_ptr<connection>& b
+    )
+    {
+        DLIB_TEST(create_listener(list, 0, "127.0.0.1") == 0);
+        DLIB_TEST(create_connection(a, list->get_listening_port(), "127.0.0.1") == 0);
+        DLIB_TEST(list->accept(b) == 0);
+    }
+
+    std::string random_bytes (
+        dlib::rand& rnd,
+        size_t num
+    )
+    {
+        std::string data(num, 0);
+        for (auto& c : data)
+            c = static_cast<char>(rnd.get_random_8bit_number());
+        return data;
+    }
+
+    std::string read_bytes (
+        connection& con,
+        size_t num
+    )
+    {
+        std::string data(num, 0);
+        size_t pos = 0;
+        while (pos < num)
+        {
+            const long status = con.read(&data[pos], num-pos);
+            if (status <= 0)
+                break;
+            pos += status;
+        }
+        data.resize(pos);
+        return data;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_gather_and_scatter (
+    )
+    {
+        print_spinner();
+        std::unique_ptr<listener> list;
+        std::unique_ptr<connection> a, b;
+        make_connected_pair(list, a, b);
+
+        dlib::rand rnd;
+        const std::string header = "header";
+        const std::string payload = random_bytes(rnd, 300000);
+
+        // Write a header, an empty buffer, and a big payload with one call.  It's big
+        // enough that it takes many system calls, so the partial write handling gets used.
+        std::thread writer([&](){
+            connection::const_buffer bufs[3];
+            bufs[0].data = header.data();
+            bufs[0].size = header.size();
+            bufs[1].data = 0;
+            bufs[1].size = 0;
+            bufs[2].data = payload.data();
+            bufs[2].size = payload.size();
+            DLIB_TEST(a->write(bufs, 3) == (long)(header.size() + payload.size()));
+            a->shutdown_outgoing();
+        });
+
+        std::string received;
+        std::vector<char> part1(10), part2(1000);
+        while (true)
+        {
+            connection::mutable_buffer bufs[2];
+            bufs[0].data = &part1[0];
+            bufs[0].size = part1.size();
+            bufs[1].data = &part2[0];
+            bufs[1].size = part2.size();
+            const long status = b->read(bufs, 2);
+            DLIB_TEST(status >= 0);
+            if (status <= 0)
+                break;
+            received.append(&part1[0], std::min<long>(status, part1.size()));
+            if (status > (long)part1.size())
+                received.append(&part2[0], status-part1.size());
+        }
+        writer.join();
+
+        DLIB_TEST(received == header + payload);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_write_some (
+    )
+    {
+        print_spinner();
+        std::unique_ptr<listener> list;
+        std::unique_ptr<connection> a, b;
+        make_connected_pair(list, a, b);
+
+        DLIB_TEST(a->set_send_buffer_size(4096) == 0);
+        DLIB_TEST(b->set_receive_buffer_size(4096) == 0);
+
+        // Nobody is reading from b, so sooner or later write_some() has to say it can't
+        // write any more rather than blocking.
+        const std::vector<char> buf(64*1024, 'x');
+        long total = 0;
+        long status;
+        while ((status = a->write_some(&buf[0], buf.size(), 0)) > 0)
+        {
+            total += status;
+            DLIB_TEST_MSG(total < 100*1024*1024, "write_some() never filled the socket buffers");
+            if (total >= 100*1024*1024)
+                return;
+        }
+        DLIB_TEST(status == TIMEOUT);
+        DLIB_TEST(total > 0);
+
+        const auto start = std::chrono::steady_clock::now();
+        DLIB_TEST(a->write_some(&buf[0], buf.size(), 50) == TIMEOUT);
+        DLIB_TEST(std::chrono::steady_clock::now()-start >= std::chrono::milliseconds(40));
+
+        // now everything we wrote should be there to read
+        const std::string data = read_bytes(*b, total);
+        DLIB_TEST(data.size() == (size_t)total);
+        DLIB_TEST(data == std::string(total, 'x'));
+
+        // and then there shouldn't be anything left
+        char ch;
+        DLIB_TEST(b->read(&ch, 1, 0) == TIMEOUT);
+
+        a->shutdown_outgoing();
+        DLIB_TEST(a->write_some(&buf[0], buf.size(), 0) == SHUTDOWN);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_socket_options (
+    )
+    {
+        print_spinner();
+        std::unique_ptr<listener> list;
+        std::unique_ptr<connection> a, b;
+        make_connected_pair(list, a, b);
+
+        DLIB_TEST(a->get_send_buffer_size() > 0);
+        DLIB_TEST(a->get_receive_buffer_size() > 0);
+        DLIB_TEST(a->set_send_buffer_size(256*1024) == 0);
+        DLIB_TEST(a->set_receive_buffer_size(256*1024) == 0);
+        // The OS may round these but it shouldn't make them much smaller.
+        dlog << LINFO << "send buffer size: " << a->get_send_buffer_size();
+        dlog << LINFO << "receive buffer size: " << a->get_receive_buffer_size();
+        DLIB_TEST(a->get_send_buffer_size() >= 128*1024);
+        DLIB_TEST(a->get_receive_buffer_size() >= 128*1024);
+        DLIB_TEST(a->set_keepalive(true) == 0);
+        DLIB_TEST(a->set_keepalive(false) == 0);
+        DLIB_TEST(a->disable_nagle() == 0);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_connect_with_timeout (
+    )
+    {
+        print_spinner();
+        std::unique_ptr<listener> list;
+        DLIB_TEST(create_listener(list, 0, "127.0.0.1") == 0);
+        const unsigned short port = list->get_listening_port();
+
+        std::unique_ptr<connection> a, b;
+        DLIB_TEST(create_connection(a, port, "127.0.0.1", 0, "", 5000) == 0);
+        DLIB_TEST(list->accept(b) == 0);
+        DLIB_TEST(a->get_foreign_port() == port);
+        DLIB_TEST(a->write("hi", 2) == 2);
+        DLIB_TEST(read_bytes(*b, 2) == "hi");
+
+        // the extension's connect() uses the same thing for ip addresses
+        a.reset(connect("127.0.0.1", port, 5000));
+        DLIB_TEST(list->accept(b) == 0);
+        DLIB_TEST(a->write("yo", 2) == 2);
+        DLIB_TEST(read_bytes(*b, 2) == "yo");
+
+        // Nobody is listening anymore so this should fail right away.
+        list.reset();
+        a.reset();
+        DLIB_TEST(create_connection(a, port, "127.0.0.1", 0, "", 5000) == OTHER_ERROR);
+        DLIB_TEST(!a);
+        bool threw = false;
+        try { connect("127.0.0.1", port, 5000); } catch (socket_error&) { threw = true; }
+        DLIB_TEST(threw);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_send_file (
+    )
+    {
+        print_spinner();
+        const std::string filename = "dlib_test_send_file.dat";
+        dlib::rand rnd;
+        const std::string contents = random_bytes(rnd, 200000);
+        {
+            std::ofstream fout(filename.c_str(), std::ios::binary);
+            fout.write(contents.data(), contents.size());
+        }
+
+        std::unique_ptr<listener> list;
+        std::unique_ptr<connection> a, b;
+        make_connected_pair(list, a, b);
+
+        std::thread writer([&](){
+            DLIB_TEST(send_file(*a, filename) == contents.size());
+            DLIB_TEST(send_file(*a, filename, 1000, 5000) == 5000);
+            // ranges past the end of the file get clipped
+            DLIB_TEST(send_file(*a, filename, contents.size()-10, 100) == 10);
+            DLIB_TEST(send_file(*a, filename, contents.size()+10) == 0);
+        });
+
+        DLIB_TEST(read_bytes(*b, contents.size()) == contents);
+        DLIB_TEST(read_bytes(*b, 5000) == contents.substr(1000, 5000));
+        DLIB_TEST(read_bytes(*b, 10) == contents.substr(contents.size()-10));
+        writer.join();
+
+        bool threw = false;
+        try { send_file(*a, "this file does not exist"); } catch (socket_error&) { threw = true; }
+        DLIB_TEST(threw);
+
+        std::remove(filename.c_str());
+    }
+
+// ----------------------------------------------------------------------------------------
+
     class sockets2_tester : public tester, private multithreaded_object 
     {
         /*!
@@ -126,6 +366,11 @@ namespace
         )
         {
             test_bad_unix_socket_paths();
+            test_gather_and_scatter();
+            test_write_some();
+            test_socket_options();
+            test_connect_with_timeout();
+            test_send_file();
 
             test_unix = false;
             test_user_sock = false;
@@ -161,10 +161,14 @@ namespace
         ) :
             C(10),
             eps(1e-4),
-            verbose(false)
+            verbose(false),
+            load_balanced(false)
         {
         }
 
+        void be_load_balanced (
+        ) { load_balanced = true; }
+
         trained_function_type train (
             const std::vector<sample_type>& all_samples,
             const std::vector<label_type>& all_labels
@@ -195,6 +199,13 @@ namespace
 
             std::vector<label_type> labels1(all_labels.begin(), all_labels.begin()+all_labels.size()/2);
             std::vector<label_type> labels2(all_labels.begin()+all_labels.size()/2, all_labels.end());
+            // When load balancing, each node has all the samples and the controller
+            // decides who works on what.
+            if (load_balanced)
+            {
+                samples1 = samples2 = all_samples;
+                labels1 = labels2 = all_labels;
+            }
             test_multiclass_svm_problem<w_type, sample_type, label_type> problem1(samples1, labels1);
             test_multiclass_svm_problem<w_type, sample_type, label_type> problem2(samples2, labels2);
             problem1.set_max_cache_size(3);
@@ -213,6 +224,8 @@ namespace
                 controller.be_verbose();
             controller.add_processing_node("127.0.0.1", 12345);
             controller.add_processing_node("localhost:12346");
+            if (load_balanced)
+                controller.enable_load_balancing();
             svm_objective = controller(solver, weights);
 
 
@@ -230,6 +243,7 @@ namespace
         scalar_type C;
         scalar_type eps;
         bool verbose;
+        bool load_balanced;
         mutable oca solver;
     };
 
@@ -528,13 +542,15 @@ namespace
             test_svm_multiclass_linear_trainer3<kernel_type> trainer3;
             test_svm_multiclass_linear_trainer4<kernel_type> trainer4;
             test_svm_multiclass_linear_trainer5<kernel_type> trainer5;
+            test_svm_multiclass_linear_trainer2<kernel_type> trainer6;
+            trainer6.be_load_balanced();
 
             trainer1.set_epsilon(1e-4);
             trainer1.set_c(10);
 
 
-            multiclass_linear_decision_function<kernel_type,double> df1, df2, df3, df4, df5;
-            double obj1, obj2, obj3, obj4, obj5;
+            multiclass_linear_decision_function<kernel_type,double> df1, df2, df3, df4, df5, df6;
+            double obj1, obj2, obj3, obj4, obj5, obj6;
 
             // Solve a multiclass SVM a whole bunch of different ways and make sure
             // they all give the same answer.
@@ -549,40 +565,49 @@ namespace
             print_spinner();
             df5 = trainer5.train(samples, labels, obj5);
             print_spinner();
+            df6 = trainer6.train(samples, labels, obj6);
+            print_spinner();
 
             dlog << LINFO << "obj1: "<< obj1;
             dlog << LINFO << "obj2: "<< obj2;
             dlog << LINFO << "obj3: "<< obj3;
             dlog << LINFO << "obj4: "<< obj4;
             dlog << LINFO << "obj5: "<< obj5;
+            dlog << LINFO << "obj6: "<< obj6;
             DLIB_TEST(std::abs(obj1 - obj2) < 1e-2);
             DLIB_TEST(std::abs(obj1 - obj3) < 1e-2);
             DLIB_TEST(std::abs(obj1 - obj4) < 1e-2);
             DLIB_TEST(std::abs(obj1 - obj5) < 1e-2);
+            DLIB_TEST(std::abs(obj1 - obj6) < 1e-2);
             DLIB_TEST(std::abs(obj1 - true_obj) < 1e-2);
             DLIB_TEST(std::abs(obj2 - true_obj) < 1e-2);
             DLIB_TEST(std::abs(obj3 - true_obj) < 1e-2);
             DLIB_TEST(std::abs(obj4 - true_obj) < 1e-2);
             DLIB_TEST(std::abs(obj5 - true_obj) < 1e-2);
+            DLIB_TEST(std::abs(obj6 - true_obj) < 1e-2);
 
             dlog << LINFO << "weight error: "<< max(abs(df1.weights - df2.weights));
             dlog << LINFO << "weight error: "<< max(abs(df1.weights - df3.weights));
             dlog << LINFO << "weight error: "<< max(abs(df1.weights - df4.weights));
             dlog << LINFO << "weight error: "<< max(abs(df1.weights - df5.weights));
+            dlog << LINFO << "weight error: "<< max(abs(df1.weights - df6.weights));
 
             DLIB_TEST(max(abs(df1.weights - df2.weights)) < 1e-2);
             DLIB_TEST(max(abs(df1.weights - df3.weights)) < 1e-2);
             DLIB_TEST(max(abs(df1.weights - df4.weights)) < 1e-2);
             DLIB_TEST(max(abs(df1.weights - df5.weights)) < 1e-2);
+            DLIB_TEST(max(abs(df1.weights - df6.weights)) < 1e-2);
 
             dlog << LINFO << "b error: "<< max(abs(df1.b - df2.b));
             dlog << LINFO << "b error: "<< max(abs(df1.b - df3.b));
             dlog << LINFO << "b error: "<< max(abs(df1.b - df4.b));
             dlog << LINFO << "b error: "<< max(abs(df1.b - df5.b));
+            dlog << LINFO << "b error: "<< max(abs(df1.b - df6.b));
             DLIB_TEST(max(abs(df1.b - df2.b)) < 1e-2);
             DLIB_TEST(max(abs(df1.b - df3.b)) < 1e-2);
             DLIB_TEST(max(abs(df1.b - df4.b)) < 1e-2);
             DLIB_TEST(max(abs(df1.b - df5.b)) < 1e-2);
+            DLIB_TEST(max(abs(df1.b - df6.b)) < 1e-2);
 
             matrix<double> res = test_multiclass_decision_function(df1, samples, labels);
             dlog << LINFO << res;
@@ -608,6 +633,11 @@ namespace
             dlog << LINFO << res;
             dlog << LINFO << "accuracy: " << sum(diag(res))/sum(res);
             DLIB_TEST(sum(diag(res)) == samples.size());
+
+            res = test_multiclass_decision_function(df6, samples, labels);
+            dlog << LINFO << res;
+            dlog << LINFO << "accuracy: " << sum(diag(res))/sum(res);
+            DLIB_TEST(sum(diag(res)) == samples.size());
         }
 
         void perform_test (
@@ -6,6 +6,9 @@
 #include <string>
 #include <cstdlib>
 #include <ctime>
+#include <atomic>
+#include <mutex>
+#include <vector>
 #include <dlib/misc_api.h>
 #include <dlib/threads.h>
 #include <dlib/any.h>
@@ -72,6 +75,87 @@ namespace
     void gadd1(int& a, int& res) { res += a; }
     void gadd2 (int c, int a, const int& b, int& res) { dlib::sleep(20); res = a + b + c; }
 
+    void test_nested_parallel_for (
+    )
+    {
+        // Tasks that run parallel_for() on the same pool and wait on it.  Since waiting
+        // workers run queued tasks this must finish even when every worker is busy
+        // with an outer task.
+        for (unsigned long num_threads = 1; num_threads <= 4; ++num_threads)
+        {
+            print_spinner();
+            thread_pool tp(num_threads);
+            std::vector<std::vector<int>> vals(20, std::vector<int>(1000, 0));
+            std::mutex m;
+            parallel_for(tp, 0, vals.size(), [&](long i) {
+                DLIB_TEST(tp.is_task_thread());
+                parallel_for(tp, 0, vals[i].size(), [&](long j) {
+                    // The blocks may run at the same time, so each adds its sum once.
+                    parallel_for_blocked(tp, 0, 3, [&](long begin, long end) {
+                        int sum = 0;
+                        for (long k = begin; k < end; ++k)
+                            sum += k+1;
+                        std::lock_guard<std::mutex> lock(m);
+                        vals[i][j] += sum;
+                    });
+                });
+            });
+
+            for (auto& v : vals)
+                for (auto x : v)
+                    DLIB_TEST(x == 6);
+
+            // exceptions thrown by nested loops make it out to the caller
+            bool got_exception = false;
+            try
+            {
+                parallel_for(tp, 0, 8, [&](long i) {
+                    parallel_for(tp, 0, 100, [&](long j) {
+                        if (i == 3 && j == 57)
+                            throw dlib::error("nested exception");
+                    });
+                });
+            }
+            catch (dlib::error& e)
+            {
+                DLIB_TEST(e.info == "nested exception");
+                got_exception = true;
+            }
+            DLIB_TEST(got_exception);
+        }
+    }
+
+    void test_many_tasks (
+    )
+    {
+        // Submitting never blocks, so we can queue up far more tasks than threads, and
+        // tasks can submit and wait on more tasks themselves.
+        thread_pool tp(3);
+        std::atomic<long> count(0);
+        std::vector<uint64> ids;
+        for (int i = 0; i < 10000; ++i)
+        {
+            ids.push_back(tp.add_task_by_value([&]() {
+                ++count;
+                if (count%100 == 0)
+                {
+                    const uint64 id = tp.add_task_by_value([&](){ ++count; });
+                    tp.wait_for_task(id);
+                }
+            }));
+        }
+        for (auto id : ids)
+            tp.wait_for_task(id);
+        DLIB_TEST(count >= 10000);
+        tp.wait_for_all_tasks();
+
+        count = 0;
+        for (int i = 0; i < 10000; ++i)
+            tp.add_task_by_value([&](){ ++count; });
+        tp.wait_for_all_tasks();
+        DLIB_TEST(count == 10000);
+    }
+
     class thread_pool_tester : public tester
     {
     public:
@@ -403,6 +487,9 @@ namespace
                 DLIB_TEST(got_exception);
 
             }
+
+            test_nested_parallel_for();
+            test_many_tasks();
         }
 
         long val;
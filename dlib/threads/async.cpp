@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include "../string.h"
 #include <thread>
+#include <mutex>
 
 namespace dlib
 {
@@ -28,15 +29,58 @@ namespace dlib
             } catch(string_cast_error&) {}
             return std::thread::hardware_concurrency();
         }
+
+        struct default_pool_config
+        {
+            std::mutex m;
+            bool size_was_set = false;
+            bool pool_was_created = false;
+            unsigned long num_threads = 0;
+        };
+
+        default_pool_config& get_default_pool_config()
+        {
+            static default_pool_config config;
+            return config;
+        }
+
+        unsigned long default_pool_size_at_creation()
+        {
+            default_pool_config& config = get_default_pool_config();
+            std::lock_guard<std::mutex> lock(config.m);
+            if (!config.size_was_set)
+                config.num_threads = default_num_threads();
+            config.pool_was_created = true;
+            return config.num_threads;
+        }
     }
 
 // ----------------------------------------------------------------------------------------
 
     thread_pool& default_thread_pool()
     {
-        static thread_pool tp(impl::default_num_threads());
+        static thread_pool tp(impl::default_pool_size_at_creation());
         return tp;
     }
+
+// ----------------------------------------------------------------------------------------
+
+    void set_default_thread_pool_size (
+        unsigned long num_threads
+    )
+    {
+        impl::default_pool_config& config = impl::get_default_pool_config();
+        std::lock_guard<std::mutex> lock(config.m);
+        if (config.pool_was_created)
+        {
+            if (config.num_threads == num_threads)
+                return;
+            throw dlib::error("set_default_thread_pool_size() was called after the default_thread_pool() "
+                "was created with " + cast_to_string(config.num_threads) + " threads.");
+        }
+        config.num_threads = num_threads;
+        config.size_was_set = true;
+    }
 }
 
 // ----------------------------------------------------------------------------------------
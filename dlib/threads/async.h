@@ -36,6 +36,10 @@ namespace dlib
 
     thread_pool& default_thread_pool();
 
+    void set_default_thread_pool_size (
+        unsigned long num_threads
+    );
+
 // ----------------------------------------------------------------------------------------
 
     template < 
@@ -16,10 +16,35 @@ namespace dlib
     );
     /*!
         ensures
-            - returns a reference to a global thread_pool.  If the DLIB_NUM_THREADS
-              environment variable is set to an integer then the thread pool will contain
-              DLIB_NUM_THREADS threads, otherwise it will contain
-              std::thread::hardware_concurrency() threads.
+            - returns a reference to a global thread_pool.  It is created the first time
+              this function is called and its size is fixed from then on:
+                - if (set_default_thread_pool_size(N) was called before that) then
+                    - the thread pool contains N threads.
+                - else if (the DLIB_NUM_THREADS environment variable is set to an integer) then
+                    - the thread pool contains DLIB_NUM_THREADS threads.
+                - else
+                    - the thread pool contains std::thread::hardware_concurrency() threads.
+            - dlib's parallel algorithms run on this pool by default, including the
+              parallel_for() overloads that take a number of threads.  So a program that
+              uses several of them at once, or nests them, still has only this many
+              compute threads.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    void set_default_thread_pool_size (
+        unsigned long num_threads
+    );
+    /*!
+        ensures
+            - Sets the number of threads default_thread_pool() will contain.  This takes
+              precedence over the DLIB_NUM_THREADS environment variable.  Since the pool
+              can't be resized once it exists, call this early, e.g. at the start of
+              main().
+        throws
+            - dlib::error
+                This exception is thrown if default_thread_pool() has already been
+                created with a number of threads other than num_threads.
     !*/
 
 // ----------------------------------------------------------------------------------------
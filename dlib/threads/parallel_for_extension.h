@@ -7,6 +7,9 @@
 #include "thread_pool_extension.h"
 #include "../console_progress_indicator.h"
 #include "async.h"
+#include <algorithm>
+#include <exception>
+#include <vector>
 
 namespace dlib
 {
@@ -69,6 +72,143 @@ namespace dlib
                 funct(begin, end);
             }
         };
+
+        template <typename T>
+        void parallel_for_split (
+            thread_pool& tp,
+            T& obj,
+            void (T::*funct)(long, long),
+            long begin,
+            long end,
+            long block_size
+        )
+        {
+            // Repeatedly hand the back half of the range, split on a block boundary, to
+            // the pool and keep the front half.  The halves land on this worker's own
+            // queue, so idle workers steal the biggest pieces first and split them
+            // further themselves, while this thread works through its part in order.
+            std::vector<uint64> ids;
+            std::exception_ptr eptr;
+            try
+            {
+                while (end-begin > block_size)
+                {
+                    const long num_blocks = (end-begin+block_size-1)/block_size;
+                    const long mid = begin + (num_blocks/2)*block_size;
+                    ids.push_back(tp.add_task_by_value([&tp,&obj,funct,mid,end,block_size]() {
+                        parallel_for_split(tp, obj, funct, mid, end, block_size);
+                    }));
+                    end = mid;
+                }
+                (obj.*funct)(begin, end);
+            }
+            catch (...)
+            {
+                eptr = std::current_exception();
+            }
+
+            // Wait for everything we handed out, even if something threw, since the
+            // tasks reference obj.
+            for (auto id : ids)
+            {
+                try
+                {
+                    tp.wait_for_task(id);
+                }
+                catch (...)
+                {
+                    if (!eptr)
+                        eptr = std::current_exception();
+                }
+            }
+
+            if (eptr)
+                std::rethrow_exception(eptr);
+        }
+
+        template <typename T>
+        void parallel_for_blocks (
+            thread_pool& tp,
+            long begin,
+            long end,
+            T& obj,
+            void (T::*funct)(long, long),
+            long block_size
+        )
+        {
+            if (end-begin <= block_size)
+            {
+                (obj.*funct)(begin, end);
+            }
+            else if (tp.is_task_thread())
+            {
+                parallel_for_split(tp, obj, funct, begin, end, block_size);
+            }
+            else
+            {
+                // Threads outside the pool don't run tasks, so hand the whole loop to a
+                // worker and let it do the splitting.
+                const uint64 id = tp.add_task_by_value([&tp,&obj,funct,begin,end,block_size]() {
+                    parallel_for_split(tp, obj, funct, begin, end, block_size);
+                });
+                tp.wait_for_task(id);
+            }
+        }
+
+        template <typename T>
+        class helper_parallel_for_lane
+        {
+        public:
+            helper_parallel_for_lane (
+                T& obj_,
+                void (T::*funct_)(long, long),
+                long block_size_
+            ) :
+                obj(obj_),
+                funct(funct_),
+                block_size(block_size_)
+            {}
+
+            T& obj;
+            void (T::*funct)(long, long);
+            const long block_size;
+
+            void run (long begin, long end)
+            {
+                for (long i = begin; i < end; i += block_size)
+                    (obj.*funct)(i, std::min(i+block_size, end));
+            }
+        };
+
+        template <typename T>
+        void parallel_for_blocked_limited (
+            unsigned long num_threads,
+            long begin,
+            long end,
+            T& obj,
+            void (T::*funct)(long, long),
+            long chunks_per_thread
+        )
+        {
+            // Rather than making a new thread pool, which would oversubscribe the machine
+            // whenever these calls are nested or several run at once, we run on the
+            // default_thread_pool().  To use no more than num_threads of its threads the
+            // range is cut into that many lanes.  Each lane is one task that processes
+            // its blocks in order.
+            thread_pool& tp = default_thread_pool();
+            const long num = end-begin;
+            const long num_lanes = static_cast<long>(std::min<unsigned long>(num_threads, tp.num_threads_in_pool()));
+            if (num_lanes <= 1 || num <= 1)
+            {
+                (obj.*funct)(begin, end);
+                return;
+            }
+
+            const long block_size = std::max(1L, num/(num_lanes*chunks_per_thread));
+            const long blocks_per_lane = (num/block_size + num_lanes-1)/num_lanes;
+            helper_parallel_for_lane<T> helper(obj, funct, block_size);
+            parallel_for_blocks(tp, begin, end, helper, &helper_parallel_for_lane<T>::run, blocks_per_lane*block_size);
+        }
     }
 
 // ----------------------------------------------------------------------------------------
@@ -99,11 +239,7 @@ namespace dlib
             const long num_workers = static_cast<long>(tp.num_threads_in_pool());
             // How many samples to process in a single task (aim for chunks_per_thread jobs per worker)
             const long block_size = std::max(1L, num/(num_workers*chunks_per_thread));
-            for (long i = 0; i < num; i+=block_size)
-            {
-                tp.add_task(obj, funct, begin+i, begin+std::min(i+block_size, num));
-            }
-            tp.wait_for_all_tasks();
+            impl::parallel_for_blocks(tp, begin, end, obj, funct, block_size);
         }
         else
         {
@@ -135,8 +271,7 @@ namespace dlib
             << "\n\t chunks_per_thread: " << chunks_per_thread
             );
 
-        thread_pool tp(num_threads);
-        parallel_for_blocked(tp, begin, end, obj, funct, chunks_per_thread);
+        impl::parallel_for_blocked_limited(num_threads, begin, end, obj, funct, chunks_per_thread);
     }
 
 // ----------------------------------------------------------------------------------------
@@ -183,8 +318,8 @@ namespace dlib
             << "\n\t chunks_per_thread: " << chunks_per_thread
             );
 
-        thread_pool tp(num_threads);
-        parallel_for_blocked(tp, begin, end, funct, chunks_per_thread);
+        impl::helper_parallel_for_funct2<T> helper(funct);
+        impl::parallel_for_blocked_limited(num_threads, begin, end, helper, &impl::helper_parallel_for_funct2<T>::run, chunks_per_thread);
     }
 
     template <typename T>
@@ -245,8 +380,8 @@ namespace dlib
             << "\n\t chunks_per_thread: " << chunks_per_thread
             );
 
-        thread_pool tp(num_threads);
-        parallel_for(tp, begin, end, obj, funct, chunks_per_thread);
+        impl::helper_parallel_for<T> helper(obj, funct);
+        impl::parallel_for_blocked_limited(num_threads, begin, end, helper, &impl::helper_parallel_for<T>::process_block, chunks_per_thread);
     }
 
 // ----------------------------------------------------------------------------------------
@@ -293,8 +428,8 @@ namespace dlib
             << "\n\t chunks_per_thread: " << chunks_per_thread
             );
 
-        thread_pool tp(num_threads);
-        parallel_for(tp, begin, end, funct, chunks_per_thread);
+        impl::helper_parallel_for_funct<T> helper(funct);
+        parallel_for(num_threads, begin, end,  helper, &impl::helper_parallel_for_funct<T>::run,  chunks_per_thread);
     }
 
 // ----------------------------------------------------------------------------------------
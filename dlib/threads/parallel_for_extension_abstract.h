@@ -41,8 +41,9 @@ namespace dlib
               processing such that (obj.*funct)(begin[i], end[i]) is invoked for all valid
               values of i.  Moreover, the subranges are non-overlapping and completely
               cover the total range of [begin, end).
-            - This function will not perform any memory allocations or create any system
-              resources such as mutex objects.
+            - The range is split recursively, so idle threads in tp pick up the largest
+              remaining pieces.  It is fine to call this function from inside a task
+              running in tp.  The calling thread then works on the loop as well.
     !*/
 
 // ----------------------------------------------------------------------------------------
@@ -61,9 +62,17 @@ namespace dlib
             - begin <= end
             - chunks_per_thread > 0
         ensures
-            - This function is equivalent to the following block of code:
-                thread_pool tp(num_threads);
+            - This function is equivalent to calling
                 parallel_for_blocked(tp, begin, end, obj, funct, chunks_per_thread);
+              with tp == default_thread_pool(), except that no more than num_threads of
+              the pool's threads work on this loop at the same time.  No new threads are
+              created, so this function can be nested or called concurrently without
+              oversubscribing the machine.
+            - if (num_threads > default_thread_pool().num_threads_in_pool()) then
+                - the loop uses all of the pool's threads but no more.  Call
+                  set_default_thread_pool_size() at startup to get a bigger pool.
+            - if (num_threads <= 1) then
+                - the whole range is processed within the calling thread.
     !*/
 
 // ----------------------------------------------------------------------------------------
@@ -96,8 +105,9 @@ namespace dlib
               Then parallel_for_blocked() submits each of these subranges to tp for
               processing such that funct(begin[i], end[i]) is invoked for all valid values
               of i.
-            - This function will not perform any memory allocations or create any system
-              resources such as mutex objects.
+            - The range is split recursively, so idle threads in tp pick up the largest
+              remaining pieces.  It is fine to call this function from inside a task
+              running in tp.  The calling thread then works on the loop as well.
     !*/
 
 // ----------------------------------------------------------------------------------------
@@ -115,9 +125,17 @@ namespace dlib
             - begin <= end
             - chunks_per_thread > 0
         ensures
-            - This function is equivalent to the following block of code:
-                thread_pool tp(num_threads);
+            - This function is equivalent to calling
                 parallel_for_blocked(tp, begin, end, funct, chunks_per_thread);
+              with tp == default_thread_pool(), except that no more than num_threads of
+              the pool's threads work on this loop at the same time.  No new threads are
+              created, so this function can be nested or called concurrently without
+              oversubscribing the machine.
+            - if (num_threads > default_thread_pool().num_threads_in_pool()) then
+                - the loop uses all of the pool's threads but no more.  Call
+                  set_default_thread_pool_size() at startup to get a bigger pool.
+            - if (num_threads <= 1) then
+                - the whole range is processed within the calling thread.
     !*/
 
 // ----------------------------------------------------------------------------------------
@@ -164,8 +182,9 @@ namespace dlib
             - Therefore, this routine invokes (obj.*funct)(i) for all i in the range
               [begin, end).  However, it does so using tp.num_threads_in_pool() parallel
               threads.
-            - This function will not perform any memory allocations or create any system
-              resources such as mutex objects.
+            - The range is split recursively, so idle threads in tp pick up the largest
+              remaining pieces.  It is fine to call this function from inside a task
+              running in tp.  The calling thread then works on the loop as well.
     !*/
 
 // ----------------------------------------------------------------------------------------
@@ -184,9 +203,17 @@ namespace dlib
             - begin <= end
             - chunks_per_thread > 0
         ensures
-            - This function is equivalent to the following block of code:
-                thread_pool tp(num_threads);
+            - This function is equivalent to calling
                 parallel_for(tp, begin, end, obj, funct, chunks_per_thread);
+              with tp == default_thread_pool(), except that no more than num_threads of
+              the pool's threads work on this loop at the same time.  No new threads are
+              created, so this function can be nested or called concurrently without
+              oversubscribing the machine.
+            - if (num_threads > default_thread_pool().num_threads_in_pool()) then
+                - the loop uses all of the pool's threads but no more.  Call
+                  set_default_thread_pool_size() at startup to get a bigger pool.
+            - if (num_threads <= 1) then
+                - the whole range is processed within the calling thread.
     !*/
 
 // ----------------------------------------------------------------------------------------
@@ -212,8 +239,9 @@ namespace dlib
                 }, chunks_per_thread);
             - Therefore, this routine invokes funct(i) for all i in the range [begin, end).
               However, it does so using tp.num_threads_in_pool() parallel threads.
-            - This function will not perform any memory allocations or create any system
-              resources such as mutex objects.
+            - The range is split recursively, so idle threads in tp pick up the largest
+              remaining pieces.  It is fine to call this function from inside a task
+              running in tp.  The calling thread then works on the loop as well.
     !*/
 
 // ----------------------------------------------------------------------------------------
@@ -231,9 +259,17 @@ namespace dlib
             - begin <= end
             - chunks_per_thread > 0
         ensures
-            - This function is equivalent to the following block of code:
-                thread_pool tp(num_threads);
+            - This function is equivalent to calling
                 parallel_for(tp, begin, end, funct, chunks_per_thread);
+              with tp == default_thread_pool(), except that no more than num_threads of
+              the pool's threads work on this loop at the same time.  No new threads are
+              created, so this function can be nested or called concurrently without
+              oversubscribing the machine.
+            - if (num_threads > default_thread_pool().num_threads_in_pool()) then
+                - the loop uses all of the pool's threads but no more.  Call
+                  set_default_thread_pool_size() at startup to get a bigger pool.
+            - if (num_threads <= 1) then
+                - the whole range is processed within the calling thread.
     !*/
 
 // ----------------------------------------------------------------------------------------
@@ -1,63 +1,105 @@
 // Copyright (C) 2008  Davis E. King (davis@dlib.net)
 // License: Boost Software License   See LICENSE.txt for the full license.
 #ifndef DLIB_THREAD_POOl_CPPh_
-#define DLIB_THREAD_POOl_CPPh_ 
+#define DLIB_THREAD_POOl_CPPh_
 
 #include "thread_pool_extension.h"
+#include <iterator>
 #include <memory>
 
 namespace dlib
 {
 
+// ----------------------------------------------------------------------------------------
+
+    namespace
+    {
+        // The thread pool the calling thread is a worker of, if any, the index of its
+        // task queue in that pool, and the id of the task it is running, or 0.
+        thread_local const thread_pool_implementation* this_threads_pool = nullptr;
+        thread_local unsigned long this_threads_queue = 0;
+        thread_local uint64 this_threads_task = 0;
+    }
+
 // ----------------------------------------------------------------------------------------
 
     thread_pool_implementation::
     thread_pool_implementation (
         unsigned long num_threads
-    ) : 
-        task_done_signaler(m),
-        task_ready_signaler(m),
-        we_are_destructing(false)
+    ) :
+        next_task_id(2),
+        num_queued(0),
+        num_unfinished(0),
+        num_sleeping(0),
+        num_waiting(0),
+        we_are_destructing(false),
+        has_exception(false)
     {
-        tasks.resize(num_threads);
-        threads.resize(num_threads);
+        queues.reserve(num_threads);
+        for (unsigned long i = 0; i < num_threads; ++i)
+            queues.emplace_back(new task_queue);
+
+        threads.reserve(num_threads);
         for (unsigned long i = 0; i < num_threads; ++i)
         {
-            threads[i] = std::thread([&](){this->thread();});
+            threads.emplace_back([this,i](){this->thread(i);});
         }
     }
 
 // ----------------------------------------------------------------------------------------
 
+    template <typename pred_type, typename help_pred_type>
     void thread_pool_implementation::
-    shutdown_pool (
+    wait_until (
+        const pred_type& done,
+        const help_pred_type& can_help
     )
     {
+        const bool is_worker = this_threads_pool == this;
+        while (!done())
         {
-            auto_mutex M(m);
-            
-            // first wait for all pending tasks to finish
-            bool found_task = true;
-            while (found_task)
+            // A worker that waits on other tasks, e.g. because it is running a
+            // parallel_for() inside a task, runs the queued tasks it is waiting on
+            // itself.  Otherwise nested waits could tie up every worker.  It doesn't
+            // touch anything else, since an unrelated task might need a lock the
+            // waiting task holds, and the helping would nest without bound.
+            if (is_worker)
             {
-                found_task = false;
-                for (unsigned long i = 0; i < tasks.size(); ++i)
+                std::unique_ptr<task_type> task = find_task_to_help(can_help);
+                if (task)
                 {
-                    // If task bucket i has a task that is currently supposed to be processed
-                    if (tasks[i].is_empty() == false)
-                    {
-                        found_task = true;
-                        break;
-                    }
+                    run_task(std::move(task));
+                    continue;
                 }
+            }
 
-                if (found_task)
-                    task_done_signaler.wait();
+            // Only this worker adds to its own queue, so nothing more it could help
+            // with shows up while it sleeps.
+            ++num_waiting;
+            {
+                std::unique_lock<std::mutex> lock(done_mutex);
+                while (!done())
+                    task_done_cv.wait(lock);
             }
+            --num_waiting;
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void thread_pool_implementation::
+    shutdown_pool (
+    )
+    {
+        // first wait for all pending tasks to finish
+        wait_until([this](){ return num_unfinished == 0; },
+                   [](const task_type&){ return true; });
 
-            // now tell the threads to kill themselves
+        // now tell the threads to kill themselves
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
             we_are_destructing = true;
-            task_ready_signaler.broadcast();
+            task_ready_cv.notify_all();
         }
 
         // wait for all threads to terminate
@@ -67,8 +109,7 @@ namespace dlib
 
         // Throw any unhandled exceptions.  Since shutdown_pool() is only called in the
         // destructor this will kill the program.
-        for (auto&& task : tasks)
-            task.propagate_exception();
+        propagate_exception();
     }
 
 // ----------------------------------------------------------------------------------------
@@ -85,8 +126,7 @@ namespace dlib
     num_threads_in_pool (
     ) const
     {
-        auto_mutex M(m);
-        return tasks.size();
+        return queues.size();
     }
 
 // ----------------------------------------------------------------------------------------
@@ -94,248 +134,309 @@ namespace dlib
     void thread_pool_implementation::
     wait_for_task (
         uint64 task_id
-    ) const
+    )
     {
-        auto_mutex M(m);
-        if (tasks.size() != 0)
+        if (queues.size() != 0)
         {
-            const unsigned long idx = task_id_to_index(task_id);
-            while (tasks[idx].task_id == task_id)
-                task_done_signaler.wait();
-
-            for (auto&& task : tasks)
-                task.propagate_exception();
+            // Help with the task itself or with the other tasks the calling task
+            // submitted, e.g. the rest of the parallel_for() it is waiting on.
+            const uint64 parent_id = this_threads_task;
+            pending_shard& shard = shards[task_id%num_shards];
+            wait_until([&]() {
+                std::lock_guard<std::mutex> lock(shard.m);
+                return shard.task_ids.count(task_id) == 0;
+            },
+            [&](const task_type& t) {
+                return t.task_id == task_id || (parent_id != 0 && t.parent_id == parent_id);
+            });
         }
+
+        propagate_exception();
     }
 
 // ----------------------------------------------------------------------------------------
 
     void thread_pool_implementation::
     wait_for_all_tasks (
-    ) const
+    )
     {
-        const thread_id_type thread_id = get_thread_id();
-
-        auto_mutex M(m);
-        bool found_task = true;
-        while (found_task)
-        {
-            found_task = false;
-            for (unsigned long i = 0; i < tasks.size(); ++i)
-            {
-                // If task bucket i has a task that is currently supposed to be processed
-                // and it originated from the calling thread
-                if (tasks[i].is_empty() == false && tasks[i].thread_id == thread_id)
-                {
-                    found_task = true;
-                    break;
-                }
-            }
-
-            if (found_task)
-                task_done_signaler.wait();
-        }
+        const std::thread::id thread_id = std::this_thread::get_id();
+        pending_shard& shard = shards[std::hash<std::thread::id>()(thread_id)%num_shards];
+        wait_until([&]() {
+            std::lock_guard<std::mutex> lock(shard.m);
+            return shard.tasks_from_thread.count(thread_id) == 0;
+        },
+        [&](const task_type& t) { return t.thread_id == thread_id; });
 
         // throw any exceptions generated by the tasks
-        for (auto&& task : tasks)
-            task.propagate_exception();
+        propagate_exception();
     }
 
 // ----------------------------------------------------------------------------------------
 
     bool thread_pool_implementation::
-    is_worker_thread (
-        const thread_id_type id
+    is_task_thread (
     ) const
     {
-        for (unsigned long i = 0; i < worker_thread_ids.size(); ++i)
-        {
-            if (worker_thread_ids[i] == id)
-                return true;
-        }
-
         // if there aren't any threads in the pool then we consider all threads
         // to be worker threads
-        if (tasks.size() == 0)
-            return true;
-        else
-            return false;
+        return queues.size() == 0 || this_threads_pool == this;
     }
 
 // ----------------------------------------------------------------------------------------
 
     void thread_pool_implementation::
-    thread (
+    propagate_exception (
     )
     {
-        {
-            // save the id of this worker thread into worker_thread_ids
-            auto_mutex M(m);
-            thread_id_type id = get_thread_id();
-            worker_thread_ids.push_back(id);
-        }
+        if (!has_exception)
+            return;
 
-        task_state_type task;
-        while (we_are_destructing == false)
+        std::exception_ptr eptr;
         {
-            long idx = 0;
+            std::lock_guard<std::mutex> lock(exception_mutex);
+            if (exceptions.size() != 0)
+            {
+                eptr = exceptions.back();
+                exceptions.pop_back();
+            }
+            has_exception = exceptions.size() != 0;
+        }
 
-            // wait for a task to do 
-            { auto_mutex M(m);
-                while ( (idx = find_ready_task()) == -1 && we_are_destructing == false)
-                    task_ready_signaler.wait();
+        if (eptr)
+            std::rethrow_exception(eptr);
+    }
 
-                if (we_are_destructing)
-                    break;
+// ----------------------------------------------------------------------------------------
 
-                tasks[idx].is_being_processed = true;
-                task = tasks[idx];
-            }
+    void thread_pool_implementation::
+    thread (
+        unsigned long idx
+    )
+    {
+        this_threads_pool = this;
+        this_threads_queue = idx;
 
-            std::exception_ptr eptr = nullptr;
-            try
-            {
-                // now do the task
-                if (task.bfp)
-                    task.bfp();
-                else if (task.mfp0)
-                    task.mfp0();
-                else if (task.mfp1)
-                    task.mfp1(task.arg1);
-                else if (task.mfp2)
-                    task.mfp2(task.arg1, task.arg2);
-            }
-            catch(...)
+        while (true)
+        {
+            std::unique_ptr<task_type> task = find_task(idx);
+            if (task)
             {
-                eptr = std::current_exception();
+                run_task(std::move(task));
+                continue;
             }
 
-            // Now let others know that we finished the task.  We do this
-            // by clearing out the state of this task
-            { auto_mutex M(m);
-                tasks[idx].is_being_processed = false;
-                tasks[idx].task_id = 0;
-                tasks[idx].bfp.clear();
-                tasks[idx].mfp0.clear();
-                tasks[idx].mfp1.clear();
-                tasks[idx].mfp2.clear();
-                tasks[idx].arg1 = 0;
-                tasks[idx].arg2 = 0;
-                tasks[idx].eptr = eptr;
-                task_done_signaler.broadcast();
-            }
+            // wait for a task to do
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            ++num_sleeping;
+            while (num_queued == 0 && we_are_destructing == false)
+                task_ready_cv.wait(lock);
+            --num_sleeping;
 
+            if (we_are_destructing && num_queued == 0)
+                break;
         }
     }
 
 // ----------------------------------------------------------------------------------------
 
-    long thread_pool_implementation::
-    find_empty_task_slot (
-    ) const
+    std::unique_ptr<thread_pool_implementation::task_type> thread_pool_implementation::
+    find_task (
+        unsigned long idx
+    )
     {
-        for (auto&& task : tasks)
-            task.propagate_exception();
+        std::unique_ptr<task_type> task;
+        if (num_queued == 0)
+            return task;
 
-        for (unsigned long i = 0; i < tasks.size(); ++i)
         {
-            if (tasks[i].is_empty())
-                return i;
+            task_queue& q = *queues[idx];
+            std::lock_guard<std::mutex> lock(q.m);
+            if (q.tasks.size() != 0)
+            {
+                task = std::move(q.tasks.back());
+                q.tasks.pop_back();
+                --num_queued;
+                return task;
+            }
         }
 
-        return -1;
-    }
-
-// ----------------------------------------------------------------------------------------
+        {
+            std::lock_guard<std::mutex> lock(injected.m);
+            if (injected.tasks.size() != 0)
+            {
+                task = std::move(injected.tasks.front());
+                injected.tasks.pop_front();
+                --num_queued;
+                return task;
+            }
+        }
 
-    long thread_pool_implementation::
-    find_ready_task (
-    ) const
-    {
-        for (unsigned long i = 0; i < tasks.size(); ++i)
+        for (unsigned long i = 1; i < queues.size(); ++i)
         {
-            if (tasks[i].is_ready())
-                return i;
+            task_queue& q = *queues[(idx+i)%queues.size()];
+            std::lock_guard<std::mutex> lock(q.m);
+            if (q.tasks.size() != 0)
+            {
+                task = std::move(q.tasks.front());
+                q.tasks.pop_front();
+                --num_queued;
+                return task;
+            }
         }
 
-        return -1;
+        return task;
     }
 
 // ----------------------------------------------------------------------------------------
 
-    uint64 thread_pool_implementation::
-    make_next_task_id (
-        long idx
+    template <typename pred_type>
+    std::unique_ptr<thread_pool_implementation::task_type> thread_pool_implementation::
+    find_task_to_help (
+        const pred_type& can_help
     )
     {
-        uint64 id = tasks[idx].next_task_id * tasks.size() + idx;
-        tasks[idx].next_task_id += 1;
-        return id;
+        std::unique_ptr<task_type> task;
+        if (num_queued == 0)
+            return task;
+
+        // The tasks a worker is waiting on are the most recent ones it submitted, so
+        // they are at the back.
+        task_queue& q = *queues[this_threads_queue];
+        std::lock_guard<std::mutex> lock(q.m);
+        for (auto i = q.tasks.rbegin(); i != q.tasks.rend(); ++i)
+        {
+            if (can_help(**i))
+            {
+                task = std::move(*i);
+                q.tasks.erase(std::next(i).base());
+                --num_queued;
+                return task;
+            }
+        }
+        return task;
     }
 
 // ----------------------------------------------------------------------------------------
 
-    unsigned long thread_pool_implementation::
-    task_id_to_index (
-        uint64 id
-    ) const
+    void thread_pool_implementation::
+    run_task (
+        std::unique_ptr<task_type> task
+    )
     {
-        return static_cast<unsigned long>(id%tasks.size());
+        // Tasks can be run by a worker that is waiting on another one, so remember
+        // which task that was.
+        const uint64 outer_task = this_threads_task;
+        this_threads_task = task->task_id;
+        try
+        {
+            // now do the task
+            task->bfp();
+        }
+        catch(...)
+        {
+            std::lock_guard<std::mutex> lock(exception_mutex);
+            exceptions.push_back(std::current_exception());
+            has_exception = true;
+        }
+        this_threads_task = outer_task;
+
+        const uint64 task_id = task->task_id;
+        const std::thread::id thread_id = task->thread_id;
+
+        // Destroy the task, and any copy of a function object it holds, before anyone
+        // can see that it finished.
+        task.reset();
+
+        {
+            pending_shard& shard = shards[task_id%num_shards];
+            std::lock_guard<std::mutex> lock(shard.m);
+            shard.task_ids.erase(task_id);
+        }
+        {
+            pending_shard& shard = shards[std::hash<std::thread::id>()(thread_id)%num_shards];
+            std::lock_guard<std::mutex> lock(shard.m);
+            auto i = shard.tasks_from_thread.find(thread_id);
+            if (--i->second == 0)
+                shard.tasks_from_thread.erase(i);
+        }
+        --num_unfinished;
+
+        // Now let others know that we finished the task.
+        if (num_waiting != 0)
+        {
+            std::lock_guard<std::mutex> lock(done_mutex);
+            task_done_cv.notify_all();
+        }
     }
 
 // ----------------------------------------------------------------------------------------
 
     uint64 thread_pool_implementation::
-    add_task_internal (
-        const bfp_type& bfp,
-        std::shared_ptr<function_object_copy>& item
+    submit (
+        std::unique_ptr<task_type> task
     )
     {
-        auto_mutex M(m);
-        const thread_id_type my_thread_id = get_thread_id();
+        const uint64 task_id = next_task_id++;
+        task->task_id = task_id;
+        task->parent_id = (this_threads_pool == this) ? this_threads_task : 0;
+        task->thread_id = std::this_thread::get_id();
 
-        // find a thread that isn't doing anything
-        long idx = find_empty_task_slot();
-        if (idx == -1 && is_worker_thread(my_thread_id))
         {
-            // this function is being called from within a worker thread and there
-            // aren't any other worker threads free so just perform the task right
-            // here
-
-            M.unlock();
-            bfp();
-
-            // return a task id that is both non-zero and also one
-            // that is never normally returned.  This way calls
-            // to wait_for_task() will never block given this id.
-            return 1;
+            pending_shard& shard = shards[task_id%num_shards];
+            std::lock_guard<std::mutex> lock(shard.m);
+            shard.task_ids.insert(task_id);
         }
-
-        // wait until there is a thread that isn't doing anything
-        while (idx == -1)
         {
-            task_done_signaler.wait();
-            idx = find_empty_task_slot();
+            pending_shard& shard = shards[std::hash<std::thread::id>()(task->thread_id)%num_shards];
+            std::lock_guard<std::mutex> lock(shard.m);
+            ++shard.tasks_from_thread[task->thread_id];
         }
+        ++num_unfinished;
 
-        tasks[idx].thread_id = my_thread_id;
-        tasks[idx].task_id = make_next_task_id(idx);
-        tasks[idx].bfp = bfp;
-        tasks[idx].function_copy.swap(item);
+        // Workers keep the tasks they make in their own queue.  Everyone else shares
+        // the injected queue.
+        {
+            task_queue& q = (this_threads_pool == this) ? *queues[this_threads_queue] : injected;
+            std::lock_guard<std::mutex> lock(q.m);
+            q.tasks.push_back(std::move(task));
+        }
+        ++num_queued;
 
-        task_ready_signaler.signal();
+        // Wake up a worker if any are asleep.
+        if (num_sleeping != 0)
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            task_ready_cv.notify_one();
+        }
 
-        return tasks[idx].task_id;
+        return task_id;
     }
 
 // ----------------------------------------------------------------------------------------
 
-    bool thread_pool_implementation::
-    is_task_thread (
-    ) const
+    uint64 thread_pool_implementation::
+    add_task_internal (
+        const bfp_type& bfp,
+        std::shared_ptr<function_object_copy>& item
+    )
     {
-        auto_mutex M(m);
-        return is_worker_thread(get_thread_id());
+        propagate_exception();
+
+        if (queues.size() == 0)
+        {
+            // There aren't any threads in the pool so just perform the task right here.
+            // Return a task id that is both non-zero and also one that is never
+            // normally returned.  This way calls to wait_for_task() will never block
+            // given this id.
+            bfp();
+            return 1;
+        }
+
+        std::unique_ptr<task_type> task(new task_type);
+        task->bfp = bfp;
+        task->function_copy.swap(item);
+        return submit(std::move(task));
     }
 
 // ----------------------------------------------------------------------------------------
@@ -3,9 +3,17 @@
 #ifndef DLIB_THREAD_POOl_Hh_
 #define DLIB_THREAD_POOl_Hh_ 
 
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <exception>
 #include <memory>
+#include <mutex>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "thread_pool_extension_abstract.h"
 #include "multithreaded_object_extension.h"
@@ -131,17 +139,39 @@ namespace dlib
     {
         /*!
             CONVENTION
-                - num_threads_in_pool() == tasks.size()
-                - if (the destructor has been called) then
+                - num_threads_in_pool() == queues.size()
+                - if (shutdown_pool() has been called) then
                     - we_are_destructing == true
                 - else
                     - we_are_destructing == false
 
-                - is_task_thread() == is_worker_thread(get_thread_id())
-
-                - m == the mutex used to protect everything in this object
-                - worker_thread_ids == an array that contains the thread ids for
-                  all the threads in the thread pool
+                - is_task_thread() == (queues.size() == 0 || the calling thread is one of
+                  this pool's workers)
+
+                - queues[i] == the tasks waiting to be run by the i-th worker thread.
+                  Each queue has its own mutex.  A worker pushes the tasks it submits
+                  onto the back of its own queue and takes work from the back of it as
+                  well.  When its queue is empty it steals from the front of the other
+                  workers' queues, which is where the oldest, and for recursively split
+                  work the biggest, tasks are.
+                - injected == the tasks submitted by threads outside the pool.  Workers
+                  take them from the front, after their own queue is empty but before
+                  stealing, so they are started in the order they were submitted.
+                - num_queued == the total number of tasks sitting in queues and injected.
+                - num_unfinished == the number of submitted tasks that haven't finished.
+                - shards[task_id%num_shards].task_ids contains the ids of all unfinished
+                  tasks and shards[hash(thread id)%num_shards].tasks_from_thread counts the
+                  unfinished tasks each thread has submitted.  They are split into shards
+                  so submitting and finishing tasks doesn't serialize on a single mutex.
+                - num_sleeping == the number of workers blocked on task_ready_cv waiting
+                  for something to do.
+                - num_waiting == the number of threads blocked on task_done_cv inside
+                  one of the wait functions.
+                - For each task, parent_id == the id of the task its submitter was
+                  running at the time, or 0 if it was submitted from outside a task of
+                  this pool.
+                - exceptions == exceptions thrown by tasks that haven't been rethrown yet.
+                  has_exception == (exceptions.size() != 0)
         !*/
         typedef bound_function_pointer::kernel_1a_c bfp_type;
 
@@ -156,13 +186,13 @@ namespace dlib
 
         void wait_for_task (
             uint64 task_id
-        ) const;
+        );
 
         unsigned long num_threads_in_pool (
         ) const;
 
         void wait_for_all_tasks (
-        ) const;
+        );
 
         bool is_task_thread (
         ) const;
@@ -173,40 +203,20 @@ namespace dlib
             void (T::*funct)()
         )
         {
-            auto_mutex M(m);
-            const thread_id_type my_thread_id = get_thread_id();
-
-            // find a thread that isn't doing anything
-            long idx = find_empty_task_slot();
-            if (idx == -1 && is_worker_thread(my_thread_id))
+            propagate_exception();
+            if (queues.size() == 0)
             {
-                // this function is being called from within a worker thread and there
-                // aren't any other worker threads free so just perform the task right
-                // here
-
-                M.unlock();
+                // There aren't any threads in the pool so the calling thread does the
+                // work.  Return a task id that is both non-zero and also one that is
+                // never normally returned.  This way calls to wait_for_task() will never
+                // block given this id.
                 (obj.*funct)();
-
-                // return a task id that is both non-zero and also one
-                // that is never normally returned.  This way calls
-                // to wait_for_task() will never block given this id.
                 return 1;
             }
 
-            // wait until there is a thread that isn't doing anything
-            while (idx == -1)
-            {
-                task_done_signaler.wait();
-                idx = find_empty_task_slot();
-            }
-
-            tasks[idx].thread_id = my_thread_id;
-            tasks[idx].task_id = make_next_task_id(idx);
-            tasks[idx].mfp0.set(obj,funct);
-
-            task_ready_signaler.signal();
-
-            return tasks[idx].task_id;
+            std::unique_ptr<task_type> task(new task_type);
+            task->bfp.set(obj,funct);
+            return submit(std::move(task));
         }
 
         template <typename T>
@@ -216,41 +226,17 @@ namespace dlib
             long arg1
         )
         {
-            auto_mutex M(m);
-            const thread_id_type my_thread_id = get_thread_id();
-
-            // find a thread that isn't doing anything
-            long idx = find_empty_task_slot();
-            if (idx == -1 && is_worker_thread(my_thread_id))
+            propagate_exception();
+            if (queues.size() == 0)
             {
-                // this function is being called from within a worker thread and there
-                // aren't any other worker threads free so just perform the task right
-                // here
-
-                M.unlock();
                 (obj.*funct)(arg1);
-
-                // return a task id that is both non-zero and also one
-                // that is never normally returned.  This way calls
-                // to wait_for_task() will never block given this id.
                 return 1;
             }
 
-            // wait until there is a thread that isn't doing anything
-            while (idx == -1)
-            {
-                task_done_signaler.wait();
-                idx = find_empty_task_slot();
-            }
-
-            tasks[idx].thread_id = my_thread_id;
-            tasks[idx].task_id = make_next_task_id(idx);
-            tasks[idx].mfp1.set(obj,funct);
-            tasks[idx].arg1 = arg1;
-
-            task_ready_signaler.signal();
-
-            return tasks[idx].task_id;
+            std::unique_ptr<task_type> task(new task_type);
+            task->arg1 = arg1;
+            task->bfp.set(obj,funct,task->arg1);
+            return submit(std::move(task));
         }
 
         template <typename T>
@@ -261,42 +247,18 @@ namespace dlib
             long arg2
         )
         {
-            auto_mutex M(m);
-            const thread_id_type my_thread_id = get_thread_id();
-
-            // find a thread that isn't doing anything
-            long idx = find_empty_task_slot();
-            if (idx == -1 && is_worker_thread(my_thread_id))
+            propagate_exception();
+            if (queues.size() == 0)
             {
-                // this function is being called from within a worker thread and there
-                // aren't any other worker threads free so just perform the task right
-                // here
-
-                M.unlock();
                 (obj.*funct)(arg1, arg2);
-
-                // return a task id that is both non-zero and also one
-                // that is never normally returned.  This way calls
-                // to wait_for_task() will never block given this id.
                 return 1;
             }
 
-            // wait until there is a thread that isn't doing anything
-            while (idx == -1)
-            {
-                task_done_signaler.wait();
-                idx = find_empty_task_slot();
-            }
-
-            tasks[idx].thread_id = my_thread_id;
-            tasks[idx].task_id = make_next_task_id(idx);
-            tasks[idx].mfp2.set(obj,funct);
-            tasks[idx].arg1 = arg1;
-            tasks[idx].arg2 = arg2;
-
-            task_ready_signaler.signal();
-
-            return tasks[idx].task_id;
+            std::unique_ptr<task_type> task(new task_type);
+            task->arg1 = arg1;
+            task->arg2 = arg2;
+            task->bfp.set(obj,funct,task->arg1,task->arg2);
+            return submit(std::move(task));
         }
 
         struct function_object_copy 
@@ -343,137 +305,129 @@ namespace dlib
 
     private:
 
-        bool is_worker_thread (
-            const thread_id_type id
-        ) const;
+        struct task_type
+        {
+            uint64 task_id = 0;
+            uint64 parent_id = 0;
+            std::thread::id thread_id; // the thread that submitted this task
+
+            long arg1 = 0;
+            long arg2 = 0;
+            bfp_type bfp;
+
+            std::shared_ptr<function_object_copy> function_copy;
+        };
+
+        struct task_queue
+        {
+            std::mutex m;
+            std::deque<std::unique_ptr<task_type>> tasks;
+        };
+
+        struct pending_shard
+        {
+            std::mutex m;
+            std::unordered_set<uint64> task_ids;
+            std::unordered_map<std::thread::id, unsigned long> tasks_from_thread;
+        };
+
+        uint64 submit (
+            std::unique_ptr<task_type> task
+        );
         /*!
             requires
-                - m is locked
+                - num_threads_in_pool() != 0
             ensures
-                - if (thread with given id is one of the thread pool's worker threads or num_threads_in_pool() == 0) then
-                    - returns true
-                - else
-                    - returns false
+                - assigns task an id, records it as unfinished and puts it in a queue
+                  where a worker will pick it up.
+                - returns the id of the task.
         !*/
 
-        void thread (
+        std::unique_ptr<task_type> find_task (
+            unsigned long idx
         );
         /*!
-            this is the function that executes the threads in the thread pool
+            requires
+                - idx < num_threads_in_pool()
+            ensures
+                - removes and returns a task from the back of queues[idx] or, if that is
+                  empty, from the front of injected or one of the other queues.
+                - returns a null pointer if all the queues are empty.
         !*/
 
-        long find_empty_task_slot (
-        ) const;
+        template <typename pred_type>
+        std::unique_ptr<task_type> find_task_to_help (
+            const pred_type& can_help
+        );
         /*!
             requires
-                - m is locked
+                - the calling thread is one of the workers
             ensures
-                - if (there is currently a empty task slot) then
-                    - returns the index of that task slot in tasks
-                    - there is a task slot
-                - else
-                    - returns -1
+                - removes and returns the task closest to the back of the calling
+                  worker's own queue for which can_help(task) == true.
+                - returns a null pointer if there isn't one.
         !*/
 
-        long find_ready_task (
-        ) const;
+        void run_task (
+            std::unique_ptr<task_type> task
+        );
         /*!
-            requires
-                - m is locked
             ensures
-                - if (there is currently a task to do) then
-                    - returns the index of that task in tasks
-                - else
-                    - returns -1
+                - calls the task, stores any exception it throws, destroys it and then
+                  records that it has finished.
         !*/
 
-        uint64 make_next_task_id (
-            long idx
+        template <typename pred_type, typename help_pred_type>
+        void wait_until (
+            const pred_type& done,
+            const help_pred_type& can_help
         );
         /*!
-            requires
-                - m is locked
-                - 0 <= idx < tasks.size()
             ensures
-                - returns the next index to be used for tasks that are placed in
-                  tasks[idx]
+                - blocks until done() == true.  If the calling thread is one of the
+                  workers it runs the queued tasks for which can_help(task) == true while
+                  it waits.  This is what makes it safe for tasks to submit more tasks
+                  and wait for them.  can_help() should only accept tasks that are part
+                  of what is being waited on, so that a waiting task never runs
+                  unrelated work, e.g. work that needs a lock the waiting task holds.
         !*/
 
-        unsigned long task_id_to_index (
-            uint64 id
-        ) const;
+        void propagate_exception (
+        );
         /*!
-            requires
-                - m is locked
-                - num_threads_in_pool() != 0
             ensures
-                - returns the index in tasks corresponding to the given id
+                - if (a task threw an exception that hasn't been rethrown yet) then
+                    - rethrows it
         !*/
 
-        struct task_state_type
-        {
-            task_state_type() : is_being_processed(false), task_id(0), next_task_id(2), arg1(0), arg2(0), eptr(nullptr) {}
-
-            bool is_ready () const 
-            /*!
-                ensures
-                    - if (is_empty() == false && no thread is currently processing this task) then
-                        - returns true
-                    - else
-                        - returns false
-            !*/
-            {
-                return !is_being_processed && !is_empty();
-            }
-
-            bool is_empty () const
-            /*!
-                ensures
-                    - if (this task state is empty.  i.e. it doesn't contain a task to be processed) then
-                        - returns true
-                    - else 
-                        - returns false
-            !*/
-            {
-                return task_id == 0;
-            }
-
-            bool is_being_processed;  // true when a thread is working on this task 
-            uint64 task_id; // the id of this task.  0 means this task is empty
-            thread_id_type thread_id; // the id of the thread that requested this task 
-
-            uint64 next_task_id;
-
-            long arg1;
-            long arg2;
-
-            member_function_pointer<> mfp0;
-            member_function_pointer<long> mfp1;
-            member_function_pointer<long,long> mfp2;
-            bfp_type bfp;
+        void thread (
+            unsigned long idx
+        );
+        /*!
+            this is the function that executes the threads in the thread pool
+        !*/
 
-            std::shared_ptr<function_object_copy> function_copy;
-            mutable std::exception_ptr eptr; // non-null if the task threw an exception
+        static const unsigned long num_shards = 64;
 
-            void propagate_exception() const
-            {
-                if (eptr)
-                {
-                    auto tmp = eptr;
-                    eptr = nullptr;
-                    std::rethrow_exception(tmp);
-                }
-            }
+        std::vector<std::unique_ptr<task_queue>> queues;
+        task_queue injected;
+        std::array<pending_shard, num_shards> shards;
 
-        };
+        std::atomic<uint64> next_task_id;
+        std::atomic<long> num_queued;
+        std::atomic<long> num_unfinished;
+        std::atomic<long> num_sleeping;
+        std::atomic<long> num_waiting;
+        std::atomic<bool> we_are_destructing;
 
-        array<task_state_type> tasks;
-        array<thread_id_type> worker_thread_ids;
+        std::mutex sleep_mutex;
+        std::condition_variable task_ready_cv;
+        std::mutex done_mutex;
+        std::condition_variable task_done_cv;
 
-        mutex m;
-        signaler task_done_signaler;
-        signaler task_ready_signaler;
-        bool we_are_destructing;
+        std::mutex exception_mutex;
+        std::vector<std::exception_ptr> exceptions;
+        std::atomic<bool> has_exception;
 
         std::vector<std::thread> threads;
 
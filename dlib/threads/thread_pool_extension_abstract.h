@@ -218,11 +218,16 @@ namespace dlib
                 mode any thread that calls add_task() is considered to be
                 a thread_pool thread capable of executing tasks.
 
-                This object is also implemented such that no memory allocations occur 
-                after the thread_pool has been constructed so long as the user doesn't 
-                call any of the add_task_by_value() routines.  The future object also 
-                doesn't perform any memory allocations or contain any system resources 
-                such as mutex objects. 
+                Submitting a task never blocks.  Tasks are queued without any bound and
+                each thread in the pool keeps its own queue.  A thread that runs out of
+                work takes tasks from the queues of the other threads.  Moreover, when a
+                pool thread calls one of the wait functions it runs the queued tasks it is
+                waiting on while it waits, but never unrelated ones.  So it is fine for
+                tasks to submit more tasks and wait on them, e.g. by calling
+                parallel_for() from inside a task, even while holding a lock that other
+                tasks also take.  The future
+                object doesn't perform any memory allocations or contain any system
+                resources such as mutex objects. 
 
             EXCEPTIONS
                 Note that if an exception is thrown inside a task thread and is not caught
@@ -285,12 +290,11 @@ namespace dlib
                 - function_object() is a valid expression 
             ensures
                 - makes a copy of function_object, call it FCOPY.
-                - if (is_task_thread() == true and there aren't any free threads available) then
-                    - calls FCOPY() within the calling thread and returns when it finishes
+                - if (num_threads_in_pool() == 0) then
+                    - calls FCOPY() within the calling thread and returns when it finishes.
                 - else
-                    - the call to this function blocks until there is a free thread in the pool
-                      to process this new task.  Once a free thread is available the task
-                      is handed off to that thread which then calls FCOPY().
+                    - adds the task to the pool's queue and returns immediately.  A thread
+                      in the pool will later call FCOPY().
                 - returns a task id that can be used by this->wait_for_task() to wait
                   for the submitted task to finish.
         !*/
@@ -307,13 +311,11 @@ namespace dlib
                   this function passes obj to the task by reference.  If you want to avoid
                   this restriction then use add_task_by_value())
             ensures
-                - if (is_task_thread() == true and there aren't any free threads available) then
-                    - calls (obj.*funct)() within the calling thread and returns
-                      when it finishes.
+                - if (num_threads_in_pool() == 0) then
+                    - calls (obj.*funct)() within the calling thread and returns when it finishes.
                 - else
-                    - the call to this function blocks until there is a free thread in the pool
-                      to process this new task.  Once a free thread is available the task
-                      is handed off to that thread which then calls (obj.*funct)()
+                    - adds the task to the pool's queue and returns immediately.  A thread
+                      in the pool will later call (obj.*funct)().
                 - returns a task id that can be used by this->wait_for_task() to wait
                   for the submitted task to finish.
         !*/
@@ -328,13 +330,11 @@ namespace dlib
                 - funct == a valid member function pointer for class T
             ensures
                 - makes a copy of obj, call it OBJ_COPY.
-                - if (is_task_thread() == true and there aren't any free threads available) then
-                    - calls (OBJ_COPY.*funct)() within the calling thread and returns 
-                      when it finishes.
+                - if (num_threads_in_pool() == 0) then
+                    - calls (OBJ_COPY.*funct)() within the calling thread and returns when it finishes.
                 - else
-                    - the call to this function blocks until there is a free thread in the pool
-                      to process this new task.  Once a free thread is available the task
-                      is handed off to that thread which then calls (OBJ_COPY.*funct)().
+                    - adds the task to the pool's queue and returns immediately.  A thread
+                      in the pool will later call (OBJ_COPY.*funct)().
                 - returns a task id that can be used by this->wait_for_task() to wait
                   for the submitted task to finish.
         !*/
@@ -352,13 +352,11 @@ namespace dlib
                   this function passes obj to the task by reference.  If you want to avoid
                   this restriction then use add_task_by_value())
             ensures
-                - if (is_task_thread() == true and there aren't any free threads available) then
-                    - calls (obj.*funct)(arg1) within the calling thread and returns
-                      when it finishes
+                - if (num_threads_in_pool() == 0) then
+                    - calls (obj.*funct)(arg1) within the calling thread and returns when it finishes.
                 - else
-                    - the call to this function blocks until there is a free thread in the pool
-                      to process this new task.  Once a free thread is available the task
-                      is handed off to that thread which then calls (obj.*funct)(arg1)
+                    - adds the task to the pool's queue and returns immediately.  A thread
+                      in the pool will later call (obj.*funct)(arg1).
                 - returns a task id that can be used by this->wait_for_task() to wait
                   for the submitted task to finish.
         !*/
@@ -377,13 +375,11 @@ namespace dlib
                   this function passes obj to the task by reference.  If you want to avoid
                   this restriction then use add_task_by_value())
             ensures
-                - if (is_task_thread() == true and there aren't any free threads available) then
-                    - calls (obj.*funct)(arg1,arg2) within the calling thread and returns
-                      when it finishes
+                - if (num_threads_in_pool() == 0) then
+                    - calls (obj.*funct)(arg1,arg2) within the calling thread and returns when it finishes.
                 - else
-                    - the call to this function blocks until there is a free thread in the pool
-                      to process this new task.  Once a free thread is available the task
-                      is handed off to that thread which then calls (obj.*funct)(arg1,arg2)
+                    - adds the task to the pool's queue and returns immediately.  A thread
+                      in the pool will later call (obj.*funct)(arg1,arg2).
                 - returns a task id that can be used by this->wait_for_task() to wait
                   for the submitted task to finish.
         !*/
@@ -397,6 +393,11 @@ namespace dlib
                     - the call to this function blocks until the task with the given id is complete
                 - else
                     - the call to this function returns immediately
+                - if (is_task_thread() == true) then
+                    - while waiting, the calling thread runs the task with the given id,
+                      if it hasn't started yet, and any not yet started tasks submitted
+                      by the task the calling thread is running.  It doesn't run other
+                      tasks.
         !*/
 
         void wait_for_all_tasks (
@@ -406,6 +407,9 @@ namespace dlib
                 - the call to this function blocks until all tasks which were submitted
                   to the thread pool by the thread that is calling this function have 
                   finished.
+                - if (is_task_thread() == true) then
+                    - while waiting, the calling thread runs the tasks it submitted that
+                      haven't started yet.  It doesn't run other tasks.
         !*/
 
         // --------------------
@@ -423,13 +427,11 @@ namespace dlib
                   this function passes function_object to the task by reference.  If you want to avoid
                   this restriction then use add_task_by_value())
             ensures
-                - if (is_task_thread() == true and there aren't any free threads available) then
-                    - calls function_object(arg1.get()) within the calling thread and returns
-                      when it finishes
+                - if (num_threads_in_pool() == 0) then
+                    - calls function_object(arg1.get()) within the calling thread and returns when it finishes.
                 - else
-                    - the call to this function blocks until there is a free thread in the pool
-                      to process this new task.  Once a free thread is available the task
-                      is handed off to that thread which then calls function_object(arg1.get()).
+                    - adds the task to the pool's queue and returns immediately.  A thread
+                      in the pool will later call function_object(arg1.get()).
                 - #arg1.is_ready() == false 
                 - returns a task id that can be used by this->wait_for_task() to wait
                   for the submitted task to finish.
@@ -446,12 +448,11 @@ namespace dlib
                   (i.e. The A1 type stored in the future must be a type that can be passed into the given function object)
             ensures
                 - makes a copy of function_object, call it FCOPY.
-                - if (is_task_thread() == true and there aren't any free threads available) then
-                    - calls FCOPY(arg1.get()) within the calling thread and returns when it finishes
+                - if (num_threads_in_pool() == 0) then
+                    - calls FCOPY(arg1.get()) within the calling thread and returns when it finishes.
                 - else
-                    - the call to this function blocks until there is a free thread in the pool
-                      to process this new task.  Once a free thread is available the task
-                      is handed off to that thread which then calls FCOPY(arg1.get()).
+                    - adds the task to the pool's queue and returns immediately.  A thread
+                      in the pool will later call FCOPY(arg1.get()).
                 - #arg1.is_ready() == false 
                 - returns a task id that can be used by this->wait_for_task() to wait
                   for the submitted task to finish.
@@ -472,13 +473,11 @@ namespace dlib
                   this function passes obj to the task by reference.  If you want to avoid
                   this restriction then use add_task_by_value())
             ensures
-                - if (is_task_thread() == true and there aren't any free threads available) then
-                    - calls (obj.*funct)(arg1.get()) within the calling thread and returns
-                      when it finishes
+                - if (num_threads_in_pool() == 0) then
+                    - calls (obj.*funct)(arg1.get()) within the calling thread and returns when it finishes.
                 - else
-                    - the call to this function blocks until there is a free thread in the pool
-                      to process this new task.  Once a free thread is available the task
-                      is handed off to that thread which then calls (obj.*funct)(arg1.get()).
+                    - adds the task to the pool's queue and returns immediately.  A thread
+                      in the pool will later call (obj.*funct)(arg1.get()).
                 - #arg1.is_ready() == false 
                 - returns a task id that can be used by this->wait_for_task() to wait
                   for the submitted task to finish.
@@ -497,13 +496,11 @@ namespace dlib
                   (i.e. The A1 type stored in the future must be a type that can be passed into the given function)
             ensures
                 - makes a copy of obj, call it OBJ_COPY.
-                - if (is_task_thread() == true and there aren't any free threads available) then
-                    - calls (OBJ_COPY.*funct)(arg1.get()) within the calling thread and returns 
-                      when it finishes.
+                - if (num_threads_in_pool() == 0) then
+                    - calls (OBJ_COPY.*funct)(arg1.get()) within the calling thread and returns when it finishes.
                 - else
-                    - the call to this function blocks until there is a free thread in the pool
-                      to process this new task.  Once a free thread is available the task
-                      is handed off to that thread which then calls (OBJ_COPY.*funct)(arg1.get()).
+                    - adds the task to the pool's queue and returns immediately.  A thread
+                      in the pool will later call (OBJ_COPY.*funct)(arg1.get()).
                 - returns a task id that can be used by this->wait_for_task() to wait
                   for the submitted task to finish.
         !*/
@@ -523,13 +520,11 @@ namespace dlib
                   this function passes obj to the task by reference.  If you want to avoid
                   this restriction then use add_task_by_value())
             ensures
-                - if (is_task_thread() == true and there aren't any free threads available) then
-                    - calls (obj.*funct)(arg1.get()) within the calling thread and returns
-                      when it finishes
+                - if (num_threads_in_pool() == 0) then
+                    - calls (obj.*funct)(arg1.get()) within the calling thread and returns when it finishes.
                 - else
-                    - the call to this function blocks until there is a free thread in the pool
-                      to process this new task.  Once a free thread is available the task
-                      is handed off to that thread which then calls (obj.*funct)(arg1.get()).
+                    - adds the task to the pool's queue and returns immediately.  A thread
+                      in the pool will later call (obj.*funct)(arg1.get()).
                 - #arg1.is_ready() == false 
                 - returns a task id that can be used by this->wait_for_task() to wait
                   for the submitted task to finish.
@@ -548,13 +543,11 @@ namespace dlib
                   (i.e. The A1 type stored in the future must be a type that can be passed into the given function)
             ensures
                 - makes a copy of obj, call it OBJ_COPY.
-                - if (is_task_thread() == true and there aren't any free threads available) then
-                    - calls (OBJ_COPY.*funct)(arg1.get()) within the calling thread and returns 
-                      when it finishes.
+                - if (num_threads_in_pool() == 0) then
+                    - calls (OBJ_COPY.*funct)(arg1.get()) within the calling thread and returns when it finishes.
                 - else
-                    - the call to this function blocks until there is a free thread in the pool
-                      to process this new task.  Once a free thread is available the task
-                      is handed off to that thread which then calls (OBJ_COPY.*funct)(arg1.get()).
+                    - adds the task to the pool's queue and returns immediately.  A thread
+                      in the pool will later call (OBJ_COPY.*funct)(arg1.get()).
                 - returns a task id that can be used by this->wait_for_task() to wait
                   for the submitted task to finish.
         !*/
@@ -570,13 +563,11 @@ namespace dlib
                 - (funct)(arg1.get()) must be a valid expression.
                   (i.e. The A1 type stored in the future must be a type that can be passed into the given function)
             ensures
-                - if (is_task_thread() == true and there aren't any free threads available) then
-                    - calls funct(arg1.get()) within the calling thread and returns
-                      when it finishes
+                - if (num_threads_in_pool() == 0) then
+                    - calls funct(arg1.get()) within the calling thread and returns when it finishes.
                 - else
-                    - the call to this function blocks until there is a free thread in the pool
-                      to process this new task.  Once a free thread is available the task
-                      is handed off to that thread which then calls funct(arg1.get()).
+                    - adds the task to the pool's queue and returns immediately.  A thread
+                      in the pool will later call funct(arg1.get()).
                 - #arg1.is_ready() == false 
                 - returns a task id that can be used by this->wait_for_task() to wait
                   for the submitted task to finish.
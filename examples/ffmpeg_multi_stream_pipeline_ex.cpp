@@ -0,0 +1,109 @@
+// The contents of this file are in the public domain. See LICENSE_FOR_EXAMPLE_PROGRAMS.txt
+/*
+
+    This is an example illustrating the use of dlib::ffmpeg::multi_stream_pipeline.
+    It decodes several videos (or cameras, or network streams) concurrently and runs
+    dlib's HOG face detector on batches of frames collected across all the streams.
+    Every few seconds it prints the pipeline's latency and throughput counters.
+
+    For example, to process three videos at once:
+        ./ffmpeg_multi_stream_pipeline_ex -i video1.mp4 -i video2.mp4 -i rtsp://camera/stream
+
+    Please see all the other ffmpeg examples:
+        - ffmpeg_info_ex.cpp
+        - ffmpeg_video_decoding_ex.cpp
+        - ffmpeg_video_decoding2_ex.cpp
+        - ffmpeg_video_demuxing_ex.cpp
+        - ffmpeg_video_demuxing2_ex.cpp
+        - ffmpeg_video_encoding_ex.cpp
+        - ffmpeg_video_muxing_ex.cpp
+        - ffmpeg_rtsp_ex.cpp
+*/
+
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <dlib/media.h>
+#include <dlib/image_processing/frontal_face_detector.h>
+#include <dlib/cmd_line_parser.h>
+
+using namespace std;
+using namespace std::chrono;
+using namespace dlib;
+using namespace dlib::ffmpeg;
+
+int main(const int argc, const char** argv)
+try
+{
+    command_line_parser parser;
+    parser.add_option("i",          "input video, camera or URL. Use it once per stream", 1);
+    parser.add_option("batch",      "maximum number of frames per batch. Defaults to 8", 1);
+    parser.add_option("decoders",   "number of decoding threads. Defaults to one per stream", 1);
+    parser.add_option("detectors",  "number of threads running the face detector. Defaults to 1", 1);
+    parser.add_option("no-drop",    "don't drop frames when the detector can't keep up");
+
+    parser.set_group_name("Help Options");
+    parser.add_option("h",      "alias of --help");
+    parser.add_option("help",   "display this message and exit");
+
+    parser.parse(argc, argv);
+
+    if (parser.option("h") || parser.option("help") || parser.option("i").count() == 0)
+    {
+        parser.print_options();
+        return 0;
+    }
+
+    using pipeline = multi_stream_pipeline<array2d<unsigned char>>;
+
+    pipeline::args args;
+    for (unsigned long i = 0; i < parser.option("i").count(); ++i)
+        args.sources.push_back(demuxer::args{parser.option("i").argument(0,i), video_enabled, audio_disabled});
+
+    args.batch_size             = get_option(parser, "batch", 8);
+    args.num_decode_threads     = get_option(parser, "decoders", 0);
+    args.num_inference_threads  = get_option(parser, "detectors", 1);
+    args.drop_frames            = !parser.option("no-drop");
+
+    // Each detector thread gets its own copy of the detector since they aren't thread safe.
+    // The batch callback is invoked with frames coming from any of the streams.  Their
+    // stream_id tells you which one.
+    std::mutex m;
+    std::vector<unsigned long> faces(args.sources.size(), 0);
+
+    pipeline p(args, [&, detector = get_frontal_face_detector()](std::vector<pipeline::frame_type>& batch)
+    {
+        static thread_local frontal_face_detector local = detector;
+
+        for (auto& item : batch)
+        {
+            const auto dets = local(item.img);
+            std::lock_guard<std::mutex> lock(m);
+            faces[item.stream_id] += dets.size();
+        }
+    });
+
+    p.start();
+
+    // The pipeline runs in the background. We just report its counters until it finishes.
+    // If the detector threw, wait() rethrows the exception.
+    while (p.is_running())
+    {
+        std::this_thread::sleep_for(seconds(2));
+        cout << p.get_stats() << endl;
+    }
+
+    p.wait();
+
+    cout << "\nFinal: " << p.get_stats() << endl;
+    for (size_t i = 0; i < faces.size(); ++i)
+        cout << args.sources[i].filepath << " : " << faces[i] << " faces detected" << endl;
+
+    return EXIT_SUCCESS;
+}
+catch (const std::exception& e)
+{
+    printf("%s\n", e.what());
+    return EXIT_FAILURE;
+}
+
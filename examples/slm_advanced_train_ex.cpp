@@ -30,6 +30,8 @@
     --generate      Generate text from trained model
     --verify        Compare generated output with original
     --tokenize-only Only perform tokenization step
+    --serve         Serve generation requests over HTTP, batching concurrent
+                    requests through a single network
 
     Configuration:
     - Adjust template parameters in transformer_config for model architecture
@@ -46,12 +48,14 @@
 #include <chrono>
 #include <algorithm>
 #include <csignal>
+#include <thread>
 #include <dlib/data_io.h>
 #include <dlib/cmd_line_parser.h>
 #include <dlib/misc_api.h>
 #include <dlib/tokenizer/bpe_tokenizer.h>
 #include <dlib/serialize.h>
 #include <dlib/dnn.h>
+#include <dlib/server.h>
 
 using namespace std;
 using namespace dlib;
@@ -741,6 +745,71 @@ private:
     std::deque<int> current_context_;  // Current context
 };
 
+// ----------------------------------------------------------------------------------------
+// HTTP front end for the serve mode.  Every connection runs on_request() in its own
+// thread, and all of them share one network through a batched_generator, which runs
+// the prompts of concurrent requests together.
+// ----------------------------------------------------------------------------------------
+template <typename net_type>
+class generation_server : public server_http
+{
+public:
+    generation_server(
+        batched_generator<net_type>& generator_,
+        const bpe_tokenizer& tokenizer_
+    ) : generator(generator_), tokenizer(tokenizer_) {}
+
+private:
+    const std::string on_request(
+        const incoming_things& incoming,
+        outgoing_things& outgoing
+    )
+    {
+        // e.g. http://localhost:8080/generate?prompt=The%20city&max_tokens=60&temperature=0.8&top_k=40
+        if (incoming.path != "/generate")
+        {
+            outgoing.http_return = 404;
+            outgoing.http_return_status = "Not Found";
+            return "Use /generate?prompt=...&max_tokens=...&temperature=...&top_k=...&top_p=...\n";
+        }
+
+        generation_options options;
+        options.max_new_tokens = get_query(incoming, "max_tokens", 100ul);
+        options.temperature = get_query(incoming, "temperature", 0.8f);
+        options.top_k = get_query(incoming, "top_k", 40ul);
+        options.top_p = get_query(incoming, "top_p", 0.95f);
+        options.seed = get_query(incoming, "seed", 0ul);
+        options.stop_tokens = { tokenizer.get_special_token_id("<text>"), tokenizer.get_special_token_id("</text>") };
+        if (!(options.top_p > 0 && options.top_p <= 1))
+        {
+            outgoing.http_return = 400;
+            outgoing.http_return_status = "Bad Request";
+            return "top_p must be in (0, 1]\n";
+        }
+
+        std::vector<int> prompt = { tokenizer.get_special_token_id("<text>") };
+        const auto encoded = tokenizer.encode(incoming.queries["prompt"]);
+        prompt.insert(prompt.end(), encoded.begin(), encoded.end());
+
+        const auto tokens = generator.generate(prompt, options);
+        outgoing.headers["Content-Type"] = "text/plain; charset=utf-8";
+        return incoming.queries["prompt"] + tokenizer.decode(tokens, false) + "\n";
+    }
+
+    template <typename T>
+    static T get_query(const incoming_things& incoming, const std::string& key, T default_value)
+    {
+        const std::string& value = incoming.queries[key];
+        if (value.empty())
+            return default_value;
+        try { return string_cast<T>(value); }
+        catch (string_cast_error&) { return default_value; }
+    }
+
+    batched_generator<net_type>& generator;
+    const bpe_tokenizer& tokenizer;
+};
+
 int main(int argc, char** argv)
 {
     try
@@ -753,6 +822,9 @@ int main(int argc, char** argv)
         parser.add_option("generate", "Generate enwiki from a previously trained model");
         parser.add_option("verify", "Verify generated output against original data");
         parser.add_option("tokenize-only", "Only tokenize the input file and save tokens");
+        parser.add_option("serve", "Serve text generation over HTTP from a previously trained model");
+        parser.add_option("port", "Port the HTTP server listens on (default: 8080)", 1);
+        parser.add_option("max-batch", "Maximum number of requests generated together (default: 64)", 1);
         parser.add_option("enwiki", "Path to the enwiki file (default: enwiki.txt)", 1);
         parser.add_option("max-tokens", "Maximum number of tokens to load in memory", 1);
         parser.add_option("max-bytes", "Maximum number of bytes to process from enwiki", 1);
@@ -773,7 +845,7 @@ int main(int argc, char** argv)
 
         if (parser.number_of_arguments() == 0 &&
             !parser.option("train") && !parser.option("generate") &&
-            !parser.option("verify") && !parser.option("tokenize-only"))
+            !parser.option("verify") && !parser.option("tokenize-only") && !parser.option("serve"))
         {
             parser.print_options();
             return 0;
@@ -1318,6 +1390,53 @@ int main(int argc, char** argv)
             cout << "Output saved to " << output_file << "\n";
         }
 
+        // ----------------------------------------------------------------------------------------
+        // Serve mode - HTTP text generation with continuous batching
+        // ----------------------------------------------------------------------------------------
+        if (parser.option("serve"))
+        {
+            cout << "=== SERVE MODE ===\n";
+
+            using net_infer = enwiki_transformer::network_type<false>;
+            net_infer net;
+            if (file_exists(model_file)) {
+                deserialize(model_file) >> net >> tokenizer;
+                cout << "Loaded model from " << model_file << "\n";
+            }
+            else {
+                cerr << "Error: model file not found. Please run --train first.\n";
+                return 0;
+            }
+
+            // Requests that arrive while the network is running join the next step, so
+            // the network always runs on as many sequences as there are clients, up to
+            // max-batch.
+            const size_t max_batch = get_option(parser, "max-batch", 64);
+            batched_generator<net_infer> generator(net, max_seq_len, tokenizer.get_special_token_id("<pad>"), max_batch);
+            generation_server<net_infer> server(generator, tokenizer);
+            server.set_listening_port(get_option(parser, "port", 8080));
+            server.start_async();
+            cout << "Listening on http://localhost:" << server.get_listening_port()
+                << "/generate?prompt=...  (Ctrl+C to stop)\n";
+
+            uint64_t last_tokens = 0;
+            double last_seconds = 0;
+            while (!g_terminate_flag.load()) {
+                std::this_thread::sleep_for(std::chrono::seconds(5));
+                const uint64_t tokens = generator.get_num_generated_tokens();
+                const double seconds = generator.get_busy_seconds();
+                if (tokens != last_tokens) {
+                    cout << "Generated " << tokens << " tokens, "
+                        << (tokens - last_tokens) / (seconds - last_seconds) << " tokens/sec over the last "
+                        << (seconds - last_seconds) << "s of work, "
+                        << generator.num_requests() << " requests in progress\n";
+                }
+                last_tokens = tokens;
+                last_seconds = seconds;
+            }
+            server.clear();
+        }
+
         // ----------------------------------------------------------------------------------------
         // Verification mode - Compare original and generated file
         // ----------------------------------------------------------------------------------------
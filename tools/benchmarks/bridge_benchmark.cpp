@@ -0,0 +1,85 @@
+/*
+
+    This program measures the throughput of dlib::bridge.  It sends the number of
+    100x100 matrices of doubles given on the command line through a bridge, both raw
+    and serialized, over TCP and over a Unix domain socket.
+
+    E.g. ./bridge_benchmark 1000
+
+*/
+
+
+#include <dlib/bridge.h>
+#include <dlib/matrix.h>
+#include <dlib/string.h>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+using namespace dlib;
+using namespace std;
+
+// ----------------------------------------------------------------------------------------
+
+// A matrix the bridge can only send with serialize() since it doesn't know this type.
+struct wrapped_matrix
+{
+    matrix<double> m;
+};
+
+void serialize(const wrapped_matrix& item, std::ostream& out) { serialize(item.m, out); }
+void deserialize(wrapped_matrix& item, std::istream& in) { deserialize(item.m, in); }
+
+// ----------------------------------------------------------------------------------------
+
+template <typename T, typename listen_type, typename connect_type>
+double mb_per_second (
+    const T& item,
+    long num,
+    listen_type listen_params,
+    connect_type connect_params
+)
+{
+    dlib::pipe<T> in(100), out(100);
+    bridge b1(listen_params, transmit(out));
+    bridge b2(connect_params, receive(in));
+
+    const auto start = std::chrono::steady_clock::now();
+    std::thread sender([&](){
+        for (long i = 0; i < num; ++i)
+        {
+            T temp = item;
+            out.enqueue(temp);
+        }
+    });
+    T val;
+    for (long i = 0; i < num; ++i)
+        in.dequeue(val);
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+    sender.join();
+    return num*sizeof(double)*100*100/secs/1e6;
+}
+
+// ----------------------------------------------------------------------------------------
+
+int main(int argc, char** argv) try
+{
+    const long num = argc > 1 ? string_cast<long>(argv[1]) : 1000;
+    const unsigned short port = 41239;
+    wrapped_matrix w;
+    w.m = uniform_matrix<double>(100,100,1.5);
+    const std::string path = "dlib_bridge_benchmark.sock";
+
+    cout << "TCP, serialize():       " << mb_per_second(w, num, listen_on_port(port), connect_to_ip_and_port("127.0.0.1",port)) << " MB/s\n";
+    cout << "TCP, raw:               " << mb_per_second(w.m, num, listen_on_port(port), connect_to_ip_and_port("127.0.0.1",port)) << " MB/s\n";
+    cout << "Unix socket, serialize: " << mb_per_second(w, num, listen_on_unix_socket(path), connect_to_unix_socket(path)) << " MB/s\n";
+    cout << "Unix socket, raw:       " << mb_per_second(w.m, num, listen_on_unix_socket(path), connect_to_unix_socket(path)) << " MB/s\n";
+}
+catch (std::exception& e)
+{
+    cout << e.what() << endl;
+    return 1;
+}
+
+// ----------------------------------------------------------------------------------------
+
@@ -0,0 +1,213 @@
+/*
+
+    This program benchmarks the cpu dnn kernels in dlib/cuda/cpu_dlib.cpp.  The
+    elementwise kernels are compared against plain scalar loops using the standard
+    library, the fused solver step against one compute_adam_update() call per
+    tensor, and the lazy embeddings ADAM update against a dense update of the whole
+    table.  The argument is the number of floats in the tensors.
+
+    E.g. ./dnn_cpu_kernels_benchmark 4000000
+
+*/
+
+
+#include <dlib/dnn.h>
+#include <dlib/string.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+using namespace dlib;
+using namespace std;
+
+// ----------------------------------------------------------------------------------------
+
+float ref_sigmoid(float x) { return 1/(1+std::exp(-x)); }
+float ref_tanh(float x) { return std::tanh(x); }
+float ref_mish(float x) { const float e = std::exp(x); const float delta = 2*e + e*e + 2; return x - 2*x/delta; }
+float ref_gelu(float x) { return 0.5f*x*(1+std::erf(x/std::sqrt(2.0f))); }
+float ref_silu(float x) { return x/(1+std::exp(-x)); }
+
+// ----------------------------------------------------------------------------------------
+
+template <typename F>
+double seconds (
+    F&& f
+)
+{
+    f();
+    double best = std::numeric_limits<double>::infinity();
+    for (int i = 0; i < 5; ++i)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        f();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count());
+    }
+    return best;
+}
+
+void report (
+    const std::string& name,
+    double ref_time,
+    double new_time
+)
+{
+    cout << rpad(name, 32) << lpad(cast_to_string(ref_time*1000), 10) << " ms "
+         << lpad(cast_to_string(new_time*1000), 10) << " ms "
+         << lpad(cast_to_string(ref_time/new_time), 8) << "x\n";
+}
+
+// ----------------------------------------------------------------------------------------
+
+int main(int argc, char** argv) try
+{
+    const long size = argc > 1 ? string_cast<long>(argv[1]) : 4000000;
+    const long k = 64, nr = 16, nc = 16;
+    dlib::rand rnd;
+    resizable_tensor src(std::max<long>(1, size/(k*nr*nc)), k, nr, nc), dest, expected;
+    for (auto& x : src)
+        x = 3*rnd.get_random_gaussian();
+    dest.copy_size(src);
+    expected.copy_size(src);
+
+    cout << "tensor size " << src.size() << ", " << default_thread_pool().num_threads_in_pool() << " threads\n";
+    cout << rpad(std::string("kernel"), 32) << "   reference        new  speedup\n";
+
+    const auto unary = [&](const std::string& name, float (*ref)(float), void (*kernel)(tensor&, const tensor&)) {
+        const double t1 = seconds([&]() {
+            const float* s = src.host();
+            float* d = expected.host();
+            for (size_t i = 0; i < src.size(); ++i)
+                d[i] = ref(s[i]);
+        });
+        const double t2 = seconds([&]() { kernel(dest, src); });
+        report(name, t1, t2);
+    };
+    unary("sigmoid", ref_sigmoid, cpu::sigmoid);
+    unary("tanh", ref_tanh, cpu::tanh);
+    unary("mish", ref_mish, cpu::mish);
+    unary("gelu", ref_gelu, cpu::gelu);
+    unary("silu", ref_silu, cpu::silu);
+
+    {
+        const double t1 = seconds([&]() {
+            const float* s = src.host();
+            float* d = expected.host();
+            for (size_t i = 0; i < src.size(); ++i)
+                d[i] = 2*s[i] + 3;
+        });
+        const double t2 = seconds([&]() { cpu::affine_transform(dest, src, 2, 3); });
+        report("affine_transform", t1, t2);
+    }
+    {
+        resizable_tensor gamma(1,k), beta(1,k), rm(1,k), rv(1,k), out;
+        gamma = 1.5;
+        beta = 0.5;
+        rm = 0.1;
+        rv = 2;
+        const double t1 = seconds([&]() {
+            const long num = nr*nc;
+            const float* s = src.host();
+            float* d = expected.host();
+            for (long n = 0; n < src.num_samples(); ++n)
+            {
+                for (long kk = 0; kk < k; ++kk)
+                {
+                    const float invstd = 1.0f/std::sqrt(rv.host()[kk] + 1e-5);
+                    for (long j = 0; j < num; ++j)
+                    {
+                        *d = gamma.host()[kk]*(*s - rm.host()[kk])*invstd + beta.host()[kk];
+                        ++d;
+                        ++s;
+                    }
+                }
+            }
+        });
+        const double t2 = seconds([&]() { cpu::batch_normalize_conv_inference(1e-5, out, src, gamma, beta, rm, rv); });
+        report("batch_normalize_conv_inference", t1, t2);
+    }
+    {
+        // A network's worth of parameter tensors, most of them small.  The reference is
+        // what the per layer solvers do: one adam update and one add per tensor.
+        std::vector<resizable_tensor> params, grads, s, m, v;
+        long total = 0;
+        while (total < size)
+        {
+            const long n = rnd.get_random_double() < 0.5 ? 64 : std::max<long>(1, size/20);
+            params.emplace_back(n);
+            for (auto& x : params.back())
+                x = rnd.get_random_gaussian();
+            grads.push_back(params.back());
+            s.push_back(params.back());
+            m.push_back(params.back());
+            m.back() = 0;
+            v.push_back(m.back());
+            total += n;
+        }
+        std::vector<resizable_tensor> params2 = params, m2 = m, v2 = v;
+        const double t1 = seconds([&]() {
+            for (size_t j = 0; j < params.size(); ++j)
+            {
+                cpu::compute_adam_update(0, params[j].size(), s[j], m2[j], v2[j], 10, 0.01, 0.0005, 0.9, 0.999, params2[j], grads[j]);
+                cpu::add(1, params2[j], 1, s[j]);
+            }
+        });
+        std::vector<tt::solver_update_segment> segments(params.size());
+        for (size_t j = 0; j < params.size(); ++j)
+        {
+            segments[j].rule = tt::solver_update_rule::adam;
+            segments[j].params = &params[j];
+            segments[j].params_grad = &grads[j];
+            segments[j].state1 = &m[j];
+            segments[j].state2 = &v[j];
+            segments[j].step = &params[j];
+            segments[j].end = params[j].size();
+            segments[j].learning_rate = 0.01;
+            segments[j].weight_decay = 0.0005;
+            segments[j].momentum1 = 0.9;
+            segments[j].momentum2 = 0.999;
+            segments[j].t = 10;
+        }
+        const double t2 = seconds([&]() { cpu::apply_solver_updates(segments); });
+        report("adam, "+cast_to_string(params.size())+" tensors", t1, t2);
+    }
+    {
+        // A language model's embedding table and a batch of 32 sequences of 64 tokens.
+        // The reference is what the solvers would do if they owned the table: a dense
+        // update of every row.
+        const long dim = 512, num_embeddings = std::max<long>(1, size/dim);
+        resizable_tensor prev(32,1,64,1), gradient_input(32,1,64,dim);
+        resizable_tensor embs(num_embeddings, dim), grad, s, m, v;
+        for (auto& x : prev)
+            x = rnd.get_random_32bit_number()%num_embeddings;
+        for (auto& x : gradient_input)
+            x = rnd.get_random_gaussian();
+        for (auto& x : embs)
+            x = rnd.get_random_gaussian();
+
+        grad.copy_size(embs);
+        s.copy_size(embs);
+        m.copy_size(embs);
+        v.copy_size(embs);
+        grad = 0;
+        m = 0;
+        v = 0;
+        const double t1 = seconds([&]() {
+            cpu::compute_adam_update(0, embs.size(), s, m, v, 10, 0.01, 0, 0.9, 0.999, embs, grad);
+            cpu::add(1, embs, 1, s);
+        });
+        const double t2 = seconds([&]() { cpu::embeddings_adam_update(prev, gradient_input, embs, m, v, 10, 0.01, 0.9, 0.999, 1e-8); });
+        report("embeddings adam, dense vs lazy", t1, t2);
+    }
+}
+catch (std::exception& e)
+{
+    cout << e.what() << endl;
+    return 1;
+}
+
+// ----------------------------------------------------------------------------------------
+
@@ -0,0 +1,83 @@
+/*
+
+    This program benchmarks the per call cost of logging with and without async
+    logging.  It logs the number of messages given on the command line from 1 and
+    from 4 threads into a stream that throws its input away.
+
+    E.g. ./logger_benchmark 1000000
+
+*/
+
+
+#include <dlib/logger.h>
+#include <dlib/string.h>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace dlib;
+using namespace std;
+
+// ----------------------------------------------------------------------------------------
+
+class null_streambuf : public std::streambuf
+{
+    int_type overflow (int_type c) { return c; }
+    std::streamsize xsputn (const char*, std::streamsize num) { return num; }
+};
+
+// ----------------------------------------------------------------------------------------
+
+double ns_per_message (
+    logger& log,
+    long num_messages,
+    int num_threads
+)
+{
+    const long per_thread = num_messages/num_threads;
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i)
+    {
+        threads.emplace_back([&](){
+            for (long j = 0; j < per_thread; ++j)
+                log << LTRACE << "message number " << j << " with a double " << j*0.5;
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+    return secs*1e9/(per_thread*num_threads);
+}
+
+// ----------------------------------------------------------------------------------------
+
+int main(int argc, char** argv) try
+{
+    const long num_messages = argc > 1 ? string_cast<long>(argv[1]) : 1000000;
+    null_streambuf buf;
+    std::ostream out(&buf);
+    logger log("logger_benchmark");
+    log.set_output_stream(out);
+    log.set_level(LALL);
+
+    for (int num_threads : {1, 4})
+    {
+        cout << num_threads << " thread(s):\n";
+        cout << "  synchronous:               " << ns_per_message(log, num_messages, num_threads) << " ns/message\n";
+        enable_async_logging();
+        cout << "  async, time per call:      " << ns_per_message(log, num_messages, num_threads) << " ns/message\n";
+        const auto start = std::chrono::steady_clock::now();
+        disable_async_logging();
+        cout << "  async, time to drain:      " << std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count() << " seconds\n";
+    }
+}
+catch (std::exception& e)
+{
+    cout << e.what() << endl;
+    return 1;
+}
+
+// ----------------------------------------------------------------------------------------
+
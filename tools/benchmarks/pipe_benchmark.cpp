@@ -0,0 +1,75 @@
+/*
+
+    This program benchmarks the throughput of dlib::pipe against lock_free_pipe.  It
+    moves the number of ints given on the command line through each kind of pipe
+    with one producer and one consumer, and with 4 of each, and prints the number of
+    items per second.
+
+    E.g. ./pipe_benchmark 1000000
+
+*/
+
+
+#include <dlib/pipe.h>
+#include <dlib/string.h>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace dlib;
+using namespace std;
+
+// ----------------------------------------------------------------------------------------
+
+template <typename pipe_type>
+double items_per_second (
+    long num_items,
+    int num_threads
+)
+{
+    pipe_type p(1024);
+    const long per_thread = num_items/num_threads;
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i)
+    {
+        threads.emplace_back([&](){
+            for (long j = 0; j < per_thread; ++j)
+            {
+                long val = j;
+                p.enqueue(val);
+            }
+        });
+        threads.emplace_back([&](){
+            long val;
+            for (long j = 0; j < per_thread; ++j)
+                p.dequeue(val);
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+    return per_thread*num_threads/std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+}
+
+// ----------------------------------------------------------------------------------------
+
+int main(int argc, char** argv) try
+{
+    const long num_items = argc > 1 ? string_cast<long>(argv[1]) : 1000000;
+    cout << "1 producer, 1 consumer:\n";
+    cout << "  pipe:                     " << items_per_second<dlib::pipe<long>>(num_items,1) << " items/sec\n";
+    cout << "  lock_free_pipe PIPE_SPSC: " << items_per_second<dlib::lock_free_pipe<long,PIPE_SPSC>>(num_items,1) << " items/sec\n";
+    cout << "  lock_free_pipe PIPE_MPMC: " << items_per_second<dlib::lock_free_pipe<long,PIPE_MPMC>>(num_items,1) << " items/sec\n";
+    cout << "4 producers, 4 consumers:\n";
+    cout << "  pipe:                     " << items_per_second<dlib::pipe<long>>(num_items,4) << " items/sec\n";
+    cout << "  lock_free_pipe PIPE_MPMC: " << items_per_second<dlib::lock_free_pipe<long,PIPE_MPMC>>(num_items,4) << " items/sec\n";
+}
+catch (std::exception& e)
+{
+    cout << e.what() << endl;
+    return 1;
+}
+
+// ----------------------------------------------------------------------------------------
+
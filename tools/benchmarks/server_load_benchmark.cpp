@@ -0,0 +1,164 @@
+/*
+
+    This program is a local load generator for dlib::server.  It opens the number of
+    client connections given on the command line, which mostly sit idle, and then
+    sends small requests on random connections from a few client threads.  It
+    reports the request latency and throughput of a thread per connection server and
+    of servers with a fixed number of worker threads.
+
+    E.g. ./server_load_benchmark 2000
+
+*/
+
+
+#include <dlib/server.h>
+#include <dlib/rand.h>
+#include <dlib/string.h>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace dlib;
+using namespace std;
+
+// ----------------------------------------------------------------------------------------
+
+class echo_serv : public server
+{
+    /*!
+        Echos back whatever it receives.  Between messages the connection is parked
+        rather than holding one of the worker threads.
+    !*/
+public:
+    ~echo_serv() { clear(); }
+
+private:
+    void on_connect (
+        connection& 
+    ) {}
+
+    bool on_connection_ready (
+        connection& con
+    )
+    {
+        char buf[1024];
+        const long num = con.read(buf, sizeof(buf), 0);
+        if (num == TIMEOUT)
+            return true;
+        if (num <= 0)
+            return false;
+        return con.write(buf, num) == num;
+    }
+};
+
+class echo_serv_threaded : public server
+{
+    /*!
+        The same thing as echo_serv but using a thread per connection.
+    !*/
+public:
+    ~echo_serv_threaded() { clear(); }
+
+private:
+    void on_connect (
+        connection& con
+    ) 
+    {
+        char buf[1024];
+        long num;
+        while ((num = con.read(buf, sizeof(buf))) > 0)
+        {
+            if (con.write(buf, num) != num)
+                break;
+        }
+    }
+};
+
+// ----------------------------------------------------------------------------------------
+
+template <typename server_type>
+void run_clients (
+    const std::string& name,
+    unsigned long num_workers,
+    long num_clients
+)
+{
+    server_type theserv;
+    theserv.set_listening_port(12347);
+    theserv.set_max_connections(0);
+    theserv.set_max_worker_threads(num_workers);
+    theserv.start_async();
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::unique_ptr<connection>> clients(num_clients);
+    for (auto& c : clients)
+        c.reset(connect("127.0.0.1", 12347));
+    const double connect_time = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+
+    const int num_threads = 4;
+    const int requests_per_thread = 2000;
+    std::vector<std::vector<double>> latencies(num_threads);
+    const auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t)
+    {
+        threads.emplace_back([&,t]() {
+            dlib::rand rnd(t);
+            char buf[64];
+            for (int i = 0; i < requests_per_thread; ++i)
+            {
+                // each thread uses its own subset of the clients
+                connection& con = *clients[(rnd.get_random_32bit_number()%(num_clients/num_threads))*num_threads + t];
+                const auto ts = std::chrono::steady_clock::now();
+                DLIB_CASSERT(con.write("0123456789abcdef", 16) == 16);
+                long got = 0;
+                while (got < 16)
+                {
+                    const long num = con.read(buf+got, 16-got);
+                    DLIB_CASSERT(num > 0);
+                    got += num;
+                }
+                latencies[t].push_back(std::chrono::duration<double>(std::chrono::steady_clock::now()-ts).count());
+            }
+        });
+    }
+    for (auto& th : threads)
+        th.join();
+    const double total_time = std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+
+    std::vector<double> all;
+    for (auto& l : latencies)
+        all.insert(all.end(), l.begin(), l.end());
+    std::sort(all.begin(), all.end());
+
+    cout << setw(22) << name 
+         << setw(12) << connect_time*1000
+         << setw(12) << all[all.size()/2]*1e6
+         << setw(12) << all[all.size()*99/100]*1e6
+         << setw(14) << (long)(all.size()/total_time) << endl;
+
+    clients.clear();
+}
+
+// ----------------------------------------------------------------------------------------
+
+int main(int argc, char** argv) try
+{
+    const long num_clients = argc > 1 ? std::max(4L, string_cast<long>(argv[1])) : 2000;
+    cout << "\n                server  connect(ms)    p50(us)    p99(us)  requests/sec" << endl;
+    run_clients<echo_serv_threaded>("thread per connection", 0, num_clients);
+    for (unsigned long num_workers : {1UL, 4UL, 16UL})
+        run_clients<echo_serv>(cast_to_string(num_workers) + " workers", num_workers, num_clients);
+}
+catch (std::exception& e)
+{
+    cout << e.what() << endl;
+    return 1;
+}
+
+// ----------------------------------------------------------------------------------------
+
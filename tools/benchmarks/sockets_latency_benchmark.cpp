@@ -0,0 +1,130 @@
+/*
+
+    This program benchmarks request/response latency over loopback.  Each request is
+    a 4 byte header followed by a 100 byte payload, which the other end echoes back.
+    It compares writing the header and payload with two write() calls, with and
+    without Nagle's algorithm, to writing them with one gather write.  The argument
+    is the number of round trips to time.
+
+    E.g. ./sockets_latency_benchmark 1000
+
+*/
+
+
+#include <dlib/sockets.h>
+#include <dlib/string.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace dlib;
+using namespace std;
+
+// ----------------------------------------------------------------------------------------
+
+enum write_mode
+{
+    TWO_WRITES,
+    TWO_WRITES_NO_NAGLE,
+    GATHER_WRITE
+};
+
+void send_message (
+    connection& con,
+    const char* header,
+    const std::vector<char>& payload,
+    write_mode mode
+)
+{
+    if (mode == GATHER_WRITE)
+    {
+        connection::const_buffer bufs[2];
+        bufs[0].data = header;
+        bufs[0].size = 4;
+        bufs[1].data = &payload[0];
+        bufs[1].size = payload.size();
+        con.write(bufs, 2);
+    }
+    else
+    {
+        con.write(header, 4);
+        con.write(&payload[0], payload.size());
+    }
+}
+
+void read_bytes (
+    connection& con,
+    size_t num
+)
+{
+    char buf[256];
+    while (num > 0)
+    {
+        const long status = con.read(buf, std::min(num, sizeof(buf)));
+        if (status <= 0)
+            throw socket_error(ECONNECTION, "connection closed while reading");
+        num -= status;
+    }
+}
+
+// ----------------------------------------------------------------------------------------
+
+double microseconds_per_round_trip (
+    write_mode mode,
+    long num_round_trips
+)
+{
+    std::unique_ptr<listener> list;
+    std::unique_ptr<connection> a, b;
+    if (create_listener(list, 0, "127.0.0.1") != 0 ||
+        create_connection(a, list->get_listening_port(), "127.0.0.1") != 0 ||
+        list->accept(b) != 0)
+        throw socket_error(ECONNECTION, "unable to connect over loopback");
+    if (mode == TWO_WRITES_NO_NAGLE)
+    {
+        a->disable_nagle();
+        b->disable_nagle();
+    }
+
+    const char header[4] = {'m','s','g',' '};
+    const std::vector<char> payload(100, 'x');
+
+    std::thread echo([&](){
+        for (long i = 0; i < num_round_trips; ++i)
+        {
+            read_bytes(*b, 4 + payload.size());
+            send_message(*b, header, payload, mode);
+        }
+    });
+
+    const auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < num_round_trips; ++i)
+    {
+        send_message(*a, header, payload, mode);
+        read_bytes(*a, 4 + payload.size());
+    }
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+    echo.join();
+    return secs*1e6/num_round_trips;
+}
+
+// ----------------------------------------------------------------------------------------
+
+int main(int argc, char** argv) try
+{
+    const long num_round_trips = argc > 1 ? string_cast<long>(argv[1]) : 1000;
+    cout << "header and payload with two writes:                 " << microseconds_per_round_trip(TWO_WRITES, num_round_trips) << " us/round trip\n";
+    cout << "header and payload with two writes, Nagle disabled: " << microseconds_per_round_trip(TWO_WRITES_NO_NAGLE, num_round_trips) << " us/round trip\n";
+    cout << "header and payload with one gather write:           " << microseconds_per_round_trip(GATHER_WRITE, num_round_trips) << " us/round trip\n";
+}
+catch (std::exception& e)
+{
+    cout << e.what() << endl;
+    return 1;
+}
+
+// ----------------------------------------------------------------------------------------
+
@@ -0,0 +1,289 @@
+/*
+
+    This program benchmarks the scheduler behind dlib::thread_pool.  It times fine
+    grained parallel_for() loops, nested parallel_for() loops and raw
+    add_task_by_value() throughput for pools of 1, 2, 4, ... up to the number of
+    threads given on the command line and prints the results, next to the same
+    numbers for baseline_thread_pool, a copy of the scheduler thread_pool used
+    before it got per worker queues.
+
+    E.g. ./thread_pool_benchmark 64
+
+*/
+
+
+#include <dlib/threads.h>
+#include <dlib/string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace dlib;
+using namespace std;
+
+// ----------------------------------------------------------------------------------------
+
+class baseline_thread_pool
+{
+    /*!
+        WHAT THIS OBJECT REPRESENTS
+            The scheduler thread_pool used before it got per worker queues, kept so
+            main() can compare against it: one mutex guards one task slot per
+            worker, add_task() blocks while every slot is taken, and a worker that
+            submits a task while every slot is taken runs it inline.
+    !*/
+public:
+    explicit baseline_thread_pool (
+        unsigned long num_threads
+    ) : slots(num_threads)
+    {
+        for (unsigned long i = 0; i < num_threads; ++i)
+            threads.emplace_back([this]() { run(); });
+    }
+
+    ~baseline_thread_pool (
+    )
+    {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            destructing = true;
+        }
+        task_ready.notify_all();
+        for (auto& t : threads)
+            t.join();
+    }
+
+    unsigned long num_threads_in_pool() const { return slots.size(); }
+
+    void add_task (
+        std::function<void()> f
+    )
+    {
+        std::unique_lock<std::mutex> lock(m);
+        long idx = find_slot([](const slot& s) { return !s.f; });
+        if (idx == -1 && is_worker())
+        {
+            lock.unlock();
+            f();
+            return;
+        }
+        while (idx == -1)
+        {
+            task_done.wait(lock);
+            idx = find_slot([](const slot& s) { return !s.f; });
+        }
+        slots[idx].f = std::move(f);
+        slots[idx].thread_id = std::this_thread::get_id();
+        task_ready.notify_one();
+    }
+
+    void wait_for_all_tasks (
+    )
+    {
+        const std::thread::id id = std::this_thread::get_id();
+        std::unique_lock<std::mutex> lock(m);
+        while (find_slot([&](const slot& s) { return s.f && s.thread_id == id; }) != -1)
+            task_done.wait(lock);
+    }
+
+    template <typename F>
+    void parallel_for_blocked (
+        long begin,
+        long end,
+        const F& funct
+    )
+    {
+        // what parallel_for_blocked() used to do
+        const long num = end-begin;
+        const long block_size = std::max(1L, num/static_cast<long>(slots.size()*8));
+        for (long i = 0; i < num; i += block_size)
+        {
+            const long b = begin+i, e = begin+std::min(i+block_size, num);
+            add_task([&funct,b,e]() { funct(b, e); });
+        }
+        wait_for_all_tasks();
+    }
+
+private:
+    struct slot
+    {
+        std::function<void()> f;
+        std::thread::id thread_id;
+        bool is_being_processed = false;
+    };
+
+    template <typename pred_type>
+    long find_slot (
+        const pred_type& pred
+    ) const
+    {
+        for (unsigned long i = 0; i < slots.size(); ++i)
+        {
+            if (pred(slots[i]))
+                return i;
+        }
+        return -1;
+    }
+
+    bool is_worker (
+    ) const
+    {
+        for (auto& t : threads)
+        {
+            if (t.get_id() == std::this_thread::get_id())
+                return true;
+        }
+        return false;
+    }
+
+    void run (
+    )
+    {
+        std::unique_lock<std::mutex> lock(m);
+        while (true)
+        {
+            long idx;
+            while ((idx = find_slot([](const slot& s) { return s.f && !s.is_being_processed; })) == -1 && !destructing)
+                task_ready.wait(lock);
+            if (destructing)
+                return;
+
+            slots[idx].is_being_processed = true;
+            std::function<void()> f = slots[idx].f;
+            lock.unlock();
+            f();
+            lock.lock();
+            slots[idx].f = nullptr;
+            slots[idx].is_being_processed = false;
+            task_done.notify_all();
+        }
+    }
+
+    std::mutex m;
+    std::condition_variable task_ready, task_done;
+    std::vector<slot> slots;
+    std::vector<std::thread> threads;
+    bool destructing = false;
+};
+
+// ----------------------------------------------------------------------------------------
+
+// ----------------------------------------------------------------------------------------
+
+template <typename F>
+double time_it (F&& f)
+{
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+}
+
+// ----------------------------------------------------------------------------------------
+
+int main(int argc, char** argv) try
+{
+    const unsigned long max_threads = argc > 1 ? std::max(1UL, string_cast<unsigned long>(argv[1])) : 64;
+    const long num_loops = 200;
+    const long loop_size = 10000;
+    const long num_tasks = 100000;
+
+    cout << "\n pool       threads   parallel_for(ms)   nested(ms)   tasks/sec" << endl;
+    for (unsigned long num_threads = 1; num_threads <= max_threads; num_threads *= 2)
+    {
+        std::vector<double> data(loop_size);
+        {
+            baseline_thread_pool tp(num_threads);
+            const double t_flat = time_it([&]() {
+                for (long i = 0; i < num_loops; ++i)
+                {
+                    tp.parallel_for_blocked(0, loop_size, [&](long begin, long end) {
+                        for (long j = begin; j < end; ++j)
+                            data[j] += std::sqrt(j+i);
+                    });
+                }
+            });
+
+            const double t_nested = time_it([&]() {
+                tp.parallel_for_blocked(0, num_loops, [&](long begin, long end) {
+                    for (long i = begin; i < end; ++i)
+                    {
+                        double sum = 0;
+                        std::mutex m;
+                        tp.parallel_for_blocked(0, loop_size/10, [&](long b, long e) {
+                            double s = 0;
+                            for (long j = b; j < e; ++j)
+                                s += std::sqrt(j+i);
+                            std::lock_guard<std::mutex> lock(m);
+                            sum += s;
+                        });
+                        DLIB_CASSERT(sum > 0);
+                    }
+                });
+            });
+
+            std::atomic<long> count(0);
+            const double t_tasks = time_it([&]() {
+                for (long i = 0; i < num_tasks; ++i)
+                    tp.add_task([&](){ ++count; });
+                tp.wait_for_all_tasks();
+            });
+            DLIB_CASSERT(count == num_tasks);
+
+            cout << " baseline" << setw(10) << num_threads
+                 << setw(19) << 1000*t_flat
+                 << setw(13) << 1000*t_nested
+                 << setw(12) << (long)(num_tasks/t_tasks) << endl;
+        }
+
+        thread_pool tp(num_threads);
+
+        const double t_flat = time_it([&]() {
+            for (long i = 0; i < num_loops; ++i)
+                parallel_for(tp, 0, loop_size, [&](long j) { data[j] += std::sqrt(j+i); });
+        });
+
+        const double t_nested = time_it([&]() {
+            parallel_for(tp, 0, num_loops, [&](long i) {
+                double sum = 0;
+                std::mutex m;
+                parallel_for_blocked(tp, 0, loop_size/10, [&](long begin, long end) {
+                    double s = 0;
+                    for (long j = begin; j < end; ++j)
+                        s += std::sqrt(j+i);
+                    std::lock_guard<std::mutex> lock(m);
+                    sum += s;
+                });
+                DLIB_CASSERT(sum > 0);
+            });
+        });
+
+        std::atomic<long> count(0);
+        const double t_tasks = time_it([&]() {
+            for (long i = 0; i < num_tasks; ++i)
+                tp.add_task_by_value([&](){ ++count; });
+            tp.wait_for_all_tasks();
+        });
+        DLIB_CASSERT(count == num_tasks);
+
+        cout << " current " << setw(10) << num_threads
+             << setw(19) << 1000*t_flat
+             << setw(13) << 1000*t_nested
+             << setw(12) << (long)(num_tasks/t_tasks) << endl;
+    }
+}
+catch (std::exception& e)
+{
+    cout << e.what() << endl;
+    return 1;
+}
+
+// ----------------------------------------------------------------------------------------
+